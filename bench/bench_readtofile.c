@@ -0,0 +1,220 @@
+/*
+ * OpenVISA - viReadToFile / viWriteFromFile throughput
+ *
+ * Compares the zero-copy file paths against the read-then-fwrite (and
+ * fread-then-write) loop applications otherwise have to write:
+ *   - raw SOCKET to a loopback server  (splice / sendfile)
+ *   - SIM binary block                 (transport reads into an mmap'ed file)
+ *
+ *   bench_readtofile [megabytes] [output-file]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "visa.h"
+#include "openvisa.h"
+
+#define CHUNK   (1u << 20)
+
+static uint32_t g_bytes;
+static int g_listen;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* ========== Loopback instrument ========== */
+
+/*
+ * One connection per session.  "DATA?\n" answers g_bytes of payload ending
+ * in '\n'; "SINK <n>\n" swallows the next n bytes and answers "OK\n".
+ */
+static void *server_conn(void *arg) {
+    int c = (int)(intptr_t)arg;
+    char *payload = (char*)malloc(CHUNK);
+    memset(payload, 'A', CHUNK);
+    char line[64];
+    size_t ll = 0;
+
+    for (;;) {
+        char ch;
+        if (recv(c, &ch, 1, 0) != 1) break;
+        if (ch != '\n') { if (ll < sizeof(line) - 1) line[ll++] = ch; continue; }
+        line[ll] = '\0';
+        ll = 0;
+
+        if (strcmp(line, "DATA?") == 0) {
+            uint32_t left = g_bytes;
+            while (left > 0) {
+                uint32_t n = left < CHUNK ? left : CHUNK;
+                if (n == left) payload[n - 1] = '\n';
+                ssize_t s = send(c, payload, n, 0);
+                payload[n - 1] = 'A';
+                if (s <= 0) goto done;
+                left -= (uint32_t)s;
+            }
+        } else if (strncmp(line, "SINK ", 5) == 0) {
+            uint32_t left = (uint32_t)strtoul(line + 5, NULL, 10);
+            while (left > 0) {
+                ssize_t r = recv(c, payload, left < CHUNK ? left : CHUNK, 0);
+                if (r <= 0) goto done;
+                left -= (uint32_t)r;
+            }
+            send(c, "OK\n", 3, 0);
+        }
+    }
+done:
+    free(payload);
+    close(c);
+    return NULL;
+}
+
+static void *server_main(void *arg) {
+    (void)arg;
+    for (;;) {
+        int c = accept(g_listen, NULL, NULL);
+        if (c < 0) break;
+        pthread_t t;
+        pthread_create(&t, NULL, server_conn, (void*)(intptr_t)c);
+        pthread_detach(t);
+    }
+    return NULL;
+}
+
+static int server_start(void) {
+    struct sockaddr_in a = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t al = sizeof(a);
+    g_listen = socket(AF_INET, SOCK_STREAM, 0);
+    if (bind(g_listen, (struct sockaddr*)&a, sizeof(a)) != 0 || listen(g_listen, 8) != 0) return -1;
+    getsockname(g_listen, (struct sockaddr*)&a, &al);
+    pthread_t t;
+    pthread_create(&t, NULL, server_main, NULL);
+    pthread_detach(t);
+    return ntohs(a.sin_port);
+}
+
+/* ========== Read paths ========== */
+
+static ViStatus read_fwrite(ViSession vi, const char *cmd, const char *path, uint32_t max, uint32_t *total) {
+    ViUInt32 n;
+    viWrite(vi, (ViBuf)cmd, (ViUInt32)strlen(cmd), &n);
+    FILE *f = fopen(path, "wb");
+    if (!f) return VI_ERROR_FILE_ACCESS;
+    ViBuf buf = (ViBuf)malloc(CHUNK);
+    ViStatus st;
+    *total = 0;
+    do {
+        st = viRead(vi, buf, CHUNK, &n);
+        if (st < VI_SUCCESS) break;
+        fwrite(buf, 1, n, f);
+        *total += n;
+    } while (st != VI_SUCCESS_TERM_CHAR && *total < max);
+    free(buf);
+    fclose(f);
+    return st;
+}
+
+static ViStatus read_to_file(ViSession vi, const char *cmd, const char *path, uint32_t max, uint32_t *total) {
+    ViUInt32 n;
+    viWrite(vi, (ViBuf)cmd, (ViUInt32)strlen(cmd), &n);
+    return viReadToFile(vi, path, max, total);
+}
+
+static void bench_read(const char *label, ViSession vi, const char *cmd, const char *path,
+                       uint32_t max, int reps) {
+    double best[2] = { 1e9, 1e9 };
+    uint32_t total = 0;
+    for (int r = 0; r < reps; r++) {
+        for (int m = 0; m < 2; m++) {
+            double t0 = now_s();
+            ViStatus st = m ? read_to_file(vi, cmd, path, max, &total)
+                            : read_fwrite(vi, cmd, path, max, &total);
+            double dt = now_s() - t0;
+            if (st < VI_SUCCESS) { printf("  %s: failed (0x%08X)\n", label, (unsigned)st); return; }
+            if (dt < best[m]) best[m] = dt;
+        }
+    }
+    double mb = total / 1048576.0;
+    printf("  %-28s %8.1f MB/s  read+fwrite   %8.1f MB/s  viReadToFile  (x%.2f)\n",
+           label, mb / best[0], mb / best[1], best[0] / best[1]);
+}
+
+/* ========== Write paths ========== */
+
+static void bench_write(ViSession vi, const char *path, uint32_t bytes, int reps) {
+    double best[2] = { 1e9, 1e9 };
+    char cmd[64], ok[8];
+    ViUInt32 n;
+    int len = snprintf(cmd, sizeof(cmd), "SINK %u\n", (unsigned)bytes);
+
+    for (int r = 0; r < reps; r++) {
+        for (int m = 0; m < 2; m++) {
+            viWrite(vi, (ViBuf)cmd, (ViUInt32)len, &n);
+            double t0 = now_s();
+            if (m) {
+                viWriteFromFile(vi, path, bytes, &n);
+            } else {
+                FILE *f = fopen(path, "rb");
+                ViBuf buf = (ViBuf)malloc(bytes);
+                size_t got = fread(buf, 1, bytes, f);
+                for (ViUInt32 off = 0; off < got; off += n)
+                    if (viWrite(vi, buf + off, (ViUInt32)(got - off), &n) < VI_SUCCESS) break;
+                free(buf);
+                fclose(f);
+            }
+            viRead(vi, (ViBuf)ok, sizeof(ok), &n);
+            double dt = now_s() - t0;
+            if (dt < best[m]) best[m] = dt;
+        }
+    }
+    double mb = bytes / 1048576.0;
+    printf("  %-28s %8.1f MB/s  fread+write   %8.1f MB/s  viWriteFromFile (x%.2f)\n",
+           "SOCKET write", mb / best[0], mb / best[1], best[0] / best[1]);
+}
+
+int main(int argc, char **argv) {
+    uint32_t mb = argc > 1 ? (uint32_t)atoi(argv[1]) : 256;
+    const char *path = argc > 2 ? argv[2] : "bench_readtofile.bin";
+    g_bytes = mb * 1048576u;
+
+    int port = server_start();
+    if (port < 0) { fprintf(stderr, "cannot start loopback server\n"); return 1; }
+
+    ViSession rm, vi, sim;
+    char rsrc[64];
+    snprintf(rsrc, sizeof(rsrc), "TCPIP::127.0.0.1::%d::SOCKET", port);
+    if (viOpenDefaultRM(&rm) != VI_SUCCESS ||
+        viOpen(rm, rsrc, VI_NULL, VI_NULL, &vi) != VI_SUCCESS) {
+        fprintf(stderr, "cannot open %s\n", rsrc);
+        return 1;
+    }
+    viSetAttribute(vi, VI_ATTR_TMO_VALUE, 10000);
+
+    printf("\n=== viReadToFile / viWriteFromFile throughput (%u MB) ===\n\n", (unsigned)mb);
+    bench_read("SOCKET read (splice)", vi, "DATA?\n", path, g_bytes, 3);
+    bench_write(vi, path, g_bytes, 3);
+
+    /* 16-bit samples: a block of mb MB */
+    char def[128];
+    snprintf(def, sizeof(def), "[commands]\nCURVe? = block noise %u int16\n", (unsigned)(g_bytes / 2));
+    if (ovSimDefine("bench", def) == VI_SUCCESS &&
+        viOpen(rm, "SIM::bench::INSTR", VI_NULL, VI_NULL, &sim) == VI_SUCCESS) {
+        bench_read("SIM block (mmap)", sim, "CURV?\n", path, g_bytes + 16, 3);
+        viClose(sim);
+    }
+
+    remove(path);
+    viClose(vi);
+    viClose(rm);
+    printf("\n");
+    return 0;
+}
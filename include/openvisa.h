@@ -0,0 +1,454 @@
+/*
+ * OpenVISA - openvisa.h
+ * OpenVISA extensions to the VISA API (not part of the IVI specification)
+ * Apache 2.0 License
+ *
+ * Everything declared here is OpenVISA-specific.  Portable VISA programs
+ * only need visa.h; include this header in addition to use the extensions.
+ */
+
+#ifndef __OPENVISA_H__
+#define __OPENVISA_H__
+
+#include "visa.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ========== Simulated instruments (SIM::<name>::INSTR) ========== */
+
+/*
+ * Register (or replace) an in-process simulated instrument definition.
+ *
+ * name:        resource name, opened afterwards as "SIM::<name>::INSTR"
+ * definition:  definition text in the .sim format (see src/transport/sim.c);
+ *              VI_NULL removes a previously registered definition
+ *
+ * Returns VI_ERROR_INV_SETUP if the definition cannot be parsed.  Sessions
+ * already open on a replaced definition keep using the old one.
+ */
+ViStatus _VI_FUNC ovSimDefine(ViConstString name, ViConstString definition);
+
+/* ========== Resource aliases ========== */
+
+/*
+ * viOpen, viParseRsrc and viParseRsrcEx accept aliases defined in the
+ * [ALIASES] section of a visaconf-style INI file ("name = resource" or NI's
+ * "AliasN = \"'name','resource'\"").  The file is read on first use from
+ * $OPENVISA_ALIASES, else %APPDATA%\OpenVISA\visaconf.ini or
+ * $XDG_CONFIG_HOME/openvisa/visaconf.ini.  ovAliasLoad replaces the table
+ * with the given file's (NULL = read the default file again) and empties
+ * the parse cache.
+ */
+ViStatus _VI_FUNC ovAliasLoad(ViConstString path);
+
+/* ========== Transport plugins ========== */
+
+/*
+ * Resources "PREFIX[board]::address..." are opened by the transport in the
+ * module library (a path, or a name searched in $OPENVISA_PLUGIN_PATH, the
+ * install plugin directory and the loader's default path, with the
+ * platform's extension appended).  The module is loaded on the first open
+ * and must export ov_transport_plugin (src/core/plugin.h).  Registering
+ * USB, GPIB or ASRL replaces the bundled transport; the other built-in
+ * prefixes are refused with VI_ERROR_INV_SETUP.
+ */
+ViStatus _VI_FUNC ovTransportRegister(ViConstString prefix, ViConstString library);
+
+/* ========== Batch operations ========== */
+
+/*
+ * Write cmd to every session and read one response from each, all
+ * sessions concurrently.  Response i lands in bufs[i] (bufSize bytes
+ * each), its length in retCounts[i] and its status in statuses[i]
+ * (statuses may be VI_NULL).  Each session keeps its own timeout.
+ *
+ * Returns VI_SUCCESS if every session succeeded, otherwise the status of
+ * the first failing session.  A session may appear only once
+ * (VI_ERROR_INV_SETUP).
+ */
+ViStatus _VI_FUNC ovQueryMany(const ViSession sessions[], ViUInt32 count, ViConstString cmd,
+                              ViBuf bufs[], ViUInt32 bufSize,
+                              ViUInt32 retCounts[], ViStatus statuses[]);
+
+/*
+ * Open count resources concurrently, on up to maxParallel workers (0 = all
+ * at once), each as viOpen(sesn, rsrcNames[i], VI_NULL, openTimeout).
+ * vis[i] receives the session or VI_NULL if that open failed, statuses[i]
+ * (statuses may be VI_NULL) its status.  The wall time is about that of the
+ * slowest open instead of the sum.  Returns VI_SUCCESS if every open
+ * succeeded, otherwise the status of the first failing one; the sessions
+ * that did open stay open either way.
+ */
+ViStatus _VI_FUNC ovOpenMany(ViSession sesn, const ViConstRsrc rsrcNames[], ViUInt32 count,
+                             ViUInt32 openTimeout, ViUInt32 maxParallel,
+                             ViSession vis[], ViStatus statuses[]);
+
+/* ========== Command pipeline ========== */
+
+/*
+ * Queue commands and queries on one session and collect the responses
+ * later through futures.  Commands are written ahead of the responses while
+ * the bytes sent since the oldest unanswered query stay within inputBudget
+ * (the instrument's input buffer; 0 = 1024) and the protocol allows it
+ * (one query in flight on VXI-11, USBTMC, GPIB, HiSLIP in synchronized
+ * mode, raw sockets and serial ports; see ovPipelineSetMaxPending).
+ * Responses are matched to futures in submission order.
+ *
+ * While a pipeline is open, do all I/O on the session through it.  Not with
+ * ovReadAheadEnable, which holds each write until the previous response is
+ * in: VI_ERROR_IN_PROGRESS on a session reading ahead.
+ */
+
+typedef struct OvPipeline OvPipeline;
+typedef ViUInt32          OvFuture;
+
+ViStatus _VI_FUNC ovPipelineCreate(ViSession vi, ViUInt32 inputBudget, OvPipeline **pipeline);
+
+/* Override the protocol's limit on unanswered queries (0 = only the input
+ * budget limits them), for instruments known to queue their responses */
+ViStatus _VI_FUNC ovPipelineSetMaxPending(OvPipeline *pipeline, ViUInt32 maxPending);
+
+/* Queue cmd (sent verbatim, include the terminator).  future may be VI_NULL:
+ * the result is then discarded instead of kept for ovFutureWait. */
+ViStatus _VI_FUNC ovPipelineWrite(OvPipeline *pipeline, ViConstString cmd, OvFuture *future);
+ViStatus _VI_FUNC ovPipelineQuery(OvPipeline *pipeline, ViConstString cmd, OvFuture *future);
+
+/*
+ * Block until the future completes and release it.  For a query the
+ * response is copied to buf; VI_SUCCESS_MAX_CNT if it did not fit.  Returns
+ * the write/read status, VI_ERROR_INV_JOB_ID for an unknown or released future.
+ */
+ViStatus _VI_FUNC ovFutureWait(OvPipeline *pipeline, OvFuture future, ViBuf buf,
+                               ViUInt32 count, ViUInt32 *retCount);
+
+/* Complete everything queued (results stay available to ovFutureWait);
+ * returns the first failure */
+ViStatus _VI_FUNC ovPipelineWaitAll(OvPipeline *pipeline);
+
+/* Drain outstanding responses and free the pipeline */
+ViStatus _VI_FUNC ovPipelineClose(OvPipeline *pipeline);
+
+/* ========== Write coalescing ========== */
+
+/*
+ * Hold consecutive command writes (no '?') on a session and send them as
+ * one program message, "CMD1;:CMD2;:CMD3" (a ':' is added so each command
+ * still starts at the root of the command tree).  The message goes out
+ * when windowMs (0 = 5 ms) has passed since the first held command, before
+ * it would grow past maxBytes (0 = 1024), and before any query, viRead,
+ * viReadSTB, viClear, trigger, file transfer or viClose on the session.
+ * Messages containing block data are never joined.
+ *
+ * Held writes report success immediately; if sending them fails later, the
+ * next call on the session returns the error.  Enabling again changes the
+ * limits.
+ */
+ViStatus _VI_FUNC ovCoalesceEnable(ViSession vi, ViUInt32 windowMs, ViUInt32 maxBytes);
+
+/* Send what is held and stop coalescing */
+ViStatus _VI_FUNC ovCoalesceDisable(ViSession vi);
+
+/* Send what is held now */
+ViStatus _VI_FUNC ovCoalesceFlush(ViSession vi);
+
+/* ========== Adaptive timeouts ========== */
+
+/*
+ * Learn how long each query takes and stop waiting for a response long
+ * before VI_ATTR_TMO_VALUE when the instrument is clearly stuck.  Latency
+ * from write to end of response is tracked per query header ("MEAS:VOLT"
+ * for "MEAS:VOLT? 10"); after 8 samples, a read following that query waits
+ * at most multiplier x its percentile latency (0 = 99th, x4), but at least
+ * floorMs (0 = 50) and never longer than VI_ATTR_TMO_VALUE.  Headers not
+ * seen often enough use VI_ATTR_TMO_VALUE.  Enabling again changes the
+ * parameters and keeps what was learned.
+ */
+ViStatus _VI_FUNC ovAdaptiveTimeoutEnable(ViSession vi, ViReal64 percentile,
+                                          ViReal64 multiplier, ViUInt32 floorMs);
+
+/* Stop adapting and forget the learned table */
+ViStatus _VI_FUNC ovAdaptiveTimeoutDisable(ViSession vi);
+
+/* Timeout a read after query would get now, and the samples it is based on */
+ViStatus _VI_FUNC ovAdaptiveTimeoutQuery(ViSession vi, ViConstString query,
+                                         ViUInt32 *timeoutMs, ViUInt32 *samples);
+
+/* Export the learned table as text / replace it with a saved one (enabling
+ * adaptive timeouts with the defaults if they are off) */
+ViStatus _VI_FUNC ovAdaptiveTimeoutSave(ViSession vi, ViConstString path);
+ViStatus _VI_FUNC ovAdaptiveTimeoutLoad(ViSession vi, ViConstString path);
+
+/* ========== Synchronized group trigger ========== */
+
+/*
+ * Trigger many instruments at (nearly) the same instant.  Each session is
+ * triggered with its protocol-native message (HiSLIP Trigger, VXI-11
+ * device_trigger, USB488 TRIGGER, GPIB GET; "*TRG\n" otherwise), released
+ * from one pre-started thread per session.  GPIB devices on the same board
+ * are triggered together by a single addressed GET.
+ *
+ * The group owns one parked thread per session until closed; do not do
+ * other I/O on a session while ovTriggerGroupFire runs.
+ */
+
+typedef struct OvTriggerGroup OvTriggerGroup;
+
+/* A session may appear only once (VI_ERROR_INV_SETUP) */
+ViStatus _VI_FUNC ovTriggerGroupCreate(const ViSession sessions[], ViUInt32 count,
+                                       OvTriggerGroup **group);
+
+/*
+ * Fire once.  statuses[i] (may be VI_NULL) receives each session's result;
+ * spreadNs (may be VI_NULL) the time between the first and the last send.
+ * Returns VI_SUCCESS or the status of the first failing session.
+ */
+ViStatus _VI_FUNC ovTriggerGroupFire(OvTriggerGroup *group, ViStatus statuses[],
+                                     ViUInt64 *spreadNs);
+
+ViStatus _VI_FUNC ovTriggerGroupClose(OvTriggerGroup *group);
+
+/* ========== Connection reuse pool ========== */
+
+/*
+ * Opt-in, per process.  With an idle time set, viClose of a TCPIP SOCKET or
+ * HiSLIP session parks the live connection instead of closing it, and a
+ * viOpen of the same resource within idleMs picks it up again without
+ * connecting (or, for HiSLIP, repeating the Initialize handshake).  Unread
+ * input is drained (SOCKET) or device-cleared (HiSLIP) before parking; a
+ * parked connection the peer closed or sent data on is dropped rather than
+ * reused.  $OPENVISA_POOL_IDLE_MS sets the idle time until this is called.
+ */
+
+typedef struct {
+    ViUInt32 hits;          /* opens served from the pool */
+    ViUInt32 misses;        /* poolable opens that had to connect */
+    ViUInt32 stale;         /* parked connections that failed the health check */
+    ViUInt32 expired;       /* parked connections closed after idleMs */
+    ViUInt32 idle;          /* connections parked right now */
+} OvPoolStats;
+
+/* idleMs 0 disables the pool and closes everything parked; maxPerRsrc 0 = 4 */
+ViStatus _VI_FUNC ovPoolConfigure(ViUInt32 idleMs, ViUInt32 maxPerRsrc);
+
+ViStatus _VI_FUNC ovPoolGetStats(OvPoolStats *stats);
+
+/* ========== Shared-memory soft instruments (SHM::<name>::INSTR) ========== */
+
+/*
+ * Instrument side of SHM::<name>::INSTR (Linux only, NSUP_OPER elsewhere).
+ * ovShmServerCreate publishes a shared memory object holding one command and
+ * one response ring; a client process opens it with viOpen.  One client at a
+ * time; a server is driven by a single thread.
+ */
+
+typedef struct OvShmServer OvShmServer;
+
+/* ringSize: bytes per ring, rounded up to a power of two; 0 = 1 MiB */
+ViStatus _VI_FUNC ovShmServerCreate(ViConstString name, ViUInt32 ringSize, OvShmServer **server);
+
+/* Next piece of a command: VI_SUCCESS when its end was read, VI_SUCCESS_MAX_CNT if buf filled */
+ViStatus _VI_FUNC ovShmServerRead(OvShmServer *server, ViBuf buf, ViUInt32 count,
+                                  ViUInt32 *retCount, ViUInt32 timeout);
+
+/* Copy a response into the ring; end marks its last piece */
+ViStatus _VI_FUNC ovShmServerWrite(OvShmServer *server, ViConstBuf buf, ViUInt32 count,
+                                   ViBoolean end, ViUInt32 timeout);
+
+/* Build a response in place: *ptr receives room for up to want bytes (*size,
+ * at least min(want, ringSize / 4)); ovShmServerCommit publishes count of them */
+ViStatus _VI_FUNC ovShmServerReserve(OvShmServer *server, ViUInt32 want, ViBuf *ptr,
+                                     ViUInt32 *size, ViUInt32 timeout);
+
+ViStatus _VI_FUNC ovShmServerCommit(OvShmServer *server, ViUInt32 count, ViBoolean end);
+
+/* Status byte returned by viReadSTB, without a round trip */
+ViStatus _VI_FUNC ovShmServerSetStatus(OvShmServer *server, ViUInt16 stb);
+
+/* Unpublish the name; a connected client sees VI_ERROR_CONN_LOST */
+ViStatus _VI_FUNC ovShmServerClose(OvShmServer *server);
+
+/* ========== Capture files (continuous acquisition logging) ========== */
+
+/*
+ * Append-only, chunked log of timestamped responses from many sessions.
+ * Records are packed into chunks (optionally LZ4-compressed); a footer
+ * index of per-chunk time range and session mask gives random access by
+ * time.  A file whose writer never closed is still readable: the reader
+ * falls back to walking the chunk headers.
+ */
+
+typedef struct OvCapture        OvCapture;
+typedef struct OvCaptureReader  OvCaptureReader;
+
+#define OV_CAPTURE_LZ4          (0x0001)    /* compress chunks (LZ4 block format) */
+
+/* Called once per matching record; any status other than VI_SUCCESS stops the scan */
+typedef ViStatus (*OvCaptureHandler)(ViUInt64 timestampNs, ViSession vi,
+                                     ViConstBuf data, ViUInt32 len, ViAddr userHandle);
+
+/* flags: OV_CAPTURE_*; chunkSize: bytes per chunk, 0 = 1 MiB.  Truncates path. */
+ViStatus _VI_FUNC ovCaptureCreate(ViConstString path, ViUInt32 flags,
+                                  ViUInt32 chunkSize, OvCapture **cap);
+
+/* Append one record; timestampNs 0 = now (ns since the Unix epoch).  Thread-safe. */
+ViStatus _VI_FUNC ovCaptureAppend(OvCapture *cap, ViSession vi, ViUInt64 timestampNs,
+                                  ViConstBuf data, ViUInt32 len);
+
+/* viRead and log the response in one call */
+ViStatus _VI_FUNC ovCaptureRead(OvCapture *cap, ViSession vi, ViBuf buf,
+                                ViUInt32 count, ViUInt32 *retCount);
+
+/* Seal the open chunk and push it to stable storage */
+ViStatus _VI_FUNC ovCaptureFlush(OvCapture *cap);
+
+/* Seal, write the index and close */
+ViStatus _VI_FUNC ovCaptureClose(OvCapture *cap);
+
+ViStatus _VI_FUNC ovCaptureOpenReader(ViConstString path, OvCaptureReader **reader);
+
+/* Visit records with tStartNs <= timestamp <= tEndNs; vi = VI_NULL for all sessions */
+ViStatus _VI_FUNC ovCaptureScan(OvCaptureReader *reader, ViUInt64 tStartNs, ViUInt64 tEndNs,
+                                ViSession vi, OvCaptureHandler handler, ViAddr userHandle);
+
+/* Time span and record count of the whole file */
+ViStatus _VI_FUNC ovCaptureGetRange(OvCaptureReader *reader, ViUInt64 *tFirstNs,
+                                    ViUInt64 *tLastNs, ViUInt64 *records);
+
+/* Resource string the session was opened with (VI_ERROR_RSRC_NFOUND if unknown) */
+ViStatus _VI_FUNC ovCaptureSessionName(OvCaptureReader *reader, ViSession vi, ViChar name[]);
+
+ViStatus _VI_FUNC ovCaptureCloseReader(OvCaptureReader *reader);
+
+/* ========== Query response cache ========== */
+
+/*
+ * Per-session cache for idempotent queries such as *IDN?.  Once enabled,
+ * the first viWrite of a listed query goes to the instrument and the
+ * response read after it is kept; later writes of the same query are not
+ * sent and the following viRead calls return the kept response.  Queries
+ * compare case-insensitively, ignoring trailing whitespace and terminators.
+ * Cached responses are dropped by viClear, by any command containing *RST,
+ * by a lost connection and by ovQueryCacheFlush.
+ *
+ * queries: up to 16 queries of at most 63 characters; VI_NULL selects
+ * *IDN?, *OPT? and SYST:VERS?.  Enabling again replaces the list and
+ * empties the cache.
+ */
+ViStatus _VI_FUNC ovQueryCacheEnable(ViSession vi, const ViConstString queries[], ViUInt32 count);
+ViStatus _VI_FUNC ovQueryCacheFlush(ViSession vi);
+
+#define OV_ATTR_QUERY_CACHE_EN      (0x3FFF8001UL)  /* ViBoolean: VI_TRUE enables the defaults */
+#define OV_ATTR_QUERY_CACHE_HITS    (0x3FFF8002UL)  /* ViUInt32, read-only: writes answered from the cache */
+#define OV_ATTR_QUERY_CACHE_MISSES  (0x3FFF8003UL)  /* ViUInt32, read-only: listed queries sent to the instrument */
+
+/* ========== Continuous streaming ========== */
+
+/*
+ * For instruments that push data continuously (raw sockets, HiSLIP).
+ * ovStreamStart starts a reader thread that drains the connection into a
+ * lock-free single-producer / single-consumer ring of ringSize bytes
+ * (rounded up to a power of two, at least 64 KiB; 0 = 16 MiB), so a
+ * briefly stalled application loses nothing as long as the ring has room.
+ * When it is full, arriving data is dropped and counted.
+ *
+ * One thread consumes: ovStreamAcquire waits up to timeout ms for data and
+ * points *data at the contiguous run of unread bytes in the ring (*count of
+ * them; the rest follows at the start of the ring after a wrap), and
+ * ovStreamRelease frees count of them.  viRead copies out of the ring
+ * instead.  viWrite still goes to the instrument; viReadToFile,
+ * viWriteFromFile, viReadSTB and viClear return VI_ERROR_IN_PROGRESS until
+ * the stream is stopped.  Once the connection fails and the ring is
+ * empty, ovStreamAcquire and viRead return the failure.  ovStreamStop (or viClose) stops the
+ * reader within about 100 ms and discards what is unread.
+ */
+#define OV_STREAM_HUGE_PAGES    0x0001      /* back the ring with huge pages if available */
+
+ViStatus _VI_FUNC ovStreamStart(ViSession vi, ViUInt32 ringSize, ViUInt32 flags);
+ViStatus _VI_FUNC ovStreamAcquire(ViSession vi, ViUInt32 timeout, ViBuf *data, ViUInt32 *count);
+ViStatus _VI_FUNC ovStreamRelease(ViSession vi, ViUInt32 count);
+ViStatus _VI_FUNC ovStreamStop(ViSession vi);
+
+#define OV_ATTR_STREAM_FILL         (0x3FFF8004UL)  /* ViUInt32, read-only: bytes unread */
+#define OV_ATTR_STREAM_HIGH_WATER   (0x3FFF8005UL)  /* ViUInt32, read-only: most bytes ever unread */
+#define OV_ATTR_STREAM_OVERFLOWS    (0x3FFF8006UL)  /* ViUInt32, read-only: reads that found the ring full */
+#define OV_ATTR_STREAM_DROPPED      (0x3FFF8007UL)  /* ViUInt64, read-only: bytes dropped for lack of room */
+#define OV_ATTR_STREAM_RECEIVED     (0x3FFF8008UL)  /* ViUInt64, read-only: bytes read from the instrument */
+#define OV_ATTR_STREAM_HUGE_PAGES   (0x3FFF8009UL)  /* ViBoolean, read-only: ring is on huge pages */
+
+/* ========== Speculative read-ahead ========== */
+
+/*
+ * Opt-in per session.  After a viWrite holding a '?', a session thread
+ * starts receiving the response straight away, into a buffer of bufferSize
+ * bytes (0 = 1 MiB), while the application is still busy; the next viRead
+ * joins that read (its timeout counting from the viRead) or is served from
+ * the buffer; viReadToFile takes it too.  Saves the read's request round
+ * trip on VXI-11, proxy and remote sessions.  A read-ahead that times out
+ * before viRead is dropped and viRead waits as usual.  Other I/O waits for
+ * a read in flight; viReadSTB and viClear cancel it instead, and viClear
+ * drops a buffered response.  Enabling again resizes the
+ * buffer; both that and ovReadAheadDisable return VI_ERROR_IN_PROGRESS
+ * while a response is buffered and unread.  Not with ovStreamStart or an
+ * open ovPipeline.
+ */
+ViStatus _VI_FUNC ovReadAheadEnable(ViSession vi, ViUInt32 bufferSize);
+ViStatus _VI_FUNC ovReadAheadDisable(ViSession vi);
+
+#define OV_ATTR_READ_AHEAD_EN       (0x3FFF800AUL)  /* ViBoolean: VI_TRUE enables with a 1 MiB buffer */
+#define OV_ATTR_READ_AHEAD_HITS     (0x3FFF800BUL)  /* ViUInt32, read-only: viRead calls served from a successful read-ahead */
+
+/* ========== Host circuit breaker ========== */
+
+/*
+ * Process-wide, for TCPIP resources.  A transport open that times out or
+ * finds the host unreachable counts a failure against the host; any other
+ * outcome, a refused connection included, clears the count.  After
+ * failThreshold failures in a row the host is down and viOpen of any
+ * resource on it returns VI_ERROR_RSRC_NFOUND at once instead of waiting
+ * out the open timeout again.  A background thread probes a down host with
+ * a TCP connect, first after probeMinMs and then with the wait doubling up
+ * to probeMaxMs, and marks it healthy when it answers.  ovBreakerReset marks
+ * one host (VI_NULL: all) healthy straight away.
+ *
+ * Off by default; failThreshold 0 turns it off again.  The probe waits
+ * default to 500 ms and 60 s when given as 0.  $OPENVISA_BREAKER, as
+ * "fails[,minMs[,maxMs]]", applies until ovBreakerConfigure is called.
+ * ovBreakerGetState reports a host by the name used in its resources;
+ * nextProbeMs is the wait until its next probe (0 when healthy).
+ */
+#define OV_HOST_HEALTHY     0
+#define OV_HOST_DOWN        1
+
+ViStatus _VI_FUNC ovBreakerConfigure(ViUInt32 failThreshold, ViUInt32 probeMinMs, ViUInt32 probeMaxMs);
+ViStatus _VI_FUNC ovBreakerGetState(ViConstString host, ViUInt16 *state, ViUInt32 *failures,
+                                    ViUInt32 *nextProbeMs);
+ViStatus _VI_FUNC ovBreakerReset(ViConstString host);
+
+#define OV_ATTR_HOST_STATE          (0x3FFF800CUL)  /* ViUInt16, read-only: OV_HOST_HEALTHY or OV_HOST_DOWN */
+#define OV_ATTR_HOSTS_DOWN          (0x3FFF800DUL)  /* ViUInt32, read-only, RM session: hosts marked down */
+
+/* ========== HiSLIP / VXI-11 auto-selection ========== */
+
+/*
+ * Process-wide, off by default.  When on, viOpen of a plain INSTR resource
+ * (TCPIP::host::INSTR or TCPIP::host::inst0::INSTR) connects to the host's
+ * HiSLIP port 4880 and its VXI-11 portmapper at once and opens the session
+ * as TCPIP::host::hislip0::INSTR if HiSLIP answers, else as VXI-11.  The
+ * choice is kept per host, so later opens do not probe; a failed open on
+ * it, or ovAutoProtocolForget (VI_NULL: all hosts), makes the next open
+ * probe again.  The session keeps the resource name it was opened with;
+ * OV_ATTR_TCPIP_HISLIP tells which protocol it uses.  $OPENVISA_AUTO_PROTOCOL=1
+ * turns it on until ovAutoProtocolEnable is called.
+ */
+ViStatus _VI_FUNC ovAutoProtocolEnable(ViBoolean enable);
+ViStatus _VI_FUNC ovAutoProtocolForget(ViConstString host);
+
+#define OV_ATTR_TCPIP_HISLIP        (0x3FFF800EUL)  /* ViBoolean, read-only: TCPIP session talks HiSLIP */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __OPENVISA_H__ */
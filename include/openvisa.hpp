@@ -0,0 +1,553 @@
+/*
+ * OpenVISA - openvisa.hpp
+ * Optional C++20 layer over the C API (header only)
+ * Apache 2.0 License
+ *
+ * RAII owners for the resource manager, sessions and locks, errors as
+ * ov::error exceptions, and co_await-able I/O built on viReadAsync /
+ * viWriteAsync and VI_EVENT_IO_COMPLETION.  Completions arrive on library
+ * worker threads and are handed to an ov::io_context, whose run() resumes
+ * every coroutine on the one thread that calls it:
+ *
+ *     ov::task<> identify(ov::session &s) {
+ *         std::string idn = co_await s.async_query("*IDN?\n");
+ *     }
+ *
+ *     ov::io_context io;
+ *     ov::resource_manager rm;
+ *     ov::session dmm(io, rm, "TCPIP::10.0.0.5::INSTR");
+ *     io.spawn(identify(dmm));
+ *     io.run();
+ *
+ * Inside the library each operation is still a blocking viRead/viWrite,
+ * run on its shared worker pool with one thread per session that has
+ * operations pending: co_await frees the application's thread, not the
+ * library's.
+ *
+ * A session and the buffers of its pending operations must outlive them.
+ * Pass what a coroutine needs as parameters: a lambda's captures die with
+ * the lambda, before the coroutine it started resumes.
+ */
+
+#ifndef OPENVISA_HPP
+#define OPENVISA_HPP
+
+#include "visa.h"
+#include "openvisa.h"
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace ov {
+
+/* ========== Errors ========== */
+
+class error : public std::runtime_error {
+public:
+    explicit error(ViStatus status) : std::runtime_error(describe(status)), status_(status) {}
+    ViStatus status() const noexcept { return status_; }
+
+private:
+    static std::string describe(ViStatus status) {
+        ViChar desc[256];
+        viStatusDesc(VI_NULL, status, desc);
+        return desc;
+    }
+    ViStatus status_;
+};
+
+/* Throws ov::error for an error status, passes completion codes through */
+inline ViStatus check(ViStatus status) {
+    if (status < VI_SUCCESS) throw error(status);
+    return status;
+}
+
+/* ========== Coroutine task ========== */
+
+template <typename T = void> class task;
+
+namespace detail {
+
+struct promise_base {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+
+    struct final_awaiter {
+        bool await_ready() const noexcept { return false; }
+        template <typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+            auto next = h.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    final_awaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { exception = std::current_exception(); }
+};
+
+template <typename T>
+struct promise : promise_base {
+    std::optional<T> value;
+
+    task<T> get_return_object() noexcept;
+    template <typename U> void return_value(U &&v) { value.emplace(std::forward<U>(v)); }
+    T result() {
+        if (exception) std::rethrow_exception(exception);
+        return std::move(*value);
+    }
+};
+
+template <>
+struct promise<void> : promise_base {
+    task<void> get_return_object() noexcept;
+    void return_void() const noexcept {}
+    void result() {
+        if (exception) std::rethrow_exception(exception);
+    }
+};
+
+} // namespace detail
+
+/* Lazily started coroutine: runs when co_awaited or spawned on an
+ * io_context, and resumes its awaiter when it finishes */
+template <typename T>
+class [[nodiscard]] task {
+public:
+    using promise_type = detail::promise<T>;
+
+    task(task &&other) noexcept : h_(std::exchange(other.h_, {})) {}
+    task &operator=(task &&other) noexcept {
+        if (this != &other) {
+            if (h_) h_.destroy();
+            h_ = std::exchange(other.h_, {});
+        }
+        return *this;
+    }
+    ~task() { if (h_) h_.destroy(); }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+        h_.promise().continuation = awaiter;
+        return h_;
+    }
+    T await_resume() { return h_.promise().result(); }
+
+private:
+    friend promise_type;
+    explicit task(std::coroutine_handle<promise_type> h) noexcept : h_(h) {}
+    std::coroutine_handle<promise_type> h_;
+};
+
+namespace detail {
+
+template <typename T>
+task<T> promise<T>::get_return_object() noexcept {
+    return task<T>(std::coroutine_handle<promise<T>>::from_promise(*this));
+}
+
+inline task<void> promise<void>::get_return_object() noexcept {
+    return task<void>(std::coroutine_handle<promise<void>>::from_promise(*this));
+}
+
+/* Fire-and-forget frame io_context::spawn wraps a task in */
+struct detached {
+    struct promise_type {
+        detached get_return_object() noexcept {
+            return { std::coroutine_handle<promise_type>::from_promise(*this) };
+        }
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+    std::coroutine_handle<promise_type> h;
+};
+
+} // namespace detail
+
+/* ========== Event loop ========== */
+
+class io_context {
+public:
+    io_context() = default;
+    io_context(const io_context &) = delete;
+    io_context &operator=(const io_context &) = delete;
+
+    /* Start t on the next run(); an exception t lets escape is rethrown
+     * from run() once every spawned task has finished */
+    void spawn(task<void> t) {
+        auto d = drive(*this, std::move(t));
+        std::lock_guard<std::mutex> lk(mu_);
+        ++live_;
+        ready_.push_back(d.h);
+    }
+
+    /* Resume coroutines on this thread until every spawned task is done */
+    void run() {
+        std::unique_lock<std::mutex> lk(mu_);
+        while (live_ > 0) {
+            cv_.wait(lk, [this] { return !ready_.empty(); });
+            auto h = ready_.front();
+            ready_.pop_front();
+            lk.unlock();
+            h.resume();
+            lk.lock();
+        }
+        if (auto e = std::exchange(failed_, nullptr)) std::rethrow_exception(e);
+    }
+
+    /* Queue h for run(); safe from any thread */
+    void post(std::coroutine_handle<> h) {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            ready_.push_back(h);
+        }
+        cv_.notify_one();
+    }
+
+private:
+    static detail::detached drive(io_context &io, task<void> t) {
+        try {
+            co_await t;
+        } catch (...) {
+            std::lock_guard<std::mutex> lk(io.mu_);
+            if (!io.failed_) io.failed_ = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lk(io.mu_);
+        --io.live_;
+    }
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<std::coroutine_handle<>> ready_;
+    std::size_t live_ = 0;
+    std::exception_ptr failed_;
+};
+
+/* ========== Resource manager ========== */
+
+class resource_manager {
+public:
+    resource_manager() { check(viOpenDefaultRM(&rm_)); }
+    resource_manager(resource_manager &&other) noexcept : rm_(std::exchange(other.rm_, VI_NULL)) {}
+    resource_manager &operator=(resource_manager &&other) noexcept {
+        if (this != &other) {
+            if (rm_) viClose(rm_);
+            rm_ = std::exchange(other.rm_, VI_NULL);
+        }
+        return *this;
+    }
+    ~resource_manager() { if (rm_) viClose(rm_); }
+
+    ViSession get() const noexcept { return rm_; }
+
+private:
+    ViSession rm_ = VI_NULL;
+};
+
+/* ========== Asynchronous operations ========== */
+
+/* What an async read returned: bytes, and whether the message ended */
+struct read_result {
+    std::size_t count;
+    bool end;
+};
+
+namespace detail {
+
+class io_operation;
+
+/* Per-session link from the completion handler to the waiting coroutines;
+ * heap-allocated so its address (the handler's user data) survives moves */
+struct async_state {
+    io_context *io;
+    std::mutex mu;
+    std::vector<io_operation *> pending;
+};
+
+class io_operation {
+public:
+    io_operation(ViSession vi, async_state *state, bool read, void *buf, std::size_t count) noexcept
+        : vi_(vi), state_(state), read_(read), buf_(static_cast<ViBuf>(buf)),
+          count_(static_cast<ViUInt32>(count)) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> awaiter) {
+        if (!state_) {
+            status_ = VI_ERROR_INV_SETUP;       /* session has no io_context */
+            return false;
+        }
+        awaiter_ = awaiter;
+        /* Held across the submit so the handler cannot look for this
+         * operation before it is listed */
+        std::lock_guard<std::mutex> lk(state_->mu);
+        status_ = read_ ? viReadAsync(vi_, buf_, count_, &job_)
+                        : viWriteAsync(vi_, buf_, count_, &job_);
+        if (status_ < VI_SUCCESS) return false;
+        state_->pending.push_back(this);
+        return true;
+    }
+
+    /* VI_EVENT_IO_COMPLETION handler installed on every session with an io_context */
+    static ViStatus on_completion(ViSession, ViEventType, ViEvent ctx, ViAddr user) {
+        auto *state = static_cast<async_state *>(user);
+        ViJobId job = VI_NULL;
+        ViStatus status = VI_SUCCESS;
+        ViUInt32 count = 0;
+        viGetAttribute(ctx, VI_ATTR_JOB_ID, &job);
+        viGetAttribute(ctx, VI_ATTR_STATUS, &status);
+        viGetAttribute(ctx, VI_ATTR_RET_COUNT, &count);
+
+        io_operation *op = nullptr;
+        {
+            std::lock_guard<std::mutex> lk(state->mu);
+            for (auto it = state->pending.begin(); it != state->pending.end(); ++it) {
+                if ((*it)->job_ == job) {
+                    op = *it;
+                    state->pending.erase(it);
+                    break;
+                }
+            }
+        }
+        if (op) {
+            op->status_ = status;
+            op->count_ = count;
+            state->io->post(op->awaiter_);
+        }
+        return VI_SUCCESS;
+    }
+
+protected:
+    ViSession vi_;
+    async_state *state_;
+    bool read_;
+    ViBuf buf_;
+    ViUInt32 count_;
+    ViJobId job_ = VI_NULL;
+    ViStatus status_ = VI_SUCCESS;
+    std::coroutine_handle<> awaiter_;
+};
+
+} // namespace detail
+
+class write_operation : public detail::io_operation {
+public:
+    using io_operation::io_operation;
+    std::size_t await_resume() const {
+        check(status_);
+        return count_;
+    }
+};
+
+class read_operation : public detail::io_operation {
+public:
+    using io_operation::io_operation;
+    read_result await_resume() const {
+        check(status_);
+        return { count_, status_ != VI_SUCCESS_MAX_CNT };
+    }
+};
+
+/* ========== Sessions ========== */
+
+class session_lock;
+
+class session {
+public:
+    /* Synchronous I/O only */
+    session(resource_manager &rm, std::string_view rsrc, ViUInt32 openTimeout = VI_NULL) {
+        std::string name(rsrc);
+        check(viOpen(rm.get(), name.data(), VI_NULL, openTimeout, &vi_));
+    }
+
+    /* Also co_await-able I/O, resumed by io.run() */
+    session(io_context &io, resource_manager &rm, std::string_view rsrc, ViUInt32 openTimeout = VI_NULL)
+        : session(rm, rsrc, openTimeout) {
+        auto state = std::make_unique<detail::async_state>();
+        state->io = &io;
+        ViStatus st = viInstallHandler(vi_, VI_EVENT_IO_COMPLETION,
+                                       &detail::io_operation::on_completion, state.get());
+        if (st >= VI_SUCCESS) st = viEnableEvent(vi_, VI_EVENT_IO_COMPLETION, VI_HNDLR, VI_NULL);
+        async_ = std::move(state);
+        check(st);                              /* ~session closes vi_ */
+    }
+
+    session(session &&other) noexcept
+        : vi_(std::exchange(other.vi_, VI_NULL)), async_(std::move(other.async_)) {}
+    session &operator=(session &&other) noexcept {
+        if (this != &other) {
+            close();
+            vi_ = std::exchange(other.vi_, VI_NULL);
+            async_ = std::move(other.async_);
+        }
+        return *this;
+    }
+    ~session() { close(); }
+
+    /* viClose waits out a running completion handler, so async_ can go after it */
+    void close() noexcept {
+        if (vi_) viClose(vi_);
+        vi_ = VI_NULL;
+        async_.reset();
+    }
+
+    ViSession get() const noexcept { return vi_; }
+
+    void set_attribute(ViAttr attr, ViAttrState value) { check(viSetAttribute(vi_, attr, value)); }
+    template <typename T> T get_attribute(ViAttr attr) const {
+        T value{};
+        check(viGetAttribute(vi_, attr, &value));
+        return value;
+    }
+
+    /* Exclusive lock for the lifetime of the returned guard */
+    session_lock lock(ViUInt32 timeout = VI_TMO_INFINITE);
+
+    /* ----- Synchronous I/O ----- */
+
+    std::size_t write(std::string_view data) {
+        ViUInt32 n = 0;
+        check(viWrite(vi_, (ViBuf)data.data(), static_cast<ViUInt32>(data.size()), &n));
+        return n;
+    }
+
+    read_result read(std::span<std::byte> buf) {
+        ViUInt32 n = 0;
+        ViStatus st = check(viRead(vi_, reinterpret_cast<ViBuf>(buf.data()), static_cast<ViUInt32>(buf.size()), &n));
+        return { n, st != VI_SUCCESS_MAX_CNT };
+    }
+
+    /* Write q, read the whole response; a trailing newline is dropped */
+    std::string query(std::string_view q) {
+        write(q);
+        std::string out;
+        for (;;) {
+            std::size_t have = out.size();
+            out.resize(have + chunk);
+            read_result r = read(std::as_writable_bytes(std::span<char>(out).subspan(have)));
+            out.resize(have + r.count);
+            if (r.end) break;
+        }
+        return trim(std::move(out));
+    }
+
+    /* ----- Asynchronous I/O (session opened with an io_context) ----- */
+
+    write_operation async_write(std::string_view data) {
+        return write_operation(vi_, async_.get(), false, const_cast<char *>(data.data()), data.size());
+    }
+
+    read_operation async_read(std::span<std::byte> buf) {
+        return read_operation(vi_, async_.get(), true, buf.data(), buf.size());
+    }
+
+    task<std::string> async_query(std::string_view q) {
+        co_await async_write(q);
+        std::string out;
+        for (;;) {
+            std::size_t have = out.size();
+            out.resize(have + chunk);
+            read_result r = co_await async_read(std::as_writable_bytes(std::span<char>(out).subspan(have)));
+            out.resize(have + r.count);
+            if (r.end) break;
+        }
+        co_return trim(std::move(out));
+    }
+
+    /*
+     * Read an IEEE 488.2 definite-length block (#<n><length><data>) straight
+     * into dst and return the part of dst it filled.  The header and the
+     * response terminator are read separately, the data itself is never
+     * copied.  A block longer than dst throws VI_ERROR_INV_SIZE with the
+     * data still unread (viClear the session before reusing it).
+     */
+    task<std::span<std::byte>> async_read_block(std::span<std::byte> dst) {
+        char head[16];
+        read_result r = co_await async_read(std::as_writable_bytes(std::span<char>(head, 2)));
+        if (r.count != 2 || head[0] != '#' || head[1] < '1' || head[1] > '9') throw error(VI_ERROR_IO);
+        std::size_t digits = static_cast<std::size_t>(head[1] - '0');
+        r = co_await async_read(std::as_writable_bytes(std::span<char>(head, digits)));
+        if (r.count != digits) throw error(VI_ERROR_IO);
+        std::size_t len = 0;
+        for (std::size_t i = 0; i < digits; i++) {
+            if (head[i] < '0' || head[i] > '9') throw error(VI_ERROR_IO);
+            len = len * 10 + static_cast<std::size_t>(head[i] - '0');
+        }
+        if (len > dst.size()) throw error(VI_ERROR_INV_SIZE);
+
+        std::size_t got = 0;
+        r = { 0, false };
+        while (got < len) {
+            r = co_await async_read(dst.subspan(got, len - got));
+            if (r.count == 0) throw error(VI_ERROR_IO);
+            got += r.count;
+        }
+        /* The terminator that follows the data */
+        while (!r.end) {
+            std::byte term[1];
+            r = co_await async_read(term);
+        }
+        co_return dst.first(len);
+    }
+
+private:
+    static constexpr std::size_t chunk = 4096;
+
+    static std::string trim(std::string s) {
+        while (!s.empty() && (s.back() == '\n' || s.back() == '\r')) s.pop_back();
+        return s;
+    }
+
+    ViSession vi_ = VI_NULL;
+    std::unique_ptr<detail::async_state> async_;
+};
+
+/* ========== Locks ========== */
+
+class session_lock {
+public:
+    session_lock(session &s, ViUInt32 timeout = VI_TMO_INFINITE, ViAccessMode type = VI_EXCLUSIVE_LOCK)
+        : vi_(s.get()) {
+        check(viLock(vi_, type, timeout, VI_NULL, VI_NULL));
+    }
+    session_lock(session_lock &&other) noexcept : vi_(std::exchange(other.vi_, VI_NULL)) {}
+    session_lock &operator=(session_lock &&other) noexcept {
+        if (this != &other) {
+            unlock();
+            vi_ = std::exchange(other.vi_, VI_NULL);
+        }
+        return *this;
+    }
+    ~session_lock() { unlock(); }
+
+    void unlock() noexcept {
+        if (vi_) viUnlock(vi_);
+        vi_ = VI_NULL;
+    }
+
+private:
+    ViSession vi_;
+};
+
+inline session_lock session::lock(ViUInt32 timeout) {
+    return session_lock(*this, timeout);
+}
+
+} // namespace ov
+
+#endif /* OPENVISA_HPP */
@@ -82,7 +82,11 @@ typedef ViUInt16    ViJobId;
 #define VI_TMO_IMMEDIATE       (0)
 #define VI_TMO_INFINITE        (0xFFFFFFFF)
 
-/* Status codes */
+/* Status codes
+ * Error codes are negative ViStatus values; build them from _VI_ERROR so
+ * they compare equal to a returned ViStatus on LP64 platforms as well. */
+#define _VI_ERROR                    (-2147483647L-1)
+
 #define VI_SUCCESS                   (0x00000000L)
 #define VI_SUCCESS_EVENT_EN          (0x3FFF0002L)
 #define VI_SUCCESS_EVENT_DIS         (0x3FFF0003L)
@@ -105,65 +109,68 @@ typedef ViUInt16    ViJobId;
 #define VI_WARN_NSUP_BUF             (0x3FFF0088L)
 #define VI_WARN_EXT_FUNC_NIMPL       (0x3FFF00A9L)
 
-#define VI_ERROR_SYSTEM_ERROR        (0xBFFF0000L)
-#define VI_ERROR_INV_OBJECT          (0xBFFF000EL)
-#define VI_ERROR_RSRC_LOCKED         (0xBFFF000FL)
-#define VI_ERROR_INV_EXPR            (0xBFFF0010L)
-#define VI_ERROR_RSRC_NFOUND         (0xBFFF0011L)
-#define VI_ERROR_INV_RSRC_NAME       (0xBFFF0012L)
-#define VI_ERROR_INV_ACC_MODE        (0xBFFF0013L)
-#define VI_ERROR_TMO                 (0xBFFF0015L)
-#define VI_ERROR_CLOSING_FAILED      (0xBFFF0016L)
-#define VI_ERROR_INV_DEGREE          (0xBFFF001BL)
-#define VI_ERROR_INV_JOB_ID          (0xBFFF001CL)
-#define VI_ERROR_NSUP_ATTR           (0xBFFF001DL)
-#define VI_ERROR_NSUP_ATTR_STATE     (0xBFFF001EL)
-#define VI_ERROR_ATTR_READONLY       (0xBFFF001FL)
-#define VI_ERROR_INV_LOCK_TYPE       (0xBFFF0020L)
-#define VI_ERROR_INV_ACCESS_KEY      (0xBFFF0021L)
-#define VI_ERROR_INV_EVENT           (0xBFFF0026L)
-#define VI_ERROR_INV_MECH            (0xBFFF0027L)
-#define VI_ERROR_HNDLR_NINSTALLED    (0xBFFF0028L)
-#define VI_ERROR_INV_HNDLR_REF       (0xBFFF0029L)
-#define VI_ERROR_INV_CONTEXT         (0xBFFF002AL)
-#define VI_ERROR_QUEUE_OVERFLOW      (0xBFFF002DL)
-#define VI_ERROR_NENABLED            (0xBFFF002FL)
-#define VI_ERROR_ABORT               (0xBFFF0030L)
-#define VI_ERROR_RAW_WR_PROT_VIOL    (0xBFFF0034L)
-#define VI_ERROR_RAW_RD_PROT_VIOL    (0xBFFF0035L)
-#define VI_ERROR_OUTP_PROT_VIOL      (0xBFFF0036L)
-#define VI_ERROR_INP_PROT_VIOL       (0xBFFF0037L)
-#define VI_ERROR_BERR                (0xBFFF0038L)
-#define VI_ERROR_IN_PROGRESS         (0xBFFF0039L)
-#define VI_ERROR_INV_SETUP           (0xBFFF003AL)
-#define VI_ERROR_QUEUE_ERROR         (0xBFFF003BL)
-#define VI_ERROR_ALLOC               (0xBFFF003CL)
-#define VI_ERROR_INV_MASK            (0xBFFF003DL)
-#define VI_ERROR_IO                  (0xBFFF003EL)
-#define VI_ERROR_INV_FMT             (0xBFFF003FL)
-#define VI_ERROR_NSUP_FMT            (0xBFFF0041L)
-#define VI_ERROR_LINE_IN_USE         (0xBFFF0042L)
-#define VI_ERROR_LINE_NRESERVED      (0xBFFF0043L)
-#define VI_ERROR_NSUP_MODE           (0xBFFF0046L)
-#define VI_ERROR_SRQ_NOCCURRED       (0xBFFF004AL)
-#define VI_ERROR_INV_SPACE           (0xBFFF004EL)
-#define VI_ERROR_INV_OFFSET          (0xBFFF0051L)
-#define VI_ERROR_INV_WIDTH           (0xBFFF0052L)
-#define VI_ERROR_NSUP_OFFSET         (0xBFFF0054L)
-#define VI_ERROR_NSUP_VAR_WIDTH      (0xBFFF0055L)
-#define VI_ERROR_WINDOW_NMAPPED      (0xBFFF0057L)
-#define VI_ERROR_RESP_PENDING        (0xBFFF0059L)
-#define VI_ERROR_NLISTENERS          (0xBFFF005FL)
-#define VI_ERROR_NCIC                (0xBFFF0060L)
-#define VI_ERROR_NSYS_CNTLR          (0xBFFF0061L)
-#define VI_ERROR_NSUP_OPER           (0xBFFF0067L)
-#define VI_ERROR_INTR_PENDING        (0xBFFF0068L)
-#define VI_ERROR_ASRL_PARITY         (0xBFFF006AL)
-#define VI_ERROR_ASRL_FRAMING        (0xBFFF006BL)
-#define VI_ERROR_ASRL_OVERRUN        (0xBFFF006CL)
-#define VI_ERROR_CONN_LOST           (0xBFFF006DL)
-#define VI_ERROR_INV_PROT            (0xBFFF006EL)
-#define VI_ERROR_INV_SIZE            (0xBFFF006FL)
+#define VI_ERROR_SYSTEM_ERROR        (_VI_ERROR+0x3FFF0000L)
+#define VI_ERROR_INV_OBJECT          (_VI_ERROR+0x3FFF000EL)
+#define VI_ERROR_RSRC_LOCKED         (_VI_ERROR+0x3FFF000FL)
+#define VI_ERROR_INV_EXPR            (_VI_ERROR+0x3FFF0010L)
+#define VI_ERROR_RSRC_NFOUND         (_VI_ERROR+0x3FFF0011L)
+#define VI_ERROR_INV_RSRC_NAME       (_VI_ERROR+0x3FFF0012L)
+#define VI_ERROR_INV_ACC_MODE        (_VI_ERROR+0x3FFF0013L)
+#define VI_ERROR_TMO                 (_VI_ERROR+0x3FFF0015L)
+#define VI_ERROR_CLOSING_FAILED      (_VI_ERROR+0x3FFF0016L)
+#define VI_ERROR_INV_DEGREE          (_VI_ERROR+0x3FFF001BL)
+#define VI_ERROR_INV_JOB_ID          (_VI_ERROR+0x3FFF001CL)
+#define VI_ERROR_NSUP_ATTR           (_VI_ERROR+0x3FFF001DL)
+#define VI_ERROR_NSUP_ATTR_STATE     (_VI_ERROR+0x3FFF001EL)
+#define VI_ERROR_ATTR_READONLY       (_VI_ERROR+0x3FFF001FL)
+#define VI_ERROR_INV_LOCK_TYPE       (_VI_ERROR+0x3FFF0020L)
+#define VI_ERROR_INV_ACCESS_KEY      (_VI_ERROR+0x3FFF0021L)
+#define VI_ERROR_INV_EVENT           (_VI_ERROR+0x3FFF0026L)
+#define VI_ERROR_INV_MECH            (_VI_ERROR+0x3FFF0027L)
+#define VI_ERROR_HNDLR_NINSTALLED    (_VI_ERROR+0x3FFF0028L)
+#define VI_ERROR_INV_HNDLR_REF       (_VI_ERROR+0x3FFF0029L)
+#define VI_ERROR_INV_CONTEXT         (_VI_ERROR+0x3FFF002AL)
+#define VI_ERROR_QUEUE_OVERFLOW      (_VI_ERROR+0x3FFF002DL)
+#define VI_ERROR_NENABLED            (_VI_ERROR+0x3FFF002FL)
+#define VI_ERROR_ABORT               (_VI_ERROR+0x3FFF0030L)
+#define VI_ERROR_RAW_WR_PROT_VIOL    (_VI_ERROR+0x3FFF0034L)
+#define VI_ERROR_RAW_RD_PROT_VIOL    (_VI_ERROR+0x3FFF0035L)
+#define VI_ERROR_OUTP_PROT_VIOL      (_VI_ERROR+0x3FFF0036L)
+#define VI_ERROR_INP_PROT_VIOL       (_VI_ERROR+0x3FFF0037L)
+#define VI_ERROR_BERR                (_VI_ERROR+0x3FFF0038L)
+#define VI_ERROR_IN_PROGRESS         (_VI_ERROR+0x3FFF0039L)
+#define VI_ERROR_INV_SETUP           (_VI_ERROR+0x3FFF003AL)
+#define VI_ERROR_QUEUE_ERROR         (_VI_ERROR+0x3FFF003BL)
+#define VI_ERROR_ALLOC               (_VI_ERROR+0x3FFF003CL)
+#define VI_ERROR_INV_MASK            (_VI_ERROR+0x3FFF003DL)
+#define VI_ERROR_IO                  (_VI_ERROR+0x3FFF003EL)
+#define VI_ERROR_INV_FMT             (_VI_ERROR+0x3FFF003FL)
+#define VI_ERROR_NSUP_FMT            (_VI_ERROR+0x3FFF0041L)
+#define VI_ERROR_LINE_IN_USE         (_VI_ERROR+0x3FFF0042L)
+#define VI_ERROR_LINE_NRESERVED      (_VI_ERROR+0x3FFF0043L)
+#define VI_ERROR_NSUP_MODE           (_VI_ERROR+0x3FFF0046L)
+#define VI_ERROR_SRQ_NOCCURRED       (_VI_ERROR+0x3FFF004AL)
+#define VI_ERROR_INV_SPACE           (_VI_ERROR+0x3FFF004EL)
+#define VI_ERROR_INV_OFFSET          (_VI_ERROR+0x3FFF0051L)
+#define VI_ERROR_INV_WIDTH           (_VI_ERROR+0x3FFF0052L)
+#define VI_ERROR_NSUP_OFFSET         (_VI_ERROR+0x3FFF0054L)
+#define VI_ERROR_NSUP_VAR_WIDTH      (_VI_ERROR+0x3FFF0055L)
+#define VI_ERROR_WINDOW_NMAPPED      (_VI_ERROR+0x3FFF0057L)
+#define VI_ERROR_RESP_PENDING        (_VI_ERROR+0x3FFF0059L)
+#define VI_ERROR_NLISTENERS          (_VI_ERROR+0x3FFF005FL)
+#define VI_ERROR_NCIC                (_VI_ERROR+0x3FFF0060L)
+#define VI_ERROR_NSYS_CNTLR          (_VI_ERROR+0x3FFF0061L)
+#define VI_ERROR_NSUP_OPER           (_VI_ERROR+0x3FFF0067L)
+#define VI_ERROR_INTR_PENDING        (_VI_ERROR+0x3FFF0068L)
+#define VI_ERROR_ASRL_PARITY         (_VI_ERROR+0x3FFF006AL)
+#define VI_ERROR_ASRL_FRAMING        (_VI_ERROR+0x3FFF006BL)
+#define VI_ERROR_ASRL_OVERRUN        (_VI_ERROR+0x3FFF006CL)
+#define VI_ERROR_CONN_LOST           (_VI_ERROR+0x3FFF006DL)
+#define VI_ERROR_INV_PROT            (_VI_ERROR+0x3FFF006EL)
+#define VI_ERROR_INV_SIZE            (_VI_ERROR+0x3FFF006FL)
+#define VI_ERROR_SESN_NLOCKED        (_VI_ERROR+0x3FFF009CL)
+#define VI_ERROR_FILE_ACCESS         (_VI_ERROR+0x3FFF00A1L)
+#define VI_ERROR_FILE_IO             (_VI_ERROR+0x3FFF00A2L)
 
 /* Attribute IDs */
 #define VI_ATTR_RSRC_CLASS           (0xBFFF0001L)
@@ -190,8 +197,31 @@ typedef ViUInt16    ViJobId;
 #define VI_ATTR_USB_SERIAL_NUM       (0xBFFF01A0L)
 #define VI_ATTR_USB_INTFC_NUM        (0x3FFF01A1L)
 #define VI_ATTR_TERMCHAR_EN          (0x3FFF0038L)
+#define VI_ATTR_FILE_APPEND_EN       (0x3FFF0192L)
 #define VI_ATTR_RSRC_MANF_NAME       (0xBFFF0172L)
 #define VI_ATTR_RSRC_MANF_ID         (0x3FFF0175L)
+#define VI_ATTR_ASRL_BAUD            (0x3FFF0021L)
+#define VI_ATTR_ASRL_DATA_BITS       (0x3FFF0022L)
+#define VI_ATTR_ASRL_PARITY          (0x3FFF0023L)
+#define VI_ATTR_ASRL_STOP_BITS       (0x3FFF0024L)
+#define VI_ATTR_ASRL_FLOW_CNTRL      (0x3FFF0025L)
+#define VI_ATTR_ASRL_AVAIL_NUM       (0x3FFF00ACL)
+#define VI_ATTR_ASRL_CTS_STATE       (0x3FFF00AEL)
+#define VI_ATTR_ASRL_DCD_STATE       (0x3FFF00AFL)
+#define VI_ATTR_ASRL_DSR_STATE       (0x3FFF00B1L)
+#define VI_ATTR_ASRL_DTR_STATE       (0x3FFF00B2L)
+#define VI_ATTR_ASRL_END_IN          (0x3FFF00B3L)
+#define VI_ATTR_ASRL_RI_STATE        (0x3FFF00BFL)
+#define VI_ATTR_ASRL_RTS_STATE       (0x3FFF00C0L)
+#define VI_ATTR_ASRL_BREAK_STATE     (0x3FFF01BCL)
+
+/* Event context attributes */
+#define VI_ATTR_EVENT_TYPE           (0xBFFF4010L)
+#define VI_ATTR_STATUS               (0x3FFF4025L)
+#define VI_ATTR_RET_COUNT            (0x3FFF4026L)
+#define VI_ATTR_BUFFER               (0x3FFF4027L)
+#define VI_ATTR_JOB_ID               (0x3FFF4006L)
+#define VI_ATTR_OPER_NAME            (0xBFFF4042L)
 
 /* Interface types */
 #define VI_INTF_GPIB                 (1)
@@ -205,15 +235,45 @@ typedef ViUInt16    ViJobId;
 /* Event types */
 #define VI_EVENT_SERVICE_REQ         (0x3FFF200BL)
 #define VI_EVENT_IO_COMPLETION       (0x3FFF2009L)
+#define VI_ALL_ENABLED_EVENTS        (0x3FFF7FFFL)
 
 /* Event mechanisms */
 #define VI_QUEUE                     (1)
 #define VI_HNDLR                     (2)
 #define VI_SUSPEND_HNDLR             (4)
 #define VI_ALL_MECH                  (0xFFFF)
+#define VI_ANY_HNDLR                 (0)
+
+/* Trigger protocols (viAssertTrigger) */
+#define VI_TRIG_PROT_DEFAULT         (0)
+#define VI_TRIG_PROT_ON              (1)
+#define VI_TRIG_PROT_OFF             (2)
+#define VI_TRIG_PROT_SYNC            (5)
 
 /* Read/Write termination */
+#define VI_ASRL_END_NONE             (0)
+#define VI_ASRL_END_LAST_BIT         (1)
 #define VI_ASRL_END_TERMCHAR         (2)
+#define VI_ASRL_END_BREAK            (3)
+
+/* Serial line settings (VI_ATTR_ASRL_*) */
+#define VI_ASRL_PAR_NONE             (0)
+#define VI_ASRL_PAR_ODD              (1)
+#define VI_ASRL_PAR_EVEN             (2)
+#define VI_ASRL_PAR_MARK             (3)
+#define VI_ASRL_PAR_SPACE            (4)
+#define VI_ASRL_STOP_ONE             (10)
+#define VI_ASRL_STOP_ONE5            (15)
+#define VI_ASRL_STOP_TWO             (20)
+#define VI_ASRL_FLOW_NONE            (0)
+#define VI_ASRL_FLOW_XON_XOFF        (1)
+#define VI_ASRL_FLOW_RTS_CTS         (2)
+#define VI_ASRL_FLOW_DTR_DSR         (4)
+
+/* Line states */
+#define VI_STATE_ASSERTED            (1)
+#define VI_STATE_UNASSERTED          (0)
+#define VI_STATE_UNKNOWN             (-1)
 
 /* Util macro */
 #define VI_SPEC_VERSION              (0x00700200L)  /* VISA 7.2 */
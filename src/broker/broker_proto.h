@@ -0,0 +1,51 @@
+/*
+ * OpenVISA - openvisa-broker wire protocol
+ *
+ * Shared by the broker daemon (src/broker/openvisa_broker.c) and the client
+ * side in viOpen/viClose (src/core/broker.c).  Each brokered session holds
+ * one Unix stream connection to the broker for as long as it is open: the
+ * lease.
+ *
+ *   client -> broker   CHECKOUT  payload = resource string, timeout = open timeout
+ *   broker -> client   CHECKOUT  status; payload = OvConnState, whose fds
+ *                                arrive as SCM_RIGHTS on the same message
+ *   client -> broker   CHECKIN   payload = OvConnState (fds not sent: the
+ *                                broker kept its own copies)
+ *   broker -> client   CHECKIN   status; the connection is back in the pool,
+ *                                so an open that follows finds it
+ *
+ * The client closes the lease after the CHECKIN reply; a lease that ends
+ * without one (crash, broken connection) makes the broker discard the
+ * connection, whose protocol state is then unknown.  Host byte order.
+ */
+
+#ifndef OPENVISA_BROKER_PROTO_H
+#define OPENVISA_BROKER_PROTO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#define OVB_CHECKOUT    1
+#define OVB_CHECKIN     2
+
+#define OVB_MAX_RSRC    511
+
+typedef struct {
+    uint32_t op;
+    int32_t  status;        /* reply only */
+    uint32_t timeout;       /* ms */
+    uint32_t len;           /* payload bytes that follow */
+} OvbHeader;
+
+/* Socket path: $OPENVISA_BROKER unless empty or "1", else
+ * $XDG_RUNTIME_DIR/openvisa-broker.sock, else /tmp/openvisa-broker.sock */
+static inline void ovb_socket_path(char *out, size_t size) {
+    const char *p = getenv("OPENVISA_BROKER");
+    const char *dir = getenv("XDG_RUNTIME_DIR");
+    if (p && *p && !(p[0] == '1' && p[1] == '\0')) snprintf(out, size, "%s", p);
+    else if (dir && *dir) snprintf(out, size, "%s/openvisa-broker.sock", dir);
+    else                  snprintf(out, size, "/tmp/openvisa-broker.sock");
+}
+
+#endif /* OPENVISA_BROKER_PROTO_H */
@@ -0,0 +1,325 @@
+/*
+ * OpenVISA - openvisa-broker: keeps instrument connections warm for
+ * short-lived client processes
+ *
+ *   openvisa-broker [-s socket] [-n max-idle] [resource ...]
+ *
+ * Clients that run with $OPENVISA_BROKER set ask the broker for a connected
+ * transport in viOpen and give it back in viClose (protocol: broker_proto.h).
+ * The broker opens connections with the library's own transports, detaches
+ * their sockets and protocol state, and passes duplicates of the sockets to
+ * the client with SCM_RIGHTS; a connection is lent to one session at a time.
+ * Resources on the command line are connected at start-up.
+ *
+ * Each lease is served by its own thread, which blocks on the lease socket
+ * until the client checks the connection back in or goes away.  Idle
+ * connections are checked before reuse: one that became readable (peer
+ * closed, or a response nobody read) is dropped and a fresh one opened.
+ */
+
+#include "visa.h"
+#include "broker_proto.h"
+#include "../core/session.h"
+#include "../core/thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#ifndef SOCK_CLOEXEC
+    #define SOCK_CLOEXEC 0
+#endif
+#ifndef MSG_NOSIGNAL
+    #define MSG_NOSIGNAL 0      /* SIGPIPE is ignored anyway */
+#endif
+
+#define BRK_MAX_IDLE    4       /* idle connections kept per resource */
+
+typedef struct Conn {
+    char         rsrc[OVB_MAX_RSRC + 1];
+    OvConnState  cs;            /* sockets owned by the broker */
+    struct Conn *next;
+} Conn;
+
+static OvMutex  g_lock = OV_MUTEX_INIT;
+static Conn    *g_idle;         /* guarded by g_lock */
+static int      g_max_idle = BRK_MAX_IDLE;
+static volatile sig_atomic_t g_stop;
+
+static void on_signal(int sig) { (void)sig; g_stop = 1; }
+
+/* ========== Connections ========== */
+
+static OvTransport *conn_transport(const char *rsrc, OvResource *parsed) {
+    if (ov_parse_rsrc(rsrc, parsed) != VI_SUCCESS) return NULL;
+    OvTransport *t = ov_transport_create_for_rsrc(parsed);
+    if (t && (!t->detach || !t->attach)) {
+        free(t->impl);
+        free(t);
+        t = NULL;
+    }
+    if (!t) ov_rsrc_release(parsed);
+    return t;
+}
+
+static void transport_free(OvTransport *t) {
+    t->close(t);
+    free(t->impl);
+    free(t);
+}
+
+static ViStatus conn_open(const char *rsrc, ViUInt32 timeout, Conn **out) {
+    OvResource parsed;
+    OvTransport *t = conn_transport(rsrc, &parsed);
+    if (!t) return VI_ERROR_NSUP_OPER;
+
+    Conn *c = (Conn*)calloc(1, sizeof(Conn));
+    if (!c) { transport_free(t); ov_rsrc_release(&parsed); return VI_ERROR_ALLOC; }
+    snprintf(c->rsrc, sizeof(c->rsrc), "%s", rsrc);
+
+    ViStatus st = t->open(t, &parsed, timeout);
+    if (st == VI_SUCCESS) st = t->detach(t, &c->cs);
+    transport_free(t);
+    ov_rsrc_release(&parsed);
+    if (st != VI_SUCCESS) { free(c); return st; }
+    *out = c;
+    return VI_SUCCESS;
+}
+
+/* graceful: state is known, let the transport end the session properly */
+static void conn_close(Conn *c, bool graceful) {
+    OvResource parsed;
+    OvTransport *t = graceful ? conn_transport(c->rsrc, &parsed) : NULL;
+    if (t && t->attach(t, &parsed, &c->cs) == VI_SUCCESS) {
+        transport_free(t);
+    } else {
+        if (t) { free(t->impl); free(t); }
+        for (ViUInt32 i = 0; i < c->cs.nfds; i++) close(c->cs.fds[i]);
+    }
+    if (t) ov_rsrc_release(&parsed);
+    free(c);
+}
+
+/* An idle connection must be silent: readable means closed or stale data */
+static bool conn_healthy(const Conn *c) {
+    for (ViUInt32 i = 0; i < c->cs.nfds; i++) {
+        struct pollfd p = { .fd = c->cs.fds[i], .events = POLLIN };
+        if (poll(&p, 1, 0) != 0) return false;
+    }
+    return true;
+}
+
+static Conn *pool_take(const char *rsrc) {
+    for (;;) {
+        ov_mutex_lock(&g_lock);
+        Conn **pp = &g_idle;
+        while (*pp && strcasecmp((*pp)->rsrc, rsrc) != 0) pp = &(*pp)->next;
+        Conn *c = *pp;
+        if (c) *pp = c->next;
+        ov_mutex_unlock(&g_lock);
+
+        if (!c) return NULL;
+        if (conn_healthy(c)) return c;
+        conn_close(c, false);
+    }
+}
+
+static void pool_put(Conn *c) {
+    int same = 0;
+    ov_mutex_lock(&g_lock);
+    for (Conn *i = g_idle; i; i = i->next)
+        if (strcasecmp(i->rsrc, c->rsrc) == 0) same++;
+    if (same < g_max_idle) {
+        c->next = g_idle;
+        g_idle = c;
+        c = NULL;
+    }
+    ov_mutex_unlock(&g_lock);
+    if (c) conn_close(c, true);
+}
+
+/* ========== Leases ========== */
+
+static bool recv_all(int fd, void *data, size_t len) {
+    uint8_t *p = (uint8_t*)data;
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p   += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static bool send_reply(int fd, ViStatus status, const Conn *c) {
+    struct {
+        OvbHeader   hdr;
+        OvConnState cs;
+    } reply;
+    memset(&reply, 0, sizeof(reply));
+    reply.hdr.op = OVB_CHECKOUT;
+    reply.hdr.status = status;
+
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int) * OV_CONN_MAX_FDS)];
+    } ctl;
+    struct iovec iov = { .iov_base = &reply, .iov_len = sizeof(OvbHeader) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    if (c) {
+        reply.hdr.len = sizeof(OvConnState);
+        reply.cs = c->cs;
+        iov.iov_len = sizeof(reply);
+        memset(&ctl, 0, sizeof(ctl));
+        msg.msg_control = ctl.buf;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * c->cs.nfds);
+        struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type  = SCM_RIGHTS;
+        cm->cmsg_len   = CMSG_LEN(sizeof(int) * c->cs.nfds);
+        memcpy(CMSG_DATA(cm), c->cs.fds, sizeof(int) * c->cs.nfds);
+    }
+
+    ssize_t n;
+    do {
+        n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    return n == (ssize_t)iov.iov_len;
+}
+
+static void *lease_thread(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    OvbHeader hdr;
+    char rsrc[OVB_MAX_RSRC + 1];
+
+    if (!recv_all(fd, &hdr, sizeof(hdr)) || hdr.op != OVB_CHECKOUT ||
+        hdr.len == 0 || hdr.len > OVB_MAX_RSRC || !recv_all(fd, rsrc, hdr.len)) {
+        close(fd);
+        return NULL;
+    }
+    rsrc[hdr.len] = '\0';
+
+    Conn *c = pool_take(rsrc);
+    ViStatus st = c ? VI_SUCCESS : conn_open(rsrc, hdr.timeout, &c);
+    if (!send_reply(fd, st, st == VI_SUCCESS ? c : NULL)) {
+        if (c) conn_close(c, true);         /* never reached the client */
+        close(fd);
+        return NULL;
+    }
+    if (st != VI_SUCCESS) { close(fd); return NULL; }
+
+    /* Lent out: wait for the check-in that carries the advanced state */
+    OvConnState back;
+    if (recv_all(fd, &hdr, sizeof(hdr)) && hdr.op == OVB_CHECKIN &&
+        hdr.len == sizeof(back) && recv_all(fd, &back, sizeof(back)) &&
+        back.nfds == c->cs.nfds && back.len <= OV_CONN_STATE_SIZE) {
+        c->cs.len = back.len;
+        memcpy(c->cs.state, back.state, back.len);
+        pool_put(c);
+        OvbHeader ack = { .op = OVB_CHECKIN };
+        send(fd, &ack, sizeof(ack), MSG_NOSIGNAL);
+    } else {
+        conn_close(c, false);               /* client died mid-session */
+    }
+    close(fd);
+    return NULL;
+}
+
+/* ========== Setup ========== */
+
+static int listen_on(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    unlink(path);                               /* stale socket of a dead broker */
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: openvisa-broker [-s socket] [-n max-idle] [resource ...]\n");
+}
+
+int main(int argc, char **argv) {
+    char path[108];
+    ovb_socket_path(path, sizeof(path));
+
+    int first = argc;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            snprintf(path, sizeof(path), "%s", argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            g_max_idle = atoi(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 1;
+        } else {
+            first = i;
+            break;
+        }
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;                  /* no SA_RESTART: accept() returns */
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    /* Pre-warm */
+    for (int i = first; i < argc; i++) {
+        Conn *c;
+        ViStatus st = conn_open(argv[i], 5000, &c);
+        if (st == VI_SUCCESS) pool_put(c);
+        else fprintf(stderr, "openvisa-broker: %s: open failed (0x%08X)\n", argv[i], (unsigned)st);
+    }
+
+    int ls = listen_on(path);
+    if (ls < 0) { fprintf(stderr, "openvisa-broker: cannot listen on %s\n", path); return 1; }
+    fprintf(stderr, "openvisa-broker: listening on %s\n", path);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    while (!g_stop) {
+        int fd = accept(ls, NULL, NULL);
+        if (fd < 0) continue;
+        pthread_t th;
+        if (pthread_create(&th, &attr, lease_thread, (void*)(intptr_t)fd) != 0) close(fd);
+    }
+
+    /* Idle connections end properly; lent ones die with their clients */
+    close(ls);
+    unlink(path);
+    ov_mutex_lock(&g_lock);
+    Conn *c = g_idle;
+    g_idle = NULL;
+    ov_mutex_unlock(&g_lock);
+    while (c) {
+        Conn *next = c->next;
+        conn_close(c, true);
+        c = next;
+    }
+    return 0;
+}
@@ -0,0 +1,314 @@
+/*
+ * OpenVISA - Adaptive per-command read timeouts  (ovAdaptiveTimeout*)
+ *
+ * Opt-in per session.  The time from writing a query to the end of its
+ * response is recorded in a latency histogram keyed by the query's header
+ * ("MEAS:VOLT" for "meas:volt? 10"; leading ':' and case ignored).  Once a
+ * header has AT_MIN_SAMPLES samples, the first read after it waits at most
+ * multiplier x the chosen percentile (no less than floorMs), and never
+ * longer than VI_ATTR_TMO_VALUE; an instrument that hangs on a fast command
+ * fails in milliseconds instead of at the worst-case timeout.  Unknown
+ * headers, and the later chunks of a response read in pieces, keep the
+ * session timeout.
+ *
+ * Only responses to a query written while no other response was pending
+ * are timed, and timeouts are not recorded; a read error or viClear forgets
+ * the responses still pending.  Histograms use quarter-octave
+ * buckets and are halved once they hold AT_DECAY samples, so the table
+ * follows an instrument that gets slower.  The table is saved and loaded as
+ * text so a station starts with the timings learned on an earlier run.
+ */
+
+#include "session.h"
+#include "scpi.h"
+#include "thread.h"
+#include "openvisa.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <math.h>
+
+#define AT_BUCKETS          104     /* 1 us .. 2^26 us (67 s) */
+#define AT_MAX_HEADERS      256     /* power of two */
+#define AT_MAX_HEADER       48
+#define AT_MIN_SAMPLES      8
+#define AT_DECAY            1024
+#define AT_FILE_MAGIC       "# openvisa adaptive timeouts 1"
+
+#define AT_DEFAULT_PERCENTILE   99.0
+#define AT_DEFAULT_MULTIPLIER   4.0
+#define AT_DEFAULT_FLOOR_MS     50
+
+typedef struct {
+    char        header[AT_MAX_HEADER];      /* "" = free slot */
+    ViUInt32    samples;
+    ViUInt32    counts[AT_BUCKETS];
+} AtEntry;
+
+struct OvAdaptiveTmo {
+    ViReal64    percentile;
+    ViReal64    multiplier;
+    ViUInt32    floor_ms;
+    AtEntry    *table;                      /* AT_MAX_HEADERS, open addressing */
+    ViUInt32    used;
+
+    AtEntry    *timing;                     /* header of the response being timed */
+    uint64_t    t_sent;
+    bool        first;                      /* next read is the first after the write */
+    ViUInt32    pending;                    /* queries written, responses not read */
+};
+
+/* ========== Headers and histograms ========== */
+
+/* Header of the first query in a message: the command holding the '?' */
+static bool at_header(const ViByte *buf, ViUInt32 count, char out[AT_MAX_HEADER]) {
+    const ViByte *q = ov_scpi_query_mark(buf, count);
+    if (!q) return false;
+    const ViByte *start = q;
+    while (start > buf && start[-1] != ';' && !isspace(start[-1])) start--;
+    while (start < q && *start == ':') start++;
+    size_t len = (size_t)(q - start);
+    if (len == 0 || len >= AT_MAX_HEADER) return false;
+    for (size_t i = 0; i < len; i++) out[i] = (char)toupper(start[i]);
+    out[len] = '\0';
+    return true;
+}
+
+static uint32_t at_hash(const char *s) {
+    uint32_t h = 2166136261u;
+    while (*s) h = (h ^ (uint8_t)*s++) * 16777619u;
+    return h;
+}
+
+/* Find (or create) the entry for header; NULL when the table is full */
+static AtEntry *at_entry(OvAdaptiveTmo *at, const char *header, bool create) {
+    uint32_t i = at_hash(header) & (AT_MAX_HEADERS - 1);
+    for (uint32_t probe = 0; probe < AT_MAX_HEADERS; probe++) {
+        AtEntry *e = &at->table[(i + probe) & (AT_MAX_HEADERS - 1)];
+        if (!e->header[0]) {
+            if (!create || at->used >= AT_MAX_HEADERS * 3 / 4) return NULL;
+            strcpy(e->header, header);
+            at->used++;
+            return e;
+        }
+        if (strcmp(e->header, header) == 0) return e;
+    }
+    return NULL;
+}
+
+static void at_record(AtEntry *e, uint64_t ns) {
+    double us = ns / 1e3;
+    int b = us < 1.0 ? 0 : (int)(4.0 * log2(us));
+    if (b >= AT_BUCKETS) b = AT_BUCKETS - 1;
+    e->counts[b]++;
+    if (++e->samples < AT_DECAY) return;
+    e->samples = 0;
+    for (int i = 0; i < AT_BUCKETS; i++) {
+        e->counts[i] /= 2;
+        e->samples += e->counts[i];
+    }
+}
+
+/* Learned timeout for e in ms, 0 = not enough samples */
+static ViUInt32 at_timeout_ms(const OvAdaptiveTmo *at, const AtEntry *e) {
+    if (!e || e->samples < AT_MIN_SAMPLES) return 0;
+    ViUInt32 target = (ViUInt32)ceil(at->percentile / 100.0 * e->samples);
+    if (target == 0) target = 1;
+    ViUInt32 seen = 0;
+    int b = 0;
+    for (; b < AT_BUCKETS - 1; b++) {
+        seen += e->counts[b];
+        if (seen >= target) break;
+    }
+    double ms = exp2((b + 1) / 4.0) / 1e3 * at->multiplier;   /* bucket's upper edge */
+    if (ms < at->floor_ms) ms = at->floor_ms;
+    return ms >= 4294967295.0 ? 0xFFFFFFFFu : (ViUInt32)ceil(ms);
+}
+
+/* ========== Session hooks ========== */
+
+void ov_adaptive_sent(OvSession *sess, ViBuf buf, ViUInt32 count) {
+    OvAdaptiveTmo *at = sess->adaptive;
+    char header[AT_MAX_HEADER];
+    if (!at_header(buf, count, header)) return;
+    /* A response queued behind another cannot be timed from its write */
+    at->timing = at->pending++ == 0 ? at_entry(at, header, true) : NULL;
+    at->t_sent = ov_time_ns();
+    at->first = true;
+}
+
+ViUInt32 ov_adaptive_timeout(OvSession *sess) {
+    OvAdaptiveTmo *at = sess->adaptive;
+    ViUInt32 tmo = sess->timeout;
+    /* Only the wait for the response to start is bounded; later chunks of a
+     * long response get the session timeout */
+    ViUInt32 learned = at->timing && at->first ? at_timeout_ms(at, at->timing) : 0;
+    if (learned && tmo != VI_TMO_IMMEDIATE && (tmo == VI_TMO_INFINITE || learned < tmo)) {
+        uint64_t elapsed_ms = (ov_time_ns() - at->t_sent) / 1000000u;
+        tmo = elapsed_ms < learned ? learned - (ViUInt32)elapsed_ms : 1;
+    }
+    return tmo;
+}
+
+ViStatus ov_adaptive_read(OvSession *sess, ViBuf buf, ViUInt32 count, ViUInt32 *retCount,
+                          ViUInt32 timeout) {
+    OvAdaptiveTmo *at = sess->adaptive;
+    ViUInt32 limit = ov_adaptive_timeout(sess);
+    ViUInt32 tmo = timeout < limit ? timeout : limit;
+
+    ViStatus st = sess->transport->read(sess->transport, buf, count, retCount, tmo);
+    if (st < VI_SUCCESS) {
+        /* Only the caller's shorter wait ran out: the response may still come */
+        if (st == VI_ERROR_TMO && tmo < limit) return st;
+        at->timing = NULL;
+        at->pending = 0;                    /* what is still owed is unknown */
+        return st;
+    }
+    at->first = false;
+    /* VI_SUCCESS from a stream transport is only what had arrived so far */
+    if (st == VI_SUCCESS_MAX_CNT || (st == VI_SUCCESS && ov_session_is_stream(sess))) return st;
+    if (at->timing) at_record(at->timing, ov_time_ns() - at->t_sent);
+    at->timing = NULL;
+    if (at->pending) at->pending--;
+    return st;
+}
+
+void ov_adaptive_clear(OvSession *sess) {
+    OvAdaptiveTmo *at = sess->adaptive;
+    if (!at) return;
+    at->timing = NULL;
+    at->pending = 0;                        /* the device dropped what it owed */
+}
+
+void ov_adaptive_free(OvSession *sess) {
+    OvAdaptiveTmo *at = sess->adaptive;
+    if (!at) return;
+    free(at->table);
+    free(at);
+    sess->adaptive = NULL;
+}
+
+/* ========== Public API ========== */
+
+ViStatus _VI_FUNC ovAdaptiveTimeoutEnable(ViSession vi, ViReal64 percentile,
+                                          ViReal64 multiplier, ViUInt32 floorMs)
+{
+    OvSession *sess = ov_session_find(vi);
+    if (!sess || sess->isRM || !sess->transport) return VI_ERROR_INV_OBJECT;
+    if (percentile == 0) percentile = AT_DEFAULT_PERCENTILE;
+    if (multiplier == 0) multiplier = AT_DEFAULT_MULTIPLIER;
+    if (floorMs == 0) floorMs = AT_DEFAULT_FLOOR_MS;
+    if (!(percentile > 0 && percentile <= 100) || !(multiplier >= 1)) return VI_ERROR_INV_SETUP;
+
+    OvAdaptiveTmo *at = sess->adaptive;
+    if (!at) {
+        at = (OvAdaptiveTmo *)calloc(1, sizeof(OvAdaptiveTmo));
+        if (!at) return VI_ERROR_ALLOC;
+        at->table = (AtEntry *)calloc(AT_MAX_HEADERS, sizeof(AtEntry));
+        if (!at->table) { free(at); return VI_ERROR_ALLOC; }
+        sess->adaptive = at;
+    }
+    at->percentile = percentile;
+    at->multiplier = multiplier;
+    at->floor_ms = floorMs;
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovAdaptiveTimeoutDisable(ViSession vi) {
+    OvSession *sess = ov_session_find(vi);
+    if (!sess || sess->isRM) return VI_ERROR_INV_OBJECT;
+    ov_adaptive_free(sess);
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovAdaptiveTimeoutQuery(ViSession vi, ViConstString query,
+                                         ViUInt32 *timeoutMs, ViUInt32 *samples)
+{
+    OvSession *sess = ov_session_find(vi);
+    if (!sess || sess->isRM || !query) return VI_ERROR_INV_OBJECT;
+    OvAdaptiveTmo *at = sess->adaptive;
+    char header[AT_MAX_HEADER];
+    AtEntry *e = NULL;
+    if (at && at_header((const ViByte *)query, (ViUInt32)strlen(query), header))
+        e = at_entry(at, header, false);
+    ViUInt32 learned = at ? at_timeout_ms(at, e) : 0;
+    if (timeoutMs) {
+        bool shorter = learned && sess->timeout != VI_TMO_IMMEDIATE &&
+                       (sess->timeout == VI_TMO_INFINITE || learned < sess->timeout);
+        *timeoutMs = shorter ? learned : sess->timeout;
+    }
+    if (samples) *samples = e ? e->samples : 0;
+    return VI_SUCCESS;
+}
+
+/*
+ * File format: a magic line, then one line per header:
+ *   <HEADER> <samples> <bucket>:<count> ...
+ */
+ViStatus _VI_FUNC ovAdaptiveTimeoutSave(ViSession vi, ViConstString path) {
+    OvSession *sess = ov_session_find(vi);
+    if (!sess || sess->isRM) return VI_ERROR_INV_OBJECT;
+    OvAdaptiveTmo *at = sess->adaptive;
+    if (!at) return VI_ERROR_NSUP_OPER;
+    if (!path) return VI_ERROR_FILE_ACCESS;
+
+    FILE *f = fopen(path, "w");
+    if (!f) return VI_ERROR_FILE_ACCESS;
+    fprintf(f, "%s\n", AT_FILE_MAGIC);
+    for (ViUInt32 i = 0; i < AT_MAX_HEADERS; i++) {
+        const AtEntry *e = &at->table[i];
+        if (!e->header[0] || !e->samples) continue;
+        fprintf(f, "%s %u", e->header, (unsigned)e->samples);
+        for (int b = 0; b < AT_BUCKETS; b++)
+            if (e->counts[b]) fprintf(f, " %d:%u", b, (unsigned)e->counts[b]);
+        fputc('\n', f);
+    }
+    return fclose(f) == 0 ? VI_SUCCESS : VI_ERROR_FILE_IO;
+}
+
+ViStatus _VI_FUNC ovAdaptiveTimeoutLoad(ViSession vi, ViConstString path) {
+    OvSession *sess = ov_session_find(vi);
+    if (!sess || sess->isRM) return VI_ERROR_INV_OBJECT;
+    if (!path) return VI_ERROR_FILE_ACCESS;
+    if (!sess->adaptive) {
+        ViStatus st = ovAdaptiveTimeoutEnable(vi, 0, 0, 0);
+        if (st != VI_SUCCESS) return st;
+    }
+    OvAdaptiveTmo *at = sess->adaptive;
+
+    FILE *f = fopen(path, "r");
+    if (!f) return VI_ERROR_FILE_ACCESS;
+    char line[2048];
+    if (!fgets(line, sizeof(line), f) || strncmp(line, AT_FILE_MAGIC, strlen(AT_FILE_MAGIC)) != 0) {
+        fclose(f);
+        return VI_ERROR_INV_SETUP;
+    }
+
+    memset(at->table, 0, AT_MAX_HEADERS * sizeof(AtEntry));
+    at->used = 0;
+    at->timing = NULL;
+    ViStatus st = VI_SUCCESS;
+    while (fgets(line, sizeof(line), f)) {
+        char header[AT_MAX_HEADER];
+        int off = 0;
+        unsigned samples;
+        if (sscanf(line, "%47s %u%n", header, &samples, &off) != 2) continue;
+        AtEntry *e = at_entry(at, header, true);
+        if (!e) { st = VI_ERROR_ALLOC; break; }
+        memset(e->counts, 0, sizeof(e->counts));
+        e->samples = 0;
+        const char *p = line + off;
+        int b, n;
+        unsigned c;
+        while (sscanf(p, " %d:%u%n", &b, &c, &n) == 2) {
+            if (b >= 0 && b < AT_BUCKETS) {
+                e->counts[b] += c;
+                e->samples += c;
+            }
+            p += n;
+        }
+    }
+    fclose(f);
+    return st;
+}
@@ -0,0 +1,361 @@
+/*
+ * OpenVISA - Resource aliases and parse cache
+ *
+ * Aliases come from a visaconf-style INI file, read once on first use:
+ *
+ *   [ALIASES]
+ *   scope  = TCPIP0::192.168.1.20::hislip0::INSTR
+ *   Alias0 = "'dmm','GPIB0::22::INSTR'"       (NI visaconf.ini form)
+ *
+ * Other sections and lines that fit neither form are ignored.  The file is
+ * $OPENVISA_ALIASES, else visaconf.ini in %APPDATA%\OpenVISA or
+ * $XDG_CONFIG_HOME/openvisa ($HOME/.config/openvisa); a missing file just
+ * means no aliases.  Alias names match case-insensitively.
+ *
+ * ov_rsrc_lookup fronts ov_parse_rsrc with a small LRU cache keyed by the
+ * string the caller passed, so a repeated viOpen of the same name skips
+ * alias resolution, parsing and the intern table's hashing alike.
+ */
+
+#include "session.h"
+#include "thread.h"
+#include "openvisa.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#define ALIAS_BUCKETS       64
+#define RSRC_CACHE_SIZE     32
+
+typedef struct AliasEntry {
+    struct AliasEntry *next_name;   /* chain in g_by_name */
+    struct AliasEntry *next_rsrc;   /* chain in g_by_rsrc */
+    uint32_t    name_hash;
+    uint32_t    rsrc_hash;
+    char       *name;
+    char       *target;             /* as written in the file */
+    char        expanded[OV_DESC_SIZE];     /* canonical target, for reverse lookup */
+} AliasEntry;
+
+typedef struct {
+    uint64_t    used;               /* LRU tick, 0 = empty */
+    uint32_t    hash;
+    char       *key;                /* string the caller passed */
+    char       *alias;              /* alias used or naming the resource, NULL = none */
+    OvResource  rsrc;               /* holds a reference to the interned text */
+} CacheEntry;
+
+static OvMutex     g_lock = OV_MUTEX_INIT;
+static bool        g_loaded;
+static AliasEntry *g_by_name[ALIAS_BUCKETS];
+static AliasEntry *g_by_rsrc[ALIAS_BUCKETS];
+static CacheEntry  g_cache[RSRC_CACHE_SIZE];
+static uint64_t    g_tick;
+static ViUInt32    g_hits, g_misses;
+
+/* FNV-1a, optionally over lower-cased bytes */
+static uint32_t alias_hash(const char *s, bool fold) {
+    uint32_t h = 2166136261u;
+    for (; *s; s++) {
+        uint8_t c = (uint8_t)*s;
+        h = (h ^ (fold ? (uint8_t)tolower(c) : c)) * 16777619u;
+    }
+    return h;
+}
+
+static bool alias_eq_ci(const char *a, const char *b) {
+    for (; *a && *b; a++, b++)
+        if (tolower((unsigned char)*a) != tolower((unsigned char)*b)) return false;
+    return *a == *b;
+}
+
+static char *alias_strdup(const char *s, size_t n) {
+    char *d = (char *)malloc(n + 1);
+    if (d) {
+        memcpy(d, s, n);
+        d[n] = '\0';
+    }
+    return d;
+}
+
+/* ========== Canonical names ========== */
+
+void ov_rsrc_expand(const OvResource *r, char *out, size_t size) {
+    switch ((int)r->intfType) {
+        case OV_INTF_TCPIP:
+            if (r->isSocket)
+                snprintf(out, size, "TCPIP%u::%s::%u::SOCKET",
+                         (unsigned)r->intfNum, ov_rsrc_host(r), (unsigned)r->port);
+            else if (r->isHiSLIP && r->port != 4880)
+                snprintf(out, size, "TCPIP%u::%s::%s,%u::INSTR", (unsigned)r->intfNum,
+                         ov_rsrc_host(r), ov_rsrc_device(r), (unsigned)r->port);
+            else
+                snprintf(out, size, "TCPIP%u::%s::%s::INSTR",
+                         (unsigned)r->intfNum, ov_rsrc_host(r), ov_rsrc_device(r));
+            break;
+        case OV_INTF_ASRL:
+            if (ov_rsrc_host(r)[0])
+                snprintf(out, size, "TCPIP%u::%s::%u::ASRL",
+                         (unsigned)r->intfNum, ov_rsrc_host(r), (unsigned)r->port);
+            else
+                snprintf(out, size, "ASRL%d::INSTR", r->comPort);
+            break;
+        case OV_INTF_USB:
+            snprintf(out, size, "USB%u::0x%04X::0x%04X::%s::INSTR", (unsigned)r->intfNum,
+                     (unsigned)r->usbVid, (unsigned)r->usbPid, ov_rsrc_usb_serial(r));
+            break;
+        case OV_INTF_GPIB:
+            if (r->gpibSecAddr >= 0)
+                snprintf(out, size, "GPIB%u::%d::%d::INSTR",
+                         (unsigned)r->intfNum, r->gpibAddr, r->gpibSecAddr);
+            else
+                snprintf(out, size, "GPIB%u::%d::INSTR", (unsigned)r->intfNum, r->gpibAddr);
+            break;
+        case OV_INTF_SIM:   snprintf(out, size, "SIM::%s::INSTR", ov_rsrc_device(r)); break;
+        case OV_INTF_PROXY: snprintf(out, size, "PROXY::%s::INSTR", ov_rsrc_device(r)); break;
+        case OV_INTF_SHM:   snprintf(out, size, "SHM::%s::INSTR", ov_rsrc_device(r)); break;
+        case OV_INTF_UNIX:  snprintf(out, size, "UNIX::%s::SOCKET", ov_rsrc_device(r)); break;
+        default:            snprintf(out, size, "%s", ov_rsrc_raw(r)); break;
+    }
+}
+
+const char *ov_rsrc_class(const OvResource *r) {
+    if (r->intfType == OV_INTF_REMOTE) {
+        /* Class of the remote resource: its last "::" field */
+        const char *dev = ov_rsrc_device(r), *last = NULL;
+        for (const char *p = strstr(dev, "::"); p; p = strstr(p + 2, "::")) last = p + 2;
+        if (last && *last && !isdigit((unsigned char)*last)) return last;
+        return "INSTR";
+    }
+    return r->isSocket ? "SOCKET" : "INSTR";
+}
+
+/* ========== Alias table ========== */
+
+/* Caller holds g_lock */
+static void alias_clear(void) {
+    for (int b = 0; b < ALIAS_BUCKETS; b++) {
+        AliasEntry *e = g_by_name[b];
+        while (e) {
+            AliasEntry *next = e->next_name;
+            free(e->name);
+            free(e->target);
+            free(e);
+            e = next;
+        }
+        g_by_name[b] = g_by_rsrc[b] = NULL;
+    }
+    for (int i = 0; i < RSRC_CACHE_SIZE; i++) {
+        CacheEntry *c = &g_cache[i];
+        if (!c->used) continue;
+        ov_rsrc_release(&c->rsrc);
+        free(c->key);
+        free(c->alias);
+        memset(c, 0, sizeof(*c));
+    }
+}
+
+static AliasEntry *alias_find(const char *name) {
+    uint32_t h = alias_hash(name, true);
+    for (AliasEntry *e = g_by_name[h % ALIAS_BUCKETS]; e; e = e->next_name)
+        if (e->name_hash == h && alias_eq_ci(e->name, name)) return e;
+    return NULL;
+}
+
+static AliasEntry *alias_find_rsrc(const char *expanded) {
+    uint32_t h = alias_hash(expanded, true);
+    for (AliasEntry *e = g_by_rsrc[h % ALIAS_BUCKETS]; e; e = e->next_rsrc)
+        if (e->rsrc_hash == h && alias_eq_ci(e->expanded, expanded)) return e;
+    return NULL;
+}
+
+/* Caller holds g_lock; entries go to the head of their chains, so a later
+ * definition of the same name shadows the earlier one */
+static void alias_add(const char *name, size_t nlen, const char *target, size_t tlen) {
+    AliasEntry *e = (AliasEntry *)calloc(1, sizeof(AliasEntry));
+    if (!e) return;
+    e->name = alias_strdup(name, nlen);
+    e->target = alias_strdup(target, tlen);
+    if (!e->name || !e->target) {
+        free(e->name);
+        free(e->target);
+        free(e);
+        return;
+    }
+    OvResource r;
+    if (ov_parse_rsrc(e->target, &r) == VI_SUCCESS) ov_rsrc_expand(&r, e->expanded, sizeof(e->expanded));
+    else snprintf(e->expanded, sizeof(e->expanded), "%s", e->target);
+    ov_rsrc_release(&r);
+
+    e->name_hash = alias_hash(e->name, true);
+    e->rsrc_hash = alias_hash(e->expanded, true);
+    e->next_name = g_by_name[e->name_hash % ALIAS_BUCKETS];
+    g_by_name[e->name_hash % ALIAS_BUCKETS] = e;
+    e->next_rsrc = g_by_rsrc[e->rsrc_hash % ALIAS_BUCKETS];
+    g_by_rsrc[e->rsrc_hash % ALIAS_BUCKETS] = e;
+}
+
+static void trim(const char **s, const char **end) {
+    while (*s < *end && isspace((unsigned char)**s)) (*s)++;
+    while (*end > *s && isspace((unsigned char)(*end)[-1])) (*end)--;
+}
+
+/* One line of the [ALIASES] section */
+static void alias_parse_line(const char *line) {
+    const char *eq = strchr(line, '=');
+    if (!eq) return;
+    const char *k = line, *kend = eq, *v = eq + 1, *vend = v + strlen(v);
+    trim(&k, &kend);
+    trim(&v, &vend);
+    if (k == kend || v == vend) return;
+    if (vend - v >= 2 && *v == '"' && vend[-1] == '"') { v++; vend--; }
+
+    /* NI form: AliasN = "'name','resource'" */
+    if (*v == '\'') {
+        const char *n = v + 1, *nend = memchr(n, '\'', (size_t)(vend - n));
+        if (!nend || nend + 2 >= vend || nend[1] != ',' || nend[2] != '\'') return;
+        const char *t = nend + 3, *tend = memchr(t, '\'', (size_t)(vend - t));
+        if (!tend || nend == n || tend == t) return;
+        alias_add(n, (size_t)(nend - n), t, (size_t)(tend - t));
+        return;
+    }
+    if ((size_t)(kend - k) == 10 && strncmp(k, "NumAliases", 10) == 0) return;
+    alias_add(k, (size_t)(kend - k), v, (size_t)(vend - v));
+}
+
+/* Caller holds g_lock */
+static bool alias_load_file(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+    char line[2 * OV_RSRC_MAX_LEN];
+    bool in_section = false;
+    while (fgets(line, sizeof(line), f)) {
+        size_t len = strcspn(line, "\r\n");
+        while (len && isspace((unsigned char)line[len - 1])) len--;
+        line[len] = '\0';
+        const char *p = line;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == ';' || *p == '#' || *p == '\0') continue;
+        if (*p == '[') {
+            in_section = alias_eq_ci(p, "[ALIASES]");
+            continue;
+        }
+        if (in_section) alias_parse_line(p);
+    }
+    fclose(f);
+    return true;
+}
+
+static bool alias_default_path(char *path, size_t size) {
+    const char *env = getenv("OPENVISA_ALIASES");
+    if (env && *env) {
+        snprintf(path, size, "%s", env);
+        return true;
+    }
+#ifdef OPENVISA_WINDOWS
+    const char *dir = getenv("APPDATA");
+    if (!dir || !*dir) return false;
+    snprintf(path, size, "%s\\OpenVISA\\visaconf.ini", dir);
+#else
+    const char *dir = getenv("XDG_CONFIG_HOME");
+    if (dir && *dir) {
+        snprintf(path, size, "%s/openvisa/visaconf.ini", dir);
+    } else {
+        dir = getenv("HOME");
+        if (!dir || !*dir) return false;
+        snprintf(path, size, "%s/.config/openvisa/visaconf.ini", dir);
+    }
+#endif
+    return true;
+}
+
+/* Caller holds g_lock */
+static void alias_load_default(void) {
+    if (g_loaded) return;
+    g_loaded = true;
+    char path[1024];
+    if (alias_default_path(path, sizeof(path))) alias_load_file(path);
+}
+
+ViStatus _VI_FUNC ovAliasLoad(ViConstString path) {
+    ov_mutex_lock(&g_lock);
+    alias_clear();
+    g_loaded = true;
+    ViStatus st = VI_SUCCESS;
+    if (path) {
+        if (!alias_load_file(path)) st = VI_ERROR_FILE_ACCESS;
+    } else {
+        g_loaded = false;
+        alias_load_default();
+    }
+    ov_mutex_unlock(&g_lock);
+    return st;
+}
+
+/* ========== Parse cache ========== */
+
+ViStatus ov_rsrc_lookup(const char *rsrcName, OvResource *rsrc, char alias[]) {
+    if (alias) alias[0] = '\0';
+    uint32_t h = alias_hash(rsrcName, false);
+
+    ov_mutex_lock(&g_lock);
+    alias_load_default();
+    CacheEntry *victim = &g_cache[0];
+    for (int i = 0; i < RSRC_CACHE_SIZE; i++) {
+        CacheEntry *c = &g_cache[i];
+        if (c->used && c->hash == h && strcmp(c->key, rsrcName) == 0) {
+            c->used = ++g_tick;
+            g_hits++;
+            *rsrc = c->rsrc;
+            ov_rsrc_retain(rsrc);
+            if (alias && c->alias) snprintf(alias, OV_DESC_SIZE, "%s", c->alias);
+            ov_mutex_unlock(&g_lock);
+            return VI_SUCCESS;
+        }
+        if (c->used < victim->used) victim = c;
+    }
+    g_misses++;
+
+    AliasEntry *a = alias_find(rsrcName);
+    ViStatus st = ov_parse_rsrc(a ? a->target : rsrcName, rsrc);
+    if (st != VI_SUCCESS) {
+        ov_mutex_unlock(&g_lock);
+        return st;
+    }
+    if (!a) {
+        char expanded[OV_DESC_SIZE];
+        ov_rsrc_expand(rsrc, expanded, sizeof(expanded));
+        a = alias_find_rsrc(expanded);
+    }
+    if (alias && a) snprintf(alias, OV_DESC_SIZE, "%s", a->name);
+
+    /* Replace the least recently used entry */
+    char *key = alias_strdup(rsrcName, strlen(rsrcName));
+    char *name = a ? alias_strdup(a->name, strlen(a->name)) : NULL;
+    if (key && (name || !a)) {
+        if (victim->used) {
+            ov_rsrc_release(&victim->rsrc);
+            free(victim->key);
+            free(victim->alias);
+        }
+        victim->used = ++g_tick;
+        victim->hash = h;
+        victim->key = key;
+        victim->alias = name;
+        victim->rsrc = *rsrc;
+        ov_rsrc_retain(&victim->rsrc);
+    } else {
+        free(key);
+        free(name);
+    }
+    ov_mutex_unlock(&g_lock);
+    return VI_SUCCESS;
+}
+
+void ov_rsrc_cache_stats(ViUInt32 *hits, ViUInt32 *misses) {
+    ov_mutex_lock(&g_lock);
+    if (hits) *hits = g_hits;
+    if (misses) *misses = g_misses;
+    ov_mutex_unlock(&g_lock);
+}
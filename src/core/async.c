@@ -0,0 +1,494 @@
+/*
+ * OpenVISA - Asynchronous I/O and I/O completion events
+ *
+ * viReadAsync/viWriteAsync queue a job on the session and return at once.
+ * The jobs are still blocking viRead/viWrite calls: a session with jobs
+ * queued is posted to the shared worker pool (ov_parallel_post), and one
+ * pool thread runs its jobs in submission order until none are left.  An
+ * application waiting on a hundred instruments therefore has up to a
+ * hundred pool threads parked in transport reads, though none of its own;
+ * past the pool's limit, sessions wait for a thread to come free.  Every
+ * finished job raises
+ * VI_EVENT_IO_COMPLETION: with VI_HNDLR the installed handlers run on the
+ * worker before the session's next job starts, with VI_QUEUE the event
+ * waits for viWaitOnEvent.  Event contexts are objects with their own
+ * handles (viGetAttribute VI_ATTR_STATUS, VI_ATTR_JOB_ID, VI_ATTR_RET_COUNT,
+ * ..., then viClose); a handler's context is closed when it returns.
+ *
+ * Other event types are accepted by viEnableEvent but never occur.
+ */
+
+#include "session.h"
+#include "thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define OV_ASYNC_MAX_HANDLERS   8
+#define OV_ASYNC_QUEUE_LEN      50      /* VISA's default VI_ATTR_MAX_QUEUE_LENGTH */
+
+/* ========== State ========== */
+
+typedef struct OvAsyncJob {
+    struct OvAsyncJob *next;
+    ViJobId     id;
+    bool        read;
+    bool        aborted;            /* viTerminate: completes with VI_ERROR_ABORT */
+    ViBuf       buf;
+    ViUInt32    count;
+} OvAsyncJob;
+
+typedef struct OvEventCtx {
+    bool        active;
+    ViEvent     handle;
+    ViEventType type;
+    ViStatus    status;
+    ViJobId     jobId;
+    bool        read;
+    ViBuf       buf;
+    ViUInt32    retCount;
+    struct OvEventCtx *next;        /* session queue */
+} OvEventCtx;
+
+typedef struct {
+    ViHndlr     fn;
+    ViAddr      user;
+} OvHandler;
+
+struct OvAsync {
+    ViSession   vi;
+    OvAsyncJob *head, *tail;
+    ViJobId     nextId;
+    bool        scheduled;          /* posted to the pool or owned by a worker */
+    bool        busy;               /* a worker is inside viRead/viWrite or a handler */
+    uintptr_t   runner;             /* that worker */
+    bool        closed;             /* session gone, freed by whoever lets go last */
+    bool        closing;            /* viClose waiting for busy to clear */
+    bool        queueEn, hndlrEn;   /* VI_EVENT_IO_COMPLETION mechanisms */
+    OvHandler   handlers[OV_ASYNC_MAX_HANDLERS];
+    uint32_t    nhandlers;
+    OvEventCtx *qhead, *qtail;
+    uint32_t    qlen;
+};
+
+/* One lock for every session's async state and the event table: it is held
+ * only to move jobs and events around, never across I/O or a handler */
+static struct {
+    OvMutex     lock;
+    OvCond      done;               /* a job's I/O finished */
+    OvCond      event;              /* an event was queued or a session closed */
+    bool        condReady;
+    OvEventCtx  events[OV_MAX_EVENTS];
+} g_async = { .lock = OV_MUTEX_INIT };
+
+static void async_init_locked(void) {
+    if (g_async.condReady) return;
+    ov_cond_init(&g_async.done);
+    ov_cond_init(&g_async.event);
+    g_async.condReady = true;
+}
+
+static OvAsync *async_get(OvSession *sess) {
+    if (!sess->async) {
+        sess->async = (OvAsync*)calloc(1, sizeof(OvAsync));
+        if (sess->async) sess->async->vi = sess->handle;
+    }
+    return sess->async;
+}
+
+/* ========== Event contexts ========== */
+
+static OvEventCtx *event_new(ViEventType type) {
+    for (uint32_t i = 0; i < OV_MAX_EVENTS; i++) {
+        OvEventCtx *ev = &g_async.events[i];
+        if (ev->active) continue;
+        memset(ev, 0, sizeof(*ev));
+        ev->active = true;
+        ev->handle = ov_handle_alloc(OV_EVENT_SLOT_BASE + i);
+        ev->type = type;
+        return ev;
+    }
+    return NULL;
+}
+
+static OvEventCtx *event_find(ViEvent handle) {
+    ViUInt32 slot = handle & OV_HANDLE_SLOT_MASK;
+    if (slot < OV_EVENT_SLOT_BASE || slot >= OV_EVENT_SLOT_BASE + OV_MAX_EVENTS) return NULL;
+    OvEventCtx *ev = &g_async.events[slot - OV_EVENT_SLOT_BASE];
+    return (ev->active && ev->handle == handle) ? ev : NULL;
+}
+
+static void event_discard_queue(OvAsync *a) {
+    for (OvEventCtx *ev = a->qhead; ev; ev = ev->next) ev->active = false;
+    a->qhead = a->qtail = NULL;
+    a->qlen = 0;
+}
+
+ViStatus ov_event_get_attr(ViEvent event, ViAttr attr, void *value) {
+    ov_mutex_lock(&g_async.lock);
+    OvEventCtx *ev = event_find(event);
+    ViStatus st = VI_SUCCESS;
+    if (!ev) {
+        st = VI_ERROR_INV_OBJECT;
+    } else switch (attr) {
+        case VI_ATTR_EVENT_TYPE: *(ViEventType*)value = ev->type; break;
+        case VI_ATTR_STATUS:     *(ViStatus*)value = ev->status; break;
+        case VI_ATTR_JOB_ID:     *(ViJobId*)value = ev->jobId; break;
+        case VI_ATTR_BUFFER:     *(ViBuf*)value = ev->buf; break;
+        case VI_ATTR_RET_COUNT:  *(ViUInt32*)value = ev->retCount; break;
+        case VI_ATTR_OPER_NAME:
+            strcpy((char*)value, ev->read ? "viReadAsync" : "viWriteAsync");
+            break;
+        default:                 st = VI_ERROR_NSUP_ATTR; break;
+    }
+    ov_mutex_unlock(&g_async.lock);
+    return st;
+}
+
+ViStatus ov_event_close(ViEvent event) {
+    ov_mutex_lock(&g_async.lock);
+    OvEventCtx *ev = event_find(event);
+    if (ev) ev->active = false;
+    ov_mutex_unlock(&g_async.lock);
+    return ev ? VI_SUCCESS : VI_ERROR_INV_OBJECT;
+}
+
+/* ========== Jobs ========== */
+
+static void async_destroy(OvAsync *a) {
+    while (a->head) {
+        OvAsyncJob *j = a->head;
+        a->head = j->next;
+        free(j);
+    }
+    event_discard_queue(a);
+    free(a);
+}
+
+static OvEventCtx *event_completion(const OvAsyncJob *j, ViStatus status, ViUInt32 retCount) {
+    OvEventCtx *ev = event_new(VI_EVENT_IO_COMPLETION);
+    if (ev) {
+        ev->status = status;
+        ev->jobId = j->id;
+        ev->read = j->read;
+        ev->buf = j->buf;
+        ev->retCount = retCount;
+    }
+    return ev;
+}
+
+/* Raise the completion of j: handlers first (lock dropped), then the queue */
+static void async_complete(OvAsync *a, const OvAsyncJob *j, ViStatus status, ViUInt32 retCount) {
+    if (a->hndlrEn && a->nhandlers) {
+        OvHandler h[OV_ASYNC_MAX_HANDLERS];
+        uint32_t n = a->nhandlers;
+        memcpy(h, a->handlers, n * sizeof(OvHandler));
+        OvEventCtx *ev = event_completion(j, status, retCount);
+        if (ev) {
+            ViEvent ctx = ev->handle;
+            a->busy = true;
+            ov_mutex_unlock(&g_async.lock);
+            for (uint32_t i = 0; i < n; i++)
+                h[i].fn(a->vi, VI_EVENT_IO_COMPLETION, ctx, h[i].user);
+            ov_mutex_lock(&g_async.lock);
+            a->busy = false;
+            ov_cond_broadcast(&g_async.done);
+            ev = event_find(ctx);
+            if (ev) ev->active = false;
+        }
+    }
+    if (a->queueEn && !a->closed && a->qlen < OV_ASYNC_QUEUE_LEN) {
+        OvEventCtx *ev = event_completion(j, status, retCount);
+        if (!ev) return;
+        if (a->qtail) a->qtail->next = ev; else a->qhead = ev;
+        a->qtail = ev;
+        a->qlen++;
+        ov_cond_broadcast(&g_async.event);
+    }
+}
+
+/* Run a's jobs in order until its queue is empty or the session closes */
+static void async_run(OvAsync *a) {
+    a->runner = ov_thread_self();
+    while (a->head && !a->closed) {
+        OvAsyncJob *j = a->head;
+        a->head = j->next;
+        if (!a->head) a->tail = NULL;
+
+        ViStatus st = VI_ERROR_ABORT;
+        ViUInt32 ret = 0;
+        if (!j->aborted) {
+            a->busy = true;
+            ov_mutex_unlock(&g_async.lock);
+            st = j->read ? viRead(a->vi, j->buf, j->count, &ret)
+                         : viWrite(a->vi, j->buf, j->count, &ret);
+            ov_mutex_lock(&g_async.lock);
+            a->busy = false;
+            ov_cond_broadcast(&g_async.done);
+        }
+        if (!a->closed) async_complete(a, j, st, ret);
+        free(j);
+    }
+    a->scheduled = false;
+    if (a->closed && !a->closing) async_destroy(a);
+}
+
+static void async_task(void *ctx, uint32_t i) {
+    (void)i;
+    ov_mutex_lock(&g_async.lock);
+    async_run((OvAsync *)ctx);
+    ov_mutex_unlock(&g_async.lock);
+}
+
+static bool async_schedule(OvAsync *a) {
+    if (a->scheduled) return true;
+    if (!ov_parallel_post(async_task, a)) return false;
+    a->scheduled = true;
+    return true;
+}
+
+/* viClose: drop queued jobs and events and wait out a read, write or
+ * handler in progress (the transport and the handler's user data are about
+ * to go) unless that handler is the caller; no events after this */
+void ov_async_free(OvSession *sess) {
+    ov_mutex_lock(&g_async.lock);
+    OvAsync *a = sess->async;
+    sess->async = NULL;
+    if (!a) {
+        ov_mutex_unlock(&g_async.lock);
+        return;
+    }
+    a->closed = true;
+    a->closing = true;
+    while (a->busy && a->runner != ov_thread_self()) ov_cond_wait(&g_async.done, &g_async.lock);
+    a->closing = false;
+    ov_cond_broadcast(&g_async.event);
+    if (!a->scheduled) {
+        async_destroy(a);
+    } else {
+        while (a->head) {
+            OvAsyncJob *j = a->head;
+            a->head = j->next;
+            free(j);
+        }
+        a->tail = NULL;
+        event_discard_queue(a);
+    }
+    ov_mutex_unlock(&g_async.lock);
+}
+
+/* ========== Asynchronous I/O ========== */
+
+static ViStatus async_submit(ViSession vi, bool read, ViBuf buf, ViUInt32 count, ViJobId *jobId) {
+    OvSession *sess = ov_session_find(vi);
+    if (!sess || !sess->transport || (read ? !sess->transport->read : !sess->transport->write))
+        return VI_ERROR_INV_OBJECT;
+
+    OvAsyncJob *j = (OvAsyncJob*)calloc(1, sizeof(OvAsyncJob));
+    if (!j) return VI_ERROR_ALLOC;
+    j->read = read;
+    j->buf = buf;
+    j->count = count;
+
+    ov_mutex_lock(&g_async.lock);
+    async_init_locked();
+    OvAsync *a = async_get(sess);
+    if (!a) {
+        ov_mutex_unlock(&g_async.lock);
+        free(j);
+        return VI_ERROR_ALLOC;
+    }
+    if (!async_schedule(a)) {
+        ov_mutex_unlock(&g_async.lock);
+        free(j);
+        return VI_ERROR_SYSTEM_ERROR;
+    }
+    if (++a->nextId == VI_NULL) ++a->nextId;
+    ViJobId id = j->id = a->nextId;
+    if (a->tail) a->tail->next = j; else a->head = j;
+    a->tail = j;
+    ov_mutex_unlock(&g_async.lock);
+
+    if (jobId) *jobId = id;         /* j may be done and freed already */
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC viReadAsync(ViSession vi, ViBuf buf, ViUInt32 count, ViJobId *jobId) {
+    return async_submit(vi, true, buf, count, jobId);
+}
+
+ViStatus _VI_FUNC viWriteAsync(ViSession vi, ViBuf buf, ViUInt32 count, ViJobId *jobId) {
+    return async_submit(vi, false, buf, count, jobId);
+}
+
+ViStatus _VI_FUNC viTerminate(ViSession vi, ViUInt16 degree, ViJobId jobId) {
+    (void)degree;
+    OvSession *sess = ov_session_find(vi);
+    if (!sess) return VI_ERROR_INV_OBJECT;
+
+    /* A job already in the transport runs to completion */
+    ov_mutex_lock(&g_async.lock);
+    bool found = false;
+    for (OvAsyncJob *j = sess->async ? sess->async->head : NULL; j; j = j->next) {
+        if (jobId == VI_NULL || j->id == jobId) {
+            j->aborted = true;
+            found = true;
+        }
+    }
+    ov_mutex_unlock(&g_async.lock);
+    return (found || jobId == VI_NULL) ? VI_SUCCESS : VI_ERROR_INV_JOB_ID;
+}
+
+/* ========== Events ========== */
+
+ViStatus _VI_FUNC viEnableEvent(ViSession vi, ViEventType eventType, ViUInt16 mechanism, ViEventFilter context) {
+    (void)context;
+    OvSession *sess = ov_session_find(vi);
+    if (!sess) return VI_ERROR_INV_OBJECT;
+    if (eventType == VI_ALL_ENABLED_EVENTS) return VI_ERROR_INV_EVENT;
+    if (mechanism == 0 || (mechanism & ~(VI_QUEUE | VI_HNDLR))) return VI_ERROR_INV_MECH;
+    if (eventType != VI_EVENT_IO_COMPLETION) return VI_SUCCESS;
+
+    ov_mutex_lock(&g_async.lock);
+    async_init_locked();
+    OvAsync *a = async_get(sess);
+    ViStatus st = VI_SUCCESS;
+    if (!a) {
+        st = VI_ERROR_ALLOC;
+    } else if ((mechanism & VI_HNDLR) && a->nhandlers == 0) {
+        st = VI_ERROR_HNDLR_NINSTALLED;
+    } else {
+        bool already = (!(mechanism & VI_QUEUE) || a->queueEn) && (!(mechanism & VI_HNDLR) || a->hndlrEn);
+        if (mechanism & VI_QUEUE) a->queueEn = true;
+        if (mechanism & VI_HNDLR) a->hndlrEn = true;
+        if (already) st = VI_SUCCESS_EVENT_EN;
+    }
+    ov_mutex_unlock(&g_async.lock);
+    return st;
+}
+
+ViStatus _VI_FUNC viDisableEvent(ViSession vi, ViEventType eventType, ViUInt16 mechanism) {
+    OvSession *sess = ov_session_find(vi);
+    if (!sess) return VI_ERROR_INV_OBJECT;
+    if (eventType != VI_EVENT_IO_COMPLETION && eventType != VI_ALL_ENABLED_EVENTS) return VI_SUCCESS;
+
+    ov_mutex_lock(&g_async.lock);
+    OvAsync *a = sess->async;
+    ViStatus st = VI_SUCCESS_EVENT_DIS;
+    if (a && ((a->queueEn && (mechanism & VI_QUEUE)) || (a->hndlrEn && (mechanism & VI_HNDLR)))) {
+        if (mechanism & VI_QUEUE) a->queueEn = false;
+        if (mechanism & VI_HNDLR) a->hndlrEn = false;
+        st = VI_SUCCESS;
+    }
+    ov_mutex_unlock(&g_async.lock);
+    return st;
+}
+
+ViStatus _VI_FUNC viDiscardEvents(ViSession vi, ViEventType eventType, ViUInt16 mechanism) {
+    OvSession *sess = ov_session_find(vi);
+    if (!sess) return VI_ERROR_INV_OBJECT;
+    if (eventType != VI_EVENT_IO_COMPLETION && eventType != VI_ALL_ENABLED_EVENTS) return VI_SUCCESS_QUEUE_EMPTY;
+
+    ov_mutex_lock(&g_async.lock);
+    OvAsync *a = sess->async;
+    ViStatus st = VI_SUCCESS_QUEUE_EMPTY;
+    if (a && (mechanism & VI_QUEUE) && a->qlen) {
+        event_discard_queue(a);
+        st = VI_SUCCESS;
+    }
+    ov_mutex_unlock(&g_async.lock);
+    return st;
+}
+
+ViStatus _VI_FUNC viWaitOnEvent(ViSession vi, ViEventType inEventType, ViUInt32 timeout,
+                                ViEventType *outEventType, ViEvent *outContext)
+{
+    if (outEventType) *outEventType = 0;
+    if (outContext) *outContext = VI_NULL;
+    OvSession *sess = ov_session_find(vi);
+    if (!sess) return VI_ERROR_INV_OBJECT;
+    if (inEventType != VI_EVENT_IO_COMPLETION && inEventType != VI_ALL_ENABLED_EVENTS) return VI_ERROR_TMO;
+
+    ov_mutex_lock(&g_async.lock);
+    async_init_locked();
+    OvAsync *a = sess->async;
+    if (!(a && a->queueEn)) {
+        ov_mutex_unlock(&g_async.lock);
+        return inEventType == VI_ALL_ENABLED_EVENTS ? VI_ERROR_TMO : VI_ERROR_NENABLED;
+    }
+
+    /* The session may close while we sleep: look it up again after each wait */
+    uint64_t deadline = ov_time_ns() + (uint64_t)timeout * 1000000u;
+    ViStatus st = VI_ERROR_TMO;
+    for (;;) {
+        sess = ov_session_find(vi);
+        a = sess ? sess->async : NULL;
+        if (!a) { st = VI_ERROR_INV_OBJECT; break; }
+        if (a->qhead) {
+            OvEventCtx *ev = a->qhead;
+            a->qhead = ev->next;
+            if (!a->qhead) a->qtail = NULL;
+            a->qlen--;
+            ev->next = NULL;
+            if (outEventType) *outEventType = ev->type;
+            if (outContext) *outContext = ev->handle;
+            else ev->active = false;
+            st = VI_SUCCESS;
+            break;
+        }
+        if (timeout == VI_TMO_INFINITE) {
+            ov_cond_wait(&g_async.event, &g_async.lock);
+            continue;
+        }
+        uint64_t now = ov_time_ns();
+        if (now >= deadline) break;
+        ov_cond_timedwait(&g_async.event, &g_async.lock, (uint32_t)((deadline - now + 999999u) / 1000000u));
+    }
+    ov_mutex_unlock(&g_async.lock);
+    return st;
+}
+
+ViStatus _VI_FUNC viInstallHandler(ViSession vi, ViEventType eventType, ViHndlr handler, ViAddr userHandle) {
+    OvSession *sess = ov_session_find(vi);
+    if (!sess) return VI_ERROR_INV_OBJECT;
+    if (!handler) return VI_ERROR_INV_HNDLR_REF;
+    if (eventType != VI_EVENT_IO_COMPLETION) return VI_SUCCESS;
+
+    ov_mutex_lock(&g_async.lock);
+    async_init_locked();
+    OvAsync *a = async_get(sess);
+    ViStatus st = VI_SUCCESS;
+    if (!a) {
+        st = VI_ERROR_ALLOC;
+    } else if (a->nhandlers == OV_ASYNC_MAX_HANDLERS) {
+        st = VI_ERROR_ALLOC;
+    } else {
+        a->handlers[a->nhandlers].fn = handler;
+        a->handlers[a->nhandlers].user = userHandle;
+        a->nhandlers++;
+    }
+    ov_mutex_unlock(&g_async.lock);
+    return st;
+}
+
+ViStatus _VI_FUNC viUninstallHandler(ViSession vi, ViEventType eventType, ViHndlr handler, ViAddr userHandle) {
+    OvSession *sess = ov_session_find(vi);
+    if (!sess) return VI_ERROR_INV_OBJECT;
+    if (eventType != VI_EVENT_IO_COMPLETION) return VI_SUCCESS;
+
+    /* handler VI_ANY_HNDLR removes them all, userHandle is then ignored */
+    ov_mutex_lock(&g_async.lock);
+    OvAsync *a = sess->async;
+    bool found = false;
+    uint32_t n = 0;
+    for (uint32_t i = 0; a && i < a->nhandlers; i++) {
+        OvHandler h = a->handlers[i];
+        if (handler == VI_ANY_HNDLR || (h.fn == handler && h.user == userHandle)) {
+            found = true;
+            continue;
+        }
+        a->handlers[n++] = h;
+    }
+    if (a) a->nhandlers = n;
+    ov_mutex_unlock(&g_async.lock);
+    return found ? VI_SUCCESS : VI_ERROR_INV_HNDLR_REF;
+}
@@ -0,0 +1,171 @@
+/*
+ * OpenVISA - HiSLIP / VXI-11 auto-selection  (ovAutoProtocol*)
+ *
+ * TCPIP::host::INSTR means VXI-11, which costs a portmapper round trip to
+ * open and an RPC per read and write.  Most current instruments speak
+ * HiSLIP as well.  With auto-selection on, viOpen of a plain INSTR resource
+ * (device inst0 on the standard port) connects to the host's HiSLIP port
+ * 4880 and its portmapper at the same time: if HiSLIP answers the session
+ * is opened as hislip0, otherwise as VXI-11.  Once the portmapper has
+ * answered, HiSLIP gets twice as long again (at least AP_GRACE_MS) before
+ * VXI-11 is taken, so a slow but present HiSLIP server still wins.
+ *
+ * The choice is kept per host, so only the first open of a host probes.
+ * An open on the chosen protocol that fails forgets it, and the next open
+ * probes again.  A host that does not resolve, or refuses both ports, is
+ * opened as VXI-11 and that open reports why.  If neither port answers
+ * within the open timeout the open fails with VI_ERROR_TMO.  The session keeps the resource name it was
+ * opened with.  Off by default; $OPENVISA_AUTO_PROTOCOL=1 turns it on until
+ * ovAutoProtocolEnable is called.
+ */
+
+#include "session.h"
+#include "thread.h"
+#include "hosts.h"
+#include "openvisa.h"
+#include <string.h>
+#include <stdlib.h>
+
+#define AP_HISLIP_PORT      4880
+#define AP_PORTMAP_PORT     111
+#define AP_GRACE_MS         50
+
+typedef struct ApHost {
+    OvHostEntry e;
+    bool        hislip;
+} ApHost;
+
+static OvMutex      g_lock = OV_MUTEX_INIT;
+static bool         g_configured;
+static bool         g_enabled;
+static OvHostEntry *g_hosts;
+
+/* Caller holds g_lock */
+static void ap_load_env(void) {
+    const char *env = ov_host_env_once(&g_configured, "OPENVISA_AUTO_PROTOCOL");
+    if (env) g_enabled = atoi(env) != 0;
+}
+
+/* Plain VXI-11 INSTR: no device name but the default, standard port */
+static bool ap_applies(const OvResource *rsrc) {
+    return rsrc->intfType == OV_INTF_TCPIP && !rsrc->isHiSLIP && !rsrc->isSocket &&
+           rsrc->port == AP_PORTMAP_PORT && ov_rsrc_host(rsrc)[0] &&
+           strcmp(ov_rsrc_device(rsrc), "inst0") == 0;
+}
+
+/* ========== Probe ========== */
+
+/* Connect to the HiSLIP port and the portmapper at once.  On VI_SUCCESS
+ * *hislip is the choice and *known whether it is worth keeping: false when
+ * the host did not resolve or both ports failed, the VXI-11 open then
+ * reports why.  VI_ERROR_TMO only if neither answered in time. */
+static ViStatus ap_probe(const char *host, ViUInt32 timeout_ms, bool *hislip, bool *known) {
+    *hislip = *known = false;
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, NULL, &hints, &res) != 0) return VI_SUCCESS;
+
+    OvProbe p[2];                       /* [0] HiSLIP, [1] portmapper */
+    ov_probe_start(&p[0], res, AP_HISLIP_PORT);
+    ov_probe_start(&p[1], res, AP_PORTMAP_PORT);
+    freeaddrinfo(res);
+
+    uint64_t t0 = ov_time_ns();
+    uint64_t deadline = t0 + (uint64_t)timeout_ms * 1000000u;
+    bool mapper_up = false;
+    for (;;) {
+        uint64_t now = ov_time_ns();
+        if (p[1].state == OV_PROBE_OPEN && !mapper_up) {
+            /* The host is there: HiSLIP gets a little longer, not the whole timeout */
+            mapper_up = true;
+            uint64_t grace = (now - t0) * 2;
+            if (grace < AP_GRACE_MS * 1000000ull) grace = AP_GRACE_MS * 1000000ull;
+            if (now + grace < deadline) deadline = now + grace;
+        }
+        if (p[0].state == OV_PROBE_OPEN || now >= deadline) break;
+        /* No HiSLIP: the portmapper still tells whether VXI-11 is worth keeping */
+        if (p[0].state != OV_PROBE_PENDING && p[1].state != OV_PROBE_PENDING) break;
+        uint64_t wait_ms = (deadline - now + 999999) / 1000000u;
+        ov_probe_wait(p, 2, wait_ms > INT32_MAX ? INT32_MAX : (ViUInt32)wait_ms);
+    }
+    ov_probe_close(&p[0]);
+    ov_probe_close(&p[1]);
+
+    *hislip = p[0].state == OV_PROBE_OPEN;
+    *known = *hislip || mapper_up;
+    if (*known || (p[0].state != OV_PROBE_PENDING && p[1].state != OV_PROBE_PENDING)) return VI_SUCCESS;
+    return VI_ERROR_TMO;
+}
+
+/* ========== Session hooks ========== */
+
+ViStatus ov_autoproto_select(OvResource *rsrc, ViUInt32 timeout, bool *switched) {
+    *switched = false;
+    if (!ap_applies(rsrc)) return VI_SUCCESS;
+
+    const char *host = ov_rsrc_host(rsrc);
+    ov_mutex_lock(&g_lock);
+    ap_load_env();
+    bool enabled = g_enabled;
+    ApHost *h = enabled ? (ApHost *)ov_host_find(&g_hosts, host, 0) : NULL;
+    bool known = h != NULL, hislip = h && h->hislip;
+    ov_mutex_unlock(&g_lock);
+    if (!enabled) return VI_SUCCESS;
+
+    if (!known) {
+        ViStatus st = ap_probe(host, timeout, &hislip, &known);
+        if (st != VI_SUCCESS) return st;
+    }
+    if (known) {
+        ov_mutex_lock(&g_lock);
+        h = (ApHost *)ov_host_find(&g_hosts, host, sizeof(ApHost));
+        if (h) h->hislip = hislip;
+        ov_mutex_unlock(&g_lock);
+    }
+
+    if (hislip) {
+        /* hislip0 on the standard port; an unset device field reads "" */
+        rsrc->isHiSLIP = true;
+        rsrc->port = AP_HISLIP_PORT;
+        rsrc->deviceOff = (ViUInt16)strlen(ov_rsrc_raw(rsrc));
+        *switched = true;
+    }
+    return VI_SUCCESS;
+}
+
+void ov_autoproto_forget(const OvResource *rsrc) {
+    ov_mutex_lock(&g_lock);
+    OvHostEntry *e = ov_host_remove(&g_hosts, ov_rsrc_host(rsrc));
+    ov_mutex_unlock(&g_lock);
+    free(e);
+}
+
+/* ========== Public API ========== */
+
+ViStatus _VI_FUNC ovAutoProtocolEnable(ViBoolean enable) {
+    ov_mutex_lock(&g_lock);
+    g_configured = true;
+    g_enabled = enable != VI_FALSE;
+    ov_mutex_unlock(&g_lock);
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovAutoProtocolForget(ViConstString host) {
+    OvHostEntry *dead;
+    ov_mutex_lock(&g_lock);
+    if (host) {
+        dead = ov_host_remove(&g_hosts, host);
+    } else {
+        dead = g_hosts;
+        g_hosts = NULL;
+    }
+    ov_mutex_unlock(&g_lock);
+    while (dead) {
+        OvHostEntry *next = dead->next;
+        free(dead);
+        dead = next;
+    }
+    return VI_SUCCESS;
+}
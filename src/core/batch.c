@@ -0,0 +1,115 @@
+/*
+ * OpenVISA - Batch operations across sessions  (ovQueryMany, ovOpenMany)
+ *
+ * Each session's write+read runs on a worker from the shared pool, so the
+ * wall time of a fan-out query is about one round trip of the slowest
+ * instrument instead of the sum of all of them.  Every transport blocks in
+ * its own read with the session's own VI_ATTR_TMO_VALUE.  Opening a station
+ * works the same way: each viOpen (name lookup, connects, handshakes) runs
+ * on its own worker.
+ */
+
+#include "session.h"
+#include "thread.h"
+#include "openvisa.h"
+#include <string.h>
+#include <stdlib.h>
+
+typedef struct {
+    const ViSession *sessions;
+    ViConstBuf       cmd;
+    ViUInt32         cmdLen;
+    ViBuf           *bufs;
+    ViUInt32         bufSize;
+    ViUInt32        *retCounts;
+    ViStatus        *statuses;
+} QueryManyCtx;
+
+static void query_one(void *arg, uint32_t i) {
+    QueryManyCtx *c = (QueryManyCtx*)arg;
+    ViUInt32 n = 0;
+    ViStatus st = viWrite(c->sessions[i], (ViBuf)c->cmd, c->cmdLen, &n);
+    n = 0;
+    if (st >= VI_SUCCESS)
+        st = viRead(c->sessions[i], c->bufs[i], c->bufSize, &n);
+    c->retCounts[i] = n;
+    c->statuses[i] = st;
+}
+
+ViStatus _VI_FUNC ovQueryMany(const ViSession sessions[], ViUInt32 count, ViConstString cmd,
+                              ViBuf bufs[], ViUInt32 bufSize,
+                              ViUInt32 retCounts[], ViStatus statuses[])
+{
+    if (!sessions || !cmd || !bufs || !retCounts) return VI_ERROR_INV_OBJECT;
+    if (count == 0) return VI_SUCCESS;
+
+    /* A session may appear only once: two workers on one transport would interleave */
+    for (ViUInt32 i = 0; i < count; i++)
+        for (ViUInt32 j = i + 1; j < count; j++)
+            if (sessions[j] == sessions[i]) return VI_ERROR_INV_SETUP;
+
+    ViStatus local[64];
+    ViStatus *st = statuses;
+    if (!st) {
+        st = count <= 64 ? local : (ViStatus*)malloc(count * sizeof(ViStatus));
+        if (!st) return VI_ERROR_ALLOC;
+    }
+
+    QueryManyCtx ctx = {
+        .sessions = sessions, .cmd = (ViConstBuf)cmd, .cmdLen = (ViUInt32)strlen(cmd),
+        .bufs = bufs, .bufSize = bufSize, .retCounts = retCounts, .statuses = st,
+    };
+    ov_parallel_for(count, query_one, &ctx, count);
+
+    ViStatus result = VI_SUCCESS;
+    for (ViUInt32 i = 0; i < count; i++) {
+        if (st[i] < VI_SUCCESS) { result = st[i]; break; }
+    }
+    if (!statuses && st != local) free(st);
+    return result;
+}
+
+typedef struct {
+    ViSession        rm;
+    const ViConstRsrc *names;
+    ViUInt32         timeout;
+    ViSession       *vis;
+    ViStatus        *statuses;
+} OpenManyCtx;
+
+static void open_one(void *arg, uint32_t i) {
+    OpenManyCtx *c = (OpenManyCtx*)arg;
+    c->vis[i] = VI_NULL;
+    c->statuses[i] = c->names[i] ? viOpen(c->rm, (ViRsrc)c->names[i], VI_NULL, c->timeout, &c->vis[i])
+                                 : VI_ERROR_INV_RSRC_NAME;
+    if (c->statuses[i] < VI_SUCCESS) c->vis[i] = VI_NULL;
+}
+
+ViStatus _VI_FUNC ovOpenMany(ViSession sesn, const ViConstRsrc rsrcNames[], ViUInt32 count,
+                             ViUInt32 openTimeout, ViUInt32 maxParallel,
+                             ViSession vis[], ViStatus statuses[])
+{
+    if (!rsrcNames || !vis) return VI_ERROR_INV_OBJECT;
+    OvSession *rm = ov_session_find(sesn);
+    if (!rm || !rm->isRM) return VI_ERROR_INV_OBJECT;
+    if (count == 0) return VI_SUCCESS;
+
+    ViStatus local[64];
+    ViStatus *st = statuses;
+    if (!st) {
+        st = count <= 64 ? local : (ViStatus*)malloc(count * sizeof(ViStatus));
+        if (!st) return VI_ERROR_ALLOC;
+    }
+
+    OpenManyCtx ctx = {
+        .rm = sesn, .names = rsrcNames, .timeout = openTimeout, .vis = vis, .statuses = st,
+    };
+    ov_parallel_for(count, open_one, &ctx, maxParallel ? maxParallel : count);
+
+    ViStatus result = VI_SUCCESS;
+    for (ViUInt32 i = 0; i < count; i++) {
+        if (st[i] < VI_SUCCESS) { result = st[i]; break; }
+    }
+    if (!statuses && st != local) free(st);
+    return result;
+}
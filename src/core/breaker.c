@@ -0,0 +1,246 @@
+/*
+ * OpenVISA - Per-host circuit breaker for TCPIP opens  (ovBreaker*)
+ *
+ * A powered-off instrument costs every viOpen the full open timeout, and
+ * retry loops multiply that.  The process keeps a table of TCPIP hosts:
+ * each transport open that times out or finds the host unreachable counts
+ * a failure, anything else (a connection, even a refused one) shows the
+ * host is there and clears the count.  After failThreshold failures in a
+ * row the host is down: viOpen of any resource on it fails at once with
+ * VI_ERROR_RSRC_NFOUND.
+ *
+ * A prober thread connects to a down host (the port of its last failed
+ * open) after probeMinMs, doubling the wait after every failed probe up to
+ * probeMaxMs.  A probe that connects, or is refused, marks the host healthy
+ * again.  Off by default, like protocol auto-selection: a host that merely
+ * answers slowly must not start failing opens it used to win.
+ * $OPENVISA_BREAKER ("fails[,minMs[,maxMs]]", fails 0 = off) turns it on
+ * until ovBreakerConfigure is called.
+ */
+
+#include "session.h"
+#include "thread.h"
+#include "hosts.h"
+#include "openvisa.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#define BR_DEFAULT_MIN_MS   500
+#define BR_DEFAULT_MAX_MS   60000
+#define BR_PROBE_TMO_MS     2000
+
+typedef struct BrHost {
+    OvHostEntry e;
+    ViUInt16    port;                   /* probed: port of the last failed open */
+    ViUInt32    failures;               /* consecutive */
+    bool        down;
+    ViUInt32    backoff_ms;
+    uint64_t    next_probe_ns;
+} BrHost;
+
+static OvMutex   g_lock = OV_MUTEX_INIT;
+static OvCond    g_wake;
+static bool      g_prober_started;
+static bool      g_configured;
+static ViUInt32  g_fails;                       /* 0 = off */
+static ViUInt32  g_min_ms = BR_DEFAULT_MIN_MS;
+static ViUInt32  g_max_ms = BR_DEFAULT_MAX_MS;
+static OvHostEntry *g_hosts;                      /* never freed: one per host ever seen */
+
+/* Caller holds g_lock */
+static void br_load_env(void) {
+    const char *env = ov_host_env_once(&g_configured, "OPENVISA_BREAKER");
+    if (!env || !*env) return;
+    char *end;
+    g_fails = (ViUInt32)strtoul(env, &end, 10);
+    if (*end == ',') g_min_ms = (ViUInt32)strtoul(end + 1, &end, 10);
+    if (*end == ',') g_max_ms = (ViUInt32)strtoul(end + 1, &end, 10);
+    if (g_min_ms == 0) g_min_ms = BR_DEFAULT_MIN_MS;
+    if (g_max_ms < g_min_ms) g_max_ms = g_min_ms;
+}
+
+/* Caller holds g_lock */
+static BrHost *br_find(const char *host, bool create) {
+    return (BrHost *)ov_host_find(&g_hosts, host, create ? sizeof(BrHost) : 0);
+}
+
+static bool br_applies(const OvResource *rsrc) {
+    return rsrc->intfType == OV_INTF_TCPIP && ov_rsrc_host(rsrc)[0];
+}
+
+/* ========== Prober ========== */
+
+/* Does anything answer at host:port?  A refused connection counts */
+static bool br_probe(const char *host, ViUInt16 port) {
+    char port_str[8];
+    snprintf(port_str, sizeof(port_str), "%u", (unsigned)port);
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port_str, &hints, &res) != 0) return false;
+
+    bool up = false;
+    for (struct addrinfo *ai = res; ai && !up; ai = ai->ai_next) {
+        OvProbe p;
+        ov_probe_start(&p, ai, 0);
+        if (p.state == OV_PROBE_PENDING) ov_probe_wait(&p, 1, BR_PROBE_TMO_MS);
+        up = p.state == OV_PROBE_OPEN || p.state == OV_PROBE_REFUSED;
+        ov_probe_close(&p);
+    }
+    freeaddrinfo(res);
+    return up;
+}
+
+static void *br_prober(void *arg) {
+    (void)arg;
+    ov_mutex_lock(&g_lock);
+    for (;;) {
+        BrHost *due = NULL;
+        for (BrHost *h = (BrHost *)g_hosts; h; h = (BrHost *)h->e.next)
+            if (h->down && (!due || h->next_probe_ns < due->next_probe_ns)) due = h;
+        if (!due) {
+            ov_cond_wait(&g_wake, &g_lock);
+            continue;
+        }
+        uint64_t now = ov_time_ns();
+        if (due->next_probe_ns > now) {
+            ov_cond_timedwait(&g_wake, &g_lock, (uint32_t)((due->next_probe_ns - now) / 1000000u) + 1);
+            continue;
+        }
+
+        char host[OV_HOST_SIZE];
+        memcpy(host, due->e.host, sizeof(host));
+        ViUInt16 port = due->port;
+        /* Not due again while this probe runs */
+        due->next_probe_ns = UINT64_MAX;
+        ov_mutex_unlock(&g_lock);
+        bool up = br_probe(host, port);
+        ov_mutex_lock(&g_lock);
+
+        if (!due->down) continue;       /* reset or reopened meanwhile */
+        if (up) {
+            due->down = false;
+            due->failures = 0;
+        } else {
+            due->backoff_ms = due->backoff_ms * 2 < g_max_ms ? due->backoff_ms * 2 : g_max_ms;
+            due->next_probe_ns = ov_time_ns() + (uint64_t)due->backoff_ms * 1000000u;
+        }
+    }
+    return NULL;
+}
+
+/* ========== Session hooks ========== */
+
+ViStatus ov_breaker_check(const OvResource *rsrc) {
+    if (!br_applies(rsrc)) return VI_SUCCESS;
+    ov_mutex_lock(&g_lock);
+    br_load_env();
+    BrHost *h = g_fails ? br_find(ov_rsrc_host(rsrc), false) : NULL;
+    bool down = h && h->down;
+    ov_mutex_unlock(&g_lock);
+    return down ? VI_ERROR_RSRC_NFOUND : VI_SUCCESS;
+}
+
+void ov_breaker_report(const OvResource *rsrc, ViStatus status) {
+    if (!br_applies(rsrc)) return;
+    bool failed = status == VI_ERROR_TMO || status == VI_ERROR_RSRC_NFOUND;
+    ov_mutex_lock(&g_lock);
+    br_load_env();
+    BrHost *h = g_fails ? br_find(ov_rsrc_host(rsrc), failed) : NULL;
+    if (!h) {
+        ov_mutex_unlock(&g_lock);
+        return;
+    }
+    if (!failed) {
+        h->failures = 0;
+        h->down = false;
+    } else if (++h->failures >= g_fails && !h->down) {
+        h->down = true;
+        h->port = rsrc->port;
+        h->backoff_ms = g_min_ms;
+        h->next_probe_ns = ov_time_ns() + (uint64_t)g_min_ms * 1000000u;
+        if (!g_prober_started) {
+            OvThread th;
+            ov_cond_init(&g_wake);
+            g_prober_started = ov_thread_create(&th, br_prober, NULL);
+        }
+        ov_cond_signal(&g_wake);
+    } else {
+        h->port = rsrc->port;
+    }
+    ov_mutex_unlock(&g_lock);
+}
+
+ViStatus ov_breaker_get_attr(OvSession *sess, ViAttr attr, void *value) {
+    ov_mutex_lock(&g_lock);
+    br_load_env();
+    ViStatus st = VI_SUCCESS;
+    switch (attr) {
+        case OV_ATTR_HOST_STATE: {
+            BrHost *h = br_applies(&sess->resource) ? br_find(ov_rsrc_host(&sess->resource), false) : NULL;
+            *(ViUInt16 *)value = h && h->down ? OV_HOST_DOWN : OV_HOST_HEALTHY;
+            break;
+        }
+        case OV_ATTR_HOSTS_DOWN: {
+            ViUInt32 n = 0;
+            for (BrHost *h = (BrHost *)g_hosts; h; h = (BrHost *)h->e.next) n += h->down;
+            *(ViUInt32 *)value = n;
+            break;
+        }
+        default:
+            st = VI_ERROR_NSUP_ATTR;
+            break;
+    }
+    ov_mutex_unlock(&g_lock);
+    return st;
+}
+
+/* ========== Public API ========== */
+
+ViStatus _VI_FUNC ovBreakerConfigure(ViUInt32 failThreshold, ViUInt32 probeMinMs, ViUInt32 probeMaxMs) {
+    ov_mutex_lock(&g_lock);
+    g_configured = true;
+    g_fails = failThreshold;
+    g_min_ms = probeMinMs ? probeMinMs : BR_DEFAULT_MIN_MS;
+    g_max_ms = probeMaxMs ? probeMaxMs : BR_DEFAULT_MAX_MS;
+    if (g_max_ms < g_min_ms) g_max_ms = g_min_ms;
+    if (!g_fails) {
+        for (BrHost *h = (BrHost *)g_hosts; h; h = (BrHost *)h->e.next) {
+            h->down = false;
+            h->failures = 0;
+        }
+    }
+    ov_mutex_unlock(&g_lock);
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovBreakerGetState(ViConstString host, ViUInt16 *state, ViUInt32 *failures,
+                                    ViUInt32 *nextProbeMs) {
+    if (!host) return VI_ERROR_INV_OBJECT;
+    ov_mutex_lock(&g_lock);
+    BrHost *h = br_find(host, false);
+    bool down = h && h->down;
+    if (state) *state = down ? OV_HOST_DOWN : OV_HOST_HEALTHY;
+    if (failures) *failures = h ? h->failures : 0;
+    if (nextProbeMs) {
+        uint64_t now = ov_time_ns();
+        *nextProbeMs = !down ? 0 : h->next_probe_ns == UINT64_MAX || h->next_probe_ns <= now
+                     ? 0 : (ViUInt32)((h->next_probe_ns - now + 999999) / 1000000u);
+    }
+    ov_mutex_unlock(&g_lock);
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovBreakerReset(ViConstString host) {
+    ov_mutex_lock(&g_lock);
+    BrHost *match = host ? br_find(host, false) : NULL;
+    for (BrHost *h = (BrHost *)g_hosts; h; h = (BrHost *)h->e.next) {
+        if (host && h != match) continue;
+        h->down = false;
+        h->failures = 0;
+    }
+    ov_mutex_unlock(&g_lock);
+    return VI_SUCCESS;
+}
@@ -0,0 +1,180 @@
+/*
+ * OpenVISA - Connection broker client
+ *
+ * When $OPENVISA_BROKER is set, viOpen first asks the openvisa-broker daemon
+ * (src/broker/openvisa_broker.c) for an already connected transport: the
+ * sockets arrive over a Unix socket as SCM_RIGHTS together with the protocol
+ * state (VXI-11 link ID and XID, HiSLIP session and message ID), so the open
+ * costs one local round trip instead of DNS, portmapper, connect and link
+ * setup.  viClose sends the updated state back and the broker keeps the
+ * connection warm for the next process.  Any failure falls back to a normal
+ * open.  The value of $OPENVISA_BROKER is the broker socket ("1" = default
+ * path, see broker_proto.h).
+ */
+
+#include "session.h"
+#include "../broker/broker_proto.h"
+#include <string.h>
+#include <stdlib.h>
+
+#ifndef OPENVISA_WINDOWS
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <sys/time.h>
+    #include <unistd.h>
+    #include <errno.h>
+    #ifndef MSG_NOSIGNAL
+        #define MSG_NOSIGNAL 0
+    #endif
+    #ifndef MSG_CMSG_CLOEXEC
+        #define MSG_CMSG_CLOEXEC 0
+    #endif
+    #ifndef SOCK_CLOEXEC
+        #define SOCK_CLOEXEC 0
+    #endif
+#endif
+
+#define OVB_REPLY_MARGIN_MS 1000u   /* broker-side bookkeeping on top of the open timeout */
+
+#ifndef OPENVISA_WINDOWS
+
+static bool broker_send(int fd, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p   += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static bool broker_recv(int fd, void *data, size_t len) {
+    uint8_t *p = (uint8_t *)data;
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p   += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+ViStatus ov_broker_checkout(const OvResource *rsrc, ViUInt32 timeout, OvConnState *cs, int *lease) {
+    *lease = -1;
+    if (!getenv("OPENVISA_BROKER")) return VI_ERROR_NSUP_OPER;
+
+    size_t rlen = strlen(ov_rsrc_raw(rsrc));
+    if (rlen == 0 || rlen > OVB_MAX_RSRC) return VI_ERROR_INV_RSRC_NAME;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    ovb_socket_path(addr.sun_path, sizeof(addr.sun_path));
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return VI_ERROR_SYSTEM_ERROR;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return VI_ERROR_RSRC_NFOUND;        /* no broker running */
+    }
+
+    /* The broker may have to open a fresh connection: allow the open timeout */
+    if (timeout != VI_TMO_INFINITE) {
+        uint32_t ms = timeout + OVB_REPLY_MARGIN_MS;
+        struct timeval tv = { .tv_sec = ms / 1000, .tv_usec = (ms % 1000) * 1000 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+
+    OvbHeader req = { .op = OVB_CHECKOUT, .timeout = timeout, .len = (uint32_t)rlen };
+    if (!broker_send(fd, &req, sizeof(req)) || !broker_send(fd, ov_rsrc_raw(rsrc), rlen)) {
+        close(fd);
+        return VI_ERROR_CONN_LOST;
+    }
+
+    /* Header and state in one message; the fds ride on its first byte */
+    struct {
+        OvbHeader   hdr;
+        OvConnState cs;
+    } reply;
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int) * OV_CONN_MAX_FDS)];
+    } ctl;
+    struct iovec iov = { .iov_base = &reply, .iov_len = sizeof(reply) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl.buf;
+    msg.msg_controllen = sizeof(ctl.buf);
+
+    ssize_t n;
+    do {
+        n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+
+    int fds[OV_CONN_MAX_FDS];
+    ViUInt32 nfds = 0;
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+        size_t cnt = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < cnt; i++) {
+            int rfd;
+            memcpy(&rfd, CMSG_DATA(c) + i * sizeof(int), sizeof(int));
+            if (nfds < OV_CONN_MAX_FDS) fds[nfds++] = rfd;
+            else close(rfd);
+        }
+    }
+
+    ViStatus st = VI_SUCCESS;
+    if (n < (ssize_t)sizeof(OvbHeader)) {
+        st = VI_ERROR_CONN_LOST;
+    } else if (reply.hdr.status != VI_SUCCESS) {
+        st = reply.hdr.status;
+    } else if (reply.hdr.len != sizeof(OvConnState) ||
+               (n < (ssize_t)sizeof(reply) &&
+                !broker_recv(fd, (uint8_t *)&reply + n, sizeof(reply) - (size_t)n))) {
+        st = VI_ERROR_CONN_LOST;
+    } else if (reply.cs.nfds != nfds || reply.cs.len > OV_CONN_STATE_SIZE) {
+        st = VI_ERROR_IO;
+    }
+
+    if (st != VI_SUCCESS) {
+        for (ViUInt32 i = 0; i < nfds; i++) close(fds[i]);
+        close(fd);
+        return st;
+    }
+
+    /* Same sockets, renumbered in this process */
+    *cs = reply.cs;
+    memcpy(cs->fds, fds, nfds * sizeof(int));
+    *lease = fd;
+    return VI_SUCCESS;
+}
+
+void ov_broker_checkin(int lease, const OvConnState *cs) {
+    if (cs) {
+        OvbHeader req = { .op = OVB_CHECKIN, .len = sizeof(*cs) }, ack;
+        if (broker_send(lease, &req, sizeof(req)) && broker_send(lease, cs, sizeof(*cs)))
+            broker_recv(lease, &ack, sizeof(ack));
+        for (ViUInt32 i = 0; i < cs->nfds; i++) close(cs->fds[i]);
+    }
+    close(lease);
+}
+
+#else  /* OPENVISA_WINDOWS — no descriptor passing */
+
+ViStatus ov_broker_checkout(const OvResource *rsrc, ViUInt32 timeout, OvConnState *cs, int *lease) {
+    (void)rsrc; (void)timeout; (void)cs;
+    *lease = -1;
+    return VI_ERROR_NSUP_OPER;
+}
+
+void ov_broker_checkin(int lease, const OvConnState *cs) {
+    (void)lease; (void)cs;
+}
+
+#endif
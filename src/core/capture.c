@@ -0,0 +1,722 @@
+/*
+ * OpenVISA - Capture files  (ovCapture* / ovCaptureReader*)
+ *
+ * File layout (host byte order, little-endian on all supported targets):
+ *
+ *   CapFileHdr                                      32 bytes
+ *   { CapChunkHdr, payload[stored_len] } ...        one per sealed chunk
+ *   CapIndexEntry[nchunks]                          written by ovCaptureClose
+ *   { u32 session, u16 len, char name[len] } ...    session directory
+ *   CapTrailer                                      last 40 bytes of the file
+ *
+ * A chunk payload is a run of records { CapRecHdr, data[len] }, stored raw
+ * or LZ4 block-compressed.  Uncompressed records are copied straight into
+ * the mapped file window, so appending costs one memcpy and no syscall;
+ * sealing only writes the chunk header.  Durability is explicit
+ * (ovCaptureFlush), never per record.
+ *
+ * If the trailer is missing (writer crashed) the reader rebuilds the index
+ * by walking chunk headers from the start of the file.
+ */
+
+#include "session.h"
+#include "thread.h"
+#include "lz4.h"
+#include "openvisa.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifdef OPENVISA_WINDOWS
+    #include <io.h>
+#else
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+/* ========== On-disk structures ========== */
+
+#define CAP_FILE_MAGIC      "OVCAP01\n"
+#define CAP_CHUNK_MAGIC     0x4B43564Fu     /* "OVCK" */
+#define CAP_TRAILER_MAGIC   0x5849564Fu     /* "OVIX" */
+#define CAP_VERSION         1u
+
+#define CAP_CHUNK_LZ4       0x0001u
+#define CAP_TRAILER_SORTED  0x0001u         /* chunk time ranges are non-overlapping, ascending */
+
+#define CAP_DEFAULT_CHUNK   (1u << 20)
+#define CAP_WINDOW_SIZE     (64u << 20)     /* mapped write window */
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t chunk_size;
+    uint32_t reserved;
+    uint64_t created_ns;
+} CapFileHdr;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t flags;
+    uint32_t raw_len;
+    uint32_t stored_len;
+    uint64_t t_min;
+    uint64_t t_max;
+    uint64_t sess_mask;         /* bit (session & 63) set for every session present */
+    uint32_t nrec;
+    uint32_t reserved;
+} CapChunkHdr;
+
+typedef struct {
+    uint64_t ts;
+    uint32_t session;
+    uint32_t len;
+} CapRecHdr;
+
+typedef struct {
+    uint64_t offset;            /* of the CapChunkHdr */
+    uint64_t t_min;
+    uint64_t t_max;
+    uint64_t sess_mask;
+    uint64_t nrec;
+} CapIndexEntry;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t flags;
+    uint64_t index_off;
+    uint64_t sess_off;
+    uint32_t nchunks;
+    uint32_t nsess;
+    uint64_t reserved;
+} CapTrailer;
+
+/* ========== Writer ========== */
+
+typedef struct {
+    uint32_t id;
+    char     name[OV_DESC_SIZE];
+} CapSessName;
+
+struct OvCapture {
+    OvMutex        lock;
+#ifdef OPENVISA_WINDOWS
+    FILE          *fp;
+#else
+    int            fd;
+#endif
+    uint32_t       flags;
+    uint32_t       chunk_size;
+
+    /* Mapped window [win_off, win_off + win_len) of the file (POSIX); on
+     * Windows a heap buffer flushed with fwrite when a chunk is sealed. */
+    uint8_t       *win;
+    uint64_t       win_off;
+    size_t         win_len;
+    uint64_t       end;             /* file offset where the open chunk starts */
+
+    /* Open chunk */
+    CapChunkHdr    cur;
+    uint8_t       *rec;             /* record area: in the window, or stage if LZ4 */
+    uint32_t       rec_cap;
+    uint8_t       *stage;           /* LZ4 staging buffer */
+    uint32_t       stage_cap;
+
+    CapIndexEntry *index;
+    uint32_t       nindex, index_cap;
+    bool           sorted;
+
+    CapSessName   *sess;
+    uint32_t       nsess, sess_cap;
+    ViSession      last_vi;         /* most recently noted session */
+};
+
+#ifdef OPENVISA_WINDOWS
+
+static bool cap_window_ensure(OvCapture *cap, size_t need) {
+    if (cap->win && cap->win_len >= need) return true;
+    uint8_t *w = (uint8_t*)realloc(cap->win, need);
+    if (!w) return false;
+    cap->win = w;
+    cap->win_len = need;
+    cap->win_off = cap->end;
+    return true;
+}
+
+static bool cap_window_commit(OvCapture *cap, size_t len) {
+    if (fwrite(cap->win, 1, len, cap->fp) != len) return false;
+    cap->end += len;
+    cap->win_off = cap->end;
+    return true;
+}
+
+static void cap_window_release(OvCapture *cap) {
+    free(cap->win);
+    cap->win = NULL;
+}
+
+static bool cap_file_write(OvCapture *cap, const void *p, size_t len) {
+    if (fwrite(p, 1, len, cap->fp) != len) return false;
+    cap->end += len;
+    return true;
+}
+
+#else
+
+static void cap_window_release(OvCapture *cap) {
+    if (cap->win) munmap(cap->win, cap->win_len);
+    cap->win = NULL;
+}
+
+/* Make [end, end + need) writable through the mapping */
+static bool cap_window_ensure(OvCapture *cap, size_t need) {
+    if (cap->win && cap->end + need <= cap->win_off + cap->win_len) return true;
+
+    cap_window_release(cap);
+    long page = sysconf(_SC_PAGESIZE);
+    uint64_t off = cap->end - (cap->end % (uint64_t)page);
+    size_t len = (size_t)(cap->end - off) + need;
+    if (len < CAP_WINDOW_SIZE) len = CAP_WINDOW_SIZE;
+
+    if (ftruncate(cap->fd, (off_t)(off + len)) != 0) return false;
+    void *w = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, cap->fd, (off_t)off);
+    if (w == MAP_FAILED) return false;
+    cap->win = (uint8_t*)w;
+    cap->win_off = off;
+    cap->win_len = len;
+    return true;
+}
+
+static bool cap_window_commit(OvCapture *cap, size_t len) {
+    cap->end += len;
+    return true;
+}
+
+static bool cap_file_write(OvCapture *cap, const void *p, size_t len) {
+    const uint8_t *b = (const uint8_t*)p;
+    while (len > 0) {
+        ssize_t n = pwrite(cap->fd, b, len, (off_t)cap->end);
+        if (n <= 0) return false;
+        b += n;
+        len -= (size_t)n;
+        cap->end += (uint64_t)n;
+    }
+    return true;
+}
+
+#endif
+
+static uint8_t *cap_window_at(OvCapture *cap, uint64_t off) {
+    return cap->win + (off - cap->win_off);
+}
+
+/* Prepare the record area for a new chunk able to hold at least min_rec bytes */
+static bool cap_chunk_begin(OvCapture *cap, uint32_t min_rec) {
+    uint32_t rec_cap = min_rec > cap->chunk_size ? min_rec : cap->chunk_size;
+    memset(&cap->cur, 0, sizeof(cap->cur));
+    cap->cur.magic = CAP_CHUNK_MAGIC;
+    cap->cur.t_min = UINT64_MAX;
+
+    if (cap->flags & OV_CAPTURE_LZ4) {
+        if (cap->stage_cap < rec_cap) {
+            uint8_t *s = (uint8_t*)realloc(cap->stage, rec_cap);
+            if (!s) return false;
+            cap->stage = s;
+            cap->stage_cap = rec_cap;
+        }
+        cap->rec = cap->stage;
+    } else {
+        if (!cap_window_ensure(cap, sizeof(CapChunkHdr) + rec_cap)) return false;
+        cap->rec = cap_window_at(cap, cap->end) + sizeof(CapChunkHdr);
+    }
+    cap->rec_cap = rec_cap;
+    return true;
+}
+
+static bool cap_chunk_seal(OvCapture *cap) {
+    CapChunkHdr *h = &cap->cur;
+    if (h->nrec == 0) return true;
+
+    h->stored_len = h->raw_len;
+    if (cap->flags & OV_CAPTURE_LZ4) {
+        size_t bound = OV_LZ4_BOUND((size_t)h->raw_len);
+        if (!cap_window_ensure(cap, sizeof(CapChunkHdr) + bound)) return false;
+        uint8_t *dst = cap_window_at(cap, cap->end) + sizeof(CapChunkHdr);
+        size_t z = ov_lz4_compress(cap->stage, h->raw_len, dst, bound);
+        if (z > 0 && z < h->raw_len) {
+            h->flags |= CAP_CHUNK_LZ4;
+            h->stored_len = (uint32_t)z;
+        } else {
+            memcpy(dst, cap->stage, h->raw_len);    /* incompressible */
+        }
+    }
+    memcpy(cap_window_at(cap, cap->end), h, sizeof(*h));
+
+    if (cap->nindex == cap->index_cap) {
+        uint32_t nc = cap->index_cap ? cap->index_cap * 2 : 256;
+        CapIndexEntry *ni = (CapIndexEntry*)realloc(cap->index, nc * sizeof(*ni));
+        if (!ni) return false;
+        cap->index = ni;
+        cap->index_cap = nc;
+    }
+    if (cap->nindex > 0 && h->t_min < cap->index[cap->nindex - 1].t_max)
+        cap->sorted = false;
+    CapIndexEntry *e = &cap->index[cap->nindex++];
+    e->offset = cap->end;
+    e->t_min = h->t_min;
+    e->t_max = h->t_max;
+    e->sess_mask = h->sess_mask;
+    e->nrec = h->nrec;
+
+    if (!cap_window_commit(cap, sizeof(CapChunkHdr) + h->stored_len)) return false;
+    h->nrec = 0;
+    h->raw_len = 0;
+    cap->rec = NULL;
+    return true;
+}
+
+/* Remember the resource string of each session for the footer directory */
+static void cap_note_session(OvCapture *cap, ViSession vi) {
+    cap->last_vi = vi;
+    for (uint32_t i = 0; i < cap->nsess; i++)
+        if (cap->sess[i].id == vi) return;
+    if (cap->nsess == cap->sess_cap) {
+        uint32_t nc = cap->sess_cap ? cap->sess_cap * 2 : 16;
+        CapSessName *ns = (CapSessName*)realloc(cap->sess, nc * sizeof(*ns));
+        if (!ns) return;
+        cap->sess = ns;
+        cap->sess_cap = nc;
+    }
+    CapSessName *s = &cap->sess[cap->nsess++];
+    s->id = vi;
+    s->name[0] = '\0';
+    OvSession *os = ov_session_find(vi);
+    if (os) {
+        strncpy(s->name, ov_rsrc_raw(&os->resource), sizeof(s->name) - 1);
+        s->name[sizeof(s->name) - 1] = '\0';
+    }
+}
+
+static void cap_free(OvCapture *cap) {
+    cap_window_release(cap);
+#ifdef OPENVISA_WINDOWS
+    if (cap->fp) fclose(cap->fp);
+#else
+    if (cap->fd >= 0) close(cap->fd);
+#endif
+    free(cap->stage);
+    free(cap->index);
+    free(cap->sess);
+    ov_mutex_destroy(&cap->lock);
+    free(cap);
+}
+
+ViStatus _VI_FUNC ovCaptureCreate(ViConstString path, ViUInt32 flags,
+                                  ViUInt32 chunkSize, OvCapture **cap)
+{
+    if (!path || !cap) return VI_ERROR_FILE_ACCESS;
+    *cap = NULL;
+
+    OvCapture *c = (OvCapture*)calloc(1, sizeof(OvCapture));
+    if (!c) return VI_ERROR_ALLOC;
+    ov_mutex_init(&c->lock);
+    c->flags = flags;
+    c->chunk_size = chunkSize ? chunkSize : CAP_DEFAULT_CHUNK;
+    c->sorted = true;
+#ifndef OPENVISA_WINDOWS
+    c->fd = -1;
+#endif
+
+#ifdef OPENVISA_WINDOWS
+    c->fp = fopen(path, "wb");
+    if (!c->fp) { cap_free(c); return VI_ERROR_FILE_ACCESS; }
+#else
+    c->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (c->fd < 0) { cap_free(c); return VI_ERROR_FILE_ACCESS; }
+#endif
+
+    CapFileHdr fh;
+    memset(&fh, 0, sizeof(fh));
+    memcpy(fh.magic, CAP_FILE_MAGIC, 8);
+    fh.version = CAP_VERSION;
+    fh.flags = flags;
+    fh.chunk_size = c->chunk_size;
+    fh.created_ns = ov_wallclock_ns();
+    if (!cap_file_write(c, &fh, sizeof(fh))) {
+        cap_free(c);
+        return VI_ERROR_FILE_IO;
+    }
+
+    *cap = c;
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovCaptureAppend(OvCapture *cap, ViSession vi, ViUInt64 timestampNs,
+                                  ViConstBuf data, ViUInt32 len)
+{
+    if (!cap || (!data && len)) return VI_ERROR_INV_OBJECT;
+    if (len > UINT32_MAX - sizeof(CapRecHdr)) return VI_ERROR_INV_SIZE;
+    if (timestampNs == 0) timestampNs = ov_wallclock_ns();
+    uint32_t need = (uint32_t)sizeof(CapRecHdr) + len;
+
+    ov_mutex_lock(&cap->lock);
+
+    if (cap->rec && cap->cur.raw_len + need > cap->rec_cap && !cap_chunk_seal(cap)) {
+        ov_mutex_unlock(&cap->lock);
+        return VI_ERROR_FILE_IO;
+    }
+    if (!cap->rec && !cap_chunk_begin(cap, need)) {
+        ov_mutex_unlock(&cap->lock);
+        return VI_ERROR_FILE_IO;
+    }
+
+    CapRecHdr rh = { .ts = timestampNs, .session = vi, .len = len };
+    uint8_t *dst = cap->rec + cap->cur.raw_len;
+    memcpy(dst, &rh, sizeof(rh));
+    if (len) memcpy(dst + sizeof(rh), data, len);
+
+    CapChunkHdr *h = &cap->cur;
+    h->raw_len += need;
+    h->nrec++;
+    if (timestampNs < h->t_min) h->t_min = timestampNs;
+    if (timestampNs > h->t_max) h->t_max = timestampNs;
+    h->sess_mask |= 1ull << (vi & 63);
+    if (vi != cap->last_vi || cap->nsess == 0)
+        cap_note_session(cap, vi);
+
+    ov_mutex_unlock(&cap->lock);
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovCaptureRead(OvCapture *cap, ViSession vi, ViBuf buf,
+                                ViUInt32 count, ViUInt32 *retCount)
+{
+    ViUInt32 n = 0;
+    ViStatus st = viRead(vi, buf, count, &n);
+    if (retCount) *retCount = n;
+    if (st < VI_SUCCESS) return st;
+
+    ViStatus cst = ovCaptureAppend(cap, vi, 0, buf, n);
+    return cst < VI_SUCCESS ? cst : st;
+}
+
+ViStatus _VI_FUNC ovCaptureFlush(OvCapture *cap) {
+    if (!cap) return VI_ERROR_INV_OBJECT;
+    ov_mutex_lock(&cap->lock);
+    bool ok = cap_chunk_seal(cap);
+#ifdef OPENVISA_WINDOWS
+    ok = ok && fflush(cap->fp) == 0;
+#else
+    if (ok && cap->win) ok = msync(cap->win, cap->win_len, MS_SYNC) == 0;
+#endif
+    ov_mutex_unlock(&cap->lock);
+    return ok ? VI_SUCCESS : VI_ERROR_FILE_IO;
+}
+
+ViStatus _VI_FUNC ovCaptureClose(OvCapture *cap) {
+    if (!cap) return VI_ERROR_INV_OBJECT;
+    bool ok = cap_chunk_seal(cap);
+
+    /* Footer goes through plain writes once the window is gone */
+    cap_window_release(cap);
+#ifndef OPENVISA_WINDOWS
+    if (cap->fd >= 0 && ftruncate(cap->fd, (off_t)cap->end) != 0) ok = false;
+#endif
+
+    CapTrailer tr;
+    memset(&tr, 0, sizeof(tr));
+    tr.magic = CAP_TRAILER_MAGIC;
+    tr.flags = cap->sorted ? CAP_TRAILER_SORTED : 0;
+    tr.index_off = cap->end;
+    tr.nchunks = cap->nindex;
+    ok = ok && cap_file_write(cap, cap->index, (size_t)cap->nindex * sizeof(CapIndexEntry));
+    tr.sess_off = cap->end;
+    tr.nsess = cap->nsess;
+    for (uint32_t i = 0; ok && i < cap->nsess; i++) {
+        uint16_t nl = (uint16_t)strlen(cap->sess[i].name);
+        ok = cap_file_write(cap, &cap->sess[i].id, 4) &&
+             cap_file_write(cap, &nl, 2) &&
+             cap_file_write(cap, cap->sess[i].name, nl);
+    }
+    ok = ok && cap_file_write(cap, &tr, sizeof(tr));
+
+#ifdef OPENVISA_WINDOWS
+    if (fclose(cap->fp) != 0) ok = false;
+    cap->fp = NULL;
+#else
+    if (close(cap->fd) != 0) ok = false;
+    cap->fd = -1;
+#endif
+    cap_free(cap);
+    return ok ? VI_SUCCESS : VI_ERROR_FILE_IO;
+}
+
+/* ========== Reader ========== */
+
+struct OvCaptureReader {
+#ifdef OPENVISA_WINDOWS
+    FILE          *fp;
+    uint8_t       *io;              /* chunk read buffer */
+    size_t         io_cap;
+#endif
+    const uint8_t *map;             /* whole file (POSIX) */
+    uint64_t       size;
+    uint64_t       data_end;        /* end of chunk area */
+
+    CapIndexEntry *index;
+    uint32_t       nindex;
+    bool           sorted;
+
+    CapSessName   *sess;
+    uint32_t       nsess;
+
+    uint8_t       *raw;             /* decompression buffer */
+    uint32_t       raw_cap;
+};
+
+/* Bytes [off, off + len) of the file, or NULL if out of range */
+static const uint8_t *cap_reader_at(OvCaptureReader *r, uint64_t off, size_t len) {
+    if (off > r->size || len > r->size - off) return NULL;
+#ifdef OPENVISA_WINDOWS
+    if (r->io_cap < len) {
+        uint8_t *b = (uint8_t*)realloc(r->io, len);
+        if (!b) return NULL;
+        r->io = b;
+        r->io_cap = len;
+    }
+    if (_fseeki64(r->fp, (__int64)off, SEEK_SET) != 0 || fread(r->io, 1, len, r->fp) != len)
+        return NULL;
+    return r->io;
+#else
+    return r->map + off;
+#endif
+}
+
+/* Rebuild the index from chunk headers (no trailer: writer did not close) */
+static bool cap_reader_walk(OvCaptureReader *r) {
+    uint64_t off = sizeof(CapFileHdr);
+    uint32_t cap_n = 0;
+    r->sorted = true;
+    for (;;) {
+        CapChunkHdr h;
+        const uint8_t *p = cap_reader_at(r, off, sizeof(h));
+        if (!p) break;
+        memcpy(&h, p, sizeof(h));
+        if (h.magic != CAP_CHUNK_MAGIC || h.nrec == 0 ||
+            !cap_reader_at(r, off + sizeof(h), h.stored_len)) break;
+        if (r->nindex == cap_n) {
+            cap_n = cap_n ? cap_n * 2 : 256;
+            CapIndexEntry *ni = (CapIndexEntry*)realloc(r->index, cap_n * sizeof(*ni));
+            if (!ni) return false;
+            r->index = ni;
+        }
+        if (r->nindex > 0 && h.t_min < r->index[r->nindex - 1].t_max) r->sorted = false;
+        CapIndexEntry *e = &r->index[r->nindex++];
+        e->offset = off;
+        e->t_min = h.t_min;
+        e->t_max = h.t_max;
+        e->sess_mask = h.sess_mask;
+        e->nrec = h.nrec;
+        off += sizeof(h) + h.stored_len;
+    }
+    r->data_end = off;
+    return true;
+}
+
+static bool cap_reader_load_footer(OvCaptureReader *r) {
+    if (r->size < sizeof(CapFileHdr) + sizeof(CapTrailer)) return false;
+    CapTrailer tr;
+    const uint8_t *p = cap_reader_at(r, r->size - sizeof(tr), sizeof(tr));
+    if (!p) return false;
+    memcpy(&tr, p, sizeof(tr));
+    if (tr.magic != CAP_TRAILER_MAGIC || tr.index_off > tr.sess_off ||
+        tr.sess_off > r->size - sizeof(tr) ||
+        (tr.sess_off - tr.index_off) != (uint64_t)tr.nchunks * sizeof(CapIndexEntry))
+        return false;
+
+    p = cap_reader_at(r, tr.index_off, (size_t)(tr.sess_off - tr.index_off));
+    if (!p) return false;
+    r->index = (CapIndexEntry*)malloc((size_t)tr.nchunks * sizeof(CapIndexEntry) + 1);
+    if (!r->index) return false;
+    memcpy(r->index, p, (size_t)tr.nchunks * sizeof(CapIndexEntry));
+    r->nindex = tr.nchunks;
+    r->sorted = (tr.flags & CAP_TRAILER_SORTED) != 0;
+    r->data_end = tr.index_off;
+
+    size_t dir_len = (size_t)(r->size - sizeof(tr) - tr.sess_off);
+    p = cap_reader_at(r, tr.sess_off, dir_len);
+    r->sess = (CapSessName*)calloc(tr.nsess + 1, sizeof(CapSessName));
+    if (!p || !r->sess) return false;
+    /* p may alias the reader's I/O buffer on Windows: copy before any other read */
+    size_t q = 0;
+    for (uint32_t i = 0; i < tr.nsess && q + 6 <= dir_len; i++) {
+        uint16_t nl;
+        memcpy(&r->sess[i].id, p + q, 4);
+        memcpy(&nl, p + q + 4, 2);
+        q += 6;
+        if (q + nl > dir_len || nl >= OV_DESC_SIZE) break;
+        memcpy(r->sess[i].name, p + q, nl);
+        q += nl;
+        r->nsess = i + 1;
+    }
+    return true;
+}
+
+ViStatus _VI_FUNC ovCaptureOpenReader(ViConstString path, OvCaptureReader **reader) {
+    if (!path || !reader) return VI_ERROR_FILE_ACCESS;
+    *reader = NULL;
+
+    OvCaptureReader *r = (OvCaptureReader*)calloc(1, sizeof(OvCaptureReader));
+    if (!r) return VI_ERROR_ALLOC;
+
+#ifdef OPENVISA_WINDOWS
+    r->fp = fopen(path, "rb");
+    if (!r->fp) { free(r); return VI_ERROR_FILE_ACCESS; }
+    _fseeki64(r->fp, 0, SEEK_END);
+    r->size = (uint64_t)_ftelli64(r->fp);
+#else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { free(r); return VI_ERROR_FILE_ACCESS; }
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || sb.st_size < (off_t)sizeof(CapFileHdr)) {
+        close(fd);
+        free(r);
+        return VI_ERROR_FILE_IO;
+    }
+    r->size = (uint64_t)sb.st_size;
+    void *m = mmap(NULL, (size_t)r->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) { free(r); return VI_ERROR_FILE_IO; }
+    r->map = (const uint8_t*)m;
+#endif
+
+    const uint8_t *p = cap_reader_at(r, 0, sizeof(CapFileHdr));
+    bool ok = p && memcmp(p, CAP_FILE_MAGIC, 8) == 0;
+    if (ok && !cap_reader_load_footer(r)) {
+        /* No usable footer: discard any partial load and walk the chunks */
+        free(r->index);
+        free(r->sess);
+        r->index = NULL;
+        r->sess = NULL;
+        r->nindex = r->nsess = 0;
+        ok = cap_reader_walk(r);
+    }
+    if (!ok) {
+        ovCaptureCloseReader(r);
+        return VI_ERROR_FILE_IO;
+    }
+
+    *reader = r;
+    return VI_SUCCESS;
+}
+
+/* Raw record bytes of chunk e (decompressed if needed) */
+static const uint8_t *cap_reader_chunk(OvCaptureReader *r, const CapIndexEntry *e, uint32_t *raw_len) {
+    CapChunkHdr h;
+    const uint8_t *p = cap_reader_at(r, e->offset, sizeof(h));
+    if (!p) return NULL;
+    memcpy(&h, p, sizeof(h));
+    if (h.magic != CAP_CHUNK_MAGIC) return NULL;
+    p = cap_reader_at(r, e->offset + sizeof(h), h.stored_len);
+    if (!p) return NULL;
+    *raw_len = h.raw_len;
+    if (!(h.flags & CAP_CHUNK_LZ4)) return p;
+
+    if (r->raw_cap < h.raw_len) {
+        uint8_t *b = (uint8_t*)realloc(r->raw, h.raw_len);
+        if (!b) return NULL;
+        r->raw = b;
+        r->raw_cap = h.raw_len;
+    }
+    return ov_lz4_decompress(p, h.stored_len, r->raw, h.raw_len) ? r->raw : NULL;
+}
+
+ViStatus _VI_FUNC ovCaptureScan(OvCaptureReader *r, ViUInt64 tStartNs, ViUInt64 tEndNs,
+                                ViSession vi, OvCaptureHandler handler, ViAddr userHandle)
+{
+    if (!r || !handler) return VI_ERROR_INV_OBJECT;
+
+    uint32_t first = 0;
+    if (r->sorted) {
+        /* First chunk whose range can reach tStartNs */
+        uint32_t lo = 0, hi = r->nindex;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (r->index[mid].t_max < tStartNs) lo = mid + 1; else hi = mid;
+        }
+        first = lo;
+    }
+    uint64_t want_mask = (vi == VI_NULL) ? ~0ull : (1ull << (vi & 63));
+
+    for (uint32_t i = first; i < r->nindex; i++) {
+        const CapIndexEntry *e = &r->index[i];
+        if (e->t_min > tEndNs) {
+            if (r->sorted) break;
+            continue;
+        }
+        if (e->t_max < tStartNs || !(e->sess_mask & want_mask)) continue;
+
+        uint32_t raw_len = 0;
+        const uint8_t *p = cap_reader_chunk(r, e, &raw_len);
+        if (!p) return VI_ERROR_FILE_IO;
+
+        for (uint32_t q = 0; q + sizeof(CapRecHdr) <= raw_len; ) {
+            CapRecHdr rh;
+            memcpy(&rh, p + q, sizeof(rh));
+            q += (uint32_t)sizeof(rh);
+            if (rh.len > raw_len - q) return VI_ERROR_FILE_IO;
+            if (rh.ts >= tStartNs && rh.ts <= tEndNs && (vi == VI_NULL || rh.session == vi)) {
+                ViStatus st = handler(rh.ts, rh.session, p + q, rh.len, userHandle);
+                if (st != VI_SUCCESS) return st;
+            }
+            q += rh.len;
+        }
+    }
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovCaptureGetRange(OvCaptureReader *r, ViUInt64 *tFirstNs,
+                                    ViUInt64 *tLastNs, ViUInt64 *records)
+{
+    if (!r) return VI_ERROR_INV_OBJECT;
+    uint64_t lo = UINT64_MAX, hi = 0, n = 0;
+    for (uint32_t i = 0; i < r->nindex; i++) {
+        if (r->index[i].t_min < lo) lo = r->index[i].t_min;
+        if (r->index[i].t_max > hi) hi = r->index[i].t_max;
+        n += r->index[i].nrec;
+    }
+    if (tFirstNs) *tFirstNs = n ? lo : 0;
+    if (tLastNs)  *tLastNs  = hi;
+    if (records)  *records  = n;
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovCaptureSessionName(OvCaptureReader *r, ViSession vi, ViChar name[]) {
+    if (!r || !name) return VI_ERROR_INV_OBJECT;
+    for (uint32_t i = 0; i < r->nsess; i++) {
+        if (r->sess[i].id == vi) {
+            strcpy(name, r->sess[i].name);
+            return VI_SUCCESS;
+        }
+    }
+    return VI_ERROR_RSRC_NFOUND;
+}
+
+ViStatus _VI_FUNC ovCaptureCloseReader(OvCaptureReader *r) {
+    if (!r) return VI_ERROR_INV_OBJECT;
+#ifdef OPENVISA_WINDOWS
+    if (r->fp) fclose(r->fp);
+    free(r->io);
+#else
+    if (r->map) munmap((void*)r->map, (size_t)r->size);
+#endif
+    free(r->index);
+    free(r->sess);
+    free(r->raw);
+    free(r);
+    return VI_SUCCESS;
+}
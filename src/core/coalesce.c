@@ -0,0 +1,231 @@
+/*
+ * OpenVISA - SCPI write coalescing  (ovCoalesce*)
+ *
+ * Opt-in per session.  Consecutive command writes (no '?') are held and
+ * joined into one program message, "CMD1;:CMD2;:CMD3\n", so a burst of
+ * settings costs one transport transaction instead of one each.  Every
+ * joined message after the first gets a leading ':' (unless it starts with
+ * ':' or is a common command, '*...') because after ';' an instrument
+ * resolves a header relative to the previous command's subsystem, while
+ * each message was written to start at the root.
+ *
+ * The held message goes out when it would outgrow maxBytes, when windowMs
+ * has passed since the first held command (a per-session timer thread), and
+ * before anything else reaches the transport: a query or a message with a
+ * binary block (both sent on their own), viRead, viReadSTB, viClear,
+ * viAssertTrigger, trigger groups, file transfers and viClose (the callers
+ * use ov_session_sync).  A held write reports success at once; should the
+ * deferred write fail, the next operation on the session returns the error.
+ */
+
+#include "session.h"
+#include "scpi.h"
+#include "thread.h"
+#include "openvisa.h"
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#define CO_DEFAULT_WINDOW_MS    5
+#define CO_DEFAULT_MAX_BYTES    1024u
+#define CO_MAX_TRAILER          4
+
+struct OvCoalescer {
+    OvSession  *sess;
+    OvMutex     lock;
+    OvCond      cond;
+    OvThread    timer;
+    bool        stop;
+
+    ViUInt32    window_ms;
+    ViUInt32    max_bytes;
+    ViByte     *buf;                /* max_bytes + CO_MAX_TRAILER */
+    ViUInt32    len;                /* joined message, without trailer */
+    ViByte      trailer[CO_MAX_TRAILER];
+    ViUInt32    trailer_len;
+    uint64_t    deadline_ns;        /* flush time of the held message */
+    ViStatus    deferred;           /* failure of a timer flush, reported next */
+};
+
+static ViStatus co_write_all(OvTransport *tr, ViBuf buf, ViUInt32 count) {
+    ViUInt32 done = 0;
+    while (done < count) {
+        ViUInt32 n = 0;
+        ViStatus st = tr->write(tr, buf + done, count - done, &n);
+        if (st < VI_SUCCESS) return st;
+        if (n == 0) return VI_ERROR_IO;
+        done += n;
+    }
+    return VI_SUCCESS;
+}
+
+/* Send the held message; lock held */
+static ViStatus co_flush_locked(OvCoalescer *co) {
+    ViStatus st = co->deferred;
+    co->deferred = VI_SUCCESS;
+    if (co->len == 0) return st;
+
+    memcpy(co->buf + co->len, co->trailer, co->trailer_len);
+    ViStatus wst = co_write_all(co->sess->transport, co->buf, co->len + co->trailer_len);
+    co->len = 0;
+    return st < VI_SUCCESS ? st : wst;
+}
+
+static void *co_timer_main(void *arg) {
+    OvCoalescer *co = (OvCoalescer *)arg;
+    ov_mutex_lock(&co->lock);
+    while (!co->stop) {
+        if (co->len == 0) {
+            ov_cond_wait(&co->cond, &co->lock);
+            continue;
+        }
+        uint64_t now = ov_time_ns();
+        if (now < co->deadline_ns) {
+            uint32_t ms = (uint32_t)((co->deadline_ns - now + 999999) / 1000000);
+            ov_cond_timedwait(&co->cond, &co->lock, ms);
+            continue;
+        }
+        ViStatus st = co_flush_locked(co);
+        if (st < VI_SUCCESS) co->deferred = st;
+    }
+    ov_mutex_unlock(&co->lock);
+    return NULL;
+}
+
+/* ========== Session hooks ========== */
+
+ViStatus ov_coalesce_write(OvSession *sess, ViBuf buf, ViUInt32 count, ViUInt32 *retCount) {
+    OvCoalescer *co = sess->coalesce;
+
+    /* Message body and terminator ("\n", "\r\n", or none when END ends it) */
+    ViUInt32 len = count;
+    while (len && isspace(buf[len - 1]) && count - len < CO_MAX_TRAILER) len--;
+    ViUInt32 lead = 0;
+    while (lead < len && isspace(buf[lead])) lead++;
+
+    ov_mutex_lock(&co->lock);
+    ViStatus st;
+    if (lead == len || ov_scpi_is_query(buf, len) || ov_scpi_has_block(buf, len) ||
+        len - lead > co->max_bytes) {
+        st = co_flush_locked(co);
+        if (st >= VI_SUCCESS) st = co->sess->transport->write(co->sess->transport, buf, count, retCount);
+        ov_mutex_unlock(&co->lock);
+        return st;
+    }
+
+    const ViByte *body = buf + lead;
+    ViUInt32 blen = len - lead;
+    bool root = body[0] != ':' && body[0] != '*';
+    ViUInt32 need = co->len ? blen + 1 + root : blen;
+    if (co->len + need > co->max_bytes || co->trailer_len != count - len ||
+        memcmp(co->trailer, buf + len, count - len) != 0) {
+        st = co_flush_locked(co);
+        if (st < VI_SUCCESS) {
+            ov_mutex_unlock(&co->lock);
+            return st;
+        }
+    }
+
+    if (co->len == 0) {
+        memcpy(co->buf, body, blen);
+        co->len = blen;
+        co->trailer_len = count - len;
+        memcpy(co->trailer, buf + len, co->trailer_len);
+        co->deadline_ns = ov_time_ns() + (uint64_t)co->window_ms * 1000000u;
+        ov_cond_signal(&co->cond);
+    } else {
+        co->buf[co->len++] = ';';
+        if (root) co->buf[co->len++] = ':';
+        memcpy(co->buf + co->len, body, blen);
+        co->len += blen;
+    }
+    st = co->deferred;
+    co->deferred = VI_SUCCESS;
+    ov_mutex_unlock(&co->lock);
+    if (retCount) *retCount = st < VI_SUCCESS ? 0 : count;
+    return st;
+}
+
+ViStatus ov_coalesce_flush(OvSession *sess) {
+    OvCoalescer *co = sess->coalesce;
+    ov_mutex_lock(&co->lock);
+    ViStatus st = co_flush_locked(co);
+    ov_mutex_unlock(&co->lock);
+    return st;
+}
+
+void ov_coalesce_free(OvSession *sess) {
+    OvCoalescer *co = sess->coalesce;
+    if (!co) return;
+    ov_mutex_lock(&co->lock);
+    co_flush_locked(co);
+    co->stop = true;
+    ov_cond_signal(&co->cond);
+    ov_mutex_unlock(&co->lock);
+    ov_thread_join(co->timer);
+    ov_cond_destroy(&co->cond);
+    ov_mutex_destroy(&co->lock);
+    free(co->buf);
+    free(co);
+    sess->coalesce = NULL;
+}
+
+/* ========== Public API ========== */
+
+ViStatus _VI_FUNC ovCoalesceEnable(ViSession vi, ViUInt32 windowMs, ViUInt32 maxBytes) {
+    OvSession *sess = ov_session_find(vi);
+    if (!sess || sess->isRM || !sess->transport || !sess->transport->write)
+        return VI_ERROR_INV_OBJECT;
+    if (!windowMs) windowMs = CO_DEFAULT_WINDOW_MS;
+    if (!maxBytes) maxBytes = CO_DEFAULT_MAX_BYTES;
+
+    OvCoalescer *co = sess->coalesce;
+    if (co) {
+        /* Retune: send what is held under the old limits first */
+        ov_mutex_lock(&co->lock);
+        ViStatus st = co_flush_locked(co);
+        ViByte *nbuf = (ViByte *)realloc(co->buf, maxBytes + CO_MAX_TRAILER);
+        if (nbuf) {
+            co->buf = nbuf;
+            co->max_bytes = maxBytes;
+            co->window_ms = windowMs;
+        }
+        ov_mutex_unlock(&co->lock);
+        if (!nbuf) return VI_ERROR_ALLOC;
+        return st;
+    }
+
+    co = (OvCoalescer *)calloc(1, sizeof(OvCoalescer));
+    if (!co) return VI_ERROR_ALLOC;
+    co->buf = (ViByte *)malloc(maxBytes + CO_MAX_TRAILER);
+    if (!co->buf) { free(co); return VI_ERROR_ALLOC; }
+    co->sess = sess;
+    co->window_ms = windowMs;
+    co->max_bytes = maxBytes;
+    ov_mutex_init(&co->lock);
+    ov_cond_init(&co->cond);
+    if (!ov_thread_create(&co->timer, co_timer_main, co)) {
+        ov_cond_destroy(&co->cond);
+        ov_mutex_destroy(&co->lock);
+        free(co->buf);
+        free(co);
+        return VI_ERROR_SYSTEM_ERROR;
+    }
+    sess->coalesce = co;
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovCoalesceDisable(ViSession vi) {
+    OvSession *sess = ov_session_find(vi);
+    if (!sess || sess->isRM) return VI_ERROR_INV_OBJECT;
+    if (!sess->coalesce) return VI_SUCCESS;
+    ViStatus st = ov_coalesce_flush(sess);
+    ov_coalesce_free(sess);
+    return st;
+}
+
+ViStatus _VI_FUNC ovCoalesceFlush(ViSession vi) {
+    OvSession *sess = ov_session_find(vi);
+    if (!sess || sess->isRM) return VI_ERROR_INV_OBJECT;
+    return ov_session_sync(sess);
+}
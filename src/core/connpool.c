@@ -0,0 +1,306 @@
+/*
+ * OpenVISA - In-process connection reuse pool
+ *
+ * Opt-in (ovPoolConfigure or $OPENVISA_POOL_IDLE_MS).  viClose of a raw
+ * socket or HiSLIP session detaches the live connection (the same hand-off
+ * the broker uses) and parks it under the canonical resource name; a viOpen
+ * of that resource attaches the most recently parked one again, skipping
+ * the TCP connect and the HiSLIP Initialize handshake.  Before parking,
+ * unread input is drained (raw socket) or device-cleared (HiSLIP); a parked
+ * connection that turns readable (peer closed, unsolicited data) fails the
+ * health check and is closed instead of reused.  A reaper thread closes
+ * connections idle longer than the configured time, so an instrument that
+ * accepts a single connection is not held hostage.
+ */
+
+#include "session.h"
+#include "thread.h"
+#include "openvisa.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#ifndef OPENVISA_WINDOWS
+    #include <sys/socket.h>
+    #include <poll.h>
+    #include <unistd.h>
+    #include <errno.h>
+#endif
+
+#define POOL_DEFAULT_MAX    4       /* parked connections per resource */
+#define POOL_KEY_SIZE       300
+
+typedef struct PoolEntry {
+    struct PoolEntry *next;
+    char        key[POOL_KEY_SIZE];
+    OvResource  rsrc;
+    OvConnState cs;
+    uint64_t    parked_ns;
+} PoolEntry;
+
+static OvMutex     g_lock = OV_MUTEX_INIT;
+static OvCond      g_wake;
+static bool        g_reaper_started;
+static bool        g_configured;        /* $OPENVISA_POOL_IDLE_MS consulted */
+static ViUInt32    g_idle_ms;           /* 0 = pool disabled */
+static ViUInt32    g_max_per_rsrc = POOL_DEFAULT_MAX;
+static PoolEntry  *g_entries;           /* most recently parked first */
+static OvPoolStats g_stats;
+
+/* Caller holds g_lock */
+static void pool_load_env(void) {
+    if (g_configured) return;
+    g_configured = true;
+    const char *env = getenv("OPENVISA_POOL_IDLE_MS");
+    if (env && *env) g_idle_ms = (ViUInt32)strtoul(env, NULL, 10);
+}
+
+/* Raw socket and HiSLIP only: VXI-11 keeps unread output inside the
+ * instrument, where a cheap check cannot see it */
+static bool pool_key(const OvResource *rsrc, const OvTransport *t, char *key) {
+    if (rsrc->intfType != OV_INTF_TCPIP || (!rsrc->isSocket && !rsrc->isHiSLIP)) return false;
+    if (!t->detach || !t->attach) return false;
+    int n;
+    if (rsrc->isSocket)
+        n = snprintf(key, POOL_KEY_SIZE, "TCPIP%u::%s::%u::SOCKET",
+                     (unsigned)rsrc->intfNum, ov_rsrc_host(rsrc), (unsigned)rsrc->port);
+    else
+        n = snprintf(key, POOL_KEY_SIZE, "TCPIP%u::%s::%s,%u::INSTR", (unsigned)rsrc->intfNum,
+                     ov_rsrc_host(rsrc), ov_rsrc_device(rsrc), (unsigned)rsrc->port);
+    /* A cut-off key could name another connection: such resources are not pooled */
+    if (n < 0 || n >= POOL_KEY_SIZE) return false;
+    for (char *p = key; *p; p++) *p = (char)tolower((unsigned char)*p);
+    return true;
+}
+
+#ifndef OPENVISA_WINDOWS
+
+/* Close a parked connection the way its transport would */
+static void pool_close(PoolEntry *e) {
+    OvTransport *t = ov_transport_create_for_rsrc(&e->rsrc);
+    if (!t) {
+        for (ViUInt32 i = 0; i < e->cs.nfds; i++) close(e->cs.fds[i]);
+    } else if (t->attach(t, &e->rsrc, &e->cs) == VI_SUCCESS && t->close) {
+        t->close(t);
+    }
+    free(t);
+    ov_rsrc_release(&e->rsrc);
+    free(e);
+}
+
+/* Unread input or EOF on any channel */
+static bool pool_pending(const OvConnState *cs) {
+    for (ViUInt32 i = 0; i < cs->nfds; i++) {
+        struct pollfd p = { .fd = cs->fds[i], .events = POLLIN };
+        if (poll(&p, 1, 0) != 0) return true;
+    }
+    return false;
+}
+
+/* Discard whatever has arrived on a raw socket; false if the peer closed */
+static bool pool_drain(int fd) {
+    char buf[4096];
+    for (;;) {
+        ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n > 0) continue;
+        if (n < 0 && errno == EINTR) continue;
+        return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+}
+
+/*
+ * Detach t into *cs with no input left over.  On false the connection is
+ * still (or again) owned by t, or already gone, and the caller closes t.
+ */
+static bool pool_settle(const OvResource *rsrc, OvTransport *t, OvConnState *cs) {
+    if (t->detach(t, cs) != VI_SUCCESS) return false;
+    if (!pool_pending(cs)) return true;
+
+    if (rsrc->isSocket) {
+        if (pool_drain(cs->fds[0])) return true;
+    } else {
+        /* HiSLIP messages cannot be skipped blindly: device clear discards them */
+        if (t->attach(t, rsrc, cs) != VI_SUCCESS) return false;
+        if (!t->clear || t->clear(t) != VI_SUCCESS || t->detach(t, cs) != VI_SUCCESS) return false;
+        if (!pool_pending(cs)) return true;
+    }
+    t->attach(t, rsrc, cs);
+    return false;
+}
+
+#else  /* OPENVISA_WINDOWS — transports have no detach/attach, nothing is parked */
+
+static void pool_close(PoolEntry *e) {
+    ov_rsrc_release(&e->rsrc);
+    free(e);
+}
+
+static bool pool_pending(const OvConnState *cs) { (void)cs; return true; }
+
+static bool pool_settle(const OvResource *rsrc, OvTransport *t, OvConnState *cs) {
+    (void)rsrc; (void)t; (void)cs;
+    return false;
+}
+
+#endif
+
+/* Unlink entries idle for idle_ms or longer into *dead; caller holds g_lock */
+static void pool_expire(uint64_t now, PoolEntry **dead) {
+    uint64_t idle_ns = (uint64_t)g_idle_ms * 1000000u;
+    for (PoolEntry **pp = &g_entries; *pp; ) {
+        PoolEntry *e = *pp;
+        if (g_idle_ms == 0 || now - e->parked_ns >= idle_ns) {
+            *pp = e->next;
+            e->next = *dead;
+            *dead = e;
+            if (g_idle_ms) g_stats.expired++;
+            g_stats.idle--;
+        } else {
+            pp = &e->next;
+        }
+    }
+}
+
+static void pool_close_all(PoolEntry *dead) {
+    while (dead) {
+        PoolEntry *next = dead->next;
+        pool_close(dead);
+        dead = next;
+    }
+}
+
+static void *pool_reaper(void *arg) {
+    (void)arg;
+    ov_mutex_lock(&g_lock);
+    for (;;) {
+        PoolEntry *dead = NULL;
+        uint64_t now = ov_time_ns();
+        pool_expire(now, &dead);
+        if (dead) {
+            ov_mutex_unlock(&g_lock);
+            pool_close_all(dead);
+            ov_mutex_lock(&g_lock);
+            continue;
+        }
+        /* Sleep until the oldest entry (last in the list) is due */
+        PoolEntry *oldest = g_entries;
+        while (oldest && oldest->next) oldest = oldest->next;
+        if (!oldest) {
+            ov_cond_wait(&g_wake, &g_lock);
+        } else {
+            uint64_t due = oldest->parked_ns + (uint64_t)g_idle_ms * 1000000u;
+            ov_cond_timedwait(&g_wake, &g_lock, (uint32_t)((due - now) / 1000000u) + 1);
+        }
+    }
+    return NULL;
+}
+
+/* ========== Session hooks ========== */
+
+bool ov_pool_take(const OvResource *rsrc, OvTransport *t) {
+    char key[POOL_KEY_SIZE];
+    ov_mutex_lock(&g_lock);
+    pool_load_env();
+    if (g_idle_ms == 0 || !pool_key(rsrc, t, key)) {
+        ov_mutex_unlock(&g_lock);
+        return false;
+    }
+
+    PoolEntry *dead = NULL, *hit = NULL;
+    pool_expire(ov_time_ns(), &dead);
+    for (PoolEntry **pp = &g_entries; *pp && !hit; ) {
+        PoolEntry *e = *pp;
+        if (strcmp(e->key, key) != 0) { pp = &e->next; continue; }
+        *pp = e->next;
+        g_stats.idle--;
+        if (pool_pending(&e->cs)) {
+            g_stats.stale++;
+            e->next = dead;
+            dead = e;
+        } else {
+            hit = e;
+        }
+    }
+    if (hit) g_stats.hits++; else g_stats.misses++;
+    ov_mutex_unlock(&g_lock);
+
+    pool_close_all(dead);
+    if (!hit) return false;
+    bool ok = t->attach(t, rsrc, &hit->cs) == VI_SUCCESS;   /* owns the fds either way */
+    ov_rsrc_release(&hit->rsrc);
+    free(hit);
+    return ok;
+}
+
+bool ov_pool_park(const OvResource *rsrc, OvTransport *t) {
+    char key[POOL_KEY_SIZE];
+    ov_mutex_lock(&g_lock);
+    pool_load_env();
+    bool enabled = g_idle_ms != 0;
+    ov_mutex_unlock(&g_lock);
+    if (!enabled || !pool_key(rsrc, t, key)) return false;
+
+    PoolEntry *e = (PoolEntry*)calloc(1, sizeof(PoolEntry));
+    if (!e) return false;
+    if (!pool_settle(rsrc, t, &e->cs)) {
+        free(e);
+        return false;
+    }
+    memcpy(e->key, key, sizeof(key));
+    e->rsrc = *rsrc;
+    ov_rsrc_retain(&e->rsrc);
+    e->parked_ns = ov_time_ns();
+
+    /* Over the per-resource limit: the oldest of this resource goes */
+    PoolEntry *dead = NULL;
+    ov_mutex_lock(&g_lock);
+    if (!g_reaper_started) {
+        OvThread th;
+        ov_cond_init(&g_wake);
+        g_reaper_started = ov_thread_create(&th, pool_reaper, NULL);
+    }
+    e->next = g_entries;
+    g_entries = e;
+    g_stats.idle++;
+    ViUInt32 same = 0;
+    for (PoolEntry **pp = &g_entries; *pp; ) {
+        PoolEntry *i = *pp;
+        if (strcmp(i->key, key) == 0 && ++same > g_max_per_rsrc) {
+            *pp = i->next;
+            i->next = dead;
+            dead = i;
+            g_stats.idle--;
+        } else {
+            pp = &i->next;
+        }
+    }
+    ov_cond_signal(&g_wake);
+    ov_mutex_unlock(&g_lock);
+
+    pool_close_all(dead);
+    return true;
+}
+
+/* ========== Public API ========== */
+
+ViStatus _VI_FUNC ovPoolConfigure(ViUInt32 idleMs, ViUInt32 maxPerRsrc) {
+    PoolEntry *dead = NULL;
+    ov_mutex_lock(&g_lock);
+    g_configured = true;
+    g_idle_ms = idleMs;
+    g_max_per_rsrc = maxPerRsrc ? maxPerRsrc : POOL_DEFAULT_MAX;
+    if (idleMs == 0) pool_expire(ov_time_ns(), &dead);
+    if (g_reaper_started) ov_cond_signal(&g_wake);     /* idle time may have shrunk */
+    ov_mutex_unlock(&g_lock);
+    pool_close_all(dead);
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovPoolGetStats(OvPoolStats *stats) {
+    if (!stats) return VI_ERROR_INV_OBJECT;
+    ov_mutex_lock(&g_lock);
+    *stats = g_stats;
+    ov_mutex_unlock(&g_lock);
+    return VI_SUCCESS;
+}
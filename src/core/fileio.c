@@ -0,0 +1,283 @@
+/*
+ * OpenVISA - File transfer  (viReadToFile / viWriteFromFile)
+ *
+ * Data is moved between the transport and the file without passing through
+ * a user buffer:
+ *  1. Native  — transports that provide readToFile/writeFromFile
+ *               (raw SOCKET on Linux: splice socket->pipe->file, sendfile)
+ *  2. mmap    — the file region is pre-sized with ftruncate and mapped; the
+ *               transport reads straight into the mapping (VXI-11, HiSLIP,
+ *               USBTMC, ...).  Writes map the file read-only and hand the
+ *               mapping to a single transport write so END is sent once.
+ *  3. Buffered — fread/fwrite through a heap buffer (Windows, special files)
+ *
+ * With the query cache or read-ahead on, reads take the buffered path
+ * through them as viRead does: the response may be a cached answer that
+ * never reaches the transport, may already be buffered by the read-ahead,
+ * and one read from the instrument may be captured.  Other reads go through
+ * ov_session_receive so adaptive timeouts apply, and file data written is
+ * shown to the query cache, adaptive timeouts and read-ahead as viWrite
+ * data is; the native path is skipped while any of them is on.
+ *
+ * VI_ATTR_FILE_APPEND_EN selects between truncating the file and appending
+ * to it.  The file is never opened with O_APPEND because splice() rejects
+ * append-mode descriptors; appending seeks to the end instead.
+ */
+
+#include "session.h"
+#include "visa.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifndef OPENVISA_WINDOWS
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <errno.h>
+#endif
+
+#define OV_FILEIO_CHUNK     (1u << 20)
+
+/* Map a transport read status to the viReadToFile result once count is hit */
+static ViStatus fileio_final_status(ViStatus st, ViUInt32 total, ViUInt32 count) {
+    if (st == VI_SUCCESS && total == count) return VI_SUCCESS_MAX_CNT;
+    return st;
+}
+
+/* Session layers that may hold the response or must see it */
+static bool fileio_layered(const OvSession *sess) {
+    return sess->qcache || sess->readahead;
+}
+
+/* Layers that must see the data moved: the native path never hands it over */
+static bool fileio_observed(const OvSession *sess) {
+    return fileio_layered(sess) || sess->adaptive;
+}
+
+/* What ov_session_write does after the transport took buf */
+static void fileio_sent(OvSession *sess, ViBuf buf, ViUInt32 count) {
+    if (count == 0) return;
+    if (sess->qcache) ov_qcache_sent(sess, buf, count);
+    if (sess->adaptive) ov_adaptive_sent(sess, buf, count);
+    if (sess->readahead) ov_readahead_sent(sess, buf, count);
+}
+
+/* ========== Buffered fallback ========== */
+
+static ViStatus fileio_read_chunk(OvSession *sess, ViBuf buf, ViUInt32 want, ViUInt32 *got) {
+    if (sess->qcache) return ov_qcache_read(sess, buf, want, got);
+    if (sess->readahead) return ov_readahead_read(sess, buf, want, got);
+    return ov_session_receive(sess, buf, want, got, sess->timeout);
+}
+
+static ViStatus fileio_read_buffered(OvSession *sess, FILE *fp, ViUInt32 count, ViUInt32 *retCount) {
+    ViUInt32 chunk = count < OV_FILEIO_CHUNK ? count : OV_FILEIO_CHUNK;
+    ViBuf buf = (ViBuf)malloc(chunk ? chunk : 1);
+    if (!buf) return VI_ERROR_ALLOC;
+
+    ViUInt32 total = 0;
+    ViStatus st = VI_SUCCESS;
+    while (total < count) {
+        ViUInt32 want = count - total < chunk ? count - total : chunk;
+        ViUInt32 got = 0;
+        st = fileio_read_chunk(sess, buf, want, &got);
+        if (st < VI_SUCCESS) break;
+        if (got && fwrite(buf, 1, got, fp) != got) { st = VI_ERROR_FILE_IO; break; }
+        total += got;
+        /* A message transport returning short of a full chunk has ended */
+        if (st != VI_SUCCESS || got == 0 || (!ov_session_is_stream(sess) && got < want)) break;
+    }
+
+    free(buf);
+    *retCount = total;
+    return st < VI_SUCCESS ? st : fileio_final_status(st, total, count);
+}
+
+static ViStatus fileio_write_buffered(OvSession *sess, FILE *fp, ViUInt32 count, ViUInt32 *retCount) {
+    OvTransport *t = sess->transport;
+    ViBuf buf = (ViBuf)malloc(count ? count : 1);
+    if (!buf) return VI_ERROR_ALLOC;
+
+    /* One write call so the transport asserts END on the last byte only */
+    ViUInt32 n = (ViUInt32)fread(buf, 1, count, fp);
+    ViUInt32 total = 0;
+    ViStatus st = VI_SUCCESS;
+    while (total < n) {
+        ViUInt32 sent = 0;
+        st = t->write(t, buf + total, n - total, &sent);
+        if (st < VI_SUCCESS) break;
+        if (sent == 0) { st = VI_ERROR_IO; break; }
+        total += sent;
+    }
+
+    if (st >= VI_SUCCESS) fileio_sent(sess, buf, total);
+    free(buf);
+    *retCount = total;
+    return st < VI_SUCCESS ? st : VI_SUCCESS;
+}
+
+/* ========== mmap path (POSIX) ========== */
+
+#ifndef OPENVISA_WINDOWS
+
+static ViStatus fileio_read_mmap(OvSession *sess, int fd, off_t offset, ViUInt32 count, ViUInt32 *retCount) {
+    long page = sysconf(_SC_PAGESIZE);
+    off_t base = offset - (offset % page);
+    size_t lead = (size_t)(offset - base);
+    size_t maplen = lead + count;
+
+    /* Pre-size so the whole destination region is backed by the file */
+    if (ftruncate(fd, offset + (off_t)count) != 0) return VI_ERROR_NSUP_OPER;
+    unsigned char *map = (unsigned char*)mmap(NULL, maplen, PROT_READ | PROT_WRITE,
+                                              MAP_SHARED, fd, base);
+    if (map == MAP_FAILED) {
+        if (ftruncate(fd, offset) != 0) { /* best effort */ }
+        return VI_ERROR_NSUP_OPER;
+    }
+
+    ViUInt32 total = 0;
+    ViStatus st = VI_SUCCESS;
+    while (total < count) {
+        ViUInt32 got = 0;
+        st = ov_session_receive(sess, map + lead + total, count - total, &got, sess->timeout);
+        if (st < VI_SUCCESS) break;
+        total += got;
+        if (!ov_session_is_stream(sess) || st != VI_SUCCESS || got == 0) break;
+    }
+
+    munmap(map, maplen);
+    /* Drop the unused tail of the pre-sized region */
+    if (ftruncate(fd, offset + (off_t)total) != 0 && st >= VI_SUCCESS) st = VI_ERROR_FILE_IO;
+
+    *retCount = total;
+    return st < VI_SUCCESS ? st : fileio_final_status(st, total, count);
+}
+
+static ViStatus fileio_write_mmap(OvSession *sess, int fd, ViUInt32 count, ViUInt32 *retCount) {
+    OvTransport *t = sess->transport;
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || !S_ISREG(sb.st_mode)) return VI_ERROR_NSUP_OPER;
+
+    ViUInt32 n = (uint64_t)sb.st_size < count ? (ViUInt32)sb.st_size : count;
+    if (n == 0) { *retCount = 0; return VI_SUCCESS; }
+
+    unsigned char *map = (unsigned char*)mmap(NULL, n, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) return VI_ERROR_NSUP_OPER;
+    madvise(map, n, MADV_SEQUENTIAL);
+
+    ViUInt32 total = 0;
+    ViStatus st = VI_SUCCESS;
+    while (total < n) {
+        ViUInt32 sent = 0;
+        st = t->write(t, map + total, n - total, &sent);
+        if (st < VI_SUCCESS) break;
+        if (sent == 0) { st = VI_ERROR_IO; break; }
+        total += sent;
+    }
+
+    if (st >= VI_SUCCESS) fileio_sent(sess, map, total);
+    munmap(map, n);
+    *retCount = total;
+    return st < VI_SUCCESS ? st : VI_SUCCESS;
+}
+
+#endif /* !OPENVISA_WINDOWS */
+
+/* ========== Public API ========== */
+
+ViStatus _VI_FUNC viReadToFile(
+    ViSession vi, ViConstString filename,
+    ViUInt32 count, ViUInt32 *retCount)
+{
+    OvSession *sess = ov_session_find(vi);
+    if (!sess || !sess->transport || !sess->transport->read)
+        return VI_ERROR_INV_OBJECT;
+    if (sess->stream) return VI_ERROR_IN_PROGRESS;     /* the reader owns the transport */
+    if (!filename) return VI_ERROR_FILE_ACCESS;
+
+    ViUInt32 dummy;
+    if (!retCount) retCount = &dummy;
+    *retCount = 0;
+
+    bool layered = fileio_layered(sess);
+    ViStatus st = layered ? VI_SUCCESS : ov_session_sync(sess);
+    if (st < VI_SUCCESS) return st;
+
+#ifdef OPENVISA_WINDOWS
+    FILE *fp = fopen(filename, sess->fileAppendEn ? "ab" : "wb");
+    if (!fp) return VI_ERROR_FILE_ACCESS;
+    st = fileio_read_buffered(sess, fp, count, retCount);
+    if (fclose(fp) != 0 && st >= VI_SUCCESS) st = VI_ERROR_FILE_IO;
+    return st;
+#else
+    int flags = O_RDWR | O_CREAT | O_CLOEXEC | (sess->fileAppendEn ? 0 : O_TRUNC);
+    int fd = open(filename, flags, 0666);
+    if (fd < 0) return VI_ERROR_FILE_ACCESS;
+
+    off_t offset = sess->fileAppendEn ? lseek(fd, 0, SEEK_END) : 0;
+    if (offset < 0) { close(fd); return VI_ERROR_FILE_IO; }
+
+    st = VI_ERROR_NSUP_OPER;
+    if (sess->transport->readToFile && !fileio_observed(sess))
+        st = sess->transport->readToFile(sess->transport, fd, count, retCount, sess->timeout);
+    if (st == VI_ERROR_NSUP_OPER && !layered)
+        st = fileio_read_mmap(sess, fd, offset, count, retCount);
+    if (st == VI_ERROR_NSUP_OPER) {
+        /* Special files (FIFOs, character devices) cannot be mapped */
+        FILE *fp = fdopen(fd, "ab");
+        if (!fp) { close(fd); return VI_ERROR_FILE_IO; }
+        st = fileio_read_buffered(sess, fp, count, retCount);
+        if (fclose(fp) != 0 && st >= VI_SUCCESS) st = VI_ERROR_FILE_IO;
+        return st;
+    }
+    close(fd);
+    return st;
+#endif
+}
+
+ViStatus _VI_FUNC viWriteFromFile(
+    ViSession vi, ViConstString filename,
+    ViUInt32 count, ViUInt32 *retCount)
+{
+    OvSession *sess = ov_session_find(vi);
+    if (!sess || !sess->transport || !sess->transport->write)
+        return VI_ERROR_INV_OBJECT;
+    if (sess->stream) return VI_ERROR_IN_PROGRESS;     /* the reader owns the transport */
+    if (!filename) return VI_ERROR_FILE_ACCESS;
+
+    ViUInt32 dummy;
+    if (!retCount) retCount = &dummy;
+    *retCount = 0;
+
+    ViStatus st = ov_session_sync(sess);
+    if (st < VI_SUCCESS) return st;
+
+#ifdef OPENVISA_WINDOWS
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) return VI_ERROR_FILE_ACCESS;
+    st = fileio_write_buffered(sess, fp, count, retCount);
+    fclose(fp);
+    return st;
+#else
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return VI_ERROR_FILE_ACCESS;
+
+    st = VI_ERROR_NSUP_OPER;
+    if (sess->transport->writeFromFile && !fileio_observed(sess))
+        st = sess->transport->writeFromFile(sess->transport, fd, count, retCount);
+    if (st == VI_ERROR_NSUP_OPER)
+        st = fileio_write_mmap(sess, fd, count, retCount);
+    if (st == VI_ERROR_NSUP_OPER) {
+        FILE *fp = fdopen(fd, "rb");
+        if (!fp) { close(fd); return VI_ERROR_FILE_IO; }
+        st = fileio_write_buffered(sess, fp, count, retCount);
+        fclose(fp);
+        return st;
+    }
+    close(fd);
+    return st;
+#endif
+}
@@ -0,0 +1,135 @@
+/*
+ * OpenVISA - Per-host tables and connect probes
+ */
+
+#include "hosts.h"
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#ifndef OPENVISA_WINDOWS
+    #include <netinet/in.h>
+    #include <fcntl.h>
+    #include <errno.h>
+    #include <poll.h>
+#endif
+
+/* ========== Host table ========== */
+
+static void host_key(const char *host, char key[OV_HOST_SIZE]) {
+    size_t n = 0;
+    for (; host[n] && n < OV_HOST_SIZE - 1; n++) key[n] = (char)tolower((unsigned char)host[n]);
+    key[n] = '\0';
+}
+
+static OvHostEntry **host_link(OvHostEntry **table, const char *key) {
+    OvHostEntry **p = table;
+    while (*p && strcmp((*p)->host, key) != 0) p = &(*p)->next;
+    return p;
+}
+
+OvHostEntry *ov_host_find(OvHostEntry **table, const char *host, size_t size) {
+    char key[OV_HOST_SIZE];
+    host_key(host, key);
+    OvHostEntry *e = *host_link(table, key);
+    if (e || !size) return e;
+    e = (OvHostEntry *)calloc(1, size);
+    if (!e) return NULL;
+    memcpy(e->host, key, sizeof(key));
+    e->next = *table;
+    *table = e;
+    return e;
+}
+
+OvHostEntry *ov_host_remove(OvHostEntry **table, const char *host) {
+    char key[OV_HOST_SIZE];
+    host_key(host, key);
+    OvHostEntry **p = host_link(table, key);
+    OvHostEntry *e = *p;
+    if (e) {
+        *p = e->next;
+        e->next = NULL;
+    }
+    return e;
+}
+
+const char *ov_host_env_once(bool *configured, const char *name) {
+    if (*configured) return NULL;
+    *configured = true;
+    return getenv(name);
+}
+
+/* ========== Connect probes ========== */
+
+void ov_probe_start(OvProbe *p, const struct addrinfo *ai, ViUInt16 port) {
+    struct sockaddr_storage ss;
+    memcpy(&ss, ai->ai_addr, ai->ai_addrlen);
+    if (port && ss.ss_family == AF_INET6) ((struct sockaddr_in6 *)&ss)->sin6_port = htons(port);
+    else if (port) ((struct sockaddr_in *)&ss)->sin_port = htons(port);
+
+    p->state = OV_PROBE_FAILED;
+    p->s = socket(ai->ai_family, SOCK_STREAM, 0);
+    if (p->s == OV_INVALID_SOCKET) return;
+#ifdef OPENVISA_WINDOWS
+    u_long nb = 1;
+    ioctlsocket(p->s, FIONBIO, &nb);
+    if (connect(p->s, (struct sockaddr *)&ss, (int)ai->ai_addrlen) == 0) p->state = OV_PROBE_OPEN;
+    else if (WSAGetLastError() == WSAEWOULDBLOCK) p->state = OV_PROBE_PENDING;
+    else if (WSAGetLastError() == WSAECONNREFUSED) p->state = OV_PROBE_REFUSED;
+#else
+    fcntl(p->s, F_SETFL, fcntl(p->s, F_GETFL, 0) | O_NONBLOCK);
+    if (connect(p->s, (struct sockaddr *)&ss, ai->ai_addrlen) == 0) p->state = OV_PROBE_OPEN;
+    else if (errno == EINPROGRESS) p->state = OV_PROBE_PENDING;
+    else if (errno == ECONNREFUSED) p->state = OV_PROBE_REFUSED;
+#endif
+}
+
+#ifdef OPENVISA_WINDOWS
+static OvProbeState probe_result(ov_socket_t s) {
+    int err = 0, elen = sizeof(err);
+    getsockopt(s, SOL_SOCKET, SO_ERROR, (char *)&err, &elen);
+    return err == 0 ? OV_PROBE_OPEN : err == WSAECONNREFUSED ? OV_PROBE_REFUSED : OV_PROBE_FAILED;
+}
+#else
+static OvProbeState probe_result(ov_socket_t s) {
+    int err = 0;
+    socklen_t elen = sizeof(err);
+    getsockopt(s, SOL_SOCKET, SO_ERROR, &err, &elen);
+    return err == 0 ? OV_PROBE_OPEN : err == ECONNREFUSED ? OV_PROBE_REFUSED : OV_PROBE_FAILED;
+}
+#endif
+
+void ov_probe_wait(OvProbe *p, int n, ViUInt32 timeout_ms) {
+#ifdef OPENVISA_WINDOWS
+    fd_set wfds, efds;
+    FD_ZERO(&wfds);
+    FD_ZERO(&efds);
+    for (int i = 0; i < n; i++) {
+        if (p[i].state != OV_PROBE_PENDING) continue;
+        FD_SET(p[i].s, &wfds);
+        FD_SET(p[i].s, &efds);
+    }
+    struct timeval tv = { (long)(timeout_ms / 1000), (long)((timeout_ms % 1000) * 1000) };
+    if (select(0, NULL, &wfds, &efds, &tv) <= 0) return;
+    for (int i = 0; i < n; i++) {
+        if (p[i].state != OV_PROBE_PENDING) continue;
+        if (FD_ISSET(p[i].s, &wfds) || FD_ISSET(p[i].s, &efds)) p[i].state = probe_result(p[i].s);
+    }
+#else
+    struct pollfd pfd[4];
+    if (n > 4) n = 4;
+    for (int i = 0; i < n; i++) {
+        pfd[i].fd = p[i].state == OV_PROBE_PENDING ? p[i].s : -1;
+        pfd[i].events = POLLOUT;
+        pfd[i].revents = 0;
+    }
+    if (poll(pfd, (nfds_t)n, (int)timeout_ms) <= 0) return;
+    for (int i = 0; i < n; i++)
+        if (pfd[i].revents) p[i].state = probe_result(p[i].s);
+#endif
+}
+
+void ov_probe_close(OvProbe *p) {
+    if (p->s != OV_INVALID_SOCKET) ov_closesocket(p->s);
+    p->s = OV_INVALID_SOCKET;
+}
@@ -0,0 +1,63 @@
+/*
+ * OpenVISA - Per-host tables and connect probes
+ *
+ * Shared by the circuit breaker and protocol auto-selection.  A host table
+ * is a list of entries keyed by the lower-cased host name; each module's
+ * entry type starts with an OvHostEntry, and the module's own lock guards
+ * the table.  A probe is a non-blocking TCP connect that several can wait
+ * on at once.
+ */
+
+#ifndef OPENVISA_HOSTS_H
+#define OPENVISA_HOSTS_H
+
+#include "visatype.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef OPENVISA_WINDOWS
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    typedef SOCKET ov_socket_t;
+    #define OV_INVALID_SOCKET INVALID_SOCKET
+    #define ov_closesocket closesocket
+#else
+    #include <sys/socket.h>
+    #include <netdb.h>
+    #include <unistd.h>
+    typedef int ov_socket_t;
+    #define OV_INVALID_SOCKET (-1)
+    #define ov_closesocket close
+#endif
+
+#define OV_HOST_SIZE        256
+
+typedef struct OvHostEntry {
+    struct OvHostEntry *next;
+    char        host[OV_HOST_SIZE];     /* lower case */
+} OvHostEntry;
+
+/* Entry for host; with size (the module's entry size) a zeroed one is
+ * added if there is none.  ov_host_remove unlinks it for the caller to free. */
+OvHostEntry *ov_host_find(OvHostEntry **table, const char *host, size_t size);
+OvHostEntry *ov_host_remove(OvHostEntry **table, const char *host);
+
+/* A module setting taken from $name the first time it is read, unless it
+ * was set through the API before: the variable's value that first time,
+ * NULL otherwise.  Caller holds the module's lock. */
+const char  *ov_host_env_once(bool *configured, const char *name);
+
+typedef enum { OV_PROBE_PENDING, OV_PROBE_OPEN, OV_PROBE_REFUSED, OV_PROBE_FAILED } OvProbeState;
+
+typedef struct {
+    ov_socket_t  s;
+    OvProbeState state;
+} OvProbe;
+
+/* Start connecting to ai's address, on port unless that is 0 */
+void ov_probe_start(OvProbe *p, const struct addrinfo *ai, ViUInt16 port);
+/* Wait up to timeout_ms for any of the n pending probes to finish */
+void ov_probe_wait(OvProbe *p, int n, ViUInt32 timeout_ms);
+void ov_probe_close(OvProbe *p);
+
+#endif /* OPENVISA_HOSTS_H */
@@ -0,0 +1,148 @@
+/*
+ * OpenVISA - LZ4 block compression
+ *
+ * Greedy single-pass compressor with a 4K-entry hash of 4-byte sequences
+ * and the usual skip acceleration over incompressible stretches.  The
+ * block-format end rules are honoured: the last 5 bytes are always
+ * literals and no match starts within the last 12 bytes.
+ */
+
+#include "lz4.h"
+#include <string.h>
+
+#define LZ4_MINMATCH        4
+#define LZ4_LASTLITERALS    5
+#define LZ4_MFLIMIT         12
+#define LZ4_MAX_OFFSET      65535u
+#define LZ4_HASH_LOG        12
+#define LZ4_SKIP_TRIGGER    6       /* step grows by 1 every 64 missed bytes */
+
+static uint32_t lz4_read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static uint32_t lz4_hash(uint32_t seq) {
+    return (seq * 2654435761u) >> (32 - LZ4_HASH_LOG);
+}
+
+/* Length continuation bytes: 255, 255, ..., rest */
+static bool lz4_put_len(uint8_t *dst, size_t cap, size_t *op, size_t len) {
+    while (len >= 255) {
+        if (*op >= cap) return false;
+        dst[(*op)++] = 255;
+        len -= 255;
+    }
+    if (*op >= cap) return false;
+    dst[(*op)++] = (uint8_t)len;
+    return true;
+}
+
+/* One sequence: literals [lit, lit+nlit), then a match (mlen 0 = last sequence) */
+static bool lz4_emit(uint8_t *dst, size_t cap, size_t *op,
+                     const uint8_t *lit, size_t nlit, size_t offset, size_t mlen)
+{
+    if (*op >= cap) return false;
+    size_t token = (*op)++;
+    size_t mcode = mlen ? mlen - LZ4_MINMATCH : 0;
+    dst[token] = (uint8_t)(((nlit < 15 ? nlit : 15) << 4) | (mcode < 15 ? mcode : 15));
+
+    if (nlit >= 15 && !lz4_put_len(dst, cap, op, nlit - 15)) return false;
+    if (cap - *op < nlit) return false;
+    memcpy(dst + *op, lit, nlit);
+    *op += nlit;
+    if (!mlen) return true;
+
+    if (cap - *op < 2) return false;
+    dst[(*op)++] = (uint8_t)(offset & 0xFF);
+    dst[(*op)++] = (uint8_t)(offset >> 8);
+    if (mcode >= 15 && !lz4_put_len(dst, cap, op, mcode - 15)) return false;
+    return true;
+}
+
+size_t ov_lz4_compress(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) {
+    uint32_t table[1u << LZ4_HASH_LOG];
+    memset(table, 0, sizeof(table));
+    size_t ip = 0, anchor = 0, op = 0;
+
+    if (n > LZ4_MFLIMIT) {
+        size_t limit = n - LZ4_MFLIMIT;
+        size_t misses = 1u << LZ4_SKIP_TRIGGER;
+        while (ip <= limit) {
+            uint32_t seq = lz4_read32(src + ip);
+            uint32_t h = lz4_hash(seq);
+            size_t ref = table[h];
+            table[h] = (uint32_t)ip;
+
+            if (ref >= ip || ip - ref > LZ4_MAX_OFFSET || lz4_read32(src + ref) != seq) {
+                ip += misses++ >> LZ4_SKIP_TRIGGER;
+                continue;
+            }
+            misses = 1u << LZ4_SKIP_TRIGGER;
+
+            /* Extend backwards over pending literals, then forwards */
+            while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) { ip--; ref--; }
+            size_t mlen = LZ4_MINMATCH;
+            size_t maxm = n - LZ4_LASTLITERALS - ip;
+            while (mlen < maxm && src[ref + mlen] == src[ip + mlen]) mlen++;
+
+            if (!lz4_emit(dst, cap, &op, src + anchor, ip - anchor, ip - ref, mlen)) return 0;
+            ip += mlen;
+            anchor = ip;
+            if (ip - 2 <= limit) table[lz4_hash(lz4_read32(src + ip - 2))] = (uint32_t)(ip - 2);
+        }
+    }
+
+    if (!lz4_emit(dst, cap, &op, src + anchor, n - anchor, 0, 0)) return 0;
+    return op;
+}
+
+bool ov_lz4_decompress(const uint8_t *src, size_t n, uint8_t *dst, size_t out_len) {
+    size_t ip = 0, op = 0;
+    while (ip < n) {
+        uint8_t token = src[ip++];
+
+        size_t nlit = token >> 4;
+        if (nlit == 15) {
+            uint8_t b;
+            do {
+                if (ip >= n) return false;
+                b = src[ip++];
+                nlit += b;
+            } while (b == 255);
+        }
+        if (n - ip < nlit || out_len - op < nlit) return false;
+        memcpy(dst + op, src + ip, nlit);
+        ip += nlit;
+        op += nlit;
+        if (ip == n) break;                 /* last sequence has no match */
+
+        if (n - ip < 2) return false;
+        size_t offset = (size_t)src[ip] | ((size_t)src[ip + 1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op) return false;
+
+        size_t mlen = (token & 15u);
+        if (mlen == 15) {
+            uint8_t b;
+            do {
+                if (ip >= n) return false;
+                b = src[ip++];
+                mlen += b;
+            } while (b == 255);
+        }
+        mlen += LZ4_MINMATCH;
+        if (out_len - op < mlen) return false;
+
+        /* Overlapping copy (offset < mlen repeats a pattern) */
+        const uint8_t *m = dst + op - offset;
+        if (offset >= mlen) {
+            memcpy(dst + op, m, mlen);
+        } else {
+            for (size_t i = 0; i < mlen; i++) dst[op + i] = m[i];
+        }
+        op += mlen;
+    }
+    return op == out_len;
+}
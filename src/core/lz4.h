@@ -0,0 +1,27 @@
+/*
+ * OpenVISA - LZ4 block compression
+ *
+ * Self-contained codec for the LZ4 block format (no frame format, no
+ * dictionary), interoperable with liblz4's LZ4_compress_default /
+ * LZ4_decompress_safe.  Used to compress bulk transfers of the remote
+ * protocol (transport/remote.c, remote/openvisa_server.c) and the chunks
+ * of capture files (core/capture.c).
+ */
+
+#ifndef OPENVISA_LZ4_H
+#define OPENVISA_LZ4_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Worst-case compressed size of n input bytes */
+#define OV_LZ4_BOUND(n)     ((n) + (n) / 255u + 16u)
+
+/* Returns the compressed size, or 0 if it does not fit in cap */
+size_t ov_lz4_compress(const uint8_t *src, size_t n, uint8_t *dst, size_t cap);
+
+/* Decodes exactly out_len bytes; false on malformed or mis-sized input */
+bool   ov_lz4_decompress(const uint8_t *src, size_t n, uint8_t *dst, size_t out_len);
+
+#endif /* OPENVISA_LZ4_H */
@@ -0,0 +1,302 @@
+/*
+ * OpenVISA - Per-session command pipeline  (ovPipeline*, ovFuture*)
+ *
+ * Commands and queries are queued in submission order and written ahead of
+ * the responses, as long as the bytes of everything sent since the oldest
+ * unanswered query fit the instrument's input-buffer budget and the
+ * transport allows another query in flight (one by default: raw sockets and
+ * serial ports cannot tell replies apart, and 488.2 instruments behind
+ * VXI-11, USBTMC, GPIB or HiSLIP synchronized mode drop an unread response
+ * when the next query arrives; ovPipelineSetMaxPending overrides it).
+ * Responses come back in message order, so they are matched to futures by
+ * position.  There is no I/O thread: submitting writes what the budget
+ * allows, and waiting reads responses (storing ones that belong to earlier
+ * futures) and keeps the write side topped up after every read.
+ */
+
+#include "session.h"
+#include "thread.h"
+#include "openvisa.h"
+#include <string.h>
+#include <stdlib.h>
+
+#define PL_DEFAULT_BUDGET   1024u   /* bytes; a conservative instrument input buffer */
+#define PL_READ_CHUNK       4096u
+
+typedef enum {
+    PL_QUEUED,          /* waiting for budget */
+    PL_SENT,            /* written, response outstanding */
+    PL_DONE,            /* result available */
+} PlState;
+
+typedef struct {
+    char       *cmd;
+    ViUInt32    len;
+    ViUInt32    inflight;   /* bytes counted against the budget */
+    bool        query;
+    bool        released;   /* awaited; slot reusable once at the head */
+    PlState     state;
+    ViStatus    status;
+    ViByte     *resp;
+    ViUInt32    resp_len;
+} PlEntry;
+
+struct OvPipeline {
+    ViSession   vi;
+    ViUInt32    budget;
+    ViUInt32    max_pending;    /* queries in flight, 0 = no limit */
+    OvMutex     lock;
+
+    PlEntry    *ring;
+    ViUInt32    cap;            /* power of two */
+    OvFuture    head;           /* oldest unreleased entry */
+    OvFuture    tail;           /* next id to assign */
+    OvFuture    next_send;      /* first PL_QUEUED entry */
+    OvFuture    next_read;      /* first sent entry the instrument may not have consumed */
+
+    ViUInt32    inflight_bytes; /* sum of inflight over [next_read, next_send) */
+    ViUInt32    inflight_queries;
+};
+
+static PlEntry *pl_at(OvPipeline *pl, OvFuture id) {
+    return &pl->ring[id & (pl->cap - 1)];
+}
+
+static bool pl_grow(OvPipeline *pl) {
+    ViUInt32 ncap = pl->cap ? pl->cap * 2 : 16;
+    PlEntry *nr = (PlEntry*)calloc(ncap, sizeof(PlEntry));
+    if (!nr) return false;
+    for (OvFuture id = pl->head; id != pl->tail; id++)
+        nr[id & (ncap - 1)] = *pl_at(pl, id);
+    free(pl->ring);
+    pl->ring = nr;
+    pl->cap  = ncap;
+    return true;
+}
+
+static void pl_entry_free(PlEntry *e) {
+    free(e->cmd);
+    free(e->resp);
+    memset(e, 0, sizeof(*e));
+}
+
+/* Drop released, finished entries from the head of the ring */
+static void pl_trim(OvPipeline *pl) {
+    while (pl->head != pl->tail) {
+        PlEntry *e = pl_at(pl, pl->head);
+        if (!e->released || e->state != PL_DONE) break;
+        if (pl->head == pl->next_read && pl->inflight_queries) break;
+        pl_entry_free(e);
+        if (pl->next_read == pl->head) pl->next_read++;
+        pl->head++;
+    }
+}
+
+/* ========== I/O ========== */
+
+static bool pl_can_send(OvPipeline *pl, const PlEntry *e) {
+    if (pl->inflight_queries == 0) return true;     /* nothing to wait for */
+    if (pl->max_pending && pl->inflight_queries >= pl->max_pending) return false;
+    return pl->inflight_bytes + e->len <= pl->budget;
+}
+
+/* Write queued entries while the budget allows */
+static void pl_send_ahead(OvPipeline *pl) {
+    while (pl->next_send != pl->tail) {
+        PlEntry *e = pl_at(pl, pl->next_send);
+        if (!pl_can_send(pl, e)) break;
+
+        /* Instrument idle: everything written before has been consumed */
+        if (pl->inflight_queries == 0) {
+            pl->next_read = pl->next_send;
+            pl->inflight_bytes = 0;
+        }
+
+        ViUInt32 n = 0;
+        ViStatus st = viWrite(pl->vi, (ViBuf)e->cmd, e->len, &n);
+        if (st >= VI_SUCCESS && n != e->len) st = VI_ERROR_IO;
+        free(e->cmd);
+        e->cmd = NULL;
+        pl->next_send++;
+
+        if (st < VI_SUCCESS) {
+            e->state  = PL_DONE;
+            e->status = st;
+            continue;
+        }
+        e->inflight = e->len;
+        pl->inflight_bytes += e->len;
+        if (e->query) {
+            e->state = PL_SENT;
+            pl->inflight_queries++;
+        } else {
+            e->state  = PL_DONE;
+            e->status = st;
+        }
+    }
+}
+
+/* Read the response of the oldest outstanding query */
+static void pl_read_one(OvPipeline *pl) {
+    /* Commands ahead of it are consumed by the time it answers */
+    PlEntry *e;
+    for (;;) {
+        e = pl_at(pl, pl->next_read++);
+        pl->inflight_bytes -= e->inflight;
+        e->inflight = 0;
+        if (e->state == PL_SENT) break;
+    }
+
+    ViUInt32 cap = 0;
+    ViStatus st;
+    do {
+        if (cap - e->resp_len < PL_READ_CHUNK) {
+            ViByte *nb = (ViByte*)realloc(e->resp, cap + PL_READ_CHUNK);
+            if (!nb) { st = VI_ERROR_ALLOC; break; }
+            e->resp = nb;
+            cap += PL_READ_CHUNK;
+        }
+        ViUInt32 n = 0;
+        st = viRead(pl->vi, e->resp + e->resp_len, cap - e->resp_len, &n);
+        e->resp_len += n;
+    } while (st == VI_SUCCESS_MAX_CNT);
+
+    e->state  = PL_DONE;
+    e->status = st;
+    pl->inflight_queries--;
+}
+
+/* Drive I/O until entry id has its result */
+static void pl_drive(OvPipeline *pl, OvFuture id) {
+    for (;;) {
+        pl_send_ahead(pl);
+        if (pl_at(pl, id)->state == PL_DONE) return;
+        pl_read_one(pl);
+    }
+}
+
+/* ========== Public API ========== */
+
+ViStatus _VI_FUNC ovPipelineCreate(ViSession vi, ViUInt32 inputBudget, OvPipeline **pipeline) {
+    if (!pipeline) return VI_ERROR_INV_OBJECT;
+    *pipeline = NULL;
+    OvSession *sess = ov_session_find(vi);
+    if (!sess || sess->isRM || !sess->transport) return VI_ERROR_INV_OBJECT;
+    /* Every write would wait for the response read ahead: one query in flight */
+    if (sess->readahead) return VI_ERROR_IN_PROGRESS;
+
+    OvPipeline *pl = (OvPipeline*)calloc(1, sizeof(*pl));
+    if (!pl || !pl_grow(pl)) { free(pl); return VI_ERROR_ALLOC; }
+    pl->vi          = vi;
+    pl->budget      = inputBudget ? inputBudget : PL_DEFAULT_BUDGET;
+    pl->max_pending = sess->transport->maxPending ? sess->transport->maxPending(sess->transport) : 0;
+    ov_mutex_init(&pl->lock);
+    *pipeline = pl;
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovPipelineSetMaxPending(OvPipeline *pipeline, ViUInt32 maxPending) {
+    OvPipeline *pl = pipeline;
+    if (!pl) return VI_ERROR_INV_OBJECT;
+    ov_mutex_lock(&pl->lock);
+    pl->max_pending = maxPending;
+    pl_send_ahead(pl);      /* a raised limit may free queued entries */
+    ov_mutex_unlock(&pl->lock);
+    return VI_SUCCESS;
+}
+
+static ViStatus pl_submit(OvPipeline *pl, ViConstString cmd, bool query, OvFuture *future) {
+    if (!pl || !cmd) return VI_ERROR_INV_OBJECT;
+    size_t len = strlen(cmd);
+    char *copy = (char*)malloc(len ? len : 1);
+    if (!copy) return VI_ERROR_ALLOC;
+    memcpy(copy, cmd, len);
+
+    ov_mutex_lock(&pl->lock);
+    pl_trim(pl);
+    if (pl->tail - pl->head == pl->cap && !pl_grow(pl)) {
+        ov_mutex_unlock(&pl->lock);
+        free(copy);
+        return VI_ERROR_ALLOC;
+    }
+    OvFuture id = pl->tail++;
+    PlEntry *e = pl_at(pl, id);
+    memset(e, 0, sizeof(*e));
+    e->cmd   = copy;
+    e->len   = (ViUInt32)len;
+    e->query = query;
+    e->state = PL_QUEUED;
+    if (!future) e->released = true;        /* fire and forget */
+    pl_send_ahead(pl);
+    ov_mutex_unlock(&pl->lock);
+
+    if (future) *future = id;
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovPipelineWrite(OvPipeline *pipeline, ViConstString cmd, OvFuture *future) {
+    return pl_submit(pipeline, cmd, false, future);
+}
+
+ViStatus _VI_FUNC ovPipelineQuery(OvPipeline *pipeline, ViConstString cmd, OvFuture *future) {
+    return pl_submit(pipeline, cmd, true, future);
+}
+
+ViStatus _VI_FUNC ovFutureWait(OvPipeline *pipeline, OvFuture future, ViBuf buf,
+                               ViUInt32 count, ViUInt32 *retCount)
+{
+    OvPipeline *pl = pipeline;
+    if (!pl) return VI_ERROR_INV_OBJECT;
+    if (retCount) *retCount = 0;
+
+    ov_mutex_lock(&pl->lock);
+    if (future - pl->head >= pl->tail - pl->head || pl_at(pl, future)->released) {
+        ov_mutex_unlock(&pl->lock);
+        return VI_ERROR_INV_JOB_ID;
+    }
+    pl_drive(pl, future);
+
+    PlEntry *e = pl_at(pl, future);
+    ViStatus st = e->status;
+    if (st >= VI_SUCCESS && e->query) {
+        ViUInt32 n = e->resp_len < count ? e->resp_len : count;
+        if (buf && n) memcpy(buf, e->resp, n);
+        if (retCount) *retCount = n;
+        if (n < e->resp_len) st = VI_SUCCESS_MAX_CNT;
+    }
+    e->released = true;
+    pl_trim(pl);
+    ov_mutex_unlock(&pl->lock);
+    return st;
+}
+
+ViStatus _VI_FUNC ovPipelineWaitAll(OvPipeline *pipeline) {
+    OvPipeline *pl = pipeline;
+    if (!pl) return VI_ERROR_INV_OBJECT;
+
+    ov_mutex_lock(&pl->lock);
+    ViStatus result = VI_SUCCESS;
+    for (OvFuture id = pl->head; id != pl->tail; id++) {
+        pl_drive(pl, id);
+        PlEntry *e = pl_at(pl, id);
+        if (e->status < VI_SUCCESS && result == VI_SUCCESS) result = e->status;
+    }
+    pl_trim(pl);
+    ov_mutex_unlock(&pl->lock);
+    return result;
+}
+
+ViStatus _VI_FUNC ovPipelineClose(OvPipeline *pipeline) {
+    OvPipeline *pl = pipeline;
+    if (!pl) return VI_ERROR_INV_OBJECT;
+
+    /* Responses still owed must be drained or they would be read by the
+     * next plain viRead on the session */
+    ViStatus st = ovPipelineWaitAll(pl);
+    for (OvFuture id = pl->head; id != pl->tail; id++)
+        pl_entry_free(pl_at(pl, id));
+    ov_mutex_destroy(&pl->lock);
+    free(pl->ring);
+    free(pl);
+    return st;
+}
@@ -0,0 +1,55 @@
+/*
+ * OpenVISA - Transport plugin ABI
+ *
+ * A transport can live in its own shared module instead of libvisa.  The
+ * module exports one function, ov_transport_plugin, returning a descriptor
+ * that names the ABI it was compiled against and its constructor; the core
+ * loads it with dlopen the first time a resource of its prefix is opened
+ * (see src/transport/transport.c).  A transport source file becomes a
+ * plugin by ending with OV_TRANSPORT_PLUGIN(ctor), which expands to nothing
+ * unless the file is built as a module (OPENVISA_BUILD_PLUGIN).
+ *
+ * The ABI is OvTransport and OvResource as laid out in core/session.h.
+ * Bump OV_PLUGIN_ABI whenever either changes incompatibly (a member moved,
+ * removed or retyped); the core refuses modules built for another ABI or
+ * with other struct sizes.  Plugins must not call into the core: everything
+ * they need comes through OvResource and the inline ov_rsrc_* accessors.
+ */
+
+#ifndef OPENVISA_PLUGIN_H
+#define OPENVISA_PLUGIN_H
+
+#include "session.h"
+
+#define OV_PLUGIN_ABI           1
+#define OV_PLUGIN_ENTRY         "ov_transport_plugin"
+
+typedef struct {
+    uint32_t    abi;                /* OV_PLUGIN_ABI */
+    uint32_t    transportSize;      /* sizeof(OvTransport) */
+    uint32_t    resourceSize;       /* sizeof(OvResource) */
+    OvTransport *(*create)(void);
+} OvTransportPlugin;
+
+typedef const OvTransportPlugin *(*OvTransportPluginEntry)(void);
+
+#ifdef OPENVISA_WINDOWS
+    #define OV_PLUGIN_EXPORT    __declspec(dllexport)
+#else
+    #define OV_PLUGIN_EXPORT    __attribute__((visibility("default")))
+#endif
+
+#ifdef OPENVISA_BUILD_PLUGIN
+    #define OV_TRANSPORT_PLUGIN(ctor)                                           \
+        OV_PLUGIN_EXPORT const OvTransportPlugin *ov_transport_plugin(void);   \
+        const OvTransportPlugin *ov_transport_plugin(void) {                   \
+            static const OvTransportPlugin desc = {                             \
+                OV_PLUGIN_ABI, sizeof(OvTransport), sizeof(OvResource), ctor    \
+            };                                                                  \
+            return &desc;                                                       \
+        }
+#else
+    #define OV_TRANSPORT_PLUGIN(ctor)
+#endif
+
+#endif /* OPENVISA_PLUGIN_H */
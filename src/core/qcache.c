@@ -0,0 +1,256 @@
+/*
+ * OpenVISA - Per-session response cache for idempotent queries
+ *
+ * Opt-in (ovQueryCacheEnable or OV_ATTR_QUERY_CACHE_EN).  A viWrite of one
+ * of the session's cacheable queries (compared case-insensitively, trailing
+ * whitespace ignored) goes to the instrument the first time and the
+ * complete response (up to TERM_CHAR or END) of the following viRead calls
+ * is kept; later writes of that query are not sent, and the reads after
+ * them are answered from the copy.  viQueryf, viPrintf and viReadToFile are
+ * covered since they go through viWrite and viRead.
+ *
+ * Responses are matched by order, so a query only hits or starts a capture
+ * when no other response is outstanding (a '?' outside quoted strings and
+ * block data counts as a query).  Writes made while a cached answer is
+ * still unread go out as usual; their responses are read after the cached
+ * one, as the instrument would have sent them.  The copies are dropped on
+ * viClear, on a command containing *RST (viWriteFromFile data included), when the connection is lost and by
+ * ovQueryCacheFlush.
+ */
+
+#include "session.h"
+#include "scpi.h"
+#include "openvisa.h"
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#define QC_MAX_QUERIES      16
+#define QC_MAX_QUERY        64
+#define QC_MAX_RESPONSE     4096    /* longer responses are not cached */
+
+typedef struct {
+    char        query[QC_MAX_QUERY];
+    ViUInt32    qlen;
+    ViByte     *resp;               /* NULL = not captured yet */
+    ViUInt32    resp_len;
+    ViStatus    resp_status;        /* VI_SUCCESS or VI_SUCCESS_TERM_CHAR */
+} QcEntry;
+
+struct OvQueryCache {
+    QcEntry     entries[QC_MAX_QUERIES];
+    ViUInt32    count;
+    QcEntry    *serving;            /* cached answer the next reads return */
+    ViUInt32    serve_off;
+    QcEntry    *capture;            /* query whose response is being read */
+    ViByte      buf[QC_MAX_RESPONSE];
+    ViUInt32    cap_len;
+    bool        cap_overflow;
+    ViUInt32    outstanding;        /* responses of sent queries not yet read */
+    ViUInt32    hits;
+    ViUInt32    misses;
+};
+
+static const char *const QC_DEFAULT[] = { "*IDN?", "*OPT?", "SYST:VERS?" };
+
+/* Command length without trailing whitespace/terminators */
+static ViUInt32 qc_trim(const ViByte *buf, ViUInt32 count) {
+    while (count && isspace(buf[count - 1])) count--;
+    return count;
+}
+
+static bool qc_contains_ci(const ViByte *buf, ViUInt32 len, const char *word) {
+    size_t wl = strlen(word);
+    for (ViUInt32 i = 0; i + wl <= len; i++) {
+        size_t k = 0;
+        while (k < wl && toupper(buf[i + k]) == (unsigned char)word[k]) k++;
+        if (k == wl) return true;
+    }
+    return false;
+}
+
+static QcEntry *qc_match(OvQueryCache *qc, const ViByte *buf, ViUInt32 len) {
+    for (ViUInt32 i = 0; i < qc->count; i++) {
+        QcEntry *e = &qc->entries[i];
+        if (e->qlen != len) continue;
+        ViUInt32 k = 0;
+        while (k < len && toupper(buf[k]) == toupper((unsigned char)e->query[k])) k++;
+        if (k == len) return e;
+    }
+    return NULL;
+}
+
+static void qc_flush(OvQueryCache *qc) {
+    for (ViUInt32 i = 0; i < qc->count; i++) {
+        free(qc->entries[i].resp);
+        qc->entries[i].resp = NULL;
+    }
+    qc->serving = NULL;
+    qc->capture = NULL;
+    qc->outstanding = 0;
+}
+
+static ViStatus qc_set_queries(OvQueryCache *qc, const ViConstString queries[], ViUInt32 count) {
+    if (count > QC_MAX_QUERIES) return VI_ERROR_INV_SETUP;
+    for (ViUInt32 i = 0; i < count; i++) {
+        size_t len = queries[i] ? qc_trim((const ViByte *)queries[i], (ViUInt32)strlen(queries[i])) : 0;
+        if (len == 0 || len >= QC_MAX_QUERY) return VI_ERROR_INV_SETUP;
+    }
+    qc_flush(qc);
+    for (ViUInt32 i = 0; i < count; i++) {
+        QcEntry *e = &qc->entries[i];
+        e->qlen = qc_trim((const ViByte *)queries[i], (ViUInt32)strlen(queries[i]));
+        memcpy(e->query, queries[i], e->qlen);
+        e->query[e->qlen] = '\0';
+    }
+    qc->count = count;
+    return VI_SUCCESS;
+}
+
+/* ========== Session hooks ========== */
+
+ViStatus ov_qcache_write(OvSession *sess, ViBuf buf, ViUInt32 count, ViUInt32 *retCount) {
+    OvQueryCache *qc = sess->qcache;
+    ViUInt32 len = qc_trim(buf, count);
+    QcEntry *e = qc_match(qc, buf, len);
+    bool idle = qc->outstanding == 0 && !qc->serving;
+
+    if (e && e->resp && idle) {
+        qc->hits++;
+        qc->serving = e;
+        qc->serve_off = 0;
+        if (retCount) *retCount = count;
+        return VI_SUCCESS;
+    }
+    if (qc_contains_ci(buf, len, "*RST")) qc_flush(qc);
+    if (e) qc->misses++;
+
+    ViStatus st = ov_session_write(sess, buf, count, retCount);
+    if (st < VI_SUCCESS) {
+        if (st == VI_ERROR_CONN_LOST) qc_flush(qc);
+        qc->capture = NULL;
+        return st;
+    }
+    if (e && idle && !qc->capture) {
+        qc->capture = e;
+        qc->cap_len = 0;
+        qc->cap_overflow = false;
+    }
+    if (ov_scpi_is_query(buf, len)) qc->outstanding++;
+    return st;
+}
+
+void ov_qcache_sent(OvSession *sess, ViBuf buf, ViUInt32 count) {
+    OvQueryCache *qc = sess->qcache;
+    ViUInt32 len = qc_trim(buf, count);
+    if (qc_contains_ci(buf, len, "*RST")) qc_flush(qc);
+    if (ov_scpi_is_query(buf, len)) qc->outstanding++;
+}
+
+ViStatus ov_qcache_read(OvSession *sess, ViBuf buf, ViUInt32 count, ViUInt32 *retCount) {
+    OvQueryCache *qc = sess->qcache;
+    QcEntry *e = qc->serving;
+    if (e) {
+        ViUInt32 n = e->resp_len - qc->serve_off;
+        if (n > count) n = count;
+        memcpy(buf, e->resp + qc->serve_off, n);
+        qc->serve_off += n;
+        if (retCount) *retCount = n;
+        if (qc->serve_off < e->resp_len) return VI_SUCCESS_MAX_CNT;
+        qc->serving = NULL;
+        return e->resp_status;
+    }
+
+    ViUInt32 n = 0;
+    ViStatus st = ov_session_read(sess, buf, count, &n);
+    if (retCount) *retCount = n;
+    if (st < VI_SUCCESS) {
+        if (st == VI_ERROR_CONN_LOST) qc_flush(qc);
+        qc->capture = NULL;
+        qc->outstanding = 0;            /* what the instrument still owes is unknown */
+        return st;
+    }
+    if (qc->capture && !qc->cap_overflow) {
+        if (qc->cap_len + n <= QC_MAX_RESPONSE) {
+            memcpy(qc->buf + qc->cap_len, buf, n);
+            qc->cap_len += n;
+        } else {
+            qc->cap_overflow = true;
+        }
+    }
+    /* Only TERM_CHAR or END completes a response: VI_SUCCESS from a stream
+     * transport is just what had arrived, and the rest is still to come */
+    if (st == VI_SUCCESS_MAX_CNT || (st == VI_SUCCESS && ov_session_is_stream(sess))) return st;
+
+    /* Response complete */
+    if (qc->outstanding) qc->outstanding--;
+    QcEntry *c = qc->capture;
+    qc->capture = NULL;
+    if (c && !qc->cap_overflow && qc->cap_len) {
+        c->resp = (ViByte *)malloc(qc->cap_len);
+        if (c->resp) {
+            memcpy(c->resp, qc->buf, qc->cap_len);
+            c->resp_len = qc->cap_len;
+            c->resp_status = st;
+        }
+    }
+    return st;
+}
+
+void ov_qcache_clear(OvSession *sess) {
+    if (sess->qcache) qc_flush(sess->qcache);
+}
+
+void ov_qcache_free(OvSession *sess) {
+    if (!sess->qcache) return;
+    qc_flush(sess->qcache);
+    free(sess->qcache);
+    sess->qcache = NULL;
+}
+
+ViStatus ov_qcache_get_attr(OvSession *sess, ViAttr attr, void *value) {
+    OvQueryCache *qc = sess->qcache;
+    switch (attr) {
+        case OV_ATTR_QUERY_CACHE_EN:
+            *(ViBoolean *)value = qc ? VI_TRUE : VI_FALSE;
+            return VI_SUCCESS;
+        case OV_ATTR_QUERY_CACHE_HITS:
+            *(ViUInt32 *)value = qc ? qc->hits : 0;
+            return VI_SUCCESS;
+        case OV_ATTR_QUERY_CACHE_MISSES:
+            *(ViUInt32 *)value = qc ? qc->misses : 0;
+            return VI_SUCCESS;
+        default:
+            return VI_ERROR_NSUP_ATTR;
+    }
+}
+
+/* ========== Public API ========== */
+
+ViStatus _VI_FUNC ovQueryCacheEnable(ViSession vi, const ViConstString queries[], ViUInt32 count) {
+    OvSession *sess = ov_session_find(vi);
+    if (!sess || sess->isRM || !sess->transport) return VI_ERROR_INV_OBJECT;
+    if (!queries) {
+        queries = QC_DEFAULT;
+        count = sizeof(QC_DEFAULT) / sizeof(QC_DEFAULT[0]);
+    }
+    OvQueryCache *qc = sess->qcache;
+    if (!qc) {
+        qc = (OvQueryCache *)calloc(1, sizeof(OvQueryCache));
+        if (!qc) return VI_ERROR_ALLOC;
+    }
+    ViStatus st = qc_set_queries(qc, queries, count);
+    if (st != VI_SUCCESS) {
+        if (!sess->qcache) free(qc);
+        return st;
+    }
+    sess->qcache = qc;
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovQueryCacheFlush(ViSession vi) {
+    OvSession *sess = ov_session_find(vi);
+    if (!sess || sess->isRM) return VI_ERROR_INV_OBJECT;
+    ov_qcache_clear(sess);
+    return VI_SUCCESS;
+}
@@ -0,0 +1,293 @@
+/*
+ * OpenVISA - Speculative response read-ahead  (ovReadAhead*)
+ *
+ * Opt-in per session.  A viWrite holding a query header (a '?' outside
+ * quoted strings and block data) is taken to be a query, and the session's
+ * read-ahead thread starts receiving its response at once, into a session
+ * buffer, while the application is still busy elsewhere.
+ * The viRead that follows joins the read in flight or is served from the
+ * buffer; what does not fit its count stays buffered for the next viRead.
+ * On transports where a read is a request of its own (a VXI-11 device_read
+ * RPC, a proxy or remote round trip) that request has already been answered
+ * by the time the application asks.
+ *
+ * The read-ahead waits in slices of at most RA_SLICE_MS until the session
+ * timeout after the write (or the adaptive one, ovAdaptiveTimeoutEnable).  A
+ * viRead that joins it moves that deadline to its own, so the application's
+ * timeout counts from its viRead and is never waited out twice; a read-ahead
+ * that timed out before viRead was called is forgotten and viRead waits on
+ * its own.  Only one response is read ahead: a query written while one is
+ * buffered or in flight is read by viRead as usual.  viWrite and the other
+ * operations that reach the transport wait for a read in flight first, so
+ * requests never interleave on the connection.  That would hold an
+ * ovPipeline to one query in flight, so ovPipelineCreate refuses a session
+ * reading ahead.  viReadSTB and viClear cancel it instead, within one
+ * slice, leaving the response to the next viRead; viClear also drops the
+ * buffered response.
+ *
+ * A response longer than the buffer is read ahead up to the buffer size;
+ * its remainder is read by viRead as usual, except on HiSLIP, which drops
+ * what a read has no room for, as it does for viRead.
+ */
+
+#include "session.h"
+#include "scpi.h"
+#include "thread.h"
+#include "openvisa.h"
+#include <string.h>
+#include <stdlib.h>
+
+#define RA_DEFAULT_BUF      (1u << 20)
+#define RA_MIN_BUF          256u
+#define RA_SLICE_MS         100u    /* longest wait before a cancel is noticed */
+
+typedef enum { RA_IDLE, RA_WANTED, RA_RUNNING } RaState;
+
+struct OvReadAhead {
+    OvSession  *sess;
+    OvMutex     lock;
+    OvCond      cond;           /* state changes, quit */
+    OvThread    thread;
+    bool        quit;
+    RaState     state;
+    uint64_t    deadline;       /* ov_time_ns() the read in flight gives up at, 0 = cancelled */
+
+    ViByte     *buf;
+    ViUInt32    size;
+    bool        ready;          /* buf holds a response (or its failure) */
+    ViUInt32    off, len;       /* unread part of buf */
+    ViStatus    status;         /* status of the read that filled buf */
+    ViUInt32    hits;           /* viRead calls served from a successful read-ahead */
+};
+
+/* ========== Read-ahead thread ========== */
+
+/* When a read starting now gives up: the session (or adaptive) timeout on */
+static uint64_t ra_deadline(OvSession *sess) {
+    ViUInt32 tmo = sess->adaptive ? ov_adaptive_timeout(sess) : sess->timeout;
+    if (tmo == VI_TMO_INFINITE) return UINT64_MAX;
+    return ov_time_ns() + (uint64_t)tmo * 1000000u;
+}
+
+/* Caller holds ra->lock: how long the next receive may wait, 0 = give up */
+static ViUInt32 ra_slice_locked(const OvReadAhead *ra) {
+    uint64_t now = ov_time_ns();
+    if (ra->deadline <= now) return 0;
+    uint64_t ms = (ra->deadline - now + 999999) / 1000000u;
+    return ms < RA_SLICE_MS ? (ViUInt32)ms : RA_SLICE_MS;
+}
+
+static void *ra_thread(void *arg) {
+    OvReadAhead *ra = (OvReadAhead *)arg;
+    ov_mutex_lock(&ra->lock);
+    for (;;) {
+        while (!ra->quit && ra->state != RA_WANTED) ov_cond_wait(&ra->cond, &ra->lock);
+        if (ra->quit) break;
+        ra->state = RA_RUNNING;
+        ViUInt32 slice = ra_slice_locked(ra);
+        ov_mutex_unlock(&ra->lock);
+
+        ViUInt32 n = 0;
+        ViStatus st = VI_ERROR_TMO;
+        /* VI_TMO_IMMEDIATE still gets its one attempt */
+        bool immediate = ra->sess->timeout == VI_TMO_IMMEDIATE;
+        while (slice || immediate) {
+            st = ov_session_receive(ra->sess, ra->buf, ra->size, &n, slice);
+            if (st != VI_ERROR_TMO || n || immediate) break;
+            ov_mutex_lock(&ra->lock);
+            slice = ra_slice_locked(ra);
+            ov_mutex_unlock(&ra->lock);
+        }
+
+        ov_mutex_lock(&ra->lock);
+        if (st != VI_ERROR_TMO || n) {
+            ra->ready = true;
+            ra->off = 0;
+            ra->len = n;
+            ra->status = st;
+        }
+        ra->state = RA_IDLE;
+        ov_cond_broadcast(&ra->cond);
+    }
+    ov_mutex_unlock(&ra->lock);
+    return NULL;
+}
+
+static void ra_wait_idle_locked(OvReadAhead *ra) {
+    while (ra->state != RA_IDLE) ov_cond_wait(&ra->cond, &ra->lock);
+}
+
+/* Stop a read not yet started at once and one in flight after its slice */
+static void ra_cancel_locked(OvReadAhead *ra) {
+    if (ra->state == RA_WANTED) ra->state = RA_IDLE;
+    ra->deadline = 0;
+    ra_wait_idle_locked(ra);
+}
+
+/* ========== Session hooks ========== */
+
+void ov_readahead_sent(OvSession *sess, ViBuf buf, ViUInt32 count) {
+    OvReadAhead *ra = sess->readahead;
+    if (!ov_scpi_is_query(buf, count)) return;
+    /* A held query would never be answered */
+    if (sess->coalesce && ov_coalesce_flush(sess) < VI_SUCCESS) return;
+    ov_mutex_lock(&ra->lock);
+    if (ra->state == RA_IDLE && !ra->ready) {
+        ra->state = RA_WANTED;
+        ra->deadline = ra_deadline(sess);
+        ov_cond_broadcast(&ra->cond);
+    }
+    ov_mutex_unlock(&ra->lock);
+}
+
+void ov_readahead_wait(OvSession *sess) {
+    OvReadAhead *ra = sess->readahead;
+    ov_mutex_lock(&ra->lock);
+    ra_wait_idle_locked(ra);
+    ov_mutex_unlock(&ra->lock);
+}
+
+void ov_readahead_cancel(OvSession *sess) {
+    OvReadAhead *ra = sess->readahead;
+    ov_mutex_lock(&ra->lock);
+    ra_cancel_locked(ra);
+    ov_mutex_unlock(&ra->lock);
+}
+
+ViStatus ov_readahead_read(OvSession *sess, ViBuf buf, ViUInt32 count, ViUInt32 *retCount) {
+    OvReadAhead *ra = sess->readahead;
+    ov_mutex_lock(&ra->lock);
+    bool joined = ra->state != RA_IDLE;
+    if (joined) {
+        /* The read in flight now waits as long as this viRead would */
+        uint64_t deadline = ra_deadline(sess);
+        if (deadline > ra->deadline) ra->deadline = deadline;
+        ra_wait_idle_locked(ra);
+    }
+    if (ra->ready) {
+        ViUInt32 n = ra->len - ra->off < count ? ra->len - ra->off : count;
+        memcpy(buf, ra->buf + ra->off, n);
+        ra->off += n;
+        if (ra->status >= VI_SUCCESS) ra->hits++;
+        ViStatus st = VI_SUCCESS_MAX_CNT;
+        if (ra->off == ra->len) {
+            st = ra->status;
+            ra->ready = false;
+        }
+        ov_mutex_unlock(&ra->lock);
+        if (retCount) *retCount = n;
+        return st;
+    }
+    ov_mutex_unlock(&ra->lock);
+    /* It timed out at this viRead's deadline (or was cancelled) */
+    if (joined) return VI_ERROR_TMO;
+
+    ViStatus st = sess->coalesce ? ov_coalesce_flush(sess) : VI_SUCCESS;
+    if (st < VI_SUCCESS) return st;
+    return ov_session_receive(sess, buf, count, retCount, sess->timeout);
+}
+
+void ov_readahead_clear(OvSession *sess) {
+    OvReadAhead *ra = sess->readahead;
+    if (!ra) return;
+    ov_mutex_lock(&ra->lock);
+    ra_cancel_locked(ra);
+    ra->ready = false;
+    ov_mutex_unlock(&ra->lock);
+}
+
+void ov_readahead_free(OvSession *sess) {
+    OvReadAhead *ra = sess->readahead;
+    if (!ra) return;
+    ov_mutex_lock(&ra->lock);
+    ra->quit = true;
+    ov_cond_broadcast(&ra->cond);
+    ov_mutex_unlock(&ra->lock);
+    ov_thread_join(ra->thread);
+    sess->readahead = NULL;
+    ov_cond_destroy(&ra->cond);
+    ov_mutex_destroy(&ra->lock);
+    free(ra->buf);
+    free(ra);
+}
+
+ViStatus ov_readahead_get_attr(OvSession *sess, ViAttr attr, void *value) {
+    OvReadAhead *ra = sess->readahead;
+    switch (attr) {
+        case OV_ATTR_READ_AHEAD_EN:
+            *(ViBoolean *)value = ra ? VI_TRUE : VI_FALSE;
+            return VI_SUCCESS;
+        case OV_ATTR_READ_AHEAD_HITS:
+            *(ViUInt32 *)value = ra ? ra->hits : 0;
+            return VI_SUCCESS;
+        default:
+            return VI_ERROR_NSUP_ATTR;
+    }
+}
+
+/* ========== Public API ========== */
+
+ViStatus _VI_FUNC ovReadAheadEnable(ViSession vi, ViUInt32 bufferSize) {
+    OvSession *sess = ov_session_find(vi);
+    if (!sess || sess->isRM || !sess->transport || !sess->transport->read) return VI_ERROR_INV_OBJECT;
+    if (sess->stream) return VI_ERROR_IN_PROGRESS;
+    if (bufferSize == 0) bufferSize = RA_DEFAULT_BUF;
+    if (bufferSize < RA_MIN_BUF) bufferSize = RA_MIN_BUF;
+
+    OvReadAhead *ra = sess->readahead;
+    if (ra) {
+        /* Resize once nothing is buffered */
+        ov_mutex_lock(&ra->lock);
+        ra_wait_idle_locked(ra);
+        ViStatus st = VI_SUCCESS;
+        if (ra->ready) {
+            st = VI_ERROR_IN_PROGRESS;
+        } else if (bufferSize != ra->size) {
+            ViByte *nbuf = (ViByte *)realloc(ra->buf, bufferSize);
+            if (nbuf) {
+                ra->buf = nbuf;
+                ra->size = bufferSize;
+            } else {
+                st = VI_ERROR_ALLOC;
+            }
+        }
+        ov_mutex_unlock(&ra->lock);
+        return st;
+    }
+
+    ra = (OvReadAhead *)calloc(1, sizeof(OvReadAhead));
+    if (!ra) return VI_ERROR_ALLOC;
+    ra->buf = (ViByte *)malloc(bufferSize);
+    if (!ra->buf) {
+        free(ra);
+        return VI_ERROR_ALLOC;
+    }
+    ra->sess = sess;
+    ra->size = bufferSize;
+    ov_mutex_init(&ra->lock);
+    ov_cond_init(&ra->cond);
+    if (!ov_thread_create(&ra->thread, ra_thread, ra)) {
+        ov_cond_destroy(&ra->cond);
+        ov_mutex_destroy(&ra->lock);
+        free(ra->buf);
+        free(ra);
+        return VI_ERROR_SYSTEM_ERROR;
+    }
+    sess->readahead = ra;
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovReadAheadDisable(ViSession vi) {
+    OvSession *sess = ov_session_find(vi);
+    if (!sess) return VI_ERROR_INV_OBJECT;
+    OvReadAhead *ra = sess->readahead;
+    if (!ra) return VI_SUCCESS;
+    ov_mutex_lock(&ra->lock);
+    ra_wait_idle_locked(ra);
+    bool buffered = ra->ready;
+    ov_mutex_unlock(&ra->lock);
+    /* A response already read ahead would be lost */
+    if (buffered) return VI_ERROR_IN_PROGRESS;
+    ov_readahead_free(sess);
+    return VI_SUCCESS;
+}
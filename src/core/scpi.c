@@ -0,0 +1,64 @@
+/*
+ * OpenVISA - SCPI message scanning
+ *
+ * A single left-to-right pass over the message.  Block data with a
+ * definite length is skipped by its header; an indefinite block (#0) runs
+ * to the end of the message.  A block header cut short by the end of buf
+ * ends the scan as well.  A '#' that is not followed by a header of that
+ * form (#H1F, #Q17, "#1 " ...) is an ordinary character.
+ */
+
+#include "scpi.h"
+#include <string.h>
+
+/* First '?' outside strings and block data (if stop_at_query), NULL if
+ * none; *block (if given) tells whether block data was found on the way */
+static const uint8_t *scpi_scan(const uint8_t *buf, size_t len, bool stop_at_query, bool *block) {
+    size_t i = 0;
+    while (i < len) {
+        uint8_t c = buf[i];
+        if (c == '?' && stop_at_query) return buf + i;
+
+        if (c == '"' || c == '\'') {
+            /* A doubled quote inside the string just closes and reopens it */
+            const uint8_t *end = (const uint8_t *)memchr(buf + i + 1, c, len - i - 1);
+            if (!end) return NULL;
+            i = (size_t)(end - buf) + 1;
+            continue;
+        }
+
+        if (c == '#' && i + 1 < len && buf[i + 1] >= '0' && buf[i + 1] <= '9') {
+            size_t ndig = (size_t)(buf[i + 1] - '0');
+            if (ndig == 0) {
+                if (block) *block = true;
+                return NULL;
+            }
+            if (i + 2 + ndig > len) return NULL;
+            size_t blen = 0, k = 0;
+            for (; k < ndig; k++) {
+                uint8_t d = buf[i + 2 + k];
+                if (d < '0' || d > '9') break;
+                blen = blen * 10 + (size_t)(d - '0');
+            }
+            if (k == ndig) {
+                if (block) *block = true;
+                size_t data = i + 2 + ndig;
+                if (blen >= len - data) return NULL;
+                i = data + blen;
+                continue;
+            }
+        }
+        i++;
+    }
+    return NULL;
+}
+
+const uint8_t *ov_scpi_query_mark(const uint8_t *buf, size_t len) {
+    return scpi_scan(buf, len, true, NULL);
+}
+
+bool ov_scpi_has_block(const uint8_t *buf, size_t len) {
+    bool block = false;
+    scpi_scan(buf, len, false, &block);
+    return block;
+}
@@ -0,0 +1,30 @@
+/*
+ * OpenVISA - SCPI message scanning
+ *
+ * Tells whether a program message asks for a response or carries block
+ * data.  Shared by the session layers that act on queries (query cache,
+ * coalescing, adaptive timeouts, read-ahead), the remote client and the
+ * proxy daemon.
+ */
+
+#ifndef OPENVISA_SCPI_H
+#define OPENVISA_SCPI_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* The first '?' of a query header in buf, NULL if the message has none.
+ * Quoted strings and IEEE 488.2 block data (#<n><len><bytes>, #0...) are
+ * skipped, so a '?' inside a string argument or binary data is not one. */
+const uint8_t *ov_scpi_query_mark(const uint8_t *buf, size_t len);
+
+/* Whether buf holds IEEE 488.2 block data: a #<n><n digits> header with
+ * n 1-9, or #0, outside quoted strings */
+bool ov_scpi_has_block(const uint8_t *buf, size_t len);
+
+static inline bool ov_scpi_is_query(const uint8_t *buf, size_t len) {
+    return ov_scpi_query_mark(buf, len) != NULL;
+}
+
+#endif /* OPENVISA_SCPI_H */
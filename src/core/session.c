@@ -3,6 +3,8 @@
  */
 
 #include "session.h"
+#include "thread.h"
+#include "openvisa.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,46 +12,89 @@
 
 /* ========== Global State ========== */
 
+/*
+ * A handle carries its table slot in the low bits, so lookup is one index
+ * and one compare instead of a scan; the sequence number above them keeps
+ * a closed handle from matching the slot's next occupant.  Find lists use
+ * slots from OV_MAX_SESSIONS up and event contexts the ones after them, so
+ * the kinds never collide.
+ */
+
 static OvState g_state = { .initialized = false, .nextHandle = 1 };
+static OvMutex g_slot_lock = OV_MUTEX_INIT;    /* slot claim/release, ovOpenMany opens in parallel */
 
 OvState* ov_state_get(void) {
     return &g_state;
 }
 
+static ViUInt32 ov_handle_next(ViUInt32 slot) {
+    OvState *s = &g_state;
+    ViUInt32 h = (s->nextHandle++ << OV_HANDLE_SLOT_BITS) | slot;
+    if (h <= OV_HANDLE_SLOT_MASK)           /* sequence wrapped: never VI_NULL */
+        h = (s->nextHandle++ << OV_HANDLE_SLOT_BITS) | slot;
+    return h;
+}
+
+ViUInt32 ov_handle_alloc(ViUInt32 slot) {
+    ov_mutex_lock(&g_slot_lock);
+    ViUInt32 h = ov_handle_next(slot);
+    ov_mutex_unlock(&g_slot_lock);
+    return h;
+}
+
 OvSession* ov_session_alloc(void) {
     OvState *s = &g_state;
+    ov_mutex_lock(&g_slot_lock);
     for (int i = 0; i < OV_MAX_SESSIONS; i++) {
         if (!s->sessions[i].active) {
             memset(&s->sessions[i], 0, sizeof(OvSession));
             s->sessions[i].active = true;
-            s->sessions[i].handle = s->nextHandle++;
+            s->sessions[i].handle = ov_handle_next((ViUInt32)i);
             s->sessions[i].timeout = 2000;          /* 2s default */
             s->sessions[i].termChar = '\n';
             s->sessions[i].termCharEn = false;
             s->sessions[i].sendEndEn = true;
+            s->sessions[i].brokerLease = -1;
+            ov_mutex_unlock(&g_slot_lock);
             return &s->sessions[i];
         }
     }
+    ov_mutex_unlock(&g_slot_lock);
     return NULL;
 }
 
 OvSession* ov_session_find(ViSession handle) {
-    OvState *s = &g_state;
-    for (int i = 0; i < OV_MAX_SESSIONS; i++) {
-        if (s->sessions[i].active && s->sessions[i].handle == handle)
-            return &s->sessions[i];
-    }
-    return NULL;
+    ViUInt32 slot = handle & OV_HANDLE_SLOT_MASK;
+    if (slot >= OV_MAX_SESSIONS) return NULL;
+    OvSession *sess = &g_state.sessions[slot];
+    return (sess->active && sess->handle == handle) ? sess : NULL;
 }
 
 void ov_session_free(OvSession *sess) {
     if (sess) {
+        ov_stream_free(sess);
+        ov_async_free(sess);
+        ov_readahead_free(sess);
+        ov_coalesce_free(sess);
         if (sess->transport) {
+            /* Brokered: hand the live connection back instead of closing it */
+            if (sess->brokerLease >= 0) {
+                OvConnState cs;
+                bool ok = sess->transport->detach(sess->transport, &cs) == VI_SUCCESS;
+                ov_broker_checkin(sess->brokerLease, ok ? &cs : NULL);
+            } else {
+                ov_pool_park(&sess->resource, sess->transport);
+            }
             if (sess->transport->close)
                 sess->transport->close(sess->transport);
             free(sess->transport);
         }
+        ov_qcache_free(sess);
+        ov_adaptive_free(sess);
+        ov_rsrc_release(&sess->resource);
+        ov_mutex_lock(&g_slot_lock);
         memset(sess, 0, sizeof(OvSession));
+        ov_mutex_unlock(&g_slot_lock);
     }
 }
 
@@ -59,7 +104,7 @@ OvFindList* ov_findlist_alloc(void) {
         if (!s->findLists[i].active) {
             memset(&s->findLists[i], 0, sizeof(OvFindList));
             s->findLists[i].active = true;
-            s->findLists[i].handle = s->nextHandle++;
+            s->findLists[i].handle = ov_handle_next((ViUInt32)(OV_MAX_SESSIONS + i));
             return &s->findLists[i];
         }
     }
@@ -67,18 +112,75 @@ OvFindList* ov_findlist_alloc(void) {
 }
 
 OvFindList* ov_findlist_find(ViFindList handle) {
-    OvState *s = &g_state;
-    for (int i = 0; i < OV_MAX_FIND_LISTS; i++) {
-        if (s->findLists[i].active && s->findLists[i].handle == handle)
-            return &s->findLists[i];
-    }
-    return NULL;
+    ViUInt32 slot = handle & OV_HANDLE_SLOT_MASK;
+    if (slot < OV_MAX_SESSIONS || slot >= OV_MAX_SESSIONS + OV_MAX_FIND_LISTS) return NULL;
+    OvFindList *fl = &g_state.findLists[slot - OV_MAX_SESSIONS];
+    return (fl->active && fl->handle == handle) ? fl : NULL;
 }
 
 void ov_findlist_free(OvFindList *fl) {
     if (fl) memset(fl, 0, sizeof(OvFindList));
 }
 
+/* ========== Interned Resource Strings ========== */
+
+#define OV_INTERN_BUCKETS   64
+
+static OvMutex    g_intern_lock = OV_MUTEX_INIT;
+static OvRsrcStr *g_intern[OV_INTERN_BUCKETS];
+
+/* FNV-1a */
+static uint32_t ov_intern_hash(const char *text, uint32_t len) {
+    uint32_t h = 2166136261u;
+    for (uint32_t i = 0; i < len; i++) h = (h ^ (uint8_t)text[i]) * 16777619u;
+    return h;
+}
+
+static OvRsrcStr *ov_intern(const char *text, uint32_t len) {
+    uint32_t hash = ov_intern_hash(text, len);
+    OvRsrcStr **bucket = &g_intern[hash % OV_INTERN_BUCKETS];
+    ov_mutex_lock(&g_intern_lock);
+    for (OvRsrcStr *e = *bucket; e; e = e->next) {
+        if (e->hash == hash && e->len == len && memcmp(e->text, text, len) == 0) {
+            e->refs++;
+            ov_mutex_unlock(&g_intern_lock);
+            return e;
+        }
+    }
+    OvRsrcStr *e = (OvRsrcStr*)malloc(sizeof(OvRsrcStr) + len);
+    if (e) {
+        e->hash = hash;
+        e->refs = 1;
+        e->len = len;
+        memcpy(e->text, text, len);
+        e->next = *bucket;
+        *bucket = e;
+    }
+    ov_mutex_unlock(&g_intern_lock);
+    return e;
+}
+
+void ov_rsrc_retain(OvResource *rsrc) {
+    if (!rsrc || !rsrc->str) return;
+    ov_mutex_lock(&g_intern_lock);
+    rsrc->str->refs++;
+    ov_mutex_unlock(&g_intern_lock);
+}
+
+void ov_rsrc_release(OvResource *rsrc) {
+    if (!rsrc || !rsrc->str) return;
+    OvRsrcStr *str = rsrc->str;
+    rsrc->str = NULL;
+    ov_mutex_lock(&g_intern_lock);
+    if (--str->refs == 0) {
+        OvRsrcStr **pp = &g_intern[str->hash % OV_INTERN_BUCKETS];
+        while (*pp != str) pp = &(*pp)->next;
+        *pp = str->next;
+        free(str);
+    }
+    ov_mutex_unlock(&g_intern_lock);
+}
+
 /* ========== Resource String Parser ========== */
 
 /* Helper: case-insensitive prefix match */
@@ -92,13 +194,32 @@ static bool starts_with_ci(const char *str, const char *prefix) {
     return true;
 }
 
-ViStatus ov_parse_rsrc(const char *rsrcName, OvResource *rsrc) {
-    memset(rsrc, 0, sizeof(OvResource));
-    strncpy(rsrc->raw, rsrcName, sizeof(rsrc->raw) - 1);
-    rsrc->gpibSecAddr = -1;
+/* Text under construction for ov_parse_rsrc: raw string, then fields */
+typedef struct {
+    char     text[2 * OV_RSRC_MAX_LEN + 16];
+    uint32_t len;
+} RsrcText;
+
+/* Append n bytes of s as a NUL-terminated field; returns its offset */
+static ViUInt16 rt_put(RsrcText *t, const char *s, size_t n) {
+    ViUInt16 off = (ViUInt16)t->len;
+    memcpy(t->text + t->len, s, n);
+    t->text[t->len + n] = '\0';
+    t->len += (uint32_t)n + 1;
+    return off;
+}
 
+/* Append the field at *p up to the next "::" and advance *p to it */
+static ViUInt16 rt_field(RsrcText *t, const char **p) {
+    const char *start = *p;
+    while (**p && strncmp(*p, "::", 2) != 0) (*p)++;
+    return rt_put(t, start, (size_t)(*p - start));
+}
+
+static ViStatus parse_fields(const char *rsrcName, OvResource *rsrc, RsrcText *t) {
     /* TCPIP[board]::host[::port]::INSTR
      * TCPIP[board]::host::port::SOCKET
+     * TCPIP[board]::host::port::ASRL   (serial port on an RFC 2217 terminal server)
      * TCPIP[board]::host[::device_name]::INSTR
      * TCPIP[board]::host::hislip0[::INSTR] */
     if (starts_with_ci(rsrcName, "TCPIP")) {
@@ -117,15 +238,11 @@ ViStatus ov_parse_rsrc(const char *rsrcName, OvResource *rsrc) {
         p += 2;
 
         /* host (IP or hostname) */
-        char *dst = rsrc->host;
-        while (*p && strncmp(p, "::", 2) != 0) {
-            *dst++ = *p++;
-        }
-        *dst = '\0';
+        rsrc->hostOff = rt_field(t, &p);
 
         if (*p == '\0') {
             /* TCPIP::host — assume INSTR on VXI-11 port */
-            strcpy(rsrc->deviceName, "inst0");
+            rsrc->deviceOff = rt_put(t, "inst0", 5);
             rsrc->port = 111; /* VXI-11 portmapper */
             return VI_SUCCESS;
         }
@@ -133,33 +250,30 @@ ViStatus ov_parse_rsrc(const char *rsrcName, OvResource *rsrc) {
 
         /* Next field: could be port, device_name, INSTR, or SOCKET */
         if (starts_with_ci(p, "INSTR")) {
-            strcpy(rsrc->deviceName, "inst0");
+            rsrc->deviceOff = rt_put(t, "inst0", 5);
             rsrc->port = 111;
             return VI_SUCCESS;
         }
 
         if (starts_with_ci(p, "hislip")) {
+            /* hislipN[,port] */
             rsrc->isHiSLIP = true;
             rsrc->port = 4880;
-            dst = rsrc->deviceName;
-            while (*p && strncmp(p, "::", 2) != 0) {
-                *dst++ = *p++;
-            }
-            *dst = '\0';
+            const char *dev = p;
+            while (*p && *p != ',' && strncmp(p, "::", 2) != 0) p++;
+            rsrc->deviceOff = rt_put(t, dev, (size_t)(p - dev));
+            if (*p == ',') rsrc->port = (ViUInt16)atoi(p + 1);
             return VI_SUCCESS;
         }
 
         /* Could be numeric port (for SOCKET) or device name */
-        char field[256] = {0};
-        dst = field;
-        while (*p && strncmp(p, "::", 2) != 0) {
-            *dst++ = *p++;
-        }
-        *dst = '\0';
+        const char *field = p;
+        while (*p && strncmp(p, "::", 2) != 0) p++;
+        size_t flen = (size_t)(p - field);
 
         if (*p == '\0' || starts_with_ci(p + 2, "INSTR")) {
             /* device name like "inst0" */
-            strcpy(rsrc->deviceName, field);
+            rsrc->deviceOff = rt_put(t, field, flen);
             rsrc->port = 111;
             return VI_SUCCESS;
         }
@@ -171,9 +285,15 @@ ViStatus ov_parse_rsrc(const char *rsrcName, OvResource *rsrc) {
             return VI_SUCCESS;
         }
 
+        if (starts_with_ci(p, "ASRL")) {
+            rsrc->intfType = OV_INTF_ASRL;
+            rsrc->port = (ViUInt16)atoi(field);
+            return rsrc->port ? VI_SUCCESS : VI_ERROR_INV_RSRC_NAME;
+        }
+
         /* port::INSTR */
         rsrc->port = (ViUInt16)atoi(field);
-        strcpy(rsrc->deviceName, "inst0");
+        rsrc->deviceOff = rt_put(t, "inst0", 5);
         return VI_SUCCESS;
     }
 
@@ -203,11 +323,7 @@ ViStatus ov_parse_rsrc(const char *rsrcName, OvResource *rsrc) {
         if (*p) p += 2;
 
         /* Serial */
-        char *dst = rsrc->usbSerial;
-        while (*p && strncmp(p, "::", 2) != 0) {
-            *dst++ = *p++;
-        }
-        *dst = '\0';
+        rsrc->usbSerialOff = rt_field(t, &p);
         /* skip ::INSTR or ::intfNum::INSTR */
 
         return VI_SUCCESS;
@@ -248,9 +364,84 @@ ViStatus ov_parse_rsrc(const char *rsrcName, OvResource *rsrc) {
         return VI_SUCCESS;
     }
 
+    /* SIM::name[::INSTR]    (simulated instrument, see transport/sim.c)
+     * PROXY::name[::INSTR]  (instrument shared by openvisa-proxy, see transport/proxy.c)
+     * SHM::name[::INSTR]    (soft instrument on shared-memory rings, see transport/shm.c) */
+    bool isSim = starts_with_ci(rsrcName, "SIM::");
+    bool isShm = starts_with_ci(rsrcName, "SHM::");
+    if (isSim || isShm || starts_with_ci(rsrcName, "PROXY::")) {
+        rsrc->intfType = isSim ? OV_INTF_SIM : isShm ? OV_INTF_SHM : OV_INTF_PROXY;
+        const char *p = rsrcName + (isSim || isShm ? 5 : 7);
+
+        rsrc->deviceOff = rt_field(t, &p);
+        if (t->text[rsrc->deviceOff] == '\0')
+            return VI_ERROR_INV_RSRC_NAME;
+        return VI_SUCCESS;
+    }
+
+    /* UNIX::path[::SOCKET]  (raw byte stream over a Unix domain socket, see transport/tcpip_raw.c) */
+    if (starts_with_ci(rsrcName, "UNIX::")) {
+        rsrc->intfType = OV_INTF_UNIX;
+        rsrc->isSocket = true;
+        const char *p = rsrcName + 6;
+        size_t len = strlen(p);
+        if (len >= 8 && starts_with_ci(p + len - 8, "::SOCKET")) len -= 8;
+        if (len == 0) return VI_ERROR_INV_RSRC_NAME;
+        rsrc->deviceOff = rt_put(t, p, len);
+        return VI_SUCCESS;
+    }
+
+    /* visa://host[:port]/RESOURCE  (resource of an openvisa-server, see transport/remote.c) */
+    if (starts_with_ci(rsrcName, "visa://")) {
+        rsrc->intfType = OV_INTF_REMOTE;
+        const char *p = rsrcName + 7;
+        const char *slash = strchr(p, '/');
+        if (!slash || slash == p) return VI_ERROR_INV_RSRC_NAME;
+
+        const char *colon = memchr(p, ':', (size_t)(slash - p));
+        const char *hend = colon ? colon : slash;
+        rsrc->hostOff = rt_put(t, p, (size_t)(hend - p));
+        if (colon) rsrc->port = (ViUInt16)atoi(colon + 1);
+
+        if (slash[1] == '\0') return VI_ERROR_INV_RSRC_NAME;
+        rsrc->deviceOff = rt_put(t, slash + 1, strlen(slash + 1));
+        return VI_SUCCESS;
+    }
+
+    /* PREFIX[board]::address...  (bus of a transport plugin, see ovTransportRegister);
+     * the plugin reads its address from the device field */
+    int plen = ov_plugin_match(rsrcName, &rsrc->intfType);
+    if (plen > 0) {
+        const char *p = rsrcName + plen;
+        rsrc->intfNum = (ViUInt16)atoi(p);
+        while (*p >= '0' && *p <= '9') p++;
+        p += 2;
+        if (*p == '\0') return VI_ERROR_INV_RSRC_NAME;
+        rsrc->deviceOff = rt_put(t, p, strlen(p));
+        return VI_SUCCESS;
+    }
+
     return VI_ERROR_INV_RSRC_NAME;
 }
 
+ViStatus ov_parse_rsrc(const char *rsrcName, OvResource *rsrc) {
+    memset(rsrc, 0, sizeof(OvResource));
+    rsrc->gpibSecAddr = -1;
+    size_t len = strlen(rsrcName);
+    if (len > OV_RSRC_MAX_LEN) return VI_ERROR_INV_RSRC_NAME;
+
+    /* Fields left unset point at the raw string's NUL, i.e. "" */
+    RsrcText t;
+    t.len = 0;
+    rt_put(&t, rsrcName, len);
+    rsrc->hostOff = rsrc->deviceOff = rsrc->usbSerialOff = (ViUInt16)len;
+
+    ViStatus st = parse_fields(rsrcName, rsrc, &t);
+    if (st != VI_SUCCESS) return st;
+    rsrc->str = ov_intern(t.text, t.len);
+    return rsrc->str ? VI_SUCCESS : VI_ERROR_ALLOC;
+}
+
 /* ========== VISA API Implementation ========== */
 
 ViStatus _VI_FUNC viOpenDefaultRM(ViSession *vi) {
@@ -281,14 +472,34 @@ ViStatus _VI_FUNC viOpen(
     OvSession *rm = ov_session_find(sesn);
     if (!rm || !rm->isRM) return VI_ERROR_INV_OBJECT;
 
-    /* Parse resource string */
+    /* Parse resource string (or resolve an alias) */
     OvResource rsrc;
-    ViStatus st = ov_parse_rsrc(rsrcName, &rsrc);
+    ViStatus st = ov_rsrc_lookup(rsrcName, &rsrc, NULL);
     if (st != VI_SUCCESS) return st;
 
-    /* Create session */
+    /* A host the circuit breaker has marked down fails at once */
+    st = ov_breaker_check(&rsrc);
+    if (st != VI_SUCCESS) {
+        ov_rsrc_release(&rsrc);
+        return st;
+    }
+
+    /* Plain VXI-11 INSTR: HiSLIP instead if auto-selection finds it */
+    ViUInt32 tmo = (openTimeout == VI_NULL) ? 5000 : openTimeout;
+    bool autoHiSLIP = false;
+    st = ov_autoproto_select(&rsrc, tmo, &autoHiSLIP);
+    if (st != VI_SUCCESS) {
+        ov_breaker_report(&rsrc, st);
+        ov_rsrc_release(&rsrc);
+        return st;
+    }
+
+    /* Create session; it takes over the reference to the interned text */
     OvSession *sess = ov_session_alloc();
-    if (!sess) return VI_ERROR_ALLOC;
+    if (!sess) {
+        ov_rsrc_release(&rsrc);
+        return VI_ERROR_ALLOC;
+    }
 
     sess->resource = rsrc;
 
@@ -299,13 +510,31 @@ ViStatus _VI_FUNC viOpen(
         return VI_ERROR_RSRC_NFOUND;
     }
 
-    /* Open transport */
-    ViUInt32 tmo = (openTimeout == VI_NULL) ? 5000 : openTimeout;
-    st = sess->transport->open(sess->transport, &rsrc, tmo);
+    /* Open transport: a parked connection of this process, else a warm one
+     * from the broker if one is running */
+    OvConnState cs;
+    st = VI_ERROR_RSRC_NFOUND;
+    if (ov_pool_take(&rsrc, sess->transport)) {
+        st = VI_SUCCESS;
+    } else if (sess->transport->attach && !autoHiSLIP &&
+        ov_broker_checkout(&rsrc, tmo, &cs, &sess->brokerLease) == VI_SUCCESS) {
+        st = sess->transport->attach(sess->transport, &rsrc, &cs);
+        if (st != VI_SUCCESS) {
+            ov_broker_checkin(sess->brokerLease, NULL);
+            sess->brokerLease = -1;
+        }
+    }
     if (st != VI_SUCCESS) {
+        st = sess->transport->open(sess->transport, &rsrc, tmo);
+        ov_breaker_report(&rsrc, st);
+    }
+    if (st != VI_SUCCESS) {
+        if (autoHiSLIP) ov_autoproto_forget(&rsrc);
         ov_session_free(sess);
         return st;
     }
+    if (sess->transport->setAttribute)
+        sess->transport->setAttribute(sess->transport, VI_ATTR_TMO_VALUE, sess->timeout);
 
     *vi = sess->handle;
     return VI_SUCCESS;
@@ -324,7 +553,7 @@ ViStatus _VI_FUNC viClose(ViObject vi) {
         return VI_SUCCESS;
     }
 
-    return VI_ERROR_INV_OBJECT;
+    return ov_event_close(vi);
 }
 
 ViStatus _VI_FUNC viRead(
@@ -335,7 +564,9 @@ ViStatus _VI_FUNC viRead(
     if (!sess || !sess->transport || !sess->transport->read)
         return VI_ERROR_INV_OBJECT;
 
-    return sess->transport->read(sess->transport, buf, count, retCount, sess->timeout);
+    if (sess->stream) return ov_stream_read(sess, buf, count, retCount);
+    if (sess->qcache) return ov_qcache_read(sess, buf, count, retCount);
+    return ov_session_read(sess, buf, count, retCount);
 }
 
 ViStatus _VI_FUNC viWrite(
@@ -346,14 +577,19 @@ ViStatus _VI_FUNC viWrite(
     if (!sess || !sess->transport || !sess->transport->write)
         return VI_ERROR_INV_OBJECT;
 
-    return sess->transport->write(sess->transport, buf, count, retCount);
+    if (sess->qcache) return ov_qcache_write(sess, buf, count, retCount);
+    return ov_session_write(sess, buf, count, retCount);
 }
 
 ViStatus _VI_FUNC viReadSTB(ViSession vi, ViUInt16 *status) {
     OvSession *sess = ov_session_find(vi);
     if (!sess || !sess->transport || !sess->transport->readSTB)
         return VI_ERROR_INV_OBJECT;
+    if (sess->stream) return VI_ERROR_IN_PROGRESS;
 
+    if (sess->readahead) ov_readahead_cancel(sess);
+    ViStatus st = ov_session_sync(sess);
+    if (st < VI_SUCCESS) return st;
     return sess->transport->readSTB(sess->transport, status);
 }
 
@@ -361,16 +597,22 @@ ViStatus _VI_FUNC viClear(ViSession vi) {
     OvSession *sess = ov_session_find(vi);
     if (!sess || !sess->transport || !sess->transport->clear)
         return VI_ERROR_INV_OBJECT;
+    if (sess->stream) return VI_ERROR_IN_PROGRESS;
 
+    ov_qcache_clear(sess);
+    ov_readahead_clear(sess);
+    ov_adaptive_clear(sess);
+    ViStatus st = ov_session_sync(sess);
+    if (st < VI_SUCCESS) return st;
     return sess->transport->clear(sess->transport);
 }
 
 ViStatus _VI_FUNC viGetAttribute(
     ViSession vi, ViAttr attribute, void *attrState)
 {
-    OvSession *sess = ov_session_find(vi);
-    if (!sess) return VI_ERROR_INV_OBJECT;
     if (!attrState) return VI_ERROR_INV_OBJECT;
+    OvSession *sess = ov_session_find(vi);
+    if (!sess) return ov_event_get_attr(vi, attribute, attrState);
 
     switch (attribute) {
         case VI_ATTR_TMO_VALUE:
@@ -385,8 +627,11 @@ ViStatus _VI_FUNC viGetAttribute(
         case VI_ATTR_SEND_END_EN:
             *(ViBoolean*)attrState = sess->sendEndEn ? VI_TRUE : VI_FALSE;
             return VI_SUCCESS;
+        case VI_ATTR_FILE_APPEND_EN:
+            *(ViBoolean*)attrState = sess->fileAppendEn ? VI_TRUE : VI_FALSE;
+            return VI_SUCCESS;
         case VI_ATTR_RSRC_NAME:
-            strcpy((char*)attrState, sess->resource.raw);
+            snprintf((char*)attrState, OV_DESC_SIZE, "%s", ov_rsrc_raw(&sess->resource));
             return VI_SUCCESS;
         case VI_ATTR_INTF_TYPE:
             *(ViUInt16*)attrState = (ViUInt16)sess->resource.intfType;
@@ -400,7 +645,30 @@ ViStatus _VI_FUNC viGetAttribute(
         case VI_ATTR_RSRC_IMPL_VERSION:
             *(ViUInt32*)attrState = 0x00010000; /* 1.0.0 */
             return VI_SUCCESS;
+        case OV_ATTR_QUERY_CACHE_EN:
+        case OV_ATTR_QUERY_CACHE_HITS:
+        case OV_ATTR_QUERY_CACHE_MISSES:
+            return ov_qcache_get_attr(sess, attribute, attrState);
+        case OV_ATTR_STREAM_FILL:
+        case OV_ATTR_STREAM_HIGH_WATER:
+        case OV_ATTR_STREAM_OVERFLOWS:
+        case OV_ATTR_STREAM_DROPPED:
+        case OV_ATTR_STREAM_RECEIVED:
+        case OV_ATTR_STREAM_HUGE_PAGES:
+            return ov_stream_get_attr(sess, attribute, attrState);
+        case OV_ATTR_READ_AHEAD_EN:
+        case OV_ATTR_READ_AHEAD_HITS:
+            return ov_readahead_get_attr(sess, attribute, attrState);
+        case OV_ATTR_HOST_STATE:
+        case OV_ATTR_HOSTS_DOWN:
+            return ov_breaker_get_attr(sess, attribute, attrState);
+        case OV_ATTR_TCPIP_HISLIP:
+            if (sess->resource.intfType != OV_INTF_TCPIP) return VI_ERROR_NSUP_ATTR;
+            *(ViBoolean*)attrState = sess->resource.isHiSLIP ? VI_TRUE : VI_FALSE;
+            return VI_SUCCESS;
         default:
+            if (sess->transport && sess->transport->getAttribute)
+                return sess->transport->getAttribute(sess->transport, attribute, attrState);
             return VI_ERROR_NSUP_ATTR;
     }
 }
@@ -414,19 +682,50 @@ ViStatus _VI_FUNC viSetAttribute(
     switch (attribute) {
         case VI_ATTR_TMO_VALUE:
             sess->timeout = (ViUInt32)attrState;
-            return VI_SUCCESS;
+            break;
         case VI_ATTR_TERMCHAR:
             sess->termChar = (ViChar)(attrState & 0xFF);
-            return VI_SUCCESS;
+            break;
         case VI_ATTR_TERMCHAR_EN:
             sess->termCharEn = (attrState != 0);
-            return VI_SUCCESS;
+            break;
         case VI_ATTR_SEND_END_EN:
             sess->sendEndEn = (attrState != 0);
             return VI_SUCCESS;
+        case VI_ATTR_FILE_APPEND_EN:
+            sess->fileAppendEn = (attrState != 0);
+            return VI_SUCCESS;
+        case OV_ATTR_QUERY_CACHE_EN:
+            if (!attrState) {
+                ov_qcache_free(sess);
+                return VI_SUCCESS;
+            }
+            return sess->qcache ? VI_SUCCESS : ovQueryCacheEnable(vi, VI_NULL, 0);
+        case OV_ATTR_READ_AHEAD_EN:
+            return attrState ? ovReadAheadEnable(vi, 0) : ovReadAheadDisable(vi);
+        case OV_ATTR_QUERY_CACHE_HITS:
+        case OV_ATTR_QUERY_CACHE_MISSES:
+        case OV_ATTR_READ_AHEAD_HITS:
+        case OV_ATTR_STREAM_FILL:
+        case OV_ATTR_STREAM_HIGH_WATER:
+        case OV_ATTR_STREAM_OVERFLOWS:
+        case OV_ATTR_STREAM_DROPPED:
+        case OV_ATTR_STREAM_RECEIVED:
+        case OV_ATTR_STREAM_HUGE_PAGES:
+        case OV_ATTR_HOST_STATE:
+        case OV_ATTR_HOSTS_DOWN:
+        case OV_ATTR_TCPIP_HISLIP:
+            return VI_ERROR_ATTR_READONLY;
         default:
+            if (sess->transport && sess->transport->setAttribute)
+                return sess->transport->setAttribute(sess->transport, attribute, attrState);
             return VI_ERROR_NSUP_ATTR;
     }
+    /* Termination the transport may frame reads with itself; the timeout
+     * for transport calls that are not passed one */
+    if (sess->transport && sess->transport->setAttribute)
+        sess->transport->setAttribute(sess->transport, attribute, attrState);
+    return VI_SUCCESS;
 }
 
 ViStatus _VI_FUNC viStatusDesc(
@@ -450,6 +749,12 @@ ViStatus _VI_FUNC viStatusDesc(
         case VI_ERROR_ALLOC:         strcpy(desc, "Insufficient resources."); break;
         case VI_ERROR_NSUP_ATTR:     strcpy(desc, "Attribute not supported."); break;
         case VI_ERROR_NSUP_OPER:     strcpy(desc, "Operation not supported."); break;
+        case VI_ERROR_FILE_ACCESS:   strcpy(desc, "Unable to open or access the file."); break;
+        case VI_ERROR_FILE_IO:       strcpy(desc, "Error while reading or writing the file."); break;
+        case VI_ERROR_ABORT:         strcpy(desc, "Operation was aborted."); break;
+        case VI_ERROR_INV_JOB_ID:    strcpy(desc, "Job identifier is invalid."); break;
+        case VI_ERROR_NENABLED:      strcpy(desc, "Event not enabled for queueing."); break;
+        case VI_ERROR_INV_SETUP:     strcpy(desc, "Inconsistent or invalid setup."); break;
         default: snprintf(desc, 256, "Unknown status code: 0x%08X", (unsigned int)status); break;
     }
     return VI_SUCCESS;
@@ -461,15 +766,39 @@ ViStatus _VI_FUNC viParseRsrc(
     ViSession sesn, ViRsrc rsrcName,
     ViUInt16 *intfType, ViUInt16 *intfNum)
 {
+    if (!rsrcName) return VI_ERROR_INV_OBJECT;
     OvResource rsrc;
-    ViStatus st = ov_parse_rsrc(rsrcName, &rsrc);
+    ViStatus st = ov_rsrc_lookup(rsrcName, &rsrc, NULL);
     if (st != VI_SUCCESS) return st;
     if (intfType) *intfType = (ViUInt16)rsrc.intfType;
     if (intfNum) *intfNum = rsrc.intfNum;
+    ov_rsrc_release(&rsrc);
+    return VI_SUCCESS;
+}
+
+/* Output buffers are OV_DESC_SIZE (VI_FIND_BUFLEN) bytes; any may be NULL */
+ViStatus _VI_FUNC viParseRsrcEx(
+    ViSession sesn, ViRsrc rsrcName,
+    ViUInt16 *intfType, ViUInt16 *intfNum,
+    ViChar rsrcClass[], ViChar expandedUnaliasedName[],
+    ViChar aliasIfExists[])
+{
+    if (!rsrcName) return VI_ERROR_INV_OBJECT;
+    OvResource rsrc;
+    char alias[OV_DESC_SIZE];
+    ViStatus st = ov_rsrc_lookup(rsrcName, &rsrc, alias);
+    if (st != VI_SUCCESS) return st;
+    if (intfType) *intfType = (ViUInt16)rsrc.intfType;
+    if (intfNum) *intfNum = rsrc.intfNum;
+    if (rsrcClass) snprintf(rsrcClass, OV_DESC_SIZE, "%s", ov_rsrc_class(&rsrc));
+    if (expandedUnaliasedName) ov_rsrc_expand(&rsrc, expandedUnaliasedName, OV_DESC_SIZE);
+    if (aliasIfExists) memcpy(aliasIfExists, alias, strlen(alias) + 1);
+    ov_rsrc_release(&rsrc);
     return VI_SUCCESS;
 }
 
 /* viFindRsrc and viFindNext are implemented in core/discovery.c */
+/* viReadToFile and viWriteFromFile are implemented in core/fileio.c */
 
 /* Formatted I/O - basic implementation */
 ViStatus _VI_FUNCH viPrintf(ViSession vi, ViString writeFmt, ...) {
@@ -507,25 +836,16 @@ ViStatus _VI_FUNCH viQueryf(ViSession vi, ViString writeFmt, ViString readFmt, .
     return st;
 }
 
-/* Event stubs */
-ViStatus _VI_FUNC viEnableEvent(ViSession vi, ViEventType eventType, ViUInt16 mechanism, ViEventFilter context) {
-    return VI_SUCCESS; /* stub */
-}
-ViStatus _VI_FUNC viDisableEvent(ViSession vi, ViEventType eventType, ViUInt16 mechanism) {
-    return VI_SUCCESS;
-}
-ViStatus _VI_FUNC viDiscardEvents(ViSession vi, ViEventType eventType, ViUInt16 mechanism) {
-    return VI_SUCCESS;
-}
-ViStatus _VI_FUNC viWaitOnEvent(ViSession vi, ViEventType inEventType, ViUInt32 timeout, ViEventType *outEventType, ViEvent *outContext) {
-    return VI_ERROR_TMO;
-}
 ViStatus _VI_FUNC viLock(ViSession vi, ViAccessMode lockType, ViUInt32 timeout, ViKeyId requestedKey, ViChar accessKey[]) {
-    return VI_SUCCESS; /* stub - no locking yet */
+    /* Only transports shared with other processes can be contended */
+    OvSession *sess = ov_session_find(vi);
+    if (sess && sess->transport && sess->transport->lock && lockType == VI_EXCLUSIVE_LOCK)
+        return sess->transport->lock(sess->transport, timeout);
+    return VI_SUCCESS; /* stub - no in-process locking yet */
 }
 ViStatus _VI_FUNC viUnlock(ViSession vi) {
-    return VI_SUCCESS;
-}
-ViStatus _VI_FUNC viTerminate(ViSession vi, ViUInt16 degree, ViJobId jobId) {
+    OvSession *sess = ov_session_find(vi);
+    if (sess && sess->transport && sess->transport->unlock)
+        return sess->transport->unlock(sess->transport);
     return VI_SUCCESS;
 }
@@ -7,12 +7,21 @@
 
 #include "visa.h"
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
 
 /* Maximum concurrent sessions */
 #define OV_MAX_SESSIONS     256
 #define OV_MAX_FIND_LISTS   32
 #define OV_DESC_SIZE        256
 #define OV_BUF_SIZE         65536
+#define OV_MAX_EVENTS       224     /* open event contexts (core/async.c) */
+
+/* Handles carry their table slot in the low bits (see session.c): sessions,
+ * then find lists, then event contexts */
+#define OV_HANDLE_SLOT_BITS 9
+#define OV_HANDLE_SLOT_MASK ((1u << OV_HANDLE_SLOT_BITS) - 1)
+#define OV_EVENT_SLOT_BASE  (OV_MAX_SESSIONS + OV_MAX_FIND_LISTS)
 
 /* Interface type for resource string parsing */
 typedef enum {
@@ -20,27 +29,69 @@ typedef enum {
     OV_INTF_USB   = VI_INTF_USB,
     OV_INTF_ASRL  = VI_INTF_ASRL,
     OV_INTF_GPIB  = VI_INTF_GPIB,
+    OV_INTF_SIM   = 100,            /* OpenVISA: simulated instrument */
+    OV_INTF_PROXY = 101,            /* OpenVISA: instrument shared by openvisa-proxy */
+    OV_INTF_REMOTE = 102,           /* OpenVISA: resource of an openvisa-server (visa://) */
+    OV_INTF_UNIX  = 103,            /* OpenVISA: byte stream over a Unix domain socket */
+    OV_INTF_SHM   = 104,            /* OpenVISA: soft instrument behind shared-memory rings */
+    OV_INTF_PLUGIN = 200,           /* OpenVISA: first type of the ovTransportRegister prefixes */
 } OvIntfType;
 
-/* Parsed resource descriptor */
+/* Longest resource string ov_parse_rsrc accepts */
+#define OV_RSRC_MAX_LEN     1024
+
+/*
+ * Interned resource text: the original resource string followed by the
+ * string fields parsed out of it, each NUL-terminated.  Shared by every
+ * OvResource parsed from the same string and freed with the last of them.
+ */
+typedef struct OvRsrcStr {
+    struct OvRsrcStr *next;         /* intern table chain */
+    uint32_t    hash;
+    uint32_t    refs;
+    uint32_t    len;                /* bytes in text, NULs included */
+    char        text[];
+} OvRsrcStr;
+
+/* Parsed resource descriptor; string fields are offsets into str->text.
+ * Copies share str: take one with ov_rsrc_retain, drop it with ov_rsrc_release. */
 typedef struct {
+    OvRsrcStr  *str;                /* interned text; NULL after a failed parse */
     OvIntfType  intfType;
     ViUInt16    intfNum;            /* board number (usually 0) */
-    char        host[256];          /* TCPIP: hostname/IP */
     ViUInt16    port;               /* TCPIP: port (VXI-11=111, HiSLIP=4880, raw=5025) */
-    char        deviceName[256];    /* TCPIP: LAN device name (inst0, hislip0, ...) */
+    ViUInt16    hostOff;            /* TCPIP, visa://, ASRL on a terminal server: hostname/IP */
+    ViUInt16    deviceOff;          /* TCPIP: LAN device name (inst0, hislip0, ...); SIM/PROXY/SHM: name; visa://: remote resource; UNIX: socket path */
+    ViUInt16    usbSerialOff;       /* USB: serial number */
     ViUInt16    usbVid;             /* USB: vendor ID */
     ViUInt16    usbPid;             /* USB: product ID */
-    char        usbSerial[128];     /* USB: serial number */
     ViUInt16    usbIntfNum;         /* USB: interface number */
     int         comPort;            /* ASRL: COM port number */
     int         gpibAddr;           /* GPIB: primary address */
     int         gpibSecAddr;        /* GPIB: secondary address (-1 = none) */
     bool        isSocket;           /* TCPIP::host::port::SOCKET */
     bool        isHiSLIP;           /* TCPIP: hislip protocol */
-    char        raw[512];           /* original resource string */
 } OvResource;
 
+static inline const char *ov_rsrc_field(const OvResource *r, ViUInt16 off) {
+    return r->str ? r->str->text + off : "";
+}
+static inline const char *ov_rsrc_raw(const OvResource *r)       { return ov_rsrc_field(r, 0); }
+static inline const char *ov_rsrc_host(const OvResource *r)      { return ov_rsrc_field(r, r->hostOff); }
+static inline const char *ov_rsrc_device(const OvResource *r)    { return ov_rsrc_field(r, r->deviceOff); }
+static inline const char *ov_rsrc_usb_serial(const OvResource *r) { return ov_rsrc_field(r, r->usbSerialOff); }
+
+/* Live connection moved between processes by the broker (core/broker.c) */
+#define OV_CONN_MAX_FDS     2
+#define OV_CONN_STATE_SIZE  64
+
+typedef struct {
+    ViUInt32    nfds;
+    int         fds[OV_CONN_MAX_FDS];
+    ViUInt32    len;
+    ViByte      state[OV_CONN_STATE_SIZE];  /* transport-private: lid, session/message ID, ... */
+} OvConnState;
+
 /* Transport operations vtable */
 typedef struct OvTransport {
     ViStatus (*open)(struct OvTransport *self, const OvResource *rsrc, ViUInt32 timeout);
@@ -49,21 +100,69 @@ typedef struct OvTransport {
     ViStatus (*write)(struct OvTransport *self, ViBuf buf, ViUInt32 count, ViUInt32 *retCount);
     ViStatus (*readSTB)(struct OvTransport *self, ViUInt16 *status);
     ViStatus (*clear)(struct OvTransport *self);
+    /* Optional zero-copy file transfer on a POSIX fd positioned at the transfer
+     * offset; NULL = generic path in core/fileio.c */
+    ViStatus (*readToFile)(struct OvTransport *self, int fd, ViUInt32 count, ViUInt32 *retCount, ViUInt32 timeout);
+    ViStatus (*writeFromFile)(struct OvTransport *self, int fd, ViUInt32 count, ViUInt32 *retCount);
+    /* Optional protocol-native trigger; NULL = "*TRG\n" sent as data.
+     * triggerArm pre-builds the message.  peers are all transports of this
+     * kind in the trigger group, self included, and *leader arrives as self's
+     * index; a bus that addresses several devices in one command points it
+     * at the peer whose fire triggers them all.  triggerFire only transmits;
+     * triggerDone collects any reply. */
+    ViStatus (*triggerArm)(struct OvTransport *self, struct OvTransport *const peers[],
+                           ViUInt32 npeers, ViUInt32 *leader);
+    ViStatus (*triggerFire)(struct OvTransport *self);
+    ViStatus (*triggerDone)(struct OvTransport *self, ViUInt32 timeout);
+    /* Optional: how many unanswered queries the protocol lets a client have
+     * in flight before it must read (0 = no limit); NULL = no limit */
+    ViUInt32 (*maxPending)(struct OvTransport *self);
+    /* Optional exclusive lock held outside this process (viLock/viUnlock);
+     * NULL = no other process can reach the instrument through us */
+    ViStatus (*lock)(struct OvTransport *self, ViUInt32 timeout);
+    ViStatus (*unlock)(struct OvTransport *self);
+    /* Optional connection hand-off: detach moves the open sockets and protocol
+     * state into *cs without tearing the connection down (close() then only
+     * frees local resources); attach resumes such a connection, possibly in
+     * another process, and owns cs->fds even when it fails.  NULL = connections of this kind are not brokered */
+    ViStatus (*detach)(struct OvTransport *self, OvConnState *cs);
+    ViStatus (*attach)(struct OvTransport *self, const OvResource *rsrc, const OvConnState *cs);
+    /* Optional transport attributes (VI_ATTR_ASRL_*, ...) not kept in
+     * OvSession; setAttribute also sees VI_ATTR_TERMCHAR(_EN) and
+     * VI_ATTR_TMO_VALUE after the session stored them (the timeout once
+     * more after open).  NULL = VI_ERROR_NSUP_ATTR */
+    ViStatus (*setAttribute)(struct OvTransport *self, ViAttr attr, ViAttrState value);
+    ViStatus (*getAttribute)(struct OvTransport *self, ViAttr attr, void *value);
     void *impl;     /* transport-specific data */
 } OvTransport;
 
-/* Session object */
+typedef struct OvQueryCache OvQueryCache;
+typedef struct OvCoalescer  OvCoalescer;
+typedef struct OvAdaptiveTmo OvAdaptiveTmo;
+typedef struct OvAsync      OvAsync;
+typedef struct OvStream     OvStream;
+typedef struct OvReadAhead  OvReadAhead;
+
+/* Session object: what every viRead/viWrite touches comes first, in one
+ * cache line; the parsed resource and rarely used attributes follow */
 typedef struct {
+    ViSession   handle;             /* slot index in the low bits, see ov_session_find */
     bool        active;
-    bool        isRM;               /* true if this is the Resource Manager session */
-    ViSession   handle;
-    OvResource  resource;
-    OvTransport *transport;
-    /* Attributes */
-    ViUInt32    timeout;            /* VI_ATTR_TMO_VALUE */
-    ViChar      termChar;           /* VI_ATTR_TERMCHAR */
     bool        termCharEn;         /* VI_ATTR_TERMCHAR_EN */
     bool        sendEndEn;          /* VI_ATTR_SEND_END_EN */
+    ViChar      termChar;           /* VI_ATTR_TERMCHAR */
+    OvTransport *transport;
+    ViUInt32    timeout;            /* VI_ATTR_TMO_VALUE */
+    bool        isRM;               /* true if this is the Resource Manager session */
+    bool        fileAppendEn;       /* VI_ATTR_FILE_APPEND_EN */
+    int         brokerLease;        /* lease socket of a brokered connection, -1 = none */
+    OvResource  resource;
+    OvQueryCache *qcache;           /* ovQueryCacheEnable, NULL = off (core/qcache.c) */
+    OvCoalescer *coalesce;          /* ovCoalesceEnable, NULL = off (core/coalesce.c) */
+    OvAdaptiveTmo *adaptive;        /* ovAdaptiveTimeoutEnable, NULL = off (core/adaptive.c) */
+    OvAsync    *async;              /* async jobs and event state, NULL until used (core/async.c) */
+    OvStream   *stream;             /* ovStreamStart reader and ring, NULL = off (core/stream.c) */
+    OvReadAhead *readahead;         /* ovReadAheadEnable, NULL = off (core/readahead.c) */
 } OvSession;
 
 /* Find list for viFindRsrc */
@@ -88,15 +187,147 @@ OvState*    ov_state_get(void);
 OvSession*  ov_session_alloc(void);
 OvSession*  ov_session_find(ViSession handle);
 void        ov_session_free(OvSession *sess);
+ViUInt32    ov_handle_alloc(ViUInt32 slot);
 OvFindList* ov_findlist_alloc(void);
 OvFindList* ov_findlist_find(ViFindList handle);
 void        ov_findlist_free(OvFindList *fl);
 
-/* Resource string parser */
+/* Resource string parser: on success rsrc holds a reference to the
+ * interned text, on failure none (ov_rsrc_release is safe either way) */
 ViStatus    ov_parse_rsrc(const char *rsrcName, OvResource *rsrc);
+void        ov_rsrc_retain(OvResource *rsrc);
+void        ov_rsrc_release(OvResource *rsrc);
+
+/* Aliases and parse cache (core/alias.c): ov_rsrc_lookup resolves an alias
+ * and parses through an LRU cache; alias (OV_DESC_SIZE bytes, may be NULL)
+ * receives the alias used or the one naming the resource, else "".
+ * ov_rsrc_expand writes the canonical resource name. */
+ViStatus    ov_rsrc_lookup(const char *rsrcName, OvResource *rsrc, char alias[]);
+void        ov_rsrc_expand(const OvResource *rsrc, char *out, size_t size);
+const char* ov_rsrc_class(const OvResource *rsrc);
+void        ov_rsrc_cache_stats(ViUInt32 *hits, ViUInt32 *misses);
+
+/* Query response cache (core/qcache.c): viRead/viWrite divert to these
+ * while sess->qcache is set; ov_qcache_sent accounts for data written past
+ * ov_qcache_write (viWriteFromFile) */
+ViStatus    ov_qcache_write(OvSession *sess, ViBuf buf, ViUInt32 count, ViUInt32 *retCount);
+void        ov_qcache_sent(OvSession *sess, ViBuf buf, ViUInt32 count);
+ViStatus    ov_qcache_read(OvSession *sess, ViBuf buf, ViUInt32 count, ViUInt32 *retCount);
+ViStatus    ov_qcache_get_attr(OvSession *sess, ViAttr attr, void *value);
+void        ov_qcache_clear(OvSession *sess);
+void        ov_qcache_free(OvSession *sess);
+
+/* Write coalescing (core/coalesce.c).  Writes go through ov_session_write
+ * and anything else that reaches the transport calls ov_session_sync first,
+ * so held commands are sent before it. */
+ViStatus    ov_coalesce_write(OvSession *sess, ViBuf buf, ViUInt32 count, ViUInt32 *retCount);
+ViStatus    ov_coalesce_flush(OvSession *sess);
+void        ov_coalesce_free(OvSession *sess);
+
+/* Adaptive read timeouts (core/adaptive.c): ov_adaptive_sent notes a query
+ * written, ov_adaptive_timeout is how long the next read may wait for it,
+ * ov_adaptive_read reads with that (or timeout, if shorter) and
+ * ov_adaptive_clear forgets the responses owed after a device clear */
+void        ov_adaptive_sent(OvSession *sess, ViBuf buf, ViUInt32 count);
+ViUInt32    ov_adaptive_timeout(OvSession *sess);
+ViStatus    ov_adaptive_read(OvSession *sess, ViBuf buf, ViUInt32 count, ViUInt32 *retCount,
+                             ViUInt32 timeout);
+void        ov_adaptive_clear(OvSession *sess);
+void        ov_adaptive_free(OvSession *sess);
+
+/* Asynchronous I/O and events (core/async.c): ov_async_free drops queued
+ * jobs and events and waits out a job in progress; event contexts are
+ * looked up by viGetAttribute/viClose when the handle is no session */
+void        ov_async_free(OvSession *sess);
+ViStatus    ov_event_get_attr(ViEvent event, ViAttr attr, void *value);
+ViStatus    ov_event_close(ViEvent event);
+
+/* Streaming (core/stream.c): while sess->stream is set a reader thread owns
+ * the transport's input side and viRead copies out of its ring; other
+ * operations that would touch it return VI_ERROR_IN_PROGRESS */
+ViStatus    ov_stream_read(OvSession *sess, ViBuf buf, ViUInt32 count, ViUInt32 *retCount);
+ViStatus    ov_stream_get_attr(OvSession *sess, ViAttr attr, void *value);
+void        ov_stream_free(OvSession *sess);
+
+/* Speculative read-ahead (core/readahead.c): ov_readahead_sent starts
+ * receiving the response to a query written, ov_readahead_read serves
+ * viRead from it, ov_readahead_wait lets a read in flight finish before
+ * anything else reaches the transport, ov_readahead_cancel stops it instead
+ * (the response is left to the next viRead) */
+void        ov_readahead_sent(OvSession *sess, ViBuf buf, ViUInt32 count);
+void        ov_readahead_wait(OvSession *sess);
+void        ov_readahead_cancel(OvSession *sess);
+ViStatus    ov_readahead_read(OvSession *sess, ViBuf buf, ViUInt32 count, ViUInt32 *retCount);
+ViStatus    ov_readahead_get_attr(OvSession *sess, ViAttr attr, void *value);
+void        ov_readahead_clear(OvSession *sess);
+void        ov_readahead_free(OvSession *sess);
+
+/* Host circuit breaker (core/breaker.c): viOpen asks ov_breaker_check before
+ * opening a TCPIP resource and tells ov_breaker_report how the transport
+ * open went */
+ViStatus    ov_breaker_check(const OvResource *rsrc);
+void        ov_breaker_report(const OvResource *rsrc, ViStatus status);
+ViStatus    ov_breaker_get_attr(OvSession *sess, ViAttr attr, void *value);
+
+/* HiSLIP / VXI-11 auto-selection (core/autoproto.c): ov_autoproto_select
+ * may turn a plain VXI-11 INSTR resource into hislip0 and sets *switched;
+ * ov_autoproto_forget drops the host's choice after a failed open */
+ViStatus    ov_autoproto_select(OvResource *rsrc, ViUInt32 timeout, bool *switched);
+void        ov_autoproto_forget(const OvResource *rsrc);
+
+/* Stream transports hand back whatever arrived, so VI_SUCCESS from a read
+ * does not end the message; message transports return a whole message (or
+ * count bytes) per read call. */
+static inline bool ov_session_is_stream(const OvSession *sess) {
+    return sess->resource.isSocket || sess->resource.intfType == OV_INTF_ASRL;
+}
+
+static inline ViStatus ov_session_sync(OvSession *sess) {
+    if (sess->readahead) ov_readahead_wait(sess);
+    return sess->coalesce ? ov_coalesce_flush(sess) : VI_SUCCESS;
+}
+
+/* Message I/O below the query cache: what viWrite/viRead do once a request
+ * has to reach the instrument */
+static inline ViStatus ov_session_write(OvSession *sess, ViBuf buf, ViUInt32 count, ViUInt32 *retCount) {
+    if (sess->readahead) ov_readahead_wait(sess);
+    ViStatus st = sess->coalesce ? ov_coalesce_write(sess, buf, count, retCount)
+                                 : sess->transport->write(sess->transport, buf, count, retCount);
+    if (sess->adaptive && st >= VI_SUCCESS) ov_adaptive_sent(sess, buf, count);
+    if (sess->readahead && st >= VI_SUCCESS) ov_readahead_sent(sess, buf, count);
+    return st;
+}
+
+/* One read from the transport waiting at most timeout, nothing flushed first */
+static inline ViStatus ov_session_receive(OvSession *sess, ViBuf buf, ViUInt32 count, ViUInt32 *retCount,
+                                          ViUInt32 timeout) {
+    if (sess->adaptive) return ov_adaptive_read(sess, buf, count, retCount, timeout);
+    return sess->transport->read(sess->transport, buf, count, retCount, timeout);
+}
+
+static inline ViStatus ov_session_read(OvSession *sess, ViBuf buf, ViUInt32 count, ViUInt32 *retCount) {
+    if (sess->readahead) return ov_readahead_read(sess, buf, count, retCount);
+    ViStatus st = ov_session_sync(sess);
+    if (st < VI_SUCCESS) return st;
+    return ov_session_receive(sess, buf, count, retCount, sess->timeout);
+}
+
+/* Connection broker client (core/broker.c) */
+ViStatus    ov_broker_checkout(const OvResource *rsrc, ViUInt32 timeout, OvConnState *cs, int *lease);
+void        ov_broker_checkin(int lease, const OvConnState *cs);
+
+/* In-process connection reuse pool (core/connpool.c): take attaches a parked
+ * connection to t; park detaches t's connection (close() then only frees
+ * local state).  Both return false when nothing moved. */
+bool        ov_pool_take(const OvResource *rsrc, OvTransport *t);
+bool        ov_pool_park(const OvResource *rsrc, OvTransport *t);
 
 /* Transport factory */
 OvTransport* ov_transport_create(OvIntfType type);
 OvTransport* ov_transport_create_for_rsrc(const OvResource *rsrc);
 
+/* Length of the ovTransportRegister prefix rsrcName starts with (followed
+ * by an optional board number and "::"), its type in *type; 0 = none */
+int         ov_plugin_match(const char *rsrcName, OvIntfType *type);
+
 #endif /* OPENVISA_SESSION_H */
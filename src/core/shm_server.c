@@ -0,0 +1,209 @@
+/*
+ * OpenVISA - Soft-instrument side of SHM::<name>::INSTR
+ *
+ * A process implementing an instrument creates the shared memory object with
+ * ovShmServerCreate, then loops: ovShmServerRead a command, answer with
+ * ovShmServerWrite (or build the answer in place with ovShmServerReserve /
+ * ovShmServerCommit, so a block costs only the client's copy out of the
+ * ring).  One thread per server; ring layout in shmring.h.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE
+#endif
+
+#include "shmring.h"
+#include "openvisa.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef __linux__
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+struct OvShmServer {
+    OvShmHeader *hdr;
+    size_t       map_size;
+    OvShmRing    cmd, rsp;
+    char         path[96];
+    uint16_t     gen;           /* generation of the client being answered */
+    uint32_t     rec_off;       /* bytes of the current command record already read */
+};
+
+ViStatus _VI_FUNC ovShmServerCreate(ViConstString name, ViUInt32 ringSize, OvShmServer **server) {
+    if (!name || !server || !*name || strchr(name, '/')) return VI_ERROR_INV_RSRC_NAME;
+    *server = NULL;
+    uint32_t ring = OVSHM_MIN_RING;
+    if (ringSize == 0) ringSize = OVSHM_DEFAULT_RING;
+    if (ringSize > OVSHM_MAX_RING) return VI_ERROR_INV_SIZE;
+    while (ring < ringSize) ring <<= 1;
+
+    OvShmServer *s = (OvShmServer *)calloc(1, sizeof(OvShmServer));
+    if (!s) return VI_ERROR_ALLOC;
+    snprintf(s->path, sizeof(s->path), "%s%s", OVSHM_PREFIX, name);
+    s->map_size = OVSHM_MAP_SIZE(ring);
+
+    /* Replace whatever a crashed predecessor left behind */
+    shm_unlink(s->path);
+    int fd = shm_open(s->path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0) { free(s); return VI_ERROR_SYSTEM_ERROR; }
+    if (ftruncate(fd, (off_t)s->map_size) != 0) {
+        close(fd);
+        shm_unlink(s->path);
+        free(s);
+        return VI_ERROR_ALLOC;
+    }
+    s->hdr = (OvShmHeader *)mmap(NULL, s->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (s->hdr == MAP_FAILED) {
+        shm_unlink(s->path);
+        free(s);
+        return VI_ERROR_ALLOC;
+    }
+
+    s->hdr->version    = OVSHM_VERSION;
+    s->hdr->ring_size  = ring;
+    s->hdr->server_pid = (uint32_t)getpid();
+    ovshm_rings(s->hdr, &s->cmd, &s->rsp);
+    __atomic_store_n(&s->hdr->magic, OVSHM_MAGIC, __ATOMIC_RELEASE);   /* clients check it last */
+    *server = s;
+    return VI_SUCCESS;
+}
+
+/*
+ * Next piece of the client's message: VI_SUCCESS once its end was copied,
+ * VI_SUCCESS_MAX_CNT if buf filled first.  Waits up to timeout ms.
+ */
+ViStatus _VI_FUNC ovShmServerRead(OvShmServer *s, ViBuf buf, ViUInt32 count,
+                                  ViUInt32 *retCount, ViUInt32 timeout) {
+    if (!s || (!buf && count)) return VI_ERROR_INV_OBJECT;
+    if (retCount) *retCount = 0;
+    uint64_t deadline = ovshm_deadline(timeout);
+    ViUInt32 total = 0;
+
+    for (;;) {
+        const OvShmRec *rec = ovshm_peek(&s->cmd, deadline);
+        if (!rec) {
+            if (retCount) *retCount = total;
+            return total ? VI_SUCCESS_MAX_CNT : VI_ERROR_TMO;
+        }
+        /* Commands of a client that has since been replaced are dropped */
+        uint16_t cur = (uint16_t)__atomic_load_n(&s->hdr->connect_seq, __ATOMIC_ACQUIRE);
+        if (rec->gen != cur) {
+            ovshm_consume(&s->cmd, rec);
+            continue;
+        }
+        if (s->gen != cur) {
+            s->gen = cur;
+            s->rec_off = 0;
+            total = 0;
+        }
+        uint32_t n = rec->len - s->rec_off;
+        if (n > count - total) n = count - total;
+        memcpy(buf + total, (const uint8_t *)(rec + 1) + s->rec_off, n);
+        total += n;
+        s->rec_off += n;
+        if (s->rec_off < rec->len) {
+            if (retCount) *retCount = total;
+            return VI_SUCCESS_MAX_CNT;
+        }
+        bool end = rec->flags & OVSHM_F_END;
+        s->rec_off = 0;
+        ovshm_consume(&s->cmd, rec);
+        if (end || total == count) {
+            if (retCount) *retCount = total;
+            return end ? VI_SUCCESS : VI_SUCCESS_MAX_CNT;
+        }
+    }
+}
+
+ViStatus _VI_FUNC ovShmServerReserve(OvShmServer *s, ViUInt32 want, ViBuf *ptr,
+                                     ViUInt32 *size, ViUInt32 timeout) {
+    if (!s || !ptr || !size) return VI_ERROR_INV_OBJECT;
+    uint32_t avail;
+    if (!ovshm_reserve(&s->rsp, want, ptr, &avail, ovshm_deadline(timeout))) return VI_ERROR_TMO;
+    *size = avail;
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovShmServerCommit(OvShmServer *s, ViUInt32 count, ViBoolean end) {
+    if (!s) return VI_ERROR_INV_OBJECT;
+    ovshm_commit(&s->rsp, count, end ? OVSHM_F_END : 0, s->gen);
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovShmServerWrite(OvShmServer *s, ViConstBuf buf, ViUInt32 count,
+                                   ViBoolean end, ViUInt32 timeout) {
+    if (!s || (!buf && count)) return VI_ERROR_INV_OBJECT;
+    uint64_t deadline = ovshm_deadline(timeout);
+    ViUInt32 done = 0;
+    do {
+        uint8_t *p;
+        uint32_t avail;
+        if (!ovshm_reserve(&s->rsp, count - done, &p, &avail, deadline)) return VI_ERROR_TMO;
+        memcpy(p, buf + done, avail);
+        done += avail;
+        ovshm_commit(&s->rsp, avail, (end && done == count) ? OVSHM_F_END : 0, s->gen);
+    } while (done < count);
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovShmServerSetStatus(OvShmServer *s, ViUInt16 stb) {
+    if (!s) return VI_ERROR_INV_OBJECT;
+    __atomic_store_n(&s->hdr->stb, (uint32_t)stb, __ATOMIC_RELEASE);
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovShmServerClose(OvShmServer *s) {
+    if (!s) return VI_ERROR_INV_OBJECT;
+    shm_unlink(s->path);
+    __atomic_store_n(&s->hdr->server_pid, 0, __ATOMIC_RELEASE);    /* clients report CONN_LOST */
+    munmap(s->hdr, s->map_size);
+    free(s);
+    return VI_SUCCESS;
+}
+
+#else  /* !__linux__ — futexes are Linux-only */
+
+ViStatus _VI_FUNC ovShmServerCreate(ViConstString name, ViUInt32 ringSize, OvShmServer **server) {
+    (void)name; (void)ringSize;
+    if (server) *server = NULL;
+    return VI_ERROR_NSUP_OPER;
+}
+
+ViStatus _VI_FUNC ovShmServerRead(OvShmServer *s, ViBuf buf, ViUInt32 count,
+                                  ViUInt32 *retCount, ViUInt32 timeout) {
+    (void)s; (void)buf; (void)count; (void)retCount; (void)timeout;
+    return VI_ERROR_NSUP_OPER;
+}
+
+ViStatus _VI_FUNC ovShmServerReserve(OvShmServer *s, ViUInt32 want, ViBuf *ptr,
+                                     ViUInt32 *size, ViUInt32 timeout) {
+    (void)s; (void)want; (void)ptr; (void)size; (void)timeout;
+    return VI_ERROR_NSUP_OPER;
+}
+
+ViStatus _VI_FUNC ovShmServerCommit(OvShmServer *s, ViUInt32 count, ViBoolean end) {
+    (void)s; (void)count; (void)end;
+    return VI_ERROR_NSUP_OPER;
+}
+
+ViStatus _VI_FUNC ovShmServerWrite(OvShmServer *s, ViConstBuf buf, ViUInt32 count,
+                                   ViBoolean end, ViUInt32 timeout) {
+    (void)s; (void)buf; (void)count; (void)end; (void)timeout;
+    return VI_ERROR_NSUP_OPER;
+}
+
+ViStatus _VI_FUNC ovShmServerSetStatus(OvShmServer *s, ViUInt16 stb) {
+    (void)s; (void)stb;
+    return VI_ERROR_NSUP_OPER;
+}
+
+ViStatus _VI_FUNC ovShmServerClose(OvShmServer *s) {
+    (void)s;
+    return VI_ERROR_NSUP_OPER;
+}
+
+#endif
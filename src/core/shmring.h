@@ -0,0 +1,258 @@
+/*
+ * OpenVISA - Shared-memory rings for SHM::<name>::INSTR
+ *
+ * Shared by the client transport (transport/shm.c) and the soft-instrument
+ * side (core/shm_server.c).  The instrument creates the POSIX shared memory
+ * object "/openvisa-shm-<name>": a header, then two single-producer /
+ * single-consumer byte rings, cmd (client -> instrument) and rsp (instrument
+ * -> client).  Linux only: waiting uses futexes on the shared words.
+ *
+ * A ring carries 8-byte aligned records {len, flags, gen} + payload that
+ * never wrap; a PAD record fills the tail of the ring when the next record
+ * would not fit before the end.  END marks the last record of a message.
+ * gen is the connection generation: a client bumps connect_seq on open and
+ * stamps its commands with it; the instrument skips commands of an older
+ * generation and stamps responses with the one it is answering, so a new
+ * client skips whatever was meant for its predecessor.
+ *
+ * Producers publish head with a release store and bump data_seq; consumers
+ * publish tail and bump space_seq.  A waiter spins briefly (multi-core
+ * only), then sets the waiters word and sleeps on the seq futex, so the
+ * other side issues a wake syscall only when somebody actually sleeps.
+ */
+
+#ifndef OPENVISA_SHMRING_H
+#define OPENVISA_SHMRING_H
+
+#include "visa.h"
+#include "thread.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef __linux__
+
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#define OVSHM_MAGIC         0x4F56534Du     /* "OVSM" */
+#define OVSHM_VERSION       1u
+#define OVSHM_PREFIX        "/openvisa-shm-"
+#define OVSHM_DEFAULT_RING  (1u << 20)
+#define OVSHM_MIN_RING      4096u
+#define OVSHM_MAX_RING      (256u << 20)
+#define OVSHM_REC_HDR       8u
+#define OVSHM_PAD_MIN       64u             /* pad instead of leaving a sliver at the end */
+#define OVSHM_SPIN_NS       50000u
+
+#define OVSHM_F_END         0x0001
+#define OVSHM_F_PAD         0x0002
+
+typedef struct {
+    uint32_t len;
+    uint16_t flags;
+    uint16_t gen;
+} OvShmRec;
+
+/* One cache line per side so producer and consumer never share a line */
+typedef struct {
+    uint64_t head;              /* bytes produced */
+    uint32_t data_seq;          /* futex: bumped after each publish */
+    uint32_t data_waiters;
+    uint8_t  pad0[48];
+    uint64_t tail;              /* bytes consumed */
+    uint32_t space_seq;         /* futex: bumped after each consume */
+    uint32_t space_waiters;
+    uint8_t  pad1[48];
+} OvShmRingCtl;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t ring_size;         /* bytes per ring, power of two */
+    uint32_t server_pid;
+    uint32_t client_pid;        /* connected client, 0 = free */
+    uint32_t connect_seq;       /* bumped by a connecting client */
+    uint32_t stb;               /* status byte, served without a round trip */
+    uint8_t  pad[36];
+    OvShmRingCtl cmd;
+    OvShmRingCtl rsp;
+} OvShmHeader;
+
+/* cmd ring data follows the header, rsp ring data follows cmd */
+#define OVSHM_MAP_SIZE(ring)    (sizeof(OvShmHeader) + 2 * (size_t)(ring))
+
+typedef struct {
+    OvShmRingCtl *ctl;
+    uint8_t      *data;
+    uint32_t      size;
+} OvShmRing;
+
+static inline void ovshm_rings(OvShmHeader *h, OvShmRing *cmd, OvShmRing *rsp) {
+    uint8_t *base = (uint8_t *)(h + 1);
+    cmd->ctl = &h->cmd;  cmd->data = base;                cmd->size = h->ring_size;
+    rsp->ctl = &h->rsp;  rsp->data = base + h->ring_size; rsp->size = h->ring_size;
+}
+
+static inline uint32_t ovshm_align8(uint32_t n) { return (n + 7u) & ~7u; }
+
+/* ========== Futex wait / wake ========== */
+
+static inline void ovshm_futex_wait(uint32_t *addr, uint32_t val, uint64_t deadline_ns, uint64_t now_ns) {
+    struct timespec ts, *tp = NULL;
+    if (deadline_ns != UINT64_MAX) {
+        uint64_t d = deadline_ns > now_ns ? deadline_ns - now_ns : 0;
+        ts.tv_sec  = (time_t)(d / 1000000000u);
+        ts.tv_nsec = (long)(d % 1000000000u);
+        tp = &ts;
+    }
+    syscall(SYS_futex, addr, FUTEX_WAIT, val, tp, NULL, 0);
+}
+
+static inline void ovshm_futex_wake(uint32_t *addr) {
+    syscall(SYS_futex, addr, FUTEX_WAKE, 0x7FFFFFFF, NULL, NULL, 0);
+}
+
+static inline uint64_t ovshm_deadline(uint32_t timeout_ms) {
+    return timeout_ms == VI_TMO_INFINITE ? UINT64_MAX : ov_time_ns() + (uint64_t)timeout_ms * 1000000u;
+}
+
+static inline void ovshm_cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/* Spinning only pays when the other side can run at the same time */
+static inline bool ovshm_may_spin(void) {
+    static int ncpu;
+    if (!ncpu) ncpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    return ncpu > 1;
+}
+
+/*
+ * Wait until *word != old (word: the other side's head/tail).  Returns
+ * false on deadline.
+ */
+static inline bool ovshm_wait(const uint64_t *word, uint64_t old, uint32_t *seq,
+                              uint32_t *waiters, uint64_t deadline_ns) {
+    if (__atomic_load_n(word, __ATOMIC_ACQUIRE) != old) return true;
+    uint64_t now = ov_time_ns();
+    if (ovshm_may_spin()) {
+        uint64_t spin_end = now + OVSHM_SPIN_NS;
+        while (now < spin_end && now < deadline_ns) {
+            for (int i = 0; i < 64; i++) {
+                if (__atomic_load_n(word, __ATOMIC_ACQUIRE) != old) return true;
+                ovshm_cpu_relax();
+            }
+            now = ov_time_ns();
+        }
+    }
+    for (;;) {
+        uint32_t s = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+        __atomic_store_n(waiters, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(word, __ATOMIC_SEQ_CST) != old) {
+            __atomic_store_n(waiters, 0, __ATOMIC_RELAXED);
+            return true;
+        }
+        if (now >= deadline_ns) {
+            __atomic_store_n(waiters, 0, __ATOMIC_RELAXED);
+            return false;
+        }
+        ovshm_futex_wait(seq, s, deadline_ns, now);
+        now = ov_time_ns();
+    }
+}
+
+static inline void ovshm_signal(uint32_t *seq, uint32_t *waiters) {
+    __atomic_fetch_add(seq, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(waiters, __ATOMIC_SEQ_CST)) {
+        __atomic_store_n(waiters, 0, __ATOMIC_RELAXED);
+        ovshm_futex_wake(seq);
+    }
+}
+
+/* ========== Producer ========== */
+
+/*
+ * Contiguous space for a record payload of up to want bytes (at least
+ * min(want, size / 4) once the consumer makes room).  *ptr points into the
+ * ring; fill it and call ovshm_commit.  Returns false on deadline.
+ */
+static inline bool ovshm_reserve(OvShmRing *r, uint32_t want, uint8_t **ptr, uint32_t *avail,
+                                 uint64_t deadline_ns) {
+    OvShmRingCtl *c = r->ctl;
+    uint32_t need = OVSHM_REC_HDR + ovshm_align8(want < r->size / 4 ? (want ? want : 1) : r->size / 4);
+    for (;;) {
+        uint64_t head = c->head;
+        uint64_t tail = __atomic_load_n(&c->tail, __ATOMIC_ACQUIRE);
+        uint32_t free_bytes = r->size - (uint32_t)(head - tail);
+        uint32_t pos = (uint32_t)(head & (r->size - 1));
+        uint32_t contig = r->size - pos;
+
+        if (contig < need && free_bytes >= contig) {
+            OvShmRec pad = { contig - OVSHM_REC_HDR, OVSHM_F_PAD, 0 };
+            memcpy(r->data + pos, &pad, sizeof(pad));
+            __atomic_store_n(&c->head, head + contig, __ATOMIC_RELEASE);
+            continue;
+        }
+        if (free_bytes >= need) {
+            uint32_t a = (free_bytes < contig ? free_bytes : contig) - OVSHM_REC_HDR;
+            *ptr = r->data + pos + OVSHM_REC_HDR;
+            *avail = a < want ? a : want;
+            return true;
+        }
+        if (!ovshm_wait(&c->tail, tail, &c->space_seq, &c->space_waiters, deadline_ns))
+            return false;
+    }
+}
+
+static inline void ovshm_commit(OvShmRing *r, uint32_t len, uint16_t flags, uint16_t gen) {
+    OvShmRingCtl *c = r->ctl;
+    uint64_t head = c->head;
+    OvShmRec rec = { len, flags, gen };
+    memcpy(r->data + (head & (r->size - 1)), &rec, sizeof(rec));
+    __atomic_store_n(&c->head, head + OVSHM_REC_HDR + ovshm_align8(len), __ATOMIC_RELEASE);
+    ovshm_signal(&c->data_seq, &c->data_waiters);
+}
+
+/* ========== Consumer ========== */
+
+/* Next record (PAD records skipped), NULL on deadline */
+static inline const OvShmRec *ovshm_peek(OvShmRing *r, uint64_t deadline_ns) {
+    OvShmRingCtl *c = r->ctl;
+    for (;;) {
+        uint64_t tail = c->tail;
+        if (__atomic_load_n(&c->head, __ATOMIC_ACQUIRE) != tail) {
+            const OvShmRec *rec = (const OvShmRec *)(r->data + (tail & (r->size - 1)));
+            if (!(rec->flags & OVSHM_F_PAD)) return rec;
+            __atomic_store_n(&c->tail, tail + OVSHM_REC_HDR + rec->len, __ATOMIC_RELEASE);
+            ovshm_signal(&c->space_seq, &c->space_waiters);
+            continue;
+        }
+        if (!ovshm_wait(&c->head, tail, &c->data_seq, &c->data_waiters, deadline_ns))
+            return NULL;
+    }
+}
+
+/* Release the record returned by ovshm_peek */
+static inline void ovshm_consume(OvShmRing *r, const OvShmRec *rec) {
+    OvShmRingCtl *c = r->ctl;
+    __atomic_store_n(&c->tail, c->tail + OVSHM_REC_HDR + ovshm_align8(rec->len), __ATOMIC_RELEASE);
+    ovshm_signal(&c->space_seq, &c->space_waiters);
+}
+
+/* Drop everything queued (consumer side) */
+static inline void ovshm_discard(OvShmRing *r) {
+    OvShmRingCtl *c = r->ctl;
+    __atomic_store_n(&c->tail, __atomic_load_n(&c->head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+    ovshm_signal(&c->space_seq, &c->space_waiters);
+}
+
+#endif /* __linux__ */
+
+#endif /* OPENVISA_SHMRING_H */
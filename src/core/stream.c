@@ -0,0 +1,380 @@
+/*
+ * OpenVISA - Continuous streaming into an SPSC ring  (ovStream*)
+ *
+ * For instruments that push data without being asked (digitizers, DAQ
+ * front ends on raw sockets or HiSLIP).  ovStreamStart gives the session a
+ * reader thread that keeps calling the transport's read and appends what
+ * arrives to a large power-of-two ring, so the connection is drained even
+ * while the application is busy.  The application is the single consumer:
+ * ovStreamAcquire hands out the contiguous run of unread bytes in place and
+ * ovStreamRelease gives it back; viRead copies out of the ring instead.
+ *
+ * The ring is lock-free: head is written only by the reader, tail only by
+ * the consumer, each on its own cache line.  A consumer that finds the ring
+ * empty sleeps on a condition variable after announcing itself in the
+ * waiting word, so the reader takes the mutex only when somebody sleeps.
+ * When the ring is full the reader keeps draining the transport and drops
+ * what does not fit, counting bytes and overflow events.
+ *
+ * The reader reads straight into the ring while at least ST_CHUNK bytes
+ * are free before the end, and through a staging chunk otherwise (near the
+ * wrap or nearly full), so a message-framed transport never truncates a
+ * read to a sliver.  Ring memory is mapped pre-faulted, on huge pages when
+ * OV_STREAM_HUGE_PAGES asks and the system has them to give.
+ */
+
+#include "session.h"
+#include "thread.h"
+#include "openvisa.h"
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef OPENVISA_WINDOWS
+    #include <malloc.h>
+#else
+    #include <sys/mman.h>
+#endif
+
+#define ST_DEFAULT_RING     (16u << 20)
+#define ST_MIN_RING         (64u << 10)
+#define ST_MAX_RING         (1u << 30)
+#define ST_CHUNK            (64u << 10)     /* staging buffer, direct-read threshold */
+#define ST_MAX_READ         (256u << 10)    /* largest single transport read */
+#define ST_POLL_MS          100             /* transport read timeout: bounds ovStreamStop */
+#define ST_HUGE_PAGE        (2u << 20)
+
+/* Producer and consumer fields on separate cache lines */
+struct OvStream {
+    /* written by the reader */
+    volatile uint64_t head;             /* bytes appended */
+    volatile uint64_t received;         /* bytes read from the transport */
+    volatile uint64_t dropped;          /* bytes read while the ring was full */
+    volatile uint32_t overflows;        /* reads that dropped bytes */
+    volatile uint32_t high_water;       /* most bytes ever unread */
+    volatile uint32_t done;             /* reader has exited */
+    ViStatus    status;                 /* why the reader exited */
+    uint8_t     pad0[24];
+
+    /* written by the consumer */
+    volatile uint64_t tail;             /* bytes released */
+    volatile uint32_t waiting;          /* consumer asleep on cond */
+    uint8_t     pad1[52];
+
+    /* set up by ovStreamStart */
+    ViByte     *data;
+    ViUInt32    size;                   /* power of two */
+    size_t      map_len;
+    bool        huge;                   /* data is on huge pages */
+    volatile uint32_t stop;
+    OvTransport *transport;
+    OvThread    thread;
+    OvMutex     lock;
+    OvCond      cond;
+    ViByte     *staging;                /* ST_CHUNK */
+};
+
+/* ========== Ring memory ========== */
+
+static void *st_aligned_alloc(size_t size) {
+#ifdef OPENVISA_WINDOWS
+    return _aligned_malloc(size, 64);
+#else
+    void *p = NULL;
+    return posix_memalign(&p, 64, size) == 0 ? p : NULL;
+#endif
+}
+
+static void st_aligned_free(void *p) {
+#ifdef OPENVISA_WINDOWS
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+/* Page-aligned, pre-faulted ring memory; *huge tells whether huge pages
+ * backed it */
+static ViByte *st_map(ViUInt32 size, bool want_huge, size_t *map_len, bool *huge) {
+    *huge = false;
+#ifdef OPENVISA_WINDOWS
+    SIZE_T large = want_huge ? GetLargePageMinimum() : 0;
+    if (large) {
+        SIZE_T len = ((SIZE_T)size + large - 1) & ~(large - 1);
+        void *p = VirtualAlloc(NULL, len, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (p) {
+            *map_len = len;
+            *huge = true;
+            return (ViByte *)p;
+        }
+    }
+    void *p = VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!p) return NULL;
+    memset(p, 0, size);
+    *map_len = size;
+    return (ViByte *)p;
+#else
+    int populate = 0;
+#ifdef MAP_POPULATE
+    populate = MAP_POPULATE;
+#endif
+#ifdef MAP_HUGETLB
+    if (want_huge) {
+        size_t len = ((size_t)size + ST_HUGE_PAGE - 1) & ~(size_t)(ST_HUGE_PAGE - 1);
+        void *p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | populate, -1, 0);
+        if (p != MAP_FAILED) {
+            *map_len = len;
+            *huge = true;
+            return (ViByte *)p;
+        }
+    }
+#endif
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return NULL;
+#ifdef MADV_HUGEPAGE
+    /* No reserved huge pages: let transparent huge pages back it instead */
+    if (want_huge) madvise(p, size, MADV_HUGEPAGE);
+#endif
+    memset(p, 0, size);
+    *map_len = size;
+    return (ViByte *)p;
+#endif
+}
+
+static void st_unmap(ViByte *p, size_t len) {
+#ifdef OPENVISA_WINDOWS
+    (void)len;
+    VirtualFree(p, 0, MEM_RELEASE);
+#else
+    munmap(p, len);
+#endif
+}
+
+static void st_destroy(OvStream *s) {
+    if (s->data) st_unmap(s->data, s->map_len);
+    free(s->staging);
+    ov_cond_destroy(&s->cond);
+    ov_mutex_destroy(&s->lock);
+    st_aligned_free(s);
+}
+
+/* ========== Reader (producer) ========== */
+
+/* Wake the consumer if it is asleep; call after publishing head or done */
+static void st_wake(OvStream *s) {
+    ov_atomic_fence();
+    if (ov_atomic_load32(&s->waiting)) {
+        ov_mutex_lock(&s->lock);
+        ov_cond_broadcast(&s->cond);
+        ov_mutex_unlock(&s->lock);
+    }
+}
+
+/* Append n staged bytes, dropping what does not fit */
+static ViUInt32 st_copy_in(OvStream *s, uint64_t head, ViUInt32 space, const ViByte *src, ViUInt32 n) {
+    ViUInt32 keep = n < space ? n : space;
+    ViUInt32 pos = (ViUInt32)(head & (s->size - 1));
+    ViUInt32 first = s->size - pos < keep ? s->size - pos : keep;
+    memcpy(s->data + pos, src, first);
+    memcpy(s->data, src + first, keep - first);
+    return keep;
+}
+
+static void *st_reader(void *arg) {
+    OvStream *s = (OvStream *)arg;
+    OvTransport *t = s->transport;
+    ViStatus status = VI_SUCCESS;
+
+    while (!ov_atomic_load32(&s->stop)) {
+        uint64_t head = s->head;
+        ViUInt32 space = s->size - (ViUInt32)(head - ov_atomic_load64(&s->tail));
+        ViUInt32 pos = (ViUInt32)(head & (s->size - 1));
+        ViUInt32 contig = s->size - pos < space ? s->size - pos : space;
+        bool direct = contig >= ST_CHUNK;
+        ViBuf dst = direct ? s->data + pos : s->staging;
+        ViUInt32 want = direct ? (contig < ST_MAX_READ ? contig : ST_MAX_READ) : ST_CHUNK;
+
+        ViUInt32 n = 0;
+        uint64_t t0 = ov_time_ns();
+        ViStatus st = t->read(t, dst, want, &n, ST_POLL_MS);
+        if (st == VI_ERROR_TMO) {
+            /* Transports that fail at once with nothing to read (SIM) */
+            if (ov_time_ns() - t0 < 1000000) ov_sleep_ms(1);
+            continue;
+        }
+        if (st < VI_SUCCESS) {
+            status = st;
+            break;
+        }
+        if (n == 0) continue;
+
+        ViUInt32 kept = direct ? n : st_copy_in(s, head, space, dst, n);
+        ov_atomic_store64(&s->head, head + kept);
+        ov_atomic_store64(&s->received, s->received + n);
+        if (kept < n) {
+            ov_atomic_store64(&s->dropped, s->dropped + (n - kept));
+            ov_atomic_store32(&s->overflows, s->overflows + 1);
+        }
+        ViUInt32 fill = s->size - space + kept;
+        if (fill > s->high_water) ov_atomic_store32(&s->high_water, fill);
+        st_wake(s);
+    }
+
+    s->status = status;
+    ov_atomic_store32(&s->done, 1);
+    st_wake(s);
+    return NULL;
+}
+
+/* ========== Consumer ========== */
+
+/* Wait up to timeout ms for unread bytes; returns how many there are */
+static ViUInt32 st_wait(OvStream *s, ViUInt32 timeout) {
+    uint64_t tail = s->tail;
+    ViUInt32 avail = (ViUInt32)(ov_atomic_load64(&s->head) - tail);
+    if (avail || timeout == 0) return avail;
+
+    uint64_t deadline = timeout == VI_TMO_INFINITE ? UINT64_MAX
+                                                   : ov_time_ns() + (uint64_t)timeout * 1000000u;
+    ov_mutex_lock(&s->lock);
+    ov_atomic_store32(&s->waiting, 1);
+    for (;;) {
+        ov_atomic_fence();
+        avail = (ViUInt32)(ov_atomic_load64(&s->head) - tail);
+        if (avail || ov_atomic_load32(&s->done)) break;
+        uint64_t now = ov_time_ns();
+        if (now >= deadline) break;
+        uint64_t left_ms = (deadline - now + 999999) / 1000000;
+        ov_cond_timedwait(&s->cond, &s->lock, left_ms > ST_POLL_MS ? ST_POLL_MS : (uint32_t)left_ms);
+    }
+    ov_atomic_store32(&s->waiting, 0);
+    ov_mutex_unlock(&s->lock);
+    return avail;
+}
+
+/* Status when nothing is left to read */
+static ViStatus st_empty_status(OvStream *s) {
+    if (!ov_atomic_load32(&s->done)) return VI_ERROR_TMO;
+    return s->status < VI_SUCCESS ? s->status : VI_ERROR_CONN_LOST;
+}
+
+ViStatus ov_stream_read(OvSession *sess, ViBuf buf, ViUInt32 count, ViUInt32 *retCount) {
+    OvStream *s = sess->stream;
+    if (retCount) *retCount = 0;
+    ViUInt32 avail = st_wait(s, sess->timeout);
+    if (!avail) return st_empty_status(s);
+
+    ViUInt32 n = avail < count ? avail : count;
+    ViUInt32 pos = (ViUInt32)(s->tail & (s->size - 1));
+    ViUInt32 first = s->size - pos < n ? s->size - pos : n;
+    memcpy(buf, s->data + pos, first);
+    memcpy(buf + first, s->data, n - first);
+    ov_atomic_store64(&s->tail, s->tail + n);
+    if (retCount) *retCount = n;
+    return n == count ? VI_SUCCESS_MAX_CNT : VI_SUCCESS;
+}
+
+ViStatus ov_stream_get_attr(OvSession *sess, ViAttr attr, void *value) {
+    OvStream *s = sess->stream;
+    switch (attr) {
+        case OV_ATTR_STREAM_FILL:
+            *(ViUInt32 *)value = s ? (ViUInt32)(ov_atomic_load64(&s->head) - s->tail) : 0;
+            return VI_SUCCESS;
+        case OV_ATTR_STREAM_HIGH_WATER:
+            *(ViUInt32 *)value = s ? ov_atomic_load32(&s->high_water) : 0;
+            return VI_SUCCESS;
+        case OV_ATTR_STREAM_OVERFLOWS:
+            *(ViUInt32 *)value = s ? ov_atomic_load32(&s->overflows) : 0;
+            return VI_SUCCESS;
+        case OV_ATTR_STREAM_DROPPED:
+            *(ViUInt64 *)value = s ? ov_atomic_load64(&s->dropped) : 0;
+            return VI_SUCCESS;
+        case OV_ATTR_STREAM_RECEIVED:
+            *(ViUInt64 *)value = s ? ov_atomic_load64(&s->received) : 0;
+            return VI_SUCCESS;
+        case OV_ATTR_STREAM_HUGE_PAGES:
+            *(ViBoolean *)value = s && s->huge ? VI_TRUE : VI_FALSE;
+            return VI_SUCCESS;
+        default:
+            return VI_ERROR_NSUP_ATTR;
+    }
+}
+
+void ov_stream_free(OvSession *sess) {
+    OvStream *s = sess->stream;
+    if (!s) return;
+    ov_atomic_store32(&s->stop, 1);
+    ov_thread_join(s->thread);
+    sess->stream = NULL;
+    st_destroy(s);
+}
+
+/* ========== Public API ========== */
+
+ViStatus _VI_FUNC ovStreamStart(ViSession vi, ViUInt32 ringSize, ViUInt32 flags) {
+    OvSession *sess = ov_session_find(vi);
+    if (!sess || sess->isRM || !sess->transport || !sess->transport->read) return VI_ERROR_INV_OBJECT;
+    if (sess->stream || sess->readahead) return VI_ERROR_IN_PROGRESS;
+    if (ringSize == 0) ringSize = ST_DEFAULT_RING;
+    if (ringSize > ST_MAX_RING) return VI_ERROR_INV_SIZE;
+    ViUInt32 size = ST_MIN_RING;
+    while (size < ringSize) size <<= 1;
+
+    /* Held commands go out before the reader owns the input side */
+    ViStatus st = ov_session_sync(sess);
+    if (st < VI_SUCCESS) return st;
+
+    OvStream *s = (OvStream *)st_aligned_alloc(sizeof(OvStream));
+    if (!s) return VI_ERROR_ALLOC;
+    memset(s, 0, sizeof(*s));
+    ov_mutex_init(&s->lock);
+    ov_cond_init(&s->cond);
+    s->size = size;
+    s->transport = sess->transport;
+    s->data = st_map(size, (flags & OV_STREAM_HUGE_PAGES) != 0, &s->map_len, &s->huge);
+    s->staging = (ViByte *)malloc(ST_CHUNK);
+    if (!s->data || !s->staging) {
+        st_destroy(s);
+        return VI_ERROR_ALLOC;
+    }
+    if (!ov_thread_create(&s->thread, st_reader, s)) {
+        st_destroy(s);
+        return VI_ERROR_SYSTEM_ERROR;
+    }
+    sess->stream = s;
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovStreamAcquire(ViSession vi, ViUInt32 timeout, ViBuf *data, ViUInt32 *count) {
+    OvSession *sess = ov_session_find(vi);
+    if (!sess || !data || !count) return VI_ERROR_INV_OBJECT;
+    OvStream *s = sess->stream;
+    if (!s) return VI_ERROR_INV_SETUP;
+
+    *data = NULL;
+    *count = 0;
+    ViUInt32 avail = st_wait(s, timeout);
+    if (!avail) return st_empty_status(s);
+    ViUInt32 pos = (ViUInt32)(s->tail & (s->size - 1));
+    *data = s->data + pos;
+    *count = s->size - pos < avail ? s->size - pos : avail;
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovStreamRelease(ViSession vi, ViUInt32 count) {
+    OvSession *sess = ov_session_find(vi);
+    if (!sess) return VI_ERROR_INV_OBJECT;
+    OvStream *s = sess->stream;
+    if (!s) return VI_ERROR_INV_SETUP;
+    if (count > (ViUInt32)(ov_atomic_load64(&s->head) - s->tail)) return VI_ERROR_INV_SIZE;
+    ov_atomic_store64(&s->tail, s->tail + count);
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovStreamStop(ViSession vi) {
+    OvSession *sess = ov_session_find(vi);
+    if (!sess) return VI_ERROR_INV_OBJECT;
+    if (!sess->stream) return VI_ERROR_INV_SETUP;
+    ov_stream_free(sess);
+    return VI_SUCCESS;
+}
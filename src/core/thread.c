@@ -0,0 +1,322 @@
+/*
+ * OpenVISA - Threading and time primitives (pthreads / Win32)
+ */
+
+#include "thread.h"
+#include <stdlib.h>
+
+#ifndef OPENVISA_WINDOWS
+    #include <time.h>
+    #include <errno.h>
+    #include <sched.h>
+#endif
+
+/* ========== Mutex / condition variable ========== */
+
+#ifdef OPENVISA_WINDOWS
+
+void ov_mutex_init(OvMutex *m)      { InitializeSRWLock(m); }
+void ov_mutex_destroy(OvMutex *m)   { (void)m; }
+void ov_mutex_lock(OvMutex *m)      { AcquireSRWLockExclusive(m); }
+void ov_mutex_unlock(OvMutex *m)    { ReleaseSRWLockExclusive(m); }
+
+void ov_cond_init(OvCond *c)        { InitializeConditionVariable(c); }
+void ov_cond_destroy(OvCond *c)     { (void)c; }
+void ov_cond_wait(OvCond *c, OvMutex *m) { SleepConditionVariableSRW(c, m, INFINITE, 0); }
+void ov_cond_signal(OvCond *c)      { WakeConditionVariable(c); }
+void ov_cond_broadcast(OvCond *c)   { WakeAllConditionVariable(c); }
+
+bool ov_cond_timedwait(OvCond *c, OvMutex *m, uint32_t timeout_ms) {
+    return SleepConditionVariableSRW(c, m, timeout_ms, 0) != 0;
+}
+
+#else
+
+void ov_mutex_init(OvMutex *m)      { pthread_mutex_init(m, NULL); }
+void ov_mutex_destroy(OvMutex *m)   { pthread_mutex_destroy(m); }
+void ov_mutex_lock(OvMutex *m)      { pthread_mutex_lock(m); }
+void ov_mutex_unlock(OvMutex *m)    { pthread_mutex_unlock(m); }
+
+void ov_cond_init(OvCond *c) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+#ifndef __APPLE__
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+    pthread_cond_init(c, &attr);
+    pthread_condattr_destroy(&attr);
+}
+void ov_cond_destroy(OvCond *c)     { pthread_cond_destroy(c); }
+void ov_cond_wait(OvCond *c, OvMutex *m) { pthread_cond_wait(c, m); }
+void ov_cond_signal(OvCond *c)      { pthread_cond_signal(c); }
+void ov_cond_broadcast(OvCond *c)   { pthread_cond_broadcast(c); }
+
+bool ov_cond_timedwait(OvCond *c, OvMutex *m, uint32_t timeout_ms) {
+    struct timespec ts;
+#ifdef __APPLE__
+    clock_gettime(CLOCK_REALTIME, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    ts.tv_sec  += timeout_ms / 1000;
+    ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+    return pthread_cond_timedwait(c, m, &ts) != ETIMEDOUT;
+}
+
+#endif
+
+/* ========== Threads ========== */
+
+#ifdef OPENVISA_WINDOWS
+
+typedef struct { OvThreadFn fn; void *arg; } OvThreadStart;
+
+static DWORD WINAPI ov_thread_trampoline(LPVOID p) {
+    OvThreadStart s = *(OvThreadStart*)p;
+    free(p);
+    s.fn(s.arg);
+    return 0;
+}
+
+bool ov_thread_create(OvThread *t, OvThreadFn fn, void *arg) {
+    OvThreadStart *s = (OvThreadStart*)malloc(sizeof(*s));
+    if (!s) return false;
+    s->fn = fn;
+    s->arg = arg;
+    *t = CreateThread(NULL, 0, ov_thread_trampoline, s, 0, NULL);
+    if (!*t) { free(s); return false; }
+    return true;
+}
+
+void ov_thread_join(OvThread t) {
+    WaitForSingleObject(t, INFINITE);
+    CloseHandle(t);
+}
+
+void ov_thread_yield(void) { SwitchToThread(); }
+
+uintptr_t ov_thread_self(void) { return (uintptr_t)GetCurrentThreadId(); }
+
+#else
+
+bool ov_thread_create(OvThread *t, OvThreadFn fn, void *arg) {
+    return pthread_create(t, NULL, fn, arg) == 0;
+}
+
+void ov_thread_join(OvThread t) {
+    pthread_join(t, NULL);
+}
+
+void ov_thread_yield(void) { sched_yield(); }
+
+uintptr_t ov_thread_self(void) { return (uintptr_t)pthread_self(); }
+
+#endif
+
+/* ========== Worker pool ========== */
+
+#define OV_POOL_MAX_THREADS 128
+
+typedef struct OvJob {
+    OvTaskFn      fn;
+    void         *ctx;
+    uint32_t      n;
+    uint32_t      next;         /* next unclaimed index */
+    uint32_t      done;         /* completed indices */
+    uint32_t      workers;      /* pool threads allowed on this job */
+    uint32_t      active;       /* pool threads currently on it */
+    bool          posted;       /* ov_parallel_post: freed by the thread that ran it */
+    OvCond        finished;
+    struct OvJob *link;
+} OvJob;
+
+static struct {
+    OvMutex  lock;
+    OvCond   work;
+    OvJob   *jobs;              /* jobs with unclaimed indices */
+    uint32_t nthreads;
+    uint32_t idle;              /* threads not working on a job */
+    uint32_t posted;            /* posted jobs not claimed yet */
+} g_pool = { .lock = OV_MUTEX_INIT };
+static bool g_pool_cond_ready;
+
+static void pool_init_locked(void) {
+    if (g_pool_cond_ready) return;
+    ov_cond_init(&g_pool.work);
+    g_pool_cond_ready = true;
+}
+
+static void *pool_worker(void *arg);
+
+/* Start threads until want of them are idle or the pool is full */
+static void pool_grow_locked(uint32_t want) {
+    while (g_pool.idle < want && g_pool.nthreads < OV_POOL_MAX_THREADS) {
+        OvThread t;
+        if (!ov_thread_create(&t, pool_worker, NULL)) break;
+#ifdef OPENVISA_WINDOWS
+        CloseHandle(t);
+#else
+        pthread_detach(t);
+#endif
+        g_pool.nthreads++;
+        g_pool.idle++;
+    }
+}
+
+static void pool_unlink(OvJob *job) {
+    for (OvJob **pp = &g_pool.jobs; *pp; pp = &(*pp)->link) {
+        if (*pp == job) { *pp = job->link; return; }
+    }
+}
+
+/* Claim the next index of job under the pool lock; false when exhausted */
+static bool pool_claim(OvJob *job, uint32_t *i) {
+    if (job->next >= job->n) return false;
+    *i = job->next++;
+    if (job->next == job->n) {
+        pool_unlink(job);
+        if (job->posted) g_pool.posted--;
+    }
+    return true;
+}
+
+static void pool_complete(OvJob *job) {
+    if (++job->done == job->n && !job->posted) ov_cond_broadcast(&job->finished);
+}
+
+static void *pool_worker(void *arg) {
+    (void)arg;
+    ov_mutex_lock(&g_pool.lock);
+    for (;;) {
+        OvJob *job = g_pool.jobs;
+        while (job && job->active >= job->workers) job = job->link;
+        if (!job) {
+            ov_cond_wait(&g_pool.work, &g_pool.lock);
+            continue;
+        }
+
+        uint32_t i;
+        g_pool.idle--;
+        job->active++;
+        while (pool_claim(job, &i)) {
+            ov_mutex_unlock(&g_pool.lock);
+            job->fn(job->ctx, i);
+            ov_mutex_lock(&g_pool.lock);
+            pool_complete(job);
+        }
+        /* Last touch of job: the owner may return as soon as active hits 0 */
+        if (--job->active == 0 && job->done == job->n) {
+            if (job->posted) free(job);
+            else ov_cond_broadcast(&job->finished);
+        }
+        g_pool.idle++;
+    }
+    return NULL;
+}
+
+void ov_parallel_for(uint32_t n, OvTaskFn fn, void *ctx, uint32_t max_workers) {
+    if (n == 0) return;
+    if (max_workers == 0 || max_workers > n) max_workers = n;
+    if (max_workers > OV_POOL_MAX_THREADS + 1) max_workers = OV_POOL_MAX_THREADS + 1;
+    if (max_workers == 1) {
+        for (uint32_t i = 0; i < n; i++) fn(ctx, i);
+        return;
+    }
+
+    OvJob job = { .fn = fn, .ctx = ctx, .n = n, .workers = max_workers - 1 };
+
+    ov_mutex_lock(&g_pool.lock);
+    pool_init_locked();
+    ov_cond_init(&job.finished);
+    job.link = g_pool.jobs;
+    g_pool.jobs = &job;
+
+    /* Grow the pool so this job can get its helpers even if others are busy */
+    pool_grow_locked(job.workers);
+    ov_cond_broadcast(&g_pool.work);
+
+    /* The caller works too */
+    uint32_t i;
+    while (pool_claim(&job, &i)) {
+        ov_mutex_unlock(&g_pool.lock);
+        fn(ctx, i);
+        ov_mutex_lock(&g_pool.lock);
+        pool_complete(&job);
+    }
+    while (job.done < job.n || job.active > 0)
+        ov_cond_wait(&job.finished, &g_pool.lock);
+    ov_mutex_unlock(&g_pool.lock);
+    ov_cond_destroy(&job.finished);
+}
+
+bool ov_parallel_post(OvTaskFn fn, void *ctx) {
+    OvJob *job = (OvJob *)calloc(1, sizeof(OvJob));
+    if (!job) return false;
+    job->fn = fn;
+    job->ctx = ctx;
+    job->n = 1;
+    job->workers = 1;
+    job->posted = true;
+
+    ov_mutex_lock(&g_pool.lock);
+    pool_init_locked();
+    /* Behind earlier posts, so they start in order */
+    OvJob **pp = &g_pool.jobs;
+    while (*pp) pp = &(*pp)->link;
+    *pp = job;
+    g_pool.posted++;
+    pool_grow_locked(g_pool.posted);
+    bool ok = g_pool.nthreads > 0;
+    if (ok) {
+        ov_cond_broadcast(&g_pool.work);
+    } else {
+        pool_unlink(job);
+        g_pool.posted--;
+    }
+    ov_mutex_unlock(&g_pool.lock);
+    if (!ok) free(job);
+    return ok;
+}
+
+/* ========== Time ========== */
+
+#ifdef OPENVISA_WINDOWS
+
+uint64_t ov_time_ns(void) {
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)((double)now.QuadPart * 1e9 / (double)freq.QuadPart);
+}
+
+uint64_t ov_wallclock_ns(void) {
+    FILETIME ft;
+    GetSystemTimePreciseAsFileTime(&ft);
+    uint64_t t = ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+    return (t - 116444736000000000ULL) * 100u;     /* 1601 -> 1970, 100 ns units */
+}
+
+void ov_sleep_ms(uint32_t ms) { Sleep(ms); }
+
+#else
+
+uint64_t ov_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t ov_wallclock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void ov_sleep_ms(uint32_t ms) {
+    struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (long)(ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) { }
+}
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * OpenVISA - Threading and time primitives
+ *
+ * Thin wrappers over pthreads / Win32 so the core modules stay free of
+ * platform #ifdefs.  Mutexes can be statically initialised with
+ * OV_MUTEX_INIT (PTHREAD_MUTEX_INITIALIZER / SRWLOCK_INIT).
+ */
+
+#ifndef OPENVISA_THREAD_H
+#define OPENVISA_THREAD_H
+
+#include "visatype.h"       /* OPENVISA_WINDOWS */
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef OPENVISA_WINDOWS
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN     /* keep winsock2.h includable afterwards */
+    #endif
+    #include <windows.h>
+    typedef SRWLOCK             OvMutex;
+    typedef CONDITION_VARIABLE  OvCond;
+    typedef HANDLE              OvThread;
+    #define OV_MUTEX_INIT       SRWLOCK_INIT
+#else
+    #include <pthread.h>
+    typedef pthread_mutex_t     OvMutex;
+    typedef pthread_cond_t      OvCond;
+    typedef pthread_t           OvThread;
+    #define OV_MUTEX_INIT       PTHREAD_MUTEX_INITIALIZER
+#endif
+
+typedef void *(*OvThreadFn)(void *arg);
+
+void     ov_mutex_init(OvMutex *m);
+void     ov_mutex_destroy(OvMutex *m);
+void     ov_mutex_lock(OvMutex *m);
+void     ov_mutex_unlock(OvMutex *m);
+
+void     ov_cond_init(OvCond *c);
+void     ov_cond_destroy(OvCond *c);
+void     ov_cond_wait(OvCond *c, OvMutex *m);
+/* Returns false on timeout */
+bool     ov_cond_timedwait(OvCond *c, OvMutex *m, uint32_t timeout_ms);
+void     ov_cond_signal(OvCond *c);
+void     ov_cond_broadcast(OvCond *c);
+
+bool     ov_thread_create(OvThread *t, OvThreadFn fn, void *arg);
+void     ov_thread_join(OvThread t);
+void     ov_thread_yield(void);
+uintptr_t ov_thread_self(void);     /* calling thread's identity, comparable with == */
+
+/* Acquire/release flag and counter access, a full fence and a spin-loop
+ * pause, for hand-offs too latency-sensitive for a condition variable */
+#ifdef OPENVISA_WINDOWS
+static __inline uint32_t ov_atomic_load32(volatile uint32_t *p) {
+    return (uint32_t)InterlockedCompareExchange((volatile LONG*)p, 0, 0);
+}
+static __inline void ov_atomic_store32(volatile uint32_t *p, uint32_t v) {
+    InterlockedExchange((volatile LONG*)p, (LONG)v);
+}
+static __inline uint64_t ov_atomic_load64(volatile uint64_t *p) {
+    return (uint64_t)InterlockedCompareExchange64((volatile LONG64*)p, 0, 0);
+}
+static __inline void ov_atomic_store64(volatile uint64_t *p, uint64_t v) {
+    InterlockedExchange64((volatile LONG64*)p, (LONG64)v);
+}
+#define ov_atomic_fence()   MemoryBarrier()
+#define ov_cpu_relax()  YieldProcessor()
+#else
+static inline uint32_t ov_atomic_load32(volatile uint32_t *p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+static inline void ov_atomic_store32(volatile uint32_t *p, uint32_t v) {
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+static inline uint64_t ov_atomic_load64(volatile uint64_t *p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+static inline void ov_atomic_store64(volatile uint64_t *p, uint64_t v) {
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+#define ov_atomic_fence()   __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#if defined(__x86_64__) || defined(__i386__)
+    #define ov_cpu_relax()  __builtin_ia32_pause()
+#elif defined(__aarch64__)
+    #define ov_cpu_relax()  __asm__ __volatile__("yield")
+#else
+    #define ov_cpu_relax()  ((void)0)
+#endif
+#endif
+
+/*
+ * Shared worker pool.  Runs fn(ctx, i) for i in [0, n) on up to max_workers
+ * threads (the caller's thread included) and returns when all are done.
+ * Pool threads are created on demand and kept for later calls.
+ * ov_parallel_post runs fn(ctx, 0) once on a pool thread and returns at
+ * once; posts start in order as threads come free (false: no thread).
+ */
+typedef void (*OvTaskFn)(void *ctx, uint32_t i);
+void     ov_parallel_for(uint32_t n, OvTaskFn fn, void *ctx, uint32_t max_workers);
+bool     ov_parallel_post(OvTaskFn fn, void *ctx);
+
+uint64_t ov_time_ns(void);          /* monotonic clock */
+uint64_t ov_wallclock_ns(void);     /* nanoseconds since the Unix epoch */
+void     ov_sleep_ms(uint32_t ms);
+
+#endif /* OPENVISA_THREAD_H */
@@ -0,0 +1,278 @@
+/*
+ * OpenVISA - Triggers  (viAssertTrigger, ovTriggerGroup*)
+ *
+ * A transport with protocol-native trigger ops (HiSLIP Trigger, VXI-11
+ * device_trigger, USB488 TRIGGER, GPIB GET) sends its own message; every
+ * other transport gets "*TRG\n" as data, as VI_TRIG_PROT_DEFAULT requires.
+ *
+ * A trigger group keeps one parked thread per sender.  Firing arms every
+ * sender from the caller's thread, waits until all threads are awake and
+ * spinning on the release flag, then flips it: the only work left between
+ * release and the wire is one send per thread.  GPIB devices on one board
+ * share a single addressed GET, so their spread is zero by construction.
+ */
+
+#include "session.h"
+#include "thread.h"
+#include "openvisa.h"
+#include <string.h>
+#include <stdlib.h>
+
+#define TRG_DATA        "*TRG\n"
+#define TRG_SPIN_LIMIT  20000       /* pauses before a spinning sender yields */
+
+typedef struct {
+    OvTriggerGroup *grp;
+    OvSession      *sess;
+    OvThread        thread;
+    bool            started;
+    ViUInt32        leader;         /* sender that fires for this session */
+    ViStatus        status;
+    uint64_t        t_send;         /* ns, immediately before the send */
+} TrigSender;
+
+struct OvTriggerGroup {
+    ViUInt32        count;
+    TrigSender     *senders;        /* one per session, same order */
+    OvTransport   **peers;          /* transports grouped by kind */
+    ViUInt32       *kind_start;     /* per sender: first peer of its kind */
+    ViUInt32       *kind_len;
+
+    OvMutex         lock;
+    OvCond          cond;
+    uint32_t        generation;     /* bumped once per fire */
+    uint32_t        waiting;        /* senders that will send this round */
+    uint32_t        ready;
+    uint32_t        finished;
+    volatile uint32_t release;      /* == generation: go */
+    bool            closing;
+};
+
+/* ========== Per-transport send ========== */
+
+static ViStatus trg_arm(OvTriggerGroup *grp, ViUInt32 i) {
+    TrigSender  *s  = &grp->senders[i];
+    OvTransport *tr = s->sess->transport;
+    s->leader = i;
+    if (!tr->triggerArm) return VI_SUCCESS;
+
+    ViUInt32 start = grp->kind_start[i], lead = 0;
+    for (ViUInt32 k = 0; k < grp->kind_len[i]; k++)
+        if (grp->peers[start + k] == tr) lead = k;
+    ViStatus st = tr->triggerArm(tr, grp->peers + start, grp->kind_len[i], &lead);
+    if (st < VI_SUCCESS) return st;
+
+    /* Map the leading peer back to its session */
+    for (ViUInt32 j = 0; j < grp->count; j++)
+        if (grp->senders[j].sess->transport == grp->peers[start + lead]) s->leader = j;
+    return st;
+}
+
+static ViStatus trg_fire(OvSession *sess) {
+    OvTransport *tr = sess->transport;
+    if (tr->triggerFire) return tr->triggerFire(tr);
+    if (!tr->write) return VI_ERROR_NSUP_OPER;
+
+    ViUInt32 n = 0;
+    ViStatus st = tr->write(tr, (ViBuf)TRG_DATA, (ViUInt32)strlen(TRG_DATA), &n);
+    if (st >= VI_SUCCESS && n != strlen(TRG_DATA)) st = VI_ERROR_IO;
+    return st;
+}
+
+static ViStatus trg_done(OvSession *sess) {
+    OvTransport *tr = sess->transport;
+    return tr->triggerDone ? tr->triggerDone(tr, sess->timeout) : VI_SUCCESS;
+}
+
+/* ========== viAssertTrigger ========== */
+
+ViStatus _VI_FUNC viAssertTrigger(ViSession vi, ViUInt16 protocol) {
+    OvSession *sess = ov_session_find(vi);
+    if (!sess || !sess->transport) return VI_ERROR_INV_OBJECT;
+    if (protocol != VI_TRIG_PROT_DEFAULT) return VI_ERROR_INV_PROT;
+
+    ViStatus st = ov_session_sync(sess);
+    if (st < VI_SUCCESS) return st;
+
+    OvTransport *tr = sess->transport;
+    if (tr->triggerArm) {
+        ViUInt32 lead = 0;
+        st = tr->triggerArm(tr, &tr, 1, &lead);
+        if (st < VI_SUCCESS) return st;
+    }
+    st = trg_fire(sess);
+    if (st < VI_SUCCESS) return st;
+    return trg_done(sess);
+}
+
+/* ========== Trigger groups ========== */
+
+static void *trg_sender_main(void *arg) {
+    TrigSender     *s   = (TrigSender*)arg;
+    OvTriggerGroup *grp = s->grp;
+    uint32_t        seen = 0;
+
+    ov_mutex_lock(&grp->lock);
+    for (;;) {
+        while (grp->generation == seen && !grp->closing)
+            ov_cond_wait(&grp->cond, &grp->lock);
+        if (grp->closing) break;
+        seen = grp->generation;
+        if (s->status < VI_SUCCESS || s->leader != (ViUInt32)(s - grp->senders))
+            continue;       /* arm failed, or another sender covers this one */
+
+        if (++grp->ready == grp->waiting) ov_cond_broadcast(&grp->cond);
+        ov_mutex_unlock(&grp->lock);
+
+        for (uint32_t spins = 0; ov_atomic_load32(&grp->release) != seen; spins++) {
+            if (spins < TRG_SPIN_LIMIT) ov_cpu_relax();
+            else ov_thread_yield();
+        }
+        s->t_send = ov_time_ns();
+        ViStatus st = trg_fire(s->sess);
+        if (st >= VI_SUCCESS) st = trg_done(s->sess);
+        s->status = st;
+
+        ov_mutex_lock(&grp->lock);
+        if (++grp->finished == grp->waiting) ov_cond_broadcast(&grp->cond);
+    }
+    ov_mutex_unlock(&grp->lock);
+    return NULL;
+}
+
+static void trg_group_free(OvTriggerGroup *grp) {
+    ov_mutex_lock(&grp->lock);
+    grp->closing = true;
+    ov_cond_broadcast(&grp->cond);
+    ov_mutex_unlock(&grp->lock);
+    for (ViUInt32 i = 0; grp->senders && i < grp->count; i++)
+        if (grp->senders[i].started) ov_thread_join(grp->senders[i].thread);
+    ov_cond_destroy(&grp->cond);
+    ov_mutex_destroy(&grp->lock);
+    free(grp->senders);
+    free(grp->peers);
+    free(grp->kind_start);
+    free(grp->kind_len);
+    free(grp);
+}
+
+ViStatus _VI_FUNC ovTriggerGroupCreate(const ViSession sessions[], ViUInt32 count,
+                                       OvTriggerGroup **group)
+{
+    if (!sessions || !group) return VI_ERROR_INV_OBJECT;
+    *group = NULL;
+    if (count == 0) return VI_ERROR_INV_SETUP;
+
+    for (ViUInt32 i = 0; i < count; i++)
+        for (ViUInt32 j = i + 1; j < count; j++)
+            if (sessions[j] == sessions[i]) return VI_ERROR_INV_SETUP;
+
+    OvTriggerGroup *grp = (OvTriggerGroup*)calloc(1, sizeof(*grp));
+    if (!grp) return VI_ERROR_ALLOC;
+    ov_mutex_init(&grp->lock);
+    ov_cond_init(&grp->cond);
+    grp->count      = count;
+    grp->senders    = (TrigSender*)calloc(count, sizeof(TrigSender));
+    grp->peers      = (OvTransport**)calloc(count, sizeof(OvTransport*));
+    grp->kind_start = (ViUInt32*)calloc(count, sizeof(ViUInt32));
+    grp->kind_len   = (ViUInt32*)calloc(count, sizeof(ViUInt32));
+    if (!grp->senders || !grp->peers || !grp->kind_start || !grp->kind_len) {
+        trg_group_free(grp);
+        return VI_ERROR_ALLOC;
+    }
+
+    for (ViUInt32 i = 0; i < count; i++) {
+        OvSession *sess = ov_session_find(sessions[i]);
+        if (!sess || sess->isRM || !sess->transport) {
+            trg_group_free(grp);
+            return VI_ERROR_INV_OBJECT;
+        }
+        grp->senders[i].grp  = grp;
+        grp->senders[i].sess = sess;
+    }
+
+    /* Group transports by kind (same triggerArm) so each arm sees its peers */
+    ViUInt32 np = 0;
+    for (ViUInt32 i = 0; i < count; i++) {
+        OvTransport *tr = grp->senders[i].sess->transport;
+        ViUInt32 j = 0;
+        while (j < i && grp->senders[j].sess->transport->triggerArm != tr->triggerArm) j++;
+        if (j < i) {
+            grp->kind_start[i] = grp->kind_start[j];
+            grp->kind_len[i]   = grp->kind_len[j];
+            continue;
+        }
+        grp->kind_start[i] = np;
+        for (ViUInt32 k = i; k < count; k++) {
+            OvTransport *peer = grp->senders[k].sess->transport;
+            if (peer->triggerArm == tr->triggerArm) grp->peers[np++] = peer;
+        }
+        grp->kind_len[i] = np - grp->kind_start[i];
+    }
+
+    for (ViUInt32 i = 0; i < count; i++) {
+        TrigSender *s = &grp->senders[i];
+        if (!ov_thread_create(&s->thread, trg_sender_main, s)) {
+            trg_group_free(grp);
+            return VI_ERROR_SYSTEM_ERROR;
+        }
+        s->started = true;
+    }
+
+    *group = grp;
+    return VI_SUCCESS;
+}
+
+ViStatus _VI_FUNC ovTriggerGroupFire(OvTriggerGroup *group, ViStatus statuses[],
+                                     ViUInt64 *spreadNs)
+{
+    if (!group) return VI_ERROR_INV_OBJECT;
+    OvTriggerGroup *grp = group;
+
+    /* Pre-stage every message before anyone is released */
+    uint32_t waiting = 0;
+    for (ViUInt32 i = 0; i < grp->count; i++) {
+        TrigSender *s = &grp->senders[i];
+        s->t_send = 0;
+        s->status = ov_session_sync(s->sess);
+        if (s->status >= VI_SUCCESS) s->status = trg_arm(grp, i);
+        if (s->status >= VI_SUCCESS && s->leader == i) waiting++;
+    }
+
+    ov_mutex_lock(&grp->lock);
+    grp->waiting  = waiting;
+    grp->ready    = 0;
+    grp->finished = 0;
+    grp->generation++;
+    ov_cond_broadcast(&grp->cond);
+    while (grp->ready < waiting)
+        ov_cond_wait(&grp->cond, &grp->lock);
+
+    ov_atomic_store32(&grp->release, grp->generation);
+
+    while (grp->finished < waiting)
+        ov_cond_wait(&grp->cond, &grp->lock);
+    ov_mutex_unlock(&grp->lock);
+
+    uint64_t first = UINT64_MAX, last = 0;
+    ViStatus result = VI_SUCCESS;
+    for (ViUInt32 i = 0; i < grp->count; i++) {
+        TrigSender *s = &grp->senders[i];
+        ViStatus st = s->status;
+        if (st >= VI_SUCCESS && s->leader != i) st = grp->senders[s->leader].status;
+        if (statuses) statuses[i] = st;
+        if (st < VI_SUCCESS && result == VI_SUCCESS) result = st;
+        if (s->t_send) {
+            if (s->t_send < first) first = s->t_send;
+            if (s->t_send > last)  last  = s->t_send;
+        }
+    }
+    if (spreadNs) *spreadNs = last >= first ? last - first : 0;
+    return result;
+}
+
+ViStatus _VI_FUNC ovTriggerGroupClose(OvTriggerGroup *group) {
+    if (!group) return VI_ERROR_INV_OBJECT;
+    trg_group_free(group);
+    return VI_SUCCESS;
+}
@@ -0,0 +1,822 @@
+/*
+ * OpenVISA - openvisa-proxy: shares instruments among many client processes
+ *
+ *   openvisa-proxy [-s socket] [-f config] [-t txn-timeout-ms] [name=resource ...]
+ *
+ * The daemon owns the real VISA sessions and serves PROXY::<name>::INSTR
+ * clients over a Unix socket (protocol: proxy_proto.h).  Config lines are
+ * "name = resource"; '#' starts a comment.  Instruments are opened on first
+ * use and stay open while the daemon runs.
+ *
+ * Structure: one epoll loop owns all client and scheduling state; each
+ * instrument has a worker thread that performs exactly one blocking VISA
+ * call at a time and reports back through an eventfd.  Clients never block
+ * each other except through the instrument itself.
+ *
+ * Scheduling, per instrument, FIFO over waiting requests:
+ *   - a WRITE holding a query (a '?' outside strings and block data) opens
+ *     a transaction: the writer owns the instrument until its READ returns
+ *     the whole response (or the transaction times out), so queries of
+ *     different clients never interleave.  Other writes are atomic.
+ *   - LOCK (viLock) holds the instrument until UNLOCK or disconnect.
+ *   - READSTB (serial poll) may run inside another client's transaction,
+ *     but not through an explicit lock.
+ * Coalescing: READSTBs waiting while one is in flight share its result, and
+ * a side-effect-free status query (*IDN?, *STB?, ...) written while another
+ * client's identical query is outstanding is answered from that response.
+ */
+
+#define _GNU_SOURCE
+#include "visa.h"
+#include "proxy_proto.h"
+#include "../core/thread.h"
+#include "../core/scpi.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#define PX_MAX_EVENTS       128
+#define PX_TXN_TIMEOUT_MS   10000u      /* owner must read its response by then */
+#define PX_TAG_LISTEN       ((void*)1)
+#define PX_TAG_EVENT        ((void*)2)
+
+/* Queries answered identically for every caller; safe to share one response */
+static const char *g_coalescible[] = {
+    "*IDN?", "*STB?", "*ESE?", "*SRE?", "*OPT?", NULL
+};
+
+typedef struct Client Client;
+typedef struct Instr  Instr;
+
+struct Client {
+    int         fd;
+    Instr      *instr;
+    bool        dead;           /* disconnected; freed once no job refers to it */
+    bool        busy;           /* its request is on the worker */
+
+    /* Request being received / served (one at a time per connection) */
+    OvpHeader   req;
+    uint32_t    hdr_got;
+    uint8_t    *payload;
+    uint32_t    pay_got;
+    bool        ready;          /* full request received, not yet replied */
+    uint64_t    deadline;       /* ns; queued request times out (0 = none) */
+    Client     *qnext;          /* instrument wait queue */
+    bool        queued;
+
+    /* Reply bytes not yet accepted by the socket */
+    uint8_t    *out;
+    uint32_t    out_len, out_off, out_cap;
+
+    /* Transaction / coalescing */
+    bool        txn;            /* owns the instrument until its response is read */
+    char        txn_cmd[16];    /* coalescible query text of the transaction */
+    uint8_t    *txn_resp;       /* its response so far, for followers */
+    uint32_t    txn_resp_len;
+    bool        txn_resp_lost;  /* out of memory keeping it */
+    Client     *leader;         /* we share this client's response */
+    Client     *fnext;          /* follower list link (query or STB) */
+    Client     *followers;
+    bool        stashed;        /* shared response has arrived */
+    ViStatus    stash_status;
+    uint8_t    *stash;
+    uint32_t    stash_len;
+
+    Client     *next;           /* all clients */
+};
+
+struct Instr {
+    char        name[OVP_MAX_NAME + 1];
+    char        rsrc[256];
+    ViSession   vi;
+    bool        opened;
+
+    Client     *owner;          /* transaction or explicit lock holder */
+    bool        locked;         /* owner holds an explicit lock */
+    uint64_t    txn_deadline;
+    Client     *qhead, *qtail;
+    Client     *stb_followers;
+    bool        need_clear;     /* abandoned transaction left a response behind */
+
+    /* Worker hand-off */
+    OvThread    thread;
+    OvMutex     lock;
+    OvCond      cond;
+    bool        busy;           /* loop side: a job is on the worker */
+    bool        job_posted;     /* worker side: job waiting to run */
+    bool        quit;
+    Client     *job_client;     /* NULL for internal jobs */
+    OvpHeader   job;
+    const uint8_t *job_in;
+    ViStatus    job_status;
+    uint32_t    job_arg;
+    uint8_t    *job_out;
+    uint32_t    job_out_len;
+    Instr      *done_next;
+};
+
+static struct {
+    ViSession   rm;
+    Instr      *instrs;
+    int         ninstrs;
+    Client     *clients;
+    int         epfd;
+    int         evfd;
+    uint32_t    txn_timeout_ms;
+
+    OvMutex     done_lock;
+    Instr      *done;           /* completed jobs */
+} g = { .done_lock = OV_MUTEX_INIT, .txn_timeout_ms = PX_TXN_TIMEOUT_MS };
+
+static volatile sig_atomic_t g_stop;
+
+static void on_signal(int sig) { (void)sig; g_stop = 1; }
+
+/* ========== Worker ========== */
+
+static void *instr_worker(void *arg) {
+    Instr *in = (Instr*)arg;
+    for (;;) {
+        ov_mutex_lock(&in->lock);
+        while (!in->job_posted && !in->quit)
+            ov_cond_wait(&in->cond, &in->lock);
+        if (in->quit) { ov_mutex_unlock(&in->lock); break; }
+        in->job_posted = false;
+        ov_mutex_unlock(&in->lock);
+
+        ViStatus st = VI_SUCCESS;
+        ViUInt32 n = 0;
+        ViUInt16 stb = 0;
+        in->job_out_len = 0;
+        if (in->opened)
+            viSetAttribute(in->vi, VI_ATTR_TMO_VALUE, in->job.timeout);
+
+        switch (in->job.op) {
+            case OVP_OPEN:
+                if (!in->opened) {
+                    st = viOpen(g.rm, in->rsrc, VI_NULL, in->job.timeout, &in->vi);
+                    in->opened = st >= VI_SUCCESS;
+                }
+                break;
+            case OVP_WRITE:
+                st = viWrite(in->vi, (ViBuf)in->job_in, in->job.len, &n);
+                in->job_arg = n;
+                break;
+            case OVP_READ:
+                st = viRead(in->vi, in->job_out, in->job.arg, &n);
+                in->job_out_len = n;
+                break;
+            case OVP_READSTB:
+                st = viReadSTB(in->vi, &stb);
+                in->job_arg = stb;
+                break;
+            case OVP_CLEAR:
+                st = viClear(in->vi);
+                break;
+        }
+        in->job_status = st;
+
+        ov_mutex_lock(&g.done_lock);
+        in->done_next = g.done;
+        g.done = in;
+        ov_mutex_unlock(&g.done_lock);
+        uint64_t one = 1;
+        ssize_t w = write(g.evfd, &one, sizeof(one));
+        (void)w;
+    }
+    return NULL;
+}
+
+/* ========== Client output ========== */
+
+static void client_flush(Client *c) {
+    while (c->out_off < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_off, c->out_len - c->out_off, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n <= 0) { c->dead = true; return; }
+        c->out_off += (uint32_t)n;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+    if (c->out_off < c->out_len) ev.events |= EPOLLOUT;
+    else c->out_off = c->out_len = 0;
+    epoll_ctl(g.epfd, EPOLL_CTL_MOD, c->fd, &ev);
+}
+
+static void client_reply(Client *c, ViStatus st, uint32_t arg, const void *data, uint32_t len) {
+    OvpHeader h = { .op = c->req.op, .status = st, .arg = arg, .len = len };
+    uint32_t need = c->out_len + (uint32_t)sizeof(h) + len;
+    if (need > c->out_cap) {
+        uint8_t *nb = (uint8_t*)realloc(c->out, need);
+        if (!nb) { c->dead = true; return; }
+        c->out = nb;
+        c->out_cap = need;
+    }
+    memcpy(c->out + c->out_len, &h, sizeof(h));
+    if (len) memcpy(c->out + c->out_len + sizeof(h), data, len);
+    c->out_len = need;
+
+    free(c->payload);
+    c->payload = NULL;
+    c->hdr_got = c->pay_got = 0;
+    c->ready = false;
+    c->deadline = 0;
+    if (!c->dead) client_flush(c);
+}
+
+/* ========== Scheduling ========== */
+
+static void queue_remove(Instr *in, Client *c) {
+    Client **pp = &in->qhead;
+    Client *prev = NULL;
+    while (*pp && *pp != c) { prev = *pp; pp = &(*pp)->qnext; }
+    if (!*pp) return;
+    *pp = c->qnext;
+    if (in->qtail == c) in->qtail = prev;
+    c->qnext = NULL;
+    c->queued = false;
+}
+
+static void queue_push(Instr *in, Client *c) {
+    c->qnext = NULL;
+    c->queued = true;
+    if (in->qtail) in->qtail->qnext = c;
+    else in->qhead = c;
+    in->qtail = c;
+}
+
+static bool is_coalescible(const uint8_t *cmd, uint32_t len, char out[16]) {
+    while (len && (cmd[len - 1] == '\n' || cmd[len - 1] == '\r' || cmd[len - 1] == ' ')) len--;
+    for (int i = 0; g_coalescible[i]; i++) {
+        size_t n = strlen(g_coalescible[i]);
+        if (n == len && strncasecmp((const char*)cmd, g_coalescible[i], n) == 0) {
+            memcpy(out, g_coalescible[i], n + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void follower_detach(Client *f) {
+    if (!f->leader) return;
+    for (Client **pp = &f->leader->followers; *pp; pp = &(*pp)->fnext)
+        if (*pp == f) { *pp = f->fnext; break; }
+    f->leader = NULL;
+    f->fnext = NULL;
+}
+
+/* Serve a follower's READ from its stashed copy of the leader's response */
+static void follower_serve(Client *f) {
+    uint32_t n = f->stash_len < f->req.arg ? f->stash_len : f->req.arg;
+    ViStatus st = f->stash_status;
+    if (st >= VI_SUCCESS && n < f->stash_len) st = VI_SUCCESS_MAX_CNT;
+    client_reply(f, st, 0, f->stash, st >= VI_SUCCESS ? n : 0);
+    free(f->stash);
+    f->stash = NULL;
+    f->stashed = false;
+}
+
+/* The leader's transaction ended: hand the response (or an error) to followers */
+static void followers_release(Client *leader, ViStatus st, const uint8_t *data, uint32_t len) {
+    while (leader->followers) {
+        Client *f = leader->followers;
+        leader->followers = f->fnext;
+        f->leader = NULL;
+        f->fnext = NULL;
+        f->stashed = true;
+        f->stash_status = st;
+        f->stash_len = 0;
+        if (st >= VI_SUCCESS && len) {
+            f->stash = (uint8_t*)malloc(len);
+            if (f->stash) { memcpy(f->stash, data, len); f->stash_len = len; }
+        }
+        if (f->ready && f->req.op == OVP_READ) follower_serve(f);
+    }
+}
+
+/* Append a chunk of a coalescible transaction's response: followers get
+ * the whole of it once the leader has read the last chunk */
+static void txn_keep(Client *c, const uint8_t *data, uint32_t len) {
+    if (c->txn_resp_lost || !len) return;
+    uint8_t *nb = (uint8_t*)realloc(c->txn_resp, c->txn_resp_len + len);
+    if (!nb) {
+        c->txn_resp_lost = true;
+        return;
+    }
+    memcpy(nb + c->txn_resp_len, data, len);
+    c->txn_resp = nb;
+    c->txn_resp_len += len;
+}
+
+static void txn_end(Instr *in, Client *c) {
+    c->txn = false;
+    c->txn_cmd[0] = '\0';
+    free(c->txn_resp);
+    c->txn_resp = NULL;
+    c->txn_resp_len = 0;
+    c->txn_resp_lost = false;
+    if (in->owner == c && !in->locked) in->owner = NULL;
+}
+
+static uint64_t deadline_for(uint32_t timeout_ms) {
+    if (timeout_ms == VI_TMO_INFINITE) return 0;
+    return ov_time_ns() + (uint64_t)timeout_ms * 1000000u;
+}
+
+/* Time left of a queued request's timeout, for the VISA call itself */
+static uint32_t remaining_ms(const Client *c) {
+    if (c->req.timeout == VI_TMO_INFINITE || !c->deadline) return c->req.timeout;
+    uint64_t now = ov_time_ns();
+    return c->deadline > now ? (uint32_t)((c->deadline - now) / 1000000u) : 0;
+}
+
+static void instr_post(Instr *in, Client *c, const OvpHeader *job, const uint8_t *data) {
+    in->busy = true;
+    in->job_client = c;
+    in->job = *job;
+    in->job_in = data;
+    in->job_arg = 0;
+    if (job->op == OVP_READ) {
+        uint8_t *nb = (uint8_t*)realloc(in->job_out, job->arg ? job->arg : 1);
+        if (nb) in->job_out = nb;
+        else    in->job.arg = 0;
+    }
+    if (c) c->busy = true;
+
+    ov_mutex_lock(&in->lock);
+    in->job_posted = true;
+    ov_cond_signal(&in->cond);
+    ov_mutex_unlock(&in->lock);
+}
+
+static bool eligible(Instr *in, Client *c) {
+    if (!in->owner || in->owner == c) return true;
+    if (in->locked) return false;
+    return c->req.op == OVP_READSTB || c->req.op == OVP_OPEN;
+}
+
+/* Same status query as the owner's outstanding transaction: share its answer */
+static bool try_coalesce(Instr *in, Client *c) {
+    Client *l = in->owner;
+    char key[16];
+    if (c->req.op != OVP_WRITE || !l || l == c || !l->txn || in->locked) return false;
+    if (!is_coalescible(c->payload, c->req.len, key) || strcmp(l->txn_cmd, key) != 0) return false;
+
+    if (c->queued) queue_remove(in, c);
+    c->leader = l;
+    c->fnext = l->followers;
+    l->followers = c;
+    free(c->stash);
+    c->stash = NULL;
+    c->stashed = false;
+    client_reply(c, VI_SUCCESS, c->req.len, NULL, 0);
+    return true;
+}
+
+/* Start the next runnable request if the worker is idle */
+static void instr_kick(Instr *in) {
+    if (in->busy) return;
+
+    if (in->need_clear && !in->owner && in->opened) {
+        in->need_clear = false;
+        OvpHeader job = { .op = OVP_CLEAR, .timeout = 2000 };
+        instr_post(in, NULL, &job, NULL);
+        return;
+    }
+
+    for (Client *c = in->qhead; c; ) {
+        Client *next = c->qnext;
+        if (!eligible(in, c)) {
+            try_coalesce(in, c);
+            c = next;
+            continue;
+        }
+        queue_remove(in, c);
+
+        if (c->req.op == OVP_LOCK) {        /* no I/O: grant now */
+            in->owner  = c;
+            in->locked = true;
+            client_reply(c, VI_SUCCESS, 0, NULL, 0);
+            c = next;
+            continue;
+        }
+        if (c->req.op == OVP_OPEN && in->opened) {
+            client_reply(c, VI_SUCCESS, 0, NULL, 0);
+            c = next;
+            continue;
+        }
+
+        OvpHeader job = c->req;
+        job.timeout = remaining_ms(c);
+        instr_post(in, c, &job, c->payload);
+        return;
+    }
+}
+
+/* A job finished on the worker (loop thread) */
+static void instr_complete(Instr *in) {
+    Client *c = in->job_client;
+    ViStatus st = in->job_status;
+    in->busy = false;
+    in->job_client = NULL;
+
+    if (c) {
+        c->busy = false;
+        switch (in->job.op) {
+            case OVP_WRITE:
+                if (!c->dead && st >= VI_SUCCESS && ov_scpi_is_query(c->payload, c->req.len)) {
+                    if (!is_coalescible(c->payload, c->req.len, c->txn_cmd)) c->txn_cmd[0] = '\0';
+                    c->txn = true;
+                    in->owner = c;
+                    in->txn_deadline = deadline_for(g.txn_timeout_ms);
+                }
+                if (!c->dead) client_reply(c, st, in->job_arg, NULL, 0);
+                break;
+
+            case OVP_READ: {
+                bool complete = st != VI_SUCCESS_MAX_CNT;
+                if (c->txn && c->txn_cmd[0] && st >= VI_SUCCESS)
+                    txn_keep(c, in->job_out, in->job_out_len);
+                if (c->txn && complete) {
+                    ViStatus fst = c->txn_resp_lost && st >= VI_SUCCESS ? VI_ERROR_ALLOC : st;
+                    followers_release(c, fst, c->txn_resp, c->txn_resp_len);
+                    txn_end(in, c);
+                }
+                if (!c->dead) client_reply(c, st, 0, in->job_out, st >= VI_SUCCESS ? in->job_out_len : 0);
+                break;
+            }
+
+            case OVP_READSTB:
+                while (in->stb_followers) {
+                    Client *f = in->stb_followers;
+                    in->stb_followers = f->fnext;
+                    f->fnext = NULL;
+                    client_reply(f, st, in->job_arg, NULL, 0);
+                }
+                if (!c->dead) client_reply(c, st, in->job_arg, NULL, 0);
+                break;
+
+            default:
+                if (!c->dead) client_reply(c, st, in->job_arg, NULL, 0);
+                break;
+        }
+    }
+    instr_kick(in);
+}
+
+/* ========== Requests ========== */
+
+static Instr *instr_find(const char *name) {
+    for (int i = 0; i < g.ninstrs; i++)
+        if (strcmp(g.instrs[i].name, name) == 0) return &g.instrs[i];
+    return NULL;
+}
+
+static void client_request(Client *c) {
+    Instr *in = c->instr;
+    c->ready = true;
+    c->deadline = deadline_for(c->req.timeout);
+
+    if (c->req.op == OVP_OPEN) {
+        char name[OVP_MAX_NAME + 1];
+        uint32_t n = c->req.len < OVP_MAX_NAME ? c->req.len : OVP_MAX_NAME;
+        memcpy(name, c->payload, n);
+        name[n] = '\0';
+        if (c->instr || !(in = instr_find(name))) {
+            client_reply(c, VI_ERROR_RSRC_NFOUND, 0, NULL, 0);
+            return;
+        }
+        c->instr = in;
+    } else if (!in) {
+        client_reply(c, VI_ERROR_INV_SETUP, 0, NULL, 0);
+        return;
+    }
+
+    switch (c->req.op) {
+        case OVP_UNLOCK:
+            if (in->owner == c && in->locked) {
+                in->locked = false;
+                if (!c->txn) in->owner = NULL;
+                client_reply(c, VI_SUCCESS, 0, NULL, 0);
+                instr_kick(in);
+            } else {
+                client_reply(c, VI_ERROR_SESN_NLOCKED, 0, NULL, 0);
+            }
+            return;
+
+        case OVP_READ:
+            if (c->stashed) { follower_serve(c); return; }
+            if (c->leader) return;          /* served when the leader's response arrives */
+            break;
+
+        case OVP_WRITE:
+            if (try_coalesce(in, c)) return;
+            break;
+
+        case OVP_READSTB:
+            if (in->busy && in->job.op == OVP_READSTB && eligible(in, c)) {
+                c->fnext = in->stb_followers;
+                in->stb_followers = c;
+                return;
+            }
+            break;
+    }
+
+    queue_push(in, c);
+    instr_kick(in);
+}
+
+/* Non-blocking receive of header + payload; dispatches complete requests */
+static void client_readable(Client *c) {
+    for (;;) {
+        if (c->ready) return;                       /* one request at a time */
+        ssize_t n;
+        if (c->hdr_got < sizeof(OvpHeader)) {
+            n = recv(c->fd, (uint8_t*)&c->req + c->hdr_got, sizeof(OvpHeader) - c->hdr_got, 0);
+            if (n > 0) {
+                c->hdr_got += (uint32_t)n;
+                if (c->hdr_got == sizeof(OvpHeader)) {
+                    if (c->req.len > OVP_MAX_PAYLOAD) { c->dead = true; return; }
+                    c->payload = (uint8_t*)malloc(c->req.len ? c->req.len : 1);
+                    if (!c->payload) { c->dead = true; return; }
+                    c->pay_got = 0;
+                    if (c->req.len == 0) client_request(c);
+                }
+                continue;
+            }
+        } else {
+            n = recv(c->fd, c->payload + c->pay_got, c->req.len - c->pay_got, 0);
+            if (n > 0) {
+                c->pay_got += (uint32_t)n;
+                if (c->pay_got == c->req.len) client_request(c);
+                continue;
+            }
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        c->dead = true;                             /* EOF or error */
+        return;
+    }
+}
+
+/* ========== Client lifetime ========== */
+
+static void client_drop(Client *c) {
+    Instr *in = c->instr;
+    if (in) {
+        if (c->queued) queue_remove(in, c);
+        for (Client **pp = &in->stb_followers; *pp; pp = &(*pp)->fnext)
+            if (*pp == c) { *pp = c->fnext; break; }
+        follower_detach(c);
+        if (c->txn) {
+            followers_release(c, VI_ERROR_CONN_LOST, NULL, 0);
+            in->need_clear = true;          /* its response is still in the instrument */
+        }
+        if (in->owner == c) {
+            in->owner  = NULL;
+            in->locked = false;
+        }
+        c->txn = false;
+        instr_kick(in);
+    }
+    epoll_ctl(g.epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    c->fd = -1;
+}
+
+static void client_free(Client *c) {
+    free(c->payload);
+    free(c->out);
+    free(c->stash);
+    free(c->txn_resp);
+    free(c);
+}
+
+/* Drop dead clients; free them once the worker no longer refers to them */
+static void reap_clients(void) {
+    for (Client **pp = &g.clients; *pp; ) {
+        Client *c = *pp;
+        if (c->dead && c->fd >= 0) client_drop(c);
+        if (c->dead && !c->busy) {
+            *pp = c->next;
+            client_free(c);
+        } else {
+            pp = &c->next;
+        }
+    }
+}
+
+static void accept_clients(int ls) {
+    for (;;) {
+        int fd = accept4(ls, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+        Client *c = (Client*)calloc(1, sizeof(Client));
+        if (!c) { close(fd); continue; }
+        c->fd = fd;
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+        if (epoll_ctl(g.epfd, EPOLL_CTL_ADD, fd, &ev) != 0) { close(fd); free(c); continue; }
+        c->next = g.clients;
+        g.clients = c;
+    }
+}
+
+/* ========== Timers ========== */
+
+/* Expire queued requests and stale transactions; returns ms until the next deadline */
+static int run_timers(void) {
+    uint64_t now = ov_time_ns(), next = now + 1000000000ull;
+    for (int i = 0; i < g.ninstrs; i++) {
+        Instr *in = &g.instrs[i];
+        if (in->owner && in->owner->txn && !in->owner->busy && in->txn_deadline) {
+            if (in->txn_deadline <= now) {
+                Client *o = in->owner;
+                followers_release(o, VI_ERROR_TMO, NULL, 0);
+                txn_end(in, o);
+                in->need_clear = true;
+                instr_kick(in);
+            } else if (in->txn_deadline < next) {
+                next = in->txn_deadline;
+            }
+        }
+        for (Client *c = in->qhead; c; ) {
+            Client *nx = c->qnext;
+            if (c->deadline && c->deadline <= now) {
+                queue_remove(in, c);
+                client_reply(c, VI_ERROR_TMO, 0, NULL, 0);
+            } else if (c->deadline && c->deadline < next) {
+                next = c->deadline;
+            }
+            c = nx;
+        }
+    }
+    return (int)((next - now) / 1000000u) + 1;
+}
+
+/* ========== Setup ========== */
+
+static bool add_instr(const char *spec) {
+    const char *eq = strchr(spec, '=');
+    if (!eq) return false;
+    const char *n0 = spec, *n1 = eq, *r0 = eq + 1;
+    while (*n0 == ' ' || *n0 == '\t') n0++;
+    while (n1 > n0 && (n1[-1] == ' ' || n1[-1] == '\t')) n1--;
+    while (*r0 == ' ' || *r0 == '\t') r0++;
+    size_t rl = strcspn(r0, " \t\r\n#");
+    if (n1 == n0 || (size_t)(n1 - n0) > OVP_MAX_NAME || rl == 0 || rl >= 256) return false;
+
+    Instr *ni = (Instr*)realloc(g.instrs, (size_t)(g.ninstrs + 1) * sizeof(Instr));
+    if (!ni) return false;
+    g.instrs = ni;
+    Instr *in = &g.instrs[g.ninstrs++];
+    memset(in, 0, sizeof(*in));
+    memcpy(in->name, n0, (size_t)(n1 - n0));
+    memcpy(in->rsrc, r0, rl);
+    return true;
+}
+
+static bool load_config(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+    char line[512];
+    int lineno = 0;
+    bool ok = true;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *p = line + strspn(line, " \t");
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0') continue;
+        if (!add_instr(p)) {
+            fprintf(stderr, "openvisa-proxy: %s:%d: expected 'name = resource'\n", path, lineno);
+            ok = false;
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+static int listen_on(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    unlink(path);                               /* stale socket of a dead daemon */
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 128) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+        "usage: openvisa-proxy [-s socket] [-f config] [-t txn-timeout-ms] [name=resource ...]\n");
+}
+
+int main(int argc, char **argv) {
+    char path[108];
+    ovp_socket_path(path, sizeof(path));
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            snprintf(path, sizeof(path), "%s", argv[++i]);
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            if (!load_config(argv[++i])) return 1;
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            g.txn_timeout_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (argv[i][0] != '-' && add_instr(argv[i])) {
+            continue;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (g.ninstrs == 0) { usage(); return 1; }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    if (viOpenDefaultRM(&g.rm) != VI_SUCCESS) return 1;
+    int ls = listen_on(path);
+    if (ls < 0) { fprintf(stderr, "openvisa-proxy: cannot listen on %s\n", path); return 1; }
+
+    g.epfd = epoll_create1(EPOLL_CLOEXEC);
+    g.evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = PX_TAG_LISTEN };
+    epoll_ctl(g.epfd, EPOLL_CTL_ADD, ls, &ev);
+    ev.data.ptr = PX_TAG_EVENT;
+    epoll_ctl(g.epfd, EPOLL_CTL_ADD, g.evfd, &ev);
+
+    for (int i = 0; i < g.ninstrs; i++) {
+        Instr *in = &g.instrs[i];
+        ov_mutex_init(&in->lock);
+        ov_cond_init(&in->cond);
+        if (!ov_thread_create(&in->thread, instr_worker, in)) return 1;
+    }
+
+    fprintf(stderr, "openvisa-proxy: %d instrument(s) on %s\n", g.ninstrs, path);
+
+    struct epoll_event events[PX_MAX_EVENTS];
+    while (!g_stop) {
+        int n = epoll_wait(g.epfd, events, PX_MAX_EVENTS, run_timers());
+        for (int i = 0; i < n; i++) {
+            void *tag = events[i].data.ptr;
+            if (tag == PX_TAG_LISTEN) {
+                accept_clients(ls);
+            } else if (tag == PX_TAG_EVENT) {
+                uint64_t cnt;
+                ssize_t r = read(g.evfd, &cnt, sizeof(cnt));
+                (void)r;
+                ov_mutex_lock(&g.done_lock);
+                Instr *done = g.done;
+                g.done = NULL;
+                ov_mutex_unlock(&g.done_lock);
+                while (done) {
+                    Instr *nx = done->done_next;
+                    instr_complete(done);
+                    done = nx;
+                }
+            } else {
+                Client *c = (Client*)tag;
+                if (c->dead) continue;
+                if (events[i].events & EPOLLOUT) client_flush(c);
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) client_readable(c);
+            }
+        }
+        reap_clients();
+    }
+
+    /* Shutdown: stop workers after their current call, close instruments */
+    for (int i = 0; i < g.ninstrs; i++) {
+        Instr *in = &g.instrs[i];
+        ov_mutex_lock(&in->lock);
+        in->quit = true;
+        ov_cond_signal(&in->cond);
+        ov_mutex_unlock(&in->lock);
+        ov_thread_join(in->thread);
+        if (in->opened) viClose(in->vi);
+        free(in->job_out);
+    }
+    for (Client *c = g.clients; c; ) {
+        Client *nx = c->next;
+        if (c->fd >= 0) close(c->fd);
+        client_free(c);
+        c = nx;
+    }
+    close(ls);
+    unlink(path);
+    viClose(g.rm);
+    return 0;
+}
@@ -0,0 +1,60 @@
+/*
+ * OpenVISA - openvisa-proxy wire protocol
+ *
+ * Shared by the daemon (src/proxy/openvisa_proxy.c) and the PROXY::<name>
+ * transport (src/transport/proxy.c).  One Unix stream connection per client
+ * session; the client sends one request and waits for its reply, so frames
+ * never interleave on a connection.  Both ends run on the same host, so
+ * fields are in host byte order.
+ *
+ *   frame = OvpHeader + len bytes of payload
+ *
+ *   request      payload     arg             timeout   reply arg / payload
+ *   OPEN         name        -               ms        -
+ *   WRITE        data        -               ms        bytes written
+ *   READ         -           max bytes       ms        - / data
+ *   READSTB      -           -               ms        status byte
+ *   CLEAR        -           -               ms        -
+ *   LOCK         -           -               ms        -
+ *   UNLOCK       -           -               -         -
+ *
+ * The reply echoes op and carries the ViStatus in status.
+ */
+
+#ifndef OPENVISA_PROXY_PROTO_H
+#define OPENVISA_PROXY_PROTO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#define OVP_OPEN        1
+#define OVP_WRITE       2
+#define OVP_READ        3
+#define OVP_READSTB     4
+#define OVP_CLEAR       5
+#define OVP_LOCK        6
+#define OVP_UNLOCK      7
+
+#define OVP_MAX_PAYLOAD (1u << 20)          /* per frame, both directions */
+#define OVP_MAX_NAME    63
+
+typedef struct {
+    uint32_t op;
+    int32_t  status;        /* reply only */
+    uint32_t arg;
+    uint32_t timeout;       /* ms, VI_TMO_INFINITE allowed */
+    uint32_t len;           /* payload bytes that follow */
+} OvpHeader;
+
+/* Socket path: $OPENVISA_PROXY_SOCKET, else $XDG_RUNTIME_DIR/openvisa-proxy.sock,
+ * else /tmp/openvisa-proxy.sock */
+static inline void ovp_socket_path(char *out, size_t size) {
+    const char *p = getenv("OPENVISA_PROXY_SOCKET");
+    const char *dir = getenv("XDG_RUNTIME_DIR");
+    if (p && *p)          snprintf(out, size, "%s", p);
+    else if (dir && *dir) snprintf(out, size, "%s/openvisa-proxy.sock", dir);
+    else                  snprintf(out, size, "/tmp/openvisa-proxy.sock");
+}
+
+#endif /* OPENVISA_PROXY_PROTO_H */
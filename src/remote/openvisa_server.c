@@ -0,0 +1,260 @@
+/*
+ * OpenVISA - openvisa-server: exposes local resources as visa://host/RESOURCE
+ *
+ *   openvisa-server [-p port] [-l address] [resource ...]
+ *
+ * Each client connection is one session, served by its own thread, which
+ * executes the requests in order and replies to each (protocol:
+ * remote_proto.h).  A WRITE flagged QUERY is followed by a read whose result
+ * is sent as an extra READ reply without being asked for.  With resources on
+ * the command line only those can be opened (compared case-insensitively);
+ * otherwise any resource this host can reach.
+ *
+ * There is no authentication: anyone who can connect drives the
+ * instruments.  The server listens on 127.0.0.1 unless -l names another
+ * address (0.0.0.0 for all interfaces); reach it from elsewhere through an
+ * SSH tunnel, or open it up with -l on a trusted network only.
+ */
+
+#include "visa.h"
+#include "remote_proto.h"
+#include "../core/lz4.h"
+#include "../core/thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#ifndef MSG_NOSIGNAL
+    #define MSG_NOSIGNAL 0      /* SIGPIPE is ignored */
+#endif
+
+typedef struct {
+    int         fd;
+    ViSession   vi;
+    uint8_t    *buf;            /* request payload / read data */
+    size_t      cap;
+    uint8_t    *zbuf;           /* compressed payload */
+    size_t      zcap;
+} Client;
+
+static ViSession g_rm;
+static OvMutex   g_open_lock = OV_MUTEX_INIT;  /* session table is not thread-safe */
+static char    **g_allowed;
+static int       g_nallowed;
+static volatile sig_atomic_t g_stop;
+
+static void on_signal(int sig) { (void)sig; g_stop = 1; }
+
+static bool grow(uint8_t **buf, size_t *cap, size_t need) {
+    if (*cap >= need) return true;
+    uint8_t *nb = (uint8_t*)realloc(*buf, need);
+    if (!nb) return false;
+    *buf = nb;
+    *cap = need;
+    return true;
+}
+
+/* ========== Framing ========== */
+
+static bool send_all(int fd, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t*)data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p   += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static bool recv_all(int fd, void *data, size_t len) {
+    uint8_t *p = (uint8_t*)data;
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p   += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static bool reply(Client *c, uint8_t op, ViStatus st, uint32_t arg, const uint8_t *data, uint32_t len) {
+    OvrHeader h = { .op = op, .status = st, .arg = arg, .len = len, .raw_len = len };
+    if (len >= OVR_LZ4_MIN && grow(&c->zbuf, &c->zcap, OV_LZ4_BOUND((size_t)len))) {
+        size_t z = ov_lz4_compress(data, len, c->zbuf, c->zcap);
+        if (z && z < len) {
+            data = c->zbuf;
+            h.len = (uint32_t)z;
+            h.flags = OVR_F_LZ4;
+        }
+    }
+    uint8_t hb[OVR_HDR_SIZE];
+    ovr_encode(&h, hb);
+    return send_all(c->fd, hb, sizeof(hb)) && (h.len == 0 || send_all(c->fd, data, h.len));
+}
+
+/* Request payload lands in c->buf, decompressed */
+static bool recv_request(Client *c, OvrHeader *h) {
+    uint8_t hb[OVR_HDR_SIZE];
+    if (!recv_all(c->fd, hb, sizeof(hb))) return false;
+    ovr_decode(hb, h);
+    if (h->len > OVR_MAX_PAYLOAD || h->raw_len > OVR_MAX_PAYLOAD) return false;
+    if (!(h->flags & OVR_F_LZ4)) h->raw_len = h->len;
+    if (!grow(&c->buf, &c->cap, h->raw_len + 1)) return false;
+    if (!(h->flags & OVR_F_LZ4)) return recv_all(c->fd, c->buf, h->len);
+
+    return grow(&c->zbuf, &c->zcap, h->len) && recv_all(c->fd, c->zbuf, h->len) &&
+           ov_lz4_decompress(c->zbuf, h->len, c->buf, h->raw_len);
+}
+
+/* ========== Requests ========== */
+
+static bool allowed(const char *rsrc) {
+    if (g_nallowed == 0) return true;
+    for (int i = 0; i < g_nallowed; i++)
+        if (strcasecmp(g_allowed[i], rsrc) == 0) return true;
+    return false;
+}
+
+static bool do_read(Client *c, uint32_t count, uint32_t timeout) {
+    if (count > OVR_MAX_PAYLOAD) count = OVR_MAX_PAYLOAD;
+    if (!grow(&c->buf, &c->cap, count ? count : 1)) return reply(c, OVR_READ, VI_ERROR_ALLOC, 0, NULL, 0);
+    viSetAttribute(c->vi, VI_ATTR_TMO_VALUE, timeout);
+    ViUInt32 n = 0;
+    ViStatus st = viRead(c->vi, c->buf, count, &n);
+    return reply(c, OVR_READ, st, 0, c->buf, st >= VI_SUCCESS ? n : 0);
+}
+
+static bool serve_one(Client *c, const OvrHeader *h) {
+    ViStatus st;
+    ViUInt32 n = 0;
+    ViUInt16 stb = 0;
+
+    switch (h->op) {
+        case OVR_OPEN:
+            c->buf[h->raw_len] = '\0';
+            if (c->vi != VI_NULL) return reply(c, OVR_OPEN, VI_ERROR_INV_SETUP, 0, NULL, 0);
+            if (!allowed((char*)c->buf)) return reply(c, OVR_OPEN, VI_ERROR_RSRC_NFOUND, 0, NULL, 0);
+            ov_mutex_lock(&g_open_lock);
+            st = viOpen(g_rm, (ViRsrc)c->buf, VI_NULL, h->timeout, &c->vi);
+            ov_mutex_unlock(&g_open_lock);
+            if (st < VI_SUCCESS) c->vi = VI_NULL;
+            return reply(c, OVR_OPEN, st, 0, NULL, 0);
+
+        case OVR_WRITE:
+            viSetAttribute(c->vi, VI_ATTR_TMO_VALUE, h->timeout);
+            st = viWrite(c->vi, c->buf, h->raw_len, &n);
+            if (!reply(c, OVR_WRITE, st, n, NULL, 0)) return false;
+            if (!(h->flags & OVR_F_QUERY)) return true;
+            /* The client is owed a READ reply either way */
+            if (st < VI_SUCCESS) return reply(c, OVR_READ, st, 0, NULL, 0);
+            return do_read(c, h->arg, h->timeout);
+
+        case OVR_READ:
+            return do_read(c, h->arg, h->timeout);
+
+        case OVR_READSTB:
+            st = viReadSTB(c->vi, &stb);
+            return reply(c, OVR_READSTB, st, stb, NULL, 0);
+
+        case OVR_CLEAR:
+            return reply(c, OVR_CLEAR, viClear(c->vi), 0, NULL, 0);
+
+        default:
+            return false;
+    }
+}
+
+static void *client_thread(void *arg) {
+    Client *c = (Client*)arg;
+    OvrHeader h;
+    while (recv_request(c, &h) && serve_one(c, &h))
+        ;
+    if (c->vi != VI_NULL) {
+        ov_mutex_lock(&g_open_lock);
+        viClose(c->vi);
+        ov_mutex_unlock(&g_open_lock);
+    }
+    close(c->fd);
+    free(c->buf);
+    free(c->zbuf);
+    free(c);
+    return NULL;
+}
+
+/* ========== Setup ========== */
+
+static void usage(void) {
+    fprintf(stderr, "usage: openvisa-server [-p port] [-l address] [resource ...]\n");
+}
+
+int main(int argc, char **argv) {
+    int port = OVR_DEFAULT_PORT;
+    const char *addr = "127.0.0.1";
+
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)      port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) addr = argv[++i];
+        else { usage(); return 1; }
+    }
+    g_allowed  = argv + i;
+    g_nallowed = argc - i;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;                  /* no SA_RESTART: accept() returns */
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (viOpenDefaultRM(&g_rm) != VI_SUCCESS) return 1;
+
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, addr, &sin.sin_addr) != 1) { usage(); return 1; }
+
+    int ls = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(ls, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (ls < 0 || bind(ls, (struct sockaddr*)&sin, sizeof(sin)) != 0 || listen(ls, 32) != 0) {
+        fprintf(stderr, "openvisa-server: cannot listen on %s:%d\n", addr, port);
+        return 1;
+    }
+    fprintf(stderr, "openvisa-server: listening on %s:%d\n", addr, port);
+    if ((ntohl(sin.sin_addr.s_addr) >> 24) != 127)
+        fprintf(stderr, "openvisa-server: no authentication, any client that reaches %s can use %s\n",
+                addr, g_nallowed ? "the listed resources" : "every resource of this host");
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    while (!g_stop) {
+        int fd = accept(ls, NULL, NULL);
+        if (fd < 0) continue;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        Client *c = (Client*)calloc(1, sizeof(Client));
+        pthread_t th;
+        if (!c) { close(fd); continue; }
+        c->fd = fd;
+        if (pthread_create(&th, &attr, client_thread, c) != 0) { close(fd); free(c); }
+    }
+
+    close(ls);
+    viClose(g_rm);
+    return 0;
+}
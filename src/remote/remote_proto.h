@@ -0,0 +1,88 @@
+/*
+ * OpenVISA - Remote VISA wire protocol (visa://host[:port]/RESOURCE)
+ *
+ * Shared by openvisa-server (src/remote/openvisa_server.c) and the remote
+ * client transport (src/transport/remote.c).  One TCP connection per
+ * session.  Requests are executed strictly in order and every request gets
+ * exactly one reply, in order, so the client can keep several requests in
+ * flight: writes are not waited for, and a write flagged QUERY makes the
+ * server read the response right away and send it along (an extra READ
+ * reply), which saves the READ round trip.  A batch of queries therefore
+ * costs one round trip in total.
+ *
+ *   frame = OvrHeader (big-endian) + len bytes of payload
+ *
+ *   request   flags     payload    arg               reply arg / payload
+ *   OPEN      -         resource   -                 -
+ *   WRITE     QUERY?    data       read size (QUERY) bytes written
+ *                                                    (+ READ reply if QUERY)
+ *   READ      -         -          max bytes         - / data
+ *   READSTB   -         -          -                 status byte
+ *   CLEAR     -         -          -                 -
+ *
+ * Payloads of at least OVR_LZ4_MIN bytes are sent LZ4-compressed (flag LZ4,
+ * raw_len = decompressed size) when that makes them smaller.
+ */
+
+#ifndef OPENVISA_REMOTE_PROTO_H
+#define OPENVISA_REMOTE_PROTO_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define OVR_DEFAULT_PORT    3538
+
+#define OVR_OPEN            1
+#define OVR_WRITE           2
+#define OVR_READ            3
+#define OVR_READSTB         4
+#define OVR_CLEAR           5
+
+#define OVR_F_LZ4           0x01    /* payload is an LZ4 block */
+#define OVR_F_QUERY         0x02    /* WRITE: read the response immediately */
+
+#define OVR_MAX_PAYLOAD     (16u << 20)
+#define OVR_LZ4_MIN         512u
+#define OVR_HDR_SIZE        24
+
+typedef struct {
+    uint8_t  op;
+    uint8_t  flags;
+    int32_t  status;        /* reply only */
+    uint32_t arg;
+    uint32_t timeout;       /* ms */
+    uint32_t len;           /* payload bytes on the wire */
+    uint32_t raw_len;       /* payload bytes after decompression */
+} OvrHeader;
+
+static inline void ovr_put32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);  p[3] = (uint8_t)v;
+}
+
+static inline uint32_t ovr_get32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void ovr_encode(const OvrHeader *h, uint8_t out[OVR_HDR_SIZE]) {
+    out[0] = h->op;
+    out[1] = h->flags;
+    out[2] = out[3] = 0;
+    ovr_put32(out + 4,  (uint32_t)h->status);
+    ovr_put32(out + 8,  h->arg);
+    ovr_put32(out + 12, h->timeout);
+    ovr_put32(out + 16, h->len);
+    ovr_put32(out + 20, h->raw_len);
+}
+
+static inline void ovr_decode(const uint8_t in[OVR_HDR_SIZE], OvrHeader *h) {
+    h->op      = in[0];
+    h->flags   = in[1];
+    h->status  = (int32_t)ovr_get32(in + 4);
+    h->arg     = ovr_get32(in + 8);
+    h->timeout = ovr_get32(in + 12);
+    h->len     = ovr_get32(in + 16);
+    h->raw_len = ovr_get32(in + 20);
+}
+
+#endif /* OPENVISA_REMOTE_PROTO_H */
@@ -9,9 +9,14 @@
  * Supported GPIB resource string:
  *   GPIB{board}::{pad}[::sad]::INSTR
  *   e.g. GPIB0::22::INSTR
+ *
+ * Triggers are sent as addressed bus commands (UNT UNL LAD.. GET) from the
+ * board, so every device of a trigger group on one board is triggered by a
+ * single ibcmd() and sees GET at the same instant.
  */
 
 #include "../core/session.h"
+#include "../core/plugin.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -59,6 +64,13 @@ typedef int Addr4882_t;     /* board / device descriptor */
 /* ibconfig request codes */
 #define IbcTMO 3
 
+/* IEEE 488.1 bus commands (sent with ATN asserted) */
+#define GPIB_CMD_GET    0x08    /* Group Execute Trigger */
+#define GPIB_CMD_LAD    0x20    /* | primary address: listen address */
+#define GPIB_CMD_UNL    0x3F    /* unlisten */
+#define GPIB_CMD_UNT    0x5F    /* untalk */
+#define GPIB_CMD_SAD    0x60    /* | secondary address */
+
 /* Timeout constants (T1..T13 → ~1us..~1000s) */
 #define TNONE  0
 #define T1us   1
@@ -86,6 +98,8 @@ typedef int (*fn_ibrsp)(int ud, char *spr);
 typedef int (*fn_ibclr)(int ud);
 typedef int (*fn_ibonl)(int ud, int v);
 typedef int (*fn_ibconfig)(int ud, int option, int v);
+typedef int (*fn_ibcmd)(int ud, const void *cmd, long cnt);
+typedef int (*fn_ibfind)(const char *name);
 typedef int* (*fn_ThreadIbsta)(void);
 typedef int* (*fn_ThreadIberr)(void);
 typedef long* (*fn_ThreadIbcntl)(void);
@@ -107,6 +121,12 @@ typedef struct {
     fn_ibclr    p_ibclr;
     fn_ibonl    p_ibonl;
     fn_ibconfig p_ibconfig;
+    fn_ibcmd    p_ibcmd;       /* optional: needed for triggers */
+    fn_ibfind   p_ibfind;      /* optional: board descriptor by name */
+
+    int         board_ud;      /* board descriptor for ibcmd (-1 = not resolved) */
+    uint8_t     trig_cmd[72];  /* armed UNT UNL LAD[SAD].. GET sequence */
+    long        trig_len;
 
     /* Thread-local stat accessors (linux-gpib ≥ 4.x) — may be NULL */
     fn_ThreadIbsta  p_ibsta;
@@ -203,6 +223,8 @@ static bool gpib_load_lib(GpibImpl *g) {
     g->p_ibclr   = (fn_ibclr)   ov_dlsym(g->lib, "ibclr");
     g->p_ibonl   = (fn_ibonl)   ov_dlsym(g->lib, "ibonl");
     g->p_ibconfig = (fn_ibconfig)ov_dlsym(g->lib, "ibconfig");
+    g->p_ibcmd   = (fn_ibcmd)   ov_dlsym(g->lib, "ibcmd");
+    g->p_ibfind  = (fn_ibfind)  ov_dlsym(g->lib, "ibfind");
 
     if (!g->p_ibdev || !g->p_ibwrt || !g->p_ibrd ||
         !g->p_ibrsp || !g->p_ibclr || !g->p_ibonl) {
@@ -328,6 +350,65 @@ static ViStatus gpib_clear(OvTransport *self) {
     return gpib_map_status(g, rc);
 }
 
+/*
+ * Trigger.  The first peer on each board becomes the leader and arms one
+ * command string addressing every peer on that board as listener; the other
+ * peers point *leader at it and are never fired themselves.
+ */
+static ViStatus gpib_trigger_arm(OvTransport *self, OvTransport *const peers[],
+                                 ViUInt32 npeers, ViUInt32 *leader) {
+    GpibImpl *g = (GpibImpl*)self->impl;
+    if (!g->lib || !g->p_ibcmd) return VI_ERROR_NSUP_OPER;
+    if (g->ud < 0) return VI_ERROR_CONN_LOST;
+
+    for (ViUInt32 i = 0; i < npeers; i++) {
+        GpibImpl *p = (GpibImpl*)peers[i]->impl;
+        if (p->board != g->board || p->ud < 0) continue;
+        if (peers[i] != self) { *leader = i; return VI_SUCCESS; }
+        break;
+    }
+
+    if (g->board_ud < 0) {
+        char name[16];
+        snprintf(name, sizeof(name), "gpib%d", g->board);
+        g->board_ud = g->p_ibfind ? g->p_ibfind(name) : -1;
+        if (g->board_ud < 0) g->board_ud = g->board;   /* linux-gpib: board index */
+    }
+
+    long n = 0;
+    g->trig_cmd[n++] = GPIB_CMD_UNT;
+    g->trig_cmd[n++] = GPIB_CMD_UNL;
+    for (ViUInt32 i = 0; i < npeers; i++) {
+        GpibImpl *p = (GpibImpl*)peers[i]->impl;
+        if (p->board != g->board || p->ud < 0) continue;
+        if (n + 3 > (long)sizeof(g->trig_cmd)) return VI_ERROR_INV_SETUP;
+        g->trig_cmd[n++] = (uint8_t)(GPIB_CMD_LAD | (p->pad & 0x1F));
+        if (p->sad >= 0)
+            g->trig_cmd[n++] = (uint8_t)(GPIB_CMD_SAD | (p->sad & 0x1F));
+    }
+    g->trig_cmd[n++] = GPIB_CMD_GET;
+    g->trig_len = n;
+    return VI_SUCCESS;
+}
+
+static ViStatus gpib_trigger_fire(OvTransport *self) {
+    GpibImpl *g = (GpibImpl*)self->impl;
+    int rc = g->p_ibcmd(g->board_ud, g->trig_cmd, g->trig_len);
+    return gpib_map_status(g, rc);
+}
+
+static ViStatus gpib_trigger_done(OvTransport *self, ViUInt32 timeout) {
+    (void)self; (void)timeout;
+    return VI_SUCCESS;
+}
+
+/* IEEE 488.2 message exchange: a query sent before the previous response
+ * is read makes most instruments discard it (-410 Query INTERRUPTED) */
+static ViUInt32 gpib_max_pending(OvTransport *self) {
+    (void)self;
+    return 1;
+}
+
 /* ========== Factory ========== */
 
 OvTransport* ov_transport_gpib_create(void) {
@@ -338,6 +419,7 @@ OvTransport* ov_transport_gpib_create(void) {
     if (!g) { free(t); return NULL; }
 
     g->ud    = -1;
+    g->board_ud = -1;
     g->board = 0;
     g->pad   = 1;
     g->sad   = -1;
@@ -353,6 +435,12 @@ OvTransport* ov_transport_gpib_create(void) {
     t->write   = gpib_write;
     t->readSTB = gpib_readSTB;
     t->clear   = gpib_clear;
+    t->maxPending  = gpib_max_pending;
+    t->triggerArm  = gpib_trigger_arm;
+    t->triggerFire = gpib_trigger_fire;
+    t->triggerDone = gpib_trigger_done;
 
     return t;
 }
+
+OV_TRANSPORT_PLUGIN(ov_transport_gpib_create)
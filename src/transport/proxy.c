@@ -0,0 +1,271 @@
+/*
+ * OpenVISA - Proxy Transport
+ *
+ * Handles PROXY::<name>[::INSTR]: the instrument is owned by an
+ * openvisa-proxy daemon (src/proxy/openvisa_proxy.c) and reached over its
+ * Unix socket, so any number of processes can share an instrument that only
+ * accepts a few connections.  Each session is one connection; every call is
+ * one request/reply frame (see src/proxy/proxy_proto.h).  Timeouts are
+ * enforced by the daemon, including time spent queued behind other clients.
+ */
+
+#include "../core/session.h"
+#include "../proxy/proxy_proto.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifndef OPENVISA_WINDOWS
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+    #include <errno.h>
+    #ifndef MSG_NOSIGNAL
+        #define MSG_NOSIGNAL 0      /* macOS: SO_NOSIGPIPE is not worth it here */
+    #endif
+    #ifndef SOCK_CLOEXEC
+        #define SOCK_CLOEXEC 0
+    #endif
+#endif
+
+typedef struct {
+    int      fd;
+    ViUInt32 timeout;       /* VI_ATTR_TMO_VALUE, for ops that carry none */
+} ProxyImpl;
+
+#ifndef OPENVISA_WINDOWS
+
+/* ========== Framing ========== */
+
+static ViStatus proxy_send_all(int fd, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return VI_ERROR_CONN_LOST;
+        p   += n;
+        len -= (size_t)n;
+    }
+    return VI_SUCCESS;
+}
+
+static ViStatus proxy_recv_all(int fd, void *data, size_t len) {
+    uint8_t *p = (uint8_t *)data;
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return VI_ERROR_CONN_LOST;
+        p   += n;
+        len -= (size_t)n;
+    }
+    return VI_SUCCESS;
+}
+
+/*
+ * One round trip.  The reply payload goes to rbuf (at most rmax bytes; any
+ * excess is a protocol error).  Returns the transport status; the daemon's
+ * ViStatus is in reply->status.
+ */
+static ViStatus proxy_call(ProxyImpl *impl, uint32_t op, uint32_t arg, uint32_t timeout,
+                           const void *payload, uint32_t len,
+                           OvpHeader *reply, void *rbuf, uint32_t rmax)
+{
+    if (impl->fd < 0) return VI_ERROR_CONN_LOST;
+    OvpHeader req = { .op = op, .arg = arg, .timeout = timeout, .len = len };
+
+    ViStatus st = proxy_send_all(impl->fd, &req, sizeof(req));
+    if (st == VI_SUCCESS && len) st = proxy_send_all(impl->fd, payload, len);
+    if (st == VI_SUCCESS) st = proxy_recv_all(impl->fd, reply, sizeof(*reply));
+    if (st == VI_SUCCESS && (reply->op != op || reply->len > rmax)) st = VI_ERROR_IO;
+    if (st == VI_SUCCESS && reply->len) st = proxy_recv_all(impl->fd, rbuf, reply->len);
+
+    if (st != VI_SUCCESS) {
+        close(impl->fd);            /* stream is out of sync */
+        impl->fd = -1;
+    }
+    return st;
+}
+
+/* ========== Transport operations ========== */
+
+static ViStatus proxy_open(OvTransport *self, const OvResource *rsrc, ViUInt32 timeout) {
+    ProxyImpl *impl = (ProxyImpl *)self->impl;
+    size_t nlen = strlen(ov_rsrc_device(rsrc));
+    if (nlen == 0 || nlen > OVP_MAX_NAME) return VI_ERROR_INV_RSRC_NAME;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    ovp_socket_path(addr.sun_path, sizeof(addr.sun_path));
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return VI_ERROR_SYSTEM_ERROR;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return VI_ERROR_RSRC_NFOUND;      /* no daemon */
+    }
+    impl->fd = fd;
+    impl->timeout = timeout;
+
+    OvpHeader reply;
+    ViStatus st = proxy_call(impl, OVP_OPEN, 0, timeout, ov_rsrc_device(rsrc), (uint32_t)nlen,
+                             &reply, NULL, 0);
+    if (st == VI_SUCCESS) st = reply.status;
+    if (st < VI_SUCCESS && impl->fd >= 0) {
+        close(impl->fd);
+        impl->fd = -1;
+    }
+    return st;
+}
+
+static ViStatus proxy_close(OvTransport *self) {
+    ProxyImpl *impl = (ProxyImpl *)self->impl;
+    if (impl->fd >= 0) {
+        close(impl->fd);            /* the daemon drops our locks on EOF */
+        impl->fd = -1;
+    }
+    return VI_SUCCESS;
+}
+
+static ViStatus proxy_write(OvTransport *self, ViBuf buf, ViUInt32 count, ViUInt32 *retCount) {
+    ProxyImpl *impl = (ProxyImpl *)self->impl;
+    ViUInt32 total = 0;
+    ViStatus st = VI_SUCCESS;
+
+    /* Frames are capped; larger writes go out as consecutive WRITEs */
+    do {
+        uint32_t chunk = count - total > OVP_MAX_PAYLOAD ? OVP_MAX_PAYLOAD : count - total;
+        OvpHeader reply;
+        st = proxy_call(impl, OVP_WRITE, 0, impl->timeout, buf + total, chunk, &reply, NULL, 0);
+        if (st != VI_SUCCESS) break;
+        st = reply.status;
+        total += reply.arg;
+        if (st < VI_SUCCESS || reply.arg < chunk) break;
+    } while (total < count);
+
+    if (retCount) *retCount = total;
+    return st;
+}
+
+static ViStatus proxy_read(OvTransport *self, ViBuf buf, ViUInt32 count,
+                           ViUInt32 *retCount, ViUInt32 timeout) {
+    ProxyImpl *impl = (ProxyImpl *)self->impl;
+    if (retCount) *retCount = 0;
+
+    uint32_t ask = count > OVP_MAX_PAYLOAD ? OVP_MAX_PAYLOAD : count;
+    OvpHeader reply;
+    ViStatus st = proxy_call(impl, OVP_READ, ask, timeout, NULL, 0, &reply, buf, ask);
+    if (st != VI_SUCCESS) return st;
+
+    if (retCount) *retCount = reply.len;
+    return reply.status;
+}
+
+static ViStatus proxy_readSTB(OvTransport *self, ViUInt16 *status) {
+    ProxyImpl *impl = (ProxyImpl *)self->impl;
+    OvpHeader reply;
+    ViStatus st = proxy_call(impl, OVP_READSTB, 0, impl->timeout, NULL, 0, &reply, NULL, 0);
+    if (st != VI_SUCCESS) return st;
+    if (reply.status >= VI_SUCCESS && status) *status = (ViUInt16)reply.arg;
+    return reply.status;
+}
+
+static ViStatus proxy_simple(OvTransport *self, uint32_t op, ViUInt32 timeout) {
+    ProxyImpl *impl = (ProxyImpl *)self->impl;
+    OvpHeader reply;
+    ViStatus st = proxy_call(impl, op, 0, timeout, NULL, 0, &reply, NULL, 0);
+    return st != VI_SUCCESS ? st : reply.status;
+}
+
+static ViStatus proxy_clear(OvTransport *self) {
+    return proxy_simple(self, OVP_CLEAR, ((ProxyImpl *)self->impl)->timeout);
+}
+
+static ViStatus proxy_lock(OvTransport *self, ViUInt32 timeout) {
+    return proxy_simple(self, OVP_LOCK, timeout);
+}
+
+static ViStatus proxy_unlock(OvTransport *self) {
+    return proxy_simple(self, OVP_UNLOCK, 0);
+}
+
+#else  /* OPENVISA_WINDOWS — the daemon listens on a Unix socket only */
+
+static ViStatus proxy_open(OvTransport *self, const OvResource *rsrc, ViUInt32 timeout) {
+    (void)self; (void)rsrc; (void)timeout;
+    return VI_ERROR_NSUP_OPER;
+}
+
+static ViStatus proxy_close(OvTransport *self) {
+    (void)self;
+    return VI_SUCCESS;
+}
+
+static ViStatus proxy_write(OvTransport *self, ViBuf buf, ViUInt32 count, ViUInt32 *retCount) {
+    (void)self; (void)buf; (void)count; (void)retCount;
+    return VI_ERROR_NSUP_OPER;
+}
+
+static ViStatus proxy_read(OvTransport *self, ViBuf buf, ViUInt32 count,
+                           ViUInt32 *retCount, ViUInt32 timeout) {
+    (void)self; (void)buf; (void)count; (void)retCount; (void)timeout;
+    return VI_ERROR_NSUP_OPER;
+}
+
+static ViStatus proxy_readSTB(OvTransport *self, ViUInt16 *status) {
+    (void)self; (void)status;
+    return VI_ERROR_NSUP_OPER;
+}
+
+static ViStatus proxy_clear(OvTransport *self) {
+    (void)self;
+    return VI_ERROR_NSUP_OPER;
+}
+
+static ViStatus proxy_lock(OvTransport *self, ViUInt32 timeout) {
+    (void)self; (void)timeout;
+    return VI_ERROR_NSUP_OPER;
+}
+
+static ViStatus proxy_unlock(OvTransport *self) {
+    (void)self;
+    return VI_ERROR_NSUP_OPER;
+}
+
+#endif
+
+/* ========== Attributes ========== */
+
+static ViStatus proxy_setAttribute(OvTransport *self, ViAttr attr, ViAttrState value) {
+    if (attr != VI_ATTR_TMO_VALUE) return VI_ERROR_NSUP_ATTR;
+    ((ProxyImpl *)self->impl)->timeout = (ViUInt32)value;
+    return VI_SUCCESS;
+}
+
+/* ========== Factory ========== */
+
+OvTransport *ov_transport_proxy_create(void) {
+    OvTransport *t = (OvTransport *)calloc(1, sizeof(OvTransport));
+    if (!t) return NULL;
+
+    ProxyImpl *impl = (ProxyImpl *)calloc(1, sizeof(ProxyImpl));
+    if (!impl) {
+        free(t);
+        return NULL;
+    }
+    impl->fd      = -1;
+    impl->timeout = 2000;
+
+    t->impl    = impl;
+    t->open    = proxy_open;
+    t->close   = proxy_close;
+    t->read    = proxy_read;
+    t->write   = proxy_write;
+    t->readSTB = proxy_readSTB;
+    t->clear   = proxy_clear;
+    t->lock    = proxy_lock;
+    t->unlock  = proxy_unlock;
+    t->setAttribute = proxy_setAttribute;
+
+    return t;
+}
@@ -0,0 +1,469 @@
+/*
+ * OpenVISA - Remote VISA Transport
+ *
+ * Handles visa://host[:port]/RESOURCE: RESOURCE is opened by an
+ * openvisa-server on host (src/remote/openvisa_server.c) and every call is
+ * forwarded over one TCP connection (protocol: src/remote/remote_proto.h).
+ *
+ * Built for slow links:
+ *   - viWrite does not wait for its reply.  The status comes back later and
+ *     a failure is returned by the next call on the session.
+ *   - A query (a '?' outside quoted strings and block data) asks the
+ *     server to read the response at once; it arrives unrequested and the next viRead takes it from the local
+ *     queue, so a query is one round trip and a burst of queries (ovPipeline,
+ *     back-to-back viWrite) shares one.
+ *   - Payloads from OVR_LZ4_MIN bytes up travel LZ4-compressed when that
+ *     helps.
+ * While a send blocks, incoming replies are drained, so a long burst never
+ * deadlocks against a server whose replies fill the socket buffers.
+ */
+
+#include "../core/session.h"
+#include "../core/lz4.h"
+#include "../core/scpi.h"
+#include "../remote/remote_proto.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifdef OPENVISA_WINDOWS
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma comment(lib, "ws2_32.lib")
+    typedef SOCKET ov_socket_t;
+    #define OV_INVALID_SOCKET INVALID_SOCKET
+    #define ov_closesocket closesocket
+    #define ov_poll WSAPoll
+    #define RM_WOULDBLOCK(e) ((e) == WSAEWOULDBLOCK)
+    #define ov_socket_error() WSAGetLastError()
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <netdb.h>
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <errno.h>
+    #include <poll.h>
+    typedef int ov_socket_t;
+    #define OV_INVALID_SOCKET (-1)
+    #define ov_closesocket close
+    #define ov_poll poll
+    #define RM_WOULDBLOCK(e) ((e) == EAGAIN || (e) == EWOULDBLOCK)
+    #define ov_socket_error() errno
+    #ifndef MSG_NOSIGNAL
+        #define MSG_NOSIGNAL 0
+    #endif
+#endif
+
+#define RM_LINK_SLACK_MS    5000u   /* network allowance on top of the VISA timeout */
+#define RM_READ_HINT        65536u  /* response size the server reads for a query */
+
+/* Response that arrived before viRead asked for it */
+typedef struct RmResp {
+    ViStatus        status;
+    uint8_t        *data;
+    uint32_t        len;
+    uint32_t        off;
+    struct RmResp  *next;
+} RmResp;
+
+typedef struct {
+    ov_socket_t sock;
+    ViUInt32    timeout;        /* VI_ATTR_TMO_VALUE; used by calls that carry none */
+    ViUInt32    read_hint;      /* last viRead size, for query read-ahead */
+    uint32_t    acks_owed;      /* WRITE replies still to come */
+    uint32_t    reads_owed;     /* query READ replies still to come */
+    ViStatus    deferred;       /* first failed write not yet reported */
+    RmResp     *head, *tail;
+    uint8_t    *zbuf;           /* compression scratch */
+    size_t      zcap;
+} RemoteImpl;
+
+/* ========== Platform init ========== */
+
+#ifdef OPENVISA_WINDOWS
+static volatile int g_rm_wsa_init = 0;
+static void remote_platform_init(void) {
+    if (!g_rm_wsa_init) {
+        WSADATA wsa;
+        WSAStartup(MAKEWORD(2, 2), &wsa);
+        g_rm_wsa_init = 1;
+    }
+}
+#else
+static void remote_platform_init(void) { /* no-op on POSIX */ }
+#endif
+
+/* The socket stays non-blocking; every send and recv waits in poll first */
+static void remote_set_nonblock(ov_socket_t s) {
+#ifdef OPENVISA_WINDOWS
+    u_long mode = 1;
+    ioctlsocket(s, FIONBIO, &mode);
+#else
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+static bool remote_zbuf(RemoteImpl *impl, size_t need) {
+    if (impl->zcap >= need) return true;
+    uint8_t *nb = (uint8_t *)realloc(impl->zbuf, need);
+    if (!nb) return false;
+    impl->zbuf = nb;
+    impl->zcap = need;
+    return true;
+}
+
+static void remote_drop(RemoteImpl *impl) {
+    if (impl->sock != OV_INVALID_SOCKET) {
+        ov_closesocket(impl->sock);
+        impl->sock = OV_INVALID_SOCKET;
+    }
+}
+
+/* ========== Receiving ========== */
+
+static ViStatus remote_recv_all(RemoteImpl *impl, void *data, size_t len, ViUInt32 timeout) {
+    uint8_t *p = (uint8_t *)data;
+    int wait = timeout == VI_TMO_INFINITE ? -1 : (int)(timeout + RM_LINK_SLACK_MS);
+    while (len > 0) {
+        struct pollfd pfd = { .fd = impl->sock, .events = POLLIN };
+        int rc = ov_poll(&pfd, 1, wait);
+        if (rc == 0) { remote_drop(impl); return VI_ERROR_CONN_LOST; }   /* link stalled */
+        if (rc < 0) continue;
+        int n = recv(impl->sock, (char *)p, (int)(len > 0x40000000u ? 0x40000000u : len), 0);
+        if (n < 0 && RM_WOULDBLOCK(ov_socket_error())) continue;
+        if (n <= 0) { remote_drop(impl); return VI_ERROR_CONN_LOST; }
+        p   += n;
+        len -= (size_t)n;
+    }
+    return VI_SUCCESS;
+}
+
+/* Reads one reply frame; the payload is decompressed into a malloc'd buffer */
+static ViStatus remote_recv_frame(RemoteImpl *impl, OvrHeader *h, uint8_t **payload, ViUInt32 timeout) {
+    uint8_t hb[OVR_HDR_SIZE];
+    *payload = NULL;
+    ViStatus st = remote_recv_all(impl, hb, sizeof(hb), timeout);
+    if (st != VI_SUCCESS) return st;
+    ovr_decode(hb, h);
+    if (h->len > OVR_MAX_PAYLOAD || h->raw_len > OVR_MAX_PAYLOAD) { remote_drop(impl); return VI_ERROR_IO; }
+    if (h->len == 0) { h->raw_len = 0; return VI_SUCCESS; }
+
+    uint8_t *out = (uint8_t *)malloc(h->raw_len ? h->raw_len : 1);
+    if (!out) { remote_drop(impl); return VI_ERROR_ALLOC; }
+    if (h->flags & OVR_F_LZ4) {
+        if (!remote_zbuf(impl, h->len)) { free(out); remote_drop(impl); return VI_ERROR_ALLOC; }
+        st = remote_recv_all(impl, impl->zbuf, h->len, timeout);
+        if (st == VI_SUCCESS && !ov_lz4_decompress(impl->zbuf, h->len, out, h->raw_len)) {
+            remote_drop(impl);
+            st = VI_ERROR_IO;
+        }
+    } else {
+        h->raw_len = h->len;
+        st = remote_recv_all(impl, out, h->len, timeout);
+    }
+    if (st != VI_SUCCESS) { free(out); return st; }
+    *payload = out;
+    return VI_SUCCESS;
+}
+
+/* Consume one reply owed to earlier writes */
+static ViStatus remote_pump(RemoteImpl *impl, ViUInt32 timeout) {
+    OvrHeader h;
+    uint8_t *data;
+    ViStatus st = remote_recv_frame(impl, &h, &data, timeout);
+    if (st != VI_SUCCESS) return st;
+
+    if (h.op == OVR_WRITE && impl->acks_owed) {
+        impl->acks_owed--;
+        if (h.status < VI_SUCCESS && impl->deferred == VI_SUCCESS) impl->deferred = h.status;
+        free(data);
+        return VI_SUCCESS;
+    }
+    if (h.op == OVR_READ && impl->reads_owed) {
+        RmResp *r = (RmResp *)calloc(1, sizeof(RmResp));
+        if (!r) { free(data); return VI_ERROR_ALLOC; }
+        impl->reads_owed--;
+        r->status = h.status;
+        r->data   = data;
+        r->len    = h.raw_len;
+        if (impl->tail) impl->tail->next = r;
+        else impl->head = r;
+        impl->tail = r;
+        return VI_SUCCESS;
+    }
+    free(data);
+    remote_drop(impl);                  /* out of sequence */
+    return VI_ERROR_IO;
+}
+
+/* ========== Sending ========== */
+
+/* Blocking send that keeps draining replies so neither side stalls on full buffers */
+static ViStatus remote_send_all(RemoteImpl *impl, const uint8_t *p, size_t len) {
+    while (len > 0) {
+        struct pollfd pfd = { .fd = impl->sock, .events = POLLOUT };
+        if (impl->acks_owed || impl->reads_owed) pfd.events |= POLLIN;
+        int rc = ov_poll(&pfd, 1, (int)(impl->timeout + RM_LINK_SLACK_MS));
+        if (rc == 0) { remote_drop(impl); return VI_ERROR_CONN_LOST; }
+        if (rc < 0) continue;
+        if ((pfd.revents & POLLIN) && !(pfd.revents & POLLOUT)) {
+            ViStatus st = remote_pump(impl, impl->timeout);
+            if (st != VI_SUCCESS) return st;
+            continue;
+        }
+        int n = send(impl->sock, (const char *)p, (int)(len > 0x40000000u ? 0x40000000u : len), MSG_NOSIGNAL);
+        if (n < 0 && RM_WOULDBLOCK(ov_socket_error())) continue;
+        if (n <= 0) { remote_drop(impl); return VI_ERROR_CONN_LOST; }
+        p   += n;
+        len -= (size_t)n;
+    }
+    return VI_SUCCESS;
+}
+
+static ViStatus remote_send_frame(RemoteImpl *impl, OvrHeader *h, const void *payload, uint32_t len) {
+    if (impl->sock == OV_INVALID_SOCKET) return VI_ERROR_CONN_LOST;
+
+    const uint8_t *body = (const uint8_t *)payload;
+    h->len = h->raw_len = len;
+    if (len >= OVR_LZ4_MIN && remote_zbuf(impl, OV_LZ4_BOUND((size_t)len))) {
+        size_t z = ov_lz4_compress(body, len, impl->zbuf, impl->zcap);
+        if (z && z < len) {
+            body = impl->zbuf;
+            h->len = (uint32_t)z;
+            h->flags |= OVR_F_LZ4;
+        }
+    }
+
+    uint8_t hb[OVR_HDR_SIZE];
+    ovr_encode(h, hb);
+    ViStatus st = remote_send_all(impl, hb, sizeof(hb));
+    if (st == VI_SUCCESS && h->len) st = remote_send_all(impl, body, h->len);
+    return st;
+}
+
+/* Synchronous call: everything owed is received first, then the reply */
+static ViStatus remote_call(RemoteImpl *impl, OvrHeader *req, const void *payload, uint32_t len,
+                            OvrHeader *reply, uint8_t **data, ViUInt32 timeout)
+{
+    ViStatus st = remote_send_frame(impl, req, payload, len);
+    while (st == VI_SUCCESS && (impl->acks_owed || impl->reads_owed))
+        st = remote_pump(impl, timeout);
+    if (st == VI_SUCCESS) st = remote_recv_frame(impl, reply, data, timeout);
+    if (st == VI_SUCCESS && reply->op != req->op) {
+        free(*data);
+        *data = NULL;
+        remote_drop(impl);
+        st = VI_ERROR_IO;
+    }
+    return st;
+}
+
+/* A write that failed since the last call is reported now, once */
+static ViStatus remote_take_deferred(RemoteImpl *impl) {
+    ViStatus st = impl->deferred;
+    impl->deferred = VI_SUCCESS;
+    return st;
+}
+
+/* ========== Transport operations ========== */
+
+static ViStatus remote_open(OvTransport *self, const OvResource *rsrc, ViUInt32 timeout) {
+    RemoteImpl *impl = (RemoteImpl *)self->impl;
+    remote_platform_init();
+
+    char port_str[8];
+    snprintf(port_str, sizeof(port_str), "%u", rsrc->port ? rsrc->port : OVR_DEFAULT_PORT);
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(ov_rsrc_host(rsrc), port_str, &hints, &res) != 0) return VI_ERROR_RSRC_NFOUND;
+
+    ViStatus st = VI_ERROR_RSRC_NFOUND;
+    for (struct addrinfo *ai = res; ai && st != VI_SUCCESS; ai = ai->ai_next) {
+        ov_socket_t s = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (s == OV_INVALID_SOCKET) continue;
+        remote_set_nonblock(s);
+        int rc = connect(s, ai->ai_addr, (int)ai->ai_addrlen);
+        if (rc != 0) {
+            struct pollfd pfd = { .fd = s, .events = POLLOUT };
+            int err = 0;
+            socklen_t elen = sizeof(err);
+            if (ov_poll(&pfd, 1, (int)timeout) == 1 &&
+                getsockopt(s, SOL_SOCKET, SO_ERROR, (char *)&err, &elen) == 0 && err == 0)
+                rc = 0;
+        }
+        if (rc != 0) { ov_closesocket(s); st = VI_ERROR_TMO; continue; }
+        int one = 1;
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char *)&one, sizeof(one));
+        impl->sock = s;
+        st = VI_SUCCESS;
+    }
+    freeaddrinfo(res);
+    if (st != VI_SUCCESS) return st;
+
+    impl->timeout = timeout;
+    OvrHeader req = { .op = OVR_OPEN, .timeout = timeout }, reply;
+    uint8_t *data;
+    st = remote_call(impl, &req, ov_rsrc_device(rsrc), (uint32_t)strlen(ov_rsrc_device(rsrc)),
+                     &reply, &data, timeout);
+    free(data);
+    if (st == VI_SUCCESS) st = reply.status;
+    if (st < VI_SUCCESS) remote_drop(impl);
+    return st;
+}
+
+static ViStatus remote_close(OvTransport *self) {
+    RemoteImpl *impl = (RemoteImpl *)self->impl;
+    remote_drop(impl);                  /* the server closes the session on EOF */
+    while (impl->head) {
+        RmResp *r = impl->head;
+        impl->head = r->next;
+        free(r->data);
+        free(r);
+    }
+    impl->tail = NULL;
+    impl->acks_owed = impl->reads_owed = 0;
+    free(impl->zbuf);
+    impl->zbuf = NULL;
+    impl->zcap = 0;
+    return VI_SUCCESS;
+}
+
+static ViStatus remote_write(OvTransport *self, ViBuf buf, ViUInt32 count, ViUInt32 *retCount) {
+    RemoteImpl *impl = (RemoteImpl *)self->impl;
+    if (retCount) *retCount = 0;
+    ViStatus st = remote_take_deferred(impl);
+    if (st != VI_SUCCESS) return st;
+    if (count > OVR_MAX_PAYLOAD) return VI_ERROR_INV_SIZE;
+
+    OvrHeader req = { .op = OVR_WRITE, .timeout = impl->timeout };
+    bool query = ov_scpi_is_query(buf, count);
+    if (query) {
+        req.flags |= OVR_F_QUERY;
+        req.arg = impl->read_hint;
+    }
+    st = remote_send_frame(impl, &req, buf, count);
+    if (st != VI_SUCCESS) return st;
+    impl->acks_owed++;
+    if (query) impl->reads_owed++;
+
+    if (retCount) *retCount = count;    /* confirmed by the server later */
+    return VI_SUCCESS;
+}
+
+static ViStatus remote_read(OvTransport *self, ViBuf buf, ViUInt32 count,
+                            ViUInt32 *retCount, ViUInt32 timeout) {
+    RemoteImpl *impl = (RemoteImpl *)self->impl;
+    if (retCount) *retCount = 0;
+    if (count) impl->read_hint = count < RM_READ_HINT ? count : RM_READ_HINT;
+
+    /* A query's response is on its way: wait for it rather than asking */
+    ViStatus st = VI_SUCCESS;
+    while (st == VI_SUCCESS && !impl->head && impl->reads_owed)
+        st = remote_pump(impl, timeout);
+    if (st != VI_SUCCESS) return st;
+    st = remote_take_deferred(impl);
+    if (st != VI_SUCCESS) return st;
+
+    if (impl->head) {
+        RmResp *r = impl->head;
+        uint32_t n = r->len - r->off < count ? r->len - r->off : count;
+        if (n) memcpy(buf, r->data + r->off, n);
+        r->off += n;
+        if (retCount) *retCount = n;
+        if (r->off < r->len) return VI_SUCCESS_MAX_CNT;
+        st = r->status;
+        impl->head = r->next;
+        if (!impl->head) impl->tail = NULL;
+        free(r->data);
+        free(r);
+        return st;
+    }
+
+    OvrHeader req = { .op = OVR_READ, .arg = count, .timeout = timeout }, reply;
+    uint8_t *data;
+    st = remote_call(impl, &req, NULL, 0, &reply, &data, timeout);
+    if (st != VI_SUCCESS) return st;
+    if (reply.raw_len > count) { free(data); remote_drop(impl); return VI_ERROR_IO; }
+    if (reply.raw_len) memcpy(buf, data, reply.raw_len);
+    free(data);
+    if (retCount) *retCount = reply.raw_len;
+    return reply.status;
+}
+
+static ViStatus remote_simple(RemoteImpl *impl, uint8_t op, uint32_t *arg) {
+    ViStatus st = remote_take_deferred(impl);
+    if (st != VI_SUCCESS) return st;
+    OvrHeader req = { .op = op, .timeout = impl->timeout }, reply;
+    uint8_t *data;
+    st = remote_call(impl, &req, NULL, 0, &reply, &data, impl->timeout);
+    free(data);
+    if (st != VI_SUCCESS) return st;
+    if (arg) *arg = reply.arg;
+    return reply.status;
+}
+
+static ViStatus remote_readSTB(OvTransport *self, ViUInt16 *status) {
+    uint32_t stb = 0;
+    ViStatus st = remote_simple((RemoteImpl *)self->impl, OVR_READSTB, &stb);
+    if (st >= VI_SUCCESS && status) *status = (ViUInt16)stb;
+    return st;
+}
+
+static ViStatus remote_clear(OvTransport *self) {
+    RemoteImpl *impl = (RemoteImpl *)self->impl;
+    ViStatus st = remote_simple(impl, OVR_CLEAR, NULL);
+    /* Responses read ahead belong to the output queue that was just cleared */
+    while (st >= VI_SUCCESS && impl->head) {
+        RmResp *r = impl->head;
+        impl->head = r->next;
+        free(r->data);
+        free(r);
+    }
+    if (!impl->head) impl->tail = NULL;
+    return st;
+}
+
+static ViUInt32 remote_max_pending(OvTransport *self) {
+    (void)self;
+    return 0;                           /* the server queues in order */
+}
+
+/* ========== Attributes ========== */
+
+static ViStatus remote_setAttribute(OvTransport *self, ViAttr attr, ViAttrState value) {
+    if (attr != VI_ATTR_TMO_VALUE) return VI_ERROR_NSUP_ATTR;
+    ((RemoteImpl *)self->impl)->timeout = (ViUInt32)value;
+    return VI_SUCCESS;
+}
+
+/* ========== Factory ========== */
+
+OvTransport *ov_transport_remote_create(void) {
+    OvTransport *t = (OvTransport *)calloc(1, sizeof(OvTransport));
+    if (!t) return NULL;
+
+    RemoteImpl *impl = (RemoteImpl *)calloc(1, sizeof(RemoteImpl));
+    if (!impl) {
+        free(t);
+        return NULL;
+    }
+    impl->sock      = OV_INVALID_SOCKET;
+    impl->timeout   = 2000;
+    impl->read_hint = RM_READ_HINT;
+
+    t->impl       = impl;
+    t->open       = remote_open;
+    t->close      = remote_close;
+    t->read       = remote_read;
+    t->write      = remote_write;
+    t->readSTB    = remote_readSTB;
+    t->clear      = remote_clear;
+    t->maxPending = remote_max_pending;
+    t->setAttribute = remote_setAttribute;
+
+    return t;
+}
@@ -0,0 +1,792 @@
+/*
+ * OpenVISA - RFC 2217 Serial-over-TCP Transport
+ *
+ * Handles TCPIP[board]::host::port::ASRL: a serial port on a terminal server
+ * (Moxa NPort, Lantronix, ser2net, ...) in RFC 2217 mode.  The byte stream is
+ * Telnet with the COM-PORT-OPTION negotiated, so besides data the link
+ * carries:
+ *   - line settings: VI_ATTR_ASRL_BAUD, _DATA_BITS, _PARITY, _STOP_BITS and
+ *     _FLOW_CNTRL are sent to the server, which answers with what it applied;
+ *   - control lines: _DTR_STATE, _RTS_STATE and _BREAK_STATE are set and
+ *     queried remotely; _CTS/_DSR/_DCD/_RI_STATE follow the server's
+ *     NOTIFY-MODEMSTATE messages;
+ *   - line errors (NOTIFY-LINESTATE) fail the next viRead with
+ *     VI_ERROR_ASRL_PARITY / _FRAMING / _OVERRUN;
+ *   - FLOWCONTROL-SUSPEND / -RESUME from the server hold writes back.
+ *
+ * Received data is buffered in the transport and reads are framed locally
+ * by VI_ATTR_ASRL_END_IN (termchar by default, or last bit / none), so a
+ * burst holding several responses is one recv and several viReads.
+ * A server that refuses the option still carries data; the serial
+ * attributes then return VI_ERROR_NSUP_ATTR.
+ */
+
+#include "../core/session.h"
+#include "../core/thread.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifdef OPENVISA_WINDOWS
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma comment(lib, "ws2_32.lib")
+    typedef SOCKET ov_socket_t;
+    #define OV_INVALID_SOCKET INVALID_SOCKET
+    #define ov_closesocket closesocket
+    #define ov_poll WSAPoll
+    #define RFC_WOULDBLOCK(e) ((e) == WSAEWOULDBLOCK)
+    #define ov_socket_error() WSAGetLastError()
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <netdb.h>
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <errno.h>
+    #include <poll.h>
+    typedef int ov_socket_t;
+    #define OV_INVALID_SOCKET (-1)
+    #define ov_closesocket close
+    #define ov_poll poll
+    #define RFC_WOULDBLOCK(e) ((e) == EAGAIN || (e) == EWOULDBLOCK)
+    #define ov_socket_error() errno
+    #ifndef MSG_NOSIGNAL
+        #define MSG_NOSIGNAL 0
+    #endif
+#endif
+
+/* ========== Telnet / RFC 2217 constants ========== */
+
+#define TN_IAC      255
+#define TN_DONT     254
+#define TN_DO       253
+#define TN_WONT     252
+#define TN_WILL     251
+#define TN_SB       250
+#define TN_SE       240
+
+#define TN_OPT_BINARY   0
+#define TN_OPT_SGA      3
+#define TN_OPT_COMPORT  44
+
+/* COM-PORT-OPTION commands (client); the server answers with +100 */
+#define CPO_SIGNATURE           0
+#define CPO_SET_BAUDRATE        1
+#define CPO_SET_DATASIZE        2
+#define CPO_SET_PARITY          3
+#define CPO_SET_STOPSIZE        4
+#define CPO_SET_CONTROL         5
+#define CPO_NOTIFY_LINESTATE    6
+#define CPO_NOTIFY_MODEMSTATE   7
+#define CPO_FLOW_SUSPEND        8
+#define CPO_FLOW_RESUME         9
+#define CPO_SET_LINESTATE_MASK  10
+#define CPO_SET_MODEMSTATE_MASK 11
+#define CPO_PURGE_DATA          12
+#define CPO_SERVER              100
+#define CPO_NCMDS               13
+
+/* SET-CONTROL values */
+#define CTL_FLOW_REQUEST    0
+#define CTL_FLOW_NONE       1
+#define CTL_FLOW_XONXOFF    2
+#define CTL_FLOW_HARDWARE   3
+#define CTL_BREAK_REQUEST   4
+#define CTL_BREAK_ON        5
+#define CTL_BREAK_OFF       6
+#define CTL_DTR_REQUEST     7
+#define CTL_DTR_ON          8
+#define CTL_DTR_OFF         9
+#define CTL_RTS_REQUEST     10
+#define CTL_RTS_ON          11
+#define CTL_RTS_OFF         12
+#define CTL_FLOW_DSR        15
+
+/* NOTIFY-LINESTATE / -MODEMSTATE bits */
+#define LS_OVERRUN      0x02
+#define LS_PARITY       0x04
+#define LS_FRAMING      0x08
+#define LS_BREAK        0x10
+#define MS_CTS          0x10
+#define MS_DSR          0x20
+#define MS_RI           0x40
+#define MS_DCD          0x80
+
+#define RFC_RECV_CHUNK  4096u
+#define RFC_SB_MAX      64u
+
+/* Telnet receive state */
+enum { TNS_DATA, TNS_IAC, TNS_OPT, TNS_SB, TNS_SB_IAC };
+
+typedef struct {
+    ov_socket_t sock;
+    ViUInt32    timeout;            /* open or last read timeout; used by control requests */
+
+    /* Telnet parser, kept across recv boundaries */
+    uint8_t     tn_state;
+    uint8_t     tn_verb;
+    uint8_t     sb[RFC_SB_MAX];
+    uint32_t    sb_len;
+    bool        comport;            /* server sent DO COM-PORT-OPTION */
+    bool        comport_refused;    /* server sent DONT */
+    uint32_t    replies[CPO_NCMDS]; /* server answers received, per command */
+    uint32_t    reply_val[CPO_NCMDS];
+    uint8_t     ctl_out[64];        /* negotiation answers queued while parsing */
+    uint32_t    ctl_out_len;
+
+    /* Received data: rx[rx_off .. rx_off + rx_len) */
+    uint8_t    *rx;
+    uint32_t    rx_off, rx_len, rx_cap;
+
+    /* Port state as last confirmed by the server */
+    ViUInt32    baud;
+    ViUInt16    data_bits, parity, stop_bits, flow;
+    ViInt16     dtr, rts, brk;
+    int         modem;              /* NOTIFY-MODEMSTATE byte, -1 = none yet */
+    ViStatus    line_err;           /* reported by the next read */
+    bool        tx_suspended;
+
+    /* Read framing */
+    ViUInt16    end_in;
+    uint8_t     term_char;
+    bool        term_char_en;
+} Rfc2217Impl;
+
+/* ========== Platform helpers ========== */
+
+#ifdef OPENVISA_WINDOWS
+static volatile int g_rfc_wsa_init = 0;
+static void rfc_platform_init(void) {
+    if (!g_rfc_wsa_init) {
+        WSADATA wsa;
+        WSAStartup(MAKEWORD(2, 2), &wsa);
+        g_rfc_wsa_init = 1;
+    }
+}
+#else
+static void rfc_platform_init(void) { /* no-op on POSIX */ }
+#endif
+
+static void rfc_set_nonblock(ov_socket_t s) {
+#ifdef OPENVISA_WINDOWS
+    u_long mode = 1;
+    ioctlsocket(s, FIONBIO, &mode);
+#else
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+static void rfc_drop(Rfc2217Impl *impl) {
+    if (impl->sock != OV_INVALID_SOCKET) {
+        ov_closesocket(impl->sock);
+        impl->sock = OV_INVALID_SOCKET;
+    }
+}
+
+/* Milliseconds left until deadline (ns), -1 = no deadline */
+static int rfc_wait_ms(uint64_t deadline) {
+    if (deadline == UINT64_MAX) return -1;
+    uint64_t now = ov_time_ns();
+    return now >= deadline ? 0 : (int)((deadline - now + 999999u) / 1000000u);
+}
+
+static uint64_t rfc_deadline(ViUInt32 timeout) {
+    return timeout == VI_TMO_INFINITE ? UINT64_MAX : ov_time_ns() + (uint64_t)timeout * 1000000u;
+}
+
+/* ========== Sending ========== */
+
+static ViStatus rfc_pump(Rfc2217Impl *impl, int wait_ms);
+
+/* Blocking send that keeps taking input, so neither side stalls on full buffers */
+static ViStatus rfc_send_raw(Rfc2217Impl *impl, const uint8_t *p, size_t len) {
+    while (len > 0) {
+        if (impl->sock == OV_INVALID_SOCKET) return VI_ERROR_CONN_LOST;
+        struct pollfd pfd = { .fd = impl->sock, .events = POLLOUT | POLLIN };
+        int rc = ov_poll(&pfd, 1, rfc_wait_ms(rfc_deadline(impl->timeout)));
+        if (rc == 0) return VI_ERROR_TMO;
+        if (rc < 0) continue;
+        if ((pfd.revents & POLLIN) && !(pfd.revents & POLLOUT)) {
+            ViStatus st = rfc_pump(impl, 0);
+            if (st < VI_SUCCESS && st != VI_ERROR_TMO) return st;
+            continue;
+        }
+        int n = send(impl->sock, (const char *)p, (int)(len > 0x40000000u ? 0x40000000u : len), MSG_NOSIGNAL);
+        if (n < 0 && RFC_WOULDBLOCK(ov_socket_error())) continue;
+        if (n <= 0) { rfc_drop(impl); return VI_ERROR_CONN_LOST; }
+        p   += n;
+        len -= (size_t)n;
+    }
+    return VI_SUCCESS;
+}
+
+/* IAC SB COM-PORT-OPTION cmd value IAC SE, with 0xFF in value doubled */
+static ViStatus rfc_send_cpo(Rfc2217Impl *impl, uint8_t cmd, const uint8_t *val, uint32_t len) {
+    uint8_t m[4 + 2 * RFC_SB_MAX + 2];
+    uint32_t n = 0;
+    m[n++] = TN_IAC; m[n++] = TN_SB; m[n++] = TN_OPT_COMPORT; m[n++] = cmd;
+    for (uint32_t i = 0; i < len && i < RFC_SB_MAX; i++) {
+        m[n++] = val[i];
+        if (val[i] == TN_IAC) m[n++] = TN_IAC;
+    }
+    m[n++] = TN_IAC; m[n++] = TN_SE;
+    return rfc_send_raw(impl, m, n);
+}
+
+/* ========== Receiving ========== */
+
+static bool rfc_rx_reserve(Rfc2217Impl *impl, uint32_t extra) {
+    if (impl->rx_off && impl->rx_off + impl->rx_len + extra > impl->rx_cap) {
+        memmove(impl->rx, impl->rx + impl->rx_off, impl->rx_len);
+        impl->rx_off = 0;
+    }
+    if (impl->rx_len + extra <= impl->rx_cap) return true;
+    uint32_t cap = impl->rx_cap ? impl->rx_cap : RFC_RECV_CHUNK;
+    while (cap < impl->rx_len + extra) cap *= 2;
+    uint8_t *nb = (uint8_t *)realloc(impl->rx, cap);
+    if (!nb) return false;
+    impl->rx = nb;
+    impl->rx_cap = cap;
+    return true;
+}
+
+static uint32_t rfc_be(const uint8_t *p, uint32_t len) {
+    uint32_t v = 0;
+    for (uint32_t i = 0; i < len && i < 4; i++) v = (v << 8) | p[i];
+    return v;
+}
+
+static void rfc_apply_control(Rfc2217Impl *impl, uint32_t v) {
+    switch (v) {
+        case CTL_FLOW_NONE:     impl->flow = VI_ASRL_FLOW_NONE; break;
+        case CTL_FLOW_XONXOFF:  impl->flow = VI_ASRL_FLOW_XON_XOFF; break;
+        case CTL_FLOW_HARDWARE: impl->flow = VI_ASRL_FLOW_RTS_CTS; break;
+        case CTL_FLOW_DSR:      impl->flow = VI_ASRL_FLOW_DTR_DSR; break;
+        case CTL_BREAK_ON:      impl->brk = VI_STATE_ASSERTED; break;
+        case CTL_BREAK_OFF:     impl->brk = VI_STATE_UNASSERTED; break;
+        case CTL_DTR_ON:        impl->dtr = VI_STATE_ASSERTED; break;
+        case CTL_DTR_OFF:       impl->dtr = VI_STATE_UNASSERTED; break;
+        case CTL_RTS_ON:        impl->rts = VI_STATE_ASSERTED; break;
+        case CTL_RTS_OFF:       impl->rts = VI_STATE_UNASSERTED; break;
+        default: break;
+    }
+}
+
+/* Answers are queued, not sent, so sending never re-enters the parser */
+static void rfc_queue(Rfc2217Impl *impl, const uint8_t *m, uint32_t n) {
+    if (impl->ctl_out_len + n > sizeof(impl->ctl_out)) return;
+    memcpy(impl->ctl_out + impl->ctl_out_len, m, n);
+    impl->ctl_out_len += n;
+}
+
+static void rfc_queue_verb(Rfc2217Impl *impl, uint8_t verb, uint8_t opt) {
+    uint8_t m[3] = { TN_IAC, verb, opt };
+    rfc_queue(impl, m, sizeof(m));
+}
+
+/* A complete COM-PORT-OPTION subnegotiation from the server */
+static void rfc_handle_sb(Rfc2217Impl *impl) {
+    if (impl->sb_len < 2 || impl->sb[0] != TN_OPT_COMPORT || impl->sb[1] < CPO_SERVER) return;
+    uint8_t cmd = (uint8_t)(impl->sb[1] - CPO_SERVER);
+    const uint8_t *v = impl->sb + 2;
+    uint32_t vlen = impl->sb_len - 2;
+    uint32_t val = rfc_be(v, vlen);
+
+    switch (cmd) {
+        case CPO_SIGNATURE:
+            if (vlen == 0) {    /* the server asks for ours */
+                static const uint8_t sig[] = { TN_IAC, TN_SB, TN_OPT_COMPORT, CPO_SIGNATURE,
+                                               'O', 'p', 'e', 'n', 'V', 'I', 'S', 'A', TN_IAC, TN_SE };
+                rfc_queue(impl, sig, sizeof(sig));
+            }
+            return;
+        case CPO_SET_BAUDRATE:  impl->baud = val; break;
+        case CPO_SET_DATASIZE:  if (val >= 5 && val <= 8) impl->data_bits = (ViUInt16)val; break;
+        case CPO_SET_PARITY:    if (val >= 1 && val <= 5) impl->parity = (ViUInt16)(val - 1); break;
+        case CPO_SET_STOPSIZE:
+            impl->stop_bits = val == 2 ? VI_ASRL_STOP_TWO : val == 3 ? VI_ASRL_STOP_ONE5 : VI_ASRL_STOP_ONE;
+            break;
+        case CPO_SET_CONTROL:   rfc_apply_control(impl, val); break;
+        case CPO_NOTIFY_LINESTATE:
+            if (impl->line_err == VI_SUCCESS) {
+                if (val & LS_OVERRUN)      impl->line_err = VI_ERROR_ASRL_OVERRUN;
+                else if (val & LS_PARITY)  impl->line_err = VI_ERROR_ASRL_PARITY;
+                else if (val & LS_FRAMING) impl->line_err = VI_ERROR_ASRL_FRAMING;
+            }
+            return;
+        case CPO_NOTIFY_MODEMSTATE: impl->modem = (int)(val & 0xFF); return;
+        case CPO_FLOW_SUSPEND:      impl->tx_suspended = true; return;
+        case CPO_FLOW_RESUME:       impl->tx_suspended = false; return;
+        default: break;
+    }
+    if (cmd < CPO_NCMDS) {
+        impl->reply_val[cmd] = val;
+        impl->replies[cmd]++;
+    }
+}
+
+/* Option requests: we want BINARY both ways, SGA from the server and COM-PORT-OPTION for us */
+static void rfc_handle_opt(Rfc2217Impl *impl, uint8_t verb, uint8_t opt) {
+    switch (verb) {
+        case TN_DO:
+            if (opt == TN_OPT_COMPORT) { impl->comport = true; impl->comport_refused = false; }
+            else if (opt != TN_OPT_BINARY) rfc_queue_verb(impl, TN_WONT, opt);
+            break;
+        case TN_DONT:
+            if (opt == TN_OPT_COMPORT) { impl->comport = false; impl->comport_refused = true; }
+            break;
+        case TN_WILL:
+            if (opt != TN_OPT_BINARY && opt != TN_OPT_SGA) rfc_queue_verb(impl, TN_DONT, opt);
+            break;
+        default:    /* WONT: nothing we rely on */
+            break;
+    }
+}
+
+static void rfc_parse(Rfc2217Impl *impl, const uint8_t *p, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        uint8_t c = p[i];
+        switch (impl->tn_state) {
+            case TNS_DATA:
+                if (c == TN_IAC) { impl->tn_state = TNS_IAC; break; }
+                /* copy the run of plain data in one go */
+                {
+                    uint32_t j = i;
+                    while (j < n && p[j] != TN_IAC) j++;
+                    if (rfc_rx_reserve(impl, j - i)) {
+                        memcpy(impl->rx + impl->rx_off + impl->rx_len, p + i, j - i);
+                        impl->rx_len += j - i;
+                    }
+                    i = j - 1;
+                }
+                break;
+            case TNS_IAC:
+                impl->tn_state = TNS_DATA;
+                if (c == TN_IAC) {
+                    if (rfc_rx_reserve(impl, 1)) impl->rx[impl->rx_off + impl->rx_len++] = c;
+                } else if (c == TN_SB) {
+                    impl->sb_len = 0;
+                    impl->tn_state = TNS_SB;
+                } else if (c >= TN_WILL && c <= TN_DONT) {
+                    impl->tn_verb = c;
+                    impl->tn_state = TNS_OPT;
+                }
+                break;
+            case TNS_OPT:
+                impl->tn_state = TNS_DATA;
+                rfc_handle_opt(impl, impl->tn_verb, c);
+                break;
+            case TNS_SB:
+                if (c == TN_IAC) impl->tn_state = TNS_SB_IAC;
+                else if (impl->sb_len < RFC_SB_MAX) impl->sb[impl->sb_len++] = c;
+                break;
+            case TNS_SB_IAC:
+                if (c == TN_IAC) {
+                    if (impl->sb_len < RFC_SB_MAX) impl->sb[impl->sb_len++] = c;
+                    impl->tn_state = TNS_SB;
+                } else {
+                    impl->tn_state = TNS_DATA;
+                    if (c == TN_SE) rfc_handle_sb(impl);
+                }
+                break;
+        }
+    }
+}
+
+/* Wait up to wait_ms (-1 = forever) for input and process it */
+static ViStatus rfc_pump(Rfc2217Impl *impl, int wait_ms) {
+    if (impl->sock == OV_INVALID_SOCKET) return VI_ERROR_CONN_LOST;
+    struct pollfd pfd = { .fd = impl->sock, .events = POLLIN };
+    int rc = ov_poll(&pfd, 1, wait_ms);
+    if (rc == 0) return VI_ERROR_TMO;
+    if (rc < 0) return VI_SUCCESS;
+
+    uint8_t buf[RFC_RECV_CHUNK];
+    int n = recv(impl->sock, (char *)buf, sizeof(buf), 0);
+    if (n < 0 && RFC_WOULDBLOCK(ov_socket_error())) return VI_SUCCESS;
+    if (n <= 0) { rfc_drop(impl); return VI_ERROR_CONN_LOST; }
+    rfc_parse(impl, buf, (uint32_t)n);
+    if (impl->ctl_out_len) {
+        uint8_t m[sizeof(impl->ctl_out)];
+        uint32_t len = impl->ctl_out_len;
+        memcpy(m, impl->ctl_out, len);
+        impl->ctl_out_len = 0;
+        return rfc_send_raw(impl, m, len);
+    }
+    return VI_SUCCESS;
+}
+
+/* ========== COM-PORT-OPTION requests ========== */
+
+/* Send cmd and wait for the server's answer; *reply gets its value */
+static ViStatus rfc_request(Rfc2217Impl *impl, uint8_t cmd, const uint8_t *val, uint32_t len, uint32_t *reply) {
+    if (!impl->comport) return VI_ERROR_NSUP_ATTR;
+    uint32_t seen = impl->replies[cmd];
+    ViStatus st = rfc_send_cpo(impl, cmd, val, len);
+    uint64_t deadline = rfc_deadline(impl->timeout);
+    while (st == VI_SUCCESS && impl->replies[cmd] == seen) {
+        st = rfc_pump(impl, rfc_wait_ms(deadline));
+        if (st == VI_SUCCESS && rfc_wait_ms(deadline) == 0 && impl->replies[cmd] == seen) st = VI_ERROR_TMO;
+    }
+    if (st == VI_SUCCESS && reply) *reply = impl->reply_val[cmd];
+    return st;
+}
+
+static ViStatus rfc_request8(Rfc2217Impl *impl, uint8_t cmd, uint8_t v, uint32_t *reply) {
+    return rfc_request(impl, cmd, &v, 1, reply);
+}
+
+static ViStatus rfc_set_baud(Rfc2217Impl *impl, ViUInt32 baud) {
+    uint8_t v[4] = { (uint8_t)(baud >> 24), (uint8_t)(baud >> 16), (uint8_t)(baud >> 8), (uint8_t)baud };
+    uint32_t got;
+    ViStatus st = rfc_request(impl, CPO_SET_BAUDRATE, v, 4, &got);
+    if (st == VI_SUCCESS && got != baud) st = VI_ERROR_NSUP_ATTR_STATE;
+    return st;
+}
+
+static ViStatus rfc_set_parity(Rfc2217Impl *impl, ViUInt16 parity) {
+    if (parity > VI_ASRL_PAR_SPACE) return VI_ERROR_NSUP_ATTR_STATE;
+    uint32_t got;
+    ViStatus st = rfc_request8(impl, CPO_SET_PARITY, (uint8_t)(parity + 1), &got);
+    if (st == VI_SUCCESS && got != (uint32_t)parity + 1) st = VI_ERROR_NSUP_ATTR_STATE;
+    return st;
+}
+
+static ViStatus rfc_set_stop(Rfc2217Impl *impl, ViUInt16 stop) {
+    uint8_t v = stop == VI_ASRL_STOP_ONE ? 1 : stop == VI_ASRL_STOP_TWO ? 2 : stop == VI_ASRL_STOP_ONE5 ? 3 : 0;
+    if (!v) return VI_ERROR_NSUP_ATTR_STATE;
+    uint32_t got;
+    ViStatus st = rfc_request8(impl, CPO_SET_STOPSIZE, v, &got);
+    if (st == VI_SUCCESS && got != v) st = VI_ERROR_NSUP_ATTR_STATE;
+    return st;
+}
+
+static ViStatus rfc_set_control(Rfc2217Impl *impl, uint8_t v) {
+    uint32_t got;
+    ViStatus st = rfc_request8(impl, CPO_SET_CONTROL, v, &got);
+    if (st == VI_SUCCESS && got != v) st = VI_ERROR_NSUP_ATTR_STATE;
+    return st;
+}
+
+static ViStatus rfc_set_flow(Rfc2217Impl *impl, ViUInt16 flow) {
+    switch (flow) {
+        case VI_ASRL_FLOW_NONE:     return rfc_set_control(impl, CTL_FLOW_NONE);
+        case VI_ASRL_FLOW_XON_XOFF: return rfc_set_control(impl, CTL_FLOW_XONXOFF);
+        case VI_ASRL_FLOW_RTS_CTS:  return rfc_set_control(impl, CTL_FLOW_HARDWARE);
+        case VI_ASRL_FLOW_DTR_DSR:  return rfc_set_control(impl, CTL_FLOW_DSR);
+        default:                    return VI_ERROR_NSUP_ATTR_STATE;
+    }
+}
+
+/* ========== Transport operations ========== */
+
+static ViStatus rfc_open(OvTransport *self, const OvResource *rsrc, ViUInt32 timeout) {
+    Rfc2217Impl *impl = (Rfc2217Impl *)self->impl;
+    rfc_platform_init();
+
+    char port_str[8];
+    snprintf(port_str, sizeof(port_str), "%u", rsrc->port);
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(ov_rsrc_host(rsrc), port_str, &hints, &res) != 0) return VI_ERROR_RSRC_NFOUND;
+
+    ViStatus st = VI_ERROR_RSRC_NFOUND;
+    for (struct addrinfo *ai = res; ai && st != VI_SUCCESS; ai = ai->ai_next) {
+        ov_socket_t s = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (s == OV_INVALID_SOCKET) continue;
+        rfc_set_nonblock(s);
+        int rc = connect(s, ai->ai_addr, (int)ai->ai_addrlen);
+        if (rc != 0) {
+            struct pollfd pfd = { .fd = s, .events = POLLOUT };
+            int err = 0;
+            socklen_t elen = sizeof(err);
+            if (ov_poll(&pfd, 1, (int)timeout) == 1 &&
+                getsockopt(s, SOL_SOCKET, SO_ERROR, (char *)&err, &elen) == 0 && err == 0)
+                rc = 0;
+        }
+        if (rc != 0) { ov_closesocket(s); st = VI_ERROR_TMO; continue; }
+        int one = 1;
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char *)&one, sizeof(one));
+        impl->sock = s;
+        st = VI_SUCCESS;
+    }
+    freeaddrinfo(res);
+    if (st != VI_SUCCESS) return st;
+
+    /* Negotiate binary transmission and the COM port option in one packet */
+    impl->timeout = timeout;
+    static const uint8_t hello[] = {
+        TN_IAC, TN_WILL, TN_OPT_COMPORT,
+        TN_IAC, TN_WILL, TN_OPT_BINARY, TN_IAC, TN_DO, TN_OPT_BINARY,
+        TN_IAC, TN_DO, TN_OPT_SGA,
+    };
+    st = rfc_send_raw(impl, hello, sizeof(hello));
+    uint64_t deadline = rfc_deadline(timeout);
+    while (st == VI_SUCCESS && !impl->comport && !impl->comport_refused) {
+        st = rfc_pump(impl, rfc_wait_ms(deadline));
+        if (st == VI_SUCCESS && rfc_wait_ms(deadline) == 0 && !impl->comport && !impl->comport_refused)
+            st = VI_ERROR_TMO;
+    }
+    if (st != VI_SUCCESS) { rfc_drop(impl); return st; }
+    if (!impl->comport) return VI_SUCCESS;      /* data only, settings stay the server's */
+
+    /* Same defaults as a local port (9600 8N1, no flow control), line
+     * errors and modem lines reported, all answers awaited at once */
+    static const uint8_t setup[] = {
+        TN_IAC, TN_SB, TN_OPT_COMPORT, CPO_SET_BAUDRATE, 0, 0, 0x25, 0x80, TN_IAC, TN_SE,
+        TN_IAC, TN_SB, TN_OPT_COMPORT, CPO_SET_DATASIZE, 8, TN_IAC, TN_SE,
+        TN_IAC, TN_SB, TN_OPT_COMPORT, CPO_SET_PARITY, 1, TN_IAC, TN_SE,
+        TN_IAC, TN_SB, TN_OPT_COMPORT, CPO_SET_STOPSIZE, 1, TN_IAC, TN_SE,
+        TN_IAC, TN_SB, TN_OPT_COMPORT, CPO_SET_CONTROL, CTL_FLOW_NONE, TN_IAC, TN_SE,
+        TN_IAC, TN_SB, TN_OPT_COMPORT, CPO_SET_LINESTATE_MASK, LS_OVERRUN | LS_PARITY | LS_FRAMING | LS_BREAK, TN_IAC, TN_SE,
+        TN_IAC, TN_SB, TN_OPT_COMPORT, CPO_SET_MODEMSTATE_MASK, TN_IAC, TN_IAC, TN_IAC, TN_SE,    /* 0xFF, doubled */
+    };
+    uint32_t seen = impl->replies[CPO_SET_MODEMSTATE_MASK];
+    st = rfc_send_raw(impl, setup, sizeof(setup));
+    while (st == VI_SUCCESS && impl->replies[CPO_SET_MODEMSTATE_MASK] == seen) {
+        st = rfc_pump(impl, rfc_wait_ms(deadline));
+        if (st == VI_SUCCESS && rfc_wait_ms(deadline) == 0 && impl->replies[CPO_SET_MODEMSTATE_MASK] == seen)
+            st = VI_ERROR_TMO;
+    }
+    if (st != VI_SUCCESS) rfc_drop(impl);
+    return st;
+}
+
+static ViStatus rfc_close(OvTransport *self) {
+    Rfc2217Impl *impl = (Rfc2217Impl *)self->impl;
+    if (impl) {
+        rfc_drop(impl);
+        free(impl->rx);
+        free(impl);
+        self->impl = NULL;
+    }
+    return VI_SUCCESS;
+}
+
+static ViStatus rfc_write(OvTransport *self, ViBuf buf, ViUInt32 count, ViUInt32 *retCount) {
+    Rfc2217Impl *impl = (Rfc2217Impl *)self->impl;
+    if (retCount) *retCount = 0;
+    if (impl->sock == OV_INVALID_SOCKET) return VI_ERROR_CONN_LOST;
+
+    /* The server asked us to pause: its serial output buffer is full */
+    uint64_t deadline = rfc_deadline(impl->timeout);
+    while (impl->tx_suspended) {
+        ViStatus st = rfc_pump(impl, rfc_wait_ms(deadline));
+        if (st == VI_ERROR_TMO || (st == VI_SUCCESS && impl->tx_suspended && rfc_wait_ms(deadline) == 0))
+            return VI_ERROR_TMO;
+        if (st != VI_SUCCESS) return st;
+    }
+
+    /* Escape IAC; plain runs go out as they are */
+    uint8_t out[8192];
+    uint32_t n = 0;
+    for (ViUInt32 i = 0; i < count; i++) {
+        out[n++] = buf[i];
+        if (buf[i] == TN_IAC) out[n++] = TN_IAC;
+        if (n >= sizeof(out) - 1 || i + 1 == count) {
+            ViStatus st = rfc_send_raw(impl, out, n);
+            if (st != VI_SUCCESS) return st;
+            if (retCount) *retCount = i + 1;
+            n = 0;
+        }
+    }
+    return VI_SUCCESS;
+}
+
+/* Length of the next message in the buffer if it is complete, 0 otherwise */
+static uint32_t rfc_frame(const Rfc2217Impl *impl, uint32_t from, uint32_t limit, bool *last_bit) {
+    const uint8_t *p = impl->rx + impl->rx_off;
+    uint32_t end = impl->rx_len < limit ? impl->rx_len : limit;
+    if (impl->end_in == VI_ASRL_END_TERMCHAR || impl->term_char_en) {
+        const uint8_t *hit = from < end ? (const uint8_t *)memchr(p + from, impl->term_char, end - from) : NULL;
+        if (hit) { *last_bit = false; return (uint32_t)(hit - p) + 1; }
+    }
+    if (impl->end_in == VI_ASRL_END_LAST_BIT) {
+        uint8_t mask = (uint8_t)(1u << (impl->data_bits - 1));
+        for (uint32_t i = from; i < end; i++)
+            if (p[i] & mask) { *last_bit = true; return i + 1; }
+    }
+    return 0;
+}
+
+static void rfc_take(Rfc2217Impl *impl, ViBuf buf, uint32_t n) {
+    memcpy(buf, impl->rx + impl->rx_off, n);
+    impl->rx_off += n;
+    impl->rx_len -= n;
+    if (impl->rx_len == 0) impl->rx_off = 0;
+}
+
+static ViStatus rfc_read(OvTransport *self, ViBuf buf, ViUInt32 count,
+                         ViUInt32 *retCount, ViUInt32 timeout) {
+    Rfc2217Impl *impl = (Rfc2217Impl *)self->impl;
+    impl->timeout = timeout;
+    if (retCount) *retCount = 0;
+
+    uint64_t deadline = rfc_deadline(timeout);
+    uint32_t scanned = 0;
+    for (;;) {
+        if (impl->line_err != VI_SUCCESS) {
+            ViStatus err = impl->line_err;
+            impl->line_err = VI_SUCCESS;
+            return err;
+        }
+        bool last_bit = false;
+        uint32_t n = rfc_frame(impl, scanned, count, &last_bit);
+        if (n) {
+            rfc_take(impl, buf, n);
+            if (retCount) *retCount = n;
+            return last_bit ? VI_SUCCESS : VI_SUCCESS_TERM_CHAR;
+        }
+        if (impl->rx_len >= count) {
+            rfc_take(impl, buf, count);
+            if (retCount) *retCount = count;
+            return VI_SUCCESS_MAX_CNT;
+        }
+        scanned = impl->rx_len;
+
+        int wait = rfc_wait_ms(deadline);
+        ViStatus st = wait == 0 ? VI_ERROR_TMO : rfc_pump(impl, wait);
+        if (st == VI_ERROR_TMO) {
+            /* VISA hands over what did arrive along with the timeout */
+            uint32_t got = impl->rx_len;
+            rfc_take(impl, buf, got);
+            if (retCount) *retCount = got;
+            return VI_ERROR_TMO;
+        }
+        if (st != VI_SUCCESS) return st;
+    }
+}
+
+static ViStatus rfc_readSTB(OvTransport *self, ViUInt16 *stb) {
+    /* No service request line on a serial port: ask the instrument */
+    Rfc2217Impl *impl = (Rfc2217Impl *)self->impl;
+    ViUInt32 n = 0;
+    ViStatus st = rfc_write(self, (ViBuf)(uintptr_t)"*STB?\n", 6, &n);
+    if (st != VI_SUCCESS) return st;
+
+    char buf[64];
+    st = rfc_read(self, (ViBuf)buf, sizeof(buf) - 1, &n, impl->timeout);
+    if (st < VI_SUCCESS) return st;
+    buf[n] = '\0';
+    if (stb) *stb = (ViUInt16)atoi(buf);
+    return VI_SUCCESS;
+}
+
+/* Device clear on a serial port: both buffers of the terminal server and ours */
+static ViStatus rfc_clear(OvTransport *self) {
+    Rfc2217Impl *impl = (Rfc2217Impl *)self->impl;
+    if (impl->sock == OV_INVALID_SOCKET) return VI_ERROR_CONN_LOST;
+    ViStatus st = impl->comport ? rfc_request8(impl, CPO_PURGE_DATA, 3, NULL) : VI_SUCCESS;
+    while (st == VI_SUCCESS && rfc_pump(impl, 0) == VI_SUCCESS) { }
+    impl->rx_off = impl->rx_len = 0;
+    impl->line_err = VI_SUCCESS;
+    return st;
+}
+
+/* ========== Attributes ========== */
+
+static ViStatus rfc_setAttribute(OvTransport *self, ViAttr attr, ViAttrState value) {
+    Rfc2217Impl *impl = (Rfc2217Impl *)self->impl;
+    switch (attr) {
+        case VI_ATTR_TERMCHAR:     impl->term_char = (uint8_t)(value & 0xFF); return VI_SUCCESS;
+        case VI_ATTR_TERMCHAR_EN:  impl->term_char_en = value != 0; return VI_SUCCESS;
+        case VI_ATTR_ASRL_END_IN:
+            if (value > VI_ASRL_END_TERMCHAR) return VI_ERROR_NSUP_ATTR_STATE;
+            impl->end_in = (ViUInt16)value;
+            return VI_SUCCESS;
+        case VI_ATTR_ASRL_BAUD:      return rfc_set_baud(impl, value);
+        case VI_ATTR_ASRL_DATA_BITS: {
+            if (value < 5 || value > 8) return VI_ERROR_NSUP_ATTR_STATE;
+            uint32_t got;
+            ViStatus st = rfc_request8(impl, CPO_SET_DATASIZE, (uint8_t)value, &got);
+            return st == VI_SUCCESS && got != value ? VI_ERROR_NSUP_ATTR_STATE : st;
+        }
+        case VI_ATTR_ASRL_PARITY:    return rfc_set_parity(impl, (ViUInt16)value);
+        case VI_ATTR_ASRL_STOP_BITS: return rfc_set_stop(impl, (ViUInt16)value);
+        case VI_ATTR_ASRL_FLOW_CNTRL: return rfc_set_flow(impl, (ViUInt16)value);
+        case VI_ATTR_ASRL_DTR_STATE:
+            return rfc_set_control(impl, (ViInt16)value == VI_STATE_ASSERTED ? CTL_DTR_ON : CTL_DTR_OFF);
+        case VI_ATTR_ASRL_RTS_STATE:
+            return rfc_set_control(impl, (ViInt16)value == VI_STATE_ASSERTED ? CTL_RTS_ON : CTL_RTS_OFF);
+        case VI_ATTR_ASRL_BREAK_STATE:
+            return rfc_set_control(impl, (ViInt16)value == VI_STATE_ASSERTED ? CTL_BREAK_ON : CTL_BREAK_OFF);
+        default:
+            return VI_ERROR_NSUP_ATTR;
+    }
+}
+
+static ViInt16 rfc_modem_line(const Rfc2217Impl *impl, int bit) {
+    if (impl->modem < 0) return VI_STATE_UNKNOWN;
+    return (impl->modem & bit) ? VI_STATE_ASSERTED : VI_STATE_UNASSERTED;
+}
+
+/* DTR, RTS and break are asked of the server, not taken from our cache */
+static ViStatus rfc_get_control(Rfc2217Impl *impl, uint8_t request, ViInt16 *field, void *value) {
+    ViStatus st = rfc_request8(impl, CPO_SET_CONTROL, request, NULL);
+    if (st == VI_SUCCESS) *(ViInt16 *)value = *field;
+    return st;
+}
+
+static ViStatus rfc_getAttribute(OvTransport *self, ViAttr attr, void *value) {
+    Rfc2217Impl *impl = (Rfc2217Impl *)self->impl;
+    /* Take in data and notifications that are already here */
+    while (impl->sock != OV_INVALID_SOCKET && rfc_pump(impl, 0) == VI_SUCCESS) { }
+
+    switch (attr) {
+        case VI_ATTR_ASRL_END_IN:     *(ViUInt16 *)value = impl->end_in; return VI_SUCCESS;
+        case VI_ATTR_ASRL_AVAIL_NUM:  *(ViUInt32 *)value = impl->rx_len; return VI_SUCCESS;
+        default: break;
+    }
+    if (!impl->comport) return VI_ERROR_NSUP_ATTR;
+
+    switch (attr) {
+        case VI_ATTR_ASRL_BAUD:       *(ViUInt32 *)value = impl->baud; return VI_SUCCESS;
+        case VI_ATTR_ASRL_DATA_BITS:  *(ViUInt16 *)value = impl->data_bits; return VI_SUCCESS;
+        case VI_ATTR_ASRL_PARITY:     *(ViUInt16 *)value = impl->parity; return VI_SUCCESS;
+        case VI_ATTR_ASRL_STOP_BITS:  *(ViUInt16 *)value = impl->stop_bits; return VI_SUCCESS;
+        case VI_ATTR_ASRL_FLOW_CNTRL: *(ViUInt16 *)value = impl->flow; return VI_SUCCESS;
+        case VI_ATTR_ASRL_DTR_STATE:  return rfc_get_control(impl, CTL_DTR_REQUEST, &impl->dtr, value);
+        case VI_ATTR_ASRL_RTS_STATE:  return rfc_get_control(impl, CTL_RTS_REQUEST, &impl->rts, value);
+        case VI_ATTR_ASRL_BREAK_STATE: return rfc_get_control(impl, CTL_BREAK_REQUEST, &impl->brk, value);
+        case VI_ATTR_ASRL_CTS_STATE:  *(ViInt16 *)value = rfc_modem_line(impl, MS_CTS); return VI_SUCCESS;
+        case VI_ATTR_ASRL_DSR_STATE:  *(ViInt16 *)value = rfc_modem_line(impl, MS_DSR); return VI_SUCCESS;
+        case VI_ATTR_ASRL_DCD_STATE:  *(ViInt16 *)value = rfc_modem_line(impl, MS_DCD); return VI_SUCCESS;
+        case VI_ATTR_ASRL_RI_STATE:   *(ViInt16 *)value = rfc_modem_line(impl, MS_RI); return VI_SUCCESS;
+        default:                      return VI_ERROR_NSUP_ATTR;
+    }
+}
+
+/* ========== Factory ========== */
+
+OvTransport* ov_transport_rfc2217_create(void) {
+    OvTransport *t = (OvTransport *)calloc(1, sizeof(OvTransport));
+    if (!t) return NULL;
+    Rfc2217Impl *impl = (Rfc2217Impl *)calloc(1, sizeof(Rfc2217Impl));
+    if (!impl) { free(t); return NULL; }
+
+    impl->sock      = OV_INVALID_SOCKET;
+    impl->baud      = 9600;
+    impl->data_bits = 8;
+    impl->parity    = VI_ASRL_PAR_NONE;
+    impl->stop_bits = VI_ASRL_STOP_ONE;
+    impl->flow      = VI_ASRL_FLOW_NONE;
+    impl->dtr = impl->rts = impl->brk = VI_STATE_UNKNOWN;
+    impl->modem     = -1;
+    impl->end_in    = VI_ASRL_END_TERMCHAR;
+    impl->term_char = '\n';
+
+    t->impl         = impl;
+    t->open         = rfc_open;
+    t->close        = rfc_close;
+    t->read         = rfc_read;
+    t->write        = rfc_write;
+    t->readSTB      = rfc_readSTB;
+    t->clear        = rfc_clear;
+    t->setAttribute = rfc_setAttribute;
+    t->getAttribute = rfc_getAttribute;
+    return t;
+}
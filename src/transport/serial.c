@@ -8,6 +8,7 @@
  */
 
 #include "../core/session.h"
+#include "../core/plugin.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -423,6 +424,12 @@ static ViStatus serial_clear(OvTransport *self) {
     return serial_write(self, (ViBuf)(uintptr_t)cmd, 5, &retCount);
 }
 
+/* No message framing: replies to several queries can come back in one read */
+static ViUInt32 serial_maxPending(OvTransport *self) {
+    (void)self;
+    return 1;
+}
+
 /* ========== Factory ========== */
 
 OvTransport* ov_transport_serial_create(void) {
@@ -447,6 +454,9 @@ OvTransport* ov_transport_serial_create(void) {
     t->write    = serial_write;
     t->readSTB  = serial_readSTB;
     t->clear    = serial_clear;
+    t->maxPending = serial_maxPending;
 
     return t;
 }
+
+OV_TRANSPORT_PLUGIN(ov_transport_serial_create)
@@ -0,0 +1,222 @@
+/*
+ * OpenVISA - Shared-Memory Transport
+ *
+ * Handles SHM::<name>::INSTR: a soft instrument in another process on this
+ * machine that published "/openvisa-shm-<name>" with ovShmServerCreate
+ * (src/core/shm_server.c).  Commands and responses travel through two
+ * single-producer / single-consumer rings in the shared mapping
+ * (src/core/shmring.h), so a query costs two memcpy's and, when the other
+ * side is already waiting, no system call at all; a block response is
+ * copied once, straight from the ring into the caller's buffer.
+ *
+ * Linux only (futexes); elsewhere viOpen returns VI_ERROR_NSUP_OPER.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE
+#endif
+
+#include "../core/session.h"
+#include "../core/shmring.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifdef __linux__
+
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SHM_LIVENESS_MS     250u    /* how often a blocked call checks the instrument is alive */
+
+typedef struct {
+    OvShmHeader *hdr;
+    size_t       map_size;
+    OvShmRing    cmd, rsp;
+    uint16_t     gen;           /* our connection generation */
+    uint32_t     rec_off;       /* bytes of the current response record already read */
+    ViUInt32     timeout;       /* open or last read timeout; used by writes */
+} ShmImpl;
+
+static bool shm_pid_alive(uint32_t pid) {
+    return pid != 0 && (kill((pid_t)pid, 0) == 0 || errno == EPERM);
+}
+
+static bool shm_server_alive(ShmImpl *impl) {
+    return shm_pid_alive(__atomic_load_n(&impl->hdr->server_pid, __ATOMIC_ACQUIRE));
+}
+
+/* Deadline of the next liveness check, never past the call's own deadline */
+static uint64_t shm_slice(uint64_t deadline) {
+    uint64_t slice = ov_time_ns() + (uint64_t)SHM_LIVENESS_MS * 1000000u;
+    return slice < deadline ? slice : deadline;
+}
+
+/* Take the single client slot, stealing it from a client that died */
+static bool shm_claim(OvShmHeader *h) {
+    uint32_t me = (uint32_t)getpid();
+    uint32_t cur = __atomic_load_n(&h->client_pid, __ATOMIC_ACQUIRE);
+    for (;;) {
+        if (cur != 0 && shm_pid_alive(cur)) return false;
+        if (__atomic_compare_exchange_n(&h->client_pid, &cur, me, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            return true;
+    }
+}
+
+static ViStatus shm_open_rsrc(OvTransport *self, const OvResource *rsrc, ViUInt32 timeout) {
+    ShmImpl *impl = (ShmImpl *)self->impl;
+    if (strchr(ov_rsrc_device(rsrc), '/')) return VI_ERROR_INV_RSRC_NAME;
+
+    char path[300];
+    snprintf(path, sizeof(path), "%s%s", OVSHM_PREFIX, ov_rsrc_device(rsrc));
+    int fd = shm_open(path, O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0) return errno == ENOENT ? VI_ERROR_RSRC_NFOUND : VI_ERROR_SYSTEM_ERROR;
+
+    struct stat sb;
+    OvShmHeader *h = MAP_FAILED;
+    if (fstat(fd, &sb) == 0 && (size_t)sb.st_size >= sizeof(OvShmHeader))
+        h = (OvShmHeader *)mmap(NULL, (size_t)sb.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (h == MAP_FAILED) return VI_ERROR_RSRC_NFOUND;
+
+    impl->map_size = (size_t)sb.st_size;
+    if (__atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != OVSHM_MAGIC || h->version != OVSHM_VERSION ||
+        OVSHM_MAP_SIZE(h->ring_size) != impl->map_size || !shm_pid_alive(h->server_pid)) {
+        munmap(h, impl->map_size);
+        return VI_ERROR_RSRC_NFOUND;
+    }
+    if (!shm_claim(h)) {
+        munmap(h, impl->map_size);
+        return VI_ERROR_RSRC_LOCKED;
+    }
+
+    impl->hdr = h;
+    ovshm_rings(h, &impl->cmd, &impl->rsp);
+    impl->gen = (uint16_t)(__atomic_add_fetch(&h->connect_seq, 1, __ATOMIC_ACQ_REL));
+    impl->rec_off = 0;
+    impl->timeout = timeout;
+    ovshm_discard(&impl->rsp);
+    return VI_SUCCESS;
+}
+
+static ViStatus shm_close(OvTransport *self) {
+    ShmImpl *impl = (ShmImpl *)self->impl;
+    if (impl) {
+        if (impl->hdr) {
+            uint32_t me = (uint32_t)getpid();
+            __atomic_compare_exchange_n(&impl->hdr->client_pid, &me, 0, false,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+            munmap(impl->hdr, impl->map_size);
+        }
+        free(impl);
+        self->impl = NULL;
+    }
+    return VI_SUCCESS;
+}
+
+static ViStatus shm_write(OvTransport *self, ViBuf buf, ViUInt32 count, ViUInt32 *retCount) {
+    ShmImpl *impl = (ShmImpl *)self->impl;
+    if (retCount) *retCount = 0;
+    uint64_t deadline = ovshm_deadline(impl->timeout);
+    ViUInt32 done = 0;
+    do {
+        uint8_t *p;
+        uint32_t avail;
+        while (!ovshm_reserve(&impl->cmd, count - done, &p, &avail, shm_slice(deadline))) {
+            if (!shm_server_alive(impl)) return VI_ERROR_CONN_LOST;
+            if (ov_time_ns() >= deadline) return VI_ERROR_TMO;
+        }
+        memcpy(p, buf + done, avail);
+        done += avail;
+        ovshm_commit(&impl->cmd, avail, done == count ? OVSHM_F_END : 0, impl->gen);
+        if (retCount) *retCount = done;
+    } while (done < count);
+    return VI_SUCCESS;
+}
+
+/* Copies records until one marked END (VI_SUCCESS) or buf is full (MAX_CNT) */
+static ViStatus shm_read(OvTransport *self, ViBuf buf, ViUInt32 count,
+                         ViUInt32 *retCount, ViUInt32 timeout) {
+    ShmImpl *impl = (ShmImpl *)self->impl;
+    impl->timeout = timeout;
+    if (retCount) *retCount = 0;
+    uint64_t deadline = ovshm_deadline(timeout);
+    ViUInt32 total = 0;
+
+    while (total < count) {
+        const OvShmRec *rec = ovshm_peek(&impl->rsp, shm_slice(deadline));
+        if (!rec) {
+            if (!shm_server_alive(impl)) return VI_ERROR_CONN_LOST;
+            if (ov_time_ns() >= deadline) return VI_ERROR_TMO;
+            continue;
+        }
+        if (rec->gen != impl->gen) {        /* meant for a previous client */
+            ovshm_consume(&impl->rsp, rec);
+            continue;
+        }
+        uint32_t n = rec->len - impl->rec_off;
+        if (n > count - total) n = count - total;
+        memcpy(buf + total, (const uint8_t *)(rec + 1) + impl->rec_off, n);
+        total += n;
+        if (retCount) *retCount = total;
+        impl->rec_off += n;
+        if (impl->rec_off < rec->len) break;
+        bool end = rec->flags & OVSHM_F_END;
+        impl->rec_off = 0;
+        ovshm_consume(&impl->rsp, rec);
+        if (end) return VI_SUCCESS;
+    }
+    return VI_SUCCESS_MAX_CNT;
+}
+
+/* The instrument keeps its status byte in the header: no round trip */
+static ViStatus shm_readSTB(OvTransport *self, ViUInt16 *status) {
+    ShmImpl *impl = (ShmImpl *)self->impl;
+    if (!shm_server_alive(impl)) return VI_ERROR_CONN_LOST;
+    if (status) *status = (ViUInt16)__atomic_load_n(&impl->hdr->stb, __ATOMIC_ACQUIRE);
+    return VI_SUCCESS;
+}
+
+static ViStatus shm_clear(OvTransport *self) {
+    ShmImpl *impl = (ShmImpl *)self->impl;
+    if (!shm_server_alive(impl)) return VI_ERROR_CONN_LOST;
+    impl->rec_off = 0;
+    ovshm_discard(&impl->rsp);
+    return VI_SUCCESS;
+}
+
+OvTransport* ov_transport_shm_create(void) {
+    OvTransport *t = (OvTransport *)calloc(1, sizeof(OvTransport));
+    if (!t) return NULL;
+    ShmImpl *impl = (ShmImpl *)calloc(1, sizeof(ShmImpl));
+    if (!impl) { free(t); return NULL; }
+
+    t->impl    = impl;
+    t->open    = shm_open_rsrc;
+    t->close   = shm_close;
+    t->read    = shm_read;
+    t->write   = shm_write;
+    t->readSTB = shm_readSTB;
+    t->clear   = shm_clear;
+    return t;
+}
+
+#else  /* !__linux__ */
+
+static ViStatus shm_open_unsupported(OvTransport *self, const OvResource *rsrc, ViUInt32 timeout) {
+    (void)self; (void)rsrc; (void)timeout;
+    return VI_ERROR_NSUP_OPER;
+}
+
+OvTransport* ov_transport_shm_create(void) {
+    OvTransport *t = (OvTransport *)calloc(1, sizeof(OvTransport));
+    if (!t) return NULL;
+    t->open = shm_open_unsupported;
+    return t;
+}
+
+#endif
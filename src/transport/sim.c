@@ -0,0 +1,1220 @@
+/*
+ * OpenVISA - Simulated Instrument Transport
+ *
+ * Handles SIM::<name>::INSTR resource strings.  The instrument is answered
+ * entirely in memory from a declarative definition, so test sequences that
+ * only need plausible SCPI responses run without sockets or simulators.
+ *
+ * Definition lookup for <name>:
+ *   1. definitions registered in-process with ovSimDefine()
+ *   2. <name> itself, if it looks like a file path (contains '/', '\' or '.')
+ *   3. <name>.sim in each directory of OPENVISA_SIM_PATH (':' or ';' separated)
+ * Loaded definitions are compiled once and shared by every session.
+ *
+ * Definition format (INI-like, lines starting with '#' are comments):
+ *
+ *   [device]
+ *   eom     = "\n"                 response terminator (default "\n")
+ *   delay   = 0                    default response delay in ms
+ *   unknown = "-113"               response to undefined queries
+ *                                  (omitted: no response, read times out)
+ *   [vars]
+ *   volt = 1.234                   state variables with initial values
+ *   stb  = 0                       'stb' is ORed into viReadSTB
+ *
+ *   [commands]
+ *   *IDN?                 = "OpenVISA,SIM,0,1.0"
+ *   *RST                  = set volt=0
+ *   CONFigure:VOLTage     = set volt={$1}
+ *   MEASure:VOLTage[:DC]? = "{volt}" delay 5
+ *   CHANnel#:SCALe?       = "{#1}e-3"
+ *   CURVe?                = block sine 1000 int16
+ *
+ * Patterns follow SCPI mnemonic rules: the upper-case prefix of a mnemonic
+ * is its short form, [..] marks an optional node and '#' a numeric suffix.
+ * Each command is a list of actions: a quoted response template, 'set
+ * var=template', 'delay <ms>' or 'block <sine|ramp|noise|zero> <n>
+ * [int8|int16|int32|float32]' (an IEEE 488.2 definite-length block,
+ * generated once at load time).  Templates substitute {var}, {$n} (n-th
+ * argument) and {#n} (n-th numeric suffix).
+ *
+ * Every pattern is expanded to all concrete header spellings at load time
+ * and stored in an open-addressing hash table, so matching a command costs
+ * one normalisation pass and one probe.
+ */
+
+#include "../core/session.h"
+#include "openvisa.h"
+#include "../core/thread.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <math.h>
+
+/* ========== Limits ========== */
+
+#define SIM_MAX_ARGS        16
+#define SIM_MAX_SUFFIXES    8
+#define SIM_MAX_HEADER      128
+#define SIM_MAX_EXPANSIONS  256
+#define SIM_MAX_LINE        4096
+
+/* ========== Compiled definition ========== */
+
+typedef enum {
+    SIM_SEG_LIT,        /* literal text */
+    SIM_SEG_VAR,        /* {name} */
+    SIM_SEG_ARG,        /* {$n} */
+    SIM_SEG_SUFFIX,     /* {#n} */
+} SimSegKind;
+
+typedef struct {
+    uint8_t     kind;
+    uint16_t    idx;            /* var / arg / suffix index */
+    uint32_t    off, len;       /* literal slice of SimTmpl.text */
+} SimSeg;
+
+typedef struct {
+    char       *text;
+    SimSeg     *segs;
+    uint32_t    nsegs;
+} SimTmpl;
+
+typedef enum {
+    SIM_OP_RESPOND,     /* append rendered template to the response */
+    SIM_OP_SET,         /* assign rendered template to a variable */
+    SIM_OP_BLOCK,       /* append a pre-generated binary block */
+} SimOpKind;
+
+typedef struct {
+    SimOpKind   kind;
+    uint16_t    var;
+    SimTmpl     tmpl;
+    uint8_t    *block;
+    uint32_t    block_len;
+} SimOp;
+
+typedef struct {
+    SimOp      *ops;
+    uint32_t    nops;
+    int32_t     delay_ms;       /* -1 → device default */
+} SimCmd;
+
+typedef struct {
+    char       *key;            /* normalised header, NULL = empty slot */
+    uint32_t    hash;
+    uint32_t    key_len;
+    uint32_t    cmd;            /* index into SimDef.cmds */
+} SimSlot;
+
+typedef struct SimDef {
+    struct SimDef *next;        /* registry chain */
+    char       *name;
+    int         refs;
+    char        eom[8];
+    uint32_t    eom_len;
+    uint32_t    delay_ms;
+    bool        has_unknown;
+    SimTmpl     unknown;
+    char      **var_names;
+    char      **var_init;
+    uint32_t    nvars, cap_vars;
+    SimCmd     *cmds;
+    uint32_t    ncmds, cap_cmds;
+    SimSlot    *slots;
+    uint32_t    mask;           /* slot count - 1 (power of two) */
+    uint32_t    nkeys;
+    int         stb_var;        /* index of 'stb', -1 if absent */
+} SimDef;
+
+static SimDef *g_sim_defs = NULL;
+static OvMutex g_sim_lock = OV_MUTEX_INIT;     /* registry and definition refs */
+
+/* ========== Per-session state ========== */
+
+typedef struct {
+    char       *s;
+    uint32_t    len, cap;
+} SimVal;
+
+typedef struct {
+    uint32_t    off, len;       /* slice of SimImpl.out */
+    uint64_t    ready_ns;       /* simulated response time */
+} SimMsg;
+
+typedef struct {
+    SimDef     *def;
+    SimVal     *vals;
+
+    /* output queue: bytes of all pending messages + message boundaries */
+    uint8_t    *out;
+    uint32_t    out_len, out_cap;
+    SimMsg     *msgs;
+    uint32_t    msg_head, msg_count, msg_cap;
+    uint32_t    msg_pos;        /* bytes already read from the head message */
+} SimImpl;
+
+/* ========== Small string helpers ========== */
+
+static uint32_t sim_hash(const char *s, uint32_t len) {
+    uint32_t h = 2166136261u;       /* FNV-1a */
+    for (uint32_t i = 0; i < len; i++) {
+        h ^= (uint8_t)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static char *sim_strndup(const char *s, size_t len) {
+    char *p = (char *)malloc(len + 1);
+    if (!p) return NULL;
+    memcpy(p, s, len);
+    p[len] = '\0';
+    return p;
+}
+
+static const char *sim_skip_ws(const char *p) {
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+/* Trim trailing whitespace / CR / LF in place */
+static void sim_rtrim(char *s) {
+    size_t n = strlen(s);
+    while (n > 0 && (s[n - 1] == ' ' || s[n - 1] == '\t' ||
+                     s[n - 1] == '\r' || s[n - 1] == '\n'))
+        s[--n] = '\0';
+}
+
+/*
+ * Read one whitespace-delimited token.  Double-quoted sections may appear
+ * anywhere in the token (e.g. set msg="a b") and support \n \r \t \" \\.
+ * *quoted is set when the token starts with a quote.
+ */
+static bool sim_next_token(const char **pp, char *out, size_t outsz, bool *quoted) {
+    const char *p = sim_skip_ws(*pp);
+    size_t n = 0;
+    bool inq = false;
+
+    if (*p == '\0') return false;
+    if (quoted) *quoted = (*p == '"');
+
+    while (*p && (inq || (*p != ' ' && *p != '\t'))) {
+        char c = *p++;
+        if (c == '"') { inq = !inq; continue; }
+        if (inq && c == '\\' && *p) {
+            c = *p++;
+            if (c == 'n') c = '\n';
+            else if (c == 'r') c = '\r';
+            else if (c == 't') c = '\t';
+        }
+        if (n + 1 < outsz) out[n++] = c;
+    }
+    out[n] = '\0';
+    *pp = p;
+    return true;
+}
+
+/* ========== Definition construction ========== */
+
+static int sim_var_index(SimDef *def, const char *name, size_t len, bool create) {
+    for (uint32_t i = 0; i < def->nvars; i++) {
+        if (strlen(def->var_names[i]) == len && strncmp(def->var_names[i], name, len) == 0)
+            return (int)i;
+    }
+    if (!create) return -1;
+
+    if (def->nvars == def->cap_vars) {
+        uint32_t cap = def->cap_vars ? def->cap_vars * 2 : 16;
+        char **n = (char **)realloc(def->var_names, cap * sizeof(char *));
+        if (!n) return -1;
+        def->var_names = n;
+        char **v = (char **)realloc(def->var_init, cap * sizeof(char *));
+        if (!v) return -1;
+        def->var_init = v;
+        def->cap_vars = cap;
+    }
+    def->var_names[def->nvars] = sim_strndup(name, len);
+    def->var_init[def->nvars]  = sim_strndup("", 0);
+    if (!def->var_names[def->nvars] || !def->var_init[def->nvars]) return -1;
+    return (int)def->nvars++;
+}
+
+/* Compile a template string into literal / substitution segments */
+static bool sim_compile_tmpl(SimDef *def, const char *src, SimTmpl *t) {
+    size_t len = strlen(src);
+    t->text  = sim_strndup(src, len);
+    t->segs  = (SimSeg *)calloc(len + 1, sizeof(SimSeg));
+    t->nsegs = 0;
+    if (!t->text || !t->segs) return false;
+
+    size_t i = 0, lit = 0;
+    while (i < len) {
+        if (src[i] != '{') { i++; continue; }
+        const char *close = strchr(src + i, '}');
+        if (!close) break;
+
+        if (i > lit) {
+            SimSeg *s = &t->segs[t->nsegs++];
+            s->kind = SIM_SEG_LIT;
+            s->off  = (uint32_t)lit;
+            s->len  = (uint32_t)(i - lit);
+        }
+
+        const char *name = src + i + 1;
+        size_t nlen = (size_t)(close - name);
+        SimSeg *s = &t->segs[t->nsegs++];
+        if (nlen >= 2 && (name[0] == '$' || name[0] == '#')) {
+            int n = atoi(name + 1);
+            if (n < 1) return false;
+            s->kind = (name[0] == '$') ? SIM_SEG_ARG : SIM_SEG_SUFFIX;
+            s->idx  = (uint16_t)(n - 1);
+        } else {
+            int v = sim_var_index(def, name, nlen, true);
+            if (v < 0) return false;
+            s->kind = SIM_SEG_VAR;
+            s->idx  = (uint16_t)v;
+        }
+        i = lit = (size_t)(close - src) + 1;
+    }
+    if (len > lit) {
+        SimSeg *s = &t->segs[t->nsegs++];
+        s->kind = SIM_SEG_LIT;
+        s->off  = (uint32_t)lit;
+        s->len  = (uint32_t)(len - lit);
+    }
+    return true;
+}
+
+static void sim_free_tmpl(SimTmpl *t) {
+    free(t->text);
+    free(t->segs);
+    t->text = NULL;
+    t->segs = NULL;
+}
+
+/* Generate an IEEE 488.2 definite-length block: #<d><len><data> */
+static bool sim_make_block(SimOp *op, const char *gen, uint32_t n, const char *type) {
+    uint32_t width = 2;
+    if      (strcmp(type, "int8")    == 0) width = 1;
+    else if (strcmp(type, "int16")   == 0) width = 2;
+    else if (strcmp(type, "int32")   == 0) width = 4;
+    else if (strcmp(type, "float32") == 0) width = 4;
+    else return false;
+
+    bool is_float = (strcmp(type, "float32") == 0);
+    uint32_t data_len = n * width;
+
+    char hdr[16];
+    int dlen = snprintf(hdr + 2, sizeof(hdr) - 2, "%u", (unsigned)data_len);
+    hdr[0] = '#';
+    hdr[1] = (char)('0' + dlen);
+    uint32_t hlen = (uint32_t)dlen + 2;
+
+    op->block = (uint8_t *)malloc(hlen + data_len);
+    if (!op->block) return false;
+    memcpy(op->block, hdr, hlen);
+    op->block_len = hlen + data_len;
+
+    uint32_t seed = 0x12345678u;
+    uint8_t *d = op->block + hlen;
+    for (uint32_t i = 0; i < n; i++) {
+        double v;   /* normalised sample in [-1, 1] */
+        if (strcmp(gen, "sine") == 0) {
+            v = sin(2.0 * 3.14159265358979323846 * (double)i / (double)n);
+        } else if (strcmp(gen, "ramp") == 0) {
+            v = (n > 1) ? (2.0 * (double)i / (double)(n - 1)) - 1.0 : 0.0;
+        } else if (strcmp(gen, "noise") == 0) {
+            seed = seed * 1664525u + 1013904223u;
+            v = ((double)(seed >> 8) / (double)(1u << 24)) * 2.0 - 1.0;
+        } else if (strcmp(gen, "zero") == 0) {
+            v = 0.0;
+        } else {
+            return false;
+        }
+
+        if (is_float) {
+            float f = (float)v;
+            memcpy(d + i * 4, &f, 4);
+        } else if (width == 1) {
+            d[i] = (uint8_t)(int8_t)(v * 127.0);
+        } else if (width == 2) {
+            int16_t s = (int16_t)(v * 32767.0);
+            memcpy(d + i * 2, &s, 2);
+        } else {
+            int32_t s = (int32_t)(v * 2147483647.0);
+            memcpy(d + i * 4, &s, 4);
+        }
+    }
+    return true;
+}
+
+/* Parse the right-hand side of a [commands] entry into ops */
+static bool sim_compile_actions(SimDef *def, const char *rhs, SimCmd *cmd) {
+    char tok[SIM_MAX_LINE];
+    bool quoted;
+    const char *p = rhs;
+
+    cmd->delay_ms = -1;
+    cmd->ops  = (SimOp *)calloc(strlen(rhs) / 2 + 1, sizeof(SimOp));
+    cmd->nops = 0;
+    if (!cmd->ops) return false;
+
+    while (sim_next_token(&p, tok, sizeof(tok), &quoted)) {
+        SimOp *op = &cmd->ops[cmd->nops];
+
+        if (quoted) {
+            op->kind = SIM_OP_RESPOND;
+            if (!sim_compile_tmpl(def, tok, &op->tmpl)) return false;
+            cmd->nops++;
+        } else if (strcmp(tok, "set") == 0) {
+            if (!sim_next_token(&p, tok, sizeof(tok), NULL)) return false;
+            char *eq = strchr(tok, '=');
+            if (!eq) return false;
+            int v = sim_var_index(def, tok, (size_t)(eq - tok), true);
+            if (v < 0) return false;
+            op->kind = SIM_OP_SET;
+            op->var  = (uint16_t)v;
+            if (!sim_compile_tmpl(def, eq + 1, &op->tmpl)) return false;
+            cmd->nops++;
+        } else if (strcmp(tok, "delay") == 0) {
+            if (!sim_next_token(&p, tok, sizeof(tok), NULL)) return false;
+            cmd->delay_ms = atoi(tok);
+        } else if (strcmp(tok, "block") == 0) {
+            char gen[32], cnt[32], type[32] = "int16";
+            if (!sim_next_token(&p, gen, sizeof(gen), NULL)) return false;
+            if (!sim_next_token(&p, cnt, sizeof(cnt), NULL)) return false;
+            /* optional sample type */
+            const char *save = p;
+            if (sim_next_token(&p, type, sizeof(type), NULL) &&
+                strcmp(type, "int8") != 0 && strcmp(type, "int16") != 0 &&
+                strcmp(type, "int32") != 0 && strcmp(type, "float32") != 0) {
+                p = save;
+                strcpy(type, "int16");
+            }
+            op->kind = SIM_OP_BLOCK;
+            if (!sim_make_block(op, gen, (uint32_t)strtoul(cnt, NULL, 10), type))
+                return false;
+            cmd->nops++;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* ========== Pattern expansion + hash table ========== */
+
+static bool sim_table_insert(SimDef *def, const char *key, uint32_t cmd) {
+    /* keep load factor <= 1/2 */
+    if ((def->nkeys + 1) * 2 > def->mask + 1) {
+        uint32_t nsize = (def->mask + 1) * 2;
+        SimSlot *ns = (SimSlot *)calloc(nsize, sizeof(SimSlot));
+        if (!ns) return false;
+        for (uint32_t i = 0; i <= def->mask; i++) {
+            if (!def->slots[i].key) continue;
+            uint32_t j = def->slots[i].hash & (nsize - 1);
+            while (ns[j].key) j = (j + 1) & (nsize - 1);
+            ns[j] = def->slots[i];
+        }
+        free(def->slots);
+        def->slots = ns;
+        def->mask  = nsize - 1;
+    }
+
+    uint32_t len = (uint32_t)strlen(key);
+    uint32_t h   = sim_hash(key, len);
+    uint32_t j   = h & def->mask;
+    while (def->slots[j].key) {
+        if (def->slots[j].hash == h && strcmp(def->slots[j].key, key) == 0) {
+            def->slots[j].cmd = cmd;        /* later definition wins */
+            return true;
+        }
+        j = (j + 1) & def->mask;
+    }
+    def->slots[j].key = sim_strndup(key, len);
+    if (!def->slots[j].key) return false;
+    def->slots[j].hash    = h;
+    def->slots[j].key_len = len;
+    def->slots[j].cmd     = cmd;
+    def->nkeys++;
+    return true;
+}
+
+static const SimCmd *sim_table_lookup(const SimDef *def, const char *key, uint32_t len) {
+    uint32_t h = sim_hash(key, len);
+    uint32_t j = h & def->mask;
+    while (def->slots[j].key) {
+        const SimSlot *s = &def->slots[j];
+        if (s->hash == h && s->key_len == len && memcmp(s->key, key, len) == 0)
+            return &def->cmds[s->cmd];
+        j = (j + 1) & def->mask;
+    }
+    return NULL;
+}
+
+typedef struct {
+    char        forms[2][SIM_MAX_HEADER];   /* short / long spelling */
+    int         nforms;
+    bool        optional;
+} SimNode;
+
+static bool sim_expand(SimDef *def, SimNode *nodes, int nnodes, int i,
+                       char *acc, size_t acclen, bool query,
+                       uint32_t cmd, int *budget)
+{
+    if (i == nnodes) {
+        if (acclen == 0) return true;
+        if (--(*budget) < 0) return false;
+        char key[SIM_MAX_HEADER + 2];
+        memcpy(key, acc, acclen);
+        if (query) key[acclen++] = '?';
+        key[acclen] = '\0';
+        return sim_table_insert(def, key, cmd);
+    }
+
+    if (nodes[i].optional &&
+        !sim_expand(def, nodes, nnodes, i + 1, acc, acclen, query, cmd, budget))
+        return false;
+
+    for (int f = 0; f < nodes[i].nforms; f++) {
+        size_t n = acclen;
+        size_t flen = strlen(nodes[i].forms[f]);
+        if (n + flen + 1 >= SIM_MAX_HEADER) return false;
+        if (n > 0 && acc[0] != '*') acc[n++] = ':';
+        memcpy(acc + n, nodes[i].forms[f], flen);
+        if (!sim_expand(def, nodes, nnodes, i + 1, acc, n + flen, query, cmd, budget))
+            return false;
+    }
+    return true;
+}
+
+/* Expand a SCPI pattern like "MEASure:VOLTage[:DC]?" into the hash table */
+static bool sim_add_pattern(SimDef *def, const char *pattern, uint32_t cmd) {
+    SimNode nodes[16];
+    int nnodes = 0;
+    char pat[SIM_MAX_HEADER];
+
+    strncpy(pat, pattern, sizeof(pat) - 1);
+    pat[sizeof(pat) - 1] = '\0';
+
+    size_t plen = strlen(pat);
+    bool query = (plen > 0 && pat[plen - 1] == '?');
+    if (query) pat[--plen] = '\0';
+
+    const char *p = pat;
+    if (*p == ':') p++;
+
+    while (*p) {
+        if (nnodes == 16) return false;
+        SimNode *nd = &nodes[nnodes++];
+        memset(nd, 0, sizeof(*nd));
+
+        if (*p == '[') { nd->optional = true; p++; }
+        if (*p == ':') p++;
+
+        char mn[SIM_MAX_HEADER];
+        size_t n = 0;
+        while (*p && *p != ':' && *p != '[' && *p != ']' && n + 1 < sizeof(mn))
+            mn[n++] = *p++;
+        mn[n] = '\0';
+        if (nd->optional) {
+            if (*p != ']') return false;
+            p++;
+        }
+        if (*p == ':') p++;
+
+        /* short form = upper-case letters + '*' + suffix marker, long = everything */
+        size_t s = 0, l = 0;
+        bool has_lower = false;
+        for (size_t k = 0; k < n; k++) {
+            char c = mn[k];
+            if (islower((unsigned char)c)) has_lower = true;
+            else nd->forms[0][s++] = c;
+            nd->forms[1][l++] = (char)toupper((unsigned char)c);
+        }
+        nd->forms[0][s] = '\0';
+        nd->forms[1][l] = '\0';
+        nd->nforms = has_lower ? 2 : 1;
+        if (!has_lower) memcpy(nd->forms[0], nd->forms[1], l + 1);
+    }
+
+    char acc[SIM_MAX_HEADER];
+    int budget = SIM_MAX_EXPANSIONS;
+    return sim_expand(def, nodes, nnodes, 0, acc, 0, query, cmd, &budget);
+}
+
+/* ========== Definition loading ========== */
+
+static void sim_def_free(SimDef *def) {
+    if (!def) return;
+    for (uint32_t i = 0; i < def->nvars; i++) {
+        free(def->var_names[i]);
+        free(def->var_init[i]);
+    }
+    free(def->var_names);
+    free(def->var_init);
+    for (uint32_t c = 0; c < def->ncmds; c++) {
+        for (uint32_t o = 0; o < def->cmds[c].nops; o++) {
+            sim_free_tmpl(&def->cmds[c].ops[o].tmpl);
+            free(def->cmds[c].ops[o].block);
+        }
+        free(def->cmds[c].ops);
+    }
+    free(def->cmds);
+    if (def->slots) {
+        for (uint32_t i = 0; i <= def->mask; i++)
+            free(def->slots[i].key);
+        free(def->slots);
+    }
+    if (def->has_unknown) sim_free_tmpl(&def->unknown);
+    free(def->name);
+    free(def);
+}
+
+static void sim_def_release(SimDef *def) {
+    if (def && --def->refs == 0)
+        sim_def_free(def);
+}
+
+static void sim_def_put(SimDef *def) {
+    ov_mutex_lock(&g_sim_lock);
+    sim_def_release(def);
+    ov_mutex_unlock(&g_sim_lock);
+}
+
+/* Unquote/unescape a value string in place (value = "..." or bare) */
+static void sim_unquote(char *v) {
+    char tmp[SIM_MAX_LINE];
+    const char *p = v;
+    if (*v != '"') return;
+    sim_next_token(&p, tmp, sizeof(tmp), NULL);
+    strcpy(v, tmp);
+}
+
+static SimDef *sim_compile(const char *name, const char *text) {
+    SimDef *def = (SimDef *)calloc(1, sizeof(SimDef));
+    if (!def) return NULL;
+
+    def->name    = sim_strndup(name, strlen(name));
+    def->refs    = 1;
+    def->eom[0]  = '\n';
+    def->eom_len = 1;
+    def->mask    = 63;
+    def->slots   = (SimSlot *)calloc(def->mask + 1, sizeof(SimSlot));
+    if (!def->name || !def->slots) goto fail;
+
+    enum { SEC_NONE, SEC_DEVICE, SEC_VARS, SEC_COMMANDS } section = SEC_NONE;
+    const char *p = text;
+    char line[SIM_MAX_LINE];
+
+    while (*p) {
+        size_t n = 0;
+        while (*p && *p != '\n') {
+            if (n + 1 < sizeof(line)) line[n++] = *p;
+            p++;
+        }
+        if (*p == '\n') p++;
+        line[n] = '\0';
+        sim_rtrim(line);
+
+        const char *l = sim_skip_ws(line);
+        if (*l == '\0' || *l == '#') continue;
+
+        if (*l == '[') {
+            if      (strncmp(l, "[device]", 8) == 0)   section = SEC_DEVICE;
+            else if (strncmp(l, "[vars]", 6) == 0)     section = SEC_VARS;
+            else if (strncmp(l, "[commands]", 10) == 0) section = SEC_COMMANDS;
+            else goto fail;
+            continue;
+        }
+
+        /* key = value (SCPI headers never contain '=') */
+        const char *eq = strchr(l, '=');
+        if (!eq) goto fail;
+        char key[SIM_MAX_HEADER];
+        size_t klen = (size_t)(eq - l);
+        if (klen >= sizeof(key)) goto fail;
+        memcpy(key, l, klen);
+        key[klen] = '\0';
+        sim_rtrim(key);
+
+        char value[SIM_MAX_LINE];
+        strcpy(value, sim_skip_ws(eq + 1));
+
+        switch (section) {
+            case SEC_DEVICE:
+                sim_unquote(value);
+                if (strcmp(key, "eom") == 0) {
+                    def->eom_len = (uint32_t)strlen(value);
+                    if (def->eom_len >= sizeof(def->eom)) goto fail;
+                    memcpy(def->eom, value, def->eom_len + 1);
+                } else if (strcmp(key, "delay") == 0) {
+                    def->delay_ms = (uint32_t)strtoul(value, NULL, 10);
+                } else if (strcmp(key, "unknown") == 0) {
+                    if (def->has_unknown) sim_free_tmpl(&def->unknown);
+                    if (!sim_compile_tmpl(def, value, &def->unknown)) goto fail;
+                    def->has_unknown = true;
+                } else {
+                    goto fail;
+                }
+                break;
+
+            case SEC_VARS: {
+                sim_unquote(value);
+                int v = sim_var_index(def, key, strlen(key), true);
+                if (v < 0) goto fail;
+                free(def->var_init[v]);
+                def->var_init[v] = sim_strndup(value, strlen(value));
+                if (!def->var_init[v]) goto fail;
+                break;
+            }
+
+            case SEC_COMMANDS: {
+                if (def->ncmds == def->cap_cmds) {
+                    uint32_t cap = def->cap_cmds ? def->cap_cmds * 2 : 16;
+                    SimCmd *nc = (SimCmd *)realloc(def->cmds, cap * sizeof(SimCmd));
+                    if (!nc) goto fail;
+                    def->cmds = nc;
+                    def->cap_cmds = cap;
+                }
+                SimCmd *cmd = &def->cmds[def->ncmds];
+                memset(cmd, 0, sizeof(*cmd));
+                def->ncmds++;
+                if (!sim_compile_actions(def, value, cmd)) goto fail;
+                if (!sim_add_pattern(def, key, def->ncmds - 1)) goto fail;
+                break;
+            }
+
+            default:
+                goto fail;
+        }
+    }
+
+    def->stb_var = sim_var_index(def, "stb", 3, false);
+    return def;
+
+fail:
+    sim_def_free(def);
+    return NULL;
+}
+
+static char *sim_read_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < 0) { fclose(f); return NULL; }
+
+    char *text = (char *)malloc((size_t)size + 1);
+    if (text && fread(text, 1, (size_t)size, f) != (size_t)size) {
+        free(text);
+        text = NULL;
+    }
+    fclose(f);
+    if (text) text[size] = '\0';
+    return text;
+}
+
+static SimDef *sim_registry_find(const char *name) {
+    for (SimDef *d = g_sim_defs; d; d = d->next)
+        if (strcmp(d->name, name) == 0) return d;
+    return NULL;
+}
+
+static void sim_registry_remove(const char *name) {
+    for (SimDef **pp = &g_sim_defs; *pp; pp = &(*pp)->next) {
+        if (strcmp((*pp)->name, name) == 0) {
+            SimDef *d = *pp;
+            *pp = d->next;
+            sim_def_release(d);
+            return;
+        }
+    }
+}
+
+static void sim_registry_add(SimDef *def) {
+    sim_registry_remove(def->name);
+    def->next  = g_sim_defs;
+    g_sim_defs = def;
+}
+
+/* Resolve <name> to a compiled definition, loading and caching it if
+ * needed; the caller gets a reference (sim_def_put) */
+static SimDef *sim_resolve(const char *name) {
+    ov_mutex_lock(&g_sim_lock);
+    SimDef *def = sim_registry_find(name);
+    if (def) def->refs++;
+    ov_mutex_unlock(&g_sim_lock);
+    if (def) return def;
+
+    char *text = NULL;
+    if (strchr(name, '/') || strchr(name, '\\') || strchr(name, '.')) {
+        text = sim_read_file(name);
+    } else {
+        const char *path = getenv("OPENVISA_SIM_PATH");
+        while (path && *path && !text) {
+            size_t dlen = strcspn(path, ":;");
+            char file[1024];
+            snprintf(file, sizeof(file), "%.*s/%s.sim", (int)dlen, path, name);
+            text = sim_read_file(file);
+            path += dlen;
+            if (*path) path++;
+        }
+    }
+    if (!text) return NULL;
+
+    SimDef *compiled = sim_compile(name, text);
+    free(text);
+    if (!compiled) return NULL;
+
+    /* Another open may have loaded it meanwhile: keep the first */
+    ov_mutex_lock(&g_sim_lock);
+    def = sim_registry_find(name);
+    if (!def) {
+        sim_registry_add(compiled);
+        def = compiled;
+        compiled = NULL;
+    }
+    def->refs++;
+    sim_def_release(compiled);
+    ov_mutex_unlock(&g_sim_lock);
+    return def;
+}
+
+ViStatus _VI_FUNC ovSimDefine(ViConstString name, ViConstString definition) {
+    if (!name || !name[0]) return VI_ERROR_INV_RSRC_NAME;
+
+    if (!definition) {
+        ov_mutex_lock(&g_sim_lock);
+        sim_registry_remove(name);
+        ov_mutex_unlock(&g_sim_lock);
+        return VI_SUCCESS;
+    }
+
+    SimDef *def = sim_compile(name, definition);
+    if (!def) return VI_ERROR_INV_SETUP;
+    ov_mutex_lock(&g_sim_lock);
+    sim_registry_add(def);
+    ov_mutex_unlock(&g_sim_lock);
+    return VI_SUCCESS;
+}
+
+/* ========== Runtime: output queue ========== */
+
+static bool sim_out_reserve(SimImpl *impl, uint32_t extra) {
+    if (impl->out_len + extra <= impl->out_cap) return true;
+    uint32_t cap = impl->out_cap ? impl->out_cap : 256;
+    while (cap < impl->out_len + extra) cap *= 2;
+    uint8_t *n = (uint8_t *)realloc(impl->out, cap);
+    if (!n) return false;
+    impl->out = n;
+    impl->out_cap = cap;
+    return true;
+}
+
+static bool sim_out_append(SimImpl *impl, const void *data, uint32_t len) {
+    if (!sim_out_reserve(impl, len)) return false;
+    memcpy(impl->out + impl->out_len, data, len);
+    impl->out_len += len;
+    return true;
+}
+
+static bool sim_msg_push(SimImpl *impl, uint32_t off, uint32_t len, uint64_t ready_ns) {
+    if (impl->msg_count == impl->msg_cap) {
+        uint32_t cap = impl->msg_cap ? impl->msg_cap * 2 : 8;
+        SimMsg *n = (SimMsg *)malloc(cap * sizeof(SimMsg));
+        if (!n) return false;
+        for (uint32_t i = 0; i < impl->msg_count; i++)
+            n[i] = impl->msgs[(impl->msg_head + i) % impl->msg_cap];
+        free(impl->msgs);
+        impl->msgs = n;
+        impl->msg_cap = cap;
+        impl->msg_head = 0;
+    }
+    SimMsg *m = &impl->msgs[(impl->msg_head + impl->msg_count) % impl->msg_cap];
+    m->off = off;
+    m->len = len;
+    m->ready_ns = ready_ns;
+    impl->msg_count++;
+    return true;
+}
+
+static void sim_msg_pop(SimImpl *impl) {
+    impl->msg_head = (impl->msg_head + 1) % impl->msg_cap;
+    impl->msg_count--;
+    impl->msg_pos = 0;
+    if (impl->msg_count == 0)
+        impl->out_len = 0;      /* queue drained: recycle the byte buffer */
+}
+
+/* ========== Runtime: command execution ========== */
+
+typedef struct {
+    const char *ptr[SIM_MAX_ARGS];
+    uint32_t    len[SIM_MAX_ARGS];
+    uint32_t    count;
+} SimSlices;
+
+static bool sim_render(SimImpl *impl, const SimTmpl *t,
+                       const SimSlices *args, const SimSlices *sfx)
+{
+    for (uint32_t i = 0; i < t->nsegs; i++) {
+        const SimSeg *s = &t->segs[i];
+        switch (s->kind) {
+            case SIM_SEG_LIT:
+                if (!sim_out_append(impl, t->text + s->off, s->len)) return false;
+                break;
+            case SIM_SEG_VAR:
+                if (!sim_out_append(impl, impl->vals[s->idx].s, impl->vals[s->idx].len))
+                    return false;
+                break;
+            case SIM_SEG_ARG:
+                if (s->idx < args->count &&
+                    !sim_out_append(impl, args->ptr[s->idx], args->len[s->idx]))
+                    return false;
+                break;
+            case SIM_SEG_SUFFIX:
+                if (s->idx < sfx->count &&
+                    !sim_out_append(impl, sfx->ptr[s->idx], sfx->len[s->idx]))
+                    return false;
+                break;
+        }
+    }
+    return true;
+}
+
+static bool sim_set_var(SimImpl *impl, uint16_t var, const uint8_t *data, uint32_t len) {
+    SimVal *v = &impl->vals[var];
+    if (len + 1 > v->cap) {
+        char *n = (char *)realloc(v->s, len + 1);
+        if (!n) return false;
+        v->s = n;
+        v->cap = len + 1;
+    }
+    memcpy(v->s, data, len);
+    v->s[len] = '\0';
+    v->len = len;
+    return true;
+}
+
+/* Split the argument list "a, b ,\"c\"" into trimmed, unquoted slices */
+static void sim_split_args(const char *p, const char *end, SimSlices *args) {
+    args->count = 0;
+    p = sim_skip_ws(p);
+    while (p < end && args->count < SIM_MAX_ARGS) {
+        const char *start = p;
+        bool inq = false;
+        while (p < end && (inq || *p != ',')) {
+            if (*p == '"' || *p == '\'') inq = !inq;
+            p++;
+        }
+        const char *e = p;
+        while (e > start && (e[-1] == ' ' || e[-1] == '\t')) e--;
+        if (e - start >= 2 && (*start == '"' || *start == '\'') && e[-1] == *start) {
+            start++;
+            e--;
+        }
+        args->ptr[args->count] = start;
+        args->len[args->count] = (uint32_t)(e - start);
+        args->count++;
+        if (p < end) p = sim_skip_ws(p + 1);
+    }
+}
+
+/*
+ * Execute one program message unit (header + arguments).
+ * Responses are appended to impl->out; *responded tells whether this
+ * unit produced query output.
+ */
+static bool sim_exec_unit(SimImpl *impl, const char *hdr, uint32_t hlen,
+                          const char *argp, const char *arge,
+                          bool *responded, int32_t *delay_ms)
+{
+    const SimDef *def = impl->def;
+    const SimCmd *cmd = sim_table_lookup(def, hdr, hlen);
+
+    SimSlices sfx;
+    sfx.count = 0;
+
+    if (!cmd) {
+        /* Retry with numeric suffixes folded to '#' (CHAN2:SCAL? → CHAN#:SCAL?) */
+        char folded[SIM_MAX_HEADER];
+        uint32_t n = 0;
+        bool any = false;
+        for (uint32_t i = 0; i < hlen && n + 1 < sizeof(folded); ) {
+            if (isdigit((unsigned char)hdr[i]) && i > 0 && isalpha((unsigned char)hdr[i - 1])) {
+                uint32_t s = i;
+                while (i < hlen && isdigit((unsigned char)hdr[i])) i++;
+                if (sfx.count < SIM_MAX_SUFFIXES) {
+                    sfx.ptr[sfx.count] = hdr + s;
+                    sfx.len[sfx.count] = i - s;
+                    sfx.count++;
+                }
+                folded[n++] = '#';
+                any = true;
+            } else {
+                folded[n++] = hdr[i++];
+            }
+        }
+        if (any) cmd = sim_table_lookup(def, folded, n);
+    }
+
+    SimSlices args;
+    sim_split_args(argp, arge, &args);
+
+    if (!cmd) {
+        bool query = (hlen > 0 && hdr[hlen - 1] == '?');
+        if (query && def->has_unknown) {
+            *responded = true;
+            return sim_render(impl, &def->unknown, &args, &sfx);
+        }
+        return true;
+    }
+
+    if (cmd->delay_ms >= 0) *delay_ms += cmd->delay_ms;
+    else                    *delay_ms += (int32_t)def->delay_ms;
+
+    for (uint32_t i = 0; i < cmd->nops; i++) {
+        const SimOp *op = &cmd->ops[i];
+        switch (op->kind) {
+            case SIM_OP_RESPOND:
+                *responded = true;
+                if (!sim_render(impl, &op->tmpl, &args, &sfx)) return false;
+                break;
+            case SIM_OP_BLOCK:
+                *responded = true;
+                if (!sim_out_append(impl, op->block, op->block_len)) return false;
+                break;
+            case SIM_OP_SET: {
+                /* render into the output tail, then move into the variable */
+                uint32_t mark = impl->out_len;
+                if (!sim_render(impl, &op->tmpl, &args, &sfx)) return false;
+                bool ok = sim_set_var(impl, op->var, impl->out + mark, impl->out_len - mark);
+                impl->out_len = mark;
+                if (!ok) return false;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+/*
+ * Execute a complete program message: units separated by ';' (outside
+ * quotes), with SCPI relative-path rules — a unit not starting with ':' or
+ * '*' continues from the previous unit's node path.  Query responses in
+ * one message are joined with ';' and terminated once with the EOM.
+ */
+static ViStatus sim_exec_message(SimImpl *impl, const char *msg, uint32_t len) {
+    char path[SIM_MAX_HEADER];
+    uint32_t path_len = 0;
+
+    uint32_t msg_start = impl->out_len;
+    bool any_response = false;
+    int32_t delay_ms = 0;
+
+    const char *p = msg, *end = msg + len;
+    while (p < end) {
+        /* unit extent */
+        const char *u = p;
+        bool inq = false;
+        while (p < end && (inq || *p != ';')) {
+            if (*p == '"' || *p == '\'') inq = !inq;
+            p++;
+        }
+        const char *uend = p;
+        if (p < end) p++;
+
+        while (u < uend && isspace((unsigned char)*u)) u++;
+        while (uend > u && isspace((unsigned char)uend[-1])) uend--;
+        if (u == uend) continue;
+
+        /* header: [:]mnemonic[:mnemonic...][?] up to whitespace */
+        char hdr[SIM_MAX_HEADER];
+        uint32_t hlen = 0;
+        bool absolute = (*u == ':' || *u == '*');
+        if (*u == ':') u++;
+
+        if (!absolute && path_len > 0) {
+            memcpy(hdr, path, path_len);
+            hlen = path_len;
+        }
+        const char *h = u;
+        while (h < uend && !isspace((unsigned char)*h) && hlen + 1 < sizeof(hdr))
+            hdr[hlen++] = (char)toupper((unsigned char)*h++);
+
+        /* remember node path (everything up to the last ':') for the next unit */
+        if (hlen > 0 && hdr[0] != '*') {
+            uint32_t k = hlen;
+            while (k > 0 && hdr[k - 1] != ':') k--;
+            memcpy(path, hdr, k);
+            path_len = k;
+        }
+
+        uint32_t before = impl->out_len;
+        if (any_response) {
+            /* tentatively add the ';' separator; dropped if no response follows */
+            if (!sim_out_append(impl, ";", 1)) return VI_ERROR_ALLOC;
+        }
+        bool responded = false;
+        if (!sim_exec_unit(impl, hdr, hlen, h, uend, &responded, &delay_ms))
+            return VI_ERROR_ALLOC;
+        if (responded) any_response = true;
+        else           impl->out_len = before;
+    }
+
+    if (!any_response) return VI_SUCCESS;
+
+    if (!sim_out_append(impl, impl->def->eom, impl->def->eom_len))
+        return VI_ERROR_ALLOC;
+
+    uint64_t ready = delay_ms > 0 ? ov_time_ns() + (uint64_t)delay_ms * 1000000u : 0;
+    if (!sim_msg_push(impl, msg_start, impl->out_len - msg_start, ready))
+        return VI_ERROR_ALLOC;
+    return VI_SUCCESS;
+}
+
+/* ========== Transport Operations ========== */
+
+static ViStatus sim_open(OvTransport *self, const OvResource *rsrc, ViUInt32 timeout) {
+    SimImpl *impl = (SimImpl *)self->impl;
+    (void)timeout;
+
+    SimDef *def = sim_resolve(ov_rsrc_device(rsrc));
+    if (!def) return VI_ERROR_RSRC_NFOUND;
+
+    impl->vals = (SimVal *)calloc(def->nvars ? def->nvars : 1, sizeof(SimVal));
+    if (!impl->vals) {
+        sim_def_put(def);
+        return VI_ERROR_ALLOC;
+    }
+
+    for (uint32_t i = 0; i < def->nvars; i++) {
+        if (!sim_set_var(impl, (uint16_t)i, (const uint8_t *)def->var_init[i],
+                         (uint32_t)strlen(def->var_init[i]))) {
+            for (uint32_t k = 0; k <= i; k++) free(impl->vals[k].s);
+            free(impl->vals);
+            impl->vals = NULL;
+            sim_def_put(def);
+            return VI_ERROR_ALLOC;
+        }
+    }
+
+    impl->def = def;
+    return VI_SUCCESS;
+}
+
+static ViStatus sim_close(OvTransport *self) {
+    SimImpl *impl = (SimImpl *)self->impl;
+    if (impl->def) {
+        for (uint32_t i = 0; i < impl->def->nvars; i++)
+            free(impl->vals[i].s);
+        sim_def_put(impl->def);
+        impl->def = NULL;
+    }
+    free(impl->vals);
+    free(impl->out);
+    free(impl->msgs);
+    memset(impl, 0, sizeof(*impl));
+    return VI_SUCCESS;
+}
+
+static ViStatus sim_write(OvTransport *self, ViBuf buf, ViUInt32 count, ViUInt32 *retCount) {
+    SimImpl *impl = (SimImpl *)self->impl;
+    if (!impl->def) return VI_ERROR_CONN_LOST;
+
+    ViStatus st = sim_exec_message(impl, (const char *)buf, count);
+    if (st != VI_SUCCESS) return st;
+
+    if (retCount) *retCount = count;
+    return VI_SUCCESS;
+}
+
+/*
+ * Reads return at most one response message.  An empty output queue fails
+ * with VI_ERROR_TMO immediately (there is nothing that could arrive later);
+ * simulated delays are honoured up to the caller's timeout.
+ */
+static ViStatus sim_read(OvTransport *self, ViBuf buf, ViUInt32 count,
+                         ViUInt32 *retCount, ViUInt32 timeout)
+{
+    SimImpl *impl = (SimImpl *)self->impl;
+    if (!impl->def) return VI_ERROR_CONN_LOST;
+    if (retCount) *retCount = 0;
+    if (impl->msg_count == 0) return VI_ERROR_TMO;
+
+    SimMsg *m = &impl->msgs[impl->msg_head];
+    if (m->ready_ns) {
+        uint64_t now = ov_time_ns();
+        if (m->ready_ns > now) {
+            uint64_t wait = m->ready_ns - now;
+            if (timeout != VI_TMO_INFINITE && wait > (uint64_t)timeout * 1000000u) {
+                ov_sleep_ms(timeout);
+                return VI_ERROR_TMO;
+            }
+            ov_sleep_ms((uint32_t)((wait + 999999u) / 1000000u));
+        }
+        m->ready_ns = 0;
+    }
+
+    uint32_t avail = m->len - impl->msg_pos;
+    uint32_t n = (avail < count) ? avail : count;
+    memcpy(buf, impl->out + m->off + impl->msg_pos, n);
+    impl->msg_pos += n;
+    if (retCount) *retCount = n;
+
+    if (impl->msg_pos < m->len)
+        return VI_SUCCESS_MAX_CNT;
+
+    sim_msg_pop(impl);
+    return VI_SUCCESS_TERM_CHAR;
+}
+
+static ViStatus sim_readSTB(OvTransport *self, ViUInt16 *status) {
+    SimImpl *impl = (SimImpl *)self->impl;
+    if (!impl->def) return VI_ERROR_CONN_LOST;
+
+    ViUInt16 stb = 0;
+    if (impl->def->stb_var >= 0)
+        stb = (ViUInt16)(strtoul(impl->vals[impl->def->stb_var].s, NULL, 0) & 0xFFu);
+    if (impl->msg_count > 0)
+        stb |= 0x10;        /* MAV: message available */
+
+    if (status) *status = stb;
+    return VI_SUCCESS;
+}
+
+static ViStatus sim_clear(OvTransport *self) {
+    SimImpl *impl = (SimImpl *)self->impl;
+    if (!impl->def) return VI_ERROR_CONN_LOST;
+
+    impl->msg_count = 0;
+    impl->msg_head  = 0;
+    impl->msg_pos   = 0;
+    impl->out_len   = 0;
+    return VI_SUCCESS;
+}
+
+/* ========== Factory ========== */
+
+OvTransport* ov_transport_sim_create(void) {
+    OvTransport *t = (OvTransport*)calloc(1, sizeof(OvTransport));
+    if (!t) return NULL;
+
+    SimImpl *impl = (SimImpl*)calloc(1, sizeof(SimImpl));
+    if (!impl) { free(t); return NULL; }
+
+    t->impl    = impl;
+    t->open    = sim_open;
+    t->close   = sim_close;
+    t->read    = sim_read;
+    t->write   = sim_write;
+    t->readSTB = sim_readSTB;
+    t->clear   = sim_clear;
+
+    return t;
+}
@@ -0,0 +1,27 @@
+/*
+ * OpenVISA - Socket helpers shared by the TCP/IP transports
+ */
+
+#ifndef OPENVISA_SOCKET_H
+#define OPENVISA_SOCKET_H
+
+#include "visatype.h"
+
+#ifdef OPENVISA_WINDOWS
+    #include <winsock2.h>
+#else
+    #include <errno.h>
+#endif
+
+/* Status for a connect that failed with err (errno, SO_ERROR or
+ * WSAGetLastError()).  An unreachable host or network is reported as not
+ * found, like a failed lookup; anything else as a lost connection. */
+static inline ViStatus ov_connect_error(int err) {
+#ifdef OPENVISA_WINDOWS
+    return (err == WSAEHOSTUNREACH || err == WSAENETUNREACH) ? VI_ERROR_RSRC_NFOUND : VI_ERROR_CONN_LOST;
+#else
+    return (err == EHOSTUNREACH || err == ENETUNREACH) ? VI_ERROR_RSRC_NFOUND : VI_ERROR_CONN_LOST;
+#endif
+}
+
+#endif /* OPENVISA_SOCKET_H */
@@ -10,6 +10,7 @@
  */
 
 #include "../core/session.h"
+#include "socket.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -103,6 +104,8 @@ typedef struct {
     uint32_t    message_id;  /* client message ID, incremented by 2 per write */
     uint64_t    max_msg_size;/* negotiated maximum message size */
     char        sub_addr[256];/* LAN device name, e.g. "hislip0" */
+    uint8_t     trig_msg[HISLIP_HEADER_SIZE]; /* armed Trigger message */
+    bool        overlapped;  /* server runs overlapped mode (InitializeResponse) */
 } HiSLIPImpl;
 
 /* ========== Platform Initialisation ========== */
@@ -150,8 +153,8 @@ static ViStatus hislip_tcp_connect(ov_socket_t sock, struct addrinfo *addr, ViUI
     int rc = connect(sock, addr->ai_addr, (int)addr->ai_addrlen);
     if (rc == 0) goto connected;
 
-    if (WSAGetLastError() != WSAEWOULDBLOCK)
-        return VI_ERROR_CONN_LOST;
+    int cerr = WSAGetLastError();
+    if (cerr != WSAEWOULDBLOCK) return ov_connect_error(cerr);
 
     fd_set writefds;
     FD_ZERO(&writefds);
@@ -172,8 +175,7 @@ connected:
     int rc = connect(sock, addr->ai_addr, addr->ai_addrlen);
     if (rc == 0) goto connected;
 
-    if (errno != EINPROGRESS)
-        return VI_ERROR_CONN_LOST;
+    if (errno != EINPROGRESS) return ov_connect_error(errno);
 
     struct pollfd pfd = { sock, POLLOUT, 0 };
     rc = poll(&pfd, 1, (int)timeout_ms);
@@ -182,7 +184,7 @@ connected:
     int err = 0;
     socklen_t elen = sizeof(err);
     getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &elen);
-    if (err != 0) return VI_ERROR_CONN_LOST;
+    if (err != 0) return ov_connect_error(err);
 
 connected:
     fcntl(sock, F_SETFL, flags); /* restore blocking */
@@ -248,15 +250,13 @@ static ViStatus hislip_discard(ov_socket_t sock, uint64_t len, ViUInt32 timeout_
 
 /* ========== HiSLIP Message Framing ========== */
 
-/* Build and send a complete HiSLIP message (header + optional payload) */
-static ViStatus hislip_send_msg(ov_socket_t sock,
-                                 uint8_t  msg_type,
-                                 uint8_t  ctrl_code,
-                                 uint32_t msg_param,
-                                 const void *payload,
-                                 uint64_t   payload_len)
+/* Encode a 16-byte HiSLIP header */
+static void hislip_pack_header(uint8_t hdr[HISLIP_HEADER_SIZE],
+                               uint8_t  msg_type,
+                               uint8_t  ctrl_code,
+                               uint32_t msg_param,
+                               uint64_t payload_len)
 {
-    uint8_t hdr[HISLIP_HEADER_SIZE];
     uint32_t mp_be = htonl(msg_param);
     uint64_t pl_be = hislip_hton64(payload_len);
 
@@ -266,6 +266,18 @@ static ViStatus hislip_send_msg(ov_socket_t sock,
     hdr[3] = ctrl_code;
     memcpy(hdr + 4, &mp_be, 4);
     memcpy(hdr + 8, &pl_be, 8);
+}
+
+/* Build and send a complete HiSLIP message (header + optional payload) */
+static ViStatus hislip_send_msg(ov_socket_t sock,
+                                 uint8_t  msg_type,
+                                 uint8_t  ctrl_code,
+                                 uint32_t msg_param,
+                                 const void *payload,
+                                 uint64_t   payload_len)
+{
+    uint8_t hdr[HISLIP_HEADER_SIZE];
+    hislip_pack_header(hdr, msg_type, ctrl_code, msg_param, payload_len);
 
     ViStatus st = hislip_send_all(sock, hdr, HISLIP_HEADER_SIZE);
     if (st != VI_SUCCESS) return st;
@@ -350,12 +362,12 @@ static ViStatus hislip_open(OvTransport *self, const OvResource *rsrc, ViUInt32
 
     hislip_platform_init();
 
-    strncpy(impl->host, rsrc->host, sizeof(impl->host) - 1);
+    strncpy(impl->host, ov_rsrc_host(rsrc), sizeof(impl->host) - 1);
     impl->port = (rsrc->port != 0) ? rsrc->port : HISLIP_DEFAULT_PORT;
 
     /* Determine LAN device sub-address (e.g. "hislip0") */
-    if (rsrc->deviceName[0] != '\0')
-        strncpy(impl->sub_addr, rsrc->deviceName, sizeof(impl->sub_addr) - 1);
+    if (ov_rsrc_device(rsrc)[0] != '\0')
+        strncpy(impl->sub_addr, ov_rsrc_device(rsrc), sizeof(impl->sub_addr) - 1);
     else
         strncpy(impl->sub_addr, "hislip0", sizeof(impl->sub_addr) - 1);
 
@@ -412,6 +424,8 @@ static ViStatus hislip_open(OvTransport *self, const OvResource *rsrc, ViUInt32
 
     /* Session ID lives in the lower 16 bits of MessageParameter */
     impl->session_id = (uint16_t)(resp.msg_param & 0xFFFFu);
+    /* Control code bit 0: 1 = overlapped mode, 0 = synchronized mode */
+    impl->overlapped = (resp.control_code & 0x01u) != 0;
 
     /* Discard payload (ServerVendorID) */
     if (resp.payload_length > 0) {
@@ -680,6 +694,93 @@ static ViStatus hislip_clear(OvTransport *self) {
     return VI_SUCCESS;
 }
 
+/*
+ * Trigger: the Trigger message carries the next MessageID like a data
+ * message and has no reply.  Arming allocates the ID and encodes the header
+ * so firing is a single send on the synchronous channel.
+ */
+static ViStatus hislip_trigger_arm(OvTransport *self, OvTransport *const peers[],
+                                   ViUInt32 npeers, ViUInt32 *leader) {
+    HiSLIPImpl *impl = (HiSLIPImpl *)self->impl;
+    (void)peers; (void)npeers; (void)leader;
+    if (impl->sync_sock == OV_INVALID_SOCKET) return VI_ERROR_CONN_LOST;
+
+    impl->message_id += 2;
+    hislip_pack_header(impl->trig_msg, HISLIP_MSG_TRIGGER, 0, impl->message_id, 0);
+    return VI_SUCCESS;
+}
+
+static ViStatus hislip_trigger_fire(OvTransport *self) {
+    HiSLIPImpl *impl = (HiSLIPImpl *)self->impl;
+    return hislip_send_all(impl->sync_sock, impl->trig_msg, HISLIP_HEADER_SIZE);
+}
+
+static ViStatus hislip_trigger_done(OvTransport *self, ViUInt32 timeout) {
+    (void)self; (void)timeout;
+    return VI_SUCCESS;
+}
+
+/*
+ * In synchronized mode the server discards a pending response when a new
+ * message arrives, so only one query may be outstanding; overlapped mode
+ * queues responses in message order.
+ */
+static ViUInt32 hislip_max_pending(OvTransport *self) {
+    HiSLIPImpl *impl = (HiSLIPImpl *)self->impl;
+    return impl->overlapped ? 0 : 1;
+}
+
+/* ========== Broker hand-off ========== */
+
+#ifndef OPENVISA_WINDOWS
+/* Both channels move together; the session and message IDs continue */
+typedef struct {
+    uint64_t max_msg_size;
+    uint32_t message_id;
+    uint16_t session_id;
+    bool     overlapped;
+} HiSLIPConnState;
+
+static ViStatus hislip_detach(OvTransport *self, OvConnState *cs) {
+    HiSLIPImpl *impl = (HiSLIPImpl *)self->impl;
+    if (impl->sync_sock == OV_INVALID_SOCKET || impl->async_sock == OV_INVALID_SOCKET)
+        return VI_ERROR_CONN_LOST;
+
+    HiSLIPConnState hs = { impl->max_msg_size, impl->message_id, impl->session_id, impl->overlapped };
+    memset(cs, 0, sizeof(*cs));
+    cs->nfds   = 2;
+    cs->fds[0] = impl->sync_sock;
+    cs->fds[1] = impl->async_sock;
+    cs->len    = sizeof(hs);
+    memcpy(cs->state, &hs, sizeof(hs));
+    impl->sync_sock  = OV_INVALID_SOCKET;
+    impl->async_sock = OV_INVALID_SOCKET;
+    return VI_SUCCESS;
+}
+
+static ViStatus hislip_attach(OvTransport *self, const OvResource *rsrc, const OvConnState *cs) {
+    HiSLIPImpl *impl = (HiSLIPImpl *)self->impl;
+    if (cs->nfds != 2 || cs->len != sizeof(HiSLIPConnState)) {
+        for (ViUInt32 i = 0; i < cs->nfds; i++) close(cs->fds[i]);
+        return VI_ERROR_INV_SETUP;
+    }
+    HiSLIPConnState hs;
+    memcpy(&hs, cs->state, sizeof(hs));
+
+    strncpy(impl->host, ov_rsrc_host(rsrc), sizeof(impl->host) - 1);
+    impl->port = (rsrc->port != 0) ? rsrc->port : HISLIP_DEFAULT_PORT;
+    strncpy(impl->sub_addr, ov_rsrc_device(rsrc)[0] ? ov_rsrc_device(rsrc) : "hislip0",
+            sizeof(impl->sub_addr) - 1);
+    impl->sync_sock    = cs->fds[0];
+    impl->async_sock   = cs->fds[1];
+    impl->max_msg_size = hs.max_msg_size;
+    impl->message_id   = hs.message_id;
+    impl->session_id   = hs.session_id;
+    impl->overlapped   = hs.overlapped;
+    return VI_SUCCESS;
+}
+#endif
+
 /* ========== Factory ========== */
 
 OvTransport *ov_transport_tcpip_hislip_create(void) {
@@ -704,6 +805,14 @@ OvTransport *ov_transport_tcpip_hislip_create(void) {
     t->write    = hislip_write;
     t->readSTB  = hislip_readSTB;
     t->clear    = hislip_clear;
+    t->triggerArm  = hislip_trigger_arm;
+    t->triggerFire = hislip_trigger_fire;
+    t->triggerDone = hislip_trigger_done;
+    t->maxPending  = hislip_max_pending;
+#ifndef OPENVISA_WINDOWS
+    t->detach      = hislip_detach;
+    t->attach      = hislip_attach;
+#endif
 
     return t;
 }
@@ -1,12 +1,25 @@
 /*
  * OpenVISA - TCPIP Raw Socket Transport
- * Handles TCPIP::host::port::SOCKET and basic SCPI over TCP
+ * Handles TCPIP::host::port::SOCKET and basic SCPI over TCP, and the same
+ * byte stream over a Unix domain socket (UNIX::path::SOCKET).
+ *
+ * Unix sockets can also hand over a large block without pushing it through
+ * the socket: the daemon puts the block in a memfd (or any regular file)
+ * and sends it as SCM_RIGHTS attached to a single carrier byte, which stands
+ * in for the block's contents at that point of the stream.  viRead copies
+ * straight out of the file; viReadToFile moves it with sendfile(2).
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE     /* splice, F_SETPIPE_SZ */
+#endif
+
 #include "../core/session.h"
+#include "socket.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stddef.h>
 
 #ifdef OPENVISA_WINDOWS
     #include <winsock2.h>
@@ -18,6 +31,8 @@
     #define ov_socket_error() WSAGetLastError()
 #else
     #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <sys/stat.h>
     #include <netinet/in.h>
     #include <netinet/tcp.h>
     #include <arpa/inet.h>
@@ -26,18 +41,45 @@
     #include <fcntl.h>
     #include <errno.h>
     #include <poll.h>
+    #ifdef __linux__
+        #include <sys/sendfile.h>
+        #define OV_RAW_HAVE_SPLICE 1
+    #endif
     typedef int ov_socket_t;
     #define OV_INVALID_SOCKET (-1)
     #define ov_closesocket close
     #define ov_socket_error() errno
 #endif
 
+#if !defined(OPENVISA_WINDOWS) && !defined(MSG_CMSG_CLOEXEC)
+    #define MSG_CMSG_CLOEXEC 0
+#endif
+
 typedef struct {
     ov_socket_t sock;
     char host[256];
     uint16_t port;
+    bool is_unix;
+    uint8_t term_char;  /* VI_ATTR_TERMCHAR */
+    bool term_char_en;  /* VI_ATTR_TERMCHAR_EN */
+#ifndef OPENVISA_WINDOWS
+    int blk_fd;         /* UNIX: block handed over by descriptor, -1 = none */
+    off_t blk_off;
+    off_t blk_len;
+#endif
+#ifdef OV_RAW_HAVE_SPLICE
+    int pipe_fd[2];     /* splice staging pipe for viReadToFile, created lazily */
+#endif
 } TcpipRawImpl;
 
+#define RAW_PIPE_SIZE   (1 << 20)
+
+/* A socket carries no END: a read ends at the session's termination
+ * character when VI_ATTR_TERMCHAR_EN is set, else at a line feed */
+static inline uint8_t raw_term(const TcpipRawImpl *impl) {
+    return impl->term_char_en ? impl->term_char : '\n';
+}
+
 /* ========== Platform init ========== */
 
 #ifdef OPENVISA_WINDOWS
@@ -65,8 +107,8 @@ static ViStatus tcpip_connect(ov_socket_t sock, struct addrinfo *addr, ViUInt32
     int rc = connect(sock, addr->ai_addr, (int)addr->ai_addrlen);
     if (rc == 0) goto connected;
 
-    if (WSAGetLastError() != WSAEWOULDBLOCK)
-        return VI_ERROR_CONN_LOST;
+    int cerr = WSAGetLastError();
+    if (cerr != WSAEWOULDBLOCK) return ov_connect_error(cerr);
 
     fd_set writefds;
     FD_ZERO(&writefds);
@@ -89,8 +131,7 @@ connected:
     int rc = connect(sock, addr->ai_addr, addr->ai_addrlen);
     if (rc == 0) goto connected;
 
-    if (errno != EINPROGRESS)
-        return VI_ERROR_CONN_LOST;
+    if (errno != EINPROGRESS) return ov_connect_error(errno);
 
     struct pollfd pfd = { .fd = sock, .events = POLLOUT };
     rc = poll(&pfd, 1, (int)timeout_ms);
@@ -100,7 +141,7 @@ connected:
     int err = 0;
     socklen_t len = sizeof(err);
     getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &len);
-    if (err != 0) return VI_ERROR_CONN_LOST;
+    if (err != 0) return ov_connect_error(err);
 
 connected:
     fcntl(sock, F_SETFL, flags); /* restore blocking */
@@ -115,7 +156,7 @@ static ViStatus tcpip_raw_open(OvTransport *self, const OvResource *rsrc, ViUInt
 
     tcpip_platform_init();
 
-    strncpy(impl->host, rsrc->host, sizeof(impl->host) - 1);
+    strncpy(impl->host, ov_rsrc_host(rsrc), sizeof(impl->host) - 1);
     impl->port = rsrc->port;
 
     /* Default port for raw SCPI-over-TCP is 5025 if SOCKET mode */
@@ -159,12 +200,125 @@ static ViStatus tcpip_raw_open(OvTransport *self, const OvResource *rsrc, ViUInt
     return VI_SUCCESS;
 }
 
+#ifndef OPENVISA_WINDOWS
+/* UNIX::path::SOCKET; on Linux a path starting with '@' names an abstract socket */
+static ViStatus tcpip_unix_open(OvTransport *self, const OvResource *rsrc, ViUInt32 timeout) {
+    TcpipRawImpl *impl = (TcpipRawImpl*)self->impl;
+
+    struct sockaddr_un sun;
+    memset(&sun, 0, sizeof(sun));
+    sun.sun_family = AF_UNIX;
+    size_t len = strlen(ov_rsrc_device(rsrc));
+    if (len == 0 || len >= sizeof(sun.sun_path)) return VI_ERROR_RSRC_NFOUND;
+    memcpy(sun.sun_path, ov_rsrc_device(rsrc), len);
+    socklen_t alen = (socklen_t)sizeof(sun);
+#ifdef __linux__
+    if (sun.sun_path[0] == '@') {
+        sun.sun_path[0] = '\0';
+        alen = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + len);
+    }
+#endif
+
+    impl->sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (impl->sock == OV_INVALID_SOCKET) return VI_ERROR_SYSTEM_ERROR;
+
+    /* A local connect only blocks while the daemon's backlog is full */
+    struct timeval tv = { .tv_sec = timeout / 1000, .tv_usec = (timeout % 1000) * 1000 };
+    setsockopt(impl->sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    if (connect(impl->sock, (struct sockaddr*)&sun, alen) != 0) {
+        int err = errno;
+        ov_closesocket(impl->sock);
+        impl->sock = OV_INVALID_SOCKET;
+        if (err == EAGAIN || err == EINPROGRESS) return VI_ERROR_TMO;
+        return (err == ENOENT || err == ECONNREFUSED) ? VI_ERROR_RSRC_NFOUND : VI_ERROR_CONN_LOST;
+    }
+    memset(&tv, 0, sizeof(tv));
+    setsockopt(impl->sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    impl->is_unix = true;
+    return VI_SUCCESS;
+}
+
+static void tcpip_unix_drop_block(TcpipRawImpl *impl) {
+    if (impl->blk_fd >= 0) close(impl->blk_fd);
+    impl->blk_fd = -1;
+    impl->blk_off = impl->blk_len = 0;
+}
+
+/* recv that picks up a block descriptor; its carrier byte is not counted */
+static int tcpip_unix_recv(TcpipRawImpl *impl, ViBuf buf, ViUInt32 count) {
+    union { struct cmsghdr h; char b[CMSG_SPACE(sizeof(int) * 4)]; } ctl;
+    struct iovec iov = { .iov_base = buf, .iov_len = count };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl.b;
+    msg.msg_controllen = sizeof(ctl.b);
+
+    ssize_t n = recvmsg(impl->sock, &msg, MSG_CMSG_CLOEXEC);
+    if (n <= 0) return (int)n;
+
+    bool carrier = false;
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+        size_t nfds = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < nfds; i++) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(c) + i * sizeof(int), sizeof(int));
+            struct stat sb;
+            if (!carrier && fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode)) {
+                tcpip_unix_drop_block(impl);
+                impl->blk_fd = fd;
+                impl->blk_len = sb.st_size;
+            } else {
+                close(fd);
+            }
+            carrier = true;
+        }
+    }
+    return (int)(carrier ? n - 1 : n);
+}
+
+static ViStatus tcpip_unix_read_block(TcpipRawImpl *impl, ViBuf buf, ViUInt32 count, ViUInt32 *retCount) {
+    off_t left = impl->blk_len - impl->blk_off;
+    size_t want = left < (off_t)count ? (size_t)left : count;
+    ssize_t n = pread(impl->blk_fd, buf, want, impl->blk_off);
+    if (n < 0) {
+        tcpip_unix_drop_block(impl);
+        return VI_ERROR_IO;
+    }
+    impl->blk_off += n;
+    if (retCount) *retCount = (ViUInt32)n;
+    if ((size_t)n < want || impl->blk_off >= impl->blk_len) {
+        tcpip_unix_drop_block(impl);
+        if (n > 0 && buf[n - 1] == raw_term(impl)) return VI_SUCCESS_TERM_CHAR;
+    }
+    return VI_SUCCESS;
+}
+#else  /* OPENVISA_WINDOWS */
+static ViStatus tcpip_unix_open_unsupported(OvTransport *self, const OvResource *rsrc, ViUInt32 timeout) {
+    (void)self; (void)rsrc; (void)timeout;
+    return VI_ERROR_NSUP_OPER;
+}
+#endif
+
 static ViStatus tcpip_raw_close(OvTransport *self) {
     TcpipRawImpl *impl = (TcpipRawImpl*)self->impl;
     if (impl->sock != OV_INVALID_SOCKET) {
         ov_closesocket(impl->sock);
         impl->sock = OV_INVALID_SOCKET;
     }
+#ifndef OPENVISA_WINDOWS
+    tcpip_unix_drop_block(impl);
+#endif
+#ifdef OV_RAW_HAVE_SPLICE
+    if (impl->pipe_fd[0] >= 0) {
+        close(impl->pipe_fd[0]);
+        close(impl->pipe_fd[1]);
+        impl->pipe_fd[0] = impl->pipe_fd[1] = -1;
+    }
+#endif
     return VI_SUCCESS;
 }
 
@@ -182,6 +336,9 @@ static ViStatus tcpip_raw_write(OvTransport *self, ViBuf buf, ViUInt32 count, Vi
 static ViStatus tcpip_raw_read(OvTransport *self, ViBuf buf, ViUInt32 count, ViUInt32 *retCount, ViUInt32 timeout) {
     TcpipRawImpl *impl = (TcpipRawImpl*)self->impl;
     if (impl->sock == OV_INVALID_SOCKET) return VI_ERROR_CONN_LOST;
+#ifndef OPENVISA_WINDOWS
+    if (impl->blk_fd >= 0) return tcpip_unix_read_block(impl, buf, count, retCount);
+#endif
 
     /* Set receive timeout */
 #ifdef OPENVISA_WINDOWS
@@ -194,7 +351,13 @@ static ViStatus tcpip_raw_read(OvTransport *self, ViBuf buf, ViUInt32 count, ViU
     setsockopt(impl->sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
 #endif
 
-    int received = recv(impl->sock, (char*)buf, count, 0);
+    int received;
+#ifndef OPENVISA_WINDOWS
+    if (impl->is_unix)
+        received = tcpip_unix_recv(impl, buf, count);
+    else
+#endif
+    received = recv(impl->sock, (char*)buf, count, 0);
     if (received < 0) {
 #ifdef OPENVISA_WINDOWS
         if (WSAGetLastError() == WSAETIMEDOUT)
@@ -204,12 +367,16 @@ static ViStatus tcpip_raw_read(OvTransport *self, ViBuf buf, ViUInt32 count, ViU
             return VI_ERROR_TMO;
         return VI_ERROR_IO;
     }
+#ifndef OPENVISA_WINDOWS
+    /* Nothing but a carrier byte arrived: the block is the data */
+    if (received == 0 && impl->blk_fd >= 0) return tcpip_unix_read_block(impl, buf, count, retCount);
+#endif
     if (received == 0) return VI_ERROR_CONN_LOST;
 
     if (retCount) *retCount = (ViUInt32)received;
 
-    /* Check if terminated by newline */
-    if (received > 0 && buf[received - 1] == '\n')
+    /* Check if terminated */
+    if (received > 0 && buf[received - 1] == raw_term(impl))
         return VI_SUCCESS_TERM_CHAR;
 
     return VI_SUCCESS;
@@ -238,6 +405,201 @@ static ViStatus tcpip_raw_clear(OvTransport *self) {
     return tcpip_raw_write(self, (ViBuf)cmd, 5, &retCount);
 }
 
+/* ========== Zero-copy file transfer (Linux) ========== */
+
+#ifdef OV_RAW_HAVE_SPLICE
+
+/*
+ * Socket -> pipe -> file with splice(2); payload never enters user space.
+ * Mirrors tcpip_raw_read: the transfer ends at count, on timeout, on peer
+ * close, or when the stream goes idle right after the terminator.
+ */
+static ViStatus tcpip_raw_readToFile(OvTransport *self, int fd, ViUInt32 count, ViUInt32 *retCount, ViUInt32 timeout) {
+    TcpipRawImpl *impl = (TcpipRawImpl*)self->impl;
+    if (impl->sock == OV_INVALID_SOCKET) return VI_ERROR_CONN_LOST;
+
+    if (impl->pipe_fd[0] < 0) {
+        if (pipe2(impl->pipe_fd, O_CLOEXEC) != 0) {
+            impl->pipe_fd[0] = impl->pipe_fd[1] = -1;
+            return VI_ERROR_NSUP_OPER;
+        }
+        fcntl(impl->pipe_fd[1], F_SETPIPE_SZ, RAW_PIPE_SIZE);
+    }
+
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+    ViUInt32 total = 0;
+    ViStatus st = VI_SUCCESS;
+
+    while (total < count) {
+        struct pollfd pfd = { .fd = impl->sock, .events = POLLIN };
+        int rc = poll(&pfd, 1, (int)timeout);
+        if (rc == 0) { st = VI_ERROR_TMO; break; }
+        if (rc < 0) { if (errno == EINTR) continue; st = VI_ERROR_IO; break; }
+
+        ssize_t n = splice(impl->sock, NULL, impl->pipe_fd[1], NULL,
+                           count - total < RAW_PIPE_SIZE ? count - total : RAW_PIPE_SIZE,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) continue;
+            /* Filesystems without splice_write support: let fileio.c map it */
+            if (total == 0 && errno == EINVAL) return VI_ERROR_NSUP_OPER;
+            st = VI_ERROR_IO;
+            break;
+        }
+        if (n == 0) { st = total ? VI_SUCCESS : VI_ERROR_CONN_LOST; break; }
+
+        while (n > 0) {
+            ssize_t m = splice(impl->pipe_fd[0], NULL, fd, NULL, (size_t)n, SPLICE_F_MOVE);
+            if (m < 0) {
+                if (errno == EINTR) continue;
+                /* Bytes stranded in the pipe would corrupt the next transfer */
+                close(impl->pipe_fd[0]);
+                close(impl->pipe_fd[1]);
+                impl->pipe_fd[0] = impl->pipe_fd[1] = -1;
+                if (retCount) *retCount = total;
+                return VI_ERROR_FILE_IO;
+            }
+            n -= m;
+            total += (ViUInt32)m;
+        }
+
+        /* Terminator check without pulling the payload through user space */
+        unsigned char last = 0;
+        if (pread(fd, &last, 1, pos + (off_t)total - 1) == 1 && last == raw_term(impl)) {
+            struct pollfd idle = { .fd = impl->sock, .events = POLLIN };
+            if (poll(&idle, 1, 0) == 0) { st = VI_SUCCESS_TERM_CHAR; break; }
+        }
+    }
+
+    if (retCount) *retCount = total;
+    if (st == VI_SUCCESS && total == count) st = VI_SUCCESS_MAX_CNT;
+    return st;
+}
+
+/* File -> socket with sendfile(2) */
+static ViStatus tcpip_raw_writeFromFile(OvTransport *self, int fd, ViUInt32 count, ViUInt32 *retCount) {
+    TcpipRawImpl *impl = (TcpipRawImpl*)self->impl;
+    if (impl->sock == OV_INVALID_SOCKET) return VI_ERROR_CONN_LOST;
+
+    ViUInt32 total = 0;
+    while (total < count) {
+        ssize_t n = sendfile(impl->sock, fd, NULL, count - total);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            if (total == 0 && (errno == EINVAL || errno == ENOSYS)) return VI_ERROR_NSUP_OPER;
+            if (retCount) *retCount = total;
+            return VI_ERROR_IO;
+        }
+        if (n == 0) break;      /* end of file */
+        total += (ViUInt32)n;
+    }
+
+    if (retCount) *retCount = total;
+    return VI_SUCCESS;
+}
+
+/*
+ * UNIX: splice would pass carrier bytes through as data and lose their
+ * descriptors, so stream data goes through tcpip_raw_read and handed-over
+ * blocks go file -> file with sendfile(2).
+ */
+static ViStatus tcpip_unix_readToFile(OvTransport *self, int fd, ViUInt32 count, ViUInt32 *retCount, ViUInt32 timeout) {
+    TcpipRawImpl *impl = (TcpipRawImpl*)self->impl;
+    if (impl->sock == OV_INVALID_SOCKET) return VI_ERROR_CONN_LOST;
+
+    char buf[16384];
+    ViUInt32 total = 0;
+    ViStatus st = VI_SUCCESS;
+
+    while (total < count) {
+        if (impl->blk_fd >= 0) {
+            off_t left = impl->blk_len - impl->blk_off;
+            size_t want = left < (off_t)(count - total) ? (size_t)left : count - total;
+            ssize_t n = sendfile(fd, impl->blk_fd, &impl->blk_off, want);
+            if (n < 0) {
+                if (errno == EINTR || errno == EAGAIN) continue;
+                if (total == 0 && (errno == EINVAL || errno == ENOSYS)) return VI_ERROR_NSUP_OPER;
+                st = VI_ERROR_FILE_IO;
+                break;
+            }
+            total += (ViUInt32)n;
+            if (n == 0 || impl->blk_off >= impl->blk_len) {
+                unsigned char last = 0;
+                bool term = impl->blk_len > 0 && pread(impl->blk_fd, &last, 1, impl->blk_len - 1) == 1 &&
+                            last == raw_term(impl);
+                tcpip_unix_drop_block(impl);
+                if (term) { st = VI_SUCCESS_TERM_CHAR; break; }
+            }
+            continue;
+        }
+
+        ViUInt32 n = 0;
+        st = tcpip_raw_read(self, (ViBuf)buf, count - total < sizeof(buf) ? count - total : (ViUInt32)sizeof(buf),
+                            &n, timeout);
+        if (st < VI_SUCCESS) break;
+        for (ViUInt32 off = 0; off < n; ) {
+            ssize_t w = write(fd, buf + off, n - off);
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) { if (retCount) *retCount = total + off; return VI_ERROR_FILE_IO; }
+            off += (ViUInt32)w;
+        }
+        total += n;
+        if (st == VI_SUCCESS_TERM_CHAR) break;
+    }
+
+    if (retCount) *retCount = total;
+    if (st == VI_SUCCESS && total == count) st = VI_SUCCESS_MAX_CNT;
+    return st;
+}
+
+#endif /* OV_RAW_HAVE_SPLICE */
+
+/* ========== Broker hand-off ========== */
+
+#ifndef OPENVISA_WINDOWS
+/* A raw socket carries no protocol state: the fd is the whole connection */
+static ViStatus tcpip_raw_detach(OvTransport *self, OvConnState *cs) {
+    TcpipRawImpl *impl = (TcpipRawImpl*)self->impl;
+    if (impl->sock == OV_INVALID_SOCKET) return VI_ERROR_CONN_LOST;
+    tcpip_unix_drop_block(impl);
+    memset(cs, 0, sizeof(*cs));
+    cs->nfds   = 1;
+    cs->fds[0] = impl->sock;
+    impl->sock = OV_INVALID_SOCKET;
+    return VI_SUCCESS;
+}
+
+static ViStatus tcpip_raw_attach(OvTransport *self, const OvResource *rsrc, const OvConnState *cs) {
+    TcpipRawImpl *impl = (TcpipRawImpl*)self->impl;
+    if (cs->nfds != 1) {
+        for (ViUInt32 i = 0; i < cs->nfds; i++) close(cs->fds[i]);
+        return VI_ERROR_INV_SETUP;
+    }
+    strncpy(impl->host, ov_rsrc_host(rsrc), sizeof(impl->host) - 1);
+    impl->port = rsrc->port ? rsrc->port : 5025;
+    impl->sock = cs->fds[0];
+    return VI_SUCCESS;
+}
+#endif
+
+/* ========== Attributes ========== */
+
+static ViStatus tcpip_raw_setAttribute(OvTransport *self, ViAttr attr, ViAttrState value) {
+    TcpipRawImpl *impl = (TcpipRawImpl*)self->impl;
+    switch (attr) {
+        case VI_ATTR_TERMCHAR:     impl->term_char = (uint8_t)(value & 0xFF); return VI_SUCCESS;
+        case VI_ATTR_TERMCHAR_EN:  impl->term_char_en = value != 0; return VI_SUCCESS;
+        default:                   return VI_ERROR_NSUP_ATTR;
+    }
+}
+
+/* A read returns whatever one recv() delivered, so replies to several
+ * queries can arrive merged: keep one query in flight */
+static ViUInt32 tcpip_raw_maxPending(OvTransport *self) {
+    (void)self;
+    return 1;
+}
+
 /* ========== Factory ========== */
 
 OvTransport* ov_transport_tcpip_raw_create(void) {
@@ -248,6 +610,10 @@ OvTransport* ov_transport_tcpip_raw_create(void) {
     if (!impl) { free(t); return NULL; }
 
     impl->sock = OV_INVALID_SOCKET;
+    impl->term_char = '\n';
+#ifndef OPENVISA_WINDOWS
+    impl->blk_fd = -1;
+#endif
     t->impl = impl;
     t->open = tcpip_raw_open;
     t->close = tcpip_raw_close;
@@ -255,6 +621,32 @@ OvTransport* ov_transport_tcpip_raw_create(void) {
     t->write = tcpip_raw_write;
     t->readSTB = tcpip_raw_readSTB;
     t->clear = tcpip_raw_clear;
+    t->setAttribute = tcpip_raw_setAttribute;
+    t->maxPending = tcpip_raw_maxPending;
+#ifndef OPENVISA_WINDOWS
+    t->detach = tcpip_raw_detach;
+    t->attach = tcpip_raw_attach;
+#endif
+#ifdef OV_RAW_HAVE_SPLICE
+    impl->pipe_fd[0] = impl->pipe_fd[1] = -1;
+    t->readToFile = tcpip_raw_readToFile;
+    t->writeFromFile = tcpip_raw_writeFromFile;
+#endif
+
+    return t;
+}
 
+/* UNIX::path::SOCKET: the raw transport over an AF_UNIX stream socket */
+OvTransport* ov_transport_unix_create(void) {
+    OvTransport *t = ov_transport_tcpip_raw_create();
+    if (!t) return NULL;
+#ifndef OPENVISA_WINDOWS
+    t->open = tcpip_unix_open;
+#else
+    t->open = tcpip_unix_open_unsupported;
+#endif
+#ifdef OV_RAW_HAVE_SPLICE
+    t->readToFile = tcpip_unix_readToFile;
+#endif
     return t;
 }
@@ -27,6 +27,7 @@
 #endif
 
 #include "../core/session.h"
+#include "socket.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -117,6 +118,9 @@ typedef struct {
     uint32_t    xid;            /* rolling RPC transaction ID */
     uint32_t    max_recv_size;  /* advertised by create_link reply */
     char        device[256];    /* LAN device name, e.g. "inst0" */
+    uint8_t     trig_msg[64];   /* armed device_trigger record, mark included */
+    uint32_t    trig_len;
+    uint32_t    trig_xid;
 } Vxi11Impl;
 
 /* ========== Platform initialisation ========== */
@@ -403,7 +407,8 @@ static ViStatus vxi11_connect(ov_socket_t sock,
 
     int rc = connect(sock, ai->ai_addr, (int)ai->ai_addrlen);
     if (rc == 0) goto done;
-    if (WSAGetLastError() != WSAEWOULDBLOCK) return VI_ERROR_CONN_LOST;
+    int cerr = WSAGetLastError();
+    if (cerr != WSAEWOULDBLOCK) return ov_connect_error(cerr);
 
     fd_set wfds;
     FD_ZERO(&wfds);
@@ -422,7 +427,7 @@ done:
 
     int rc = connect(sock, ai->ai_addr, ai->ai_addrlen);
     if (rc == 0) goto done;
-    if (errno != EINPROGRESS) return VI_ERROR_CONN_LOST;
+    if (errno != EINPROGRESS) return ov_connect_error(errno);
 
     struct pollfd pfd = { .fd = sock, .events = POLLOUT };
     rc = poll(&pfd, 1, (int)timeout_ms);
@@ -432,7 +437,7 @@ done:
     int err = 0;
     socklen_t elen = sizeof(err);
     getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &elen);
-    if (err != 0) return VI_ERROR_CONN_LOST;
+    if (err != 0) return ov_connect_error(err);
 
 done:
     fcntl(sock, F_SETFL, flags); /* restore blocking */
@@ -577,10 +582,10 @@ static ViStatus vxi11_open(OvTransport *self,
     Vxi11Impl *impl = (Vxi11Impl *)self->impl;
     vxi11_platform_init();
 
-    strncpy(impl->host, rsrc->host, sizeof(impl->host) - 1);
+    strncpy(impl->host, ov_rsrc_host(rsrc), sizeof(impl->host) - 1);
 
     /* Device name: parsed from resource string (e.g. "inst0") or default */
-    const char *devname = rsrc->deviceName[0] ? rsrc->deviceName : "inst0";
+    const char *devname = ov_rsrc_device(rsrc)[0] ? ov_rsrc_device(rsrc) : "inst0";
     strncpy(impl->device, devname, sizeof(impl->device) - 1);
 
     /* Seed XID from current time XOR impl address for uniqueness */
@@ -862,6 +867,123 @@ static ViStatus vxi11_clear(OvTransport *self)
     return VI_SUCCESS;
 }
 
+/*
+ * device_trigger: Group Execute Trigger for this link.
+ *
+ * Arming encodes the whole record (record mark, RPC header, Device_GenericParms)
+ * so firing is one send(); the Device_Error reply is collected afterwards.
+ */
+static ViStatus vxi11_trigger_arm(OvTransport *self, OvTransport *const peers[],
+                                  ViUInt32 npeers, ViUInt32 *leader)
+{
+    Vxi11Impl *impl = (Vxi11Impl *)self->impl;
+    (void)peers; (void)npeers; (void)leader;
+    if (impl->sock == OV_INVALID_SOCKET) return VI_ERROR_CONN_LOST;
+
+    uint8_t *msg = impl->trig_msg + 4;
+    uint32_t n   = 0;
+    impl->trig_xid = impl->xid++;
+    n += rpc_build_call_hdr(msg + n, impl->trig_xid,
+                            VXI11_CORE_PROG, VXI11_CORE_VERS,
+                            VXI11_PROC_DEVICE_TRIGGER);
+    n += xdr_put_i32(msg + n, impl->lid);
+    n += xdr_put_u32(msg + n, 0u);             /* flags */
+    n += xdr_put_u32(msg + n, 0u);             /* lock_timeout */
+    n += xdr_put_u32(msg + n, 5000u);          /* io_timeout */
+
+    xdr_put_u32(impl->trig_msg, 0x80000000u | n);
+    impl->trig_len = 4 + n;
+    return VI_SUCCESS;
+}
+
+static ViStatus vxi11_trigger_fire(OvTransport *self)
+{
+    Vxi11Impl *impl = (Vxi11Impl *)self->impl;
+    uint32_t sent = 0;
+    while (sent < impl->trig_len) {
+        int rc = send(impl->sock, (const char *)(impl->trig_msg + sent),
+                      (int)(impl->trig_len - sent), 0);
+        if (rc <= 0) return VI_ERROR_IO;
+        sent += (uint32_t)rc;
+    }
+    return VI_SUCCESS;
+}
+
+static ViStatus vxi11_trigger_done(OvTransport *self, ViUInt32 timeout)
+{
+    Vxi11Impl *impl = (Vxi11Impl *)self->impl;
+
+    uint8_t  rbuf[128];
+    uint32_t rlen = 0;
+    ViStatus st = rm_recv(impl->sock, rbuf, sizeof(rbuf), &rlen, timeout + 2000u);
+    if (st != VI_SUCCESS) return st;
+
+    int off = rpc_parse_reply(rbuf, rlen, impl->trig_xid);
+    if (off < 0 || (uint32_t)off + 4u > rlen) return VI_ERROR_IO;
+
+    int32_t error = 0;
+    xdr_get_i32(rbuf + off, &error);
+    if (error != 0) return VI_ERROR_IO;
+
+    return VI_SUCCESS;
+}
+
+/* ========== Broker hand-off ========== */
+
+#ifndef OPENVISA_WINDOWS
+/* The link survives the move: the next process continues its lid and XIDs */
+typedef struct {
+    int32_t  lid;
+    uint32_t xid;
+    uint32_t max_recv_size;
+    uint16_t core_port;
+} Vxi11ConnState;
+
+static ViStatus vxi11_detach(OvTransport *self, OvConnState *cs)
+{
+    Vxi11Impl *impl = (Vxi11Impl *)self->impl;
+    if (impl->sock == OV_INVALID_SOCKET) return VI_ERROR_CONN_LOST;
+
+    Vxi11ConnState vs = { impl->lid, impl->xid, impl->max_recv_size, impl->core_port };
+    memset(cs, 0, sizeof(*cs));
+    cs->nfds   = 1;
+    cs->fds[0] = impl->sock;
+    cs->len    = sizeof(vs);
+    memcpy(cs->state, &vs, sizeof(vs));
+    impl->sock = OV_INVALID_SOCKET;     /* close() must not destroy_link */
+    return VI_SUCCESS;
+}
+
+static ViStatus vxi11_attach(OvTransport *self, const OvResource *rsrc, const OvConnState *cs)
+{
+    Vxi11Impl *impl = (Vxi11Impl *)self->impl;
+    if (cs->nfds != 1 || cs->len != sizeof(Vxi11ConnState)) {
+        for (ViUInt32 i = 0; i < cs->nfds; i++) close(cs->fds[i]);
+        return VI_ERROR_INV_SETUP;
+    }
+    Vxi11ConnState vs;
+    memcpy(&vs, cs->state, sizeof(vs));
+
+    strncpy(impl->host, ov_rsrc_host(rsrc), sizeof(impl->host) - 1);
+    strncpy(impl->device, ov_rsrc_device(rsrc)[0] ? ov_rsrc_device(rsrc) : "inst0",
+            sizeof(impl->device) - 1);
+    impl->sock          = cs->fds[0];
+    impl->lid           = vs.lid;
+    impl->xid           = vs.xid;
+    impl->max_recv_size = vs.max_recv_size;
+    impl->core_port     = vs.core_port;
+    return VI_SUCCESS;
+}
+#endif
+
+/* Instruments behind VXI-11 follow 488.2 message exchange: a second query
+ * before the first response is read interrupts it (-410) */
+static ViUInt32 vxi11_max_pending(OvTransport *self)
+{
+    (void)self;
+    return 1;
+}
+
 /* ========== Factory ========== */
 
 OvTransport *ov_transport_tcpip_vxi11_create(void)
@@ -883,6 +1005,14 @@ OvTransport *ov_transport_tcpip_vxi11_create(void)
     t->write   = vxi11_write;
     t->readSTB = vxi11_readSTB;
     t->clear   = vxi11_clear;
+    t->maxPending  = vxi11_max_pending;
+    t->triggerArm  = vxi11_trigger_arm;
+    t->triggerFire = vxi11_trigger_fire;
+    t->triggerDone = vxi11_trigger_done;
+#ifndef OPENVISA_WINDOWS
+    t->detach      = vxi11_detach;
+    t->attach      = vxi11_attach;
+#endif
 
     return t;
 }
@@ -1,17 +1,220 @@
 /*
  * OpenVISA - Transport factory
+ *
+ * LAN and OpenVISA's own transports are linked into libvisa.  Buses that
+ * drag in hardware libraries (USB, GPIB, local serial ports) are, in a
+ * plugin build (OPENVISA_TRANSPORT_PLUGINS), separate modules loaded the
+ * first time a resource of their prefix is opened; ovTransportRegister adds
+ * prefixes for transports shipped outside this tree.  ABI: core/plugin.h.
  */
 
 #include "../core/session.h"
+#include "../core/plugin.h"
+#include "../core/thread.h"
+#include "openvisa.h"
 #include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#ifdef OPENVISA_WINDOWS
+    typedef HMODULE ov_dl_t;
+    #define ov_dlopen(n)    LoadLibraryA(n)
+    #define ov_dlsym(h, s)  ((void*)GetProcAddress((HMODULE)(h), (s)))
+    #define ov_dlclose(h)   FreeLibrary((HMODULE)(h))
+    #define OV_PLUGIN_EXT   ".dll"
+    #define OV_PATH_SEPS    ";"
+#else
+    #include <dlfcn.h>
+    typedef void* ov_dl_t;
+    #define ov_dlopen(n)    dlopen((n), RTLD_NOW | RTLD_LOCAL)
+    #define ov_dlsym(h, s)  dlsym((h), (s))
+    #define ov_dlclose(h)   dlclose(h)
+    #ifdef __APPLE__
+        #define OV_PLUGIN_EXT   ".dylib"
+    #else
+        #define OV_PLUGIN_EXT   ".so"
+    #endif
+    #define OV_PATH_SEPS    ":;"
+#endif
 
 /* Forward declarations for transport constructors */
 extern OvTransport* ov_transport_tcpip_raw_create(void);
 extern OvTransport* ov_transport_tcpip_vxi11_create(void);
 extern OvTransport* ov_transport_tcpip_hislip_create(void);
+extern OvTransport* ov_transport_sim_create(void);
+extern OvTransport* ov_transport_proxy_create(void);
+extern OvTransport* ov_transport_remote_create(void);
+extern OvTransport* ov_transport_unix_create(void);
+extern OvTransport* ov_transport_shm_create(void);
+extern OvTransport* ov_transport_rfc2217_create(void);
+#ifndef OPENVISA_TRANSPORT_PLUGINS
 extern OvTransport* ov_transport_usbtmc_create(void);
 extern OvTransport* ov_transport_serial_create(void);
 extern OvTransport* ov_transport_gpib_create(void);
+#endif
+
+/* ========== Plugin registry ========== */
+
+#define OV_MAX_PLUGINS      16
+#define OV_PREFIX_SIZE      16
+
+typedef struct {
+    char        prefix[OV_PREFIX_SIZE];
+    char        library[256];       /* module name (searched) or path */
+    bool        tried;              /* load attempted; create set if it worked */
+    OvTransport *(*create)(void);
+} OvPluginSlot;
+
+static OvMutex      g_plugin_lock = OV_MUTEX_INIT;
+static OvPluginSlot g_plugins[OV_MAX_PLUGINS] = {
+#ifdef OPENVISA_TRANSPORT_PLUGINS
+    /* fixed slots of the VISA buses; registered prefixes follow */
+    { "USB",  "ovt_usbtmc", false, NULL },
+    { "GPIB", "ovt_gpib",   false, NULL },
+    { "ASRL", "ovt_serial", false, NULL },
+#else
+    { "USB",  "", true, ov_transport_usbtmc_create },
+    { "GPIB", "", true, ov_transport_gpib_create },
+    { "ASRL", "", true, ov_transport_serial_create },
+#endif
+};
+static int g_nplugins = 3;
+
+/* Slot of an interface type: the VISA buses, then OV_INTF_PLUGIN + i */
+static int plugin_slot(OvIntfType type) {
+    switch (type) {
+        case OV_INTF_USB:  return 0;
+        case OV_INTF_GPIB: return 1;
+        case OV_INTF_ASRL: return 2;
+        default:
+            if ((int)type >= OV_INTF_PLUGIN && (int)type < OV_INTF_PLUGIN + g_nplugins)
+                return (int)type - OV_INTF_PLUGIN;
+            return -1;
+    }
+}
+
+static bool prefix_eq(const char *a, const char *b, size_t n) {
+    for (size_t k = 0; k < n; k++)
+        if (tolower((unsigned char)a[k]) != tolower((unsigned char)b[k])) return false;
+    return true;
+}
+
+static ov_dl_t plugin_dlopen_in(const char *dir, size_t dlen, const char *name) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%.*s/%s" OV_PLUGIN_EXT, (int)dlen, dir, name);
+    return ov_dlopen(path);
+}
+
+/* $OPENVISA_PLUGIN_PATH, then the install directory, then the loader's own search */
+static ov_dl_t plugin_dlopen(const char *library) {
+    if (strchr(library, '/') || strchr(library, '\\')) return ov_dlopen(library);
+    ov_dl_t lib = NULL;
+    const char *path = getenv("OPENVISA_PLUGIN_PATH");
+    while (path && *path && !lib) {
+        size_t dlen = strcspn(path, OV_PATH_SEPS);
+        if (dlen) lib = plugin_dlopen_in(path, dlen, library);
+        path += dlen;
+        if (*path) path++;
+    }
+#ifdef OPENVISA_PLUGIN_DIR
+    if (!lib) lib = plugin_dlopen_in(OPENVISA_PLUGIN_DIR, strlen(OPENVISA_PLUGIN_DIR), library);
+#endif
+    if (!lib) {
+        char name[300];
+        snprintf(name, sizeof(name), "%s" OV_PLUGIN_EXT, library);
+        lib = ov_dlopen(name);
+    }
+    return lib;
+}
+
+/* Caller holds g_plugin_lock */
+static void plugin_load(OvPluginSlot *slot) {
+    slot->tried = true;
+    ov_dl_t lib = plugin_dlopen(slot->library);
+    if (!lib) return;
+    OvTransportPluginEntry entry = (OvTransportPluginEntry)ov_dlsym(lib, OV_PLUGIN_ENTRY);
+    const OvTransportPlugin *desc = entry ? entry() : NULL;
+    if (!desc || desc->abi != OV_PLUGIN_ABI || desc->transportSize != sizeof(OvTransport) ||
+        desc->resourceSize != sizeof(OvResource) || !desc->create) {
+        ov_dlclose(lib);
+        return;
+    }
+    slot->create = desc->create;    /* the module stays loaded for the process */
+}
+
+static ViStatus unsupported_open(OvTransport *self, const OvResource *rsrc, ViUInt32 timeout) {
+    (void)self; (void)rsrc; (void)timeout;
+    return VI_ERROR_NSUP_OPER;
+}
+
+/* Transport of a plugin slot, loading its module on first use; a module
+ * that is missing or built for another ABI yields VI_ERROR_NSUP_OPER at open */
+static OvTransport *plugin_create(OvIntfType type) {
+    ov_mutex_lock(&g_plugin_lock);
+    int i = plugin_slot(type);
+    OvTransport *(*create)(void) = NULL;
+    if (i >= 0) {
+        if (!g_plugins[i].tried) plugin_load(&g_plugins[i]);
+        create = g_plugins[i].create;
+    }
+    ov_mutex_unlock(&g_plugin_lock);
+    if (i < 0) return NULL;
+    if (create) return create();
+
+    OvTransport *t = (OvTransport *)calloc(1, sizeof(OvTransport));
+    if (t) t->open = unsupported_open;
+    return t;
+}
+
+int ov_plugin_match(const char *rsrcName, OvIntfType *type) {
+    int len = 0;
+    ov_mutex_lock(&g_plugin_lock);
+    for (int i = 3; i < g_nplugins && !len; i++) {
+        size_t n = strlen(g_plugins[i].prefix);
+        if (strlen(rsrcName) < n || !prefix_eq(rsrcName, g_plugins[i].prefix, n)) continue;
+        const char *p = rsrcName + n;
+        while (isdigit((unsigned char)*p)) p++;
+        if (strncmp(p, "::", 2) != 0) continue;
+        *type = (OvIntfType)(OV_INTF_PLUGIN + i);
+        len = (int)n;
+    }
+    ov_mutex_unlock(&g_plugin_lock);
+    return len;
+}
+
+ViStatus _VI_FUNC ovTransportRegister(ViConstString prefix, ViConstString library) {
+    static const char *core[] = { "TCPIP", "SIM", "PROXY", "SHM", "UNIX", "visa", NULL };
+    if (!prefix || !library || !*library) return VI_ERROR_INV_SETUP;
+    size_t n = strlen(prefix);
+    if (n == 0 || n >= OV_PREFIX_SIZE || strlen(library) >= sizeof(g_plugins[0].library))
+        return VI_ERROR_INV_SETUP;
+    for (size_t k = 0; k < n; k++)
+        if (!isalpha((unsigned char)prefix[k])) return VI_ERROR_INV_SETUP;
+    for (int k = 0; core[k]; k++)
+        if (strlen(core[k]) == n && prefix_eq(prefix, core[k], n)) return VI_ERROR_INV_SETUP;
+
+    ViStatus st = VI_SUCCESS;
+    ov_mutex_lock(&g_plugin_lock);
+    int i = 0;
+    while (i < g_nplugins && !(strlen(g_plugins[i].prefix) == n && prefix_eq(g_plugins[i].prefix, prefix, n)))
+        i++;
+    if (i == g_nplugins) {
+        if (g_nplugins == OV_MAX_PLUGINS) {
+            st = VI_ERROR_ALLOC;
+        } else {
+            g_nplugins++;
+            memcpy(g_plugins[i].prefix, prefix, n + 1);
+        }
+    }
+    if (st == VI_SUCCESS) {         /* (re)point the slot; loaded on next use */
+        snprintf(g_plugins[i].library, sizeof(g_plugins[i].library), "%s", library);
+        g_plugins[i].tried = false;
+        g_plugins[i].create = NULL;
+    }
+    ov_mutex_unlock(&g_plugin_lock);
+    return st;
+}
 
 /*
  * ov_transport_create_for_rsrc
@@ -32,17 +235,30 @@ OvTransport* ov_transport_create_for_rsrc(const OvResource *rsrc) {
             /* Default INSTR mode → VXI-11 (standard VISA behavior) */
             return ov_transport_tcpip_vxi11_create();
 
-        case OV_INTF_USB:
-            return ov_transport_usbtmc_create();
-
         case OV_INTF_ASRL:
-            return ov_transport_serial_create();
+            /* TCPIP::host::port::ASRL: serial port behind a terminal server */
+            if (ov_rsrc_host(rsrc)[0])
+                return ov_transport_rfc2217_create();
+            return plugin_create(rsrc->intfType);
+
+        case OV_INTF_SIM:
+            return ov_transport_sim_create();
+
+        case OV_INTF_PROXY:
+            return ov_transport_proxy_create();
+
+        case OV_INTF_REMOTE:
+            return ov_transport_remote_create();
+
+        case OV_INTF_UNIX:
+            return ov_transport_unix_create();
 
-        case OV_INTF_GPIB:
-            return ov_transport_gpib_create();
+        case OV_INTF_SHM:
+            return ov_transport_shm_create();
 
         default:
-            return NULL;
+            /* USB, GPIB and ovTransportRegister prefixes */
+            return plugin_create(rsrc->intfType);
     }
 }
 
@@ -52,9 +268,11 @@ OvTransport* ov_transport_create_for_rsrc(const OvResource *rsrc) {
 OvTransport* ov_transport_create(OvIntfType type) {
     switch (type) {
         case OV_INTF_TCPIP:  return ov_transport_tcpip_vxi11_create();
-        case OV_INTF_USB:    return ov_transport_usbtmc_create();
-        case OV_INTF_ASRL:   return ov_transport_serial_create();
-        case OV_INTF_GPIB:   return ov_transport_gpib_create();
-        default:             return NULL;
+        case OV_INTF_SIM:    return ov_transport_sim_create();
+        case OV_INTF_PROXY:  return ov_transport_proxy_create();
+        case OV_INTF_REMOTE: return ov_transport_remote_create();
+        case OV_INTF_UNIX:   return ov_transport_unix_create();
+        case OV_INTF_SHM:    return ov_transport_shm_create();
+        default:             return plugin_create(type);
     }
 }
@@ -11,6 +11,7 @@
  */
 
 #include "../core/session.h"
+#include "../core/plugin.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -27,6 +28,7 @@
 #define USBTMC_MSGID_VENDOR_SPECIFIC_OUT        126
 #define USBTMC_MSGID_REQUEST_VENDOR_SPECIFIC_IN 127
 #define USBTMC_MSGID_VENDOR_SPECIFIC_IN         127
+#define USB488_MSGID_TRIGGER                    128
 
 /* bmTransferAttributes flags */
 #define USBTMC_TRANSFER_EOM         0x01  /* DEV_DEP_MSG_OUT: End-of-Message */
@@ -123,6 +125,8 @@ typedef struct {
     uint8_t  ren_control;    /* USB488: REN_CONTROL supported */
     uint8_t  trigger;        /* USB488: TRIGGER supported */
     uint8_t  read_stb_cap;   /* USB488: READ_STATUS_BYTE supported */
+
+    UsbtmcHeader trig_hdr;   /* armed USB488 TRIGGER message */
 } UsbtmcImpl;
 
 /* -------------------------------------------------------------------------
@@ -260,14 +264,14 @@ static ViStatus usbtmc_open(OvTransport *self, const OvResource *rsrc, ViUInt32
             continue;
 
         /* Match serial number (if specified) */
-        if (rsrc->usbSerial[0] != '\0') {
+        if (ov_rsrc_usb_serial(rsrc)[0] != '\0') {
             char serial_buf[256] = {0};
             if (desc.iSerialNumber) {
                 libusb_get_string_descriptor_ascii(
                     h, desc.iSerialNumber,
                     (unsigned char *)serial_buf, sizeof(serial_buf));
             }
-            if (strcmp(serial_buf, rsrc->usbSerial) != 0) {
+            if (strcmp(serial_buf, ov_rsrc_usb_serial(rsrc)) != 0) {
                 libusb_close(h);
                 continue;
             }
@@ -645,6 +649,46 @@ static ViStatus usbtmc_clear(OvTransport *self) {
     return VI_SUCCESS;
 }
 
+/* -------------------------------------------------------------------------
+ * trigger — USB488 TRIGGER (Bulk-OUT, header only, no response)
+ * ------------------------------------------------------------------------- */
+static ViStatus usbtmc_trigger_arm(OvTransport *self, OvTransport *const peers[],
+                                   ViUInt32 npeers, ViUInt32 *leader)
+{
+    UsbtmcImpl *impl = (UsbtmcImpl *)self->impl;
+    (void)peers; (void)npeers; (void)leader;
+    if (!impl->dev) return VI_ERROR_CONN_LOST;
+    if (!impl->usb488_if || !impl->trigger) return VI_ERROR_NSUP_OPER;
+
+    usbtmc_build_header(&impl->trig_hdr, USB488_MSGID_TRIGGER,
+                        usbtmc_next_tag(impl), 0, 0, 0x00);
+    return VI_SUCCESS;
+}
+
+static ViStatus usbtmc_trigger_fire(OvTransport *self)
+{
+    UsbtmcImpl *impl = (UsbtmcImpl *)self->impl;
+    int transferred = 0;
+    int rc = libusb_bulk_transfer(impl->dev, impl->ep_bulk_out,
+                                  (unsigned char *)&impl->trig_hdr, USBTMC_HEADER_SIZE,
+                                  &transferred, USBTMC_DEFAULT_TIMEOUT_MS);
+    return (rc < 0 || transferred != USBTMC_HEADER_SIZE) ? VI_ERROR_IO : VI_SUCCESS;
+}
+
+static ViStatus usbtmc_trigger_done(OvTransport *self, ViUInt32 timeout)
+{
+    (void)self; (void)timeout;
+    return VI_SUCCESS;
+}
+
+/* A USBTMC-USB488 device drops an unread response when the next query
+ * arrives (488.2 Query INTERRUPTED) */
+static ViUInt32 usbtmc_max_pending(OvTransport *self)
+{
+    (void)self;
+    return 1;
+}
+
 /* =========================================================================
  * Factory — libusb available
  * ========================================================================= */
@@ -663,6 +707,10 @@ OvTransport* ov_transport_usbtmc_create(void) {
     t->write   = usbtmc_write;
     t->readSTB = usbtmc_readSTB;
     t->clear   = usbtmc_clear;
+    t->maxPending  = usbtmc_max_pending;
+    t->triggerArm  = usbtmc_trigger_arm;
+    t->triggerFire = usbtmc_trigger_fire;
+    t->triggerDone = usbtmc_trigger_done;
 
     return t;
 }
@@ -727,3 +775,5 @@ OvTransport* ov_transport_usbtmc_create(void) {
 }
 
 #endif  /* HAVE_LIBUSB */
+
+OV_TRANSPORT_PLUGIN(ov_transport_usbtmc_create)
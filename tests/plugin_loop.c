@@ -0,0 +1,71 @@
+/*
+ * OpenVISA - Loopback transport plugin for test_plugin
+ *
+ * LOOP::<name>: a read returns what the last write sent.  Built twice: as
+ * ovt_testloop and, with LOOP_BAD_ABI, as a module claiming another ABI.
+ */
+
+#include "core/plugin.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    ViByte   buf[256];
+    ViUInt32 len;
+} LoopImpl;
+
+static ViStatus loop_open(OvTransport *self, const OvResource *rsrc, ViUInt32 timeout) {
+    (void)timeout;
+    if (strcmp(ov_rsrc_device(rsrc), "broken") == 0) return VI_ERROR_RSRC_NFOUND;
+    self->impl = calloc(1, sizeof(LoopImpl));
+    return self->impl ? VI_SUCCESS : VI_ERROR_ALLOC;
+}
+
+static ViStatus loop_close(OvTransport *self) {
+    free(self->impl);
+    self->impl = NULL;
+    return VI_SUCCESS;
+}
+
+static ViStatus loop_write(OvTransport *self, ViBuf buf, ViUInt32 count, ViUInt32 *retCount) {
+    LoopImpl *impl = (LoopImpl *)self->impl;
+    if (count > sizeof(impl->buf)) count = sizeof(impl->buf);
+    memcpy(impl->buf, buf, count);
+    impl->len = count;
+    if (retCount) *retCount = count;
+    return VI_SUCCESS;
+}
+
+static ViStatus loop_read(OvTransport *self, ViBuf buf, ViUInt32 count,
+                          ViUInt32 *retCount, ViUInt32 timeout) {
+    LoopImpl *impl = (LoopImpl *)self->impl;
+    (void)timeout;
+    if (impl->len == 0) return VI_ERROR_TMO;
+    ViUInt32 n = impl->len < count ? impl->len : count;
+    memcpy(buf, impl->buf, n);
+    impl->len = 0;
+    if (retCount) *retCount = n;
+    return VI_SUCCESS;
+}
+
+static OvTransport *loop_create(void) {
+    OvTransport *t = (OvTransport *)calloc(1, sizeof(OvTransport));
+    if (!t) return NULL;
+    t->open  = loop_open;
+    t->close = loop_close;
+    t->read  = loop_read;
+    t->write = loop_write;
+    return t;
+}
+
+#ifdef LOOP_BAD_ABI
+OV_PLUGIN_EXPORT const OvTransportPlugin *ov_transport_plugin(void);
+const OvTransportPlugin *ov_transport_plugin(void) {
+    static const OvTransportPlugin desc = {
+        OV_PLUGIN_ABI + 1, sizeof(OvTransport), sizeof(OvResource), loop_create
+    };
+    return &desc;
+}
+#else
+OV_TRANSPORT_PLUGIN(loop_create)
+#endif
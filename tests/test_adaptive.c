@@ -0,0 +1,217 @@
+/*
+ * OpenVISA - Adaptive timeout tests
+ *
+ * A loopback raw-socket instrument answers FAST? after 1 ms (g_fast_ms
+ * while that is set) and SLOW? after 100 ms.  BLOCK? sends a block
+ * header at once and its data g_block_delay_ms later.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "visa.h"
+#include "openvisa.h"
+#include "testutil.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define USER_TMO_MS     5000
+#define TABLE_FILE      "test_adaptive_table.txt"
+
+static ViSession g_rm;
+static char g_rsrc[64];
+static volatile int g_fast_ms;
+static volatile int g_block_delay_ms;
+
+static void *instr_conn(void *arg) {
+    int c = (int)(intptr_t)arg;
+    char line[256];
+    size_t len = 0;
+    char buf[256];
+    ssize_t n;
+    while ((n = recv(c, buf, sizeof(buf), 0)) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] != '\n') {
+                if (len < sizeof(line) - 1) line[len++] = buf[i];
+                continue;
+            }
+            line[len] = '\0';
+            len = 0;
+            const char *cmd = line[0] == ':' ? line + 1 : line;
+            if (strcasecmp(cmd, "FAST?") == 0) {
+                usleep(g_fast_ms ? (useconds_t)g_fast_ms * 1000 : 1000);
+                send(c, "1\n", 2, MSG_NOSIGNAL);
+            } else if (strcasecmp(cmd, "SLOW?") == 0) {
+                usleep(100000);
+                send(c, "2\n", 2, MSG_NOSIGNAL);
+            } else if (strcasecmp(cmd, "BLOCK?") == 0) {
+                int delay = g_block_delay_ms;
+                if (delay == 0) {
+                    send(c, "#14DATA\n", 8, MSG_NOSIGNAL);
+                    continue;
+                }
+                send(c, "#14", 3, MSG_NOSIGNAL);
+                usleep((useconds_t)delay * 1000);
+                send(c, "DATA\n", 5, MSG_NOSIGNAL);
+            }
+        }
+    }
+    close(c);
+    return NULL;
+}
+
+static ViStatus query(ViSession vi, const char *cmd) {
+    char r[16];
+    ViUInt32 n;
+    ViStatus st = viWrite(vi, (ViBuf)cmd, (ViUInt32)strlen(cmd), &n);
+    if (st < VI_SUCCESS) return st;
+    return viRead(vi, (ViBuf)r, sizeof(r), &n);
+}
+
+static ViSession open_instr(void) {
+    ViSession vi = VI_NULL;
+    viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi);
+    viSetAttribute(vi, VI_ATTR_TMO_VALUE, USER_TMO_MS);
+    return vi;
+}
+
+static ViSession g_vi;
+
+void test_cold(void) {
+    TEST("Unlearned query keeps the session timeout");
+    g_vi = open_instr();
+    ViUInt32 tmo = 0, samples = 1;
+    if (ovAdaptiveTimeoutEnable(g_vi, 0, 0, 20) != VI_SUCCESS) { FAIL("enable"); return; }
+    ovAdaptiveTimeoutQuery(g_vi, "FAST?\n", &tmo, &samples);
+    if (tmo != USER_TMO_MS || samples != 0) { FAIL("learned from nothing"); return; }
+    if (ovAdaptiveTimeoutEnable(g_vi, 120, 0, 0) != VI_ERROR_INV_SETUP) { FAIL("bad percentile"); return; }
+    PASS();
+}
+
+void test_learn(void) {
+    TEST("Per-header timeouts learned from latency");
+    for (int i = 0; i < 20; i++) {
+        if (query(g_vi, i & 1 ? "FAST?\n" : ":fast?\n") < VI_SUCCESS) { FAIL("fast query"); return; }
+        if (i < 8 && query(g_vi, "SLOW?\n") < VI_SUCCESS) { FAIL("slow query"); return; }
+    }
+    ViUInt32 t_fast, t_slow, n_fast, n_slow;
+    ovAdaptiveTimeoutQuery(g_vi, "FAST?", &t_fast, &n_fast);
+    ovAdaptiveTimeoutQuery(g_vi, "SLOW?", &t_slow, &n_slow);
+    printf("(FAST? %u ms, SLOW? %u ms) ", (unsigned)t_fast, (unsigned)t_slow);
+    if (n_fast != 20 || n_slow != 8) { FAIL("sample count"); return; }
+    if (t_fast < 20 || t_fast >= t_slow) { FAIL("fast timeout"); return; }
+    if (t_slow < 400 || t_slow >= USER_TMO_MS) { FAIL("slow timeout"); return; }
+    PASS();
+}
+
+void test_hang(void) {
+    TEST("Hung fast query fails at its learned timeout");
+    ViUInt32 t_fast;
+    ovAdaptiveTimeoutQuery(g_vi, "FAST?", &t_fast, NULL);
+    /* Answered well inside the session timeout, but past the learned one */
+    g_fast_ms = (int)t_fast + 500;
+    char r[16];
+    ViUInt32 n = 0;
+    ViStatus st = query(g_vi, "FAST?\n");
+    ViStatus late = viRead(g_vi, (ViBuf)r, sizeof(r), &n);
+    g_fast_ms = 0;
+    if (st != VI_ERROR_TMO) { FAIL("session timeout used"); return; }
+    if (late < VI_SUCCESS || n != 2 || r[0] != '1') { FAIL("late answer lost"); return; }
+    if (query(g_vi, "SLOW?\n") < VI_SUCCESS) { FAIL("slow query cut short"); return; }
+    PASS();
+}
+
+void test_chunked(void) {
+    TEST("Later chunks of a response get the session TMO");
+    for (int i = 0; i < 10; i++) {
+        if (query(g_vi, "BLOCK?\n") < VI_SUCCESS) { FAIL("learn"); return; }
+    }
+    ViUInt32 learned, n;
+    ovAdaptiveTimeoutQuery(g_vi, "BLOCK?", &learned, NULL);
+    g_block_delay_ms = (int)learned + 100;
+    char r[16];
+    viWrite(g_vi, (ViBuf)"BLOCK?\n", 7, &n);
+    ViStatus s1 = viRead(g_vi, (ViBuf)r, 3, &n);
+    ViStatus s2 = viRead(g_vi, (ViBuf)r, sizeof(r), &n);
+    g_block_delay_ms = 0;
+    if (s1 < VI_SUCCESS) { FAIL("header"); return; }
+    if (s2 != VI_SUCCESS_TERM_CHAR || n != 5) { FAIL("data chunk timed out"); return; }
+    PASS();
+}
+
+void test_clear(void) {
+    TEST("viClear drops the responses still owed");
+    ViUInt32 n, before, after;
+    ovAdaptiveTimeoutQuery(g_vi, "FAST?", NULL, &before);
+    viWrite(g_vi, (ViBuf)"FAST?\n", 6, &n);       /* response never read */
+    usleep(20000);
+    ViStatus st = viClear(g_vi);
+    ViStatus sq = query(g_vi, "FAST?\n");
+    ovAdaptiveTimeoutQuery(g_vi, "FAST?", NULL, &after);
+    if (st != VI_SUCCESS || sq < VI_SUCCESS) { FAIL("clear"); return; }
+    if (after != before + 1) { FAIL("stopped learning"); return; }
+    PASS();
+}
+
+void test_bounded(void) {
+    TEST("Learned timeout never exceeds VI_ATTR_TMO_VALUE");
+    ViUInt32 tmo;
+    viSetAttribute(g_vi, VI_ATTR_TMO_VALUE, 10);
+    ovAdaptiveTimeoutQuery(g_vi, "SLOW?", &tmo, NULL);
+    viSetAttribute(g_vi, VI_ATTR_TMO_VALUE, USER_TMO_MS);
+    if (tmo != 10) { FAIL("exceeded"); return; }
+    PASS();
+}
+
+void test_export_import(void) {
+    TEST("Saved table starts a new session warm");
+    ViUInt32 t_before, n_before, t_after, n_after, t_cold;
+    ovAdaptiveTimeoutQuery(g_vi, "SLOW?", &t_before, &n_before);
+    ViStatus st = ovAdaptiveTimeoutSave(g_vi, TABLE_FILE);
+    viClose(g_vi);
+    if (st != VI_SUCCESS) { FAIL("save"); return; }
+
+    ViSession vi = open_instr();
+    ovAdaptiveTimeoutEnable(vi, 0, 0, 20);
+    ovAdaptiveTimeoutQuery(vi, "SLOW?", &t_cold, NULL);
+    st = ovAdaptiveTimeoutLoad(vi, TABLE_FILE);
+    ovAdaptiveTimeoutQuery(vi, "SLOW?", &t_after, &n_after);
+    int bad = ovAdaptiveTimeoutLoad(vi, "no-such-dir/table.txt") != VI_ERROR_FILE_ACCESS;
+    viClose(vi);
+    remove(TABLE_FILE);
+    if (st != VI_SUCCESS || bad) { FAIL("load"); return; }
+    if (t_cold != USER_TMO_MS || t_after != t_before || n_after != n_before) { FAIL("table differs"); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA Adaptive Timeout Tests ===\n\n");
+    signal(SIGPIPE, SIG_IGN);
+    unsetenv("OPENVISA_BROKER");
+
+    serve_socket(instr_conn, g_rsrc, sizeof(g_rsrc));
+
+    viOpenDefaultRM(&g_rm);
+    test_cold();
+    test_learn();
+    test_hang();
+    test_chunked();
+    test_clear();
+    test_bounded();
+    test_export_import();
+    viClose(g_rm);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,197 @@
+/*
+ * OpenVISA - Resource alias and parse cache tests
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "visa.h"
+#include "openvisa.h"
+#include "core/session.h"
+#include "testutil.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define ALIAS_FILE  "test_alias_visaconf.ini"
+#define PARSES      100000
+
+static const char *VISACONF =
+    "; written by test_alias\n"
+    "[GENERAL]\n"
+    "scope = not an alias\n"
+    "\n"
+    "[ALIASES]\n"
+    "NumAliases = 2\n"
+    "Alias0 = \"'dmm','GPIB::22::INSTR'\"\n"
+    "Alias1 = \"'bench','SIM::aliased::INSTR'\"\n"
+    "scope  = TCPIP0::192.168.1.20::hislip0::INSTR   \n"
+    "# comment\n"
+    "psu = TCPIP::10.0.0.5::5025::SOCKET\n"
+    "\n"
+    "[OTHER]\n"
+    "ignored = GPIB0::1::INSTR\n";
+
+static ViSession g_rm;
+
+static ViStatus parse_ex(const char *name, ViUInt16 *type, char *cls, char *expanded, char *alias) {
+    ViUInt16 num;
+    return viParseRsrcEx(g_rm, (ViRsrc)name, type, &num, cls, expanded, alias);
+}
+
+void test_load(void) {
+    TEST("Alias file loads; missing file reported");
+    FILE *f = fopen(ALIAS_FILE, "w");
+    if (!f) { FAIL("cannot write alias file"); return; }
+    fputs(VISACONF, f);
+    fclose(f);
+    if (ovAliasLoad("no-such-dir/visaconf.ini") != VI_ERROR_FILE_ACCESS) { FAIL("missing accepted"); return; }
+    if (ovAliasLoad(ALIAS_FILE) != VI_SUCCESS) { FAIL("load"); return; }
+    PASS();
+}
+
+void test_plain_alias(void) {
+    TEST("name = resource alias expands");
+    ViUInt16 type = 0;
+    char cls[OV_DESC_SIZE], exp[OV_DESC_SIZE], alias[OV_DESC_SIZE];
+    if (parse_ex("scope", &type, cls, exp, alias) != VI_SUCCESS) { FAIL("parse"); return; }
+    if (type != VI_INTF_TCPIP || strcmp(cls, "INSTR") != 0 ||
+        strcmp(exp, "TCPIP0::192.168.1.20::hislip0::INSTR") != 0 || strcmp(alias, "scope") != 0) {
+        FAIL(exp); return;
+    }
+    PASS();
+}
+
+void test_ni_alias(void) {
+    TEST("NI AliasN form, case-insensitive name");
+    ViUInt16 type = 0;
+    char cls[OV_DESC_SIZE], exp[OV_DESC_SIZE], alias[OV_DESC_SIZE];
+    if (parse_ex("DMM", &type, cls, exp, alias) != VI_SUCCESS) { FAIL("parse"); return; }
+    if (type != VI_INTF_GPIB || strcmp(exp, "GPIB0::22::INSTR") != 0 || strcmp(alias, "dmm") != 0) {
+        FAIL(exp); return;
+    }
+    PASS();
+}
+
+void test_reverse_alias(void) {
+    TEST("Full name reports the alias that names it");
+    char cls[OV_DESC_SIZE], exp[OV_DESC_SIZE], alias[OV_DESC_SIZE];
+    ViUInt16 type;
+    if (parse_ex("gpib0::22::instr", &type, cls, exp, alias) != VI_SUCCESS) { FAIL("parse"); return; }
+    if (strcmp(alias, "dmm") != 0) { FAIL("no alias"); return; }
+    if (parse_ex("TCPIP::10.0.0.5::5025::SOCKET", &type, cls, exp, alias) != VI_SUCCESS) { FAIL("parse"); return; }
+    if (strcmp(alias, "psu") != 0 || strcmp(cls, "SOCKET") != 0) { FAIL("socket"); return; }
+    PASS();
+}
+
+void test_no_alias(void) {
+    TEST("Unaliased resource: empty alias, expanded name");
+    char cls[OV_DESC_SIZE], exp[OV_DESC_SIZE], alias[OV_DESC_SIZE] = "x";
+    ViUInt16 type;
+    if (parse_ex("USB::0x0957::0x1796::MY123::INSTR", &type, cls, exp, alias) != VI_SUCCESS) { FAIL("parse"); return; }
+    if (alias[0] || strcmp(exp, "USB0::0x0957::0x1796::MY123::INSTR") != 0) { FAIL(exp); return; }
+    if (parse_ex("ignored", &type, cls, exp, alias) != VI_ERROR_INV_RSRC_NAME) { FAIL("other section"); return; }
+    PASS();
+}
+
+void test_open_alias(void) {
+    TEST("viOpen through an alias");
+    ViSession vi;
+    if (viOpen(g_rm, "bench", VI_NULL, VI_NULL, &vi) != VI_SUCCESS) { FAIL("open"); return; }
+    char name[OV_DESC_SIZE];
+    ViUInt32 n;
+    char idn[64];
+    ViStatus st = viGetAttribute(vi, VI_ATTR_RSRC_NAME, name);
+    if (st == VI_SUCCESS) st = viWrite(vi, (ViBuf)"*IDN?\n", 6, &n);
+    if (st == VI_SUCCESS) st = viRead(vi, (ViBuf)idn, sizeof(idn) - 1, &n);
+    viClose(vi);
+    if (st < VI_SUCCESS || strcmp(name, "SIM::aliased::INSTR") != 0) { FAIL(name); return; }
+    idn[n] = '\0';
+    if (strncmp(idn, "OpenVISA,ALIAS", 14) != 0) { FAIL(idn); return; }
+    PASS();
+}
+
+void test_cache_hits(void) {
+    TEST("Repeated parse served from the cache");
+    ViUInt32 h0, m0, h1, m1;
+    ViUInt16 type, num;
+    ov_rsrc_cache_stats(&h0, &m0);
+    double t0 = now_us();
+    for (int i = 0; i < PARSES; i++) viParseRsrc(g_rm, "scope", &type, &num);
+    double t_cached = (now_us() - t0) * 1000 / PARSES;
+    ov_rsrc_cache_stats(&h1, &m1);
+
+    t0 = now_us();
+    for (int i = 0; i < PARSES; i++) {
+        OvResource r;
+        ov_parse_rsrc("TCPIP0::192.168.1.20::hislip0::INSTR", &r);
+        ov_rsrc_release(&r);
+    }
+    double t_parse = (now_us() - t0) * 1000 / PARSES;
+    printf("(%.0f ns cached, %.0f ns parsed) ", t_cached, t_parse);
+    if (h1 - h0 != PARSES || m1 != m0) { FAIL("cache missed"); return; }
+    PASS();
+}
+
+void test_lru(void) {
+    TEST("Least recently used entry evicted");
+    ViUInt32 h0, m0, h1, m1;
+    ViUInt16 type, num;
+    char name[64];
+    viParseRsrc(g_rm, "scope", &type, &num);
+    for (int i = 0; i < 64; i++) {
+        snprintf(name, sizeof(name), "GPIB0::%d::INSTR", i);
+        viParseRsrc(g_rm, name, &type, &num);
+        viParseRsrc(g_rm, "dmm", &type, &num);         /* kept hot */
+    }
+    ov_rsrc_cache_stats(&h0, &m0);
+    viParseRsrc(g_rm, "dmm", &type, &num);
+    viParseRsrc(g_rm, "scope", &type, &num);
+    ov_rsrc_cache_stats(&h1, &m1);
+    if (h1 - h0 != 1 || m1 - m0 != 1) { FAIL("wrong entry evicted"); return; }
+    PASS();
+}
+
+void test_reload(void) {
+    TEST("Reload drops old aliases and cached parses");
+    FILE *f = fopen(ALIAS_FILE, "w");
+    if (!f) { FAIL("cannot write alias file"); return; }
+    fputs("[aliases]\nscope = TCPIP0::192.168.1.21::INSTR\n", f);
+    fclose(f);
+    if (ovAliasLoad(ALIAS_FILE) != VI_SUCCESS) { FAIL("load"); return; }
+    remove(ALIAS_FILE);
+    ViUInt16 type;
+    char cls[OV_DESC_SIZE], exp[OV_DESC_SIZE], alias[OV_DESC_SIZE];
+    if (parse_ex("scope", &type, cls, exp, alias) != VI_SUCCESS ||
+        strcmp(exp, "TCPIP0::192.168.1.21::inst0::INSTR") != 0) { FAIL(exp); return; }
+    if (parse_ex("dmm", &type, cls, exp, alias) != VI_ERROR_INV_RSRC_NAME) { FAIL("old alias kept"); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA Alias Tests ===\n\n");
+
+    ovSimDefine("aliased", "[commands]\n*IDN? = \"OpenVISA,ALIAS,0,1.0\"\n");
+    viOpenDefaultRM(&g_rm);
+
+    test_load();
+    test_plain_alias();
+    test_ni_alias();
+    test_reverse_alias();
+    test_no_alias();
+    test_open_alias();
+    test_cache_hits();
+    test_lru();
+    test_reload();
+
+    viClose(g_rm);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,222 @@
+/*
+ * OpenVISA - Asynchronous I/O and I/O completion event tests
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "visa.h"
+#include "openvisa.h"
+#include "core/thread.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define NDEV        20
+
+static const char *SIM_DEF =
+    "[commands]\n"
+    "*IDN?  = \"OpenVISA,ASYNC,0,1.0\"\n"
+    "SLOW?  = \"42\" delay 50\n";
+
+static ViSession g_rm;
+
+static ViSession open_sim(void) {
+    ViSession vi = VI_NULL;
+    viOpen(g_rm, "SIM::async::INSTR", VI_NULL, VI_NULL, &vi);
+    return vi;
+}
+
+/* Next queued completion of vi: its job id and status */
+static ViStatus next_completion(ViSession vi, ViJobId *job, ViStatus *status, ViUInt32 *count) {
+    ViEventType type;
+    ViEvent ev;
+    ViStatus st = viWaitOnEvent(vi, VI_EVENT_IO_COMPLETION, 2000, &type, &ev);
+    if (st != VI_SUCCESS) return st;
+    viGetAttribute(ev, VI_ATTR_JOB_ID, job);
+    viGetAttribute(ev, VI_ATTR_STATUS, status);
+    if (count) viGetAttribute(ev, VI_ATTR_RET_COUNT, count);
+    return viClose(ev);
+}
+
+void test_queue(void) {
+    TEST("Completions queued in order with their results");
+    ViSession vi = open_sim();
+    char buf[64] = { 0 };
+    ViJobId jw, jr;
+    viEnableEvent(vi, VI_EVENT_IO_COMPLETION, VI_QUEUE, VI_NULL);
+    ViStatus st = viWriteAsync(vi, (ViBuf)"*IDN?\n", 6, &jw);
+    if (st == VI_SUCCESS) st = viReadAsync(vi, (ViBuf)buf, sizeof(buf) - 1, &jr);
+    if (st != VI_SUCCESS || jw == VI_NULL || jw == jr) { viClose(vi); FAIL("submit"); return; }
+
+    ViEventType type = 0;
+    ViEvent ev;
+    ViJobId job = 0;
+    ViStatus status = 0;
+    ViUInt32 count = 0;
+    ViBuf data = NULL;
+    char oper[32] = "";
+    int ok = next_completion(vi, &job, &status, &count) == VI_SUCCESS && job == jw && status == VI_SUCCESS && count == 6;
+    ok = ok && viWaitOnEvent(vi, VI_ALL_ENABLED_EVENTS, 2000, &type, &ev) == VI_SUCCESS && type == VI_EVENT_IO_COMPLETION;
+    if (ok) {
+        viGetAttribute(ev, VI_ATTR_JOB_ID, &job);
+        viGetAttribute(ev, VI_ATTR_STATUS, &status);
+        viGetAttribute(ev, VI_ATTR_RET_COUNT, &count);
+        viGetAttribute(ev, VI_ATTR_BUFFER, &data);
+        viGetAttribute(ev, VI_ATTR_OPER_NAME, oper);
+        ok = job == jr && status >= VI_SUCCESS && data == (ViBuf)buf && count == 21 &&
+             strncmp(buf, "OpenVISA,ASYNC", 14) == 0 && strcmp(oper, "viReadAsync") == 0;
+        ok = ok && viClose(ev) == VI_SUCCESS && viGetAttribute(ev, VI_ATTR_STATUS, &status) == VI_ERROR_INV_OBJECT;
+    }
+    ok = ok && viWaitOnEvent(vi, VI_EVENT_IO_COMPLETION, 0, &type, &ev) == VI_ERROR_TMO;
+    viClose(vi);
+    if (!ok) { FAIL("events"); return; }
+    PASS();
+}
+
+/* Each session's write completion waits here for every other session's:
+ * all of them get through only if the sessions run at the same time */
+static OvMutex g_bar_lock = OV_MUTEX_INIT;
+static OvCond  g_bar;
+static int     g_arrived, g_met;
+
+static ViStatus on_arrive(ViSession vi, ViEventType type, ViEvent ctx, ViAddr user) {
+    (void)vi; (void)type; (void)user;
+    char oper[32] = "";
+    viGetAttribute(ctx, VI_ATTR_OPER_NAME, oper);
+    if (strcmp(oper, "viWriteAsync") != 0) return VI_SUCCESS;
+    ov_mutex_lock(&g_bar_lock);
+    g_arrived++;
+    ov_cond_broadcast(&g_bar);
+    while (g_arrived < NDEV && ov_cond_timedwait(&g_bar, &g_bar_lock, 2000)) {}
+    g_met += g_arrived == NDEV;
+    ov_mutex_unlock(&g_bar_lock);
+    return VI_SUCCESS;
+}
+
+void test_concurrent(void) {
+    TEST("Sessions complete concurrently");
+    ViSession vi[NDEV];
+    char buf[NDEV][16];
+    ov_cond_init(&g_bar);
+    for (int i = 0; i < NDEV; i++) {
+        vi[i] = open_sim();
+        viInstallHandler(vi[i], VI_EVENT_IO_COMPLETION, on_arrive, VI_NULL);
+        viEnableEvent(vi[i], VI_EVENT_IO_COMPLETION, VI_QUEUE | VI_HNDLR, VI_NULL);
+    }
+    for (int i = 0; i < NDEV; i++) {
+        viWriteAsync(vi[i], (ViBuf)"SLOW?\n", 6, VI_NULL);
+        viReadAsync(vi[i], (ViBuf)buf[i], sizeof(buf[i]), VI_NULL);
+    }
+    int ok = 1;
+    for (int i = 0; i < NDEV; i++) {
+        for (int k = 0; k < 2; k++) {
+            ViJobId job;
+            ViStatus status;
+            ok = ok && next_completion(vi[i], &job, &status, NULL) == VI_SUCCESS && status >= VI_SUCCESS;
+        }
+        ok = ok && strncmp(buf[i], "42", 2) == 0;
+    }
+    for (int i = 0; i < NDEV; i++) viClose(vi[i]);
+    printf("(%d of %d together) ", g_met, NDEV);
+    if (!ok) { FAIL("completions"); return; }
+    if (g_met != NDEV) { FAIL("serialized"); return; }
+    PASS();
+}
+
+static volatile int g_calls;
+static volatile ViStatus g_status;
+
+static ViStatus on_complete(ViSession vi, ViEventType type, ViEvent ctx, ViAddr user) {
+    (void)vi;
+    ViStatus st;
+    ViUInt32 count;
+    viGetAttribute(ctx, VI_ATTR_STATUS, &st);
+    viGetAttribute(ctx, VI_ATTR_RET_COUNT, &count);
+    if (type == VI_EVENT_IO_COMPLETION && user == &g_calls && count > 0) g_status = st;
+    g_calls++;
+    return VI_SUCCESS;
+}
+
+void test_handler(void) {
+    TEST("Handler called per completion");
+    ViSession vi = open_sim();
+    char buf[16];
+    int ok = viEnableEvent(vi, VI_EVENT_IO_COMPLETION, VI_HNDLR, VI_NULL) == VI_ERROR_HNDLR_NINSTALLED &&
+             viInstallHandler(vi, VI_EVENT_IO_COMPLETION, on_complete, (ViAddr)&g_calls) == VI_SUCCESS &&
+             viEnableEvent(vi, VI_EVENT_IO_COMPLETION, VI_HNDLR, VI_NULL) == VI_SUCCESS;
+    viWriteAsync(vi, (ViBuf)"SLOW?\n", 6, VI_NULL);
+    viReadAsync(vi, (ViBuf)buf, sizeof(buf), VI_NULL);
+    for (int i = 0; i < 200 && g_calls < 2; i++) ov_sleep_ms(5);
+    ok = ok && g_calls == 2 && g_status >= VI_SUCCESS;
+    ok = ok && viUninstallHandler(vi, VI_EVENT_IO_COMPLETION, on_complete, (ViAddr)&g_calls) == VI_SUCCESS &&
+         viUninstallHandler(vi, VI_EVENT_IO_COMPLETION, on_complete, (ViAddr)&g_calls) == VI_ERROR_INV_HNDLR_REF;
+    viClose(vi);
+    if (!ok) { FAIL("handler"); return; }
+    PASS();
+}
+
+void test_terminate(void) {
+    TEST("viTerminate aborts a queued job");
+    ViSession vi = open_sim();
+    char a[16], b[16];
+    ViJobId j1, j2, j3;
+    viEnableEvent(vi, VI_EVENT_IO_COMPLETION, VI_QUEUE, VI_NULL);
+    viWriteAsync(vi, (ViBuf)"SLOW?\n", 6, &j1);
+    viReadAsync(vi, (ViBuf)a, sizeof(a), &j2);
+    viReadAsync(vi, (ViBuf)b, sizeof(b), &j3);
+    ViStatus st = viTerminate(vi, 0, j3);
+    ViJobId job[3];
+    ViStatus status[3];
+    int ok = st == VI_SUCCESS;
+    for (int i = 0; i < 3; i++) ok = ok && next_completion(vi, &job[i], &status[i], NULL) == VI_SUCCESS;
+    ok = ok && job[0] == j1 && job[1] == j2 && job[2] == j3 &&
+         status[1] >= VI_SUCCESS && status[2] == VI_ERROR_ABORT &&
+         viTerminate(vi, 0, j3) == VI_ERROR_INV_JOB_ID;
+    viClose(vi);
+    if (!ok) { FAIL("not aborted"); return; }
+    PASS();
+}
+
+void test_close_pending(void) {
+    TEST("viClose with jobs pending");
+    ViSession vi = open_sim();
+    char buf[16];
+    viEnableEvent(vi, VI_EVENT_IO_COMPLETION, VI_QUEUE, VI_NULL);
+    viWriteAsync(vi, (ViBuf)"SLOW?\n", 6, VI_NULL);
+    viReadAsync(vi, (ViBuf)buf, sizeof(buf), VI_NULL);
+    ov_sleep_ms(10);
+    ViStatus st = viClose(vi);
+    ViEventType type;
+    ViEvent ev;
+    int ok = st == VI_SUCCESS &&
+             viWaitOnEvent(vi, VI_EVENT_IO_COMPLETION, 0, &type, &ev) == VI_ERROR_INV_OBJECT &&
+             viReadAsync(vi, (ViBuf)buf, sizeof(buf), VI_NULL) == VI_ERROR_INV_OBJECT;
+    vi = open_sim();
+    ok = ok && viWaitOnEvent(vi, VI_EVENT_IO_COMPLETION, 0, &type, &ev) == VI_ERROR_NENABLED;
+    viClose(vi);
+    if (!ok) { FAIL("close"); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA Async I/O Tests ===\n\n");
+
+    ovSimDefine("async", SIM_DEF);
+    viOpenDefaultRM(&g_rm);
+    test_queue();
+    test_concurrent();
+    test_handler();
+    test_terminate();
+    test_close_pending();
+    viClose(g_rm);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
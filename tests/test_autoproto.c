@@ -0,0 +1,223 @@
+/*
+ * OpenVISA - HiSLIP / VXI-11 auto-selection (ovAutoProtocol*) tests
+ *
+ * Instruments live on their own loopback addresses, so they can listen on
+ * the real ports: 127.0.0.42 has a HiSLIP server on 4880 and a portmapper
+ * on 111, 127.0.0.43 only the portmapper.  The portmappers never answer an
+ * RPC, so a VXI-11 open times out; they count the connections they get.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "visa.h"
+#include "openvisa.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static ViSession g_rm;
+static volatile uint32_t g_hislip_conns, g_mapper42_conns, g_mapper43_conns;
+
+static int recv_all(int c, uint8_t *buf, size_t len) {
+    while (len) {
+        ssize_t n = recv(c, buf, len, 0);
+        if (n <= 0) return -1;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static void send_hdr(int c, uint8_t type, uint32_t param) {
+    uint8_t h[16] = { 'H', 'S', type, 0,
+                      (uint8_t)(param >> 24), (uint8_t)(param >> 16), (uint8_t)(param >> 8), (uint8_t)param };
+    send(c, h, sizeof(h), MSG_NOSIGNAL);
+}
+
+/* Initialize -> InitializeResponse, AsyncInitialize -> response */
+static void *hislip_conn(void *arg) {
+    int c = (int)(intptr_t)arg;
+    uint8_t h[16], skip[256];
+    while (recv_all(c, h, sizeof(h)) == 0) {
+        uint64_t len = 0;
+        for (int i = 8; i < 16; i++) len = (len << 8) | h[i];
+        while (len) {
+            size_t n = len < sizeof(skip) ? (size_t)len : sizeof(skip);
+            if (recv_all(c, skip, n) != 0) goto done;
+            len -= n;
+        }
+        if (h[2] == 0) send_hdr(c, 1, (1u << 24) | 1);
+        else if (h[2] == 17) send_hdr(c, 18, 0);
+    }
+done:
+    close(c);
+    return NULL;
+}
+
+/* Takes the connection and reads until the client goes */
+static void *mute_conn(void *arg) {
+    int c = (int)(intptr_t)arg;
+    uint8_t buf[256];
+    while (recv(c, buf, sizeof(buf), 0) > 0) {}
+    close(c);
+    return NULL;
+}
+
+typedef struct {
+    int ls;
+    volatile uint32_t *count;
+    void *(*conn)(void *);
+} Server;
+
+static void *server(void *arg) {
+    Server *srv = (Server *)arg;
+    for (;;) {
+        int c = accept(srv->ls, NULL, NULL);
+        if (c < 0) return NULL;
+        __sync_fetch_and_add(srv->count, 1);
+        pthread_t th;
+        pthread_create(&th, NULL, srv->conn, (void*)(intptr_t)c);
+        pthread_detach(th);
+    }
+}
+
+static int start_server(Server *srv, const char *ip, int port, volatile uint32_t *count,
+                        void *(*conn)(void *)) {
+    int ls = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(ls, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons((uint16_t)port) };
+    inet_pton(AF_INET, ip, &addr.sin_addr);
+    if (bind(ls, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(ls, 16) != 0) {
+        close(ls);
+        return -1;
+    }
+    srv->ls = ls;
+    srv->count = count;
+    srv->conn = conn;
+    pthread_t th;
+    pthread_create(&th, NULL, server, srv);
+    pthread_detach(th);
+    return 0;
+}
+
+static ViStatus open_rsrc(const char *rsrc, ViUInt32 tmo, ViSession *vi) {
+    *vi = VI_NULL;
+    return viOpen(g_rm, (ViRsrc)rsrc, VI_NULL, tmo, vi);
+}
+
+void test_off(void) {
+    TEST("Off by default: INSTR stays VXI-11");
+    ViSession vi;
+    ViStatus st = open_rsrc("TCPIP::127.0.0.42::INSTR", 200, &vi);
+    if (st != VI_ERROR_TMO || g_hislip_conns != 0 || g_mapper42_conns != 1) { FAIL("probed"); return; }
+    PASS();
+}
+
+void test_hislip(void) {
+    TEST("Host with HiSLIP gets a HiSLIP session");
+    ovAutoProtocolEnable(VI_TRUE);
+    ViSession vi;
+    uint32_t mapper0 = g_mapper42_conns;
+    ViStatus st = open_rsrc("TCPIP::127.0.0.42::INSTR", 1000, &vi);
+    ViBoolean hislip = VI_FALSE;
+    char name[256] = "";
+    if (st == VI_SUCCESS) {
+        viGetAttribute(vi, OV_ATTR_TCPIP_HISLIP, &hislip);
+        viGetAttribute(vi, VI_ATTR_RSRC_NAME, name);
+        viClose(vi);
+    }
+    if (st != VI_SUCCESS || hislip != VI_TRUE) { FAIL("not HiSLIP"); return; }
+    if (strcmp(name, "TCPIP::127.0.0.42::INSTR") != 0) { FAIL("resource name"); return; }
+    if (g_mapper42_conns != mapper0 + 1 || g_hislip_conns < 2) { FAIL("probe"); return; }
+    PASS();
+}
+
+void test_cached(void) {
+    TEST("Choice kept per host until forgotten");
+    ViSession vi;
+    uint32_t mapper0 = g_mapper42_conns;
+    ViBoolean hislip = VI_FALSE;
+    ViStatus st = open_rsrc("TCPIP0::127.0.0.42::inst0::INSTR", 1000, &vi);
+    if (st == VI_SUCCESS) {
+        viGetAttribute(vi, OV_ATTR_TCPIP_HISLIP, &hislip);
+        viClose(vi);
+    }
+    uint32_t mapper1 = g_mapper42_conns;
+    ovAutoProtocolForget("127.0.0.42");
+    ViStatus st2 = open_rsrc("TCPIP::127.0.0.42::INSTR", 1000, &vi);
+    if (st2 == VI_SUCCESS) viClose(vi);
+    if (st != VI_SUCCESS || hislip != VI_TRUE || st2 != VI_SUCCESS) { FAIL("open"); return; }
+    if (mapper1 != mapper0 || g_mapper42_conns != mapper0 + 1) { FAIL("probe count"); return; }
+    PASS();
+}
+
+void test_vxi11(void) {
+    TEST("Host without HiSLIP stays VXI-11");
+    ViSession vi;
+    /* probe + GETPORT, then GETPORT only */
+    ViStatus s1 = open_rsrc("TCPIP::127.0.0.43::INSTR", 200, &vi);
+    uint32_t after1 = g_mapper43_conns;
+    ViStatus s2 = open_rsrc("TCPIP::127.0.0.43::INSTR", 200, &vi);
+    if (s1 != VI_ERROR_TMO || s2 != VI_ERROR_TMO) { FAIL("status"); return; }
+    if (after1 != 2 || g_mapper43_conns != 3) { FAIL("probe count"); return; }
+    PASS();
+}
+
+void test_other_rsrc(void) {
+    TEST("Other devices and silent hosts are left alone");
+    ViSession vi;
+    uint32_t hislip0 = g_hislip_conns;
+    ViStatus s1 = open_rsrc("TCPIP::127.0.0.42::inst1::INSTR", 200, &vi);
+    ViStatus s2 = open_rsrc("TCPIP::127.0.0.44::INSTR", 200, &vi);     /* nothing listens */
+    ViBoolean hislip = VI_FALSE;
+    ViStatus sim = open_rsrc("SIM::ap::INSTR", 0, &vi);
+    ViStatus attr = viGetAttribute(vi, OV_ATTR_TCPIP_HISLIP, &hislip);
+    viClose(vi);
+    if (s1 != VI_ERROR_TMO || g_hislip_conns != hislip0) { FAIL("inst1 switched"); return; }
+    if (s2 != VI_ERROR_CONN_LOST) { FAIL("refused host"); return; }
+    if (sim != VI_SUCCESS || attr != VI_ERROR_NSUP_ATTR) { FAIL("attribute"); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA Protocol Auto-Selection Tests ===\n\n");
+    signal(SIGPIPE, SIG_IGN);
+    unsetenv("OPENVISA_BROKER");
+    unsetenv("OPENVISA_AUTO_PROTOCOL");
+
+    static Server hs, m42, m43;
+    if (start_server(&hs, "127.0.0.42", 4880, &g_hislip_conns, hislip_conn) != 0 ||
+        start_server(&m42, "127.0.0.42", 111, &g_mapper42_conns, mute_conn) != 0 ||
+        start_server(&m43, "127.0.0.43", 111, &g_mapper43_conns, mute_conn) != 0) {
+        printf("  (skipped: cannot listen on ports 4880 and 111)\n\n");
+        return 0;
+    }
+
+    ovSimDefine("ap", "[commands]\n*IDN? = \"OpenVISA,AP,0,1.0\"\n");
+    viOpenDefaultRM(&g_rm);
+    ovBreakerConfigure(0, 0, 0);    /* the timed-out opens here must not trip it */
+    test_off();
+    test_hislip();
+    test_cached();
+    test_vxi11();
+    test_other_rsrc();
+    viClose(g_rm);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
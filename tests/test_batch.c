@@ -0,0 +1,158 @@
+/*
+ * OpenVISA - Batch query (ovQueryMany) tests
+ *
+ * NDEV loopback raw-socket instruments answer READ? with "DEV<n>" after
+ * DELAY_MS, and count how many READ? they are answering at once.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "visa.h"
+#include "openvisa.h"
+#include "testutil.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define NDEV        8
+#define DELAY_MS    40
+
+static ViSession g_rm;
+static ViSession g_dev[NDEV];
+static int g_port[NDEV];
+static volatile uint32_t g_answering, g_peak;
+
+static void *instr_conn(void *arg) {
+    int c = (int)(intptr_t)arg;
+    struct sockaddr_in addr;
+    socklen_t alen = sizeof(addr);
+    getsockname(c, (struct sockaddr*)&addr, &alen);
+    int dev = 0;
+    while (dev < NDEV - 1 && g_port[dev] != ntohs(addr.sin_port)) dev++;
+
+    char line[64], buf[256];
+    size_t len = 0;
+    ssize_t n;
+    while ((n = recv(c, buf, sizeof(buf), 0)) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] != '\n') {
+                if (len < sizeof(line) - 1) line[len++] = buf[i];
+                continue;
+            }
+            line[len] = '\0';
+            len = 0;
+            if (strcmp(line, "READ?") != 0) continue;
+            uint32_t now = __sync_add_and_fetch(&g_answering, 1), p;
+            while ((p = g_peak) < now && !__sync_bool_compare_and_swap(&g_peak, p, now)) {}
+            usleep(DELAY_MS * 1000);
+            __sync_sub_and_fetch(&g_answering, 1);
+            char out[16];
+            int k = snprintf(out, sizeof(out), "DEV%d\n", dev);
+            send(c, out, (size_t)k, MSG_NOSIGNAL);
+        }
+    }
+    close(c);
+    return NULL;
+}
+
+void test_fan_out(void) {
+    TEST("Responses gathered concurrently");
+    char store[NDEV][32];
+    ViBuf bufs[NDEV];
+    ViUInt32 counts[NDEV];
+    ViStatus st[NDEV];
+    for (int i = 0; i < NDEV; i++) bufs[i] = (ViBuf)store[i];
+
+    g_peak = 0;
+    ViStatus rc = ovQueryMany(g_dev, NDEV, "READ?\n", bufs, 32, counts, st);
+    if (rc != VI_SUCCESS) { FAIL("status"); return; }
+    for (int i = 0; i < NDEV; i++) {
+        char expect[16];
+        int n = snprintf(expect, sizeof(expect), "DEV%d\n", i);
+        if (st[i] != VI_SUCCESS_TERM_CHAR || counts[i] != (ViUInt32)n ||
+            memcmp(store[i], expect, (size_t)n) != 0) { FAIL("wrong response"); return; }
+    }
+    printf("(%u of %d at once) ", g_peak, NDEV);
+    if (g_peak < NDEV / 2) { FAIL("not concurrent"); return; }
+    PASS();
+}
+
+void test_per_session_status(void) {
+    TEST("Per-session status, bad handle and duplicates");
+    ViSession list[3] = { g_dev[0], 0xDEAD, g_dev[1] };
+    char a[32], b[32], c[32];
+    ViBuf bufs[3] = { (ViBuf)a, (ViBuf)b, (ViBuf)c };
+    ViUInt32 counts[3];
+    ViStatus st[3];
+    ViStatus rc = ovQueryMany(list, 3, "READ?\n", bufs, 32, counts, st);
+    if (rc != VI_ERROR_INV_OBJECT || st[1] != VI_ERROR_INV_OBJECT) { FAIL("bad handle"); return; }
+    if (st[0] != VI_SUCCESS_TERM_CHAR || st[2] != VI_SUCCESS_TERM_CHAR) { FAIL("good sessions"); return; }
+
+    list[1] = g_dev[0];
+    if (ovQueryMany(list, 3, "READ?\n", bufs, 32, counts, NULL) != VI_ERROR_INV_SETUP) {
+        FAIL("duplicate accepted"); return;
+    }
+    PASS();
+}
+
+void test_timeouts(void) {
+    TEST("Each session honours its own timeout");
+    viSetAttribute(g_dev[3], VI_ATTR_TMO_VALUE, 5);
+    char store[NDEV][32];
+    ViBuf bufs[NDEV];
+    ViUInt32 counts[NDEV];
+    ViStatus st[NDEV];
+    for (int i = 0; i < NDEV; i++) bufs[i] = (ViBuf)store[i];
+    ViStatus rc = ovQueryMany(g_dev, NDEV, "READ?\n", bufs, 32, counts, st);
+    viSetAttribute(g_dev[3], VI_ATTR_TMO_VALUE, 2000);
+
+    /* Drain the late response so the session is clean again */
+    ViUInt32 n;
+    viRead(g_dev[3], (ViBuf)store[3], 32, &n);
+
+    if (rc != VI_ERROR_TMO || st[3] != VI_ERROR_TMO) { FAIL("no timeout"); return; }
+    for (int i = 0; i < NDEV; i++)
+        if (i != 3 && st[i] != VI_SUCCESS_TERM_CHAR) { FAIL("others affected"); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA Batch Query Tests ===\n\n");
+
+    if (viOpenDefaultRM(&g_rm) != VI_SUCCESS) return 1;
+    for (int i = 0; i < NDEV; i++) {
+        int ls = listen_loopback(4, &g_port[i]);
+        if (ls < 0) return 1;
+        serve(ls, instr_conn);
+    }
+    for (int i = 0; i < NDEV; i++) {
+        char rsrc[48];
+        snprintf(rsrc, sizeof(rsrc), "TCPIP::127.0.0.1::%d::SOCKET", g_port[i]);
+        if (viOpen(g_rm, rsrc, VI_NULL, VI_NULL, &g_dev[i]) != VI_SUCCESS) {
+            printf("  cannot open %s\n", rsrc);
+            return 1;
+        }
+        viSetAttribute(g_dev[i], VI_ATTR_TERMCHAR_EN, VI_TRUE);
+    }
+
+    test_fan_out();
+    test_per_session_status();
+    test_timeouts();
+
+    for (int i = 0; i < NDEV; i++) viClose(g_dev[i]);
+    viClose(g_rm);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,190 @@
+/*
+ * OpenVISA - Host circuit breaker (ovBreaker*) tests
+ *
+ * A listener whose accept queue is full stands in for an instrument that
+ * does not answer: connects to it time out.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "visa.h"
+#include "openvisa.h"
+#include "testutil.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define MAX_FILL 64
+
+static ViSession g_rm;
+static int g_ls = -1;
+static int g_fill[MAX_FILL];
+static int g_nfill;
+static char g_rsrc[64];
+
+/* Connect until the accept queue is full and a connect no longer completes */
+static void fill_queue(void) {
+    struct sockaddr_in addr;
+    socklen_t alen = sizeof(addr);
+    getsockname(g_ls, (struct sockaddr*)&addr, &alen);
+    while (g_nfill < MAX_FILL) {
+        int c = socket(AF_INET, SOCK_STREAM, 0);
+        fcntl(c, F_SETFL, O_NONBLOCK);
+        connect(c, (struct sockaddr*)&addr, sizeof(addr));
+        g_fill[g_nfill++] = c;
+        struct pollfd p = { .fd = c, .events = POLLOUT };
+        if (poll(&p, 1, 100) == 0) return;
+    }
+}
+
+/* Accept everything queued: the host answers again */
+static void drain_queue(void) {
+    fcntl(g_ls, F_SETFL, O_NONBLOCK);
+    for (int i = 0; i < 20; i++) {
+        int c;
+        while ((c = accept(g_ls, NULL, NULL)) >= 0) close(c);
+        usleep(10 * 1000);
+    }
+    for (int i = 0; i < g_nfill; i++) close(g_fill[i]);
+    g_nfill = 0;
+}
+
+static ViStatus open_rsrc(const char *rsrc, ViUInt32 tmo, ViSession *vi) {
+    *vi = VI_NULL;
+    return viOpen(g_rm, (ViRsrc)rsrc, VI_NULL, tmo, vi);
+}
+
+void test_default_off(void) {
+    TEST("Off until configured");
+    ViSession vi;
+    int ok = 1;
+    for (int i = 0; i < 3; i++) ok = ok && open_rsrc(g_rsrc, 100, &vi) == VI_ERROR_TMO;
+    ViUInt16 state = OV_HOST_DOWN;
+    ViUInt32 failures = 1;
+    ovBreakerGetState("127.0.0.1", &state, &failures, VI_NULL);
+    if (!ok || state != OV_HOST_HEALTHY || failures != 0) { FAIL("counted"); return; }
+    PASS();
+}
+
+void test_refused(void) {
+    TEST("Refused connects never trip it");
+    int s = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t alen = sizeof(addr);
+    bind(s, (struct sockaddr*)&addr, sizeof(addr));
+    getsockname(s, (struct sockaddr*)&addr, &alen);
+    close(s);                   /* nothing listens on this port now */
+    char rsrc[64];
+    snprintf(rsrc, sizeof(rsrc), "TCPIP::127.0.0.1::%d::SOCKET", ntohs(addr.sin_port));
+    int ok = 1;
+    ViSession vi;
+    for (int i = 0; i < 5; i++) ok = ok && open_rsrc(rsrc, 200, &vi) == VI_ERROR_CONN_LOST;
+    ViUInt16 state = 1;
+    ViUInt32 failures = 1;
+    ovBreakerGetState("127.0.0.1", &state, &failures, VI_NULL);
+    if (!ok || state != OV_HOST_HEALTHY || failures != 0) { FAIL("tripped"); return; }
+    PASS();
+}
+
+void test_trip(void) {
+    TEST("Timed-out opens mark the host down");
+    ViSession vi;
+    int ok = 1;
+    for (int i = 0; i < 3; i++) ok = ok && open_rsrc(g_rsrc, 200, &vi) == VI_ERROR_TMO;
+    /* A connect attempt would time out: not found means none was made */
+    ViStatus st = open_rsrc(g_rsrc, 200, &vi);
+    ViUInt32 down = 0, failures = 0, next = 0;
+    ViUInt16 state = OV_HOST_HEALTHY;
+    viGetAttribute(g_rm, OV_ATTR_HOSTS_DOWN, &down);
+    ovBreakerGetState("127.0.0.1", &state, &failures, &next);
+    if (!ok) { FAIL("opens did not time out"); return; }
+    if (st != VI_ERROR_RSRC_NFOUND) { FAIL("not failed fast"); return; }
+    if (down != 1 || state != OV_HOST_DOWN || failures != 3 || next == 0 || next > 300) {
+        FAIL("state"); return;
+    }
+    PASS();
+}
+
+void test_recover(void) {
+    TEST("Prober marks the host healthy when it answers");
+    drain_queue();
+    ViUInt16 state = OV_HOST_DOWN;
+    for (int i = 0; i < 500 && state != OV_HOST_HEALTHY; i++) {
+        usleep(10 * 1000);
+        ovBreakerGetState("127.0.0.1", &state, VI_NULL, VI_NULL);
+    }
+    drain_queue();              /* the probe's connection took the one slot */
+    ViSession vi;
+    ViStatus st = open_rsrc(g_rsrc, 1000, &vi);
+    ViUInt16 attr = OV_HOST_DOWN;
+    ViUInt32 down = 1;
+    if (st == VI_SUCCESS) {
+        viGetAttribute(vi, OV_ATTR_HOST_STATE, &attr);
+        viClose(vi);
+    }
+    viGetAttribute(g_rm, OV_ATTR_HOSTS_DOWN, &down);
+    if (state != OV_HOST_HEALTHY) { FAIL("still down"); return; }
+    if (st != VI_SUCCESS || attr != OV_HOST_HEALTHY || down != 0) { FAIL("open"); return; }
+    PASS();
+}
+
+void test_reset_off(void) {
+    TEST("Reset clears it; threshold 0 turns it off");
+    fill_queue();
+    ViSession vi;
+    ovBreakerConfigure(1, 60000, 0);
+    ViStatus s1 = open_rsrc(g_rsrc, 100, &vi);
+    ViStatus s2 = open_rsrc(g_rsrc, 100, &vi);
+    ViUInt16 state = OV_HOST_HEALTHY;
+    ovBreakerGetState("127.0.0.1", &state, VI_NULL, VI_NULL);
+    ovBreakerReset(VI_NULL);
+    ViStatus s3 = open_rsrc(g_rsrc, 100, &vi);       /* times out and trips again */
+    ovBreakerConfigure(0, 0, 0);
+    ViStatus s4 = open_rsrc(g_rsrc, 100, &vi);
+    ViStatus s5 = open_rsrc(g_rsrc, 100, &vi);
+    ViStatus ro = viSetAttribute(g_rm, OV_ATTR_HOSTS_DOWN, 0);
+    drain_queue();
+    int ok = s1 == VI_ERROR_TMO && s2 == VI_ERROR_RSRC_NFOUND && state == OV_HOST_DOWN &&
+             s3 == VI_ERROR_TMO && s4 == VI_ERROR_TMO && s5 == VI_ERROR_TMO &&
+             ro == VI_ERROR_ATTR_READONLY;
+    if (!ok) { FAIL("reset/off"); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA Circuit Breaker Tests ===\n\n");
+    unsetenv("OPENVISA_BROKER");
+    unsetenv("OPENVISA_BREAKER");
+
+    int port;
+    g_ls = listen_loopback(0, &port);
+    snprintf(g_rsrc, sizeof(g_rsrc), "TCPIP::127.0.0.1::%d::SOCKET", port);
+    fill_queue();
+
+    viOpenDefaultRM(&g_rm);
+    test_default_off();
+    ovBreakerConfigure(3, 300, 1000);
+    test_refused();
+    test_trip();
+    test_recover();
+    test_reset_off();
+    viClose(g_rm);
+    close(g_ls);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
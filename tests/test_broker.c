@@ -0,0 +1,171 @@
+/*
+ * OpenVISA - openvisa-broker connection hand-off tests
+ *
+ * Usage: test_broker <path-to-openvisa-broker>
+ * A loopback raw-socket instrument counts the TCP connections it accepts, so
+ * the tests can tell a reused connection from a fresh one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "visa.h"
+#include "openvisa.h"
+#include "testutil.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static ViSession g_rm;
+static char g_rsrc[64];
+static volatile int g_accepts;
+
+/* Answers every line with "conn <n>", n = which accepted connection */
+static void *instr_conn(void *arg) {
+    int c = (int)(intptr_t)arg;
+    int id = __sync_add_and_fetch(&g_accepts, 1);
+    char buf[256];
+    ssize_t n;
+    while ((n = recv(c, buf, sizeof(buf), 0)) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] != '\n') continue;
+            char resp[32];
+            int len = snprintf(resp, sizeof(resp), "conn %d\n", id);
+            send(c, resp, (size_t)len, MSG_NOSIGNAL);
+        }
+    }
+    close(c);
+    return NULL;
+}
+
+static int query(ViSession vi) {
+    char buf[32];
+    ViUInt32 n;
+    if (viWrite(vi, (ViBuf)"*IDN?\n", 6, &n) != VI_SUCCESS) return -1;
+    if (viRead(vi, (ViBuf)buf, sizeof(buf) - 1, &n) < VI_SUCCESS) return -1;
+    buf[n] = '\0';
+    int id = -1;
+    sscanf(buf, "conn %d", &id);
+    return id;
+}
+
+/* Up once the socket takes connections: the file appears before listen() */
+static int broker_up(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    int ok = connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+    close(fd);
+    return ok;
+}
+
+void test_reuse(void) {
+    TEST("Connection reused across open/close");
+    ViSession vi;
+    double best = 1e9;
+    int ids[5];
+    for (int i = 0; i < 5; i++) {
+        double t0 = now_us();
+        ViStatus st = viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi);
+        double dt = now_us() - t0;
+        if (st != VI_SUCCESS) { FAIL("open"); return; }
+        if (i > 0 && dt < best) best = dt;
+        ids[i] = query(vi);
+        viClose(vi);
+    }
+    for (int i = 1; i < 5; i++)
+        if (ids[i] != ids[0]) { FAIL("new connection"); return; }
+    if (g_accepts != 1) { FAIL("extra connects"); return; }
+    printf("(open %.0f us) ", best);
+    PASS();
+}
+
+void test_concurrent(void) {
+    TEST("Concurrent sessions get separate connections");
+    ViSession a, b;
+    viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &a);
+    viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &b);
+    int ia = query(a), ib = query(b);
+    viClose(a);
+    viClose(b);
+    if (ia < 0 || ib < 0 || ia == ib) { FAIL("shared connection"); return; }
+    PASS();
+}
+
+void test_stale(void) {
+    TEST("Connection with unread response not reused");
+    ViSession vi;
+    ViUInt32 n;
+    viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi);
+    int before = query(vi);
+    viWrite(vi, (ViBuf)"*IDN?\n", 6, &n);          /* response left unread */
+    viClose(vi);
+    usleep(20000);                                  /* let the response arrive */
+
+    viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi);
+    int after = query(vi);
+    viClose(vi);
+    if (after < 0 || after == before) { FAIL("stale connection handed out"); return; }
+    PASS();
+}
+
+void test_fallback(void) {
+    TEST("Direct open when no broker is running");
+    setenv("OPENVISA_BROKER", "/nonexistent/broker.sock", 1);
+    int before = g_accepts;
+    ViSession vi;
+    ViStatus st = viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi);
+    int id = st == VI_SUCCESS ? query(vi) : -1;
+    if (st == VI_SUCCESS) viClose(vi);
+    if (id != before + 1) { FAIL("no direct connection"); return; }
+    PASS();
+}
+
+int main(int argc, char **argv) {
+    printf("\n=== OpenVISA Broker Tests ===\n\n");
+    if (argc < 2) {
+        printf("usage: test_broker <openvisa-broker>\n");
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    serve_socket(instr_conn, g_rsrc, sizeof(g_rsrc));
+
+    char dir[] = "/tmp/ovbroker-XXXXXX";
+    if (!mkdtemp(dir)) return 1;
+    char sock[64];
+    snprintf(sock, sizeof(sock), "%s/broker.sock", dir);
+    setenv("OPENVISA_BROKER", sock, 1);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl(argv[1], argv[1], (char*)NULL);
+        _exit(127);
+    }
+    for (int i = 0; i < 200 && !broker_up(sock); i++) usleep(10000);
+
+    viOpenDefaultRM(&g_rm);
+    test_reuse();
+    test_concurrent();
+    test_stale();
+    test_fallback();
+    viClose(g_rm);
+
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    rmdir(dir);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * OpenVISA - Capture file (ovCapture*) tests
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "visa.h"
+#include "openvisa.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define CAP_FILE    "capture_test.ovcap"
+#define T0          1700000000000000000ull      /* base timestamp, ns */
+#define NREC        20000
+
+typedef struct {
+    ViUInt64 count;
+    ViUInt64 last_ts;
+    ViUInt64 bytes;
+    int      bad;
+} ScanStats;
+
+static ViStatus count_handler(ViUInt64 ts, ViSession vi, ViConstBuf data, ViUInt32 len, ViAddr user) {
+    ScanStats *s = (ScanStats*)user;
+    char expect[64];
+    int n = snprintf(expect, sizeof(expect), "%u,%llu\n", (unsigned)vi, (unsigned long long)(ts - T0));
+    if ((ViUInt32)n != len || memcmp(expect, data, len) != 0) s->bad++;
+    if (ts < s->last_ts) s->bad++;
+    s->last_ts = ts;
+    s->count++;
+    s->bytes += len;
+    return VI_SUCCESS;
+}
+
+static ViStatus stop_handler(ViUInt64 ts, ViSession vi, ViConstBuf data, ViUInt32 len, ViAddr user) {
+    (void)ts; (void)vi; (void)data; (void)len;
+    return ++*(int*)user == 3 ? VI_ERROR_ABORT : VI_SUCCESS;
+}
+
+/* NREC records, 1 us apart, round-robin over sessions 1..4 */
+static ViStatus write_file(ViUInt32 flags, ViUInt32 chunk, int close_it, OvCapture **out) {
+    OvCapture *cap;
+    ViStatus st = ovCaptureCreate(CAP_FILE, flags, chunk, &cap);
+    if (st != VI_SUCCESS) return st;
+    for (int i = 0; i < NREC; i++) {
+        char rec[64];
+        ViSession vi = 1 + (i % 4);
+        ViUInt64 dt = (ViUInt64)i * 1000u;
+        int n = snprintf(rec, sizeof(rec), "%u,%llu\n", (unsigned)vi, (unsigned long long)dt);
+        st = ovCaptureAppend(cap, vi, T0 + dt, (ViConstBuf)rec, (ViUInt32)n);
+        if (st != VI_SUCCESS) return st;
+    }
+    if (close_it) return ovCaptureClose(cap);
+    *out = cap;
+    return ovCaptureFlush(cap);
+}
+
+static void check_contents(void) {
+    OvCaptureReader *r;
+    if (ovCaptureOpenReader(CAP_FILE, &r) != VI_SUCCESS) { FAIL("open reader"); return; }
+
+    ViUInt64 first, last, nrec;
+    ovCaptureGetRange(r, &first, &last, &nrec);
+    if (nrec != NREC || first != T0 || last != T0 + (NREC - 1) * 1000ull) {
+        ovCaptureCloseReader(r); FAIL("range"); return;
+    }
+
+    ScanStats all = {0};
+    ovCaptureScan(r, 0, ~0ull, VI_NULL, count_handler, &all);
+    if (all.count != NREC || all.bad) { ovCaptureCloseReader(r); FAIL("full scan"); return; }
+
+    /* 5 ms window, session 3 only: records 5000..9999 with i % 4 == 2 */
+    ScanStats win = {0};
+    ovCaptureScan(r, T0 + 5000000ull, T0 + 9999000ull, 3, count_handler, &win);
+    ovCaptureCloseReader(r);
+    if (win.count != 1250 || win.bad) { FAIL("window scan"); return; }
+    PASS();
+}
+
+void test_roundtrip(void) {
+    TEST("Write/read round trip, time + session filter");
+    if (write_file(0, 4096, 1, NULL) != VI_SUCCESS) { FAIL("write"); return; }
+    check_contents();
+}
+
+void test_lz4(void) {
+    TEST("LZ4-compressed chunks");
+    ViStatus st = write_file(OV_CAPTURE_LZ4, 0, 1, NULL);
+    if (st != VI_SUCCESS) { FAIL("write"); return; }
+    check_contents();
+}
+
+void test_unclosed(void) {
+    TEST("File readable while writer is still open");
+    OvCapture *cap = NULL;
+    if (write_file(0, 8192, 0, &cap) != VI_SUCCESS) { FAIL("write"); return; }
+    check_contents();
+    ovCaptureClose(cap);
+}
+
+void test_stop_and_names(void) {
+    TEST("Handler can stop a scan; session names recorded");
+    ViSession rm, sim;
+    viOpenDefaultRM(&rm);
+    ovSimDefine("capdmm", "[commands]\nREAD? = \"4.2\"\n");
+    if (viOpen(rm, "SIM::capdmm::INSTR", VI_NULL, VI_NULL, &sim) != VI_SUCCESS) { FAIL("open sim"); return; }
+
+    OvCapture *cap;
+    ovCaptureCreate(CAP_FILE, 0, 0, &cap);
+    for (int i = 0; i < 10; i++) {
+        char buf[32];
+        ViUInt32 n;
+        viWrite(sim, (ViBuf)"READ?\n", 6, &n);
+        if (ovCaptureRead(cap, sim, (ViBuf)buf, sizeof(buf), &n) < VI_SUCCESS || n != 4) {
+            FAIL("capture read"); return;
+        }
+    }
+    ovCaptureClose(cap);
+    viClose(sim);
+    viClose(rm);
+
+    OvCaptureReader *r;
+    char name[256];
+    int seen = 0;
+    ovCaptureOpenReader(CAP_FILE, &r);
+    ViStatus st = ovCaptureScan(r, 0, ~0ull, VI_NULL, stop_handler, &seen);
+    ViStatus nst = ovCaptureSessionName(r, sim, name);
+    ovCaptureCloseReader(r);
+    if (st != VI_ERROR_ABORT || seen != 3) { FAIL("scan not stopped"); return; }
+    if (nst != VI_SUCCESS || strcmp(name, "SIM::capdmm::INSTR") != 0) { FAIL("session name"); return; }
+    PASS();
+}
+
+void test_not_a_capture(void) {
+    TEST("Foreign file rejected");
+    FILE *f = fopen(CAP_FILE, "wb");
+    fputs("this is not a capture file, just some text long enough", f);
+    fclose(f);
+    OvCaptureReader *r;
+    if (ovCaptureOpenReader(CAP_FILE, &r) != VI_ERROR_FILE_IO) { FAIL("accepted"); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA Capture File Tests ===\n\n");
+
+    test_roundtrip();
+    test_lz4();
+    test_unclosed();
+    test_stop_and_names();
+    test_not_a_capture();
+    remove(CAP_FILE);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
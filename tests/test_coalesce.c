@@ -0,0 +1,250 @@
+/*
+ * OpenVISA - SCPI write coalescing tests
+ *
+ * A loopback raw-socket instrument logs every program message it receives
+ * and spends MSG_COST_US on each one, as a real instrument's parser does
+ * per message; queries are answered with "1".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "visa.h"
+#include "openvisa.h"
+#include "testutil.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define MSG_COST_US     100
+#define MAX_MSGS        4096
+#define COMMANDS        400
+
+static ViSession g_rm;
+static char g_rsrc[64];
+
+static pthread_mutex_t g_log_lock = PTHREAD_MUTEX_INITIALIZER;
+static char *g_log[MAX_MSGS];
+static int g_msgs;
+
+static void log_reset(void) {
+    pthread_mutex_lock(&g_log_lock);
+    for (int i = 0; i < g_msgs; i++) free(g_log[i]);
+    g_msgs = 0;
+    pthread_mutex_unlock(&g_log_lock);
+}
+
+static int log_count(void) {
+    pthread_mutex_lock(&g_log_lock);
+    int n = g_msgs;
+    pthread_mutex_unlock(&g_log_lock);
+    return n;
+}
+
+/* Message i of the log, "" if not (yet) received */
+static const char *log_msg(int i) {
+    pthread_mutex_lock(&g_log_lock);
+    const char *m = i < g_msgs ? g_log[i] : "";
+    pthread_mutex_unlock(&g_log_lock);
+    return m;
+}
+
+static int wait_msgs(int n) {
+    for (int i = 0; i < 200 && log_count() < n; i++) usleep(1000);
+    return log_count();
+}
+
+static void *instr_conn(void *arg) {
+    int c = (int)(intptr_t)arg;
+    char line[8192];
+    size_t len = 0;
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(c, buf, sizeof(buf), 0)) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] != '\n') {
+                if (len < sizeof(line) - 1) line[len++] = buf[i];
+                continue;
+            }
+            line[len] = '\0';
+            usleep(MSG_COST_US);
+            pthread_mutex_lock(&g_log_lock);
+            if (g_msgs < MAX_MSGS) g_log[g_msgs++] = strdup(line);
+            pthread_mutex_unlock(&g_log_lock);
+            if (strchr(line, '?')) send(c, "1\n", 2, MSG_NOSIGNAL);
+            len = 0;
+        }
+    }
+    close(c);
+    return NULL;
+}
+
+static ViStatus send_cmd(ViSession vi, const char *cmd) {
+    ViUInt32 n;
+    return viWrite(vi, (ViBuf)cmd, (ViUInt32)strlen(cmd), &n);
+}
+
+static ViSession open_instr(void) {
+    ViSession vi = VI_NULL;
+    viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi);
+    log_reset();
+    return vi;
+}
+
+void test_join(void) {
+    TEST("Commands joined, relative headers rooted");
+    ViSession vi = open_instr();
+    ovCoalesceEnable(vi, 1000, 0);
+    send_cmd(vi, "SOUR:VOLT 1\n");
+    send_cmd(vi, "*CLS\n");
+    send_cmd(vi, ":OUTP ON\n");
+    send_cmd(vi, "CURR 2;VOLT 3\n");
+    usleep(20000);
+    int held = log_count() == 0;
+    ovCoalesceFlush(vi);
+    wait_msgs(1);
+    const char *m = log_msg(0);
+    int ok = held && log_count() == 1 &&
+             strcmp(m, "SOUR:VOLT 1;*CLS;:OUTP ON;:CURR 2;VOLT 3") == 0;
+    viClose(vi);
+    if (!ok) { FAIL(held ? m : "sent before the window"); return; }
+    PASS();
+}
+
+void test_query_flushes(void) {
+    TEST("Query sent after the held commands");
+    ViSession vi = open_instr();
+    ovCoalesceEnable(vi, 1000, 0);
+    send_cmd(vi, "TRIG:SOUR BUS\n");
+    send_cmd(vi, "INIT\n");
+    char r[16];
+    ViUInt32 n = 0;
+    ViStatus st = send_cmd(vi, "*OPC?\n");
+    if (st == VI_SUCCESS) st = viRead(vi, (ViBuf)r, sizeof(r), &n);
+    wait_msgs(2);
+    int ok = st >= VI_SUCCESS && n == 2 && log_count() == 2 &&
+             strcmp(log_msg(0), "TRIG:SOUR BUS;:INIT") == 0 && strcmp(log_msg(1), "*OPC?") == 0;
+    viClose(vi);
+    if (!ok) { FAIL("order"); return; }
+    PASS();
+}
+
+void test_window(void) {
+    TEST("Held commands sent when the window expires");
+    ViSession vi = open_instr();
+    ovCoalesceEnable(vi, 10, 0);
+    send_cmd(vi, "OUTP ON\n");
+    send_cmd(vi, "OUTP OFF\n");
+    int got = wait_msgs(1);
+    int ok = got == 1 && strcmp(log_msg(0), "OUTP ON;:OUTP OFF") == 0;
+    viClose(vi);
+    if (!ok) { FAIL("not flushed"); return; }
+    PASS();
+}
+
+void test_size_bound(void) {
+    TEST("Messages stay within maxBytes");
+    ViSession vi = open_instr();
+    ovCoalesceEnable(vi, 1000, 32);
+    for (int i = 0; i < 10; i++) send_cmd(vi, "VOLT 1.2345\n");
+    ovCoalesceFlush(vi);
+    wait_msgs(5);
+    int ok = log_count() == 5;                      /* two commands per message */
+    for (int i = 0; i < log_count(); i++) ok = ok && strlen(log_msg(i)) <= 32;
+    viClose(vi);
+    if (!ok) { FAIL("size"); return; }
+    PASS();
+}
+
+void test_block_and_close(void) {
+    TEST("Block data sent alone; close flushes");
+    ViSession vi = open_instr();
+    ovCoalesceEnable(vi, 1000, 0);
+    send_cmd(vi, "FORM ASC\n");
+    send_cmd(vi, "DATA #15a;b;c\n");
+    send_cmd(vi, "OUTP ON\n");
+    viClose(vi);
+    wait_msgs(3);
+    int ok = log_count() == 3 && strcmp(log_msg(0), "FORM ASC") == 0 &&
+             strcmp(log_msg(1), "DATA #15a;b;c") == 0 && strcmp(log_msg(2), "OUTP ON") == 0;
+    if (!ok) { FAIL("block joined"); return; }
+    PASS();
+}
+
+void test_hash_not_block(void) {
+    TEST("'#' in strings and non-decimal numbers joined");
+    ViSession vi = open_instr();
+    ovCoalesceEnable(vi, 1000, 0);
+    send_cmd(vi, "DISP:TEXT \"#1 run\"\n");
+    send_cmd(vi, "STAT:QUES:ENAB #H1F\n");
+    send_cmd(vi, "STAT:OPER:ENAB #Q17\n");
+    ovCoalesceFlush(vi);
+    wait_msgs(1);
+    int ok = log_count() == 1 &&
+             strcmp(log_msg(0), "DISP:TEXT \"#1 run\";:STAT:QUES:ENAB #H1F;:STAT:OPER:ENAB #Q17") == 0;
+    viClose(vi);
+    if (!ok) { FAIL(log_msg(0)); return; }
+    PASS();
+}
+
+static double run_commands(ViSession vi, int *msgs) {
+    char cmd[32], r[16];
+    ViUInt32 n;
+    log_reset();
+    double t0 = now_ms();
+    for (int i = 0; i < COMMANDS; i++) {
+        snprintf(cmd, sizeof(cmd), "SOUR:VOLT %d.%02d\n", i / 100, i % 100);
+        send_cmd(vi, cmd);
+    }
+    send_cmd(vi, "*OPC?\n");
+    viRead(vi, (ViBuf)r, sizeof(r), &n);
+    double dt = now_ms() - t0;
+    *msgs = log_count();
+    return dt;
+}
+
+void test_throughput(void) {
+    TEST("Command throughput with and without coalescing");
+    ViSession vi = open_instr();
+    int plain_msgs, co_msgs;
+    double t_plain = run_commands(vi, &plain_msgs);
+    ovCoalesceEnable(vi, 0, 0);
+    double t_co = run_commands(vi, &co_msgs);
+    ViStatus st = ovCoalesceDisable(vi);
+    viClose(vi);
+    printf("(%.0f -> %.0f cmd/s, %d -> %d msgs) ",
+           COMMANDS / t_plain * 1e3, COMMANDS / t_co * 1e3, plain_msgs, co_msgs);
+    if (st != VI_SUCCESS || plain_msgs != COMMANDS + 1 || co_msgs > COMMANDS / 10) { FAIL("not coalesced"); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA Write Coalescing Tests ===\n\n");
+    signal(SIGPIPE, SIG_IGN);
+    unsetenv("OPENVISA_BROKER");
+
+    serve_socket(instr_conn, g_rsrc, sizeof(g_rsrc));
+
+    viOpenDefaultRM(&g_rm);
+    test_join();
+    test_query_flushes();
+    test_window();
+    test_size_bound();
+    test_block_and_close();
+    test_hash_not_block();
+    test_throughput();
+    viClose(g_rm);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
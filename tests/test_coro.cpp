@@ -0,0 +1,160 @@
+/*
+ * OpenVISA - C++20 layer (openvisa.hpp) tests
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "openvisa.hpp"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define NDEV        50
+
+static const char *SIM_DEF =
+    "[commands]\n"
+    "*IDN?  = \"OpenVISA,CORO,0,1.0\"\n"
+    "MEAS?  = \"1.25\" delay 20\n"
+    "CURV?  = block ramp 1000 int16\n";
+
+void test_raii() {
+    TEST("RAII session, sync query, errors as exceptions");
+    ov::resource_manager rm;
+    ov::session s(rm, "SIM::coro::INSTR");
+    std::string idn = s.query("*IDN?\n");
+    ViSession vi = s.get();
+    ViStatus bad = VI_SUCCESS;
+    try {
+        ov::session missing(rm, "SIM::no-such-sim::INSTR");
+    } catch (const ov::error &e) {
+        bad = e.status();
+    }
+    {
+        auto guard = s.lock(1000);
+    }
+    ov::session moved(std::move(s));
+    bool ok = idn == "OpenVISA,CORO,0,1.0" && bad == VI_ERROR_RSRC_NFOUND &&
+              s.get() == VI_NULL && moved.get() == vi &&
+              moved.get_attribute<ViUInt32>(VI_ATTR_TMO_VALUE) == 2000;
+    moved.close();
+    ViUInt32 tmo;
+    if (!ok || viGetAttribute(vi, VI_ATTR_TMO_VALUE, &tmo) != VI_ERROR_INV_OBJECT) { FAIL("raii"); return; }
+    PASS();
+}
+
+static ov::task<double> measure_twice(ov::session &s) {
+    std::string a = co_await s.async_query("MEAS?\n");
+    std::string b = co_await s.async_query(":MEAS?\n");
+    co_return std::stod(a) + std::stod(b);
+}
+
+/* Tasks suspended in measure_twice, and the most there were at once */
+static int g_inflight, g_peak;
+
+static ov::task<> accumulate(ov::session &s, int &done, double &sum) {
+    if (++g_inflight > g_peak) g_peak = g_inflight;
+    sum += co_await measure_twice(s);
+    g_inflight--;
+    done++;
+}
+
+void test_one_thread() {
+    TEST("Many instruments from one thread");
+    ov::io_context io;
+    ov::resource_manager rm;
+    std::vector<std::unique_ptr<ov::session>> devs;
+    for (int i = 0; i < NDEV; i++)
+        devs.push_back(std::make_unique<ov::session>(io, rm, "SIM::coro::INSTR"));
+
+    int done = 0;
+    double sum = 0;
+    for (auto &d : devs) io.spawn(accumulate(*d, done, sum));
+    io.run();
+    printf("(%d of %d in flight) ", g_peak, NDEV);
+    if (done != NDEV || sum != NDEV * 2.5) { FAIL("results"); return; }
+    if (g_peak != NDEV) { FAIL("serialized"); return; }
+    PASS();
+}
+
+static ov::task<> read_curve(ov::session &s, std::span<std::byte> buf,
+                             std::span<std::byte> &got, std::string &after) {
+    co_await s.async_write("CURV?\n");
+    got = co_await s.async_read_block(buf);
+    after = co_await s.async_query("*IDN?\n");
+}
+
+void test_block() {
+    TEST("Binary block read in place");
+    ov::io_context io;
+    ov::resource_manager rm;
+    ov::session s(io, rm, "SIM::coro::INSTR");
+    std::vector<std::byte> buf(4096);
+    std::span<std::byte> got;
+    std::string after;
+    io.spawn(read_curve(s, buf, got, after));
+    io.run();
+    int16_t first, last;
+    std::memcpy(&first, got.data(), 2);
+    std::memcpy(&last, got.data() + got.size() - 2, 2);
+    if (got.data() != buf.data() || got.size() != 2000) { FAIL("block"); return; }
+    if (first == last) { FAIL("not a ramp"); return; }
+    if (after != "OpenVISA,CORO,0,1.0") { FAIL("terminator left behind"); return; }
+    PASS();
+}
+
+static ov::task<> query_undefined(ov::session &s, bool &reached) {
+    co_await s.async_query("UNDEFINED?\n");
+    reached = true;
+}
+
+static ov::task<> write_without_io(ov::session &s, ViStatus &st) {
+    try {
+        co_await s.async_write("*IDN?\n");
+    } catch (const ov::error &e) {
+        st = e.status();
+    }
+}
+
+void test_exception() {
+    TEST("Failed operation rethrown from run()");
+    ov::io_context io;
+    ov::resource_manager rm;
+    ov::session s(io, rm, "SIM::coro::INSTR");
+    ov::session sync_only(rm, "SIM::coro::INSTR");
+    bool reached = false;
+    ViStatus st = VI_SUCCESS, st2 = VI_SUCCESS;
+    io.spawn(query_undefined(s, reached));
+    try {
+        io.run();
+    } catch (const ov::error &e) {
+        st = e.status();
+    }
+    io.spawn(write_without_io(sync_only, st2));
+    io.run();
+    if (reached || st != VI_ERROR_TMO) { FAIL("not rethrown"); return; }
+    if (st2 != VI_ERROR_INV_SETUP) { FAIL("no io_context"); return; }
+    PASS();
+}
+
+int main() {
+    printf("\n=== OpenVISA C++ Layer Tests ===\n\n");
+
+    ovSimDefine("coro", SIM_DEF);
+    test_raii();
+    test_one_thread();
+    test_block();
+    test_exception();
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
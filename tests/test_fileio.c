@@ -0,0 +1,258 @@
+/*
+ * OpenVISA - viReadToFile / viWriteFromFile tests
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "visa.h"
+#include "openvisa.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define TMP_FILE     "fileio_test.bin"
+#define SOCK_BYTES   (3u * 1024 * 1024 + 17)
+
+static ViSession g_rm;
+
+static long file_size(const char *path, unsigned char *head, size_t headsz) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    if (head) { size_t n = fread(head, 1, headsz, f); (void)n; }
+    fseek(f, 0, SEEK_END);
+    long sz = ftell(f);
+    fclose(f);
+    return sz;
+}
+
+/* Loopback instrument: answers "DATA?" with SOCK_BYTES of a counting pattern
+ * ending in '\n', "TERM?" with a line ending in '\r', echoes anything else
+ * back with a byte count. */
+static void *loopback_server(void *arg) {
+    int ls = (int)(intptr_t)arg;
+    int c = accept(ls, NULL, NULL);
+    if (c < 0) return NULL;
+    unsigned char *p = (unsigned char*)malloc(SOCK_BYTES);
+    for (uint32_t i = 0; i < SOCK_BYTES; i++) p[i] = (unsigned char)(i % 251);
+    p[SOCK_BYTES - 1] = '\n';
+
+    char req[64];
+    ssize_t n;
+    while ((n = recv(c, req, sizeof(req) - 1, 0)) > 0) {
+        req[n] = '\0';
+        if (strncmp(req, "DATA?", 5) == 0) {
+            for (uint32_t off = 0; off < SOCK_BYTES; ) {
+                ssize_t s = send(c, p + off, SOCK_BYTES - off, 0);
+                if (s <= 0) break;
+                off += (uint32_t)s;
+            }
+        } else if (strncmp(req, "TERM?", 5) == 0) {
+            send(c, "12\n34\r", 6, 0);
+        } else {
+            char reply[32];
+            int rl = snprintf(reply, sizeof(reply), "GOT %d\n", (int)n);
+            send(c, reply, (size_t)rl, 0);
+        }
+    }
+    free(p);
+    close(c);
+    return NULL;
+}
+
+void test_sim_read_to_file(ViSession sim) {
+    TEST("SIM block read into file (mmap path)");
+    ViUInt32 n;
+    viWrite(sim, (ViBuf)"CURV?\n", 6, &n);
+    ViStatus st = viReadToFile(sim, TMP_FILE, 1u << 20, &n);
+    unsigned char head[4];
+    /* #42000 + 1000 int16 samples + '\n' */
+    if (st != VI_SUCCESS_TERM_CHAR) { FAIL("status"); return; }
+    if (n != 2007 || file_size(TMP_FILE, head, sizeof(head)) != 2007) { FAIL("size"); return; }
+    if (memcmp(head, "#420", 4) != 0) { FAIL("content"); return; }
+    PASS();
+}
+
+void test_append(ViSession sim) {
+    TEST("VI_ATTR_FILE_APPEND_EN appends");
+    ViBoolean en = VI_TRUE;
+    ViUInt32 n;
+    viSetAttribute(sim, VI_ATTR_FILE_APPEND_EN, VI_TRUE);
+    viGetAttribute(sim, VI_ATTR_FILE_APPEND_EN, &en);
+    if (!en) { FAIL("attribute not set"); return; }
+    viWrite(sim, (ViBuf)"*IDN?\n", 6, &n);
+    viReadToFile(sim, TMP_FILE, 256, &n);
+    viSetAttribute(sim, VI_ATTR_FILE_APPEND_EN, VI_FALSE);
+    if (file_size(TMP_FILE, NULL, 0) != 2007 + (long)n) { FAIL("not appended"); return; }
+
+    viWrite(sim, (ViBuf)"*IDN?\n", 6, &n);
+    viReadToFile(sim, TMP_FILE, 256, &n);
+    if (file_size(TMP_FILE, NULL, 0) != (long)n) { FAIL("not truncated"); return; }
+    PASS();
+}
+
+void test_max_count(ViSession sim) {
+    TEST("Count limit leaves the rest queued");
+    ViUInt32 n;
+    char rest[64];
+    viWrite(sim, (ViBuf)"*IDN?\n", 6, &n);
+    if (viReadToFile(sim, TMP_FILE, 8, &n) != VI_SUCCESS_MAX_CNT || n != 8) { FAIL("status"); return; }
+    if (viRead(sim, (ViBuf)rest, sizeof(rest), &n) != VI_SUCCESS_TERM_CHAR) { FAIL("remainder"); return; }
+    PASS();
+}
+
+void test_write_from_file(ViSession sim) {
+    TEST("viWriteFromFile sends file contents");
+    FILE *f = fopen(TMP_FILE, "wb");
+    fputs("CONF:VOLT 7.5\n", f);
+    fclose(f);
+    ViUInt32 n;
+    char buf[32];
+    if (viWriteFromFile(sim, TMP_FILE, 1000, &n) != VI_SUCCESS || n != 14) { FAIL("write"); return; }
+    viWrite(sim, (ViBuf)"MEAS:VOLT?\n", 11, &n);
+    viRead(sim, (ViBuf)buf, sizeof(buf) - 1, &n);
+    buf[n] = '\0';
+    if (strcmp(buf, "7.5\n") != 0) { FAIL(buf); return; }
+    if (viWriteFromFile(sim, "/nonexistent/file", 10, &n) != VI_ERROR_FILE_ACCESS) { FAIL("missing file"); return; }
+    PASS();
+}
+
+static ViStatus query(ViSession vi, const char *cmd, char *buf, ViUInt32 size) {
+    ViUInt32 n = 0;
+    ViStatus st = viWrite(vi, (ViBuf)cmd, (ViUInt32)strlen(cmd), &n);
+    if (st == VI_SUCCESS) st = viRead(vi, (ViBuf)buf, size - 1, &n);
+    buf[st >= VI_SUCCESS ? n : 0] = '\0';
+    return st;
+}
+
+static int write_file(const char *text) {
+    FILE *f = fopen(TMP_FILE, "wb");
+    if (!f) return 0;
+    fputs(text, f);
+    fclose(f);
+    return 1;
+}
+
+void test_file_write_seen(ViSession sim) {
+    TEST("File data seen by query cache and adaptive TMO");
+    char r[64];
+    ViUInt32 n = 0, hits0 = 0, hits1 = 0, samples = 0;
+    ovQueryCacheEnable(sim, VI_NULL, 0);
+    ovAdaptiveTimeoutEnable(sim, 0, 0, 0);
+    query(sim, "*IDN?\n", r, sizeof(r));
+    query(sim, "*IDN?\n", r, sizeof(r));
+    viGetAttribute(sim, OV_ATTR_QUERY_CACHE_HITS, &hits0);
+    ViStatus s1 = write_file("*RST\n") ? viWriteFromFile(sim, TMP_FILE, 5, &n) : VI_ERROR_FILE_ACCESS;
+    query(sim, "*IDN?\n", r, sizeof(r));
+    viGetAttribute(sim, OV_ATTR_QUERY_CACHE_HITS, &hits1);
+    /* A query sent from a file is timed when its response is read */
+    ViStatus s2 = write_file("MEAS:VOLT?\n") ? viWriteFromFile(sim, TMP_FILE, 11, &n) : VI_ERROR_FILE_ACCESS;
+    ViStatus s3 = viReadToFile(sim, TMP_FILE, 64, &n);
+    ovAdaptiveTimeoutQuery(sim, "MEAS:VOLT?", VI_NULL, &samples);
+    viSetAttribute(sim, OV_ATTR_QUERY_CACHE_EN, VI_FALSE);
+    ovAdaptiveTimeoutDisable(sim);
+    if (s1 != VI_SUCCESS || s2 != VI_SUCCESS || s3 < VI_SUCCESS) { FAIL("I/O"); return; }
+    if (hits0 != 1 || hits1 != 1) { FAIL("stale answer after *RST"); return; }
+    if (samples != 1) { FAIL("not timed"); return; }
+    PASS();
+}
+
+void test_socket(void) {
+    TEST("SOCKET read/write through file (splice/sendfile)");
+    struct sockaddr_in a = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t al = sizeof(a);
+    int ls = socket(AF_INET, SOCK_STREAM, 0);
+    if (bind(ls, (struct sockaddr*)&a, sizeof(a)) != 0 || listen(ls, 1) != 0) { FAIL("listen"); return; }
+    getsockname(ls, (struct sockaddr*)&a, &al);
+    pthread_t th;
+    pthread_create(&th, NULL, loopback_server, (void*)(intptr_t)ls);
+
+    char rsrc[64];
+    ViSession vi;
+    ViUInt32 n;
+    snprintf(rsrc, sizeof(rsrc), "TCPIP::127.0.0.1::%d::SOCKET", ntohs(a.sin_port));
+    if (viOpen(g_rm, rsrc, VI_NULL, VI_NULL, &vi) != VI_SUCCESS) { FAIL("open"); return; }
+
+    viWrite(vi, (ViBuf)"DATA?\n", 6, &n);
+    ViStatus st = viReadToFile(vi, TMP_FILE, SOCK_BYTES + 100, &n);
+    int ok = (st == VI_SUCCESS_TERM_CHAR && n == SOCK_BYTES);
+    if (ok) {
+        unsigned char *p = (unsigned char*)malloc(SOCK_BYTES);
+        FILE *f = fopen(TMP_FILE, "rb");
+        ok = f && fread(p, 1, SOCK_BYTES, f) == SOCK_BYTES;
+        for (uint32_t i = 0; ok && i < SOCK_BYTES - 1; i++)
+            if (p[i] != (unsigned char)(i % 251)) ok = 0;
+        if (f) fclose(f);
+        free(p);
+    }
+
+    char buf[32] = {0};
+    if (ok) {
+        FILE *f = fopen(TMP_FILE, "wb");
+        fputs("HELLO FROM FILE\n", f);
+        fclose(f);
+        ok = viWriteFromFile(vi, TMP_FILE, 100, &n) == VI_SUCCESS && n == 16 &&
+             viRead(vi, (ViBuf)buf, sizeof(buf) - 1, &n) >= VI_SUCCESS &&
+             strncmp(buf, "GOT 16", 6) == 0;
+    }
+
+    /* A custom termination character ends the transfer where viRead would */
+    if (ok) {
+        viSetAttribute(vi, VI_ATTR_TMO_VALUE, 2000);
+        viSetAttribute(vi, VI_ATTR_TERMCHAR, '\r');
+        viSetAttribute(vi, VI_ATTR_TERMCHAR_EN, VI_TRUE);
+        viWrite(vi, (ViBuf)"TERM?\n", 6, &n);
+        ok = viReadToFile(vi, TMP_FILE, 100, &n) == VI_SUCCESS_TERM_CHAR && n == 6;
+    }
+
+    viClose(vi);
+    pthread_join(th, NULL);
+    close(ls);
+    if (!ok) { FAIL("transfer mismatch"); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA File Transfer Tests ===\n\n");
+
+    if (viOpenDefaultRM(&g_rm) != VI_SUCCESS) return 1;
+
+    ViSession sim;
+    if (ovSimDefine("fileio",
+            "[vars]\nvolt = 0\n"
+            "[commands]\n"
+            "*IDN? = \"OpenVISA,FILEIO,0,1.0\"\n"
+            "*RST = set volt=0\n"
+            "CONFigure:VOLTage = set volt={$1}\n"
+            "MEASure:VOLTage? = \"{volt}\"\n"
+            "CURVe? = block sine 1000 int16\n") != VI_SUCCESS ||
+        viOpen(g_rm, "SIM::fileio::INSTR", VI_NULL, VI_NULL, &sim) != VI_SUCCESS) {
+        printf("  cannot open SIM::fileio::INSTR\n");
+        return 1;
+    }
+
+    test_sim_read_to_file(sim);
+    test_append(sim);
+    test_max_count(sim);
+    test_write_from_file(sim);
+    test_file_write_seen(sim);
+    test_socket();
+
+    viClose(sim);
+    viClose(g_rm);
+    remove(TMP_FILE);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
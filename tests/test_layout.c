@@ -0,0 +1,224 @@
+/*
+ * OpenVISA - Session table layout and interned resource string tests
+ *
+ * LegacyResource / LegacySession reproduce the layout sessions had when
+ * each one embedded its resource strings, to compare size and the cost of
+ * finding a session by handle and calling into its transport.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "visa.h"
+#include "openvisa.h"
+#include "testutil.h"
+#include "core/session.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define CACHE_LINE  64
+#define LOOKUPS     2000000
+
+typedef struct {
+    OvIntfType  intfType;
+    ViUInt16    intfNum;
+    char        host[256];
+    ViUInt16    port;
+    char        deviceName[256];
+    ViUInt16    usbVid;
+    ViUInt16    usbPid;
+    char        usbSerial[128];
+    ViUInt16    usbIntfNum;
+    int         comPort;
+    int         gpibAddr;
+    int         gpibSecAddr;
+    bool        isSocket;
+    bool        isHiSLIP;
+    char        raw[512];
+} LegacyResource;
+
+typedef struct {
+    bool        active;
+    bool        isRM;
+    ViSession   handle;
+    LegacyResource resource;
+    OvTransport *transport;
+    ViUInt32    timeout;
+    ViChar      termChar;
+    bool        termCharEn;
+    bool        sendEndEn;
+    bool        fileAppendEn;
+    int         brokerLease;
+} LegacySession;
+
+static LegacySession g_legacy[OV_MAX_SESSIONS];
+static ViSession g_rm;
+
+static LegacySession *legacy_find(ViSession handle) {
+    for (int i = 0; i < OV_MAX_SESSIONS; i++)
+        if (g_legacy[i].active && g_legacy[i].handle == handle) return &g_legacy[i];
+    return NULL;
+}
+
+void test_sizes(void) {
+    TEST("Hot session fields share the first cache line");
+    printf("(session %zu -> %zu B, resource %zu -> %zu B) ",
+           sizeof(LegacySession), sizeof(OvSession), sizeof(LegacyResource), sizeof(OvResource));
+    if (offsetof(OvSession, timeout) + sizeof(ViUInt32) > CACHE_LINE ||
+        offsetof(OvSession, transport) + sizeof(OvTransport*) > CACHE_LINE ||
+        offsetof(OvSession, termChar) >= CACHE_LINE) { FAIL("hot field past line 0"); return; }
+    if (sizeof(OvResource) > CACHE_LINE) { FAIL("resource larger than a cache line"); return; }
+    if (sizeof(OvSession) * 8 > sizeof(LegacySession)) { FAIL("session not compacted"); return; }
+    PASS();
+}
+
+void test_interned(void) {
+    TEST("Equal resource strings share one interned copy");
+    OvResource a, b, c;
+    if (ov_parse_rsrc("TCPIP::10.0.0.7::hislip0::INSTR", &a) != VI_SUCCESS ||
+        ov_parse_rsrc("TCPIP::10.0.0.7::hislip0::INSTR", &b) != VI_SUCCESS ||
+        ov_parse_rsrc("TCPIP::10.0.0.8::hislip0::INSTR", &c) != VI_SUCCESS) { FAIL("parse"); return; }
+    int ok = a.str == b.str && a.str != c.str && a.str->refs == 2 &&
+             strcmp(ov_rsrc_raw(&b), "TCPIP::10.0.0.7::hislip0::INSTR") == 0 &&
+             strcmp(ov_rsrc_host(&b), "10.0.0.7") == 0 &&
+             strcmp(ov_rsrc_device(&b), "hislip0") == 0 &&
+             strcmp(ov_rsrc_usb_serial(&b), "") == 0;
+    ov_rsrc_release(&a);
+    ok = ok && a.str == NULL && b.str->refs == 1;
+    ov_rsrc_release(&b);
+    ov_rsrc_release(&c);
+    if (!ok) { FAIL("not shared"); return; }
+    PASS();
+}
+
+void test_copy_reference(void) {
+    TEST("Copied resource outlives the original");
+    OvResource a, copy;
+    if (ov_parse_rsrc("visa://lab-pc:3537/GPIB0::5::INSTR", &a) != VI_SUCCESS) { FAIL("parse"); return; }
+    copy = a;
+    ov_rsrc_retain(&copy);
+    ov_rsrc_release(&a);
+    int ok = strcmp(ov_rsrc_host(&copy), "lab-pc") == 0 &&
+             strcmp(ov_rsrc_device(&copy), "GPIB0::5::INSTR") == 0 && copy.port == 3537;
+    ov_rsrc_release(&copy);
+    if (!ok) { FAIL("fields lost"); return; }
+    PASS();
+}
+
+void test_too_long(void) {
+    TEST("Overlong resource string rejected");
+    char name[OV_RSRC_MAX_LEN + 16];
+    memcpy(name, "SIM::", 5);
+    memset(name + 5, 'x', sizeof(name) - 6);
+    name[sizeof(name) - 1] = '\0';
+    OvResource r;
+    if (ov_parse_rsrc(name, &r) != VI_ERROR_INV_RSRC_NAME || r.str) { FAIL("accepted"); return; }
+    PASS();
+}
+
+void test_long_name_attr(void) {
+    TEST("Long resource name fits the caller's buffer");
+    char dev[300 + 1];
+    memset(dev, 'y', sizeof(dev) - 1);
+    dev[sizeof(dev) - 1] = '\0';
+    char rsrc[sizeof(dev) + 16];
+    snprintf(rsrc, sizeof(rsrc), "SIM::%s::INSTR", dev);
+    ovSimDefine(dev, "[commands]\n*IDN? = \"OpenVISA,LONG,0,1.0\"\n");
+    ViSession vi;
+    if (viOpen(g_rm, rsrc, VI_NULL, VI_NULL, &vi) != VI_SUCCESS) { FAIL("open"); return; }
+    struct { char name[OV_DESC_SIZE]; char guard[16]; } out;
+    memset(&out, 0x5A, sizeof(out));
+    ViStatus st = viGetAttribute(vi, VI_ATTR_RSRC_NAME, out.name);
+    viClose(vi);
+    int intact = 1;
+    for (size_t i = 0; i < sizeof(out.guard); i++) intact = intact && out.guard[i] == 0x5A;
+    if (st != VI_SUCCESS || !intact) { FAIL("buffer overrun"); return; }
+    if (strlen(out.name) != OV_DESC_SIZE - 1 || strncmp(out.name, rsrc, OV_DESC_SIZE - 1) != 0) {
+        FAIL("name"); return;
+    }
+    PASS();
+}
+
+void test_stale_handle(void) {
+    TEST("Closed handle invalid after its slot is reused");
+    ViSession a, b;
+    ViUInt16 stb;
+    if (viOpen(g_rm, "SIM::layout::INSTR", VI_NULL, VI_NULL, &a) != VI_SUCCESS) { FAIL("open"); return; }
+    viClose(a);
+    if (viOpen(g_rm, "SIM::layout::INSTR", VI_NULL, VI_NULL, &b) != VI_SUCCESS) { FAIL("reopen"); return; }
+    int ok = a != b && ov_session_find(a) == NULL && viReadSTB(a, &stb) == VI_ERROR_INV_OBJECT &&
+             ov_session_find(b) != NULL;
+    viClose(b);
+    if (!ok) { FAIL("stale handle accepted"); return; }
+    PASS();
+}
+
+void test_lookup_dispatch(void) {
+    TEST("Lookup plus dispatch against the old table");
+    static ViSession handles[OV_MAX_SESSIONS];
+    ViUInt32 n = 0;
+    while (n < OV_MAX_SESSIONS &&
+           viOpen(g_rm, "SIM::layout::INSTR", VI_NULL, VI_NULL, &handles[n]) == VI_SUCCESS) n++;
+    if (n < OV_MAX_SESSIONS / 2) { FAIL("could not fill the table"); return; }
+
+    /* The same sessions in the old layout, sharing the live transports */
+    for (ViUInt32 i = 0; i < n; i++) {
+        OvSession *s = ov_session_find(handles[i]);
+        g_legacy[i].active = true;
+        g_legacy[i].handle = handles[i];
+        g_legacy[i].transport = s->transport;
+        strcpy(g_legacy[i].resource.raw, ov_rsrc_raw(&s->resource));
+    }
+
+    ViUInt16 stb;
+    ViUInt32 calls = 0;
+    ViUInt32 found = 0;
+    double t0 = now_us();
+    for (ViUInt32 i = 0; i < LOOKUPS; i++) {
+        LegacySession *s = legacy_find(handles[(i * 37u) % n]);
+        calls += s->transport->readSTB(s->transport, &stb) == VI_SUCCESS;
+    }
+    double t_old = (now_us() - t0) * 1e3 / LOOKUPS;
+    t0 = now_us();
+    for (ViUInt32 i = 0; i < LOOKUPS; i++) {
+        ViSession h = handles[(i * 37u) % n];
+        OvSession *s = ov_session_find(h);
+        found += s->handle == h;
+        calls += s->transport->readSTB(s->transport, &stb) == VI_SUCCESS;
+    }
+    double t_new = (now_us() - t0) * 1e3 / LOOKUPS;
+
+    for (ViUInt32 i = 0; i < n; i++) viClose(handles[i]);
+    printf("(%u sessions: %.1f -> %.1f ns) ", (unsigned)n, t_old, t_new);
+    if (found != LOOKUPS) { FAIL("wrong session"); return; }
+    if (calls != 2u * LOOKUPS) { FAIL("dispatch failed"); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA Session Layout Tests ===\n\n");
+
+    ovSimDefine("layout", "[commands]\n*IDN? = \"OpenVISA,LAYOUT,0,1.0\"\n");
+    viOpenDefaultRM(&g_rm);
+
+    test_sizes();
+    test_interned();
+    test_copy_reference();
+    test_too_long();
+    test_long_name_attr();
+    test_stale_handle();
+    test_lookup_dispatch();
+
+    viClose(g_rm);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,161 @@
+/*
+ * OpenVISA - Parallel open (ovOpenMany) tests
+ *
+ * A loopback HiSLIP server takes OPEN_DELAY_MS to answer Initialize, like
+ * an instrument busy setting up a session, so a station of NDEV instruments
+ * takes NDEV x OPEN_DELAY_MS to open one after the other.  The server
+ * counts how many Initializes it is answering at once.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "visa.h"
+#include "openvisa.h"
+#include "testutil.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define NDEV            16
+#define OPEN_DELAY_MS   100
+
+static ViSession g_rm;
+static char g_rsrc[64];
+static volatile uint32_t g_next_session = 1;
+static volatile uint32_t g_opening, g_peak;     /* Initializes being answered, most at once */
+
+static int recv_all(int c, uint8_t *buf, size_t len) {
+    while (len) {
+        ssize_t n = recv(c, buf, len, 0);
+        if (n <= 0) return -1;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static void send_hdr(int c, uint8_t type, uint32_t param) {
+    uint8_t h[16] = { 'H', 'S', type, 0,
+                      (uint8_t)(param >> 24), (uint8_t)(param >> 16), (uint8_t)(param >> 8), (uint8_t)param };
+    send(c, h, sizeof(h), MSG_NOSIGNAL);
+}
+
+/* Initialize -> (delay) InitializeResponse, AsyncInitialize -> response */
+static void *hislip_conn(void *arg) {
+    int c = (int)(intptr_t)arg;
+    uint8_t h[16], skip[256];
+    while (recv_all(c, h, sizeof(h)) == 0) {
+        uint64_t len = 0;
+        for (int i = 8; i < 16; i++) len = (len << 8) | h[i];
+        while (len) {
+            size_t n = len < sizeof(skip) ? (size_t)len : sizeof(skip);
+            if (recv_all(c, skip, n) != 0) goto done;
+            len -= n;
+        }
+        if (h[2] == 0) {
+            uint32_t now = __sync_add_and_fetch(&g_opening, 1), p;
+            while ((p = g_peak) < now && !__sync_bool_compare_and_swap(&g_peak, p, now)) {}
+            usleep(OPEN_DELAY_MS * 1000);
+            __sync_sub_and_fetch(&g_opening, 1);
+            uint32_t id = __sync_fetch_and_add(&g_next_session, 1) & 0xFFFF;
+            send_hdr(c, 1, (1u << 24) | id);
+        } else if (h[2] == 17) {
+            send_hdr(c, 18, 0);
+        }
+    }
+done:
+    close(c);
+    return NULL;
+}
+
+void test_parallel(void) {
+    TEST("Station opens its instruments concurrently");
+    ViSession seq[NDEV], par[NDEV];
+    ViStatus st[NDEV];
+    ViConstRsrc names[NDEV];
+    for (int i = 0; i < NDEV; i++) names[i] = g_rsrc;
+
+    g_peak = 0;
+    for (int i = 0; i < NDEV; i++) viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &seq[i]);
+    uint32_t peak_seq = g_peak;
+    for (int i = 0; i < NDEV; i++) viClose(seq[i]);
+
+    g_peak = 0;
+    ViStatus rc = ovOpenMany(g_rm, names, NDEV, 0, 0, par, st);
+    uint32_t peak_par = g_peak;
+
+    int distinct = 1;
+    for (int i = 0; i < NDEV; i++)
+        for (int j = i + 1; j < NDEV; j++) distinct = distinct && par[i] != par[j];
+    for (int i = 0; i < NDEV; i++) viClose(par[i]);
+    printf("(%d opens: %u -> %u at once) ", NDEV, peak_seq, peak_par);
+    if (rc != VI_SUCCESS) { FAIL("open failed"); return; }
+    if (!distinct) { FAIL("handle reused"); return; }
+    if (peak_seq != 1 || peak_par < NDEV / 2) { FAIL("not concurrent"); return; }
+    PASS();
+}
+
+void test_bounded(void) {
+    TEST("maxParallel bounds the workers");
+    ViSession vis[8];
+    ViConstRsrc names[8];
+    for (int i = 0; i < 8; i++) names[i] = g_rsrc;
+    g_peak = 0;
+    ViStatus rc = ovOpenMany(g_rm, names, 8, 0, 2, vis, VI_NULL);
+    uint32_t peak = g_peak;
+    for (int i = 0; i < 8; i++) viClose(vis[i]);
+    if (rc != VI_SUCCESS) { FAIL("open failed"); return; }
+    if (peak > 2) { FAIL("more than 2 at once"); return; }
+    PASS();
+}
+
+void test_per_resource_status(void) {
+    TEST("Per-resource status; good opens kept");
+    ViConstRsrc names[4] = { "SIM::om::INSTR", "NOT A RESOURCE", "SIM::om::INSTR", "SIM::missing::INSTR" };
+    ViSession vis[4];
+    ViStatus st[4];
+    ViStatus rc = ovOpenMany(g_rm, names, 4, 0, 0, vis, st);
+    int ok = rc < VI_SUCCESS &&
+             st[0] == VI_SUCCESS && vis[0] != VI_NULL &&
+             st[1] == VI_ERROR_INV_RSRC_NAME && vis[1] == VI_NULL &&
+             st[2] == VI_SUCCESS && vis[2] != VI_NULL && vis[2] != vis[0] &&
+             st[3] == VI_ERROR_RSRC_NFOUND && vis[3] == VI_NULL;
+    char idn[32];
+    if (ok) ok = viQueryf(vis[2], "*IDN?\n", "%s", idn) >= VI_SUCCESS && strncmp(idn, "OpenVISA,OM", 11) == 0;
+    viClose(vis[0]);
+    viClose(vis[2]);
+    if (!ok) { FAIL("statuses"); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA Parallel Open Tests ===\n\n");
+    signal(SIGPIPE, SIG_IGN);
+    unsetenv("OPENVISA_BROKER");
+    unsetenv("OPENVISA_POOL_IDLE_MS");
+
+    int port;
+    serve(listen_loopback(64, &port), hislip_conn);
+    snprintf(g_rsrc, sizeof(g_rsrc), "TCPIP::127.0.0.1::hislip0,%d::INSTR", port);
+
+    ovSimDefine("om", "[commands]\n*IDN? = \"OpenVISA,OM,0,1.0\"\n");
+    viOpenDefaultRM(&g_rm);
+    test_parallel();
+    test_bounded();
+    test_per_resource_status();
+    viClose(g_rm);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
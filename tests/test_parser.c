@@ -21,7 +21,7 @@ void test_tcpip_socket(void) {
     ViStatus st = ov_parse_rsrc("TCPIP::192.168.1.50::5025::SOCKET", &r);
     if (st != VI_SUCCESS) { FAIL("parse failed"); return; }
     if (r.intfType != OV_INTF_TCPIP) { FAIL("wrong type"); return; }
-    if (strcmp(r.host, "192.168.1.50") != 0) { FAIL("wrong host"); return; }
+    if (strcmp(ov_rsrc_host(&r), "192.168.1.50") != 0) { FAIL("wrong host"); return; }
     if (r.port != 5025) { FAIL("wrong port"); return; }
     if (!r.isSocket) { FAIL("not socket"); return; }
     PASS();
@@ -33,7 +33,7 @@ void test_tcpip_instr(void) {
     ViStatus st = ov_parse_rsrc("TCPIP::192.168.1.50::INSTR", &r);
     if (st != VI_SUCCESS) { FAIL("parse failed"); return; }
     if (r.intfType != OV_INTF_TCPIP) { FAIL("wrong type"); return; }
-    if (strcmp(r.host, "192.168.1.50") != 0) { FAIL("wrong host"); return; }
+    if (strcmp(ov_rsrc_host(&r), "192.168.1.50") != 0) { FAIL("wrong host"); return; }
     if (r.isSocket) { FAIL("should not be socket"); return; }
     PASS();
 }
@@ -43,8 +43,8 @@ void test_tcpip_host_only(void) {
     OvResource r;
     ViStatus st = ov_parse_rsrc("TCPIP::myoscilloscope.local", &r);
     if (st != VI_SUCCESS) { FAIL("parse failed"); return; }
-    if (strcmp(r.host, "myoscilloscope.local") != 0) { FAIL("wrong host"); return; }
-    if (strcmp(r.deviceName, "inst0") != 0) { FAIL("wrong device name"); return; }
+    if (strcmp(ov_rsrc_host(&r), "myoscilloscope.local") != 0) { FAIL("wrong host"); return; }
+    if (strcmp(ov_rsrc_device(&r), "inst0") != 0) { FAIL("wrong device name"); return; }
     PASS();
 }
 
@@ -54,7 +54,7 @@ void test_tcpip_with_board(void) {
     ViStatus st = ov_parse_rsrc("TCPIP2::10.0.0.1::INSTR", &r);
     if (st != VI_SUCCESS) { FAIL("parse failed"); return; }
     if (r.intfNum != 2) { FAIL("wrong board num"); return; }
-    if (strcmp(r.host, "10.0.0.1") != 0) { FAIL("wrong host"); return; }
+    if (strcmp(ov_rsrc_host(&r), "10.0.0.1") != 0) { FAIL("wrong host"); return; }
     PASS();
 }
 
@@ -65,7 +65,17 @@ void test_tcpip_hislip(void) {
     if (st != VI_SUCCESS) { FAIL("parse failed"); return; }
     if (!r.isHiSLIP) { FAIL("not HiSLIP"); return; }
     if (r.port != 4880) { FAIL("wrong port"); return; }
-    if (strcmp(r.deviceName, "hislip0") != 0) { FAIL("wrong device name"); return; }
+    if (strcmp(ov_rsrc_device(&r), "hislip0") != 0) { FAIL("wrong device name"); return; }
+    PASS();
+}
+
+void test_tcpip_hislip_port(void) {
+    TEST("TCPIP::host::hislip0,4881::INSTR");
+    OvResource r;
+    ViStatus st = ov_parse_rsrc("TCPIP::192.168.1.50::hislip0,4881::INSTR", &r);
+    if (st != VI_SUCCESS) { FAIL("parse failed"); return; }
+    if (!r.isHiSLIP || r.port != 4881) { FAIL("wrong port"); return; }
+    if (strcmp(ov_rsrc_device(&r), "hislip0") != 0) { FAIL("wrong device name"); return; }
     PASS();
 }
 
@@ -74,7 +84,7 @@ void test_tcpip_device_name(void) {
     OvResource r;
     ViStatus st = ov_parse_rsrc("TCPIP::192.168.1.50::inst0::INSTR", &r);
     if (st != VI_SUCCESS) { FAIL("parse failed"); return; }
-    if (strcmp(r.deviceName, "inst0") != 0) { FAIL("wrong device name"); return; }
+    if (strcmp(ov_rsrc_device(&r), "inst0") != 0) { FAIL("wrong device name"); return; }
     PASS();
 }
 
@@ -86,7 +96,7 @@ void test_usb(void) {
     if (r.intfType != OV_INTF_USB) { FAIL("wrong type"); return; }
     if (r.usbVid != 0x1234) { FAIL("wrong VID"); return; }
     if (r.usbPid != 0x5678) { FAIL("wrong PID"); return; }
-    if (strcmp(r.usbSerial, "MY_SERIAL") != 0) { FAIL("wrong serial"); return; }
+    if (strcmp(ov_rsrc_usb_serial(&r), "MY_SERIAL") != 0) { FAIL("wrong serial"); return; }
     PASS();
 }
 
@@ -147,6 +157,7 @@ int main(void) {
     test_tcpip_host_only();
     test_tcpip_with_board();
     test_tcpip_hislip();
+    test_tcpip_hislip_port();
     test_tcpip_device_name();
     test_usb();
     test_asrl();
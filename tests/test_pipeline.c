@@ -0,0 +1,223 @@
+/*
+ * OpenVISA - Command pipeline (ovPipeline*, ovFuture*) tests
+ *
+ * The raw-socket instrument holds its replies until the input has been
+ * quiet for IDLE_MS and then sends them all in one segment, so replies to
+ * queries written ahead would arrive merged.  It echoes each query without
+ * the '?' and counts how many it had unanswered at once.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "visa.h"
+#include "openvisa.h"
+#include "testutil.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define NQ          10
+#define IDLE_MS     20
+
+static ViSession g_rm;
+static ViSession g_dev;
+static char g_rsrc[64];
+static volatile int g_max_unanswered;
+
+static void *instr_conn(void *arg) {
+    int c = (int)(intptr_t)arg;
+    char line[256], out[4096];
+    size_t len = 0, olen = 0;
+    int unanswered = 0;
+    for (;;) {
+        struct pollfd p = { .fd = c, .events = POLLIN };
+        if (poll(&p, 1, olen ? IDLE_MS : -1) == 0) {
+            send(c, out, olen, MSG_NOSIGNAL);
+            olen = 0;
+            unanswered = 0;
+            continue;
+        }
+        char buf[1024];
+        ssize_t n = recv(c, buf, sizeof(buf), 0);
+        if (n <= 0) break;
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] != '\n') {
+                if (len < sizeof(line) - 1) line[len++] = buf[i];
+                continue;
+            }
+            if (len && line[len - 1] == '?' && olen + len + 1 <= sizeof(out)) {
+                memcpy(out + olen, line, len - 1);
+                olen += len - 1;
+                out[olen++] = '\n';
+                if (++unanswered > g_max_unanswered) g_max_unanswered = unanswered;
+            }
+            len = 0;
+        }
+    }
+    close(c);
+    return NULL;
+}
+
+void test_in_order(void) {
+    TEST("Futures matched to responses in order");
+    OvPipeline *pl;
+    if (ovPipelineCreate(g_dev, 0, &pl) != VI_SUCCESS) { FAIL("create"); return; }
+
+    OvFuture f[NQ], w;
+    for (int i = 0; i < NQ; i++) {
+        char cmd[32];
+        snprintf(cmd, sizeof(cmd), "CHAN%d:VOLT?\n", i + 1);
+        ovPipelineQuery(pl, cmd, &f[i]);
+        if (i == 4) ovPipelineWrite(pl, "VOLT 7\n", &w);
+    }
+
+    /* Await out of order: the last first */
+    for (int k = NQ - 1; k >= 0; k--) {
+        char buf[32], expect[32];
+        ViUInt32 n;
+        ViStatus st = ovFutureWait(pl, f[k], (ViBuf)buf, sizeof(buf), &n);
+        snprintf(expect, sizeof(expect), "%s%d\n", k < 5 ? "0:" : "7:", k + 1);
+        if (st != VI_SUCCESS_TERM_CHAR || n != strlen(expect) || memcmp(buf, expect, n) != 0) {
+            ovPipelineClose(pl); FAIL("wrong response"); return;
+        }
+    }
+    if (ovFutureWait(pl, w, VI_NULL, 0, VI_NULL) != VI_SUCCESS) { ovPipelineClose(pl); FAIL("write future"); return; }
+    if (ovFutureWait(pl, f[0], VI_NULL, 0, VI_NULL) != VI_ERROR_INV_JOB_ID) {
+        ovPipelineClose(pl); FAIL("released future accepted"); return;
+    }
+    ovPipelineClose(pl);
+    PASS();
+}
+
+void test_budget(void) {
+    TEST("Input budget limits write-ahead");
+    OvPipeline *pl;
+    /* Each query is 12 bytes: a 13-byte budget allows only one in flight */
+    ovPipelineCreate(g_dev, 13, &pl);
+    OvFuture f[4];
+    for (int i = 0; i < 4; i++) ovPipelineQuery(pl, "CHAN1:VOLT?\n", &f[i]);
+    ViStatus st = ovPipelineWaitAll(pl);
+    char buf[32];
+    ViUInt32 n;
+    ViStatus st3 = ovFutureWait(pl, f[3], (ViBuf)buf, sizeof(buf), &n);
+    ovPipelineClose(pl);
+    int ok = st == VI_SUCCESS && st3 == VI_SUCCESS_TERM_CHAR && n == 4 && memcmp(buf, "7:1\n", 4) == 0;
+
+    /* Read behind its back: the simulator has only the first query's
+     * response, and a read with nothing queued fails at once */
+    ovPipelineCreate(g_dev, 13, &pl);
+    for (int i = 0; i < 4; i++) ovPipelineQuery(pl, "CHAN1:VOLT?\n", &f[i]);
+    ViStatus r1 = viRead(g_dev, (ViBuf)buf, sizeof(buf), &n);
+    ViStatus r2 = viRead(g_dev, (ViBuf)buf, sizeof(buf), &n);
+    ovPipelineClose(pl);
+    viClear(g_dev);
+    if (!ok) { FAIL("results"); return; }
+    if (r1 != VI_SUCCESS_TERM_CHAR || r2 != VI_ERROR_TMO) { FAIL("budget exceeded"); return; }
+    PASS();
+}
+
+void test_errors(void) {
+    TEST("Failed query reported on its own future");
+    OvPipeline *pl;
+    ovPipelineCreate(g_dev, 0, &pl);
+    OvFuture bad, good;
+    ovPipelineQuery(pl, "NOPE?\n", &bad);       /* no response: read times out */
+    ViStatus sb = ovFutureWait(pl, bad, VI_NULL, 0, VI_NULL);
+    ovPipelineQuery(pl, "CHAN2:VOLT?\n", &good);
+    char buf[32];
+    ViUInt32 n;
+    ViStatus sg = ovFutureWait(pl, good, (ViBuf)buf, sizeof(buf), &n);
+    ovPipelineClose(pl);
+    if (sb != VI_ERROR_TMO) { FAIL("missing error"); return; }
+    if (sg != VI_SUCCESS_TERM_CHAR || n != 4 || memcmp(buf, "7:2\n", 4) != 0) { FAIL("next query"); return; }
+    PASS();
+}
+
+void test_raw_socket(void) {
+    TEST("Raw socket keeps one query in flight");
+    ViSession vi = VI_NULL;
+    if (viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi) != VI_SUCCESS) { FAIL("open"); return; }
+    viSetAttribute(vi, VI_ATTR_TMO_VALUE, 1000);
+    OvPipeline *pl;
+    ovPipelineCreate(vi, 0, &pl);
+    OvFuture f[4];
+    for (int i = 0; i < 4; i++) {
+        char cmd[16];
+        snprintf(cmd, sizeof(cmd), "MEAS%d?\n", i + 1);
+        ovPipelineQuery(pl, cmd, &f[i]);
+    }
+    int ok = 1;
+    for (int i = 0; i < 4; i++) {
+        char buf[32], expect[16];
+        ViUInt32 n = 0;
+        ViStatus st = ovFutureWait(pl, f[i], (ViBuf)buf, sizeof(buf), &n);
+        snprintf(expect, sizeof(expect), "MEAS%d\n", i + 1);
+        ok = ok && st == VI_SUCCESS_TERM_CHAR && n == strlen(expect) && memcmp(buf, expect, n) == 0;
+    }
+    ovPipelineClose(pl);
+    viClose(vi);
+    if (!ok) { FAIL("responses merged"); return; }
+    if (g_max_unanswered != 1) { FAIL("queries written ahead"); return; }
+    PASS();
+}
+
+void test_max_pending_raised(void) {
+    TEST("Raised max pending writes queries ahead");
+    ViSession vi = VI_NULL;
+    if (viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi) != VI_SUCCESS) { FAIL("open"); return; }
+    viSetAttribute(vi, VI_ATTR_TMO_VALUE, 200);
+    OvPipeline *pl;
+    ovPipelineCreate(vi, 0, &pl);
+    g_max_unanswered = 0;
+    ViStatus st = ovPipelineSetMaxPending(pl, 3);
+    for (int i = 0; i < 3; i++) ovPipelineQuery(pl, "MEAS?\n", VI_NULL);
+    /* The replies come back merged on a raw socket: only the writes count */
+    ovPipelineClose(pl);
+    viClose(vi);
+    if (st != VI_SUCCESS) { FAIL("set"); return; }
+    if (g_max_unanswered != 3) { FAIL("queries not written ahead"); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA Pipeline Tests ===\n\n");
+    signal(SIGPIPE, SIG_IGN);
+    unsetenv("OPENVISA_BROKER");
+
+    serve_socket(instr_conn, g_rsrc, sizeof(g_rsrc));
+
+    viOpenDefaultRM(&g_rm);
+    ovSimDefine("pipe",
+        "[vars]\n"
+        "volt = 0\n"
+        "[commands]\n"
+        "VOLTage       = set volt={$1}\n"
+        "CHANnel#:VOLTage? = \"{volt}:{#1}\" delay 30\n");
+    if (viOpen(g_rm, "SIM::pipe::INSTR", VI_NULL, VI_NULL, &g_dev) != VI_SUCCESS) {
+        printf("cannot open SIM::pipe::INSTR\n");
+        return 1;
+    }
+
+    test_in_order();
+    test_budget();
+    test_errors();
+    test_raw_socket();
+    test_max_pending_raised();
+
+    viClose(g_dev);
+    viClose(g_rm);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,143 @@
+/*
+ * OpenVISA - Transport plugin tests
+ *
+ * Run with $OPENVISA_PLUGIN_PATH at the build's plugins/ directory, which
+ * holds the bundled ovt_* modules and the ovt_testloop test modules.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+#include "visa.h"
+#include "openvisa.h"
+#include "core/session.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#ifdef __APPLE__
+    #define EXT ".dylib"
+#else
+    #define EXT ".so"
+#endif
+
+static ViSession g_rm;
+
+/* Whether the module is mapped into the process, without loading it */
+static int module_loaded(const char *name) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s" EXT, getenv("OPENVISA_PLUGIN_PATH"), name);
+    void *h = dlopen(path, RTLD_NOW | RTLD_NOLOAD);
+    if (h) dlclose(h);
+    return h != NULL;
+}
+
+void test_lazy_bundled(void) {
+    TEST("Bundled USB transport loaded on first open");
+    ViSession vi;
+    if (module_loaded("ovt_usbtmc")) { FAIL("loaded at startup"); return; }
+    ViUInt16 type, num;
+    viParseRsrc(g_rm, "USB::0x0957::0x1796::X::INSTR", &type, &num);
+    if (module_loaded("ovt_usbtmc")) { FAIL("loaded by parse"); return; }
+    if (viOpen(g_rm, "USB::0x0957::0x1796::X::INSTR", VI_NULL, 100, &vi) == VI_SUCCESS) viClose(vi);
+    if (!module_loaded("ovt_usbtmc")) { FAIL("not loaded by open"); return; }
+    PASS();
+}
+
+void test_register_parse(void) {
+    TEST("Registered prefix parses");
+    OvResource r;
+    if (ov_parse_rsrc("LOOP::a::INSTR", &r) != VI_ERROR_INV_RSRC_NAME) { FAIL("parsed unregistered"); return; }
+    if (ovTransportRegister("LOOP", "ovt_testloop") != VI_SUCCESS) { FAIL("register"); return; }
+    if (ov_parse_rsrc("loop2::a::INSTR", &r) != VI_SUCCESS) { FAIL("parse"); return; }
+    int ok = r.intfType >= OV_INTF_PLUGIN && r.intfNum == 2 && strcmp(ov_rsrc_device(&r), "a::INSTR") == 0;
+    ov_rsrc_release(&r);
+    if (!ok) { FAIL("wrong fields"); return; }
+    if (ov_parse_rsrc("LOOPY::a", &r) != VI_ERROR_INV_RSRC_NAME) { FAIL("prefix of a longer word"); return; }
+    PASS();
+}
+
+void test_register_refused(void) {
+    TEST("Core and malformed prefixes refused");
+    if (ovTransportRegister("tcpip", "ovt_testloop") != VI_ERROR_INV_SETUP ||
+        ovTransportRegister("SIM", "ovt_testloop") != VI_ERROR_INV_SETUP ||
+        ovTransportRegister("L00P", "ovt_testloop") != VI_ERROR_INV_SETUP ||
+        ovTransportRegister("", "ovt_testloop") != VI_ERROR_INV_SETUP) { FAIL("accepted"); return; }
+    PASS();
+}
+
+void test_plugin_io(void) {
+    TEST("I/O through a plugin transport");
+    if (module_loaded("ovt_testloop")) { FAIL("loaded by register"); return; }
+    ViSession vi;
+    if (viOpen(g_rm, "LOOP::bench::INSTR", VI_NULL, VI_NULL, &vi) != VI_SUCCESS) { FAIL("open"); return; }
+    char buf[32];
+    ViUInt32 n = 0;
+    ViStatus st = viWrite(vi, (ViBuf)"ping\n", 5, &n);
+    if (st == VI_SUCCESS) st = viRead(vi, (ViBuf)buf, sizeof(buf), &n);
+    viClose(vi);
+    if (st != VI_SUCCESS || n != 5 || memcmp(buf, "ping\n", 5) != 0) { FAIL("echo"); return; }
+    if (viOpen(g_rm, "LOOP::broken", VI_NULL, VI_NULL, &vi) != VI_ERROR_RSRC_NFOUND) { FAIL("open status"); return; }
+    PASS();
+}
+
+void test_bad_abi(void) {
+    TEST("Module built for another ABI refused");
+    ViSession vi;
+    ovTransportRegister("BAD", "ovt_testloop_badabi");
+    ViStatus st = viOpen(g_rm, "BAD::x", VI_NULL, VI_NULL, &vi);
+    if (st == VI_SUCCESS) viClose(vi);
+    if (st != VI_ERROR_NSUP_OPER) { FAIL("wrong status"); return; }
+    PASS();
+}
+
+void test_missing(void) {
+    TEST("Missing module reports NSUP_OPER");
+    ViSession vi;
+    ovTransportRegister("GONE", "ovt_no_such_module");
+    ViStatus st = viOpen(g_rm, "GONE::x", VI_NULL, VI_NULL, &vi);
+    if (st == VI_SUCCESS) viClose(vi);
+    if (st != VI_ERROR_NSUP_OPER) { FAIL("wrong status"); return; }
+    PASS();
+}
+
+void test_replace(void) {
+    TEST("Re-registering points a prefix at a new module");
+    ViSession vi;
+    ovTransportRegister("BAD", "ovt_testloop");
+    ViStatus st = viOpen(g_rm, "BAD::x", VI_NULL, VI_NULL, &vi);
+    if (st == VI_SUCCESS) viClose(vi);
+    if (st != VI_SUCCESS) { FAIL("still refused"); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA Transport Plugin Tests ===\n\n");
+    if (!getenv("OPENVISA_PLUGIN_PATH")) {
+        printf("  OPENVISA_PLUGIN_PATH not set\n");
+        return 1;
+    }
+    viOpenDefaultRM(&g_rm);
+
+#ifdef OPENVISA_TRANSPORT_PLUGINS
+    test_lazy_bundled();
+#endif
+    test_register_parse();
+    test_register_refused();
+    test_plugin_io();
+    test_bad_abi();
+    test_missing();
+    test_replace();
+
+    viClose(g_rm);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
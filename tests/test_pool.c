@@ -0,0 +1,184 @@
+/*
+ * OpenVISA - in-process connection reuse pool tests
+ *
+ * A loopback raw-socket instrument numbers its connections and the
+ * responses on each, so the tests can tell a reused connection from a fresh
+ * one and a drained response from a stale one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "visa.h"
+#include "openvisa.h"
+#include "testutil.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static ViSession g_rm;
+static char g_rsrc[64];
+static volatile int g_accepts;
+static volatile int g_closes;
+static volatile int g_last_fd = -1;
+
+/* Answers every line with "conn <n> <seq>" */
+static void *instr_conn(void *arg) {
+    int c = (int)(intptr_t)arg;
+    int id = __sync_add_and_fetch(&g_accepts, 1);
+    int seq = 0;
+    g_last_fd = c;
+    char buf[256];
+    ssize_t n;
+    while ((n = recv(c, buf, sizeof(buf), 0)) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] != '\n') continue;
+            char resp[32];
+            int len = snprintf(resp, sizeof(resp), "conn %d %d\n", id, ++seq);
+            send(c, resp, (size_t)len, MSG_NOSIGNAL);
+        }
+    }
+    __sync_add_and_fetch(&g_closes, 1);
+    close(c);
+    return NULL;
+}
+
+static int query(ViSession vi, int *seq) {
+    char buf[32];
+    ViUInt32 n;
+    if (viWrite(vi, (ViBuf)"*IDN?\n", 6, &n) != VI_SUCCESS) return -1;
+    if (viRead(vi, (ViBuf)buf, sizeof(buf) - 1, &n) < VI_SUCCESS) return -1;
+    buf[n] = '\0';
+    int id = -1, s = -1;
+    sscanf(buf, "conn %d %d", &id, &s);
+    if (seq) *seq = s;
+    return id;
+}
+
+static int open_query_close(int *seq) {
+    ViSession vi;
+    if (viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi) != VI_SUCCESS) return -1;
+    int id = query(vi, seq);
+    viClose(vi);
+    return id;
+}
+
+void test_disabled(void) {
+    TEST("Pool off by default");
+    int a = open_query_close(NULL), b = open_query_close(NULL);
+    if (a < 0 || b < 0 || a == b) { FAIL("connection reused"); return; }
+    PASS();
+}
+
+void test_reuse(void) {
+    TEST("Repeated open/close reuses one connection");
+    ovPoolConfigure(2000, 0);
+    OvPoolStats before, after;
+    ovPoolGetStats(&before);
+    int accepts = g_accepts;
+    double best = 1e9;
+    int first = -1;
+    for (int i = 0; i < 5; i++) {
+        ViSession vi;
+        double t0 = now_us();
+        if (viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi) != VI_SUCCESS) { FAIL("open"); return; }
+        double dt = now_us() - t0;
+        if (i > 0 && dt < best) best = dt;
+        int id = query(vi, NULL);
+        viClose(vi);
+        if (i == 0) first = id;
+        else if (id != first) { FAIL("new connection"); return; }
+    }
+    ovPoolGetStats(&after);
+    if (g_accepts != accepts + 1) { FAIL("extra connects"); return; }
+    if (after.hits - before.hits != 4 || after.misses - before.misses != 1) { FAIL("stats"); return; }
+    if (after.idle != 1) { FAIL("not parked"); return; }
+    printf("(open %.1f us) ", best);
+    PASS();
+}
+
+void test_drain(void) {
+    TEST("Unread response drained before parking");
+    ViSession vi;
+    ViUInt32 n;
+    int seq = 0, seq2 = 0;
+    viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi);
+    int id = query(vi, &seq);
+    viWrite(vi, (ViBuf)"*IDN?\n", 6, &n);          /* response seq+1 left unread */
+    usleep(20000);
+    viClose(vi);
+    int id2 = open_query_close(&seq2);
+    if (id2 != id) { FAIL("not reused"); return; }
+    if (seq2 != seq + 2) { FAIL("stale response read"); return; }
+    PASS();
+}
+
+void test_health(void) {
+    TEST("Connection closed by peer is not reused");
+    int id = open_query_close(NULL);                /* parked */
+    OvPoolStats before, after;
+    ovPoolGetStats(&before);
+    shutdown(g_last_fd, SHUT_RDWR);
+    usleep(20000);
+    int id2 = open_query_close(NULL);
+    ovPoolGetStats(&after);
+    if (id2 < 0 || id2 == id) { FAIL("dead connection handed out"); return; }
+    if (after.stale != before.stale + 1) { FAIL("stale not counted"); return; }
+    PASS();
+}
+
+void test_expiry(void) {
+    TEST("Idle connection closed after the idle time");
+    ovPoolConfigure(50, 0);
+    int closes = g_closes;
+    open_query_close(NULL);
+    usleep(200000);
+    OvPoolStats st;
+    ovPoolGetStats(&st);
+    if (st.idle != 0 || st.expired == 0) { FAIL("still parked"); return; }
+    if (g_closes <= closes) { FAIL("socket left open"); return; }
+    PASS();
+}
+
+void test_disable(void) {
+    TEST("Disabling closes parked connections");
+    ovPoolConfigure(10000, 0);
+    open_query_close(NULL);
+    int closes = g_closes;
+    ovPoolConfigure(0, 0);
+    usleep(20000);
+    OvPoolStats st;
+    ovPoolGetStats(&st);
+    if (st.idle != 0 || g_closes != closes + 1) { FAIL("still parked"); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA Connection Pool Tests ===\n\n");
+    signal(SIGPIPE, SIG_IGN);
+    unsetenv("OPENVISA_POOL_IDLE_MS");
+    unsetenv("OPENVISA_BROKER");
+
+    serve_socket(instr_conn, g_rsrc, sizeof(g_rsrc));
+
+    viOpenDefaultRM(&g_rm);
+    test_disabled();
+    test_reuse();
+    test_drain();
+    test_health();
+    test_expiry();
+    test_disable();
+    viClose(g_rm);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
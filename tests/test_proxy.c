@@ -0,0 +1,301 @@
+/*
+ * OpenVISA - openvisa-proxy daemon / PROXY:: transport tests
+ *
+ * Usage: test_proxy <path-to-openvisa-proxy>
+ * Starts the daemon on a private socket, serving one simulated instrument.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "visa.h"
+#include "openvisa.h"
+#include "testutil.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define NCLIENTS    8
+#define NQUERIES    25
+#define IDN_DELAY   100
+
+static ViSession g_rm;
+static ViSession g_cli[NCLIENTS];
+static pthread_barrier_t g_start;
+
+static ViStatus query(ViSession vi, const char *cmd, char *buf, size_t size) {
+    ViUInt32 n = 0;
+    ViStatus st = viWrite(vi, (ViBuf)cmd, (ViUInt32)strlen(cmd), &n);
+    if (st < VI_SUCCESS) return st;
+    st = viRead(vi, (ViBuf)buf, (ViUInt32)size - 1, &n);
+    buf[st >= VI_SUCCESS ? n : 0] = '\0';
+    return st;
+}
+
+void test_idn(void) {
+    TEST("*IDN? round trip through the daemon");
+    char buf[64];
+    ViStatus st = query(g_cli[0], "*IDN?\n", buf, sizeof(buf));
+    if (st < VI_SUCCESS || strcmp(buf, "ACME,Meter,1,1.0\n") != 0) { FAIL(buf); return; }
+    PASS();
+}
+
+static void *echo_client(void *arg) {
+    int id = (int)(intptr_t)arg;
+    int *bad = (int*)malloc(sizeof(int));
+    *bad = 0;
+    pthread_barrier_wait(&g_start);
+    for (int i = 0; i < NQUERIES; i++) {
+        char cmd[32], expect[32], buf[32];
+        snprintf(cmd, sizeof(cmd), "ECHO%d?\n", id * 1000 + i);
+        snprintf(expect, sizeof(expect), "%d\n", id * 1000 + i);
+        if (query(g_cli[id], cmd, buf, sizeof(buf)) < VI_SUCCESS || strcmp(buf, expect) != 0)
+            (*bad)++;
+    }
+    return bad;
+}
+
+void test_interleave(void) {
+    TEST("Concurrent clients get their own responses");
+    pthread_t th[NCLIENTS];
+    pthread_barrier_init(&g_start, NULL, NCLIENTS);
+    for (int i = 0; i < NCLIENTS; i++)
+        pthread_create(&th[i], NULL, echo_client, (void*)(intptr_t)i);
+    int bad = 0;
+    for (int i = 0; i < NCLIENTS; i++) {
+        void *r;
+        pthread_join(th[i], &r);
+        bad += *(int*)r;
+        free(r);
+    }
+    pthread_barrier_destroy(&g_start);
+    if (bad) { FAIL("mismatched responses"); return; }
+    PASS();
+}
+
+void test_lock(void) {
+    TEST("viLock excludes other clients until unlock/close");
+    ViSession a;
+    char buf[64];
+    ViUInt32 n;
+    if (viOpen(g_rm, "PROXY::meter::INSTR", VI_NULL, VI_NULL, &a) != VI_SUCCESS) { FAIL("open"); return; }
+    if (viLock(a, VI_EXCLUSIVE_LOCK, 1000, VI_NULL, VI_NULL) != VI_SUCCESS) { viClose(a); FAIL("lock"); return; }
+
+    viSetAttribute(g_cli[1], VI_ATTR_TMO_VALUE, 200);
+    ViStatus blocked = viWrite(g_cli[1], (ViBuf)"*RST\n", 5, &n);
+    ViStatus relock  = viLock(g_cli[1], VI_EXCLUSIVE_LOCK, 100, VI_NULL, VI_NULL);
+    ViStatus owner   = query(a, "*IDN?\n", buf, sizeof(buf));
+    viUnlock(a);
+    ViStatus after   = viWrite(g_cli[1], (ViBuf)"*RST\n", 5, &n);
+
+    /* Closing a session drops its lock */
+    viLock(a, VI_EXCLUSIVE_LOCK, 1000, VI_NULL, VI_NULL);
+    viClose(a);
+    ViStatus closed  = viWrite(g_cli[1], (ViBuf)"*RST\n", 5, &n);
+    viSetAttribute(g_cli[1], VI_ATTR_TMO_VALUE, 2000);
+
+    if (blocked != VI_ERROR_TMO || relock != VI_ERROR_TMO) { FAIL("not excluded"); return; }
+    if (owner < VI_SUCCESS) { FAIL("owner blocked"); return; }
+    if (after != VI_SUCCESS || closed != VI_SUCCESS) { FAIL("lock not released"); return; }
+    PASS();
+}
+
+static void *unlock_later(void *arg) {
+    usleep(200 * 1000);
+    viUnlock((ViSession)(intptr_t)arg);
+    return NULL;
+}
+
+void test_write_timeout(void) {
+    TEST("Writes wait for the session timeout");
+    ViSession a, b;
+    ViUInt32 n;
+    char buf[32];
+    if (viOpen(g_rm, "PROXY::meter::INSTR", VI_NULL, VI_NULL, &a) != VI_SUCCESS) { FAIL("open"); return; }
+    if (viOpen(g_rm, "PROXY::meter::INSTR", VI_NULL, VI_NULL, &b) != VI_SUCCESS) { viClose(a); FAIL("open"); return; }
+    /* The last read used 100 ms; the write must use the timeout set after it */
+    viSetAttribute(b, VI_ATTR_TMO_VALUE, 100);
+    query(b, "ECHO1?\n", buf, sizeof(buf));
+    viSetAttribute(b, VI_ATTR_TMO_VALUE, 5000);
+    viLock(a, VI_EXCLUSIVE_LOCK, 1000, VI_NULL, VI_NULL);
+    pthread_t th;
+    pthread_create(&th, NULL, unlock_later, (void*)(intptr_t)a);
+    ViStatus st = viWrite(b, (ViBuf)"*RST\n", 5, &n);
+    pthread_join(th, NULL);
+    viClose(b);
+    viClose(a);
+    if (st != VI_SUCCESS) { FAIL("write timed out"); return; }
+    PASS();
+}
+
+/* A follower must get the whole response, not the leader's last chunk */
+void test_coalesce_chunked(void) {
+    TEST("Coalesced follower gets the whole response");
+    char lead[64], follow[64];
+    ViUInt32 n = 0, total = 0;
+    ViStatus st = viWrite(g_cli[0], (ViBuf)"*IDN?\n", 6, &n);
+    if (st == VI_SUCCESS) st = viWrite(g_cli[1], (ViBuf)"*IDN?\n", 6, &n);
+    while (st >= VI_SUCCESS && total < sizeof(lead) - 1) {
+        st = viRead(g_cli[0], (ViBuf)lead + total, 5, &n);      /* in 5-byte chunks */
+        total += n;
+        if (st != VI_SUCCESS_MAX_CNT) break;
+    }
+    lead[total] = '\0';
+    ViStatus fst = viRead(g_cli[1], (ViBuf)follow, sizeof(follow) - 1, &n);
+    follow[fst >= VI_SUCCESS ? n : 0] = '\0';
+    if (st < VI_SUCCESS || strcmp(lead, "ACME,Meter,1,1.0\n") != 0) { FAIL("leader"); return; }
+    if (fst < VI_SUCCESS || strcmp(follow, lead) != 0) { FAIL(follow); return; }
+    PASS();
+}
+
+static void *idn_client(void *arg) {
+    int id = (int)(intptr_t)arg;
+    char *buf = (char*)calloc(1, 64);
+    pthread_barrier_wait(&g_start);
+    query(g_cli[id], "*IDN?\n", buf, 64);
+    return buf;
+}
+
+/* *IDN? executions on the instrument so far: it appends an 'x' to runs */
+static int idn_runs(void) {
+    char buf[256];
+    if (query(g_cli[0], "RUNS?\n", buf, sizeof(buf)) < VI_SUCCESS) return -1;
+    return (int)strspn(buf + 1, "x");
+}
+
+void test_coalesce(void) {
+    TEST("Identical concurrent *IDN? queries coalesced");
+    pthread_t th[NCLIENTS];
+    pthread_barrier_init(&g_start, NULL, NCLIENTS);
+    int runs0 = idn_runs();
+    for (int i = 0; i < NCLIENTS; i++)
+        pthread_create(&th[i], NULL, idn_client, (void*)(intptr_t)i);
+    int bad = 0;
+    for (int i = 0; i < NCLIENTS; i++) {
+        void *r;
+        pthread_join(th[i], &r);
+        if (strcmp((char*)r, "ACME,Meter,1,1.0\n") != 0) bad++;
+        free(r);
+    }
+    pthread_barrier_destroy(&g_start);
+    int runs = idn_runs() - runs0;
+    if (bad) { FAIL("wrong response"); return; }
+    printf("(%d runs for %d queries) ", runs, NCLIENTS);
+    if (runs0 < 0 || runs < 1 || runs > NCLIENTS / 2) { FAIL("not coalesced"); return; }
+    PASS();
+}
+
+static void *stb_client(void *arg) {
+    int id = (int)(intptr_t)arg;
+    int *bad = (int*)malloc(sizeof(int));
+    *bad = 0;
+    pthread_barrier_wait(&g_start);
+    for (int i = 0; i < NQUERIES; i++) {
+        ViUInt16 stb = 0;
+        if (viReadSTB(g_cli[id], &stb) != VI_SUCCESS || (stb & 0x04) == 0) (*bad)++;
+    }
+    return bad;
+}
+
+void test_stb(void) {
+    TEST("Concurrent viReadSTB");
+    pthread_t th[NCLIENTS];
+    pthread_barrier_init(&g_start, NULL, NCLIENTS);
+    for (int i = 0; i < NCLIENTS; i++)
+        pthread_create(&th[i], NULL, stb_client, (void*)(intptr_t)i);
+    int bad = 0;
+    for (int i = 0; i < NCLIENTS; i++) {
+        void *r;
+        pthread_join(th[i], &r);
+        bad += *(int*)r;
+        free(r);
+    }
+    pthread_barrier_destroy(&g_start);
+    if (bad) { FAIL("status byte"); return; }
+    PASS();
+}
+
+void test_unknown(void) {
+    TEST("Unknown instrument name rejected");
+    ViSession vi;
+    if (viOpen(g_rm, "PROXY::nosuch::INSTR", VI_NULL, VI_NULL, &vi) != VI_ERROR_RSRC_NFOUND) {
+        FAIL("opened"); return;
+    }
+    PASS();
+}
+
+int main(int argc, char **argv) {
+    printf("\n=== OpenVISA Proxy Tests ===\n\n");
+    if (argc < 2) {
+        printf("usage: test_proxy <openvisa-proxy>\n");
+        return 1;
+    }
+
+    char dir[] = "/tmp/ovproxy-XXXXXX";
+    if (!mkdtemp(dir)) return 1;
+    char sim[64], sock[64];
+    snprintf(sim, sizeof(sim), "%s/meter.sim", dir);
+    snprintf(sock, sizeof(sock), "%s/proxy.sock", dir);
+    FILE *f = fopen(sim, "w");
+    if (!f) return 1;
+    fprintf(f,
+        "[vars]\n"
+        "stb = 4\n"
+        "runs = -\n"
+        "[commands]\n"
+        "*IDN?  = \"ACME,Meter,1,1.0\" delay %d set runs={runs}x\n"
+        "RUNS?  = \"{runs}\"\n"
+        "*RST   = set stb=4\n"
+        "ECHO#? = \"{#1}\" delay 1\n", IDN_DELAY);
+    fclose(f);
+
+    setenv("OPENVISA_SIM_PATH", dir, 1);
+    setenv("OPENVISA_PROXY_SOCKET", sock, 1);
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl(argv[1], argv[1], "meter=SIM::meter::INSTR", (char*)NULL);
+        _exit(127);
+    }
+
+    viOpenDefaultRM(&g_rm);
+    ViStatus st = VI_ERROR_RSRC_NFOUND;
+    for (int i = 0; i < 200 && st != VI_SUCCESS; i++) {     /* daemon start-up */
+        st = viOpen(g_rm, "PROXY::meter::INSTR", VI_NULL, VI_NULL, &g_cli[0]);
+        if (st != VI_SUCCESS) usleep(10000);
+    }
+    for (int i = 1; i < NCLIENTS && st == VI_SUCCESS; i++)
+        st = viOpen(g_rm, "PROXY::meter::INSTR", VI_NULL, VI_NULL, &g_cli[i]);
+
+    if (st == VI_SUCCESS) {
+        test_idn();
+        test_interleave();
+        test_lock();
+        test_coalesce();
+        test_coalesce_chunked();
+        test_write_timeout();
+        test_stb();
+        test_unknown();
+    } else {
+        printf("cannot reach openvisa-proxy\n");
+        tests_failed++;
+    }
+
+    viClose(g_rm);
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    unlink(sim);
+    rmdir(dir);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
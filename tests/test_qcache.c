@@ -0,0 +1,350 @@
+/*
+ * OpenVISA - Query response cache tests
+ *
+ * The simulated instrument's identity comes from a variable that MODEL
+ * changes, so a stale answer shows that a query was served from the cache
+ * and a fresh one that it reached the instrument.  A loopback raw-socket
+ * instrument sends its *IDN? answer in two segments.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "visa.h"
+#include "openvisa.h"
+#include "testutil.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define QUERIES     20
+
+static const char *SIM_DEF =
+    "[vars]\n"
+    "model = A\n"
+    "volt = 1.5\n"
+    "text = \"\"\n"
+    "[commands]\n"
+    "*IDN?          = \"OpenVISA,{model},0,1.0\" delay 2\n"
+    "*OPT?          = \"OPT1,OPT2\"\n"
+    "SYSTem:VERSion? = \"1999.0\"\n"
+    "*RST           = set volt=0\n"
+    "MODEL          = set model={$1}\n"
+    "DISPlay:TEXT   = set text={$1}\n"
+    "MEASure:VOLTage? = \"{volt}\"\n";
+
+static ViSession g_rm;
+static char g_rsrc[64];
+
+static ViStatus query(ViSession vi, const char *cmd, char *resp, ViUInt32 size) {
+    ViUInt32 n;
+    ViStatus st = viWrite(vi, (ViBuf)cmd, (ViUInt32)strlen(cmd), &n);
+    if (st < VI_SUCCESS) return st;
+    st = viRead(vi, (ViBuf)resp, size - 1, &n);
+    resp[st < VI_SUCCESS ? 0 : n] = '\0';
+    return st;
+}
+
+static ViStatus send_cmd(ViSession vi, const char *cmd) {
+    ViUInt32 n;
+    return viWrite(vi, (ViBuf)cmd, (ViUInt32)strlen(cmd), &n);
+}
+
+static ViSession open_sim(void) {
+    ViSession vi = VI_NULL;
+    viOpen(g_rm, "SIM::qcache::INSTR", VI_NULL, VI_NULL, &vi);
+    return vi;
+}
+
+void test_disabled(void) {
+    TEST("Disabled by default: every query reaches device");
+    ViSession vi = open_sim();
+    char r[64];
+    ViBoolean en = VI_TRUE;
+    query(vi, "*IDN?\n", r, sizeof(r));
+    send_cmd(vi, "MODEL B\n");
+    query(vi, "*IDN?\n", r, sizeof(r));
+    viGetAttribute(vi, OV_ATTR_QUERY_CACHE_EN, &en);
+    viClose(vi);
+    if (en) { FAIL("enabled"); return; }
+    if (strcmp(r, "OpenVISA,B,0,1.0\n") != 0) { FAIL(r); return; }
+    PASS();
+}
+
+void test_hit(void) {
+    TEST("Repeated *IDN? answered from the cache");
+    ViSession vi = open_sim();
+    char r[64];
+    if (ovQueryCacheEnable(vi, VI_NULL, 0) != VI_SUCCESS) { FAIL("enable"); viClose(vi); return; }
+    double t0 = now_ms();
+    query(vi, "*IDN?\n", r, sizeof(r));
+    double t_first = now_ms() - t0;
+    send_cmd(vi, "MODEL B\n");
+    t0 = now_ms();
+    int stale = 0;
+    for (int i = 0; i < QUERIES; i++) {
+        query(vi, i & 1 ? "*idn?\r\n" : "*IDN?\n", r, sizeof(r));
+        stale += strcmp(r, "OpenVISA,A,0,1.0\n") == 0;
+    }
+    double t_cached = (now_ms() - t0) / QUERIES;
+    ViUInt32 hits = 0, misses = 0;
+    viGetAttribute(vi, OV_ATTR_QUERY_CACHE_HITS, &hits);
+    viGetAttribute(vi, OV_ATTR_QUERY_CACHE_MISSES, &misses);
+    viClose(vi);
+    printf("(%.2f ms sent, %.3f ms cached) ", t_first, t_cached);
+    if (stale != QUERIES) { FAIL("query reached the instrument"); return; }
+    if (hits != QUERIES || misses != 1) { FAIL("counters"); return; }
+    PASS();
+}
+
+void test_queryf(void) {
+    TEST("viQueryf served from the cache");
+    ViSession vi = open_sim();
+    char r[64];
+    ovQueryCacheEnable(vi, VI_NULL, 0);
+    query(vi, "*IDN?\n", r, sizeof(r));
+    send_cmd(vi, "MODEL B\n");
+    r[0] = '\0';
+    ViStatus st = viQueryf(vi, "*IDN?\n", "%s", r);
+    viClose(vi);
+    if (st < VI_SUCCESS || strncmp(r, "OpenVISA,A", 10) != 0) { FAIL(r); return; }
+    PASS();
+}
+
+void test_invalidation(void) {
+    TEST("*RST, viClear and flush drop cached answers");
+    ViSession vi = open_sim();
+    char r[64];
+    int ok = 1;
+    ovQueryCacheEnable(vi, VI_NULL, 0);
+
+    query(vi, "*IDN?\n", r, sizeof(r));
+    send_cmd(vi, "MODEL B\n");
+    send_cmd(vi, "*rst\n");
+    query(vi, "*IDN?\n", r, sizeof(r));
+    ok = ok && strcmp(r, "OpenVISA,B,0,1.0\n") == 0;
+
+    send_cmd(vi, "MODEL C\n");
+    viClear(vi);
+    query(vi, "*IDN?\n", r, sizeof(r));
+    ok = ok && strcmp(r, "OpenVISA,C,0,1.0\n") == 0;
+
+    send_cmd(vi, "MODEL D\n");
+    ovQueryCacheFlush(vi);
+    query(vi, "*IDN?\n", r, sizeof(r));
+    ok = ok && strcmp(r, "OpenVISA,D,0,1.0\n") == 0;
+
+    send_cmd(vi, "MODEL E\n");
+    query(vi, "*IDN?\n", r, sizeof(r));
+    ok = ok && strcmp(r, "OpenVISA,D,0,1.0\n") == 0;
+    viClose(vi);
+    if (!ok) { FAIL(r); return; }
+    PASS();
+}
+
+void test_custom_list(void) {
+    TEST("Custom query list; other queries not cached");
+    ViSession vi = open_sim();
+    char r[64];
+    ViConstString list[] = { "*OPT?", "MEAS:VOLT?" };
+    ViConstString bad[] = { "" };
+    int ok = ovQueryCacheEnable(vi, bad, 1) == VI_ERROR_INV_SETUP;
+    ok = ok && ovQueryCacheEnable(vi, list, 2) == VI_SUCCESS;
+    query(vi, "MEAS:VOLT?\n", r, sizeof(r));
+    send_cmd(vi, "*RST\n");                             /* flushes: volt=0 */
+    query(vi, "MEAS:VOLT?\n", r, sizeof(r));
+    ok = ok && strcmp(r, "0\n") == 0;
+    send_cmd(vi, "MODEL B\n");
+    query(vi, "*IDN?\n", r, sizeof(r));             /* not listed */
+    send_cmd(vi, "MODEL C\n");
+    query(vi, "*IDN?\n", r, sizeof(r));
+    ok = ok && strcmp(r, "OpenVISA,C,0,1.0\n") == 0;
+    viClose(vi);
+    if (!ok) { FAIL(r); return; }
+    PASS();
+}
+
+void test_attributes(void) {
+    TEST("Cache attributes: enable, read-only counters");
+    ViSession vi = open_sim();
+    char r[64];
+    ViBoolean en = VI_FALSE;
+    ViUInt32 hits = 1;
+    int ok = viSetAttribute(vi, OV_ATTR_QUERY_CACHE_EN, VI_TRUE) == VI_SUCCESS;
+    viGetAttribute(vi, OV_ATTR_QUERY_CACHE_EN, &en);
+    ok = ok && en == VI_TRUE;
+    query(vi, "SYST:VERS?\n", r, sizeof(r));
+    query(vi, "*OPT?\n", r, sizeof(r));
+    query(vi, "*OPT?\n", r, sizeof(r));
+    viGetAttribute(vi, OV_ATTR_QUERY_CACHE_HITS, &hits);
+    ok = ok && hits == 1 && strcmp(r, "OPT1,OPT2\n") == 0;
+    ok = ok && viSetAttribute(vi, OV_ATTR_QUERY_CACHE_HITS, 0) == VI_ERROR_ATTR_READONLY;
+    ok = ok && viSetAttribute(vi, OV_ATTR_QUERY_CACHE_EN, VI_FALSE) == VI_SUCCESS;
+    viGetAttribute(vi, OV_ATTR_QUERY_CACHE_EN, &en);
+    viGetAttribute(vi, OV_ATTR_QUERY_CACHE_HITS, &hits);
+    ok = ok && en == VI_FALSE && hits == 0;
+    viClose(vi);
+    if (!ok) { FAIL("attributes"); return; }
+    PASS();
+}
+
+void test_small_buffer(void) {
+    TEST("Cached answer read in pieces");
+    ViSession vi = open_sim();
+    char r[64], part[8];
+    ViUInt32 n, total = 0;
+    ovQueryCacheEnable(vi, VI_NULL, 0);
+    query(vi, "*IDN?\n", r, sizeof(r));
+    send_cmd(vi, "*IDN?\n");
+    ViStatus st;
+    do {
+        st = viRead(vi, (ViBuf)part, sizeof(part), &n);
+        if (st < VI_SUCCESS) break;
+        memcpy(r + total, part, n);
+        total += n;
+    } while (st == VI_SUCCESS_MAX_CNT);
+    r[total] = '\0';
+    viClose(vi);
+    if (st < VI_SUCCESS || strcmp(r, "OpenVISA,A,0,1.0\n") != 0) { FAIL(r); return; }
+    PASS();
+}
+
+void test_ordering(void) {
+    TEST("Pipelined queries keep response order");
+    ViSession vi = open_sim();
+    char a[64], b[64], c[64];
+    ViUInt32 n, hits = 0;
+    ovQueryCacheEnable(vi, VI_NULL, 0);
+    query(vi, "*IDN?\n", a, sizeof(a));
+
+    /* A query still owed by the instrument: *IDN? must not jump ahead */
+    send_cmd(vi, "MEAS:VOLT?\n");
+    send_cmd(vi, "*IDN?\n");
+    viRead(vi, (ViBuf)a, sizeof(a) - 1, &n); a[n] = '\0';
+    viRead(vi, (ViBuf)b, sizeof(b) - 1, &n); b[n] = '\0';
+
+    /* A cached answer pending: the next query's reply comes after it */
+    send_cmd(vi, "*IDN?\n");
+    send_cmd(vi, "MEAS:VOLT?\n");
+    viRead(vi, (ViBuf)c, sizeof(c) - 1, &n); c[n] = '\0';
+    int ok = strcmp(a, "1.5\n") == 0 && strcmp(b, "OpenVISA,A,0,1.0\n") == 0 &&
+             strcmp(c, "OpenVISA,A,0,1.0\n") == 0;
+    viRead(vi, (ViBuf)c, sizeof(c) - 1, &n); c[n] = '\0';
+    ok = ok && strcmp(c, "1.5\n") == 0;
+    viGetAttribute(vi, OV_ATTR_QUERY_CACHE_HITS, &hits);
+    viClose(vi);
+    if (!ok) { FAIL("out of order"); return; }
+    if (hits != 1) { FAIL("hit count"); return; }
+    PASS();
+}
+
+void test_read_to_file(void) {
+    TEST("viReadToFile gets the cached answer");
+    ViSession vi = open_sim();
+    char r[64], path[] = "/tmp/ovqcache-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) { viClose(vi); FAIL("mkstemp"); return; }
+    close(fd);
+    ViUInt32 n = 0, hits = 0;
+    ovQueryCacheEnable(vi, VI_NULL, 0);
+    query(vi, "*IDN?\n", r, sizeof(r));
+    send_cmd(vi, "MODEL B\n");
+    send_cmd(vi, "*IDN?\n");
+    ViStatus st = viReadToFile(vi, path, sizeof(r), &n);
+    viGetAttribute(vi, OV_ATTR_QUERY_CACHE_HITS, &hits);
+    viClose(vi);
+    FILE *f = fopen(path, "rb");
+    size_t len = f ? fread(r, 1, sizeof(r) - 1, f) : 0;
+    if (f) fclose(f);
+    unlink(path);
+    r[len] = '\0';
+    if (st < VI_SUCCESS || n != 17 || hits != 1) { FAIL("read"); return; }
+    if (strcmp(r, "OpenVISA,A,0,1.0\n") != 0) { FAIL(r); return; }
+    PASS();
+}
+
+void test_string_arg(void) {
+    TEST("'?' in a string argument is not a query");
+    ViSession vi = open_sim();
+    char r[64];
+    ViUInt32 hits = 0;
+    ovQueryCacheEnable(vi, VI_NULL, 0);
+    query(vi, "*IDN?\n", r, sizeof(r));
+    send_cmd(vi, "DISP:TEXT \"Done?\"\n");
+    query(vi, "*IDN?\n", r, sizeof(r));
+    viGetAttribute(vi, OV_ATTR_QUERY_CACHE_HITS, &hits);
+    viClose(vi);
+    if (hits != 1 || strcmp(r, "OpenVISA,A,0,1.0\n") != 0) { FAIL("no hit"); return; }
+    PASS();
+}
+
+/* *IDN? is answered in two segments 50 ms apart */
+static void *split_conn(void *arg) {
+    int c = (int)(intptr_t)arg;
+    char buf[256];
+    while (recv(c, buf, sizeof(buf), 0) > 0) {
+        send(c, "ACME,", 5, MSG_NOSIGNAL);
+        usleep(50 * 1000);
+        send(c, "Meter\n", 6, MSG_NOSIGNAL);
+    }
+    close(c);
+    return NULL;
+}
+
+void test_partial_read(void) {
+    TEST("Partial socket read is not cached as the answer");
+    ViSession vi = VI_NULL;
+    if (viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi) != VI_SUCCESS) { FAIL("open"); return; }
+    ovQueryCacheEnable(vi, VI_NULL, 0);
+    char r[64];
+    ViUInt32 n, total = 0;
+    ViStatus st = send_cmd(vi, "*IDN?\n");
+    while (st >= VI_SUCCESS && st != VI_SUCCESS_TERM_CHAR && total < sizeof(r) - 1) {
+        st = viRead(vi, (ViBuf)r + total, sizeof(r) - 1 - total, &n);
+        total += n;
+    }
+    ViStatus hit = query(vi, "*IDN?\n", r, sizeof(r));
+    ViUInt32 hits = 0;
+    viGetAttribute(vi, OV_ATTR_QUERY_CACHE_HITS, &hits);
+    viClose(vi);
+    if (st != VI_SUCCESS_TERM_CHAR || hits != 1) { FAIL("no hit"); return; }
+    if (hit != VI_SUCCESS_TERM_CHAR || strcmp(r, "ACME,Meter\n") != 0) { FAIL(r); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA Query Cache Tests ===\n\n");
+    signal(SIGPIPE, SIG_IGN);
+    unsetenv("OPENVISA_BROKER");
+
+    serve_socket(split_conn, g_rsrc, sizeof(g_rsrc));
+
+    ovSimDefine("qcache", SIM_DEF);
+    viOpenDefaultRM(&g_rm);
+
+    test_disabled();
+    test_hit();
+    test_queryf();
+    test_invalidation();
+    test_custom_list();
+    test_attributes();
+    test_small_buffer();
+    test_ordering();
+    test_read_to_file();
+    test_string_arg();
+    test_partial_read();
+
+    viClose(g_rm);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,276 @@
+/*
+ * OpenVISA - Speculative read-ahead (ovReadAhead*) tests
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "visa.h"
+#include "openvisa.h"
+#include "testutil.h"
+#include "core/thread.h"
+
+#ifndef _WIN32
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#endif
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define FILE_NAME   "test_readahead.txt"
+
+static const char *SIM_DEF =
+    "[commands]\n"
+    "*IDN?  = \"OpenVISA,READAHEAD,0,1.0\"\n"
+    "MEAS?  = \"1.25\" delay 50\n"
+    "SLOW?  = \"late\" delay 300\n"
+    "LATE?  = \"late\" delay 500\n"
+    "HUNG?  = \"never\" delay 86400000\n";
+
+static ViSession g_rm;
+
+static ViSession open_sim(void) {
+    ViSession vi = VI_NULL;
+    viOpen(g_rm, "SIM::ra::INSTR", VI_NULL, VI_NULL, &vi);
+    return vi;
+}
+
+static ViStatus write_cmd(ViSession vi, const char *cmd) {
+    return viWrite(vi, (ViBuf)cmd, (ViUInt32)strlen(cmd), VI_NULL);
+}
+
+/* Read one response as a string, trailing newline dropped */
+static ViStatus recv_str(ViSession vi, char *out, ViUInt32 size) {
+    ViUInt32 n = 0;
+    ViStatus st = viRead(vi, (ViBuf)out, size - 1, &n);
+    out[n] = '\0';
+    if (n && out[n - 1] == '\n') out[n - 1] = '\0';
+    return st;
+}
+
+void test_served(void) {
+    TEST("Responses read ahead and served");
+    ViSession vi = open_sim();
+    char a[64], b[64];
+    ViUInt32 hits = 0;
+    ViBoolean en = VI_FALSE;
+    int ok = ovReadAheadEnable(vi, 0) == VI_SUCCESS &&
+             viGetAttribute(vi, OV_ATTR_READ_AHEAD_EN, &en) == VI_SUCCESS && en == VI_TRUE;
+    write_cmd(vi, "*IDN?\n");
+    ov_sleep_ms(20);
+    ok = ok && recv_str(vi, a, sizeof(a)) >= VI_SUCCESS;
+
+    /* Joined in flight: the read-ahead is still waiting for MEAS? */
+    write_cmd(vi, "MEAS?\n");
+    ok = ok && recv_str(vi, b, sizeof(b)) >= VI_SUCCESS;
+    viGetAttribute(vi, OV_ATTR_READ_AHEAD_HITS, &hits);
+    viClose(vi);
+    if (!ok || strcmp(a, "OpenVISA,READAHEAD,0,1.0") != 0 || strcmp(b, "1.25") != 0) { FAIL("responses"); return; }
+    if (hits != 2) { FAIL("not from the read-ahead"); return; }
+    PASS();
+}
+
+void test_partial(void) {
+    TEST("Short reads take the buffered response in parts");
+    ViSession vi = open_sim();
+    ovReadAheadEnable(vi, 0);
+    write_cmd(vi, "*IDN?\n");
+    char buf[64] = "";
+    ViUInt32 n1 = 0, n2 = 0;
+    ViStatus s1 = viRead(vi, (ViBuf)buf, 8, &n1);
+    ViStatus s2 = viRead(vi, (ViBuf)buf + n1, sizeof(buf) - n1 - 1, &n2);
+    ViStatus s3 = viRead(vi, (ViBuf)buf, sizeof(buf), VI_NULL);
+    viClose(vi);
+    int ok = s1 == VI_SUCCESS_MAX_CNT && n1 == 8 && s2 == VI_SUCCESS_TERM_CHAR &&
+             strncmp(buf, "OpenVISA,READAHEAD,0,1.0\n", n1 + n2) == 0 && n1 + n2 == 25 &&
+             s3 == VI_ERROR_TMO;
+    if (!ok) { FAIL("parts"); return; }
+    PASS();
+}
+
+void test_order(void) {
+    TEST("Queries written back to back keep their order");
+    ViSession vi = open_sim();
+    ovReadAheadEnable(vi, 0);
+    char a[64], b[64], c[64];
+    write_cmd(vi, "MEAS?\n");
+    write_cmd(vi, "*IDN?\n");        /* waits for MEAS? to be read ahead; not itself read ahead */
+    write_cmd(vi, "CONF:VOLT\n");
+    int ok = recv_str(vi, a, sizeof(a)) >= VI_SUCCESS && recv_str(vi, b, sizeof(b)) >= VI_SUCCESS;
+    write_cmd(vi, "*IDN?\n");
+    ok = ok && recv_str(vi, c, sizeof(c)) >= VI_SUCCESS;
+    viClose(vi);
+    if (!ok || strcmp(a, "1.25") != 0 || strcmp(b, "OpenVISA,READAHEAD,0,1.0") != 0 ||
+        strcmp(c, b) != 0) { FAIL("order"); return; }
+    PASS();
+}
+
+void test_timeout(void) {
+    TEST("Timed-out read-ahead leaves viRead waiting");
+    ViSession vi = open_sim();
+    ovReadAheadEnable(vi, 0);
+    viSetAttribute(vi, VI_ATTR_TMO_VALUE, 100);
+    write_cmd(vi, "SLOW?\n");
+    ov_sleep_ms(150);           /* the read-ahead gave up after 100 ms */
+    viSetAttribute(vi, VI_ATTR_TMO_VALUE, 1000);
+    char r[64];
+    ViUInt32 hits = 1;
+    ViStatus st = recv_str(vi, r, sizeof(r));
+    viGetAttribute(vi, OV_ATTR_READ_AHEAD_HITS, &hits);
+    viClose(vi);
+    if (st < VI_SUCCESS || strcmp(r, "late") != 0 || hits != 0) { FAIL("timeout"); return; }
+    PASS();
+}
+
+void test_clear_disable(void) {
+    TEST("viClear drops it; disable keeps an unread one");
+    ViSession vi = open_sim();
+    ViBoolean en = VI_TRUE;
+    char r[64];
+    int ok = viSetAttribute(vi, OV_ATTR_READ_AHEAD_EN, VI_TRUE) == VI_SUCCESS;
+    write_cmd(vi, "*IDN?\n");
+    ok = ok && viClear(vi) == VI_SUCCESS && recv_str(vi, r, sizeof(r)) == VI_ERROR_TMO;
+    write_cmd(vi, "*IDN?\n");
+    ok = ok && ovReadAheadDisable(vi) == VI_ERROR_IN_PROGRESS &&
+         ovStreamStart(vi, 0, 0) == VI_ERROR_IN_PROGRESS &&
+         recv_str(vi, r, sizeof(r)) >= VI_SUCCESS && strcmp(r, "OpenVISA,READAHEAD,0,1.0") == 0 &&
+         viSetAttribute(vi, OV_ATTR_READ_AHEAD_EN, VI_FALSE) == VI_SUCCESS &&
+         viGetAttribute(vi, OV_ATTR_READ_AHEAD_EN, &en) == VI_SUCCESS && en == VI_FALSE;
+    write_cmd(vi, "*IDN?\n");
+    ok = ok && recv_str(vi, r, sizeof(r)) >= VI_SUCCESS && strcmp(r, "OpenVISA,READAHEAD,0,1.0") == 0;
+    viClose(vi);
+    if (!ok) { FAIL("clear/disable"); return; }
+    PASS();
+}
+
+void test_joined_timeout(void) {
+    TEST("Joined read-ahead times out once, not twice");
+    ViSession vi = open_sim();
+    ovReadAheadEnable(vi, 0);
+    /* LATE? answers after 500 ms: a 300 ms timeout waited twice gets it */
+    viSetAttribute(vi, VI_ATTR_TMO_VALUE, 300);
+    write_cmd(vi, "LATE?\n");
+    char r[64];
+    ViStatus st = recv_str(vi, r, sizeof(r));
+    viClose(vi);
+    if (st != VI_ERROR_TMO) { FAIL("timeout waited twice"); return; }
+    PASS();
+}
+
+void test_cancel(void) {
+    TEST("viReadSTB and viClear cancel a hung read-ahead");
+    ViSession vi = open_sim();
+    ovReadAheadEnable(vi, 0);
+    /* Neither the read-ahead nor HUNG? ever gives up: waiting for it hangs */
+    viSetAttribute(vi, VI_ATTR_TMO_VALUE, VI_TMO_INFINITE);
+    ViUInt16 stb;
+    write_cmd(vi, "HUNG?\n");
+    ov_sleep_ms(20);
+    ViStatus s1 = viReadSTB(vi, &stb);
+    write_cmd(vi, "HUNG?\n");
+    ov_sleep_ms(20);
+    ViStatus s2 = viClear(vi);
+    viClose(vi);
+    if (s1 < VI_SUCCESS || s2 < VI_SUCCESS) { FAIL("status"); return; }
+    PASS();
+}
+
+void test_read_to_file(void) {
+    TEST("viReadToFile takes the read-ahead response");
+    ViSession vi = open_sim();
+    ovReadAheadEnable(vi, 0);
+    write_cmd(vi, "MEAS?\n");
+    ViUInt32 n = 0, hits = 0;
+    ViStatus st = viReadToFile(vi, FILE_NAME, 64, &n);
+    viGetAttribute(vi, OV_ATTR_READ_AHEAD_HITS, &hits);
+    viClose(vi);
+    char r[64] = "";
+    FILE *fp = fopen(FILE_NAME, "rb");
+    size_t len = fp ? fread(r, 1, sizeof(r) - 1, fp) : 0;
+    if (fp) fclose(fp);
+    remove(FILE_NAME);
+    if (st < VI_SUCCESS || n != 5 || len != 5 || memcmp(r, "1.25\n", 5) != 0) { FAIL("file"); return; }
+    if (hits != 1) { FAIL("not from the read-ahead"); return; }
+    PASS();
+}
+
+void test_pipeline_refused(void) {
+    TEST("No pipeline on a session reading ahead");
+    ViSession vi = open_sim();
+    OvPipeline *pl = NULL;
+    ovReadAheadEnable(vi, 0);
+    ViStatus s1 = ovPipelineCreate(vi, 0, &pl);
+    ovReadAheadDisable(vi);
+    ViStatus s2 = ovPipelineCreate(vi, 0, &pl);
+    if (s2 == VI_SUCCESS) ovPipelineClose(pl);
+    viClose(vi);
+    if (s1 != VI_ERROR_IN_PROGRESS || s2 != VI_SUCCESS) { FAIL("pipeline"); return; }
+    PASS();
+}
+
+#ifndef _WIN32
+/* Answers *IDN?; hangs up on DROP? */
+static void *drop_conn(void *arg) {
+    int c = (int)(intptr_t)arg;
+    char buf[256];
+    ssize_t n;
+    while ((n = recv(c, buf, sizeof(buf) - 1, 0)) > 0) {
+        buf[n] = '\0';
+        if (strstr(buf, "DROP?")) break;
+        send(c, "ACME\n", 5, MSG_NOSIGNAL);
+    }
+    close(c);
+    return NULL;
+}
+
+void test_failed_not_hit(void) {
+    TEST("A failed read-ahead is not counted as a hit");
+    char rsrc[64], r[64];
+    ViSession vi = VI_NULL;
+    ViUInt32 hits = 1;
+    if (serve_socket(drop_conn, rsrc, sizeof(rsrc)) < 0 ||
+        viOpen(g_rm, rsrc, VI_NULL, VI_NULL, &vi) != VI_SUCCESS) { FAIL("open"); return; }
+    viSetAttribute(vi, VI_ATTR_TERMCHAR_EN, VI_TRUE);
+    ovReadAheadEnable(vi, 0);
+    write_cmd(vi, "*IDN?\n");
+    ViStatus s1 = recv_str(vi, r, sizeof(r));
+    write_cmd(vi, "DROP?\n");
+    ViStatus s2 = recv_str(vi, r, sizeof(r));
+    viGetAttribute(vi, OV_ATTR_READ_AHEAD_HITS, &hits);
+    viClose(vi);
+    if (s1 < VI_SUCCESS || s2 >= VI_SUCCESS) { FAIL("statuses"); return; }
+    if (hits != 1) { FAIL("failure counted"); return; }
+    PASS();
+}
+#endif
+
+int main(void) {
+    printf("\n=== OpenVISA Read-Ahead Tests ===\n\n");
+
+    ovSimDefine("ra", SIM_DEF);
+    viOpenDefaultRM(&g_rm);
+    test_served();
+    test_partial();
+    test_order();
+    test_timeout();
+    test_clear_disable();
+    test_joined_timeout();
+    test_cancel();
+    test_read_to_file();
+    test_pipeline_refused();
+#ifndef _WIN32
+    test_failed_not_hit();
+#endif
+    viClose(g_rm);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
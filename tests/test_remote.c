@@ -0,0 +1,403 @@
+/*
+ * OpenVISA - remote VISA (visa://host/RESOURCE) tests
+ *
+ * Usage: test_remote <path-to-openvisa-server>
+ * The client talks to a localhost openvisa-server through an in-process relay
+ * that impairs the link like our WAN: one-way delay and a rate limit
+ * (OPENVISA_TEST_WAN_DELAY_MS, default 25; OPENVISA_TEST_WAN_RATE_KBPS,
+ * default 1000 kB/s).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "visa.h"
+#include "openvisa.h"
+#include "testutil.h"
+#include "core/lz4.h"
+#include "core/scpi.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define CURVE_POINTS 400000
+
+static ViSession g_rm;
+static int g_server_port;
+static int g_relay_port;
+static volatile uint32_t g_round_trips;     /* client sends that follow a reply */
+static volatile uint32_t g_down_bytes;      /* relayed server -> client */
+static double g_delay_ms = 25;
+static double g_rate_kbps = 1000;
+
+static void sleep_until(double t) {
+    double d = t - now_ms();
+    if (d > 0) usleep((useconds_t)(d * 1000));
+}
+
+/* ========== WAN relay ========== */
+
+typedef struct Chunk {
+    struct Chunk *next;
+    double        due;          /* arrival + one-way delay */
+    size_t        len;
+    char          data[];
+} Chunk;
+
+/* Shared by both directions: set when a reply reached the client */
+typedef struct {
+    volatile int    replied;
+} Link;
+
+/* One direction of a relayed connection */
+typedef struct {
+    int             in, out;
+    Link           *link;
+    int             upstream;   /* client -> server */
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    Chunk          *head, *tail;
+    int             eof;
+} Pipe;
+
+static void *pipe_reader(void *arg) {
+    Pipe *p = (Pipe*)arg;
+    char buf[16384];
+    ssize_t n;
+    while ((n = recv(p->in, buf, sizeof(buf), 0)) > 0) {
+        if (p->upstream && __sync_lock_test_and_set(&p->link->replied, 0))
+            __sync_fetch_and_add(&g_round_trips, 1);
+        Chunk *c = (Chunk*)malloc(sizeof(Chunk) + (size_t)n);
+        c->next = NULL;
+        c->due = now_ms() + g_delay_ms;
+        c->len = (size_t)n;
+        memcpy(c->data, buf, (size_t)n);
+        pthread_mutex_lock(&p->lock);
+        if (p->tail) p->tail->next = c; else p->head = c;
+        p->tail = c;
+        pthread_cond_signal(&p->cond);
+        pthread_mutex_unlock(&p->lock);
+    }
+    pthread_mutex_lock(&p->lock);
+    p->eof = 1;
+    pthread_cond_signal(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+/* Delivers each chunk after the delay, then holds the link for len / rate */
+static void *pipe_writer(void *arg) {
+    Pipe *p = (Pipe*)arg;
+    double link_free = 0;
+    for (;;) {
+        pthread_mutex_lock(&p->lock);
+        while (!p->head && !p->eof) pthread_cond_wait(&p->cond, &p->lock);
+        Chunk *c = p->head;
+        if (c) {
+            p->head = c->next;
+            if (!p->head) p->tail = NULL;
+        }
+        pthread_mutex_unlock(&p->lock);
+        if (!c) break;
+
+        sleep_until(c->due > link_free ? c->due : link_free);
+        if (!p->upstream) {         /* before the client can see the reply */
+            __sync_fetch_and_add(&g_down_bytes, (uint32_t)c->len);
+            __sync_lock_test_and_set(&p->link->replied, 1);
+        }
+        send(p->out, c->data, c->len, MSG_NOSIGNAL);
+        link_free = now_ms() + (double)c->len / g_rate_kbps;   /* kB/s == bytes/ms */
+        free(c);
+    }
+    shutdown(p->out, SHUT_WR);
+    return NULL;
+}
+
+static void relay_pipe(int in, int out, Link *link, int upstream) {
+    Pipe *p = (Pipe*)calloc(1, sizeof(Pipe));
+    p->in = in;
+    p->out = out;
+    p->link = link;
+    p->upstream = upstream;
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->cond, NULL);
+    pthread_t r, w;
+    pthread_create(&r, NULL, pipe_reader, p);
+    pthread_create(&w, NULL, pipe_writer, p);
+    pthread_detach(r);
+    pthread_detach(w);
+}
+
+static int connect_local(int port) {
+    int s = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in a = { .sin_family = AF_INET, .sin_port = htons((uint16_t)port),
+                             .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    if (connect(s, (struct sockaddr*)&a, sizeof(a)) != 0) { close(s); return -1; }
+    int one = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return s;
+}
+
+static void *relay_conn(void *arg) {
+    int c = (int)(intptr_t)arg;
+    int one = 1;
+    setsockopt(c, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    int s = connect_local(g_server_port);
+    if (s < 0) { close(c); return NULL; }
+    Link *link = (Link*)calloc(1, sizeof(Link));
+    link->replied = 1;          /* the first send starts a round trip */
+    relay_pipe(c, s, link, 1);
+    relay_pipe(s, c, link, 0);
+    return NULL;
+}
+
+/* ========== Tests ========== */
+
+static ViStatus open_remote(const char *rsrc, ViSession *vi) {
+    char name[128];
+    snprintf(name, sizeof(name), "visa://127.0.0.1:%d/%s", g_relay_port, rsrc);
+    return viOpen(g_rm, name, VI_NULL, 5000, vi);
+}
+
+void test_idn(void) {
+    TEST("Query over visa:// round trip");
+    ViSession vi;
+    if (open_remote("SIM::meter::INSTR", &vi) != VI_SUCCESS) { FAIL("open"); return; }
+    char buf[64];
+    ViUInt32 n;
+    uint32_t trips0 = g_round_trips;
+    ViStatus st = viWrite(vi, (ViBuf)"*IDN?\n", 6, &n);
+    if (st == VI_SUCCESS) st = viRead(vi, (ViBuf)buf, sizeof(buf) - 1, &n);
+    uint32_t trips = g_round_trips - trips0;
+    viClose(vi);
+    if (st < VI_SUCCESS) { FAIL("query"); return; }
+    buf[n] = '\0';
+    if (strncmp(buf, "ACME,Meter", 10) != 0) { FAIL(buf); return; }
+    if (trips != 1) { FAIL("query needs more than one round trip"); return; }
+    PASS();
+}
+
+void test_pipelined(void) {
+    TEST("10 pipelined queries within a few round trips");
+    ViSession vi;
+    if (open_remote("SIM::meter::INSTR", &vi) != VI_SUCCESS) { FAIL("open"); return; }
+    OvPipeline *pl;
+    OvFuture f[10];
+    uint32_t trips0 = g_round_trips;
+    ViStatus st = ovPipelineCreate(vi, 0, &pl);
+    for (int i = 0; i < 10 && st == VI_SUCCESS; i++) {
+        char cmd[32];
+        snprintf(cmd, sizeof(cmd), "ECHO%d?\n", i);
+        st = ovPipelineQuery(pl, cmd, &f[i]);
+    }
+    int bad = 0;
+    for (int i = 0; i < 10 && st == VI_SUCCESS; i++) {
+        char buf[32], want[8];
+        ViUInt32 n;
+        st = ovFutureWait(pl, f[i], (ViBuf)buf, sizeof(buf) - 1, &n);
+        if (st < VI_SUCCESS) break;
+        buf[n] = '\0';
+        snprintf(want, sizeof(want), "%d", i);
+        if (strncmp(buf, want, strlen(want)) != 0) bad++;
+    }
+    uint32_t trips = g_round_trips - trips0;
+    if (st >= VI_SUCCESS) ovPipelineClose(pl);
+    viClose(vi);
+    if (st < VI_SUCCESS) { FAIL("query"); return; }
+    if (bad) { FAIL("wrong response order"); return; }
+    printf("(%u round trips) ", (unsigned)trips);
+    if (trips > 2) { FAIL("not pipelined"); return; }
+    PASS();
+}
+
+static ViStatus read_curve(ViSession vi, char *buf, ViUInt32 cap, ViUInt32 *total) {
+    ViUInt32 n;
+    ViStatus st = viWrite(vi, (ViBuf)"CURVe?\n", 7, &n);
+    *total = 0;
+    while (st >= VI_SUCCESS) {
+        st = viRead(vi, (ViBuf)buf + *total, cap - *total, &n);
+        *total += n;
+        if (st != VI_SUCCESS_MAX_CNT || *total == cap) break;
+    }
+    return st;
+}
+
+void test_bulk(void) {
+    TEST("Compressed bulk read matches local SIM");
+    ViUInt32 cap = CURVE_POINTS + 64;
+    char *local = (char*)malloc(cap), *remote = (char*)malloc(cap);
+    ViSession vi;
+    ViUInt32 nl = 0, nr = 0;
+    ViStatus st = viOpen(g_rm, "SIM::meter::INSTR", VI_NULL, VI_NULL, &vi);
+    if (st == VI_SUCCESS) {
+        st = read_curve(vi, local, cap, &nl);
+        viClose(vi);
+    }
+    if (st < VI_SUCCESS) { FAIL("local read"); free(local); free(remote); return; }
+
+    uint32_t sent = 0;
+    st = open_remote("SIM::meter::INSTR", &vi);
+    if (st == VI_SUCCESS) {
+        uint32_t bytes0 = g_down_bytes;
+        st = read_curve(vi, remote, cap, &nr);
+        sent = g_down_bytes - bytes0;
+        viClose(vi);
+    }
+    int same = st >= VI_SUCCESS && nl == nr && memcmp(local, remote, nl) == 0;
+    free(local);
+    free(remote);
+    if (st < VI_SUCCESS) { FAIL("remote read"); return; }
+    if (!same) { FAIL("data differs"); return; }
+    printf("(%u B in %u B) ", (unsigned)nr, (unsigned)sent);
+    if (sent >= nr / 2) { FAIL("not compressed"); return; }
+    PASS();
+}
+
+void test_lz4(void) {
+    TEST("LZ4 codec round trip");
+    size_t n = 200000;
+    uint8_t *src = (uint8_t*)malloc(n), *z = (uint8_t*)malloc(OV_LZ4_BOUND(n)), *out = (uint8_t*)malloc(n);
+    uint32_t seed = 1;
+    int ok = 1;
+    for (int pass = 0; pass < 3 && ok; pass++) {
+        for (size_t i = 0; i < n; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            src[i] = pass == 0 ? (uint8_t)(seed >> 24)                 /* incompressible */
+                   : pass == 1 ? (uint8_t)("abcabcabd"[i % 9])         /* short period */
+                   : (uint8_t)((seed >> 28) < 2 ? seed >> 20 : i / 1000);
+        }
+        size_t zn = ov_lz4_compress(src, n, z, OV_LZ4_BOUND(n));
+        ok = zn > 0 && ov_lz4_decompress(z, zn, out, n) && memcmp(src, out, n) == 0;
+        if (ok && pass == 1 && zn > n / 50) ok = 0;
+        /* Truncated and mis-sized input are rejected */
+        if (ok && (ov_lz4_decompress(z, zn - 1, out, n) || ov_lz4_decompress(z, zn, out, n - 1))) ok = 0;
+    }
+    free(src);
+    free(z);
+    free(out);
+    if (!ok) { FAIL("mismatch"); return; }
+    PASS();
+}
+
+void test_query_mark(void) {
+    TEST("'?' in strings and block data is no query");
+    static const struct { const char *msg; int query; } cases[] = {
+        { "MEAS:VOLT?\n", 1 },
+        { "DISP:TEXT \"Ready?\"\n", 0 },
+        { "DISP:TEXT 'a''?'\n", 0 },
+        { "DISP:TEXT \"x\";:SYST:ERR?\n", 1 },
+        { "DATA #15ab?cd\n", 0 },
+        { "DATA #15ab?cd;*OPC?\n", 1 },
+        { "DATA #0?\n", 0 },
+        { "FREQ #H1F;*ESR?\n", 1 },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const char *m = cases[i].msg;
+        if (ov_scpi_is_query((const uint8_t *)m, strlen(m)) != (cases[i].query != 0)) {
+            FAIL(m); return;
+        }
+    }
+    /* The server must not wait for a reply to the command */
+    ViSession vi;
+    if (open_remote("SIM::meter::INSTR", &vi) != VI_SUCCESS) { FAIL("open"); return; }
+    viSetAttribute(vi, VI_ATTR_TMO_VALUE, 1000);
+    char buf[64];
+    ViUInt32 n = 0;
+    ViStatus st = viWrite(vi, (ViBuf)"DISP:TEXT \"Ready?\"\n", 19, &n);
+    if (st == VI_SUCCESS) st = viWrite(vi, (ViBuf)"*IDN?\n", 6, &n);
+    if (st == VI_SUCCESS) st = viRead(vi, (ViBuf)buf, sizeof(buf) - 1, &n);
+    viClose(vi);
+    if (st < VI_SUCCESS) { FAIL("query after string argument"); return; }
+    buf[n] = '\0';
+    if (strncmp(buf, "ACME,Meter", 10) != 0) { FAIL(buf); return; }
+    PASS();
+}
+
+void test_bad_rsrc(void) {
+    TEST("Unknown remote resource reports RSRC_NFOUND");
+    ViSession vi;
+    ViStatus st = open_remote("SIM::nosuch::INSTR", &vi);
+    if (st == VI_SUCCESS) viClose(vi);
+    if (st != VI_ERROR_RSRC_NFOUND) { FAIL("wrong status"); return; }
+    PASS();
+}
+
+int main(int argc, char **argv) {
+    printf("\n=== OpenVISA Remote Tests ===\n\n");
+    if (argc < 2) {
+        printf("usage: test_remote <openvisa-server>\n");
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    const char *env = getenv("OPENVISA_TEST_WAN_DELAY_MS");
+    if (env && *env) g_delay_ms = atof(env);
+    env = getenv("OPENVISA_TEST_WAN_RATE_KBPS");
+    if (env && atof(env) > 0) g_rate_kbps = atof(env);
+    printf("  (link: %.0f ms one-way, %.0f kB/s)\n\n", g_delay_ms, g_rate_kbps);
+
+    char dir[] = "/tmp/ovremote-XXXXXX";
+    if (!mkdtemp(dir)) return 1;
+    char sim[64];
+    snprintf(sim, sizeof(sim), "%s/meter.sim", dir);
+    FILE *f = fopen(sim, "w");
+    if (!f) return 1;
+    fprintf(f,
+        "[vars]\n"
+        "text = \"\"\n"
+        "[commands]\n"
+        "DISPlay:TEXT = set text={$1}\n"
+        "*IDN?  = \"ACME,Meter,1,1.0\"\n"
+        "ECHO#? = \"{#1}\"\n"
+        "CURVe? = block sine %d int8\n", CURVE_POINTS);
+    fclose(f);
+    setenv("OPENVISA_SIM_PATH", dir, 1);
+
+    int probe = listen_loopback(16, &g_server_port);
+    close(probe);
+    char port[16];
+    snprintf(port, sizeof(port), "%d", g_server_port);
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl(argv[1], argv[1], "-l", "127.0.0.1", "-p", port, (char*)NULL);
+        _exit(127);
+    }
+    int s = -1;
+    for (int i = 0; i < 200 && s < 0; i++) {              /* server start-up */
+        s = connect_local(g_server_port);
+        if (s < 0) usleep(10000);
+    }
+    if (s >= 0) close(s);
+
+    serve(listen_loopback(16, &g_relay_port), relay_conn);
+
+    viOpenDefaultRM(&g_rm);
+    test_idn();
+    test_pipelined();
+    test_bulk();
+    test_lz4();
+    test_query_mark();
+    test_bad_rsrc();
+    viClose(g_rm);
+
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    unlink(sim);
+    rmdir(dir);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,397 @@
+/*
+ * OpenVISA - RFC 2217 (TCPIP::host::port::ASRL) transport tests
+ *
+ * A loopback stand-in for a terminal server speaks Telnet with the
+ * COM-PORT-OPTION, keeps the port settings it was sent and plays the serial
+ * instrument itself: *IDN?, BAUD? (the line settings in effect), TWO?
+ * (two responses in one packet), BIN? (bytes that need IAC escaping),
+ * ECHO <data> and PARERR (a parity error notification).  A second listener
+ * refuses the option, like a terminal server in plain Telnet mode.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "visa.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define IAC  255
+#define DONT 254
+#define DO   253
+#define WILL 251
+#define SB   250
+#define SE   240
+#define COMPORT 44
+
+static ViSession g_rm;
+static char g_rsrc[64];
+static char g_plain_rsrc[64];
+
+static const unsigned char g_bin[] = { 0xFF, 0x00, 0xFF, 0xFF, 'a', 0xF0, 0xFA, '\n' };
+
+/* ========== Terminal server stand-in ========== */
+
+typedef struct {
+    int c;
+    int refuse;
+    unsigned baud, data, parity, stop, flow, dtr, rts, brk;
+} Port;
+
+static void send_all(int c, const void *data, size_t len) {
+    const char *p = (const char*)data;
+    while (len > 0) {
+        ssize_t n = send(c, p, len, MSG_NOSIGNAL);
+        if (n <= 0) return;
+        p += n;
+        len -= (size_t)n;
+    }
+}
+
+/* Serial data towards the client, IAC doubled */
+static void send_data(Port *pt, const void *data, size_t len) {
+    unsigned char out[256];
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        out[n++] = ((const unsigned char*)data)[i];
+        if (out[n - 1] == IAC) out[n++] = IAC;
+    }
+    send_all(pt->c, out, n);
+}
+
+static void send_cpo(Port *pt, int cmd, const unsigned char *v, size_t len) {
+    unsigned char m[32] = { IAC, SB, COMPORT, (unsigned char)cmd };
+    size_t n = 4;
+    for (size_t i = 0; i < len; i++) {
+        m[n++] = v[i];
+        if (v[i] == IAC) m[n++] = IAC;
+    }
+    m[n++] = IAC;
+    m[n++] = SE;
+    send_all(pt->c, m, n);
+}
+
+static void handle_cpo(Port *pt, const unsigned char *sb, size_t len) {
+    if (len < 2 || sb[0] != COMPORT) return;
+    int cmd = sb[1];
+    const unsigned char *v = sb + 2;
+    unsigned char r = len > 2 ? v[0] : 0;
+    switch (cmd) {
+        case 1:
+            pt->baud = (unsigned)v[0] << 24 | (unsigned)v[1] << 16 | (unsigned)v[2] << 8 | v[3];
+            if (pt->baud > 115200) pt->baud = 115200;       /* the port's limit */
+            {
+                unsigned char b[4] = { (unsigned char)(pt->baud >> 24), (unsigned char)(pt->baud >> 16),
+                                       (unsigned char)(pt->baud >> 8), (unsigned char)pt->baud };
+                send_cpo(pt, 101, b, 4);
+            }
+            return;
+        case 2: pt->data = r; break;
+        case 3: pt->parity = r; break;
+        case 4: pt->stop = r; break;
+        case 5:
+            switch (r) {
+                case 1: case 2: case 3: pt->flow = r; break;
+                case 4: r = pt->brk ? 5 : 6; break;
+                case 5: case 6: pt->brk = r == 5; break;
+                case 7: r = pt->dtr ? 8 : 9; break;
+                case 8: case 9: pt->dtr = r == 8; break;
+                case 10: r = pt->rts ? 11 : 12; break;
+                case 11: case 12: pt->rts = r == 11; break;
+            }
+            break;
+        case 11:
+            send_cpo(pt, 111, &r, 1);
+            r = 0x30;                                       /* CTS and DSR up */
+            send_cpo(pt, 107, &r, 1);
+            return;
+        case 12: break;
+        default: break;
+    }
+    send_cpo(pt, cmd + 100, &r, 1);
+}
+
+static void handle_line(Port *pt, const char *line) {
+    char resp[128];
+    if (strcmp(line, "*IDN?") == 0) {
+        send_data(pt, "ACME,SerialInst,1,1.0\n", 22);
+    } else if (strcmp(line, "BAUD?") == 0) {
+        int n = snprintf(resp, sizeof(resp), "%u %u %u %u %u\n", pt->baud, pt->data, pt->parity, pt->stop, pt->flow);
+        send_data(pt, resp, (size_t)n);
+    } else if (strcmp(line, "TWO?") == 0) {
+        send_data(pt, "first\nsecond\n", 13);
+    } else if (strcmp(line, "BIN?") == 0) {
+        send_data(pt, g_bin, sizeof(g_bin));
+    } else if (strncmp(line, "ECHO ", 5) == 0) {
+        int n = snprintf(resp, sizeof(resp), "%s\n", line + 5);
+        send_data(pt, resp, (size_t)n);
+    } else if (strcmp(line, "PARERR") == 0) {
+        unsigned char ls = 0x04;
+        send_cpo(pt, 106, &ls, 1);
+    }
+}
+
+static void *port_conn(void *arg) {
+    Port *pt = (Port*)arg;
+    unsigned char buf[512], sb[64];
+    char line[256];
+    size_t line_len = 0, sb_len = 0;
+    int state = 0, verb = 0;            /* 0 data, 1 IAC, 2 option, 3 SB, 4 SB IAC */
+    ssize_t n;
+    while ((n = recv(pt->c, buf, sizeof(buf), 0)) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            unsigned char ch = buf[i];
+            switch (state) {
+                case 0:
+                    if (ch == IAC) { state = 1; break; }
+                data:
+                    if (ch == '\n') {
+                        line[line_len] = '\0';
+                        handle_line(pt, line);
+                        line_len = 0;
+                    } else if (line_len < sizeof(line) - 1) {
+                        line[line_len++] = (char)ch;
+                    }
+                    break;
+                case 1:
+                    state = 0;
+                    if (ch == IAC) goto data;
+                    if (ch == SB) { sb_len = 0; state = 3; }
+                    else if (ch >= WILL && ch <= DONT) { verb = ch; state = 2; }
+                    break;
+                case 2:
+                    state = 0;
+                    if (verb == WILL && ch == COMPORT) {
+                        unsigned char m[3] = { IAC, (unsigned char)(pt->refuse ? DONT : DO), COMPORT };
+                        send_all(pt->c, m, 3);
+                    }
+                    break;
+                case 3:
+                    if (ch == IAC) state = 4;
+                    else if (sb_len < sizeof(sb)) sb[sb_len++] = ch;
+                    break;
+                case 4:
+                    if (ch == IAC) { if (sb_len < sizeof(sb)) sb[sb_len++] = ch; state = 3; break; }
+                    state = 0;
+                    if (ch == SE) handle_cpo(pt, sb, sb_len);
+                    break;
+            }
+        }
+    }
+    close(pt->c);
+    free(pt);
+    return NULL;
+}
+
+static void *port_server(void *arg) {
+    int ls = (int)(intptr_t)arg & 0xFFFF;
+    int refuse = (int)(intptr_t)arg >> 16;
+    for (;;) {
+        int c = accept(ls, NULL, NULL);
+        if (c < 0) return NULL;
+        Port *pt = (Port*)calloc(1, sizeof(Port));
+        pt->c = c;
+        pt->refuse = refuse;
+        pt->baud = 19200;
+        pt->dtr = pt->rts = 1;
+        pthread_t th;
+        pthread_create(&th, NULL, port_conn, pt);
+        pthread_detach(th);
+    }
+}
+
+static void start_server(char *rsrc, size_t len, int refuse) {
+    int ls = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t alen = sizeof(addr);
+    bind(ls, (struct sockaddr*)&addr, sizeof(addr));
+    listen(ls, 16);
+    getsockname(ls, (struct sockaddr*)&addr, &alen);
+    snprintf(rsrc, len, "TCPIP::127.0.0.1::%d::ASRL", ntohs(addr.sin_port));
+    pthread_t th;
+    pthread_create(&th, NULL, port_server, (void*)(intptr_t)(ls | refuse << 16));
+}
+
+/* ========== Tests ========== */
+
+static ViStatus query(ViSession vi, const char *cmd, char *buf, size_t size, ViUInt32 *n) {
+    ViStatus st = viWrite(vi, (ViBuf)cmd, (ViUInt32)strlen(cmd), n);
+    *n = 0;
+    if (st == VI_SUCCESS) st = viRead(vi, (ViBuf)buf, (ViUInt32)size - 1, n);
+    buf[*n] = '\0';
+    return st;
+}
+
+void test_parse(void) {
+    TEST("Parse TCPIP::host::port::ASRL");
+    ViUInt16 type = 0, num = 0;
+    if (viParseRsrc(g_rm, "TCPIP::ts1.lab::4001::ASRL", &type, &num) != VI_SUCCESS || type != VI_INTF_ASRL) {
+        FAIL("rejected"); return;
+    }
+    if (viParseRsrc(g_rm, "TCPIP::ts1.lab::0::ASRL", &type, &num) != VI_ERROR_INV_RSRC_NAME) { FAIL("port 0"); return; }
+    PASS();
+}
+
+void test_idn(ViSession vi) {
+    TEST("Query through the terminal server");
+    char buf[64];
+    ViUInt32 n;
+    ViStatus st = query(vi, "*IDN?\n", buf, sizeof(buf), &n);
+    if (st != VI_SUCCESS_TERM_CHAR || strcmp(buf, "ACME,SerialInst,1,1.0\n") != 0) { FAIL("wrong response"); return; }
+    PASS();
+}
+
+void test_defaults(ViSession vi) {
+    TEST("Open applies 9600 8N1, no flow control");
+    char buf[64];
+    ViUInt32 n;
+    query(vi, "BAUD?\n", buf, sizeof(buf), &n);
+    if (strcmp(buf, "9600 8 1 1 1\n") != 0) { FAIL(buf); return; }
+    PASS();
+}
+
+void test_settings(ViSession vi) {
+    TEST("Baud, parity, stop bits and flow set remotely");
+    if (viSetAttribute(vi, VI_ATTR_ASRL_BAUD, 57600) != VI_SUCCESS ||
+        viSetAttribute(vi, VI_ATTR_ASRL_DATA_BITS, 7) != VI_SUCCESS ||
+        viSetAttribute(vi, VI_ATTR_ASRL_PARITY, VI_ASRL_PAR_EVEN) != VI_SUCCESS ||
+        viSetAttribute(vi, VI_ATTR_ASRL_STOP_BITS, VI_ASRL_STOP_TWO) != VI_SUCCESS ||
+        viSetAttribute(vi, VI_ATTR_ASRL_FLOW_CNTRL, VI_ASRL_FLOW_RTS_CTS) != VI_SUCCESS) {
+        FAIL("set rejected"); return;
+    }
+    char buf[64];
+    ViUInt32 n, baud = 0;
+    ViUInt16 parity = 0, stop = 0;
+    query(vi, "BAUD?\n", buf, sizeof(buf), &n);
+    viGetAttribute(vi, VI_ATTR_ASRL_BAUD, &baud);
+    viGetAttribute(vi, VI_ATTR_ASRL_PARITY, &parity);
+    viGetAttribute(vi, VI_ATTR_ASRL_STOP_BITS, &stop);
+    if (strcmp(buf, "57600 7 3 2 3\n") != 0) { FAIL(buf); return; }
+    if (baud != 57600 || parity != VI_ASRL_PAR_EVEN || stop != VI_ASRL_STOP_TWO) { FAIL("attributes"); return; }
+    if (viSetAttribute(vi, VI_ATTR_ASRL_BAUD, 230400) != VI_ERROR_NSUP_ATTR_STATE) { FAIL("limit not reported"); return; }
+    viGetAttribute(vi, VI_ATTR_ASRL_BAUD, &baud);
+    if (baud != 115200) { FAIL("applied rate not kept"); return; }
+    PASS();
+}
+
+void test_lines(ViSession vi) {
+    TEST("DTR, RTS, break and modem lines");
+    ViInt16 dtr = -2, rts = -2, brk = -2, cts = -2, dcd = -2;
+    if (viSetAttribute(vi, VI_ATTR_ASRL_DTR_STATE, VI_STATE_UNASSERTED) != VI_SUCCESS ||
+        viSetAttribute(vi, VI_ATTR_ASRL_BREAK_STATE, VI_STATE_ASSERTED) != VI_SUCCESS) { FAIL("set"); return; }
+    viGetAttribute(vi, VI_ATTR_ASRL_DTR_STATE, &dtr);
+    viGetAttribute(vi, VI_ATTR_ASRL_RTS_STATE, &rts);
+    viGetAttribute(vi, VI_ATTR_ASRL_BREAK_STATE, &brk);
+    viGetAttribute(vi, VI_ATTR_ASRL_CTS_STATE, &cts);
+    viGetAttribute(vi, VI_ATTR_ASRL_DCD_STATE, &dcd);
+    viSetAttribute(vi, VI_ATTR_ASRL_BREAK_STATE, VI_STATE_UNASSERTED);
+    if (dtr != VI_STATE_UNASSERTED || rts != VI_STATE_ASSERTED || brk != VI_STATE_ASSERTED) { FAIL("control lines"); return; }
+    if (cts != VI_STATE_ASSERTED || dcd != VI_STATE_UNASSERTED) { FAIL("modem lines"); return; }
+    PASS();
+}
+
+void test_framing(ViSession vi) {
+    TEST("Termchar framing splits one packet");
+    char a[32], b[32];
+    ViUInt32 n1 = 0, n2 = 0, avail = 0;
+    query(vi, "TWO?\n", a, sizeof(a), &n1);
+    viGetAttribute(vi, VI_ATTR_ASRL_AVAIL_NUM, &avail);
+    ViStatus st = viRead(vi, (ViBuf)b, sizeof(b) - 1, &n2);
+    b[n2] = '\0';
+    if (strcmp(a, "first\n") != 0 || strcmp(b, "second\n") != 0 || st != VI_SUCCESS_TERM_CHAR) { FAIL("framing"); return; }
+    if (avail != 7) { FAIL("AVAIL_NUM"); return; }
+
+    /* END_IN none: the read ends on the count, not on '\n' */
+    ViUInt32 n;
+    viSetAttribute(vi, VI_ATTR_ASRL_END_IN, VI_ASRL_END_NONE);
+    viWrite(vi, (ViBuf)"ECHO abc\n", 9, &n);
+    st = viRead(vi, (ViBuf)a, 3, &n1);
+    ViStatus st2 = viRead(vi, (ViBuf)a + 3, 1, &n2);
+    viSetAttribute(vi, VI_ATTR_ASRL_END_IN, VI_ASRL_END_TERMCHAR);
+    if (st != VI_SUCCESS_MAX_CNT || n1 != 3 || st2 != VI_SUCCESS_MAX_CNT || memcmp(a, "abc\n", 4) != 0) {
+        FAIL("END_NONE"); return;
+    }
+    PASS();
+}
+
+void test_binary(ViSession vi) {
+    TEST("0xFF bytes survive Telnet escaping");
+    char buf[32];
+    ViUInt32 n;
+    query(vi, "BIN?\n", buf, sizeof(buf), &n);
+    if (n != sizeof(g_bin) || memcmp(buf, g_bin, sizeof(g_bin)) != 0) { FAIL("data differs"); return; }
+
+    char cmd[16] = "ECHO \xff\xfe\xff\n";
+    query(vi, cmd, buf, sizeof(buf), &n);
+    if (n != 4 || memcmp(buf, "\xff\xfe\xff\n", 4) != 0) { FAIL("written 0xFF garbled"); return; }
+    PASS();
+}
+
+void test_line_error(ViSession vi) {
+    TEST("Parity error fails the next read");
+    ViUInt32 n;
+    char buf[32];
+    viWrite(vi, (ViBuf)"PARERR\n", 7, &n);
+    ViStatus st = viRead(vi, (ViBuf)buf, sizeof(buf), &n);
+    ViStatus st2 = query(vi, "*IDN?\n", buf, sizeof(buf), &n);
+    if (st != VI_ERROR_ASRL_PARITY) { FAIL("not reported"); return; }
+    if (st2 != VI_SUCCESS_TERM_CHAR) { FAIL("not cleared"); return; }
+    PASS();
+}
+
+void test_refused(void) {
+    TEST("Server without COM-PORT-OPTION: data only");
+    ViSession vi;
+    char buf[64];
+    ViUInt32 n, baud;
+    if (viOpen(g_rm, g_plain_rsrc, VI_NULL, VI_NULL, &vi) != VI_SUCCESS) { FAIL("open"); return; }
+    ViStatus st = query(vi, "*IDN?\n", buf, sizeof(buf), &n);
+    ViStatus st_attr = viGetAttribute(vi, VI_ATTR_ASRL_BAUD, &baud);
+    ViStatus st_set = viSetAttribute(vi, VI_ATTR_ASRL_BAUD, 9600);
+    viClose(vi);
+    if (st != VI_SUCCESS_TERM_CHAR || strcmp(buf, "ACME,SerialInst,1,1.0\n") != 0) { FAIL("query"); return; }
+    if (st_attr != VI_ERROR_NSUP_ATTR || st_set != VI_ERROR_NSUP_ATTR) { FAIL("attributes"); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA RFC 2217 Tests ===\n\n");
+    signal(SIGPIPE, SIG_IGN);
+    start_server(g_rsrc, sizeof(g_rsrc), 0);
+    start_server(g_plain_rsrc, sizeof(g_plain_rsrc), 1);
+
+    viOpenDefaultRM(&g_rm);
+    test_parse();
+    ViSession vi;
+    if (viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi) == VI_SUCCESS) {
+        test_idn(vi);
+        test_defaults(vi);
+        test_settings(vi);
+        test_lines(vi);
+        test_framing(vi);
+        test_binary(vi);
+        test_line_error(vi);
+        viClose(vi);
+    } else {
+        TEST("Open RFC 2217 port");
+        FAIL("viOpen");
+    }
+    test_refused();
+    viClose(g_rm);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
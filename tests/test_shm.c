@@ -0,0 +1,274 @@
+/*
+ * OpenVISA - SHM::<name>::INSTR transport tests
+ *
+ * A forked child runs a soft instrument on ovShmServer*: *IDN? is answered
+ * with ovShmServerWrite, CURV? with an 8 MiB block generated in place in the
+ * response ring (ovShmServerReserve / ovShmServerCommit), STB <n> sets the
+ * status byte, COUNT? returns the number of *IDN? answered and EXIT closes
+ * the server.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "visa.h"
+#include "openvisa.h"
+#include "testutil.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define BLOCK_SIZE  (8u << 20)
+#define HEADER      "#78388608"
+#define RESP_SIZE   (sizeof(HEADER) - 1 + BLOCK_SIZE + 1)
+#define IDN         "ACME,ShmInst,1,1.0\n"
+#define ROUND_TRIPS 2000
+
+static ViSession g_rm;
+static char g_name[64];
+static char g_rsrc[96];
+
+static uint8_t pattern(uint32_t i) { return (uint8_t)(i * 7 % 251); }
+
+/* ========== Soft instrument (child process) ========== */
+
+static void send_curve(OvShmServer *s) {
+    ovShmServerWrite(s, (ViConstBuf)HEADER, sizeof(HEADER) - 1, VI_FALSE, 1000);
+    uint32_t done = 0;
+    while (done < BLOCK_SIZE) {
+        ViBuf p;
+        ViUInt32 room;
+        if (ovShmServerReserve(s, BLOCK_SIZE - done, &p, &room, 5000) != VI_SUCCESS) return;
+        for (ViUInt32 i = 0; i < room; i++) p[i] = pattern(done + i);
+        done += room;
+        ovShmServerCommit(s, room, VI_FALSE);
+    }
+    ovShmServerWrite(s, (ViConstBuf)"\n", 1, VI_TRUE, 1000);
+}
+
+static int run_instrument(int ready_fd) {
+    OvShmServer *s;
+    if (ovShmServerCreate(g_name, 0, &s) != VI_SUCCESS) return 1;
+    if (write(ready_fd, "r", 1) != 1) return 1;
+    close(ready_fd);
+
+    char cmd[256];
+    uint32_t idns = 0;
+    for (;;) {
+        ViUInt32 n = 0, len = 0;
+        ViStatus st;
+        do {
+            st = ovShmServerRead(s, (ViBuf)cmd + len, sizeof(cmd) - 1 - len, &n, VI_TMO_INFINITE);
+            len += n;
+        } while (st == VI_SUCCESS_MAX_CNT && len < sizeof(cmd) - 1);
+        if (st < VI_SUCCESS) continue;
+        cmd[len] = '\0';
+        if (strcmp(cmd, "*IDN?\n") == 0) {
+            ovShmServerWrite(s, (ViConstBuf)IDN, sizeof(IDN) - 1, VI_TRUE, 1000);
+            idns++;
+        } else if (strcmp(cmd, "COUNT?\n") == 0) {
+            char r[16];
+            int rn = snprintf(r, sizeof(r), "%u\n", (unsigned)idns);
+            ovShmServerWrite(s, (ViConstBuf)r, (ViUInt32)rn, VI_TRUE, 1000);
+        } else if (strcmp(cmd, "CURV?\n") == 0) {
+            send_curve(s);
+        } else if (strncmp(cmd, "STB ", 4) == 0) {
+            ovShmServerSetStatus(s, (ViUInt16)atoi(cmd + 4));
+        } else if (strcmp(cmd, "EXIT\n") == 0) {
+            ovShmServerClose(s);
+            return 0;
+        }
+    }
+}
+
+/* ========== Tests ========== */
+
+static int query_idn(ViSession vi) {
+    char buf[64];
+    ViUInt32 n = 0;
+    ViStatus st = viWrite(vi, (ViBuf)"*IDN?\n", 6, &n);
+    if (st == VI_SUCCESS) st = viRead(vi, (ViBuf)buf, sizeof(buf) - 1, &n);
+    buf[st >= VI_SUCCESS ? n : 0] = '\0';
+    return strcmp(buf, IDN) == 0;
+}
+
+/* *IDN? queries the instrument has answered, -1 on error */
+static long idn_count(ViSession vi) {
+    char buf[32];
+    ViUInt32 n = 0;
+    ViStatus st = viWrite(vi, (ViBuf)"COUNT?\n", 7, &n);
+    if (st == VI_SUCCESS) st = viRead(vi, (ViBuf)buf, sizeof(buf) - 1, &n);
+    if (st < VI_SUCCESS) return -1;
+    buf[n] = '\0';
+    return atol(buf);
+}
+
+void test_parse(void) {
+    TEST("Parse SHM::name::INSTR");
+    ViUInt16 type = 0, num = 0;
+    if (viParseRsrc(g_rm, "SHM::scope0::INSTR", &type, &num) != VI_SUCCESS ||
+        viParseRsrc(g_rm, "shm::scope0", &type, &num) != VI_SUCCESS) { FAIL("rejected"); return; }
+    if (viParseRsrc(g_rm, "SHM::::INSTR", &type, &num) != VI_ERROR_INV_RSRC_NAME) { FAIL("empty name"); return; }
+    PASS();
+}
+
+void test_idn(ViSession vi) {
+    TEST("Query over shared memory");
+    if (!query_idn(vi)) { FAIL("wrong response"); return; }
+    PASS();
+}
+
+void test_latency(ViSession vi) {
+    TEST("Query round trip");
+    static double t[ROUND_TRIPS];
+    long before = idn_count(vi);
+    for (int i = 0; i < ROUND_TRIPS; i++) {
+        double t0 = now_us();
+        if (!query_idn(vi)) { FAIL("wrong response"); return; }
+        t[i] = now_us() - t0;
+    }
+    /* median by partial selection sort of the lower half */
+    for (int i = 0; i <= ROUND_TRIPS / 2; i++)
+        for (int j = i + 1; j < ROUND_TRIPS; j++)
+            if (t[j] < t[i]) { double x = t[i]; t[i] = t[j]; t[j] = x; }
+    double median = t[ROUND_TRIPS / 2];
+    long answered = idn_count(vi) - before;
+    printf("(median %.2f us, %ld cpus) ", median, sysconf(_SC_NPROCESSORS_ONLN));
+    if (before < 0 || answered != ROUND_TRIPS) { FAIL("queries lost or repeated"); return; }
+    PASS();
+}
+
+void test_block(ViSession vi) {
+    TEST("8 MiB block built in place by the instrument");
+    uint8_t *buf = (uint8_t*)malloc(RESP_SIZE);
+    memset(buf, 0, RESP_SIZE);                  /* fault the pages in before timing */
+    ViUInt32 n = 0, total = 0;
+    double t0 = now_us();
+    ViStatus st = viWrite(vi, (ViBuf)"CURV?\n", 6, &n);
+    while (st >= VI_SUCCESS && total < RESP_SIZE) {
+        st = viRead(vi, buf + total, RESP_SIZE - total, &n);
+        total += n;
+        if (st == VI_SUCCESS) break;
+    }
+    double dt = now_us() - t0;
+    int ok = st == VI_SUCCESS && total == RESP_SIZE &&
+             memcmp(buf, HEADER, sizeof(HEADER) - 1) == 0 && buf[RESP_SIZE - 1] == '\n';
+    for (uint32_t i = 0; ok && i < BLOCK_SIZE; i++)
+        if (buf[sizeof(HEADER) - 1 + i] != pattern(i)) ok = 0;
+    free(buf);
+    if (!ok) { FAIL("data differs"); return; }
+    printf("(%.1f ms) ", dt / 1000.0);
+    PASS();
+}
+
+void test_stb(ViSession vi) {
+    TEST("viReadSTB from the shared header");
+    ViUInt32 n;
+    ViUInt16 stb = 0;
+    viWrite(vi, (ViBuf)"STB 66\n", 7, &n);
+    for (int i = 0; i < 1000 && stb != 66; i++) {
+        if (viReadSTB(vi, &stb) != VI_SUCCESS) break;
+        if (stb != 66) usleep(1000);
+    }
+    if (stb != 66) { FAIL("status byte not seen"); return; }
+    PASS();
+}
+
+void test_exclusive(void) {
+    TEST("Second client gets RSRC_LOCKED");
+    ViSession vi2;
+    ViStatus st = viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi2);
+    if (st == VI_SUCCESS) viClose(vi2);
+    if (st != VI_ERROR_RSRC_LOCKED) { FAIL("wrong status"); return; }
+    PASS();
+}
+
+void test_reconnect(void) {
+    TEST("Unread response not seen by the next client");
+    ViSession vi;
+    ViUInt32 n;
+    if (viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi) != VI_SUCCESS) { FAIL("open"); return; }
+    viWrite(vi, (ViBuf)"CURV?\n", 6, &n);        /* left in the ring */
+    viClose(vi);
+    if (viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi) != VI_SUCCESS) { FAIL("reopen"); return; }
+    int ok = query_idn(vi);
+    viClose(vi);
+    if (!ok) { FAIL("stale response read"); return; }
+    PASS();
+}
+
+void test_missing(void) {
+    TEST("Missing instrument reports RSRC_NFOUND");
+    ViSession vi;
+    ViStatus st = viOpen(g_rm, "SHM::openvisa-no-such-instrument::INSTR", VI_NULL, VI_NULL, &vi);
+    if (st == VI_SUCCESS) viClose(vi);
+    if (st != VI_ERROR_RSRC_NFOUND) { FAIL("wrong status"); return; }
+    PASS();
+}
+
+void test_server_gone(pid_t child) {
+    TEST("Instrument exit reports CONN_LOST");
+    ViSession vi;
+    ViUInt32 n;
+    ViUInt16 stb;
+    char buf[16];
+    if (viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi) != VI_SUCCESS) { FAIL("open"); return; }
+    viWrite(vi, (ViBuf)"EXIT\n", 5, &n);
+    waitpid(child, NULL, 0);
+    ViStatus st_read = viRead(vi, (ViBuf)buf, sizeof(buf), &n);
+    ViStatus st_stb = viReadSTB(vi, &stb);
+    viClose(vi);
+    if (st_read != VI_ERROR_CONN_LOST || st_stb != VI_ERROR_CONN_LOST) { FAIL("wrong status"); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA Shared Memory Tests ===\n\n");
+    snprintf(g_name, sizeof(g_name), "ovtest-%d", (int)getpid());
+    snprintf(g_rsrc, sizeof(g_rsrc), "SHM::%s::INSTR", g_name);
+
+    int ready[2];
+    if (pipe(ready) != 0) return 1;
+    pid_t child = fork();
+    if (child < 0) return 1;
+    if (child == 0) {
+        close(ready[0]);
+        _exit(run_instrument(ready[1]));
+    }
+    close(ready[1]);
+    char c;
+    if (read(ready[0], &c, 1) != 1) { kill(child, SIGKILL); return 1; }
+    close(ready[0]);
+
+    viOpenDefaultRM(&g_rm);
+    test_parse();
+    ViSession vi;
+    if (viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi) == VI_SUCCESS) {
+        test_idn(vi);
+        test_latency(vi);
+        test_block(vi);
+        test_stb(vi);
+        test_exclusive();
+        viClose(vi);
+        test_reconnect();
+    } else {
+        TEST("Open SHM instrument");
+        FAIL("viOpen");
+    }
+    test_missing();
+    test_server_gone(child);
+    viClose(g_rm);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,261 @@
+/*
+ * OpenVISA - Simulated instrument (SIM::<name>::INSTR) tests
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "visa.h"
+#include "openvisa.h"
+#include "core/session.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static const char *DMM_DEF =
+    "# simulated DMM\n"
+    "[device]\n"
+    "eom = \"\\n\"\n"
+    "unknown = \"-113,\\\"Undefined header\\\"\"\n"
+    "\n"
+    "[vars]\n"
+    "volt = 1.234\n"
+    "func = VOLT\n"
+    "\n"
+    "[commands]\n"
+    "*IDN?                 = \"OpenVISA,SIMDMM,0001,1.0\"\n"
+    "*RST                  = set volt=0 set func=VOLT\n"
+    "CONFigure:VOLTage     = set volt={$1}\n"
+    "CONFigure:FUNCtion    = set func={$1}\n"
+    "CONFigure:FUNCtion?   = \"{func}\"\n"
+    "MEASure:VOLTage[:DC]? = \"{volt}\"\n"
+    "MEASure:CURRent?      = \"0.001\"\n"
+    "CHANnel#:SCALe?       = \"CH{#1}:{$1}\"\n"
+    "SLOW?                 = \"done\" delay 30\n"
+    "CURVe?                = block ramp 4 int8\n";
+
+static ViSession g_rm;
+
+static ViStatus query(ViSession vi, const char *cmd, char *out, size_t outsz) {
+    ViUInt32 n;
+    ViStatus st = viWrite(vi, (ViBuf)cmd, (ViUInt32)strlen(cmd), &n);
+    if (st != VI_SUCCESS) return st;
+    st = viRead(vi, (ViBuf)out, (ViUInt32)(outsz - 1), &n);
+    if (st < VI_SUCCESS) return st;
+    out[n] = '\0';
+    return st;
+}
+
+void test_parse(void) {
+    TEST("SIM::name::INSTR parses");
+    OvResource r;
+    ViStatus st = ov_parse_rsrc("SIM::dmm1::INSTR", &r);
+    if (st != VI_SUCCESS) { FAIL("parse failed"); return; }
+    if (r.intfType != OV_INTF_SIM) { FAIL("wrong type"); return; }
+    if (strcmp(ov_rsrc_device(&r), "dmm1") != 0) { FAIL("wrong name"); return; }
+    PASS();
+}
+
+void test_bad_definition(void) {
+    TEST("Malformed definition is rejected");
+    if (ovSimDefine("bad", "[commands]\n*IDN? = frobnicate\n") != VI_ERROR_INV_SETUP) {
+        FAIL("accepted bad definition"); return;
+    }
+    PASS();
+}
+
+void test_idn(ViSession vi) {
+    TEST("*IDN? answered from table");
+    char buf[256];
+    ViStatus st = query(vi, "*IDN?\n", buf, sizeof(buf));
+    if (st != VI_SUCCESS_TERM_CHAR) { FAIL("read status"); return; }
+    if (strcmp(buf, "OpenVISA,SIMDMM,0001,1.0\n") != 0) { FAIL(buf); return; }
+    PASS();
+}
+
+void test_short_long_forms(ViSession vi) {
+    TEST("Short/long/optional mnemonic forms");
+    const char *forms[] = { "MEAS:VOLT?", "measure:voltage?", ":MEAS:VOLT:DC?",
+                            "Meas:Volt:Dc?", NULL };
+    char buf[64];
+    for (int i = 0; forms[i]; i++) {
+        if (query(vi, forms[i], buf, sizeof(buf)) != VI_SUCCESS_TERM_CHAR ||
+            strcmp(buf, "1.234\n") != 0) { FAIL(forms[i]); return; }
+    }
+    PASS();
+}
+
+void test_state_vars(ViSession vi) {
+    TEST("set actions update state variables");
+    char buf[64];
+    ViUInt32 n;
+    viWrite(vi, (ViBuf)"CONF:VOLT 5.5\n", 14, &n);
+    if (query(vi, "MEAS:VOLT?\n", buf, sizeof(buf)) < VI_SUCCESS ||
+        strcmp(buf, "5.5\n") != 0) { FAIL("set volt"); return; }
+    viWrite(vi, (ViBuf)"*RST\n", 5, &n);
+    if (query(vi, "MEAS:VOLT?\n", buf, sizeof(buf)) < VI_SUCCESS ||
+        strcmp(buf, "0\n") != 0) { FAIL("*RST"); return; }
+    PASS();
+}
+
+void test_compound_message(ViSession vi) {
+    TEST("Compound message with relative paths");
+    char buf[64];
+    /* CURR? is relative to MEAS:, FUNC? after ':CONF:FUNC CURR' */
+    if (query(vi, ":CONF:FUNC \"CURR\";FUNC?;:MEAS:VOLT?;CURR?\n", buf, sizeof(buf)) < VI_SUCCESS) {
+        FAIL("query failed"); return;
+    }
+    if (strcmp(buf, "CURR;0;0.001\n") != 0) { FAIL(buf); return; }
+    /* A bare ':' unit has no header at all */
+    if (query(vi, ":;*IDN?\n", buf, sizeof(buf)) < VI_SUCCESS ||
+        strcmp(buf, "OpenVISA,SIMDMM,0001,1.0\n") != 0) { FAIL(buf); return; }
+    PASS();
+}
+
+void test_numeric_suffix(ViSession vi) {
+    TEST("Numeric suffix capture (CHAN2:SCAL?)");
+    char buf[64];
+    if (query(vi, "CHAN2:SCAL? 10\n", buf, sizeof(buf)) < VI_SUCCESS ||
+        strcmp(buf, "CH2:10\n") != 0) { FAIL(buf); return; }
+    PASS();
+}
+
+void test_block(ViSession vi) {
+    TEST("Binary block generator");
+    unsigned char buf[64];
+    ViUInt32 n;
+    viWrite(vi, (ViBuf)"CURV?\n", 6, &n);
+    ViStatus st = viRead(vi, buf, sizeof(buf), &n);
+    if (st != VI_SUCCESS_TERM_CHAR) { FAIL("read status"); return; }
+    /* #14 + 4 samples + '\n' */
+    if (n != 8 || memcmp(buf, "#14", 3) != 0) { FAIL("bad block header"); return; }
+    if ((signed char)buf[3] != -127 || (signed char)buf[6] != 127) { FAIL("bad ramp"); return; }
+    PASS();
+}
+
+void test_unknown_and_stb(ViSession vi) {
+    TEST("Unknown query response, MAV in STB, viClear");
+    char buf[64];
+    if (query(vi, "FOO:BAR?\n", buf, sizeof(buf)) < VI_SUCCESS ||
+        strcmp(buf, "-113,\"Undefined header\"\n") != 0) { FAIL(buf); return; }
+
+    ViUInt32 n;
+    ViUInt16 stb = 0;
+    viWrite(vi, (ViBuf)"*IDN?\n", 6, &n);
+    viReadSTB(vi, &stb);
+    if (!(stb & 0x10)) { FAIL("MAV not set"); return; }
+    viClear(vi);
+    viReadSTB(vi, &stb);
+    if (stb & 0x10) { FAIL("MAV after clear"); return; }
+    if (viRead(vi, (ViBuf)buf, sizeof(buf), &n) != VI_ERROR_TMO) { FAIL("queue not empty"); return; }
+    PASS();
+}
+
+void test_partial_read(ViSession vi) {
+    TEST("Partial reads continue the same message");
+    char a[8], b[64];
+    ViUInt32 n1, n2;
+    viWrite(vi, (ViBuf)"*IDN?\n", 6, &n1);
+    if (viRead(vi, (ViBuf)a, 8, &n1) != VI_SUCCESS_MAX_CNT || n1 != 8) { FAIL("first"); return; }
+    if (viRead(vi, (ViBuf)b, sizeof(b), &n2) != VI_SUCCESS_TERM_CHAR) { FAIL("second"); return; }
+    if (n1 + n2 != 25 || memcmp(a, "OpenVISA", 8) != 0) { FAIL("content"); return; }
+    PASS();
+}
+
+void test_delay(ViSession vi) {
+    TEST("Simulated delay honours the timeout");
+    char buf[64];
+    ViUInt32 n;
+    viWrite(vi, (ViBuf)"SLOW?\n", 6, &n);
+    viSetAttribute(vi, VI_ATTR_TMO_VALUE, 5);
+    ViStatus st = viRead(vi, (ViBuf)buf, sizeof(buf), &n);
+    viSetAttribute(vi, VI_ATTR_TMO_VALUE, 2000);
+    if (st != VI_ERROR_TMO) { FAIL("expected timeout"); return; }
+    if (viRead(vi, (ViBuf)buf, sizeof(buf), &n) != VI_SUCCESS_TERM_CHAR) { FAIL("late read"); return; }
+    PASS();
+}
+
+void test_file_definition(void) {
+    TEST("Definition loaded from OPENVISA_SIM_PATH");
+    FILE *f = fopen("psu_sim_test.sim", "w");
+    if (!f) { FAIL("cannot write temp file"); return; }
+    fputs("[commands]\nOUTPut? = \"1\"\n", f);
+    fclose(f);
+
+    ViSession vi;
+    setenv("OPENVISA_SIM_PATH", "/nonexistent:.", 1);
+    ViStatus st = viOpen(g_rm, "SIM::psu_sim_test::INSTR", VI_NULL, VI_NULL, &vi);
+    remove("psu_sim_test.sim");
+    if (st != VI_SUCCESS) { FAIL("open failed"); return; }
+    char buf[16];
+    st = query(vi, "OUTP?\n", buf, sizeof(buf));
+    viClose(vi);
+    if (st < VI_SUCCESS || strcmp(buf, "1\n") != 0) { FAIL("bad response"); return; }
+
+    if (viOpen(g_rm, "SIM::does_not_exist::INSTR", VI_NULL, VI_NULL, &vi) != VI_ERROR_RSRC_NFOUND) {
+        FAIL("missing definition opened"); return;
+    }
+    PASS();
+}
+
+void test_query_speed(ViSession vi) {
+    TEST("Query round trip cost");
+    const int iters = 200000;
+    char buf[64];
+    ViUInt32 n;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < iters; i++) {
+        viWrite(vi, (ViBuf)"MEAS:VOLT:DC?\n", 14, &n);
+        viRead(vi, (ViBuf)buf, sizeof(buf), &n);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / iters;
+    printf("(%.0f ns/query) ", ns);
+    if (ns > 20000.0) { FAIL("simulated query too slow"); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA Simulated Instrument Tests ===\n\n");
+
+    if (viOpenDefaultRM(&g_rm) != VI_SUCCESS) return 1;
+
+    test_parse();
+    test_bad_definition();
+
+    if (ovSimDefine("dmm", DMM_DEF) != VI_SUCCESS) {
+        printf("  definition rejected\n");
+        return 1;
+    }
+    ViSession vi;
+    if (viOpen(g_rm, "SIM::dmm::INSTR", VI_NULL, VI_NULL, &vi) != VI_SUCCESS) {
+        printf("  cannot open SIM::dmm::INSTR\n");
+        return 1;
+    }
+
+    test_idn(vi);
+    test_short_long_forms(vi);
+    test_state_vars(vi);
+    test_compound_message(vi);
+    test_numeric_suffix(vi);
+    test_block(vi);
+    test_unknown_and_stb(vi);
+    test_partial_read(vi);
+    test_delay(vi);
+    test_file_definition();
+    test_query_speed(vi);
+
+    viClose(vi);
+    viClose(g_rm);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
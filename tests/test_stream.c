@@ -0,0 +1,179 @@
+/*
+ * OpenVISA - Continuous streaming (ovStream*) tests
+ *
+ * A loopback "digitizer" waits for "START <bytes>\n" and then pushes that
+ * many bytes of a counting pattern as fast as the socket takes them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "visa.h"
+#include "openvisa.h"
+#include "testutil.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static ViSession g_rm;
+static char g_rsrc[64];
+
+static uint8_t pattern(uint64_t i) {
+    return (uint8_t)(i * 7 + (i >> 8));
+}
+
+static void *digitizer_conn(void *arg) {
+    int c = (int)(intptr_t)arg;
+    char line[64];
+    size_t n = 0;
+    while (n < sizeof(line) - 1 && recv(c, &line[n], 1, 0) == 1 && line[n] != '\n') n++;
+    line[n] = '\0';
+    uint64_t total = strtoull(line + 6, NULL, 10);
+    uint8_t chunk[16384];
+    for (uint64_t sent = 0; sent < total; ) {
+        size_t len = total - sent < sizeof(chunk) ? (size_t)(total - sent) : sizeof(chunk);
+        for (size_t i = 0; i < len; i++) chunk[i] = pattern(sent + i);
+        ssize_t w = send(c, chunk, len, MSG_NOSIGNAL);
+        if (w <= 0) break;
+        sent += (uint64_t)w;
+    }
+    close(c);
+    return NULL;
+}
+
+static ViSession start(ViUInt32 ringSize, ViUInt32 flags, uint64_t total) {
+    ViSession vi = VI_NULL;
+    char cmd[32];
+    if (viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi) != VI_SUCCESS) return VI_NULL;
+    viSetAttribute(vi, VI_ATTR_TMO_VALUE, 2000);
+    if (ovStreamStart(vi, ringSize, flags) != VI_SUCCESS) { viClose(vi); return VI_NULL; }
+    int len = snprintf(cmd, sizeof(cmd), "START %llu\n", (unsigned long long)total);
+    viWrite(vi, (ViBuf)cmd, (ViUInt32)len, VI_NULL);
+    return vi;
+}
+
+/* Consume with acquire/release until the connection ends; checks the
+ * pattern from offset 0 and returns the bytes seen, or -1 on a mismatch */
+static int64_t drain(ViSession vi, ViStatus *end) {
+    uint64_t off = 0;
+    for (;;) {
+        ViBuf p;
+        ViUInt32 n;
+        ViStatus st = ovStreamAcquire(vi, 2000, &p, &n);
+        if (st != VI_SUCCESS) { *end = st; return (int64_t)off; }
+        for (ViUInt32 i = 0; i < n; i++)
+            if (p[i] != pattern(off + i)) return -1;
+        off += n;
+        ovStreamRelease(vi, n);
+    }
+}
+
+void test_stall(void) {
+    TEST("Stalled consumer loses nothing the ring holds");
+    const uint64_t total = 8u << 20;
+    ViSession vi = start(16u << 20, 0, total);
+    if (!vi) { FAIL("start"); return; }
+    usleep(300 * 1000);      /* application busy while the instrument streams */
+    ViUInt32 hw = 0, fill = 0;
+    viGetAttribute(vi, OV_ATTR_STREAM_FILL, &fill);
+    ViStatus end = VI_SUCCESS;
+    int64_t got = drain(vi, &end);
+    ViUInt32 overflows = 1;
+    ViUInt64 received = 0;
+    viGetAttribute(vi, OV_ATTR_STREAM_HIGH_WATER, &hw);
+    viGetAttribute(vi, OV_ATTR_STREAM_OVERFLOWS, &overflows);
+    viGetAttribute(vi, OV_ATTR_STREAM_RECEIVED, &received);
+    viClose(vi);
+    printf("(%.1f MiB buffered while stalled) ", fill / 1048576.0);
+    if (got != (int64_t)total) { FAIL(got < 0 ? "corrupt" : "short"); return; }
+    if (end != VI_ERROR_CONN_LOST || overflows != 0 || received != total) { FAIL("counters"); return; }
+    if (hw < fill || fill < (1u << 20)) { FAIL("nothing buffered"); return; }
+    PASS();
+}
+
+void test_overflow(void) {
+    TEST("Full ring drops and counts the excess");
+    const uint64_t total = 4u << 20;
+    ViSession vi = start(64u << 10, 0, total);
+    if (!vi) { FAIL("start"); return; }
+    ViUInt64 received = 0;
+    for (int i = 0; i < 300 && received < total; i++) {
+        usleep(10 * 1000);
+        viGetAttribute(vi, OV_ATTR_STREAM_RECEIVED, &received);
+    }
+    ViUInt32 overflows = 0, hw = 0;
+    ViUInt64 dropped = 0;
+    viGetAttribute(vi, OV_ATTR_STREAM_OVERFLOWS, &overflows);
+    viGetAttribute(vi, OV_ATTR_STREAM_DROPPED, &dropped);
+    viGetAttribute(vi, OV_ATTR_STREAM_HIGH_WATER, &hw);
+    ViStatus end = VI_SUCCESS;
+    int64_t got = drain(vi, &end);
+    viClose(vi);
+    int ok = received == total && overflows > 0 && hw == (64u << 10) &&
+             got == (int64_t)(64u << 10) && (uint64_t)got + dropped == total;
+    if (!ok) { FAIL("counters"); return; }
+    PASS();
+}
+
+void test_viread(void) {
+    TEST("viRead copies out of a huge-page ring");
+    const uint64_t total = 1u << 20;
+    ViSession vi = start(0, OV_STREAM_HUGE_PAGES, total);
+    if (!vi) { FAIL("start"); return; }
+    static ViByte buf[100000];
+    uint64_t off = 0;
+    int ok = 1;
+    ViStatus st;
+    ViUInt32 n;
+    ViUInt16 stb;
+    /* Only viRead and viWrite may share the transport with the reader */
+    ViStatus busy[4] = {
+        viReadToFile(vi, "test_stream.bin", 16, &n),
+        viWriteFromFile(vi, "test_stream.bin", 16, &n),
+        viReadSTB(vi, &stb),
+        viClear(vi),
+    };
+    for (int i = 0; i < 4; i++) ok = ok && busy[i] == VI_ERROR_IN_PROGRESS;
+    while ((st = viRead(vi, buf, sizeof(buf), &n)) >= VI_SUCCESS) {
+        for (ViUInt32 i = 0; i < n && ok; i++) ok = buf[i] == pattern(off + i);
+        off += n;
+    }
+    ViStatus again = ovStreamStart(vi, 0, 0);
+    ViStatus stop = ovStreamStop(vi);
+    ViUInt32 fill = 1;
+    viGetAttribute(vi, OV_ATTR_STREAM_FILL, &fill);
+    ViStatus stop2 = ovStreamStop(vi);
+    viClose(vi);
+    ok = ok && off == total && st == VI_ERROR_CONN_LOST && again == VI_ERROR_IN_PROGRESS &&
+         stop == VI_SUCCESS && fill == 0 && stop2 == VI_ERROR_INV_SETUP;
+    if (!ok) { FAIL("read"); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA Streaming Tests ===\n\n");
+    signal(SIGPIPE, SIG_IGN);
+    unsetenv("OPENVISA_BROKER");
+    unsetenv("OPENVISA_POOL_IDLE_MS");
+
+    serve_socket(digitizer_conn, g_rsrc, sizeof(g_rsrc));
+
+    viOpenDefaultRM(&g_rm);
+    test_stall();
+    test_overflow();
+    test_viread();
+    viClose(g_rm);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * OpenVISA - Trigger (viAssertTrigger, ovTriggerGroup*) tests
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "visa.h"
+#include "openvisa.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define NDEV        8
+
+static ViSession g_rm;
+static ViSession g_dev[NDEV];
+
+static const char *g_def =
+    "[vars]\n"
+    "trig = 0\n"
+    "[commands]\n"
+    "*TRG  = set trig=1\n"
+    "*CLS  = set trig=0\n"
+    "TRIG? = \"{trig}\"\n";
+
+/* 1 if the device saw *TRG since the last *CLS, 0 if not, -1 on error */
+static int triggered(ViSession vi) {
+    char buf[16];
+    ViUInt32 n;
+    if (viWrite(vi, (ViBuf)"TRIG?\n", 6, &n) < VI_SUCCESS) return -1;
+    if (viRead(vi, (ViBuf)buf, sizeof(buf), &n) < VI_SUCCESS || n < 1) return -1;
+    return buf[0] == '1';
+}
+
+static void reset_all(void) {
+    ViUInt32 n;
+    for (int i = 0; i < NDEV; i++) viWrite(g_dev[i], (ViBuf)"*CLS\n", 5, &n);
+}
+
+void test_assert_trigger(void) {
+    TEST("viAssertTrigger sends *TRG to message devices");
+    reset_all();
+    if (viAssertTrigger(g_dev[0], VI_TRIG_PROT_DEFAULT) != VI_SUCCESS) { FAIL("status"); return; }
+    if (triggered(g_dev[0]) != 1 || triggered(g_dev[1]) != 0) { FAIL("not triggered"); return; }
+    if (viAssertTrigger(g_dev[0], VI_TRIG_PROT_SYNC) != VI_ERROR_INV_PROT) { FAIL("protocol"); return; }
+    PASS();
+}
+
+void test_group_fire(void) {
+    TEST("Group fire triggers every session, repeatedly");
+    OvTriggerGroup *grp;
+    if (ovTriggerGroupCreate(g_dev, NDEV, &grp) != VI_SUCCESS) { FAIL("create"); return; }
+
+    for (int round = 0; round < 3; round++) {
+        reset_all();
+        ViStatus st[NDEV];
+        ViUInt64 spread = ~0ull;
+        if (ovTriggerGroupFire(grp, st, &spread) != VI_SUCCESS) {
+            ovTriggerGroupClose(grp); FAIL("fire"); return;
+        }
+        for (int i = 0; i < NDEV; i++) {
+            if (st[i] != VI_SUCCESS || triggered(g_dev[i]) != 1) {
+                ovTriggerGroupClose(grp); FAIL("device missed trigger"); return;
+            }
+        }
+        if (spread == ~0ull) { ovTriggerGroupClose(grp); FAIL("no spread"); return; }
+        if (round == 2) printf("(spread %.1f us) ", spread / 1e3);
+    }
+    ovTriggerGroupClose(grp);
+    PASS();
+}
+
+void test_group_rejects(void) {
+    TEST("Group rejects duplicates and bad handles");
+    OvTriggerGroup *grp = NULL;
+    ViSession dup[2] = { g_dev[0], g_dev[0] };
+    if (ovTriggerGroupCreate(dup, 2, &grp) != VI_ERROR_INV_SETUP || grp) { FAIL("duplicate"); return; }
+    ViSession bad[2] = { g_dev[0], 0xDEAD };
+    if (ovTriggerGroupCreate(bad, 2, &grp) != VI_ERROR_INV_OBJECT || grp) { FAIL("bad handle"); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA Trigger Tests ===\n\n");
+
+    viOpenDefaultRM(&g_rm);
+    ovSimDefine("trg", g_def);
+    for (int i = 0; i < NDEV; i++) {
+        if (viOpen(g_rm, "SIM::trg::INSTR", VI_NULL, VI_NULL, &g_dev[i]) != VI_SUCCESS) {
+            printf("cannot open SIM::trg::INSTR\n");
+            return 1;
+        }
+    }
+
+    test_assert_trigger();
+    test_group_fire();
+    test_group_rejects();
+
+    for (int i = 0; i < NDEV; i++) viClose(g_dev[i]);
+    viClose(g_rm);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,256 @@
+/*
+ * OpenVISA - UNIX::path::SOCKET transport tests
+ *
+ * An in-process soft instrument listens on a Unix socket and answers CURV?
+ * by handing its waveform over as a memfd (SCM_RIGHTS), CURVS? with the same
+ * bytes through the socket.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "visa.h"
+#include "testutil.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  %-50s", name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define BLOCK_SIZE  (4u << 20)
+#define HEADER      "#74194304"
+#define RESP_SIZE   (sizeof(HEADER) - 1 + BLOCK_SIZE + 1)
+
+static ViSession g_rm;
+static char g_rsrc[128];
+static char g_abstract_rsrc[128];
+static uint8_t *g_block;
+static int g_memfd = -1;
+static int g_memfd_count;
+
+/* ========== Soft instrument ========== */
+
+static void send_all(int c, const void *data, size_t len) {
+    const char *p = (const char*)data;
+    while (len > 0) {
+        ssize_t n = send(c, p, len, MSG_NOSIGNAL);
+        if (n <= 0) return;
+        p += n;
+        len -= (size_t)n;
+    }
+}
+
+/* The waveform lives in one memfd that every CURV? hands out */
+static void send_block_fd(int c) {
+    int fd = g_memfd;
+    char carrier = 0;
+    struct iovec iov = { .iov_base = &carrier, .iov_len = 1 };
+    union { struct cmsghdr h; char b[CMSG_SPACE(sizeof(int))]; } ctl;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl.b;
+    msg.msg_controllen = sizeof(ctl.b);
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cm), &fd, sizeof(int));
+    sendmsg(c, &msg, MSG_NOSIGNAL);
+    __sync_add_and_fetch(&g_memfd_count, 1);
+}
+
+static void *instr_conn(void *arg) {
+    int c = (int)(intptr_t)arg;
+    char line[256];
+    size_t len = 0;
+    char ch;
+    while (recv(c, &ch, 1, 0) == 1) {
+        if (ch != '\n') {
+            if (len < sizeof(line) - 1) line[len++] = ch;
+            continue;
+        }
+        line[len] = '\0';
+        len = 0;
+        if (strcmp(line, "*IDN?") == 0) {
+            send_all(c, "ACME,SoftInst,1,1.0\n", 20);
+        } else if (strcmp(line, "CURV?") == 0) {
+            send_all(c, HEADER, sizeof(HEADER) - 1);
+            send_block_fd(c);
+            send_all(c, "\n", 1);
+        } else if (strcmp(line, "CURVS?") == 0) {
+            send_all(c, HEADER, sizeof(HEADER) - 1);
+            send_all(c, g_block, BLOCK_SIZE);
+            send_all(c, "\n", 1);
+        }
+    }
+    close(c);
+    return NULL;
+}
+
+static void start_server(const struct sockaddr_un *sun, socklen_t alen) {
+    int ls = socket(AF_UNIX, SOCK_STREAM, 0);
+    bind(ls, (const struct sockaddr*)sun, alen);
+    listen(ls, 16);
+    serve(ls, instr_conn);
+}
+
+/* ========== Tests ========== */
+
+static int idn(const char *rsrc) {
+    ViSession vi;
+    char buf[64];
+    ViUInt32 n = 0;
+    if (viOpen(g_rm, (ViRsrc)rsrc, VI_NULL, VI_NULL, &vi) != VI_SUCCESS) return 0;
+    ViStatus st = viWrite(vi, (ViBuf)"*IDN?\n", 6, &n);
+    if (st == VI_SUCCESS) st = viRead(vi, (ViBuf)buf, sizeof(buf) - 1, &n);
+    viClose(vi);
+    buf[st >= VI_SUCCESS ? n : 0] = '\0';
+    return strcmp(buf, "ACME,SoftInst,1,1.0\n") == 0;
+}
+
+void test_parse(void) {
+    TEST("Parse UNIX::path::SOCKET");
+    ViUInt16 type = 0, num = 0;
+    if (viParseRsrc(g_rm, "UNIX::/run/inst/psu0::SOCKET", &type, &num) != VI_SUCCESS ||
+        viParseRsrc(g_rm, "unix::@psu0", &type, &num) != VI_SUCCESS) { FAIL("rejected"); return; }
+    if (viParseRsrc(g_rm, "UNIX::::SOCKET", &type, &num) != VI_ERROR_INV_RSRC_NAME) { FAIL("empty path"); return; }
+    PASS();
+}
+
+void test_idn(void) {
+    TEST("Query over a Unix socket");
+    if (!idn(g_rsrc)) { FAIL("wrong response"); return; }
+    PASS();
+}
+
+void test_abstract(void) {
+    TEST("Query over an abstract Unix socket");
+    if (!idn(g_abstract_rsrc)) { FAIL("wrong response"); return; }
+    PASS();
+}
+
+static ViStatus read_curve(ViSession vi, const char *cmd, uint8_t *buf, ViUInt32 *total) {
+    ViUInt32 n;
+    ViStatus st = viWrite(vi, (ViBuf)cmd, (ViUInt32)strlen(cmd), &n);
+    *total = 0;
+    while (st >= VI_SUCCESS && *total < RESP_SIZE) {
+        st = viRead(vi, buf + *total, RESP_SIZE - *total, &n);
+        *total += n;
+    }
+    return st;
+}
+
+static int curve_ok(const uint8_t *buf, ViUInt32 n) {
+    return n == RESP_SIZE && memcmp(buf, HEADER, sizeof(HEADER) - 1) == 0 &&
+           memcmp(buf + sizeof(HEADER) - 1, g_block, BLOCK_SIZE) == 0 && buf[RESP_SIZE - 1] == '\n';
+}
+
+void test_block(void) {
+    TEST("4 MiB block handed over by memfd");
+    uint8_t *buf = (uint8_t*)malloc(RESP_SIZE);
+    ViSession vi;
+    ViUInt32 nfd = 0, nstream = 0;
+    if (viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi) != VI_SUCCESS) { FAIL("open"); free(buf); return; }
+    memset(buf, 0, RESP_SIZE);                      /* fault the pages in before timing */
+    int before = g_memfd_count;
+    double t0 = now_ms();
+    ViStatus st = read_curve(vi, "CURV?\n", buf, &nfd);
+    double t_fd = now_ms() - t0;
+    int ok_fd = st >= VI_SUCCESS && curve_ok(buf, nfd);
+    memset(buf, 0, RESP_SIZE);
+    t0 = now_ms();
+    st = read_curve(vi, "CURVS?\n", buf, &nstream);
+    double t_stream = now_ms() - t0;
+    int ok_stream = st >= VI_SUCCESS && curve_ok(buf, nstream);
+    viClose(vi);
+    free(buf);
+    if (g_memfd_count != before + 1) { FAIL("no descriptor sent"); return; }
+    if (!ok_fd) { FAIL("memfd data differs"); return; }
+    if (!ok_stream) { FAIL("stream data differs"); return; }
+    printf("(%.1f vs %.1f ms) ", t_fd, t_stream);
+    PASS();
+}
+
+void test_read_to_file(void) {
+    TEST("viReadToFile of a handed-over block");
+    char path[] = "/tmp/ovunix-curve-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) { FAIL("tmp file"); return; }
+    close(fd);
+    ViSession vi;
+    ViUInt32 n = 0, total = 0;
+    ViStatus st = viOpen(g_rm, g_rsrc, VI_NULL, VI_NULL, &vi);
+    if (st == VI_SUCCESS) st = viWrite(vi, (ViBuf)"CURV?\n", 6, &n);
+    if (st == VI_SUCCESS) st = viReadToFile(vi, path, RESP_SIZE, &total);
+    viClose(vi);
+
+    uint8_t *buf = (uint8_t*)malloc(RESP_SIZE + 1);
+    FILE *f = fopen(path, "rb");
+    size_t got = f ? fread(buf, 1, RESP_SIZE + 1, f) : 0;
+    if (f) fclose(f);
+    unlink(path);
+    int ok = st >= VI_SUCCESS && total == RESP_SIZE && got == RESP_SIZE && curve_ok(buf, (ViUInt32)got);
+    free(buf);
+    if (!ok) { FAIL("file differs"); return; }
+    PASS();
+}
+
+void test_missing(void) {
+    TEST("Missing socket reports RSRC_NFOUND");
+    ViSession vi;
+    ViStatus st = viOpen(g_rm, "UNIX::/nonexistent/inst.sock::SOCKET", VI_NULL, VI_NULL, &vi);
+    if (st == VI_SUCCESS) viClose(vi);
+    if (st != VI_ERROR_RSRC_NFOUND) { FAIL("wrong status"); return; }
+    PASS();
+}
+
+int main(void) {
+    printf("\n=== OpenVISA Unix Socket Tests ===\n\n");
+    signal(SIGPIPE, SIG_IGN);
+
+    g_block = (uint8_t*)malloc(BLOCK_SIZE);
+    for (uint32_t i = 0; i < BLOCK_SIZE; i++) g_block[i] = (uint8_t)(i * 7 % 251);
+    g_memfd = memfd_create("curve", MFD_CLOEXEC);
+    if (g_memfd < 0 || write(g_memfd, g_block, BLOCK_SIZE) != (ssize_t)BLOCK_SIZE) return 1;
+
+    char dir[] = "/tmp/ovunix-XXXXXX";
+    if (!mkdtemp(dir)) return 1;
+    struct sockaddr_un sun = { .sun_family = AF_UNIX };
+    snprintf(sun.sun_path, sizeof(sun.sun_path), "%s/inst.sock", dir);
+    snprintf(g_rsrc, sizeof(g_rsrc), "UNIX::%s::SOCKET", sun.sun_path);
+    start_server(&sun, sizeof(sun));
+
+    struct sockaddr_un asun = { .sun_family = AF_UNIX };
+    int alen = snprintf(asun.sun_path + 1, sizeof(asun.sun_path) - 1, "ovunix-test-%d", (int)getpid());
+    snprintf(g_abstract_rsrc, sizeof(g_abstract_rsrc), "UNIX::@%s::SOCKET", asun.sun_path + 1);
+    start_server(&asun, (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + (size_t)alen));
+
+    viOpenDefaultRM(&g_rm);
+    test_parse();
+    test_idn();
+    test_abstract();
+    test_block();
+    test_read_to_file();
+    test_missing();
+    viClose(g_rm);
+
+    unlink(sun.sun_path);
+    rmdir(dir);
+    free(g_block);
+
+    printf("\n=== Results: %d passed, %d failed ===\n\n",
+           tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * OpenVISA - Helpers shared by the tests
+ */
+
+#include "testutil.h"
+#include "core/thread.h"
+
+#ifndef _WIN32
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+double now_ms(void) {
+    return ov_time_ns() / 1e6;
+}
+
+double now_us(void) {
+    return ov_time_ns() / 1e3;
+}
+
+#ifndef _WIN32
+
+int listen_loopback(int backlog, int *port) {
+    int ls = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t alen = sizeof(addr);
+    if (ls < 0) return -1;
+    if (bind(ls, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(ls, backlog) != 0 ||
+        getsockname(ls, (struct sockaddr*)&addr, &alen) != 0) {
+        close(ls);
+        return -1;
+    }
+    *port = ntohs(addr.sin_port);
+    return ls;
+}
+
+typedef struct {
+    int ls;
+    void *(*conn)(void *);
+} Server;
+
+static void *server_thread(void *arg) {
+    Server srv = *(Server*)arg;
+    free(arg);
+    for (;;) {
+        int c = accept(srv.ls, NULL, NULL);
+        if (c < 0) return NULL;
+        pthread_t th;
+        pthread_create(&th, NULL, srv.conn, (void*)(intptr_t)c);
+        pthread_detach(th);
+    }
+}
+
+void serve(int ls, void *(*conn)(void *)) {
+    Server *srv = (Server*)malloc(sizeof(Server));
+    srv->ls = ls;
+    srv->conn = conn;
+    pthread_t th;
+    pthread_create(&th, NULL, server_thread, srv);
+    pthread_detach(th);
+}
+
+int serve_socket(void *(*conn)(void *), char *rsrc, size_t size) {
+    int port;
+    int ls = listen_loopback(16, &port);
+    if (ls < 0) return -1;
+    snprintf(rsrc, size, "TCPIP::127.0.0.1::%d::SOCKET", port);
+    serve(ls, conn);
+    return ls;
+}
+
+#endif
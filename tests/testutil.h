@@ -0,0 +1,25 @@
+/*
+ * OpenVISA - Helpers shared by the tests
+ *
+ * A monotonic clock, and on POSIX a loopback server: serve() accepts on a
+ * listener and runs conn((void*)(intptr_t)fd) on a detached thread per
+ * connection, which closes the fd when done.
+ */
+
+#ifndef OPENVISA_TESTUTIL_H
+#define OPENVISA_TESTUTIL_H
+
+#include <stddef.h>
+
+double now_ms(void);
+double now_us(void);
+
+#ifndef _WIN32
+/* Listener on 127.0.0.1 and an ephemeral port (*port); -1 on failure */
+int  listen_loopback(int backlog, int *port);
+void serve(int ls, void *(*conn)(void *));
+/* Both of the above; rsrc receives "TCPIP::127.0.0.1::<port>::SOCKET" */
+int  serve_socket(void *(*conn)(void *), char *rsrc, size_t size);
+#endif
+
+#endif /* OPENVISA_TESTUTIL_H */